@@ -19,6 +19,7 @@
 #import "YapBidirectionalCache.h"
 #import "YapCache.h"
 #import "YapCollectionKey.h"
+#import "YapDatabaseCollectionStatistics.h"
 #import "YapDatabaseConnectionConfig.h"
 #import "YapDatabaseConnectionPool.h"
 #import "YapDatabaseConnectionProxy.h"
@@ -57,6 +58,8 @@
 
 #import "YapDatabaseSecondaryIndex.h"
 #import "YapDatabaseSecondaryIndexOptions.h"
+#import "YapDatabaseSecondaryIndexPreparedQuery.h"
+#import "YapDatabaseSecondaryIndexJoinedQuery.h"
 #import "YapDatabaseSecondaryIndexConnection.h"
 #import "YapDatabaseSecondaryIndexTransaction.h"
 #import "YapDatabaseSecondaryIndexHandler.h"
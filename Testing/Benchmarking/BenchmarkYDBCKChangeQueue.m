@@ -0,0 +1,210 @@
+#import "BenchmarkYDBCKChangeQueue.h"
+#import "YDBCKChangeQueue.h"
+#import "YDBCKChangeRecord.h"
+#import "YapDatabaseCloudKitPrivate.h"
+
+#import <CloudKit/CloudKit.h>
+
+#define QUEUED_CHANGESET_COUNT   1000   // Number of changeSets in the queue before the test starts
+#define RECORDS_PER_CHANGESET     100   // Number of modified records per queued changeSet
+#define MODIFICATIONS_TOTAL    100000   // Total number of record modifications
+#define MODIFICATIONS_PER_COMMIT  500   // Number of record modifications per (simulated) transaction
+#define SAVED_CHANGESET_COUNT     100   // Number of inFlight changeSets to complete (one record at a time)
+
+
+/**
+ * Synthetic stress test for the YDBCKChangeQueue.
+ *
+ * Every transaction that touches a CKRecord must consult the changeSets from previous commits
+ * (those that haven't been uploaded to the server yet).
+ * So we fill the queue with a large number of changeSets, and then measure the cost of
+ * modifying records & completing inFlight changeSets, one simulated transaction at a time.
+**/
+@implementation BenchmarkYDBCKChangeQueue
+
+static NSMutableArray<CKRecordID *> *recordIDs;
+
++ (CKRecord *)recordWithID:(CKRecordID *)recordID value:(NSUInteger)value
+{
+	CKRecord *record = [[CKRecord alloc] initWithRecordType:@"benchmark" recordID:recordID];
+	[record setObject:@(value) forKey:@"value"];
+	
+	return record;
+}
+
++ (YDBCKChangeQueue *)generateMasterQueue
+{
+	YDBCKChangeQueue *masterQueue = [[YDBCKChangeQueue alloc] initMasterQueue];
+	
+	NSUInteger recordCount = QUEUED_CHANGESET_COUNT * RECORDS_PER_CHANGESET;
+	recordIDs = [NSMutableArray arrayWithCapacity:recordCount];
+	
+	for (NSUInteger i = 0; i < recordCount; i++)
+	{
+		NSString *recordName = [[NSUUID UUID] UUIDString];
+		[recordIDs addObject:[[CKRecordID alloc] initWithRecordName:recordName]];
+	}
+	
+	NSMutableArray<YDBCKChangeSet *> *changeSets = [NSMutableArray arrayWithCapacity:QUEUED_CHANGESET_COUNT];
+	NSString *prev = nil;
+	
+	for (NSUInteger i = 0; i < QUEUED_CHANGESET_COUNT; i++)
+	{
+		YDBCKChangeSet *changeSet = [[YDBCKChangeSet alloc] initWithDatabaseIdentifier:nil];
+		changeSet.uuid = [[NSUUID UUID] UUIDString];
+		changeSet.prev = prev;
+		prev = changeSet.uuid;
+		
+		changeSet->modifiedRecords = [[NSMutableDictionary alloc] initWithCapacity:RECORDS_PER_CHANGESET];
+		
+		for (NSUInteger j = 0; j < RECORDS_PER_CHANGESET; j++)
+		{
+			// Spread each record across multiple changeSets,
+			// so a single modification has to touch several previous commits.
+			
+			NSUInteger recordIndex = (NSUInteger)arc4random_uniform((uint32_t)recordCount);
+			CKRecordID *recordID = recordIDs[recordIndex];
+			
+			YDBCKChangeRecord *changeRecord =
+			  [[YDBCKChangeRecord alloc] initWithRecord:[self recordWithID:recordID value:j]];
+			
+			changeSet->modifiedRecords[recordID] = changeRecord;
+		}
+		
+		[changeSets addObject:changeSet];
+	}
+	
+	[masterQueue restoreOldChangeSets:changeSets];
+	return masterQueue;
+}
+
++ (NSTimeInterval)testModifiedRecords:(YDBCKChangeQueue *)masterQueue
+{
+	NSUInteger recordCount = [recordIDs count];
+	NSUInteger remaining = MODIFICATIONS_TOTAL;
+	NSUInteger touchedChangeSets = 0;
+	
+	NSDate *start = [NSDate date];
+	
+	while (remaining > 0)
+	{
+		NSUInteger count = MIN(remaining, MODIFICATIONS_PER_COMMIT);
+		remaining -= count;
+		
+		YDBCKChangeQueue *pendingQueue = [masterQueue newPendingQueue];
+		
+		for (NSUInteger i = 0; i < count; i++)
+		{
+			NSUInteger recordIndex = (NSUInteger)arc4random_uniform((uint32_t)recordCount);
+			CKRecord *record = [self recordWithID:recordIDs[recordIndex] value:i];
+			
+			[masterQueue updatePendingQueue:pendingQueue
+			             withModifiedRecord:record
+			             databaseIdentifier:nil
+			                 originalValues:nil];
+		}
+		
+		touchedChangeSets += [pendingQueue.changeSetsFromPreviousCommits count];
+		
+		[masterQueue mergePendingQueue:pendingQueue];
+	}
+	
+	NSTimeInterval elapsed = [start timeIntervalSinceNow] * -1.0;
+	
+	NSLog(@"Modified records: %lu, elapsed = %.6f (touched %lu previous changeSets)",
+	      (unsigned long)MODIFICATIONS_TOTAL, elapsed, (unsigned long)touchedChangeSets);
+	
+	return elapsed;
+}
+
++ (NSTimeInterval)testPendingLookups:(YDBCKChangeQueue *)masterQueue
+{
+	NSUInteger hitCount = 0;
+	
+	NSDate *start = [NSDate date];
+	
+	for (CKRecordID *recordID in recordIDs)
+	{
+		BOOL hasPendingModification = NO;
+		BOOL hasPendingDelete = NO;
+		
+		[masterQueue getHasPendingModification:&hasPendingModification
+		                      hasPendingDelete:&hasPendingDelete
+		                           forRecordID:recordID
+		                    databaseIdentifier:nil];
+		
+		if (hasPendingModification) {
+			hitCount++;
+		}
+	}
+	
+	NSTimeInterval elapsed = [start timeIntervalSinceNow] * -1.0;
+	
+	NSLog(@"Pending lookups: %lu, elapsed = %.6f (hits %lu)",
+	      (unsigned long)[recordIDs count], elapsed, (unsigned long)hitCount);
+	
+	return elapsed;
+}
+
++ (NSTimeInterval)testSavedRecords:(YDBCKChangeQueue *)masterQueue
+{
+	NSUInteger savedCount = 0;
+	
+	NSDate *start = [NSDate date];
+	
+	for (NSUInteger i = 0; i < SAVED_CHANGESET_COUNT; i++)
+	{
+		BOOL isAlreadyInFlight = NO;
+		YDBCKChangeSet *inFlightChangeSet = [masterQueue makeInFlightChangeSet:&isAlreadyInFlight];
+		
+		if (inFlightChangeSet == nil) break;
+		
+		// Simulate CKModifyRecordsOperation.perRecordCompletionBlock,
+		// which results in one transaction per saved record.
+		
+		for (CKRecord *record in inFlightChangeSet.recordsToSave_noCopy)
+		{
+			YDBCKChangeQueue *pendingQueue = [masterQueue newPendingQueue];
+			
+			[masterQueue updatePendingQueue:pendingQueue
+			                withSavedRecord:record
+			             databaseIdentifier:nil
+			          isOpPartialCompletion:YES];
+			
+			[masterQueue mergePendingQueue:pendingQueue];
+			savedCount++;
+		}
+		
+		[masterQueue removeCompletedInFlightChangeSet];
+	}
+	
+	NSTimeInterval elapsed = [start timeIntervalSinceNow] * -1.0;
+	
+	NSLog(@"Saved records: %lu, elapsed = %.6f", (unsigned long)savedCount, elapsed);
+	
+	return elapsed;
+}
+
++ (void)runTestsWithCompletion:(dispatch_block_t)completionBlock
+{
+	dispatch_async(dispatch_get_main_queue(), ^{
+		
+		NSLog(@" \n\n\n ");
+		NSLog(@"====================================================");
+		NSLog(@"YDBCKChangeQueue: %lu queued changeSets, %lu records per changeSet \n\n",
+		      (unsigned long)QUEUED_CHANGESET_COUNT, (unsigned long)RECORDS_PER_CHANGESET);
+		
+		YDBCKChangeQueue *masterQueue = [self generateMasterQueue];
+		
+		[self testModifiedRecords:masterQueue];
+		[self testPendingLookups:masterQueue];
+		[self testSavedRecords:masterQueue];
+		
+		NSLog(@"====================================================");
+		
+		recordIDs = nil;
+		completionBlock();
+	});
+}
+
+@end
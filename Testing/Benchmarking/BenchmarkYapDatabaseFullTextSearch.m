@@ -0,0 +1,172 @@
+#import "BenchmarkYapDatabaseFullTextSearch.h"
+#import "YapDatabase.h"
+#import "YapDatabaseFullTextSearch.h"
+
+
+@implementation BenchmarkYapDatabaseFullTextSearch
+
+static NSArray<NSString *> *corpus;
+static NSUInteger corpusLength;
+
++ (NSString *)databaseName
+{
+	return @"BenchmarkYapDatabaseFullTextSearch.sqlite";
+}
+
++ (NSURL *)databaseURL
+{
+	NSArray<NSURL*> *urls = [[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask];
+	NSURL *baseDir = [urls firstObject];
+	
+	return [baseDir URLByAppendingPathComponent:[self databaseName] isDirectory:NO];
+}
+
+/**
+ * Generates a corpus of (roughly) the given size in bytes.
+ * Each document is about 1 KB of (ASCII) english-ish text, with mixed case & punctuation.
+**/
++ (void)generateCorpusWithLength:(NSUInteger)length
+{
+	NSArray<NSString *> *words = @[
+	  @"The", @"quick", @"brown", @"fox", @"jumps", @"over", @"the", @"lazy", @"dog.",
+	  @"Lorem", @"ipsum", @"dolor", @"sit", @"amet,", @"consectetur", @"adipiscing", @"elit;",
+	  @"meeting", @"tomorrow", @"at", @"10:30", @"re:", @"invoice", @"#4471", @"(draft)", @"coffee-shop"
+	];
+	
+	NSMutableArray<NSString *> *documents = [NSMutableArray array];
+	NSUInteger total = 0;
+	
+	srandom(42);
+	
+	while (total < length)
+	{
+		NSMutableString *document = [NSMutableString stringWithCapacity:1100];
+		
+		while ([document length] < 1024)
+		{
+			[document appendString:words[random() % [words count]]];
+			[document appendString:@" "];
+		}
+		
+		[documents addObject:document];
+		total += [document length];
+	}
+	
+	corpus = [documents copy];
+	corpusLength = total;
+}
+
++ (YapDatabaseFullTextSearch *)ftsWithTokenizer:(NSString *)tokenizer
+{
+	YapDatabaseFullTextSearchHandler *handler = [YapDatabaseFullTextSearchHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object){
+		
+		[dict setObject:object forKey:@"content"];
+	}];
+	
+	NSDictionary *options = @{ @"tokenize": [NSString stringWithFormat:@"'%@'", tokenizer] };
+	
+	return [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                      options:options
+	                                                      handler:handler
+	                                                   ftsVersion:YapDatabaseFullTextSearchFTS5Version
+	                                                   versionTag:nil];
+}
+
+/**
+ * Measures the time to index the corpus during writes (extension registered beforehand),
+ * and the time to populate the index for the existing corpus (extension registered afterwards).
+**/
++ (void)benchmarkTokenizer:(NSString *)tokenizer
+{
+	NSURL *databaseURL = [self databaseURL];
+	double megabytes = (double)corpusLength / (1024.0 * 1024.0);
+	
+	// Insert
+	{
+		[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+		
+		YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+		YapDatabaseConnection *connection = [database newConnection];
+		
+		[database registerExtension:[self ftsWithTokenizer:tokenizer] withName:@"fts"];
+		
+		NSDate *start = [NSDate date];
+		
+		[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			[corpus enumerateObjectsUsingBlock:^(NSString *document, NSUInteger idx, BOOL *stop) {
+				
+				NSString *key = [NSString stringWithFormat:@"%lu", (unsigned long)idx];
+				[transaction setObject:document forKey:key inCollection:nil];
+			}];
+		}];
+		
+		NSTimeInterval elapsed = [start timeIntervalSinceNow] * -1.0;
+		
+		NSLog(@"%@ insert: total time: %.6f, throughput: %.2f MB/s", tokenizer, elapsed, (megabytes / elapsed));
+	}
+	
+	// Populate
+	{
+		[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+		
+		YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+		YapDatabaseConnection *connection = [database newConnection];
+		
+		[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			[corpus enumerateObjectsUsingBlock:^(NSString *document, NSUInteger idx, BOOL *stop) {
+				
+				NSString *key = [NSString stringWithFormat:@"%lu", (unsigned long)idx];
+				[transaction setObject:document forKey:key inCollection:nil];
+			}];
+		}];
+		
+		NSDate *start = [NSDate date];
+		
+		[database registerExtension:[self ftsWithTokenizer:tokenizer] withName:@"fts"];
+		
+		NSTimeInterval elapsed = [start timeIntervalSinceNow] * -1.0;
+		
+		NSLog(@"%@ populate: total time: %.6f, throughput: %.2f MB/s", tokenizer, elapsed, (megabytes / elapsed));
+	}
+}
+
++ (void)runTestsWithCompletion:(dispatch_block_t)completionBlock
+{
+	[self generateCorpusWithLength:(8 * 1024 * 1024)];
+	
+	// Run tests
+	
+	dispatch_async(dispatch_get_main_queue(), ^{
+		
+		NSLog(@" \n\n\n ");
+		NSLog(@"YapDatabaseFullTextSearch Benchmarks:");
+		NSLog(@"====================================================");
+		NSLog(@"TOKENIZER THROUGHPUT (%.1f MB corpus, %lu documents)",
+		      ((double)corpusLength / (1024.0 * 1024.0)), (unsigned long)[corpus count]);
+		
+		[self benchmarkTokenizer:@"unicode61"];
+		[self benchmarkTokenizer:YapDatabaseFullTextSearchFastTokenizer];
+		
+		NSLog(@"====================================================");
+	});
+	dispatch_async(dispatch_get_main_queue(), ^{
+		
+		NSLog(@"TOKENIZER THROUGHPUT (EDGE N-GRAMS)");
+		
+		NSString *tokenizer = [NSString stringWithFormat:@"%@ edge_ngram 2 8", YapDatabaseFullTextSearchFastTokenizer];
+		[self benchmarkTokenizer:tokenizer];
+		
+		NSLog(@"====================================================");
+	});
+	dispatch_async(dispatch_get_main_queue(), ^{
+		
+		corpus = nil;
+		
+		completionBlock();
+	});
+}
+
+@end
@@ -0,0 +1,8 @@
+#import <Foundation/Foundation.h>
+
+
+@interface BenchmarkYapDatabaseRTreeIndex : NSObject
+
++ (void)runTestsWithCompletion:(dispatch_block_t)completionBlock;
+
+@end
@@ -0,0 +1,243 @@
+#import "BenchmarkYapDatabaseRTreeIndex.h"
+#import "YapDatabase.h"
+#import "YapDatabaseRTreeIndex.h"
+
+
+@implementation BenchmarkYapDatabaseRTreeIndex
+
+static NSArray<NSArray<NSNumber *> *> *points;
+
++ (NSString *)databaseName
+{
+	return @"BenchmarkYapDatabaseRTreeIndex.sqlite";
+}
+
++ (NSURL *)databaseURL
+{
+	NSArray<NSURL*> *urls = [[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask];
+	NSURL *baseDir = [urls firstObject];
+	
+	return [baseDir URLByAppendingPathComponent:[self databaseName] isDirectory:NO];
+}
+
+/**
+ * Generates points that resemble a set of GPS tracks:
+ * each track is a random walk, starting from a random location within a 10 x 10 degree area.
+**/
++ (void)generatePointsWithCount:(NSUInteger)count
+{
+	NSMutableArray *result = [NSMutableArray arrayWithCapacity:count];
+	
+	srandom(42);
+	
+	double lat = 0.0;
+	double lon = 0.0;
+	
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		if ((i % 1000) == 0)
+		{
+			lat = 40.0 + ((double)(random() % 10000) / 1000.0);
+			lon = -80.0 + ((double)(random() % 10000) / 1000.0);
+		}
+		else
+		{
+			lat += ((double)(random() % 201) - 100.0) / 100000.0;
+			lon += ((double)(random() % 201) - 100.0) / 100000.0;
+		}
+		
+		[result addObject:@[ @(lat), @(lon) ]];
+	}
+	
+	points = [result copy];
+}
+
++ (YapDatabaseRTreeIndex *)rtree
+{
+	YapDatabaseRTreeIndexSetup *setup = [[YapDatabaseRTreeIndexSetup alloc] init];
+	[setup setColumns:@[ @"minLat", @"maxLat", @"minLon", @"maxLon" ]];
+	
+	YapDatabaseRTreeIndexHandler *handler = [YapDatabaseRTreeIndexHandler withObjectBlock:
+	    ^(NSMutableDictionary *dict, NSString *collection, NSString *key, id object){
+		
+		__unsafe_unretained NSArray<NSNumber *> *point = (NSArray<NSNumber *> *)object;
+		
+		dict[@"minLat"] = point[0];
+		dict[@"maxLat"] = point[0];
+		dict[@"minLon"] = point[1];
+		dict[@"maxLon"] = point[1];
+	}];
+	
+	return [[YapDatabaseRTreeIndex alloc] initWithSetup:setup handler:handler versionTag:nil];
+}
+
++ (void)insertPointsWithConnection:(YapDatabaseConnection *)connection batchSize:(NSUInteger)batchSize
+{
+	NSUInteger count = [points count];
+	
+	for (NSUInteger offset = 0; offset < count; offset += batchSize)
+	{
+		[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			NSUInteger end = MIN(offset + batchSize, count);
+			for (NSUInteger i = offset; i < end; i++)
+			{
+				NSString *key = [NSString stringWithFormat:@"%lu", (unsigned long)i];
+				[transaction setObject:points[i] forKey:key inCollection:nil];
+			}
+		}];
+	}
+}
+
+/**
+ * Runs a fixed set of window queries (about 1 km square, centered on random points),
+ * and returns the total time.
+**/
++ (NSTimeInterval)queryWithConnection:(YapDatabaseConnection *)connection count:(NSUInteger)queryCount
+{
+	srandom(7);
+	
+	__block NSUInteger matches = 0;
+	NSDate *start = [NSDate date];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		for (NSUInteger i = 0; i < queryCount; i++)
+		{
+			NSArray<NSNumber *> *point = points[random() % [points count]];
+			double lat = [point[0] doubleValue];
+			double lon = [point[1] doubleValue];
+			
+			YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:
+			  @"WHERE minLat >= ? AND maxLat <= ? AND minLon >= ? AND maxLon <= ?",
+			  @(lat - 0.005), @(lat + 0.005), @(lon - 0.005), @(lon + 0.005)];
+			
+			NSUInteger count = 0;
+			[[transaction ext:@"rtree"] getNumberOfRows:&count matchingQuery:query];
+			
+			matches += count;
+		}
+	}];
+	
+	NSTimeInterval elapsed = [start timeIntervalSinceNow] * -1.0;
+	
+	NSLog(@"  %lu queries: total time: %.6f, avg matches: %.1f",
+	      (unsigned long)queryCount, elapsed, ((double)matches / (double)queryCount));
+	
+	return elapsed;
+}
+
+/**
+ * Finds the closest 20 points to random locations, via the nearest neighbour search.
+**/
++ (void)benchmarkNearestNeighboursWithConnection:(YapDatabaseConnection *)connection count:(NSUInteger)queryCount
+{
+	srandom(7);
+	
+	NSDate *start = [NSDate date];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		for (NSUInteger i = 0; i < queryCount; i++)
+		{
+			NSArray<NSNumber *> *point = points[random() % [points count]];
+			
+			__block NSUInteger count = 0;
+			[[transaction ext:@"rtree"] enumerateKeysNearestToPoint:point
+			                                             usingBlock:^(NSString *collection, NSString *key, double distance, BOOL *stop)
+			{
+				if (++count == 20) *stop = YES;
+			}];
+		}
+	}];
+	
+	NSTimeInterval elapsed = [start timeIntervalSinceNow] * -1.0;
+	
+	NSLog(@"  %lu nearest neighbour queries (k=20): total time: %.6f", (unsigned long)queryCount, elapsed);
+}
+
++ (void)benchmarkBulkLoad
+{
+	NSURL *databaseURL = [self databaseURL];
+	
+	// Incremental (many small transactions, so every entry is inserted one at a time)
+	{
+		[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+		
+		YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+		YapDatabaseConnection *connection = [database newConnection];
+		
+		[database registerExtension:[self rtree] withName:@"rtree"];
+		
+		NSDate *start = [NSDate date];
+		
+		[self insertPointsWithConnection:connection batchSize:100];
+		
+		NSTimeInterval elapsed = [start timeIntervalSinceNow] * -1.0;
+		NSLog(@"incremental insert: total time: %.6f", elapsed);
+		
+		NSLog(@"incremental queries:");
+		[self queryWithConnection:connection count:1000];
+		
+		start = [NSDate date];
+		
+		[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			[[transaction ext:@"rtree"] repack];
+		}];
+		
+		elapsed = [start timeIntervalSinceNow] * -1.0;
+		NSLog(@"repack: total time: %.6f", elapsed);
+		
+		NSLog(@"repacked queries:");
+		[self queryWithConnection:connection count:1000];
+	}
+	
+	// Populate (extension registered afterwards, so the rtree is bulk loaded)
+	{
+		[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+		
+		YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+		YapDatabaseConnection *connection = [database newConnection];
+		
+		[self insertPointsWithConnection:connection batchSize:[points count]];
+		
+		NSDate *start = [NSDate date];
+		
+		[database registerExtension:[self rtree] withName:@"rtree"];
+		
+		NSTimeInterval elapsed = [start timeIntervalSinceNow] * -1.0;
+		NSLog(@"populate (bulk load): total time: %.6f", elapsed);
+		
+		NSLog(@"bulk loaded queries:");
+		[self queryWithConnection:connection count:1000];
+		[self benchmarkNearestNeighboursWithConnection:connection count:1000];
+	}
+}
+
++ (void)runTestsWithCompletion:(dispatch_block_t)completionBlock
+{
+	[self generatePointsWithCount:200000];
+	
+	// Run tests
+	
+	dispatch_async(dispatch_get_main_queue(), ^{
+		
+		NSLog(@" \n\n\n ");
+		NSLog(@"YapDatabaseRTreeIndex Benchmarks:");
+		NSLog(@"====================================================");
+		NSLog(@"BULK LOAD (%lu points)", (unsigned long)[points count]);
+		
+		[self benchmarkBulkLoad];
+		
+		NSLog(@"====================================================");
+	});
+	dispatch_async(dispatch_get_main_queue(), ^{
+		
+		points = nil;
+		
+		completionBlock();
+	});
+}
+
+@end
@@ -0,0 +1,158 @@
+#import "BenchmarkYapDatabaseRelationship.h"
+#import "YapDatabase.h"
+#import "YapDatabaseRelationship.h"
+
+
+@implementation BenchmarkYapDatabaseRelationship
+
+static YapDatabase *database;
+static YapDatabaseConnection *connection;
+
++ (NSString *)databaseName
+{
+	return @"BenchmarkYapDatabaseRelationship.sqlite";
+}
+
++ (NSURL *)databaseURL
+{
+	NSArray<NSURL*> *urls = [[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask];
+	NSURL *baseDir = [urls firstObject];
+	
+	return [baseDir URLByAppendingPathComponent:[self databaseName] isDirectory:NO];
+}
+
+/**
+ * Creates a tree with the given fanout & depth, rooted at the given key.
+ * Every edge points from child to parent, with YDB_DeleteSourceIfDestinationDeleted.
+ * That is, deleting the root cascades to the entire tree.
+ *
+ * Returns the total number of nodes created (including the root).
+**/
++ (NSUInteger)populateTreeWithRoot:(NSString *)rootKey fanout:(NSUInteger)fanout depth:(NSUInteger)depth
+{
+	__block NSUInteger count = 0;
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		YapDatabaseRelationshipTransaction *relationship = [transaction ext:@"relationship"];
+		
+		[transaction setObject:rootKey forKey:rootKey inCollection:nil];
+		count++;
+		
+		NSMutableArray *level = [NSMutableArray arrayWithObject:rootKey];
+		
+		for (NSUInteger d = 0; d < depth; d++)
+		{
+			NSMutableArray *nextLevel = [NSMutableArray arrayWithCapacity:([level count] * fanout)];
+			
+			for (NSString *parentKey in level)
+			{
+				for (NSUInteger f = 0; f < fanout; f++)
+				{
+					NSString *childKey = [NSString stringWithFormat:@"%@-%lu", parentKey, (unsigned long)f];
+					
+					[transaction setObject:childKey forKey:childKey inCollection:nil];
+					count++;
+					
+					YapDatabaseRelationshipEdge *edge =
+					  [YapDatabaseRelationshipEdge edgeWithName:@"parent"
+					                                  sourceKey:childKey
+					                                 collection:nil
+					                             destinationKey:parentKey
+					                                 collection:nil
+					                            nodeDeleteRules:YDB_DeleteSourceIfDestinationDeleted];
+					
+					[relationship addEdge:edge];
+					
+					[nextLevel addObject:childKey];
+				}
+			}
+			
+			level = nextLevel;
+		}
+	}];
+	
+	return count;
+}
+
++ (void)cascadeDeleteTreeWithFanout:(NSUInteger)fanout depth:(NSUInteger)depth
+{
+	NSString *rootKey = [NSString stringWithFormat:@"root_%lu_%lu", (unsigned long)fanout, (unsigned long)depth];
+	
+	NSUInteger nodeCount = [self populateTreeWithRoot:rootKey fanout:fanout depth:depth];
+	
+	NSDate *start = [NSDate date];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeObjectForKey:rootKey inCollection:nil];
+	}];
+	
+	NSTimeInterval elapsed = [start timeIntervalSinceNow] * -1.0;
+	
+	__block NSUInteger remaining = 0;
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		remaining = [transaction numberOfKeysInCollection:nil];
+	}];
+	
+	NSLog(@"Cascade delete (fanout %lu, depth %lu): total time: %.6f, deleted nodes: %lu, remaining: %lu",
+	      (unsigned long)fanout, (unsigned long)depth, elapsed, (unsigned long)nodeCount, (unsigned long)remaining);
+}
+
++ (void)runTestsWithCompletion:(dispatch_block_t)completionBlock
+{
+	NSURL *databaseURL = [self databaseURL];
+	
+	// Delete old database file (if exists)
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	// Create database
+	database = [[YapDatabase alloc] initWithURL:databaseURL];
+	connection = [database newConnection];
+	
+	YapDatabaseRelationship *relationship = [[YapDatabaseRelationship alloc] init];
+	[database registerExtension:relationship withName:@"relationship"];
+	
+	// Run tests
+	
+	dispatch_async(dispatch_get_main_queue(), ^{
+		
+		NSLog(@" \n\n\n ");
+		NSLog(@"YapDatabaseRelationship Benchmarks:");
+		NSLog(@"====================================================");
+		NSLog(@"CASCADE DELETE (WIDE)");
+		
+		[self cascadeDeleteTreeWithFanout:1000 depth:1];
+		[self cascadeDeleteTreeWithFanout:10000 depth:1];
+		
+		NSLog(@"====================================================");
+	});
+	dispatch_async(dispatch_get_main_queue(), ^{
+		
+		NSLog(@"CASCADE DELETE (DEEP)");
+		
+		[self cascadeDeleteTreeWithFanout:1 depth:1000];
+		[self cascadeDeleteTreeWithFanout:1 depth:5000];
+		
+		NSLog(@"====================================================");
+	});
+	dispatch_async(dispatch_get_main_queue(), ^{
+		
+		NSLog(@"CASCADE DELETE (BALANCED)");
+		
+		[self cascadeDeleteTreeWithFanout:4 depth:6];
+		[self cascadeDeleteTreeWithFanout:10 depth:4];
+		
+		NSLog(@"====================================================");
+	});
+	dispatch_async(dispatch_get_main_queue(), ^{
+		
+		database = nil;
+		connection = nil;
+		
+		completionBlock();
+	});
+}
+
+@end
@@ -138,5 +138,6 @@
 @property (nonatomic, strong, readonly) NSString *key;
 
 + (NSUInteger)notifyCount;
++ (YapDatabaseRelationshipEdge *)lastNotifyEdge;
 
 @end
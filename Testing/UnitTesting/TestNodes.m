@@ -377,6 +377,7 @@
 @implementation Node_NotifyCount
 
 static NSUInteger notifyCount = 0;
+static YapDatabaseRelationshipEdge *lastNotifyEdge = nil;
 
 @synthesize key = key;
 
@@ -412,6 +413,7 @@ static NSUInteger notifyCount = 0;
                                        withReason:(YDB_NotifyReason)reason
 {
 	notifyCount++;
+	lastNotifyEdge = edge;
 	return nil;
 }
 
@@ -420,4 +422,9 @@ static NSUInteger notifyCount = 0;
 	return notifyCount;
 }
 
++ (YapDatabaseRelationshipEdge *)lastNotifyEdge
+{
+	return lastNotifyEdge;
+}
+
 @end
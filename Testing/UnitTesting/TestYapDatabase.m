@@ -608,6 +608,373 @@
 	}];
 }
 
+- (void)testKeyRanges
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database);
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSUInteger i = 0; i < 25; i++)
+		{
+			NSString *key = [NSString stringWithFormat:@"user:%02lu", (unsigned long)i];
+			[transaction setObject:@"object" forKey:key inCollection:@"test"];
+		}
+		
+		[transaction setObject:@"object" forKey:@"user" inCollection:@"test"];
+		[transaction setObject:@"object" forKey:@"users" inCollection:@"test"];
+		[transaction setObject:@"object" forKey:@"admin:00" inCollection:@"test"];
+		
+		[transaction setObject:@"object" forKey:@"user:99" inCollection:@"other"];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		// Ranges
+		
+		NSArray *keys = [transaction keysInCollection:@"test" from:@"user:05" to:@"user:08" limit:0];
+		XCTAssertEqualObjects(keys, (@[ @"user:05", @"user:06", @"user:07" ]));
+		
+		keys = [transaction keysInCollection:@"test" from:nil to:@"user" limit:0];
+		XCTAssertEqualObjects(keys, (@[ @"admin:00" ]));
+		
+		keys = [transaction keysInCollection:@"test" from:@"user:23" to:nil limit:0];
+		XCTAssertEqualObjects(keys, (@[ @"user:23", @"user:24", @"users" ]));
+		
+		keys = [transaction keysInCollection:@"test" from:nil to:nil limit:2];
+		XCTAssertEqualObjects(keys, (@[ @"admin:00", @"user" ]));
+		
+		keys = [transaction keysInCollection:@"test" from:nil to:nil limit:0];
+		XCTAssertTrue([keys count] == 28);
+		
+		// Prefix
+		
+		__block NSMutableArray *enumerated = [NSMutableArray array];
+		[transaction enumerateKeysInCollection:@"test" withPrefix:@"user:" usingBlock:^(NSString *key, BOOL *stop) {
+			
+			[enumerated addObject:key];
+		}];
+		
+		XCTAssertTrue([enumerated count] == 25);
+		XCTAssertEqualObjects([enumerated firstObject], @"user:00");
+		XCTAssertEqualObjects([enumerated lastObject], @"user:24");
+		
+		enumerated = [NSMutableArray array];
+		[transaction enumerateKeysInCollection:@"test" withPrefix:@"user" reverse:YES usingBlock:^(NSString *key, BOOL *stop) {
+			
+			[enumerated addObject:key];
+			if ([enumerated count] == 3) *stop = YES;
+		}];
+		
+		XCTAssertEqualObjects(enumerated, (@[ @"users", @"user:24", @"user:23" ]));
+		
+		// Pagination (forward)
+		
+		NSMutableArray *pages = [NSMutableArray array];
+		NSString *cursor = nil;
+		do {
+			[pages addObject:[transaction keysInCollection:@"test" withPrefix:@"user:" limit:10 reverse:NO cursor:&cursor]];
+			
+		} while (cursor && [pages count] < 10);
+		
+		XCTAssertTrue([pages count] == 3);
+		XCTAssertTrue([pages[0] count] == 10);
+		XCTAssertTrue([pages[1] count] == 10);
+		XCTAssertTrue([pages[2] count] == 5);
+		XCTAssertEqualObjects(pages[1][0], @"user:10");
+		XCTAssertEqualObjects(pages[2][4], @"user:24");
+		
+		// Pagination (reverse)
+		
+		pages = [NSMutableArray array];
+		cursor = nil;
+		do {
+			[pages addObject:[transaction keysInCollection:@"test" from:@"user:00" to:@"user:20"
+			                                         limit:10 reverse:YES cursor:&cursor]];
+			
+		} while (cursor && [pages count] < 10);
+		
+		XCTAssertTrue([pages count] == 2);
+		XCTAssertEqualObjects(pages[0][0], @"user:19");
+		XCTAssertEqualObjects(pages[1][9], @"user:00");
+		
+		// An exactly full last page doesn't produce an empty extra page
+		
+		cursor = nil;
+		keys = [transaction keysInCollection:@"test" from:@"user:00" to:@"user:10" limit:10 reverse:NO cursor:&cursor];
+		XCTAssertTrue([keys count] == 10);
+		XCTAssertNil(cursor);
+	}];
+	
+	// The cursor remains valid across transactions (and changes)
+	
+	__block NSString *cursor = nil;
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSArray *keys = [transaction keysInCollection:@"test" withPrefix:@"user:" limit:5 reverse:NO cursor:&cursor];
+		XCTAssertEqualObjects([keys lastObject], @"user:04");
+	}];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeObjectForKey:@"user:05" inCollection:@"test"];
+		[transaction setObject:@"object" forKey:@"user:04a" inCollection:@"test"];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSArray *keys = [transaction keysInCollection:@"test" withPrefix:@"user:" limit:2 reverse:NO cursor:&cursor];
+		XCTAssertEqualObjects(keys, (@[ @"user:04a", @"user:06" ]));
+	}];
+}
+
+- (void)testCollectionStatistics
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database);
+	
+	YapDatabaseConnection *connection1 = [database newConnection];
+	YapDatabaseConnection *connection2 = [database newConnection];
+	
+	__block uint64_t bytes = 0;
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSUInteger i = 0; i < 10; i++)
+		{
+			NSString *key = [NSString stringWithFormat:@"%lu", (unsigned long)i];
+			[transaction setObject:@"object" forKey:key inCollection:@"test"];
+		}
+		
+		[transaction setObject:@"object" forKey:@"key" inCollection:nil withMetadata:@"metadata"];
+		
+		// Within the transaction
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 10);
+		XCTAssertTrue([transaction numberOfKeysInCollection:nil] == 1);
+		XCTAssertTrue([transaction numberOfKeysInAllCollections] == 11);
+		XCTAssertTrue([transaction numberOfCollections] == 2);
+		
+		// Overwriting a key doesn't change the count
+		
+		[transaction setObject:@"object" forKey:@"0" inCollection:@"test"];
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 10);
+		
+		bytes = [transaction statisticsForCollection:@"test"].numberOfBytes;
+		XCTAssertTrue(bytes > 0);
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 10);
+		XCTAssertTrue([transaction numberOfKeysInCollection:nil] == 1);
+		XCTAssertTrue([transaction numberOfKeysInAllCollections] == 11);
+		XCTAssertTrue([transaction numberOfCollections] == 2);
+		
+		NSDictionary *stats = [transaction collectionStatistics];
+		XCTAssertTrue([stats count] == 2);
+		XCTAssertTrue([stats[@"test"] numberOfBytes] == bytes);
+		XCTAssertTrue([stats[@""] numberOfKeys] == 1);
+		
+		XCTAssertNil([transaction statisticsForCollection:@"nonexistent"]);
+	}];
+	
+	// Changes in size
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction replaceObject:@"a much larger object than before" forKey:@"1" inCollection:@"test"];
+		[transaction replaceMetadata:nil forKey:@"key" inCollection:nil];
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 10);
+		XCTAssertTrue([transaction statisticsForCollection:@"test"].numberOfBytes > bytes);
+		
+		bytes = [transaction statisticsForCollection:@"test"].numberOfBytes;
+	}];
+	
+	// Removal
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeObjectForKey:@"1" inCollection:@"test"];
+		[transaction removeObjectForKey:@"nonexistent" inCollection:@"test"];
+		[transaction removeObjectsForKeys:@[ @"2", @"3", @"nonexistent" ] inCollection:@"test"];
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 7);
+		XCTAssertTrue([transaction statisticsForCollection:@"test"].numberOfBytes < bytes);
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 7);
+	}];
+	
+	// Rollback
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeAllObjectsInCollection:@"test"];
+		[transaction setObject:@"object" forKey:@"key" inCollection:@"another"];
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 0);
+		XCTAssertNil([transaction statisticsForCollection:@"test"]);
+		XCTAssertTrue([transaction numberOfCollections] == 2);
+		
+		[transaction rollback];
+	}];
+	
+	[connection1 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 7);
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"another"] == 0);
+		XCTAssertTrue([transaction numberOfCollections] == 2);
+	}];
+	
+	// Remove all in collection
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeAllObjectsInCollection:@"test"];
+		[transaction setObject:@"object" forKey:@"0" inCollection:@"test"];
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 1);
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 1);
+		XCTAssertTrue([transaction numberOfKeysInAllCollections] == 2);
+	}];
+	
+	// Remove all in all collections
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeAllObjectsInAllCollections];
+		
+		XCTAssertTrue([transaction numberOfKeysInAllCollections] == 0);
+		XCTAssertTrue([transaction numberOfCollections] == 0);
+		
+		[transaction setObject:@"object" forKey:@"key" inCollection:@"another"];
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 0);
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"another"] == 1);
+		XCTAssertTrue([transaction numberOfKeysInAllCollections] == 1);
+		XCTAssertEqualObjects([[transaction collectionStatistics] allKeys], @[ @"another" ]);
+	}];
+	
+	// The counters are persisted
+	
+	connection1 = nil;
+	connection2 = nil;
+	database = nil;
+	
+	database = [[YapDatabase alloc] initWithURL:databaseURL];
+	connection1 = [database newConnection];
+	
+	[connection1 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"another"] == 1);
+		XCTAssertTrue([transaction numberOfKeysInAllCollections] == 1);
+	}];
+}
+
+- (void)testCollectionStatistics_modifiedByOlderVersion
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database);
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSUInteger i = 0; i < 3; i++)
+		{
+			NSString *key = [NSString stringWithFormat:@"%lu", (unsigned long)i];
+			[transaction setObject:@"object" forKey:key inCollection:@"test"];
+		}
+	}];
+	
+	connection = nil;
+	database = nil;
+	
+	// Modify the database the way an older version of YapDatabase would:
+	// It changes the rows & increments the snapshot, but doesn't know about the collection_stats table.
+	
+	sqlite3 *db = NULL;
+	int status = sqlite3_open_v2([[databaseURL path] UTF8String], &db, SQLITE_OPEN_READWRITE, NULL);
+	XCTAssertTrue(status == SQLITE_OK);
+	
+	char *stmt =
+	    "BEGIN TRANSACTION;"
+	    " DELETE FROM \"database2\" WHERE \"collection\" = 'test' AND \"key\" = '0';"
+	    " INSERT INTO \"database2\" (\"collection\", \"key\", \"data\") VALUES ('test', 'a', x'0102');"
+	    " INSERT INTO \"database2\" (\"collection\", \"key\", \"data\") VALUES ('test', 'b', x'0102');"
+	    " INSERT INTO \"database2\" (\"collection\", \"key\", \"data\") VALUES ('older', 'a', x'0102');"
+	    " UPDATE \"yap2\" SET \"data\" = \"data\" + 1 WHERE \"extension\" = '' AND \"key\" = 'snapshot';"
+	    " COMMIT TRANSACTION;";
+	
+	status = sqlite3_exec(db, stmt, NULL, NULL, NULL);
+	XCTAssertTrue(status == SQLITE_OK, @"%s", sqlite3_errmsg(db));
+	
+	sqlite3_close(db);
+	
+	// The counters are rebuilt when the database is opened again
+	
+	database = [[YapDatabase alloc] initWithURL:databaseURL];
+	connection = [database newConnection];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"test"] == 4);
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"older"] == 1);
+		XCTAssertTrue([transaction numberOfKeysInAllCollections] == 5);
+		XCTAssertTrue([transaction numberOfCollections] == 2);
+		
+		XCTAssertTrue([transaction statisticsForCollection:@"older"].numberOfBytes == 2);
+	}];
+	
+	// And kept up-to-date from then on
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeObjectForKey:@"a" inCollection:@"older"];
+	}];
+	
+	connection = nil;
+	database = nil;
+	
+	database = [[YapDatabase alloc] initWithURL:databaseURL];
+	connection = [database newConnection];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue([transaction numberOfKeysInCollection:@"older"] == 0);
+		XCTAssertTrue([transaction numberOfCollections] == 1);
+	}];
+}
+
 - (void)testPropertyListSerializerDeserializer
 {
 	YapDatabaseSerializer propertyListSerializer = [YapDatabase propertyListSerializer];
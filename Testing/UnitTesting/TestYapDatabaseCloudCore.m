@@ -0,0 +1,1437 @@
+#import <XCTest/XCTest.h>
+
+#import <YapDatabase/YapDatabase.h>
+#import <YapDatabase/YapDatabaseCloudCore.h>
+#import <YapDatabase/YapDatabaseCloudCorePrivate.h>
+#import <YapDatabase/YapDatabasePrivate.h>
+
+/**
+ * How long to wait for the pipeline to start an operation that should be started.
+ * And how long to wait before concluding that an operation (correctly) wasn't started.
+**/
+static NSTimeInterval const kStartTimeout   = 5.0;
+static NSTimeInterval const kNoStartTimeout = 0.25;
+
+/**
+ * Pipeline delegate that simply records the operations that the pipeline starts (in order).
+**/
+@interface TestCloudCorePipelineDelegate : NSObject <YapDatabaseCloudCorePipelineDelegate>
+
+/**
+ * Waits (up to the given timeout) for the pipeline to start the next operation.
+ * Returns the uuid of the started operation, or nil if no operation was started in time.
+**/
+- (NSUUID *)waitForStartedOperation:(NSTimeInterval)timeout;
+
+@end
+
+@implementation TestCloudCorePipelineDelegate
+{
+	dispatch_semaphore_t semaphore;
+	NSMutableArray<NSUUID *> *startedOpUUIDs;
+}
+
+- (instancetype)init
+{
+	if ((self = [super init]))
+	{
+		semaphore = dispatch_semaphore_create(0);
+		startedOpUUIDs = [[NSMutableArray alloc] init];
+	}
+	return self;
+}
+
+- (void)startOperation:(YapDatabaseCloudCoreOperation *)operation forPipeline:(YapDatabaseCloudCorePipeline *)pipeline
+{
+	@synchronized (self) {
+		[startedOpUUIDs addObject:operation.uuid];
+	}
+	dispatch_semaphore_signal(semaphore);
+}
+
+- (NSUUID *)waitForStartedOperation:(NSTimeInterval)timeout
+{
+	dispatch_time_t deadline = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC));
+	
+	if (dispatch_semaphore_wait(semaphore, deadline) != 0) {
+		return nil;
+	}
+	
+	@synchronized (self) {
+		
+		NSUUID *opUUID = [startedOpUUIDs firstObject];
+		[startedOpUUIDs removeObjectAtIndex:0];
+		
+		return opUUID;
+	}
+}
+
+@end
+
+/**
+ * Operation subclass with a few persistent properties of its own.
+**/
+@interface TestCloudCoreOperation : YapDatabaseCloudCoreOperation
+
+@property (nonatomic, copy, readwrite) NSString *name;
+@property (nonatomic, assign, readwrite) NSInteger attempt;
+
+@end
+
+@implementation TestCloudCoreOperation
+
+@synthesize name = name;
+@synthesize attempt = attempt;
+
+- (instancetype)initWithCoder:(NSCoder *)decoder
+{
+	if ((self = [super initWithCoder:decoder]))
+	{
+		name = [decoder decodeObjectForKey:@"name"];
+		attempt = [decoder decodeIntegerForKey:@"attempt"];
+	}
+	return self;
+}
+
+- (void)encodeWithCoder:(NSCoder *)coder
+{
+	[super encodeWithCoder:coder];
+	
+	[coder encodeObject:name forKey:@"name"];
+	[coder encodeInteger:attempt forKey:@"attempt"];
+}
+
+- (instancetype)copyWithZone:(NSZone *)zone
+{
+	TestCloudCoreOperation *copy = [super copyWithZone:zone];
+	copy->name = name;
+	copy->attempt = attempt;
+	
+	return copy;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface TestYapDatabaseCloudCore : XCTestCase
+@end
+
+@implementation TestYapDatabaseCloudCore
+
+- (NSString *)fileName
+{
+	NSString *filePath = [NSString stringWithFormat:@"%s", __FILE__];
+	NSString *fileName = [filePath lastPathComponent];
+	
+	NSUInteger dotLocation = [fileName rangeOfString:@"." options:NSBackwardsSearch].location;
+	if (dotLocation != NSNotFound) {
+		 fileName = [fileName substringToIndex:dotLocation];
+	}
+	
+	return fileName;
+}
+
+- (NSURL *)databaseURL:(NSString *)suffix
+{
+	NSString *databaseName = [NSString stringWithFormat:@"%@-%@.sqlite", [self fileName], suffix];
+	
+	NSArray<NSURL*> *urls = [[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask];
+	NSURL *baseDir = [urls firstObject];
+	
+	return [baseDir URLByAppendingPathComponent:databaseName isDirectory:NO];
+}
+
+- (void)setUp
+{
+	[super setUp];
+}
+
+- (void)tearDown
+{
+	[super tearDown];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Utilities
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Creates a CloudCore instance with a single (default) pipeline.
+**/
+- (YapDatabaseCloudCore *)cloudCoreWithAlgorithm:(YDBCloudCorePipelineAlgorithm)algorithm
+                                        delegate:(TestCloudCorePipelineDelegate *)delegate
+                     maxConcurrentOperationCount:(NSUInteger)maxConcurrentOperationCount
+                                         options:(YapDatabaseCloudCoreOptions *)options
+{
+	YapDatabaseCloudCore *cloudCore = [[YapDatabaseCloudCore alloc] initWithVersionTag:@"1" options:options];
+	
+	YapDatabaseCloudCorePipeline *pipeline =
+	  [[YapDatabaseCloudCorePipeline alloc] initWithName:YapDatabaseCloudCoreDefaultPipelineName
+	                                           algorithm:algorithm
+	                                            delegate:delegate];
+	
+	pipeline.maxConcurrentOperationCount = maxConcurrentOperationCount;
+	
+	[cloudCore registerPipeline:pipeline];
+	return cloudCore;
+}
+
+- (YapDatabaseCloudCoreOperation *)operationWithPriority:(int32_t)priority
+{
+	YapDatabaseCloudCoreOperation *operation = [[YapDatabaseCloudCoreOperation alloc] init];
+	operation.priority = priority;
+	
+	return operation;
+}
+
+- (void)addOperations:(NSArray<YapDatabaseCloudCoreOperation *> *)operations
+           connection:(YapDatabaseConnection *)connection
+{
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (YapDatabaseCloudCoreOperation *operation in operations)
+		{
+			XCTAssertTrue([[transaction ext:@"cloud"] addOperation:operation]);
+		}
+	}];
+}
+
+- (void)completeOperationWithUUID:(NSUUID *)opUUID connection:(YapDatabaseConnection *)connection
+{
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"cloud"] completeOperationWithUUID:opUUID];
+	}];
+}
+
+- (void)skipOperationWithUUID:(NSUUID *)opUUID connection:(YapDatabaseConnection *)connection
+{
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"cloud"] skipOperationWithUUID:opUUID];
+	}];
+}
+
+/**
+ * Waits for the given number of operations to be started, and returns their uuids.
+**/
+- (NSSet<NSUUID *> *)waitForStartedOperations:(NSUInteger)count delegate:(TestCloudCorePipelineDelegate *)delegate
+{
+	NSMutableSet<NSUUID *> *startedOpUUIDs = [NSMutableSet setWithCapacity:count];
+	
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		NSUUID *opUUID = [delegate waitForStartedOperation:kStartTimeout];
+		if (opUUID == nil) break;
+		
+		[startedOpUUIDs addObject:opUUID];
+	}
+	
+	return startedOpUUIDs;
+}
+
+/**
+ * Re-opens the database (once the previous instance has been deallocated).
+**/
+- (YapDatabase *)reopenDatabaseWithURL:(NSURL *)databaseURL
+{
+	YapDatabase *database = nil;
+	
+	for (int i = 0; i < 100 && database == nil; i++)
+	{
+		// Wait for the previous database instance to be deallocated
+		if (i > 0) [NSThread sleepForTimeInterval:0.05];
+		
+		database = [[YapDatabase alloc] initWithURL:databaseURL];
+	}
+	
+	return database;
+}
+
+/**
+ * Creates a database containing the given number of graphs (1 commit per graph) in the default pipeline.
+ * The pipeline is suspended, so all the operations are still queued when the database is re-opened.
+ *
+ * Returns the operation uuids for each graph.
+**/
+- (NSArray<NSSet<NSUUID *> *> *)createDatabaseWithURL:(NSURL *)databaseURL
+                                            algorithm:(YDBCloudCorePipelineAlgorithm)algorithm
+                                           graphCount:(NSUInteger)graphCount
+                                   operationsPerGraph:(NSUInteger)operationsPerGraph
+{
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	NSMutableArray<NSSet<NSUUID *> *> *graphs = [NSMutableArray arrayWithCapacity:graphCount];
+	
+	@autoreleasepool {
+		
+		YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+		XCTAssertNotNil(database, @"Oops");
+		
+		YapDatabaseConnection *connection = [database newConnection];
+		
+		TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+		YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:algorithm
+		                                                      delegate:delegate
+		                                   maxConcurrentOperationCount:8
+		                                                       options:nil];
+		[cloudCore suspend];
+		
+		BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+		XCTAssertTrue(registered, @"Error registering extension");
+		
+		for (NSUInteger g = 0; g < graphCount; g++)
+		{
+			NSMutableArray<YapDatabaseCloudCoreOperation *> *operations =
+			  [NSMutableArray arrayWithCapacity:operationsPerGraph];
+			
+			for (NSUInteger i = 0; i < operationsPerGraph; i++)
+			{
+				[operations addObject:[self operationWithPriority:0]];
+			}
+			
+			[self addOperations:operations connection:connection];
+			[graphs addObject:[NSSet setWithArray:[operations valueForKey:@"uuid"]]];
+		}
+		
+		XCTAssertTrue([[cloudCore defaultPipeline] graphCount] == graphCount);
+	}
+	
+	return graphs;
+}
+
+/**
+ * Returns the operation uuids for each graph in the pipeline.
+ * A graph that's pending restore has no operations.
+**/
+- (NSArray<NSSet<NSUUID *> *> *)graphsForPipeline:(YapDatabaseCloudCorePipeline *)pipeline
+{
+	NSMutableArray<NSSet<NSUUID *> *> *graphs = [NSMutableArray array];
+	
+	for (NSArray<YapDatabaseCloudCoreOperation *> *operations in [pipeline graphOperations])
+	{
+		[graphs addObject:[NSSet setWithArray:[operations valueForKey:@"uuid"]]];
+	}
+	
+	return graphs;
+}
+
+/**
+ * Deferred graphs are restored asynchronously.
+ * So this method polls the pipeline until its graphs match (or the timeout expires).
+**/
+- (NSArray<NSSet<NSUUID *> *> *)waitForPipeline:(YapDatabaseCloudCorePipeline *)pipeline
+                                         graphs:(NSArray<NSSet<NSUUID *> *> *)expectedGraphs
+{
+	NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:kStartTimeout];
+	
+	NSArray<NSSet<NSUUID *> *> *graphs = [self graphsForPipeline:pipeline];
+	
+	while (![graphs isEqualToArray:expectedGraphs] && ([deadline timeIntervalSinceNow] > 0))
+	{
+		[NSThread sleepForTimeInterval:0.01];
+		graphs = [self graphsForPipeline:pipeline];
+	}
+	
+	return graphs;
+}
+
+/**
+ * Returns the number of rows in the (sqlite) queue table.
+**/
+- (NSUInteger)queueRowCountForCloudCore:(YapDatabaseCloudCore *)cloudCore connection:(YapDatabaseConnection *)connection
+{
+	__block NSUInteger count = 0;
+	
+	NSString *query = [NSString stringWithFormat:@"SELECT COUNT(*) FROM \"%@\";", [cloudCore queueTableName]];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		sqlite3 *db = connection->db;
+		sqlite3_stmt *statement = NULL;
+		
+		int status = sqlite3_prepare_v2(db, [query UTF8String], -1, &statement, NULL);
+		XCTAssertTrue(status == SQLITE_OK, @"Error creating statement: %s", sqlite3_errmsg(db));
+		
+		if (status == SQLITE_OK)
+		{
+			if (sqlite3_step(statement) == SQLITE_ROW) {
+				count = (NSUInteger)sqlite3_column_int64(statement, 0);
+			}
+			sqlite3_finalize(statement);
+		}
+	}];
+	
+	return count;
+}
+
+/**
+ * Returns the uuids of all the operations in the pipeline (regardless of graph).
+**/
+- (NSSet<NSUUID *> *)operationUUIDsForPipeline:(YapDatabaseCloudCorePipeline *)pipeline
+{
+	NSMutableSet<NSUUID *> *opUUIDs = [NSMutableSet set];
+	
+	for (NSSet<NSUUID *> *graph in [self graphsForPipeline:pipeline])
+	{
+		[opUUIDs unionSet:graph];
+	}
+	
+	return opUUIDs;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Ready Queue
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)testReadyQueue_priorityOrder
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	// Only 1 operation at a time, so the start order is the dequeue order
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:1
+	                                                       options:nil];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	YapDatabaseCloudCoreOperation *op1  = [self operationWithPriority:1];
+	YapDatabaseCloudCoreOperation *op5a = [self operationWithPriority:5];
+	YapDatabaseCloudCoreOperation *op3  = [self operationWithPriority:3];
+	YapDatabaseCloudCoreOperation *op5b = [self operationWithPriority:5];
+	YapDatabaseCloudCoreOperation *opDependent = [self operationWithPriority:10];
+	
+	// The highest priority operation can't start until its dependency (the lowest priority operation) completes
+	[opDependent addDependency:op1];
+	
+	[cloudCore suspend];
+	[self addOperations:@[ op1, op5a, op3, op5b, opDependent ] connection:connection];
+	[cloudCore resume];
+	
+	// Highest priority first. Equal priorities are started in the order they were added.
+	
+	NSArray<YapDatabaseCloudCoreOperation *> *expectedOrder = @[ op5a, op5b, op3, op1, opDependent ];
+	
+	for (YapDatabaseCloudCoreOperation *expectedOp in expectedOrder)
+	{
+		NSUUID *startedOpUUID = [delegate waitForStartedOperation:kStartTimeout];
+		XCTAssertEqualObjects(startedOpUUID, expectedOp.uuid);
+		
+		[self completeOperationWithUUID:startedOpUUID connection:connection];
+	}
+	
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+	XCTAssertTrue([[cloudCore defaultPipeline] graphCount] == 0);
+}
+
+- (void)testReadyQueue_dependentsReleased
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:nil];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// opB depends on opA.
+	// opC depends on both opA & opB.
+	
+	YapDatabaseCloudCoreOperation *opA = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opB = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opC = [self operationWithPriority:0];
+	
+	[opB addDependency:opA];
+	[opC addDependencies:@[ opA, opB ]];
+	
+	[self addOperations:@[ opC, opB, opA ] connection:connection];
+	
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opA.uuid);
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+	
+	// Completing opA releases opB (but not opC)
+	
+	[self completeOperationWithUUID:opA.uuid connection:connection];
+	
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opB.uuid);
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+	
+	// Skipping opB releases opC
+	
+	[self skipOperationWithUUID:opB.uuid connection:connection];
+	
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opC.uuid);
+	
+	[self completeOperationWithUUID:opC.uuid connection:connection];
+	
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+	XCTAssertTrue([[cloudCore defaultPipeline] graphCount] == 0);
+}
+
+- (void)testReadyQueue_flatGraphCrossGraphDependencies
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_FlatGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:nil];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// Graph #1: opA
+	// Graph #2: opB (depends on opA), opC (independent), opD (depends on opB)
+	
+	YapDatabaseCloudCoreOperation *opA = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opB = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opC = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opD = [self operationWithPriority:0];
+	
+	[opB addDependency:opA];
+	[opD addDependency:opB];
+	
+	[self addOperations:@[ opA ] connection:connection];
+	
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opA.uuid);
+	
+	[self addOperations:@[ opB, opC, opD ] connection:connection];
+	
+	XCTAssertTrue([[cloudCore defaultPipeline] graphCount] == 2);
+	
+	// FlatGraph: opC can start while graph #1 is still in progress.
+	// But opB must wait for opA (in the earlier graph).
+	
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opC.uuid);
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+	
+	[self completeOperationWithUUID:opA.uuid connection:connection];
+	
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opB.uuid);
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+	
+	[self skipOperationWithUUID:opB.uuid connection:connection];
+	
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opD.uuid);
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"cloud"] completeOperationsWithUUIDs:@[ opC.uuid, opD.uuid ]];
+	}];
+	
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+	XCTAssertTrue([[cloudCore defaultPipeline] graphCount] == 0);
+}
+
+- (void)testReadyQueue_flatGraphRestore
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_FlatGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:nil];
+	[cloudCore suspend];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	YapDatabaseCloudCoreOperation *opA = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opB = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opC = [self operationWithPriority:0];
+	
+	[opB addDependency:opA];
+	
+	[self addOperations:@[ opA ] connection:connection];
+	[self addOperations:@[ opB, opC ] connection:connection];
+	
+	// Re-open the database.
+	// The ready queue of the restored graphs must also respect dependencies into earlier graphs.
+	
+	connection = nil;
+	cloudCore = nil;
+	database = nil;
+	
+	database = [self reopenDatabaseWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	connection = [database newConnection];
+	
+	delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_FlatGraph
+	                                delegate:delegate
+	             maxConcurrentOperationCount:8
+	                                 options:nil];
+	
+	registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	NSSet<NSUUID *> *startedOpUUIDs = [self waitForStartedOperations:2 delegate:delegate];
+	XCTAssertEqualObjects(startedOpUUIDs, ([NSSet setWithObjects:opA.uuid, opC.uuid, nil]));
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+	
+	[self completeOperationWithUUID:opA.uuid connection:connection];
+	
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opB.uuid);
+}
+
+- (void)testReadyQueue_circularDependency
+{
+	YapDatabaseCloudCoreOperation *opA = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opB = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opC = [self operationWithPriority:0];
+	
+	[opB addDependency:opA];
+	[opC addDependencies:@[ opA, opB ]];
+	
+	XCTAssertNoThrow([[YapDatabaseCloudCoreGraph alloc] initWithSnapshot:0 operations:@[ opA, opB, opC ]]);
+	
+	// opA -> opC -> opB -> opA
+	
+	[opA addDependency:opC];
+	
+	XCTAssertThrowsSpecificNamed([[YapDatabaseCloudCoreGraph alloc] initWithSnapshot:0 operations:@[ opA, opB, opC ]],
+	                             NSException, @"YapDatabaseCloudCore");
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Hold
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)testHold_fireOrder
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:nil];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	YapDatabaseCloudCorePipeline *pipeline = [cloudCore defaultPipeline];
+	
+	YapDatabaseCloudCoreOperation *opA = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opB = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opC = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opD = [self operationWithPriority:0];
+	
+	// The holds are set in a different order than they expire.
+	// And opD has 2 holds (in different contexts), so the later one is the one that matters.
+	
+	[pipeline setHoldDate:[NSDate dateWithTimeIntervalSinceNow:0.9] forOperationWithUUID:opA.uuid context:@"test"];
+	[pipeline setHoldDate:[NSDate dateWithTimeIntervalSinceNow:0.3] forOperationWithUUID:opB.uuid context:@"test"];
+	[pipeline setHoldDate:[NSDate dateWithTimeIntervalSinceNow:0.6] forOperationWithUUID:opC.uuid context:@"test"];
+	[pipeline setHoldDate:[NSDate dateWithTimeIntervalSinceNow:0.3] forOperationWithUUID:opD.uuid context:@"test"];
+	[pipeline setHoldDate:[NSDate dateWithTimeIntervalSinceNow:1.2] forOperationWithUUID:opD.uuid context:@"other"];
+	
+	[self addOperations:@[ opA, opB, opC, opD ] connection:connection];
+	
+	XCTAssertNil([delegate waitForStartedOperation:0.15]);
+	
+	NSArray<YapDatabaseCloudCoreOperation *> *expectedOrder = @[ opB, opC, opA, opD ];
+	
+	for (YapDatabaseCloudCoreOperation *expectedOp in expectedOrder)
+	{
+		XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], expectedOp.uuid);
+	}
+	
+	// Expired holds are removed
+	
+	XCTAssertNil([pipeline holdDatesForContext:@"test"]);
+	XCTAssertNil([pipeline holdDatesForContext:@"other"]);
+}
+
+- (void)testHold_staleEntries
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:nil];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	YapDatabaseCloudCorePipeline *pipeline = [cloudCore defaultPipeline];
+	
+	YapDatabaseCloudCoreOperation *opA = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opB = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *opC = [self operationWithPriority:0];
+	
+	// opA: hold is extended. The original (earlier) heap entry is stale, and must not release the operation.
+	// opB: hold is shortened. The original (later) heap entry is stale, and must not delay the operation.
+	// opC: hold is cleared. The original heap entry is stale, and the operation can start immediately.
+	
+	NSDate *extendedDate = [NSDate dateWithTimeIntervalSinceNow:60.0];
+	
+	[pipeline setHoldDate:[NSDate dateWithTimeIntervalSinceNow:0.3] forOperationWithUUID:opA.uuid context:@"test"];
+	[pipeline setHoldDate:extendedDate forOperationWithUUID:opA.uuid context:@"test"];
+	
+	[pipeline setHoldDate:[NSDate dateWithTimeIntervalSinceNow:60.0] forOperationWithUUID:opB.uuid context:@"test"];
+	[pipeline setHoldDate:[NSDate dateWithTimeIntervalSinceNow:0.6] forOperationWithUUID:opB.uuid context:@"test"];
+	
+	[pipeline setHoldDate:[NSDate dateWithTimeIntervalSinceNow:0.3] forOperationWithUUID:opC.uuid context:@"test"];
+	[pipeline setHoldDate:nil forOperationWithUUID:opC.uuid context:@"test"];
+	
+	[self addOperations:@[ opA, opB, opC ] connection:connection];
+	
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opC.uuid);
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opB.uuid);
+	
+	// By now, the stale entry for opA (0.3 seconds) has long passed
+	
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+	
+	XCTAssertEqualObjects([pipeline holdDateForOperationWithUUID:opA.uuid context:@"test"], extendedDate);
+	XCTAssertEqualObjects([pipeline holdDatesForContext:@"test"], @{ opA.uuid: extendedDate });
+	
+	// Clearing the remaining hold releases opA
+	
+	[pipeline setHoldDate:nil forOperationWithUUID:opA.uuid context:@"test"];
+	
+	XCTAssertEqualObjects([delegate waitForStartedOperation:kStartTimeout], opA.uuid);
+	XCTAssertNil([pipeline holdDatesForContext:@"test"]);
+}
+
+/**
+ * The hold heap is private, so we peek at it (and its entries) via KVC.
+ * This is only safe because none of the holds in this test expire during the test.
+**/
+- (void)testHold_heapCompaction
+{
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCorePipeline *pipeline =
+	  [[YapDatabaseCloudCorePipeline alloc] initWithName:@"test" delegate:delegate];
+	
+	NSUInteger holdCount = 20;
+	
+	NSMutableArray<NSUUID *> *opUUIDs = [NSMutableArray arrayWithCapacity:holdCount];
+	for (NSUInteger i = 0; i < holdCount; i++)
+	{
+		[opUUIDs addObject:[NSUUID UUID]];
+	}
+	
+	// Repeatedly move each hold to an earlier date.
+	// The replaced (later) heap entries are stale, but they're never at the top of the heap.
+	// So they're only discarded when the heap is compacted.
+	
+	NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+	
+	for (NSUInteger i = 0; i < 1000; i++)
+	{
+		NSDate *date = [NSDate dateWithTimeIntervalSinceReferenceDate:(now + 100000 - i)];
+		[pipeline setHoldDate:date forOperationWithUUID:opUUIDs[(i * 7) % holdCount] context:@"test"];
+	}
+	
+	NSDictionary<NSUUID *, NSDate *> *holds = [pipeline holdDatesForContext:@"test"]; // sync: flushes the setHoldDate calls
+	XCTAssertTrue(holds.count == holdCount);
+	
+	NSArray *holdHeap = [[pipeline valueForKey:@"holdHeap"] copy];
+	
+	XCTAssertTrue(holdHeap.count >= holdCount);
+	XCTAssertTrue(holdHeap.count <= ((holdCount * 2) + 32 + 1), @"holdHeap.count = %lu", (unsigned long)holdHeap.count);
+	
+	// Heap property
+	
+	for (NSUInteger i = 1; i < holdHeap.count; i++)
+	{
+		double fireTime = [[holdHeap[i] valueForKey:@"fireTime"] doubleValue];
+		double parentFireTime = [[holdHeap[(i - 1) / 2] valueForKey:@"fireTime"] doubleValue];
+		
+		XCTAssertTrue(parentFireTime <= fireTime, @"Heap property violated at index %lu", (unsigned long)i);
+	}
+	
+	// Every valid hold survived the compaction
+	
+	NSMutableSet<NSUUID *> *validOpUUIDs = [NSMutableSet setWithCapacity:holdCount];
+	
+	for (id entry in holdHeap)
+	{
+		NSUUID *opUUID = [entry valueForKey:@"opUUID"];
+		NSDate *date = [entry valueForKey:@"date"];
+		
+		if ([holds[opUUID] isEqualToDate:date])
+		{
+			XCTAssertFalse([validOpUUIDs containsObject:opUUID]);
+			[validOpUUIDs addObject:opUUID];
+		}
+	}
+	
+	XCTAssertEqualObjects(validOpUUIDs, [NSSet setWithArray:opUUIDs]);
+	
+	// Clearing every hold leaves only stale entries, which are all discarded
+	
+	for (NSUUID *opUUID in opUUIDs)
+	{
+		[pipeline setHoldDate:nil forOperationWithUUID:opUUID context:@"test"];
+	}
+	
+	XCTAssertNil([pipeline holdDatesForContext:@"test"]);
+	XCTAssertTrue([[pipeline valueForKey:@"holdHeap"] count] == 0);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Deferred Restore
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)testDeferredRestore_placeholders
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	NSArray<NSSet<NSUUID *> *> *graphs = [self createDatabaseWithURL:databaseURL
+	                                                        algorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                       graphCount:5
+	                                               operationsPerGraph:2];
+	
+	YapDatabase *database = [self reopenDatabaseWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseCloudCoreOptions *options = [[YapDatabaseCloudCoreOptions alloc] init];
+	options.restoreGraphLimit = 2;
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:options];
+	[cloudCore suspend];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	YapDatabaseCloudCorePipeline *pipeline = [cloudCore defaultPipeline];
+	
+	// Only the first 2 graphs are restored. The others are (empty) placeholders.
+	
+	NSArray<NSSet<NSUUID *> *> *expectedGraphs = @[ graphs[0], graphs[1], [NSSet set], [NSSet set], [NSSet set] ];
+	
+	XCTAssertTrue([pipeline graphCount] == 5);
+	XCTAssertEqualObjects([self graphsForPipeline:pipeline], expectedGraphs);
+	
+	NSUUID *restoredOpUUID = [graphs[1] anyObject];
+	NSUUID *deferredOpUUID = [graphs[3] anyObject];
+	
+	XCTAssertNotNil([pipeline operationWithUUID:restoredOpUUID]);
+	XCTAssertNil([pipeline operationWithUUID:deferredOpUUID]);
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertNotNil([[transaction ext:@"cloud"] operationWithUUID:restoredOpUUID]);
+		XCTAssertNil([[transaction ext:@"cloud"] operationWithUUID:deferredOpUUID]);
+	}];
+	
+	// The placeholders aren't restored while the restored graphs are still queued
+	
+	[NSThread sleepForTimeInterval:kNoStartTimeout];
+	XCTAssertEqualObjects([self graphsForPipeline:pipeline], expectedGraphs);
+}
+
+- (void)testDeferredRestore_afterEarlierGraphsComplete
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	NSArray<NSSet<NSUUID *> *> *graphs = [self createDatabaseWithURL:databaseURL
+	                                                        algorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                       graphCount:4
+	                                               operationsPerGraph:2];
+	
+	YapDatabase *database = [self reopenDatabaseWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseCloudCoreOptions *options = [[YapDatabaseCloudCoreOptions alloc] init];
+	options.restoreGraphLimit = 1;
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:options];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	YapDatabaseCloudCorePipeline *pipeline = [cloudCore defaultPipeline];
+	
+	// Each time the graph at the front of the queue completes, the next graph is a placeholder.
+	// Its operations arrive (asynchronously) in a batch, and must then be started.
+	
+	for (NSUInteger g = 0; g < graphs.count; g++)
+	{
+		NSMutableArray<NSSet<NSUUID *> *> *expectedGraphs = [NSMutableArray arrayWithObject:graphs[g]];
+		for (NSUInteger i = g + 1; i < graphs.count; i++)
+		{
+			[expectedGraphs addObject:[NSSet set]];
+		}
+		
+		XCTAssertEqualObjects([self waitForPipeline:pipeline graphs:expectedGraphs], expectedGraphs);
+		
+		XCTAssertEqualObjects([self waitForStartedOperations:2 delegate:delegate], graphs[g]);
+		XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+		
+		[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			[[transaction ext:@"cloud"] completeOperationsWithUUIDs:[graphs[g] allObjects]];
+		}];
+	}
+	
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+	XCTAssertTrue([pipeline graphCount] == 0);
+}
+
+- (void)testDeferredRestore_flatGraphRestoresEagerly
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	NSArray<NSSet<NSUUID *> *> *graphs = [self createDatabaseWithURL:databaseURL
+	                                                        algorithm:YDBCloudCorePipelineAlgorithm_FlatGraph
+	                                                       graphCount:4
+	                                               operationsPerGraph:2];
+	
+	YapDatabase *database = [self reopenDatabaseWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseCloudCoreOptions *options = [[YapDatabaseCloudCoreOptions alloc] init];
+	options.restoreGraphLimit = 1;
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_FlatGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:options];
+	[cloudCore suspend];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// The restoreGraphLimit doesn't apply to FlatGraph pipelines
+	
+	XCTAssertEqualObjects([self graphsForPipeline:[cloudCore defaultPipeline]], graphs);
+}
+
+- (void)testDeferredRestore_algorithmChange
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	NSArray<NSSet<NSUUID *> *> *graphs = [self createDatabaseWithURL:databaseURL
+	                                                        algorithm:YDBCloudCorePipelineAlgorithm_FlatGraph
+	                                                       graphCount:4
+	                                               operationsPerGraph:2];
+	
+	YapDatabase *database = [self reopenDatabaseWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseCloudCoreOptions *options = [[YapDatabaseCloudCoreOptions alloc] init];
+	options.restoreGraphLimit = 1;
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:options];
+	[cloudCore suspend];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// The pipeline changed from FlatGraph to CommitGraph, so every graph is restored during registration
+	
+	YapDatabaseCloudCorePipeline *pipeline = [cloudCore defaultPipeline];
+	
+	XCTAssertEqualObjects([self graphsForPipeline:pipeline], graphs);
+	
+	// And the pipeline now uses the CommitGraph algorithm
+	
+	[cloudCore resume];
+	
+	XCTAssertEqualObjects([self waitForStartedOperations:2 delegate:delegate], graphs[0]);
+	XCTAssertNil([delegate waitForStartedOperation:kNoStartTimeout]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Serialization
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)testSerialization_binaryRoundTrip
+{
+	NSData *magic = [@"YDCO" dataUsingEncoding:NSUTF8StringEncoding];
+	
+	// Base class, no extras
+	
+	YapDatabaseCloudCoreOperation *op1 = [self operationWithPriority:-7];
+	[op1 addDependency:[NSUUID UUID]];
+	[op1 addDependency:[NSUUID UUID]];
+	
+	NSData *data1 = [op1 serializedData];
+	XCTAssertEqualObjects([data1 subdataWithRange:NSMakeRange(0, magic.length)], magic);
+	
+	YapDatabaseCloudCoreOperation *decoded1 = [YapDatabaseCloudCoreOperation operationWithSerializedData:data1];
+	
+	XCTAssertTrue([decoded1 class] == [YapDatabaseCloudCoreOperation class]);
+	XCTAssertEqualObjects(decoded1.uuid, op1.uuid);
+	XCTAssertTrue(decoded1.priority == -7);
+	XCTAssertEqualObjects(decoded1.dependencies, op1.dependencies);
+	XCTAssertNil(decoded1.persistentUserInfo);
+	
+	// Base class, with persistentUserInfo (and no dependencies)
+	
+	YapDatabaseCloudCoreOperation *op2 = [self operationWithPriority:0];
+	op2.persistentUserInfo = @{ @"key": @"value", @"number": @(42) };
+	
+	YapDatabaseCloudCoreOperation *decoded2 =
+	  [YapDatabaseCloudCoreOperation operationWithSerializedData:[op2 serializedData]];
+	
+	XCTAssertTrue([decoded2 class] == [YapDatabaseCloudCoreOperation class]);
+	XCTAssertEqualObjects(decoded2.uuid, op2.uuid);
+	XCTAssertTrue(decoded2.priority == 0);
+	XCTAssertTrue(decoded2.dependencies.count == 0);
+	XCTAssertEqualObjects(decoded2.persistentUserInfo, op2.persistentUserInfo);
+	
+	// Subclass, with its own properties & persistentUserInfo
+	
+	TestCloudCoreOperation *op3 = [[TestCloudCoreOperation alloc] init];
+	op3.priority = INT32_MAX;
+	op3.name = @"upload";
+	op3.attempt = 3;
+	op3.persistentUserInfo = @{ @"key": @"value" };
+	[op3 addDependency:op1];
+	
+	NSData *data3 = [op3 serializedData];
+	XCTAssertEqualObjects([data3 subdataWithRange:NSMakeRange(0, magic.length)], magic);
+	
+	TestCloudCoreOperation *decoded3 =
+	  (TestCloudCoreOperation *)[YapDatabaseCloudCoreOperation operationWithSerializedData:data3];
+	
+	XCTAssertTrue([decoded3 class] == [TestCloudCoreOperation class]);
+	XCTAssertEqualObjects(decoded3.uuid, op3.uuid);
+	XCTAssertTrue(decoded3.priority == INT32_MAX);
+	XCTAssertEqualObjects(decoded3.dependencies, [NSSet setWithObject:op1.uuid]);
+	XCTAssertEqualObjects(decoded3.persistentUserInfo, op3.persistentUserInfo);
+	XCTAssertEqualObjects(decoded3.name, @"upload");
+	XCTAssertTrue(decoded3.attempt == 3);
+	
+	// The binary serializer uses the same format
+	
+	YDBCloudCoreOperationSerializer serializer = [YapDatabaseCloudCore binaryOperationSerializer];
+	YDBCloudCoreOperationDeserializer deserializer = [YapDatabaseCloudCore defaultOperationDeserializer];
+	
+	TestCloudCoreOperation *decoded4 = (TestCloudCoreOperation *)deserializer(serializer(op3));
+	
+	XCTAssertTrue([decoded4 class] == [TestCloudCoreOperation class]);
+	XCTAssertEqualObjects(decoded4.uuid, op3.uuid);
+	XCTAssertEqualObjects(decoded4.name, @"upload");
+	
+	// Truncated or unknown data is rejected
+	
+	XCTAssertNil([YapDatabaseCloudCoreOperation operationWithSerializedData:[data1 subdataWithRange:NSMakeRange(0, 10)]]);
+	XCTAssertNil([YapDatabaseCloudCoreOperation operationWithSerializedData:
+	                [data1 subdataWithRange:NSMakeRange(0, data1.length - 1)]]);
+	
+	NSMutableData *unknownVersion = [data1 mutableCopy];
+	((uint8_t *)unknownVersion.mutableBytes)[magic.length] = 0xFF;
+	
+	XCTAssertNil([YapDatabaseCloudCoreOperation operationWithSerializedData:unknownVersion]);
+}
+
+- (void)testSerialization_legacyKeyedArchive
+{
+	YDBCloudCoreOperationSerializer serializer = [YapDatabaseCloudCore defaultOperationSerializer];
+	YDBCloudCoreOperationDeserializer deserializer = [YapDatabaseCloudCore defaultOperationDeserializer];
+	
+	YapDatabaseCloudCoreOperation *op1 = [self operationWithPriority:5];
+	op1.persistentUserInfo = @{ @"key": @"value" };
+	[op1 addDependency:[NSUUID UUID]];
+	
+	TestCloudCoreOperation *op2 = [[TestCloudCoreOperation alloc] init];
+	op2.priority = -1;
+	op2.name = @"download";
+	op2.attempt = 1;
+	[op2 addDependency:op1];
+	
+	for (YapDatabaseCloudCoreOperation *op in @[ op1, op2 ])
+	{
+		NSData *archive = [NSKeyedArchiver archivedDataWithRootObject:op];
+		
+		// The default serializer is still a plain keyed archive
+		XCTAssertEqualObjects(serializer(op), archive);
+		
+		YapDatabaseCloudCoreOperation *decodedA = [YapDatabaseCloudCoreOperation operationWithSerializedData:archive];
+		YapDatabaseCloudCoreOperation *decodedB = deserializer(archive);
+		
+		for (YapDatabaseCloudCoreOperation *decoded in @[ decodedA, decodedB ])
+		{
+			XCTAssertTrue([decoded class] == [op class]);
+			XCTAssertEqualObjects(decoded.uuid, op.uuid);
+			XCTAssertTrue(decoded.priority == op.priority);
+			XCTAssertEqualObjects(decoded.dependencies, op.dependencies);
+			XCTAssertEqualObjects(decoded.persistentUserInfo, op.persistentUserInfo);
+		}
+	}
+	
+	TestCloudCoreOperation *decoded2 = (TestCloudCoreOperation *)
+	  [YapDatabaseCloudCoreOperation operationWithSerializedData:[NSKeyedArchiver archivedDataWithRootObject:op2]];
+	
+	XCTAssertEqualObjects(decoded2.name, @"download");
+	XCTAssertTrue(decoded2.attempt == 1);
+}
+
+- (void)testSerialization_binarySerializerPersists
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	YapDatabaseCloudCoreOperation *op1 = [self operationWithPriority:1];
+	op1.persistentUserInfo = @{ @"key": @"value" };
+	
+	TestCloudCoreOperation *op2 = [[TestCloudCoreOperation alloc] init];
+	op2.name = @"upload";
+	op2.attempt = 2;
+	[op2 addDependency:op1];
+	
+	// Write the operations with the binary serializer
+	
+	@autoreleasepool {
+		
+		YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+		XCTAssertNotNil(database, @"Oops");
+		
+		YapDatabaseConnection *connection = [database newConnection];
+		
+		TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+		YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+		                                                      delegate:delegate
+		                                   maxConcurrentOperationCount:8
+		                                                       options:nil];
+		
+		[cloudCore setOperationSerializer:[YapDatabaseCloudCore binaryOperationSerializer]
+		                     deserializer:[YapDatabaseCloudCore defaultOperationDeserializer]];
+		[cloudCore suspend];
+		
+		BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+		XCTAssertTrue(registered, @"Error registering extension");
+		
+		[self addOperations:@[ op1, op2 ] connection:connection];
+	}
+	
+	// And read them back with the default (de)serializer
+	
+	YapDatabase *database = [self reopenDatabaseWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:nil];
+	[cloudCore suspend];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		YapDatabaseCloudCoreOperation *restored1 = [[transaction ext:@"cloud"] operationWithUUID:op1.uuid];
+		TestCloudCoreOperation *restored2 =
+		  (TestCloudCoreOperation *)[[transaction ext:@"cloud"] operationWithUUID:op2.uuid];
+		
+		XCTAssertTrue([restored1 class] == [YapDatabaseCloudCoreOperation class]);
+		XCTAssertTrue(restored1.priority == 1);
+		XCTAssertEqualObjects(restored1.persistentUserInfo, op1.persistentUserInfo);
+		
+		XCTAssertTrue([restored2 class] == [TestCloudCoreOperation class]);
+		XCTAssertEqualObjects(restored2.dependencies, [NSSet setWithObject:op1.uuid]);
+		XCTAssertEqualObjects(restored2.name, @"upload");
+		XCTAssertTrue(restored2.attempt == 2);
+	}];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Complete & Skip
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)testCompleteOperations_duplicateUUIDs
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:nil];
+	[cloudCore suspend];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	YapDatabaseCloudCorePipeline *pipeline = [cloudCore defaultPipeline];
+	
+	YapDatabaseCloudCoreOperation *op1 = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *op2 = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *op3 = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *op4 = [self operationWithPriority:0];
+	
+	[self addOperations:@[ op1, op2, op3, op4 ] connection:connection];
+	XCTAssertTrue([self queueRowCountForCloudCore:cloudCore connection:connection] == 4);
+	
+	// Each operation is only completed (or skipped) once, no matter how often it's listed
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"cloud"] completeOperationsWithUUIDs:@[ op1.uuid, op1.uuid, op2.uuid, op1.uuid ]];
+		[[transaction ext:@"cloud"] skipOperationsWithUUIDs:@[ op3.uuid, op3.uuid, [NSUUID UUID], op2.uuid ]];
+		
+		YapDatabaseCloudCoreTransaction *cloudTransaction = [transaction ext:@"cloud"];
+		
+		XCTAssertTrue([cloudTransaction operationWithUUID:op1.uuid].pendingStatusIsCompleted);
+		XCTAssertTrue([cloudTransaction operationWithUUID:op2.uuid].pendingStatusIsCompleted);
+		XCTAssertTrue([cloudTransaction operationWithUUID:op3.uuid].pendingStatusIsSkipped);
+		XCTAssertFalse([cloudTransaction operationWithUUID:op4.uuid].pendingStatusIsCompletedOrSkipped);
+	}];
+	
+	XCTAssertEqualObjects([self operationUUIDsForPipeline:pipeline], [NSSet setWithObject:op4.uuid]);
+	XCTAssertTrue([self queueRowCountForCloudCore:cloudCore connection:connection] == 1);
+	
+	// Including operations that were added within the same transaction
+	
+	YapDatabaseCloudCoreOperation *op5 = [self operationWithPriority:0];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		XCTAssertTrue([[transaction ext:@"cloud"] addOperation:op5]);
+		
+		[[transaction ext:@"cloud"] completeOperationsWithUUIDs:@[ op5.uuid, op4.uuid, op5.uuid, op4.uuid ]];
+	}];
+	
+	XCTAssertTrue([pipeline graphCount] == 0);
+	XCTAssertTrue([self queueRowCountForCloudCore:cloudCore connection:connection] == 0);
+}
+
+- (void)testCompleteOperations_multiplePipelines
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:nil];
+	
+	YapDatabaseCloudCorePipeline *otherPipeline =
+	  [[YapDatabaseCloudCorePipeline alloc] initWithName:@"other" delegate:delegate];
+	
+	XCTAssertTrue([cloudCore registerPipeline:otherPipeline]);
+	[cloudCore suspend];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	YapDatabaseCloudCorePipeline *defaultPipeline = [cloudCore defaultPipeline];
+	
+	YapDatabaseCloudCoreOperation *defaultOp1 = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *defaultOp2 = [self operationWithPriority:0];
+	
+	YapDatabaseCloudCoreOperation *otherOp1 = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *otherOp2 = [self operationWithPriority:0];
+	YapDatabaseCloudCoreOperation *otherOp3 = [self operationWithPriority:0];
+	
+	otherOp1.pipeline = @"other";
+	otherOp2.pipeline = @"other";
+	otherOp3.pipeline = @"other";
+	
+	[self addOperations:@[ defaultOp1, defaultOp2, otherOp1, otherOp2, otherOp3 ] connection:connection];
+	XCTAssertTrue([self queueRowCountForCloudCore:cloudCore connection:connection] == 5);
+	
+	// Without a pipeline name, every pipeline is searched
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"cloud"] completeOperationsWithUUIDs:@[ defaultOp1.uuid, otherOp1.uuid ]];
+	}];
+	
+	XCTAssertEqualObjects([self operationUUIDsForPipeline:defaultPipeline], [NSSet setWithObject:defaultOp2.uuid]);
+	XCTAssertEqualObjects([self operationUUIDsForPipeline:otherPipeline],
+	                      ([NSSet setWithObjects:otherOp2.uuid, otherOp3.uuid, nil]));
+	XCTAssertTrue([self queueRowCountForCloudCore:cloudCore connection:connection] == 3);
+	
+	// With a pipeline name, only that pipeline is searched
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"cloud"] skipOperationsWithUUIDs:@[ defaultOp2.uuid, otherOp2.uuid ] inPipeline:@"other"];
+	}];
+	
+	XCTAssertEqualObjects([self operationUUIDsForPipeline:defaultPipeline], [NSSet setWithObject:defaultOp2.uuid]);
+	XCTAssertEqualObjects([self operationUUIDsForPipeline:otherPipeline], [NSSet setWithObject:otherOp3.uuid]);
+	XCTAssertTrue([self queueRowCountForCloudCore:cloudCore connection:connection] == 2);
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"cloud"] skipOperationsWithUUIDs:@[ otherOp3.uuid, defaultOp2.uuid ]];
+	}];
+	
+	XCTAssertTrue([defaultPipeline graphCount] == 0);
+	XCTAssertTrue([otherPipeline graphCount] == 0);
+	XCTAssertTrue([self queueRowCountForCloudCore:cloudCore connection:connection] == 0);
+}
+
+- (void)testCompleteOperations_aboveParameterLimit
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	
+	NSUInteger const maxHostParams = 64;
+	NSUInteger const opCount = 300;
+	
+	NSMutableArray<NSUUID *> *opUUIDs = [NSMutableArray arrayWithCapacity:opCount];
+	
+	@autoreleasepool {
+		
+		YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+		XCTAssertNotNil(database, @"Oops");
+		
+		YapDatabaseConnection *connection = [database newConnection];
+		
+		// Lower the limit, so the batch deletes below have to be split into multiple statements
+		
+		[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+			
+			sqlite3_limit(connection->db, SQLITE_LIMIT_VARIABLE_NUMBER, (int)maxHostParams);
+		}];
+		
+		TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+		YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+		                                                      delegate:delegate
+		                                   maxConcurrentOperationCount:8
+		                                                       options:nil];
+		[cloudCore suspend];
+		
+		BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+		XCTAssertTrue(registered, @"Error registering extension");
+		
+		NSMutableArray<YapDatabaseCloudCoreOperation *> *operations = [NSMutableArray arrayWithCapacity:opCount];
+		for (NSUInteger i = 0; i < opCount; i++)
+		{
+			YapDatabaseCloudCoreOperation *op = [self operationWithPriority:0];
+			
+			[operations addObject:op];
+			[opUUIDs addObject:op.uuid];
+		}
+		
+		[self addOperations:operations connection:connection];
+		XCTAssertTrue([self queueRowCountForCloudCore:cloudCore connection:connection] == opCount);
+		
+		// Complete 150 (3 statements), then skip 101 (2 statements)
+		
+		NSArray<NSUUID *> *completeUUIDs = [opUUIDs subarrayWithRange:NSMakeRange(0, 150)];
+		NSArray<NSUUID *> *skipUUIDs = [opUUIDs subarrayWithRange:NSMakeRange(150, 101)];
+		
+		[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			[[transaction ext:@"cloud"] completeOperationsWithUUIDs:[completeUUIDs arrayByAddingObjectsFromArray:completeUUIDs]];
+		}];
+		
+		XCTAssertTrue([self queueRowCountForCloudCore:cloudCore connection:connection] == (opCount - 150));
+		
+		[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			[[transaction ext:@"cloud"] skipOperationsWithUUIDs:skipUUIDs];
+		}];
+		
+		XCTAssertTrue([self queueRowCountForCloudCore:cloudCore connection:connection] == (opCount - 251));
+		
+		XCTAssertEqualObjects([self operationUUIDsForPipeline:[cloudCore defaultPipeline]],
+		                      [NSSet setWithArray:[opUUIDs subarrayWithRange:NSMakeRange(251, opCount - 251)]]);
+	}
+	
+	// The deleted rows must stay deleted
+	
+	YapDatabase *database = [self reopenDatabaseWithURL:databaseURL];
+	XCTAssertNotNil(database, @"Oops");
+	
+	TestCloudCorePipelineDelegate *delegate = [[TestCloudCorePipelineDelegate alloc] init];
+	YapDatabaseCloudCore *cloudCore = [self cloudCoreWithAlgorithm:YDBCloudCorePipelineAlgorithm_CommitGraph
+	                                                      delegate:delegate
+	                                   maxConcurrentOperationCount:8
+	                                                       options:nil];
+	[cloudCore suspend];
+	
+	BOOL registered = [database registerExtension:cloudCore withName:@"cloud"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	XCTAssertEqualObjects([self operationUUIDsForPipeline:[cloudCore defaultPipeline]],
+	                      [NSSet setWithArray:[opUUIDs subarrayWithRange:NSMakeRange(251, opCount - 251)]]);
+}
+
+@end
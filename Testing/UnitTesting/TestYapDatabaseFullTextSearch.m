@@ -234,4 +234,639 @@
 	}];
 }
 
+- (void)testIncrementalPopulation
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	NSUInteger const existingCount = 25;
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSUInteger i = 0; i < existingCount; i++)
+		{
+			NSString *key = [NSString stringWithFormat:@"key%lu", (unsigned long)i];
+			[transaction setObject:@"hello world" forKey:key inCollection:nil];
+		}
+	}];
+	
+	YapDatabaseFullTextSearchHandler *handler = [YapDatabaseFullTextSearchHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object){
+		
+		[dict setObject:object forKey:@"content"];
+	}];
+	
+	YapDatabaseFullTextSearch *fts =
+	  [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                 handler:handler];
+	fts.populationChunkSize = 10;
+	
+	[database registerExtension:fts withName:@"fts"];
+	
+	NSUInteger (^CountMatches)(NSString *) = ^NSUInteger (NSString *query){
+		
+		__block NSUInteger count = 0;
+		[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+			
+			[[transaction ext:@"fts"] enumerateKeysMatching:query
+			                                     usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+				count++;
+			}];
+		}];
+		return count;
+	};
+	
+	// Registration doesn't index the existing rows
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue([[transaction ext:@"fts"] isPartialIndex]);
+	}];
+	XCTAssertTrue(CountMatches(@"hello") == 0);
+	
+	// But new writes are indexed immediately
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@"hello coffee shop" forKey:@"new" inCollection:nil];
+	}];
+	XCTAssertTrue(CountMatches(@"hello") == 1);
+	XCTAssertTrue(CountMatches(@"coffee") == 1);
+	
+	// Populate in the background
+	
+	dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+	
+	[[connection extension:@"fts"] asyncPopulateWithCompletionQueue:dispatch_get_global_queue(0, 0)
+	                                                completionBlock:^{
+		dispatch_semaphore_signal(semaphore);
+	}];
+	
+	dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertFalse([[transaction ext:@"fts"] isPartialIndex]);
+	}];
+	XCTAssertTrue(CountMatches(@"hello") == existingCount + 1);
+	XCTAssertTrue(CountMatches(@"coffee") == 1);
+}
+
+- (void)testContentless
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseFullTextSearchHandler *handler = [YapDatabaseFullTextSearchHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object){
+		
+		[dict setObject:object forKey:@"content"];
+	}];
+	
+	YapDatabaseFullTextSearch *fts =
+	  [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                 options:nil
+	                                                 handler:handler
+	                                              ftsVersion:YapDatabaseFullTextSearchFTS5Version
+	                                              versionTag:nil];
+	fts.contentless = YES;
+	
+	[database registerExtension:fts withName:@"fts"];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@"hello world"       forKey:@"key1" inCollection:nil];
+		[transaction setObject:@"hello coffee shop" forKey:@"key2" inCollection:nil];
+		[transaction setObject:@"hello laptop"      forKey:@"key3" inCollection:nil];
+	}];
+	
+	// Modify & remove rows (requires contentless_delete)
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@"goodbye laptop" forKey:@"key3" inCollection:nil];
+		[transaction removeObjectForKey:@"key1" inCollection:nil];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		__block NSUInteger count;
+		
+		count = 0;
+		[[transaction ext:@"fts"] enumerateKeysMatching:@"hello"
+		                                     usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+			count++;
+		}];
+		XCTAssertTrue(count == 1, @"Wrong number of search results");
+		
+		count = 0;
+		[[transaction ext:@"fts"] enumerateKeysMatching:@"laptop"
+		                                     usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+			count++;
+		}];
+		XCTAssertTrue(count == 1, @"Wrong number of search results");
+		
+		// Snippets are generated on demand
+		
+		YapDatabaseFullTextSearchSnippetOptions *options = [YapDatabaseFullTextSearchSnippetOptions new];
+		options.startMatchText = @"[[";
+		options.endMatchText   = @"]]";
+		
+		count = 0;
+		[[transaction ext:@"fts"] enumerateKeysMatching:@"coffee"
+		                             withSnippetOptions:options
+		                                     usingBlock:
+		    ^(NSString *snippet, NSString *collection, NSString *key, BOOL *stop) {
+			
+			XCTAssertTrue([key isEqualToString:@"key2"]);
+			XCTAssertTrue([snippet isEqualToString:@"hello [[coffee]] shop"], @"Unexpected snippet: %@", snippet);
+			count++;
+		}];
+		XCTAssertTrue(count == 1, @"Wrong number of search results");
+	}];
+}
+
+- (void)testFastTokenizer
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseFullTextSearchHandler *handler = [YapDatabaseFullTextSearchHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object){
+		
+		[dict setObject:object forKey:@"content"];
+	}];
+	
+	NSDictionary *options = @{ @"tokenize": @"'yap_fast edge_ngram 2 8'" };
+	
+	YapDatabaseFullTextSearch *fts =
+	  [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                 options:options
+	                                                 handler:handler
+	                                              ftsVersion:YapDatabaseFullTextSearchFTS5Version
+	                                              versionTag:nil];
+	
+	XCTAssertTrue([database registerExtension:fts withName:@"fts"]);
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@"Hello, World! (coffee-shop)" forKey:@"key1" inCollection:nil];
+		[transaction setObject:@"HELLO laptop 2017"           forKey:@"key2" inCollection:nil];
+		[transaction setObject:@"Grüße aus dem Café"          forKey:@"key3" inCollection:nil]; // non-ASCII
+	}];
+	
+	// Use a different connection, to ensure the tokenizer is registered per connection
+	
+	YapDatabaseConnection *connection2 = [database newConnection];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSUInteger (^CountMatches)(NSString *) = ^NSUInteger (NSString *query){
+			
+			__block NSUInteger count = 0;
+			[[transaction ext:@"fts"] enumerateKeysMatching:query
+			                                     usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+				count++;
+			}];
+			return count;
+		};
+		
+		XCTAssertTrue(CountMatches(@"hello") == 2);
+		XCTAssertTrue(CountMatches(@"coffee") == 1);
+		XCTAssertTrue(CountMatches(@"shop") == 1);
+		XCTAssertTrue(CountMatches(@"2017") == 1);
+		XCTAssertTrue(CountMatches(@"café") == 1);
+		
+		// Edge n-grams
+		
+		XCTAssertTrue(CountMatches(@"hel") == 2);
+		XCTAssertTrue(CountMatches(@"lapt") == 1);
+		XCTAssertTrue(CountMatches(@"caf") == 1);
+		XCTAssertTrue(CountMatches(@"h") == 0); // below minimum
+	}];
+}
+
+/**
+ * FTS5 needs the table's tokenizer in order to drop the table.
+ * So a table using the custom tokenizer must be droppable from a connection that hasn't registered it.
+**/
+- (void)testFastTokenizer_dropTable
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseFullTextSearchHandler *handler = [YapDatabaseFullTextSearchHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object){
+		
+		[dict setObject:object forKey:@"content"];
+	}];
+	
+	NSDictionary *options = @{ @"tokenize": @"'yap_fast edge_ngram 2 8'" };
+	
+	YapDatabaseFullTextSearch *fts1 =
+	  [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                 options:options
+	                                                 handler:handler
+	                                              ftsVersion:YapDatabaseFullTextSearchFTS5Version
+	                                              versionTag:@"1"];
+	
+	YapDatabaseFullTextSearch *fts2 =
+	  [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                 options:options
+	                                                 handler:handler
+	                                              ftsVersion:YapDatabaseFullTextSearchFTS5Version
+	                                              versionTag:@"1"];
+	
+	XCTAssertTrue([database registerExtension:fts1 withName:@"fts1"]);
+	XCTAssertTrue([database registerExtension:fts2 withName:@"fts2"]);
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@"hello coffee shop" forKey:@"key1" inCollection:nil];
+		[transaction setObject:@"hello laptop"      forKey:@"key2" inCollection:nil];
+	}];
+	
+	//
+	// Re-open the database, without the custom tokenizer.
+	//
+	
+	connection = nil;
+	fts1 = nil;
+	fts2 = nil;
+	database = nil;
+	
+	for (int i = 0; i < 100 && database == nil; i++)
+	{
+		// Wait for the previous database instance to be deallocated
+		if (i > 0) [NSThread sleepForTimeInterval:0.05];
+		
+		database = [[YapDatabase alloc] initWithURL:databaseURL];
+	}
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	connection = [database newConnection];
+	
+	// Re-registering with a new versionTag & the default tokenizer drops & re-creates the table.
+	
+	fts1 = [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                      options:nil
+	                                                      handler:handler
+	                                                   ftsVersion:YapDatabaseFullTextSearchFTS5Version
+	                                                   versionTag:@"2"];
+	
+	XCTAssertTrue([database registerExtension:fts1 withName:@"fts1"]);
+	
+	// Unregistering drops the (orphaned) table.
+	// Otherwise re-registering (with the default tokenizer) would fail to re-populate the old table.
+	
+	[database unregisterExtensionWithName:@"fts2"];
+	
+	fts2 = [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                      options:nil
+	                                                      handler:handler
+	                                                   ftsVersion:YapDatabaseFullTextSearchFTS5Version
+	                                                   versionTag:@"1"];
+	
+	XCTAssertTrue([database registerExtension:fts2 withName:@"fts2"]);
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		for (NSString *extName in @[ @"fts1", @"fts2" ])
+		{
+			__block NSUInteger count = 0;
+			[[transaction ext:extName] enumerateKeysMatching:@"hello"
+			                                      usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+				count++;
+			}];
+			XCTAssertTrue(count == 2, @"Wrong number of search results (%@)", extName);
+		}
+	}];
+}
+
+- (void)testBm25TopK
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseFullTextSearchHandler *handler = [YapDatabaseFullTextSearchHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object){
+		
+		[dict setObject:object forKey:@"content"];
+	}];
+	
+	YapDatabaseFullTextSearch *fts =
+	  [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                 options:nil
+	                                                 handler:handler
+	                                              ftsVersion:YapDatabaseFullTextSearchFTS5Version
+	                                              versionTag:nil];
+	
+	XCTAssertTrue([database registerExtension:fts withName:@"fts"]);
+	
+	NSUInteger const count = 200;
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		NSArray *words = @[ @"apple", @"banana", @"cherry", @"date" ];
+		
+		for (NSUInteger i = 0; i < count; i++)
+		{
+			NSMutableString *content = [NSMutableString stringWithString:@"fruit"];
+			for (NSUInteger w = 0; w < (i % 7) + 1; w++)
+			{
+				[content appendFormat:@" %@", words[(i + w) % [words count]]];
+			}
+			
+			NSString *collection = (i % 2) ? @"odd" : @"even";
+			NSString *key = [NSString stringWithFormat:@"%lu", (unsigned long)i];
+			
+			[transaction setObject:content forKey:key inCollection:collection];
+		}
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSString *(^Describe)(NSString *, NSString *) = ^NSString *(NSString *collection, NSString *key){
+			return [NSString stringWithFormat:@"%@/%@", collection, key];
+		};
+		
+		// Full (unlimited) result set
+		
+		NSMutableSet *all = [NSMutableSet set];
+		[[transaction ext:@"fts"] enumerateBm25OrderedKeysMatching:@"apple"
+		                                               withWeights:nil
+		                                                usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+			[all addObject:Describe(collection, key)];
+		}];
+		
+		XCTAssertTrue([all count] > 50);
+		
+		// Limit/offset pages
+		
+		NSMutableArray *paged = [NSMutableArray array];
+		for (NSUInteger offset = 0; offset < [all count]; offset += 25)
+		{
+			__block NSUInteger pageCount = 0;
+			[[transaction ext:@"fts"] enumerateBm25OrderedKeysMatching:@"apple"
+			                                               withWeights:nil
+			                                                     limit:25
+			                                                    offset:offset
+			                                                usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+				[paged addObject:Describe(collection, key)];
+				pageCount++;
+			}];
+			
+			XCTAssertTrue(pageCount == MIN((NSUInteger)25, [all count] - offset));
+		}
+		
+		XCTAssertTrue([paged count] == [all count]);
+		XCTAssertEqualObjects([NSSet setWithArray:paged], all);
+		
+		// Keyset pages (with custom weights) must produce the same order as limit/offset pages
+		
+		NSMutableArray *weightedPaged = [NSMutableArray array];
+		for (NSUInteger offset = 0; offset < [all count]; offset += 25)
+		{
+			[[transaction ext:@"fts"] enumerateBm25OrderedKeysMatching:@"apple"
+			                                               withWeights:@[ @(1.0) ]
+			                                                     limit:25
+			                                                    offset:offset
+			                                                usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+				[weightedPaged addObject:Describe(collection, key)];
+			}];
+		}
+		
+		NSMutableArray *cursored = [NSMutableArray array];
+		YapDatabaseFullTextSearchBm25Cursor *cursor = nil;
+		NSUInteger pages = 0;
+		do {
+			cursor = [[transaction ext:@"fts"] enumerateBm25OrderedKeysMatching:@"apple"
+			                                                        withWeights:@[ @(1.0) ]
+			                                                              limit:25
+			                                                        afterCursor:cursor
+			                                                         usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+				[cursored addObject:Describe(collection, key)];
+			}];
+			pages++;
+			
+		} while (cursor && pages < 100);
+		
+		XCTAssertEqualObjects(cursored, weightedPaged);
+		XCTAssertEqualObjects(cursored, paged);
+		
+		// Top-K with filtering must match the filtered (ordered) full result set
+		
+		NSMutableArray *expected = [NSMutableArray array];
+		for (NSString *item in paged)
+		{
+			if ([item hasPrefix:@"odd/"] && [expected count] < 10) {
+				[expected addObject:item];
+			}
+		}
+		
+		NSMutableArray *filtered = [NSMutableArray array];
+		[[transaction ext:@"fts"] enumerateBm25OrderedKeysMatching:@"apple"
+		                                               withWeights:nil
+		                                                     limit:10
+		                                                    filter:^BOOL(NSString *collection, NSString *key) {
+			
+			return [collection isEqualToString:@"odd"];
+			
+		} usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+			
+			[filtered addObject:Describe(collection, key)];
+		}];
+		
+		XCTAssertEqualObjects(filtered, expected);
+		
+		// Limit of zero
+		
+		__block NSUInteger zeroCount = 0;
+		[[transaction ext:@"fts"] enumerateBm25OrderedKeysMatching:@"apple"
+		                                               withWeights:nil
+		                                                     limit:0
+		                                                    offset:0
+		                                                usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+			zeroCount++;
+		}];
+		
+		XCTAssertTrue(zeroCount == 0);
+	}];
+}
+
+
+- (void)testQueryCache
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection1 = [database newConnection];
+	YapDatabaseConnection *connection2 = [database newConnection];
+	
+	YapDatabaseFullTextSearchHandler *handler = [YapDatabaseFullTextSearchHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object){
+		
+		[dict setObject:object forKey:@"content"];
+	}];
+	
+	YapDatabaseFullTextSearch *fts =
+	  [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                 options:nil
+	                                                 handler:handler
+	                                              ftsVersion:YapDatabaseFullTextSearchFTS5Version
+	                                              versionTag:nil];
+	
+	XCTAssertTrue([database registerExtension:fts withName:@"fts"]);
+	
+	XCTAssertTrue([[connection1 ext:@"fts"] queryCacheEnabled]);
+	
+	[connection2 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@"hello world" forKey:@"key1" inCollection:nil];
+		[transaction setObject:@"hello coffee shop" forKey:@"key2" inCollection:nil];
+		[transaction setObject:@"goodbye world" forKey:@"key3" inCollection:nil];
+	}];
+	
+	NSSet* (^Keys)(YapDatabaseReadTransaction *, NSString *) = ^NSSet* (YapDatabaseReadTransaction *transaction, NSString *query){
+		
+		NSMutableSet *keys = [NSMutableSet set];
+		[[transaction ext:@"fts"] enumerateKeysMatching:query usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+			[keys addObject:key];
+		}];
+		return keys;
+	};
+	
+	NSDictionary* (^Snippets)(YapDatabaseReadTransaction *, NSString *) =
+	  ^NSDictionary* (YapDatabaseReadTransaction *transaction, NSString *query)
+	{
+		NSMutableDictionary *snippets = [NSMutableDictionary dictionary];
+		[[transaction ext:@"fts"] enumerateKeysMatching:query
+		                             withSnippetOptions:nil
+		                                     usingBlock:^(NSString *snippet, NSString *collection, NSString *key, BOOL *stop) {
+			snippets[key] = snippet;
+		}];
+		return snippets;
+	};
+	
+	__block NSDictionary *snippets = nil;
+	
+	[connection1 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSSet *expected = [NSSet setWithObjects:@"key1", @"key2", nil];
+		
+		XCTAssertEqualObjects(Keys(transaction, @"hello"), expected);
+		XCTAssertEqualObjects(Keys(transaction, @"hello"), expected); // from cache
+		
+		snippets = Snippets(transaction, @"hello");
+		XCTAssertTrue([snippets count] == 2);
+		XCTAssertEqualObjects(Snippets(transaction, @"hello"), snippets); // from cache
+		
+		// A stopped enumeration shouldn't pollute the cache
+		
+		__block NSUInteger stoppedCount = 0;
+		[[transaction ext:@"fts"] enumerateKeysMatching:@"world" usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+			stoppedCount++;
+			*stop = YES;
+		}];
+		XCTAssertTrue(stoppedCount == 1);
+		
+		expected = [NSSet setWithObjects:@"key1", @"key3", nil];
+		XCTAssertEqualObjects(Keys(transaction, @"world"), expected);
+	}];
+	
+	// A change made on another connection must invalidate the cache
+	
+	[connection2 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@"hello again" forKey:@"key4" inCollection:nil];
+		[transaction removeObjectForKey:@"key1" inCollection:nil];
+	}];
+	
+	[connection1 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSSet *expected = [NSSet setWithObjects:@"key2", @"key4", nil];
+		XCTAssertEqualObjects(Keys(transaction, @"hello"), expected);
+		
+		NSDictionary *newSnippets = Snippets(transaction, @"hello");
+		XCTAssertEqualObjects([NSSet setWithArray:[newSnippets allKeys]], expected);
+		XCTAssertEqualObjects(newSnippets[@"key2"], snippets[@"key2"]);
+	}];
+	
+	// A change made within a transaction must be visible to subsequent queries within the same transaction
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		NSSet *expected = [NSSet setWithObjects:@"key2", @"key4", nil];
+		XCTAssertEqualObjects(Keys(transaction, @"hello"), expected);
+		
+		[transaction setObject:@"hello there" forKey:@"key5" inCollection:nil];
+		
+		expected = [NSSet setWithObjects:@"key2", @"key4", @"key5", nil];
+		XCTAssertEqualObjects(Keys(transaction, @"hello"), expected);
+	}];
+	
+	// Rolled back changes must not be visible afterwards
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@"hello rollback" forKey:@"key6" inCollection:nil];
+		
+		XCTAssertTrue([Keys(transaction, @"hello") containsObject:@"key6"]);
+		[transaction rollback];
+	}];
+	
+	[connection1 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSSet *expected = [NSSet setWithObjects:@"key2", @"key4", @"key5", nil];
+		XCTAssertEqualObjects(Keys(transaction, @"hello"), expected);
+	}];
+	
+	// Disabled cache
+	
+	[[connection1 ext:@"fts"] setQueryCacheEnabled:NO];
+	XCTAssertFalse([[connection1 ext:@"fts"] queryCacheEnabled]);
+	
+	[connection1 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSSet *expected = [NSSet setWithObjects:@"key2", @"key4", @"key5", nil];
+		XCTAssertEqualObjects(Keys(transaction, @"hello"), expected);
+		XCTAssertEqualObjects(Keys(transaction, @"hello"), expected);
+	}];
+}
+
 @end
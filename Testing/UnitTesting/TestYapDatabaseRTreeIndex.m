@@ -0,0 +1,872 @@
+#import <XCTest/XCTest.h>
+
+#import <YapDatabase/YapDatabase.h>
+#import <YapDatabase/YapDatabaseRTreeIndex.h>
+#import <YapDatabase/YapDatabasePrivate.h>
+
+@interface TestYapDatabaseRTreeIndex : XCTestCase
+@end
+
+@implementation TestYapDatabaseRTreeIndex
+
+- (NSString *)fileName
+{
+	NSString *filePath = [NSString stringWithFormat:@"%s", __FILE__];
+	NSString *fileName = [filePath lastPathComponent];
+	
+	NSUInteger dotLocation = [fileName rangeOfString:@"." options:NSBackwardsSearch].location;
+	if (dotLocation != NSNotFound) {
+		 fileName = [fileName substringToIndex:dotLocation];
+	}
+	
+	return fileName;
+}
+
+- (NSURL *)databaseURL:(NSString *)suffix
+{
+	NSString *databaseName = [NSString stringWithFormat:@"%@-%@.sqlite", [self fileName], suffix];
+	
+	NSArray<NSURL*> *urls = [[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask];
+	NSURL *baseDir = [urls firstObject];
+	
+	return [baseDir URLByAppendingPathComponent:databaseName isDirectory:NO];
+}
+
+- (void)setUp
+{
+	[super setUp];
+}
+
+- (void)tearDown
+{
+	[super tearDown];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Utilities
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (NSString *)tableNameForRTree:(NSString *)registeredName
+{
+	return [NSString stringWithFormat:@"rTreeIndex_%@", registeredName];
+}
+
+- (NSString *)keyForIndex:(NSUInteger)index
+{
+	return [NSString stringWithFormat:@"%lu", (unsigned long)index];
+}
+
+- (NSArray<NSString *> *)columnNamesWithDimensions:(NSUInteger)dimensions
+{
+	NSMutableArray<NSString *> *columnNames = [NSMutableArray arrayWithCapacity:(dimensions * 2)];
+	
+	for (NSUInteger d = 0; d < dimensions; d++)
+	{
+		[columnNames addObject:[NSString stringWithFormat:@"min%lu", (unsigned long)d]];
+		[columnNames addObject:[NSString stringWithFormat:@"max%lu", (unsigned long)d]];
+	}
+	
+	return columnNames;
+}
+
+/**
+ * The objects are boxes: an array with a min & max value for each dimension (in the same order as the columns).
+**/
+- (YapDatabaseRTreeIndex *)rtreeWithDimensions:(NSUInteger)dimensions
+{
+	NSArray<NSString *> *columnNames = [self columnNamesWithDimensions:dimensions];
+	
+	YapDatabaseRTreeIndexSetup *setup = [[YapDatabaseRTreeIndexSetup alloc] init];
+	[setup setColumns:columnNames];
+	
+	YapDatabaseRTreeIndexHandler *handler = [YapDatabaseRTreeIndexHandler withObjectBlock:
+	    ^(NSMutableDictionary *dict, NSString *collection, NSString *key, id object){
+		
+		__unsafe_unretained NSArray<NSNumber *> *box = (NSArray<NSNumber *> *)object;
+		
+		for (NSUInteger i = 0; i < [columnNames count]; i++)
+		{
+			dict[columnNames[i]] = box[i];
+		}
+	}];
+	
+	return [[YapDatabaseRTreeIndex alloc] initWithSetup:setup handler:handler versionTag:nil];
+}
+
+/**
+ * Generates boxes within a 100 unit wide area (in every dimension).
+ * About half of them are points (min == max), and the others are up to 1 unit wide.
+**/
+- (NSArray<NSArray<NSNumber *> *> *)boxesWithCount:(NSUInteger)count dimensions:(NSUInteger)dimensions seed:(unsigned)seed
+{
+	NSMutableArray *boxes = [NSMutableArray arrayWithCapacity:count];
+	
+	srandom(seed);
+	
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		BOOL isPoint = ((random() % 2) == 0);
+		NSMutableArray<NSNumber *> *box = [NSMutableArray arrayWithCapacity:(dimensions * 2)];
+		
+		for (NSUInteger d = 0; d < dimensions; d++)
+		{
+			double min = (double)(random() % 100000) / 1000.0;
+			double max = isPoint ? min : (min + ((double)(random() % 1000) / 1000.0));
+			
+			[box addObject:@(min)];
+			[box addObject:@(max)];
+		}
+		
+		[boxes addObject:box];
+	}
+	
+	return boxes;
+}
+
+/**
+ * Stores boxes[i] for key (startIndex + i), with at most batchSize objects per transaction.
+**/
+- (void)setBoxes:(NSArray *)boxes
+ startingAtIndex:(NSUInteger)startIndex
+      connection:(YapDatabaseConnection *)connection
+       batchSize:(NSUInteger)batchSize
+{
+	NSUInteger count = [boxes count];
+	
+	for (NSUInteger offset = 0; offset < count; offset += batchSize)
+	{
+		[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			NSUInteger end = MIN(offset + batchSize, count);
+			for (NSUInteger i = offset; i < end; i++)
+			{
+				[transaction setObject:boxes[i] forKey:[self keyForIndex:(startIndex + i)] inCollection:nil];
+			}
+		}];
+	}
+}
+
+- (void)removeKeysInRange:(NSRange)range connection:(YapDatabaseConnection *)connection batchSize:(NSUInteger)batchSize
+{
+	for (NSUInteger offset = 0; offset < range.length; offset += batchSize)
+	{
+		NSUInteger end = MIN(offset + batchSize, range.length);
+		
+		NSMutableArray<NSString *> *keys = [NSMutableArray arrayWithCapacity:(end - offset)];
+		for (NSUInteger i = offset; i < end; i++)
+		{
+			[keys addObject:[self keyForIndex:(range.location + i)]];
+		}
+		
+		[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			[transaction removeObjectsForKeys:keys inCollection:nil];
+		}];
+	}
+}
+
+/**
+ * Executes the given SQL directly on the connection's database, and returns the resulting rows.
+**/
+- (NSArray<NSArray *> *)rowsForQuery:(NSString *)query connection:(YapDatabaseConnection *)connection
+{
+	NSMutableArray<NSArray *> *rows = [NSMutableArray array];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		sqlite3 *db = connection->db;
+		sqlite3_stmt *statement = NULL;
+		
+		int status = sqlite3_prepare_v2(db, [query UTF8String], -1, &statement, NULL);
+		XCTAssert(status == SQLITE_OK, @"Error preparing '%@': %d %s", query, status, sqlite3_errmsg(db));
+		
+		if (status != SQLITE_OK) return;
+		
+		while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+		{
+			int columnCount = sqlite3_column_count(statement);
+			NSMutableArray *row = [NSMutableArray arrayWithCapacity:columnCount];
+			
+			for (int i = 0; i < columnCount; i++)
+			{
+				switch (sqlite3_column_type(statement, i))
+				{
+					case SQLITE_INTEGER :
+						[row addObject:@(sqlite3_column_int64(statement, i))];
+						break;
+					case SQLITE_FLOAT :
+						[row addObject:@(sqlite3_column_double(statement, i))];
+						break;
+					case SQLITE_TEXT :
+						[row addObject:[NSString stringWithUTF8String:(const char *)sqlite3_column_text(statement, i)]];
+						break;
+					default :
+						[row addObject:[NSNull null]];
+						break;
+				}
+			}
+			
+			[rows addObject:row];
+		}
+		
+		XCTAssert(status == SQLITE_DONE, @"Error executing '%@': %d %s", query, status, sqlite3_errmsg(db));
+		
+		sqlite3_finalize(statement);
+	}];
+	
+	return rows;
+}
+
+/**
+ * Returns the content of the rtree table, as a dictionary of key -> coordinates (as stored in the rtree).
+**/
+- (NSDictionary<NSString *, NSArray *> *)entriesForRTree:(NSString *)registeredName
+                                              dimensions:(NSUInteger)dimensions
+                                              connection:(YapDatabaseConnection *)connection
+{
+	NSMutableString *query = [NSMutableString stringWithString:@"SELECT d.\"key\""];
+	
+	for (NSString *columnName in [self columnNamesWithDimensions:dimensions])
+	{
+		[query appendFormat:@", r.\"%@\"", columnName];
+	}
+	
+	[query appendFormat:@" FROM \"%@\" AS r INNER JOIN \"database2\" AS d ON d.\"rowid\" = r.\"rowid\";",
+	                    [self tableNameForRTree:registeredName]];
+	
+	NSMutableDictionary<NSString *, NSArray *> *entries = [NSMutableDictionary dictionary];
+	
+	for (NSArray *row in [self rowsForQuery:query connection:connection])
+	{
+		entries[row[0]] = [row subarrayWithRange:NSMakeRange(1, [row count] - 1)];
+	}
+	
+	return entries;
+}
+
+- (NSUInteger)nodeCountForRTree:(NSString *)registeredName connection:(YapDatabaseConnection *)connection
+{
+	NSString *query =
+	  [NSString stringWithFormat:@"SELECT COUNT(*) FROM \"%@_node\";", [self tableNameForRTree:registeredName]];
+	
+	NSArray<NSArray *> *rows = [self rowsForQuery:query connection:connection];
+	
+	return [[[rows firstObject] firstObject] unsignedIntegerValue];
+}
+
+/**
+ * Runs sqlite's integrity check for rtree tables (which is available as of sqlite 3.24).
+ * It checks that every node's bounding box contains its children, and that the _parent & _rowid tables are consistent.
+**/
+- (void)checkRTree:(NSString *)registeredName connection:(YapDatabaseConnection *)connection
+{
+	if (sqlite3_libversion_number() < 3024000) return;
+	
+	NSString *query =
+	  [NSString stringWithFormat:@"SELECT rtreecheck('%@');", [self tableNameForRTree:registeredName]];
+	
+	NSArray<NSArray *> *rows = [self rowsForQuery:query connection:connection];
+	
+	XCTAssertEqualObjects([[rows firstObject] firstObject], @"ok", @"rtreecheck failed for rtree(%@)", registeredName);
+}
+
+- (NSSet<NSString *> *)keysForRTree:(NSString *)registeredName
+                      matchingQuery:(YapDatabaseQuery *)query
+                         connection:(YapDatabaseConnection *)connection
+{
+	NSMutableSet<NSString *> *keys = [NSMutableSet set];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		BOOL result = [[transaction ext:registeredName] enumerateKeysMatchingQuery:query
+		                                                                usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+			
+			[keys addObject:key];
+		}];
+		
+		XCTAssertTrue(result, @"Error executing query");
+	}];
+	
+	return keys;
+}
+
+/**
+ * Compares an rtree against a reference rtree (built by incremental inserts),
+ * including the stored coordinates of every entry, and the results of a set of window queries.
+ * Then runs rtreecheck on both of them.
+**/
+- (void)assertRTree:(NSString *)registeredName
+         connection:(YapDatabaseConnection *)connection
+       matchesRTree:(NSString *)referenceName
+         connection:(YapDatabaseConnection *)referenceConnection
+         dimensions:(NSUInteger)dimensions
+{
+	NSDictionary *entries =
+	  [self entriesForRTree:registeredName dimensions:dimensions connection:connection];
+	NSDictionary *referenceEntries =
+	  [self entriesForRTree:referenceName dimensions:dimensions connection:referenceConnection];
+	
+	XCTAssertTrue([entries count] > 0, @"Empty rtree(%@)", registeredName);
+	XCTAssertTrue([entries isEqualToDictionary:referenceEntries],
+	              @"rtree(%@) doesn't match reference(%@): %lu vs %lu entries",
+	              registeredName, referenceName, (unsigned long)[entries count], (unsigned long)[referenceEntries count]);
+	
+	srandom(7);
+	
+	for (NSUInteger i = 0; i < 50; i++)
+	{
+		double x = (double)(random() % 95000) / 1000.0;
+		double y = (double)(random() % 95000) / 1000.0;
+		
+		YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:
+		  @"WHERE max0 >= ? AND min0 <= ? AND max1 >= ? AND min1 <= ?", @(x), @(x + 5.0), @(y), @(y + 5.0)];
+		
+		NSSet *keys = [self keysForRTree:registeredName matchingQuery:query connection:connection];
+		NSSet *referenceKeys = [self keysForRTree:referenceName matchingQuery:query connection:referenceConnection];
+		
+		XCTAssertEqualObjects(keys, referenceKeys, @"Window query mismatch: x(%f) y(%f)", x, y);
+	}
+	
+	[self checkRTree:registeredName connection:connection];
+	[self checkRTree:referenceName connection:referenceConnection];
+}
+
+/**
+ * Compares nearest neighbour queries against a brute force search:
+ * the distance from the point to every entry's bounding box (as stored in the rtree), sorted.
+ *
+ * For a set of random points, the first k results must have the same distances as the k closest entries,
+ * in the same order. (Ties may come back in any order, so the keys themselves are checked via their distances.)
+ * Then a full enumeration must return every entry exactly once, in order of increasing distance.
+**/
+- (void)assertNearestNeighboursForRTree:(NSString *)registeredName
+                             dimensions:(NSUInteger)dimensions
+                             connection:(YapDatabaseConnection *)connection
+{
+	NSDictionary<NSString *, NSArray *> *entries =
+	  [self entriesForRTree:registeredName dimensions:dimensions connection:connection];
+	
+	XCTAssertTrue([entries count] > 0, @"Empty rtree(%@)", registeredName);
+	
+	NSUInteger const k = 20;
+	
+	srandom(11);
+	
+	for (NSUInteger q = 0; q <= 20; q++)
+	{
+		NSMutableArray<NSNumber *> *point = [NSMutableArray arrayWithCapacity:dimensions];
+		for (NSUInteger d = 0; d < dimensions; d++)
+		{
+			// Include a few points outside of the area that the boxes are in
+			double value = (double)(random() % 120000) / 1000.0 - 10.0;
+			
+			[point addObject:@(value)];
+		}
+		
+		NSMutableDictionary<NSString *, NSNumber *> *bruteForceDistances =
+		  [NSMutableDictionary dictionaryWithCapacity:[entries count]];
+		
+		[entries enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSArray *coordinates, BOOL *stop) {
+			
+			double distance = 0.0;
+			for (NSUInteger d = 0; d < dimensions; d++)
+			{
+				double p = [point[d] doubleValue];
+				double min = [coordinates[(d * 2) + 0] doubleValue];
+				double max = [coordinates[(d * 2) + 1] doubleValue];
+				
+				double delta = 0.0;
+				if (p < min)
+					delta = min - p;
+				else if (p > max)
+					delta = p - max;
+				
+				distance += delta * delta;
+			}
+			
+			bruteForceDistances[key] = @(sqrt(distance));
+		}];
+		
+		NSArray<NSNumber *> *sortedDistances =
+		  [[bruteForceDistances allValues] sortedArrayUsingSelector:@selector(compare:)];
+		
+		BOOL fullEnumeration = (q == 20);
+		
+		NSMutableArray<NSString *> *keys = [NSMutableArray array];
+		NSMutableArray<NSNumber *> *distances = [NSMutableArray array];
+		
+		[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+			
+			BOOL result = [[transaction ext:registeredName] enumerateKeysNearestToPoint:point
+			    usingBlock:^(NSString *collection, NSString *key, double distance, BOOL *stop) {
+				
+				[keys addObject:key];
+				[distances addObject:@(distance)];
+				
+				if (!fullEnumeration && ([keys count] == k)) *stop = YES;
+			}];
+			
+			XCTAssertTrue(result, @"Error executing nearest neighbour query");
+		}];
+		
+		NSUInteger expectedCount = fullEnumeration ? [entries count] : MIN(k, [entries count]);
+		
+		XCTAssertTrue([keys count] == expectedCount,
+		              @"Wrong number of results: %lu vs %lu", (unsigned long)[keys count], (unsigned long)expectedCount);
+		XCTAssertTrue([[NSSet setWithArray:keys] count] == [keys count], @"Duplicate results");
+		
+		NSUInteger count = MIN([keys count], expectedCount);
+		for (NSUInteger i = 0; i < count; i++)
+		{
+			double distance = [distances[i] doubleValue];
+			
+			XCTAssertEqualWithAccuracy(distance, [sortedDistances[i] doubleValue], 1e-9,
+			                           @"Wrong distance for result %lu", (unsigned long)i);
+			XCTAssertEqualWithAccuracy(distance, [bruteForceDistances[keys[i]] doubleValue], 1e-9,
+			                           @"Wrong distance for key(%@)", keys[i]);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Bulk Loading
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)testPopulate
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	// The reference is registered before the objects are added, so it's built by incremental inserts.
+	
+	BOOL registered = [database registerExtension:[self rtreeWithDimensions:2] withName:@"reference"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	NSArray *boxes = [self boxesWithCount:3000 dimensions:2 seed:42];
+	[self setBoxes:boxes startingAtIndex:0 connection:connection batchSize:100];
+	
+	// The rtree is populated (and bulk loaded) during registration
+	
+	registered = [database registerExtension:[self rtreeWithDimensions:2] withName:@"rtree"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"reference" connection:connection dimensions:2];
+	
+	NSUInteger nodeCount = [self nodeCountForRTree:@"rtree" connection:connection];
+	NSUInteger referenceNodeCount = [self nodeCountForRTree:@"reference" connection:connection];
+	
+	XCTAssertTrue(nodeCount < referenceNodeCount,
+	              @"Bulk loaded rtree isn't packed: %lu nodes vs %lu nodes",
+	              (unsigned long)nodeCount, (unsigned long)referenceNodeCount);
+	
+	// The rtree module should be able to keep modifying the packed tree
+	
+	NSArray *moreBoxes = [self boxesWithCount:200 dimensions:2 seed:43];
+	[self setBoxes:moreBoxes startingAtIndex:2900 connection:connection batchSize:50]; // 100 updates, 100 inserts
+	
+	[self removeKeysInRange:NSMakeRange(0, 300) connection:connection batchSize:50];
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"reference" connection:connection dimensions:2];
+}
+
+- (void)testLargeBatch
+{
+	NSString *referenceSuffix = [NSString stringWithFormat:@"%@-reference", NSStringFromSelector(_cmd)];
+	
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	NSURL *referenceDatabaseURL = [self databaseURL:referenceSuffix];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	[[NSFileManager defaultManager] removeItemAtURL:referenceDatabaseURL error:nil];
+	
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	YapDatabase *referenceDatabase = [[YapDatabase alloc] initWithURL:referenceDatabaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	XCTAssertNotNil(referenceDatabase, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	YapDatabaseConnection *referenceConnection = [referenceDatabase newConnection];
+	
+	BOOL registered = NO;
+	
+	registered = [database registerExtension:[self rtreeWithDimensions:2] withName:@"rtree"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	registered = [referenceDatabase registerExtension:[self rtreeWithDimensions:2] withName:@"rtree"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// Start with a small rtree (built incrementally in both databases)
+	
+	NSArray *boxes = [self boxesWithCount:500 dimensions:2 seed:42];
+	
+	[self setBoxes:boxes startingAtIndex:0 connection:connection batchSize:100];
+	[self setBoxes:boxes startingAtIndex:0 connection:referenceConnection batchSize:100];
+	
+	// Then a large batch: more inserts than there are entries in the rtree, so the rtree is rebuilt via a bulk load.
+	// Along with a few updates & removes, which are applied before the rebuild.
+	
+	NSArray *moreBoxes = [self boxesWithCount:2500 dimensions:2 seed:43];
+	NSArray *movedBoxes = [self boxesWithCount:50 dimensions:2 seed:44];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSUInteger i = 0; i < [moreBoxes count]; i++)
+		{
+			[transaction setObject:moreBoxes[i] forKey:[self keyForIndex:(500 + i)] inCollection:nil];
+		}
+		
+		for (NSUInteger i = 0; i < [movedBoxes count]; i++)
+		{
+			[transaction setObject:movedBoxes[i] forKey:[self keyForIndex:i] inCollection:nil];
+		}
+		
+		for (NSUInteger i = 50; i < 100; i++)
+		{
+			[transaction removeObjectForKey:[self keyForIndex:i] inCollection:nil];
+		}
+	}];
+	
+	[self setBoxes:moreBoxes startingAtIndex:500 connection:referenceConnection batchSize:100];
+	[self setBoxes:movedBoxes startingAtIndex:0 connection:referenceConnection batchSize:100];
+	[self removeKeysInRange:NSMakeRange(50, 50) connection:referenceConnection batchSize:100];
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"rtree" connection:referenceConnection dimensions:2];
+	
+	NSUInteger nodeCount = [self nodeCountForRTree:@"rtree" connection:connection];
+	NSUInteger referenceNodeCount = [self nodeCountForRTree:@"rtree" connection:referenceConnection];
+	
+	XCTAssertTrue(nodeCount < referenceNodeCount,
+	              @"Bulk loaded rtree isn't packed: %lu nodes vs %lu nodes",
+	              (unsigned long)nodeCount, (unsigned long)referenceNodeCount);
+	
+	// Small batches after the rebuild go through the rtree module (incremental inserts)
+	
+	NSArray *updatedBoxes = [self boxesWithCount:100 dimensions:2 seed:45];
+	
+	[self setBoxes:updatedBoxes startingAtIndex:1000 connection:connection batchSize:25];
+	[self setBoxes:updatedBoxes startingAtIndex:1000 connection:referenceConnection batchSize:25];
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"rtree" connection:referenceConnection dimensions:2];
+}
+
+- (void)testRepack
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	BOOL registered = NO;
+	
+	registered = [database registerExtension:[self rtreeWithDimensions:2] withName:@"rtree"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	registered = [database registerExtension:[self rtreeWithDimensions:2] withName:@"reference"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// Build both rtrees incrementally, with enough churn to leave the nodes loosely packed
+	
+	NSArray *boxes = [self boxesWithCount:3000 dimensions:2 seed:42];
+	[self setBoxes:boxes startingAtIndex:0 connection:connection batchSize:100];
+	
+	[self removeKeysInRange:NSMakeRange(0, 1000) connection:connection batchSize:100];
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"reference" connection:connection dimensions:2];
+	
+	NSUInteger nodeCountBeforeRepack = [self nodeCountForRTree:@"rtree" connection:connection];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"rtree"] repack];
+	}];
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"reference" connection:connection dimensions:2];
+	
+	NSUInteger nodeCount = [self nodeCountForRTree:@"rtree" connection:connection];
+	
+	XCTAssertTrue(nodeCount < nodeCountBeforeRepack,
+	              @"Repacked rtree isn't packed: %lu nodes vs %lu nodes",
+	              (unsigned long)nodeCount, (unsigned long)nodeCountBeforeRepack);
+	
+	// Changes within the same transaction as the repack are included in it
+	
+	NSArray *moreBoxes = [self boxesWithCount:100 dimensions:2 seed:43];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSUInteger i = 0; i < [moreBoxes count]; i++)
+		{
+			[transaction setObject:moreBoxes[i] forKey:[self keyForIndex:(2000 + i)] inCollection:nil];
+		}
+		
+		[[transaction ext:@"rtree"] repack];
+	}];
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"reference" connection:connection dimensions:2];
+	
+	// And the rtree module should be able to keep modifying the repacked tree
+	
+	NSArray *updatedBoxes = [self boxesWithCount:200 dimensions:2 seed:44];
+	[self setBoxes:updatedBoxes startingAtIndex:2900 connection:connection batchSize:50]; // 100 updates, 100 inserts
+	
+	[self removeKeysInRange:NSMakeRange(1000, 300) connection:connection batchSize:50];
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"reference" connection:connection dimensions:2];
+}
+
+/**
+ * With SQLITE_DBCONFIG_DEFENSIVE (sqlite 3.26+), the shadow tables of the rtree are read-only.
+ * So the bulk load fails, and the extension has to fall back to inserting the entries one at a time.
+**/
+- (void)testBulkLoadFallback
+{
+#ifndef SQLITE_DBCONFIG_DEFENSIVE
+	NSLog(@"Skipping %@: SQLITE_DBCONFIG_DEFENSIVE is not available", NSStringFromSelector(_cmd));
+#else
+	NSString *referenceSuffix = [NSString stringWithFormat:@"%@-reference", NSStringFromSelector(_cmd)];
+	
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	NSURL *referenceDatabaseURL = [self databaseURL:referenceSuffix];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	[[NSFileManager defaultManager] removeItemAtURL:referenceDatabaseURL error:nil];
+	
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	YapDatabase *referenceDatabase = [[YapDatabase alloc] initWithURL:referenceDatabaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	XCTAssertNotNil(referenceDatabase, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	YapDatabaseConnection *referenceConnection = [referenceDatabase newConnection];
+	
+	BOOL registered = NO;
+	
+	registered = [database registerExtension:[self rtreeWithDimensions:2] withName:@"rtree"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	registered = [referenceDatabase registerExtension:[self rtreeWithDimensions:2] withName:@"rtree"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	__block BOOL isDefensive = NO;
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		sqlite3 *db = connection->db;
+		
+		if (sqlite3_db_config(db, SQLITE_DBCONFIG_DEFENSIVE, 1, NULL) != SQLITE_OK) return;
+		
+		NSString *write =
+		  [NSString stringWithFormat:@"DELETE FROM \"%@_parent\" WHERE 0;", [self tableNameForRTree:@"rtree"]];
+		
+		sqlite3_stmt *statement = NULL;
+		isDefensive = (sqlite3_prepare_v2(db, [write UTF8String], -1, &statement, NULL) != SQLITE_OK);
+		
+		sqlite3_finalize(statement);
+	}];
+	
+	if (!isDefensive)
+	{
+		NSLog(@"Skipping %@: the rtree shadow tables are writable", NSStringFromSelector(_cmd));
+		return;
+	}
+	
+	// A large batch (which would normally be bulk loaded)
+	
+	NSArray *boxes = [self boxesWithCount:2000 dimensions:2 seed:42];
+	
+	[self setBoxes:boxes startingAtIndex:0 connection:connection batchSize:2000];
+	[self setBoxes:boxes startingAtIndex:0 connection:referenceConnection batchSize:100];
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"rtree" connection:referenceConnection dimensions:2];
+	
+	// And a repack
+	
+	[self removeKeysInRange:NSMakeRange(0, 500) connection:connection batchSize:100];
+	[self removeKeysInRange:NSMakeRange(0, 500) connection:referenceConnection batchSize:100];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"rtree"] repack];
+	}];
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"rtree" connection:referenceConnection dimensions:2];
+	
+	// Followed by incremental changes
+	
+	NSArray *updatedBoxes = [self boxesWithCount:200 dimensions:2 seed:43];
+	
+	[self setBoxes:updatedBoxes startingAtIndex:1900 connection:connection batchSize:50];
+	[self setBoxes:updatedBoxes startingAtIndex:1900 connection:referenceConnection batchSize:50];
+	
+	[self assertRTree:@"rtree" connection:connection matchesRTree:@"rtree" connection:referenceConnection dimensions:2];
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Nearest Neighbours
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)testNearestNeighbours
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	BOOL registered = [database registerExtension:[self rtreeWithDimensions:2] withName:@"rtree"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	NSArray *boxes = [self boxesWithCount:3000 dimensions:2 seed:42];
+	[self setBoxes:boxes startingAtIndex:0 connection:connection batchSize:100];
+	
+	[self assertNearestNeighboursForRTree:@"rtree" dimensions:2 connection:connection];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		// The object variant should pass the matching object
+		
+		__block NSUInteger count = 0;
+		[[transaction ext:@"rtree"] enumerateKeysAndObjectsNearestToPoint:@[ @(50.0), @(50.0) ]
+		    usingBlock:^(NSString *collection, NSString *key, id object, double distance, BOOL *stop) {
+			
+			XCTAssertEqualObjects(object, boxes[[key integerValue]], @"Wrong object for key(%@)", key);
+			
+			if (++count == 20) *stop = YES;
+		}];
+		
+		XCTAssertTrue(count == 20, @"Wrong number of results: %lu", (unsigned long)count);
+		
+		// The point needs one value per dimension
+		
+		BOOL result = [[transaction ext:@"rtree"] enumerateKeysNearestToPoint:@[ @(50.0) ]
+		    usingBlock:^(NSString *collection, NSString *key, double distance, BOOL *stop) {}];
+		
+		XCTAssertFalse(result, @"Expected invalid point to be rejected");
+	}];
+}
+
+- (void)testNearestNeighbours_dimensions
+{
+	for (NSNumber *dimensionsNumber in @[ @(1), @(3), @(5) ])
+	{
+		NSUInteger dimensions = [dimensionsNumber unsignedIntegerValue];
+		
+		NSString *suffix = [NSString stringWithFormat:@"%@-%lu", NSStringFromSelector(_cmd), (unsigned long)dimensions];
+		NSURL *databaseURL = [self databaseURL:suffix];
+		
+		[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+		YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+		
+		XCTAssertNotNil(database, @"Oops");
+		
+		YapDatabaseConnection *connection = [database newConnection];
+		
+		BOOL registered = [database registerExtension:[self rtreeWithDimensions:dimensions] withName:@"rtree"];
+		XCTAssertTrue(registered, @"Error registering extension");
+		
+		NSArray *boxes = [self boxesWithCount:2000 dimensions:dimensions seed:42];
+		[self setBoxes:boxes startingAtIndex:0 connection:connection batchSize:100];
+		
+		[self assertNearestNeighboursForRTree:@"rtree" dimensions:dimensions connection:connection];
+	}
+}
+
+- (void)testNearestNeighbours_remove
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	BOOL registered = [database registerExtension:[self rtreeWithDimensions:2] withName:@"rtree"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	NSArray *boxes = [self boxesWithCount:3000 dimensions:2 seed:42];
+	[self setBoxes:boxes startingAtIndex:0 connection:connection batchSize:100];
+	
+	// Removing most of the entries leaves nodes that are nearly empty (or that sqlite has merged & reinserted)
+	
+	[self removeKeysInRange:NSMakeRange(0, 2500) connection:connection batchSize:100];
+	
+	[self assertNearestNeighboursForRTree:@"rtree" dimensions:2 connection:connection];
+	
+	// Changes within the same transaction are included in the results
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSUInteger i = 2500; i < 2600; i++)
+		{
+			[transaction removeObjectForKey:[self keyForIndex:i] inCollection:nil];
+		}
+		
+		NSMutableSet<NSString *> *keys = [NSMutableSet set];
+		
+		[[transaction ext:@"rtree"] enumerateKeysNearestToPoint:@[ @(50.0), @(50.0) ]
+		    usingBlock:^(NSString *collection, NSString *key, double distance, BOOL *stop) {
+			
+			[keys addObject:key];
+		}];
+		
+		XCTAssertTrue([keys count] == 400, @"Wrong number of results: %lu", (unsigned long)[keys count]);
+		XCTAssertFalse([keys containsObject:[self keyForIndex:2500]], @"Removed key in results");
+	}];
+	
+	[self assertNearestNeighboursForRTree:@"rtree" dimensions:2 connection:connection];
+}
+
+- (void)testNearestNeighbours_bulkLoad
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:nil];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	// Populate (bulk loaded during registration)
+	
+	NSArray *boxes = [self boxesWithCount:3000 dimensions:2 seed:42];
+	[self setBoxes:boxes startingAtIndex:0 connection:connection batchSize:1000];
+	
+	BOOL registered = [database registerExtension:[self rtreeWithDimensions:2] withName:@"rtree"];
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	[self assertNearestNeighboursForRTree:@"rtree" dimensions:2 connection:connection];
+	
+	// A large batch (rebuilds the rtree via a bulk load)
+	
+	NSArray *moreBoxes = [self boxesWithCount:4000 dimensions:2 seed:43];
+	[self setBoxes:moreBoxes startingAtIndex:3000 connection:connection batchSize:4000];
+	
+	[self assertNearestNeighboursForRTree:@"rtree" dimensions:2 connection:connection];
+	
+	// And incremental changes to the packed tree
+	
+	[self removeKeysInRange:NSMakeRange(1000, 2000) connection:connection batchSize:100];
+	
+	[self assertNearestNeighboursForRTree:@"rtree" dimensions:2 connection:connection];
+}
+
+@end
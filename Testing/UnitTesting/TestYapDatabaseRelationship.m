@@ -303,6 +303,86 @@
 	}];
 }
 
+- (void)testProtocol_ConcurrentPopulate
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database);
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	// Populate the database BEFORE registering the extension,
+	// with enough rows to span multiple batches.
+	
+	NSUInteger const parentCount = 2500;
+	NSMutableArray<NSString *> *parentKeys = [NSMutableArray arrayWithCapacity:parentCount];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSUInteger i = 0; i < parentCount; i++)
+		{
+			Node_Standard *parent = [[Node_Standard alloc] init];
+			Node_Standard *child1 = [[Node_Standard alloc] init];
+			Node_Standard *child2 = [[Node_Standard alloc] init];
+			
+			parent.childKeys = @[ child1.key, child2.key ];
+			
+			[transaction setObject:parent forKey:parent.key inCollection:nil];
+			[transaction setObject:child1 forKey:child1.key inCollection:nil];
+			[transaction setObject:child2 forKey:child2.key inCollection:nil];
+			
+			[parentKeys addObject:parent.key];
+		}
+		
+		// This collection is excluded via allowedCollections
+		
+		Node_Standard *ignored = [[Node_Standard alloc] init];
+		ignored.childKeys = @[ parentKeys[0] ];
+		
+		[transaction setObject:ignored forKey:ignored.key inCollection:@"ignored"];
+	}];
+	
+	YapDatabaseRelationshipOptions *options = [[YapDatabaseRelationshipOptions alloc] init];
+	options.populateConcurrency = 4;
+	options.allowedCollections = [[YapWhitelistBlacklist alloc] initWithBlacklist:[NSSet setWithObject:@"ignored"]];
+	
+	YapDatabaseRelationship *relationship = [[YapDatabaseRelationship alloc] initWithVersionTag:nil options:options];
+	
+	BOOL registered = [database registerExtension:relationship withName:@"relationship"];
+	
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSUInteger edgeCount = [[transaction ext:@"relationship"] edgeCountWithName:@"child"];
+		XCTAssertTrue(edgeCount == (parentCount * 2), @"Bad edgeCount: %lu", (unsigned long)edgeCount);
+		
+		for (NSString *parentKey in @[ parentKeys[0], parentKeys[parentCount / 2], parentKeys[parentCount - 1] ])
+		{
+			edgeCount = [[transaction ext:@"relationship"] edgeCountWithName:@"child"
+			                                                       sourceKey:parentKey
+			                                                      collection:nil];
+			XCTAssertTrue(edgeCount == 2, @"Bad edgeCount: %lu", (unsigned long)edgeCount);
+		}
+	}];
+	
+	// Delete rules must work as usual
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeObjectForKey:parentKeys[0] inCollection:nil];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSUInteger count = [transaction numberOfKeysInCollection:nil];
+		XCTAssertTrue(count == ((parentCount - 1) * 3), @"Bad count: %lu", (unsigned long)count);
+	}];
+}
+
 - (void)testProtocol_Inverse
 {
 	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
@@ -4405,4 +4485,671 @@
 	XCTAssert([Node_NotifyCount notifyCount] == 1);
 }
 
+/**
+ * The source-deleted notify path must hand the destination an edge with the correct
+ * sourceKey & destinationKey, even when the edge was read from disk (without keys).
+**/
+- (void)testDeleteAndNotify_edgeKeys
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database);
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseRelationship *relationship = [[YapDatabaseRelationship alloc] init];
+	
+	BOOL registered = [database registerExtension:relationship withName:@"relationship"];
+	
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	__block NSString *parentKey = nil;
+	__block NSString *childKey = nil;
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		Node_NotifyCount *child = [[Node_NotifyCount alloc] init];
+		childKey = child.key;
+		
+		Node_Notify *parent = [[Node_Notify alloc] init];
+		parent.child = child.key;
+		parentKey = parent.key;
+		
+		[transaction setObject:parent forKey:parent.key inCollection:nil];
+		[transaction setObject:child forKey:child.key inCollection:nil];
+	}];
+	
+	NSUInteger notifyCount = [Node_NotifyCount notifyCount];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeObjectForKey:parentKey inCollection:nil];
+	}];
+	
+	XCTAssert([Node_NotifyCount notifyCount] == (notifyCount + 1));
+	
+	YapDatabaseRelationshipEdge *edge = [Node_NotifyCount lastNotifyEdge];
+	
+	XCTAssertEqualObjects(edge.name, @"child");
+	XCTAssertEqualObjects(edge.sourceKey, parentKey);
+	XCTAssertEqualObjects(edge.destinationKey, childKey);
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertFalse([transaction hasObjectForKey:childKey inCollection:nil]);
+		XCTAssert([[transaction ext:@"relationship"] edgeCountWithName:@"child"] == 0);
+	}];
+}
+
+/**
+ * Cascading deletes are processed in passes during flush.
+ * Each node deleted by a rule is picked up in the following pass.
+**/
+- (void)testCascadeDelete
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database);
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseRelationship *relationship = [[YapDatabaseRelationship alloc] init];
+	
+	BOOL registered = [database registerExtension:relationship withName:@"relationship"];
+	
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// key1 -> key2 -> key3 -> key4 -> shared
+	//                                   ^
+	//                         other ----|
+	//
+	// The chain uses DeleteDestinationIfSourceDeleted.
+	// The edges into shared use DeleteDestinationIfAllSourcesDeleted.
+	
+	NSArray<NSString *> *chain = @[ @"key1", @"key2", @"key3", @"key4" ];
+	
+	YapDatabaseRelationshipEdge* (^EdgeFromTo)(NSString *, NSString *, NSString *, YDB_NodeDeleteRules) =
+	^(NSString *name, NSString *src, NSString *dst, YDB_NodeDeleteRules rules){
+		
+		return [YapDatabaseRelationshipEdge edgeWithName:name
+		                                       sourceKey:src
+		                                      collection:nil
+		                                  destinationKey:dst
+		                                      collection:nil
+		                                 nodeDeleteRules:rules];
+	};
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSString *key in chain)
+		{
+			[transaction setObject:key forKey:key inCollection:nil];
+		}
+		[transaction setObject:@"shared" forKey:@"shared" inCollection:nil];
+		[transaction setObject:@"other" forKey:@"other" inCollection:nil];
+		
+		for (NSUInteger i = 1; i < chain.count; i++)
+		{
+			[[transaction ext:@"relationship"] addEdge:
+			  EdgeFromTo(@"child", chain[i-1], chain[i], YDB_DeleteDestinationIfSourceDeleted)];
+		}
+		
+		[[transaction ext:@"relationship"] addEdge:
+		  EdgeFromTo(@"shared", @"key4", @"shared", YDB_DeleteDestinationIfAllSourcesDeleted)];
+		[[transaction ext:@"relationship"] addEdge:
+		  EdgeFromTo(@"shared", @"other", @"shared", YDB_DeleteDestinationIfAllSourcesDeleted)];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssert([[transaction ext:@"relationship"] edgeCountWithName:@"child"] == 3);
+		XCTAssert([[transaction ext:@"relationship"] edgeCountWithName:@"shared"] == 2);
+	}];
+	
+	// Deleting the head of the chain takes 4 passes:
+	// key1 -> key2 -> key3 -> key4 -> (shared survives, as other is still a source)
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeObjectForKey:@"key1" inCollection:nil];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		for (NSString *key in chain)
+		{
+			XCTAssertFalse([transaction hasObjectForKey:key inCollection:nil], @"key: %@", key);
+		}
+		XCTAssertTrue([transaction hasObjectForKey:@"shared" inCollection:nil]);
+		XCTAssertTrue([transaction hasObjectForKey:@"other" inCollection:nil]);
+		
+		XCTAssert([[transaction ext:@"relationship"] edgeCountWithName:@"child"] == 0);
+		XCTAssert([[transaction ext:@"relationship"] edgeCountWithName:@"shared"] == 1);
+	}];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeObjectForKey:@"other" inCollection:nil];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertFalse([transaction hasObjectForKey:@"shared" inCollection:nil]);
+		XCTAssert([[transaction ext:@"relationship"] edgeCountWithName:@"shared"] == 0);
+	}];
+}
+
+/**
+ * A node deleted by a rule in one pass, while a sibling is deleted explicitly in the same
+ * transaction, must not keep a DeleteDestinationIfAllSourcesDeleted destination alive.
+**/
+- (void)testCascadeDelete_allSourcesAcrossPasses
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database);
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseRelationship *relationship = [[YapDatabaseRelationship alloc] init];
+	
+	BOOL registered = [database registerExtension:relationship withName:@"relationship"];
+	
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// root -> mid -> shared
+	//                  ^
+	// leaf ------------|
+	//
+	// root->mid uses DeleteDestinationIfSourceDeleted.
+	// The edges into shared use DeleteDestinationIfAllSourcesDeleted.
+	//
+	// Deleting root & leaf together: leaf is processed in the first pass (along with root),
+	// and mid in the second pass. Shared must be deleted in the second pass.
+	
+	NSArray<NSString *> *keys = @[ @"root", @"mid", @"leaf", @"shared" ];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSString *key in keys)
+		{
+			[transaction setObject:key forKey:key inCollection:nil];
+		}
+		
+		YapDatabaseRelationshipEdge *edge;
+		
+		edge = [YapDatabaseRelationshipEdge edgeWithName:@"child"
+		                                       sourceKey:@"root"
+		                                      collection:nil
+		                                  destinationKey:@"mid"
+		                                      collection:nil
+		                                 nodeDeleteRules:YDB_DeleteDestinationIfSourceDeleted];
+		[[transaction ext:@"relationship"] addEdge:edge];
+		
+		edge = [YapDatabaseRelationshipEdge edgeWithName:@"shared"
+		                                       sourceKey:@"mid"
+		                                      collection:nil
+		                                  destinationKey:@"shared"
+		                                      collection:nil
+		                                 nodeDeleteRules:YDB_DeleteDestinationIfAllSourcesDeleted];
+		[[transaction ext:@"relationship"] addEdge:edge];
+		
+		edge = [YapDatabaseRelationshipEdge edgeWithName:@"shared"
+		                                       sourceKey:@"leaf"
+		                                      collection:nil
+		                                  destinationKey:@"shared"
+		                                      collection:nil
+		                                 nodeDeleteRules:YDB_DeleteDestinationIfAllSourcesDeleted];
+		[[transaction ext:@"relationship"] addEdge:edge];
+	}];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeObjectForKey:@"root" inCollection:nil];
+		[transaction removeObjectForKey:@"leaf" inCollection:nil];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		for (NSString *key in keys)
+		{
+			XCTAssertFalse([transaction hasObjectForKey:key inCollection:nil], @"key: %@", key);
+		}
+		
+		XCTAssert([[transaction ext:@"relationship"] edgeCountWithName:@"child"] == 0);
+		XCTAssert([[transaction ext:@"relationship"] edgeCountWithName:@"shared"] == 0);
+	}];
+}
+
+- (void)testTraversal
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database);
+	
+	YapDatabaseConnection *connection1 = [database newConnection];
+	YapDatabaseConnection *connection2 = [database newConnection];
+	
+	YapDatabaseRelationshipOptions *options = [[YapDatabaseRelationshipOptions alloc] init];
+	options.adjacencyCacheEdgeNames = [NSSet setWithObject:@"child"];
+	
+	YapDatabaseRelationship *relationship = [[YapDatabaseRelationship alloc] initWithVersionTag:nil options:options];
+	
+	BOOL registered = [database registerExtension:relationship withName:@"relationship"];
+	
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// key1 -> key2 -> key3 -> key4
+	//           ^               |
+	//           |_______________|
+	
+	NSArray<NSString *> *keys = @[ @"key1", @"key2", @"key3", @"key4" ];
+	
+	YapDatabaseRelationshipEdge* (^EdgeFromTo)(NSString *, NSString *) = ^(NSString *src, NSString *dst){
+		
+		return [YapDatabaseRelationshipEdge edgeWithName:@"child"
+		                                       sourceKey:src
+		                                      collection:nil
+		                                  destinationKey:dst
+		                                      collection:nil
+		                                 nodeDeleteRules:0];
+	};
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSString *key in keys)
+		{
+			[transaction setObject:key forKey:key inCollection:nil];
+		}
+		
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"key1", @"key2")];
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"key2", @"key3")];
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"key3", @"key4")];
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"key4", @"key2")];
+		
+		// Pending (un-flushed) changes use the regular enumeration
+		
+		NSUInteger count = [[transaction ext:@"relationship"] reachableNodeCountFromKey:@"key1"
+		                                                                     collection:nil
+		                                                                  withEdgeNames:@[ @"child" ]
+		                                                                      direction:YDB_TraversalDirectionOutgoing
+		                                                                       maxDepth:0];
+		XCTAssertTrue(count == 3);
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSMutableDictionary<NSString*, NSNumber*> *depths = [NSMutableDictionary dictionary];
+		
+		[[transaction ext:@"relationship"] enumerateNodesReachableFromKey:@"key1"
+		                                                       collection:nil
+		                                                    withEdgeNames:@[ @"child" ]
+		                                                        direction:YDB_TraversalDirectionOutgoing
+		                                                            order:YDB_TraversalOrderBreadthFirst
+		                                                         maxDepth:0
+		                                                       usingBlock:
+		    ^(NSString *key, NSString *collection, NSUInteger depth, BOOL *stop)
+		{
+			XCTAssertNil(depths[key]);
+			depths[key] = @(depth);
+		}];
+		
+		XCTAssertTrue(depths.count == 3);
+		XCTAssertTrue([depths[@"key2"] unsignedIntegerValue] == 1);
+		XCTAssertTrue([depths[@"key3"] unsignedIntegerValue] == 2);
+		XCTAssertTrue([depths[@"key4"] unsignedIntegerValue] == 3);
+		
+		NSUInteger count;
+		
+		count = [[transaction ext:@"relationship"] reachableNodeCountFromKey:@"key1"
+		                                                          collection:nil
+		                                                       withEdgeNames:@[ @"child" ]
+		                                                           direction:YDB_TraversalDirectionOutgoing
+		                                                            maxDepth:2];
+		XCTAssertTrue(count == 2);
+		
+		count = [[transaction ext:@"relationship"] reachableNodeCountFromKey:@"key4"
+		                                                          collection:nil
+		                                                       withEdgeNames:@[ @"child" ]
+		                                                           direction:YDB_TraversalDirectionIncoming
+		                                                            maxDepth:0];
+		XCTAssertTrue(count == 3); // key3, key2, key1
+		
+		XCTAssertTrue([[transaction ext:@"relationship"] isNodeWithKey:@"key4" collection:nil
+		                                              reachableFromKey:@"key1" collection:nil
+		                                                 withEdgeNames:@[ @"child" ]
+		                                                      maxDepth:0]);
+		
+		XCTAssertFalse([[transaction ext:@"relationship"] isNodeWithKey:@"key1" collection:nil
+		                                               reachableFromKey:@"key4" collection:nil
+		                                                  withEdgeNames:@[ @"child" ]
+		                                                       maxDepth:0]);
+	}];
+	
+	// Changes from other connections must be reflected in the in-memory graph
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"relationship"] removeEdgeWithName:@"child"
+		                                            sourceKey:@"key2"
+		                                           collection:nil
+		                                       destinationKey:@"key3"
+		                                           collection:nil
+		                                       withProcessing:YDB_EdgeDeleted];
+		
+		[transaction setObject:@"key5" forKey:@"key5" inCollection:nil];
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"key2", @"key5")];
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSMutableArray<NSString *> *reachable = [NSMutableArray array];
+		
+		[[transaction ext:@"relationship"] enumerateNodesReachableFromKey:@"key1"
+		                                                       collection:nil
+		                                                    withEdgeNames:@[ @"child" ]
+		                                                        direction:YDB_TraversalDirectionOutgoing
+		                                                            order:YDB_TraversalOrderDepthFirst
+		                                                         maxDepth:0
+		                                                       usingBlock:
+		    ^(NSString *key, NSString *collection, NSUInteger depth, BOOL *stop)
+		{
+			[reachable addObject:key];
+		}];
+		
+		XCTAssertTrue(reachable.count == 2);
+		XCTAssertTrue([reachable containsObject:@"key2"]);
+		XCTAssertTrue([reachable containsObject:@"key5"]);
+	}];
+}
+
+- (void)testRecursiveQueries
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database);
+	
+	YapDatabaseConnection *connection1 = [database newConnection];
+	YapDatabaseConnection *connection2 = [database newConnection];
+	
+	YapDatabaseRelationship *relationship = [[YapDatabaseRelationship alloc] init];
+	
+	BOOL registered = [database registerExtension:relationship withName:@"relationship"];
+	
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// Edges point from child to parent:
+	//
+	// root <- a <- a1
+	// root <- a <- a2 <- b2
+	// root <- b <- b1 <- b2
+	//
+	// (b2 has 2 parents: a2 & b1)
+	
+	YapDatabaseRelationshipEdge* (^EdgeFromTo)(NSString *, NSString *) = ^(NSString *src, NSString *dst){
+		
+		return [YapDatabaseRelationshipEdge edgeWithName:@"parent"
+		                                       sourceKey:src
+		                                      collection:nil
+		                                  destinationKey:dst
+		                                      collection:nil
+		                                 nodeDeleteRules:0];
+	};
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (NSString *key in @[ @"root", @"a", @"b", @"a1", @"a2", @"b1", @"b2" ])
+		{
+			[transaction setObject:key forKey:key inCollection:nil];
+		}
+		
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"a",  @"root")];
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"b",  @"root")];
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"a1", @"a")];
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"a2", @"a")];
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"b1", @"b")];
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"b2", @"b1")];
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"b2", @"a2")];
+		
+		// Pending (un-flushed) changes use the regular traversal
+		
+		NSArray<YapCollectionKey *> *path =
+		  [[transaction ext:@"relationship"] shortestPathFromKey:@"b2" collection:nil
+		                                                   toKey:@"root" collection:nil
+		                                             viaEdgeName:@"parent"
+		                                                maxDepth:0];
+		XCTAssertTrue(path.count == 4);
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		// Descendants (incoming edges)
+		
+		NSMutableDictionary<NSString*, NSNumber*> *depths = [NSMutableDictionary dictionary];
+		
+		[[transaction ext:@"relationship"] enumerateKeysReachableFromKey:@"root"
+		                                                      collection:nil
+		                                                     viaEdgeName:@"parent"
+		                                                       direction:YDB_TraversalDirectionIncoming
+		                                                        maxDepth:0
+		                                                      usingBlock:
+		    ^(NSString *key, NSString *collection, NSUInteger depth, BOOL *stop)
+		{
+			XCTAssertNil(depths[key]);
+			depths[key] = @(depth);
+		}];
+		
+		XCTAssertTrue(depths.count == 6);
+		XCTAssertTrue([depths[@"a"]  unsignedIntegerValue] == 1);
+		XCTAssertTrue([depths[@"b"]  unsignedIntegerValue] == 1);
+		XCTAssertTrue([depths[@"a2"] unsignedIntegerValue] == 2);
+		XCTAssertTrue([depths[@"b2"] unsignedIntegerValue] == 3);
+		
+		[depths removeAllObjects];
+		
+		[[transaction ext:@"relationship"] enumerateKeysReachableFromKey:@"root"
+		                                                      collection:nil
+		                                                     viaEdgeName:@"parent"
+		                                                       direction:YDB_TraversalDirectionIncoming
+		                                                        maxDepth:2
+		                                                      usingBlock:
+		    ^(NSString *key, NSString *collection, NSUInteger depth, BOOL *stop)
+		{
+			depths[key] = @(depth);
+		}];
+		
+		XCTAssertTrue(depths.count == 5);
+		XCTAssertNil(depths[@"b2"]);
+		
+		// Ancestors (outgoing edges)
+		
+		NSMutableSet<NSString *> *ancestors = [NSMutableSet set];
+		
+		[[transaction ext:@"relationship"] enumerateKeysReachableFromKey:@"b2"
+		                                                      collection:nil
+		                                                     viaEdgeName:@"parent"
+		                                                       direction:YDB_TraversalDirectionOutgoing
+		                                                        maxDepth:0
+		                                                      usingBlock:
+		    ^(NSString *key, NSString *collection, NSUInteger depth, BOOL *stop)
+		{
+			[ancestors addObject:key];
+		}];
+		
+		NSSet *expected = [NSSet setWithObjects:@"b1", @"b", @"a2", @"a", @"root", nil];
+		XCTAssertTrue([ancestors isEqualToSet:expected]);
+		
+		// Shortest path
+		
+		NSArray<YapCollectionKey *> *path =
+		  [[transaction ext:@"relationship"] shortestPathFromKey:@"b2" collection:nil
+		                                                   toKey:@"root" collection:nil
+		                                             viaEdgeName:@"parent"
+		                                                maxDepth:0];
+		
+		XCTAssertTrue(path.count == 4);
+		XCTAssertTrue([path.firstObject.key isEqualToString:@"b2"]);
+		XCTAssertTrue([path.lastObject.key isEqualToString:@"root"]);
+		
+		path = [[transaction ext:@"relationship"] shortestPathFromKey:@"b2" collection:nil
+		                                                        toKey:@"root" collection:nil
+		                                                  viaEdgeName:@"parent"
+		                                                     maxDepth:2];
+		XCTAssertNil(path);
+		
+		path = [[transaction ext:@"relationship"] shortestPathFromKey:@"root" collection:nil
+		                                                        toKey:@"b2" collection:nil
+		                                                  viaEdgeName:@"parent"
+		                                                     maxDepth:0];
+		XCTAssertNil(path);
+	}];
+	
+	// Cycles must terminate
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[[transaction ext:@"relationship"] addEdge:EdgeFromTo(@"root", @"b2")];
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		__block NSUInteger count = 0;
+		
+		[[transaction ext:@"relationship"] enumerateKeysReachableFromKey:@"root"
+		                                                      collection:nil
+		                                                     viaEdgeName:@"parent"
+		                                                       direction:YDB_TraversalDirectionOutgoing
+		                                                        maxDepth:0
+		                                                      usingBlock:
+		    ^(NSString *key, NSString *collection, NSUInteger depth, BOOL *stop)
+		{
+			count++;
+		}];
+		
+		XCTAssertTrue(count == 5); // b2, b1, a2, b, a (the starting node isn't reported)
+	}];
+}
+
+/**
+ * Densely connected graph (every node points to every other node).
+ * Each node must be reported once, at its shortest depth.
+**/
+- (void)testRecursiveQueries_cycles
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database);
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseRelationship *relationship = [[YapDatabaseRelationship alloc] init];
+	
+	BOOL registered = [database registerExtension:relationship withName:@"relationship"];
+	
+	XCTAssertTrue(registered, @"Error registering extension");
+	
+	// start -> node0 <-> node1 <-> ... <-> node49 (all pairs)
+	
+	NSUInteger nodeCount = 50;
+	
+	NSMutableArray<NSString *> *keys = [NSMutableArray arrayWithCapacity:nodeCount];
+	for (NSUInteger i = 0; i < nodeCount; i++)
+	{
+		[keys addObject:[NSString stringWithFormat:@"node%lu", (unsigned long)i]];
+	}
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@"start" forKey:@"start" inCollection:nil];
+		
+		for (NSString *key in keys)
+		{
+			[transaction setObject:key forKey:key inCollection:nil];
+		}
+		
+		YapDatabaseRelationshipEdge *edge =
+		  [YapDatabaseRelationshipEdge edgeWithName:@"link"
+		                                  sourceKey:@"start"
+		                                 collection:nil
+		                             destinationKey:keys[0]
+		                                 collection:nil
+		                            nodeDeleteRules:0];
+		[[transaction ext:@"relationship"] addEdge:edge];
+		
+		for (NSString *src in keys)
+		{
+			for (NSString *dst in keys)
+			{
+				if ([src isEqualToString:dst]) continue;
+				
+				edge = [YapDatabaseRelationshipEdge edgeWithName:@"link"
+				                                       sourceKey:src
+				                                      collection:nil
+				                                  destinationKey:dst
+				                                      collection:nil
+				                                 nodeDeleteRules:0];
+				[[transaction ext:@"relationship"] addEdge:edge];
+			}
+		}
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		NSMutableDictionary<NSString*, NSNumber*> *depths = [NSMutableDictionary dictionary];
+		__block NSUInteger nestedCount = 0;
+		
+		[[transaction ext:@"relationship"] enumerateKeysReachableFromKey:@"start"
+		                                                      collection:nil
+		                                                     viaEdgeName:@"link"
+		                                                       direction:YDB_TraversalDirectionOutgoing
+		                                                        maxDepth:0
+		                                                      usingBlock:
+		    ^(NSString *key, NSString *collection, NSUInteger depth, BOOL *stop)
+		{
+			XCTAssertNil(depths[key]);
+			depths[key] = @(depth);
+			
+			if (depths.count == 1)
+			{
+				// Nested query (from within the enumeration block)
+				
+				[[transaction ext:@"relationship"] enumerateKeysReachableFromKey:key
+				                                                      collection:nil
+				                                                     viaEdgeName:@"link"
+				                                                       direction:YDB_TraversalDirectionOutgoing
+				                                                        maxDepth:0
+				                                                      usingBlock:
+				    ^(NSString *key, NSString *collection, NSUInteger depth, BOOL *stop)
+				{
+					nestedCount++;
+				}];
+			}
+		}];
+		
+		XCTAssertTrue(depths.count == nodeCount);
+		XCTAssertTrue([depths[keys[0]] unsignedIntegerValue] == 1);
+		XCTAssertTrue([depths[keys[nodeCount-1]] unsignedIntegerValue] == 2);
+		
+		XCTAssertTrue(nestedCount == (nodeCount - 1));
+	}];
+}
+
 @end
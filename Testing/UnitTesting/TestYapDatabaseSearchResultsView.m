@@ -311,6 +311,124 @@
 	[self _testWithDatabase:database options:searchViewOptions];
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Query Refinement
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)test2_refinement_small
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[self _test2_refinementWithURL:databaseURL count:100];
+}
+
+- (void)test2_refinement_large
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	// Enough rows that the refinement runs the new query against the index (rather than checking each row)
+	[self _test2_refinementWithURL:databaseURL count:5000];
+}
+
+- (void)_test2_refinementWithURL:(NSURL *)databaseURL count:(NSUInteger)count
+{
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	// Setup FTS
+	
+	YapDatabaseFullTextSearchHandler *handler = [YapDatabaseFullTextSearchHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object){
+		
+		[dict setObject:object forKey:@"content"];
+	}];
+	
+	YapDatabaseFullTextSearch *fts =
+	  [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"]
+	                                                 handler:handler
+	                                              versionTag:@"1"];
+	
+	BOOL registerResult1 = [database registerExtension:fts withName:@"fts"];
+	XCTAssertTrue(registerResult1, @"Failure registering fts extension");
+	
+	// Setup SearchResultsView
+	
+	YapDatabaseViewGrouping *grouping = [YapDatabaseViewGrouping withKeyBlock:
+	    ^NSString *(YapDatabaseReadTransaction *transaction, NSString *collection, NSString *key)
+	{
+		return @"";
+	}];
+	
+	YapDatabaseViewSorting *sorting = [YapDatabaseViewSorting withKeyBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSString *group,
+	        NSString *collection1, NSString *key1,
+	        NSString *collection2, NSString *key2)
+	{
+		return [key1 compare:key2 options:NSNumericSearch];
+	}];
+	
+	YapDatabaseSearchResultsView *searchResultsView =
+	  [[YapDatabaseSearchResultsView alloc] initWithFullTextSearchName:@"fts"
+	                                                          grouping:grouping
+	                                                           sorting:sorting
+	                                                        versionTag:@"1"
+	                                                           options:nil];
+	
+	BOOL registerResult2 = [database registerExtension:searchResultsView withName:@"searchResults"];
+	XCTAssertTrue(registerResult2, @"Failure registering searchResults extension");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		NSArray *words = @[ @"cat", @"cats", @"catalog", @"car", @"cart", @"dog", @"dogs", @"door" ];
+		
+		for (NSUInteger i = 0; i < count; i++)
+		{
+			NSString *phrase = [NSString stringWithFormat:@"%@ %@ %@",
+			                    words[i % [words count]],
+			                    words[(i / 3) % [words count]],
+			                    words[(i / 7) % [words count]]];
+			
+			[transaction setObject:phrase forKey:[NSString stringWithFormat:@"%lu", (unsigned long)i] inCollection:nil];
+		}
+	}];
+	
+	// Simulate search-as-you-type, including widening (backspace) & non-refinements.
+	
+	NSArray<NSString *> *queries = @[
+	  @"c*", @"ca*", @"cat*", @"cats", @"cats dog*", @"cats dogs", @"cats", @"ca*", @"car*", @"door", @"do*"
+	];
+	
+	for (NSString *query in queries)
+	{
+		[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+			
+			[[transaction ext:@"searchResults"] performSearchFor:query];
+		}];
+		
+		[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+			
+			NSMutableSet *expected = [NSMutableSet set];
+			[[transaction ext:@"fts"] enumerateKeysMatching:query
+			                                     usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+				[expected addObject:key];
+			}];
+			
+			NSMutableSet *actual = [NSMutableSet set];
+			[[transaction ext:@"searchResults"] enumerateKeysInGroup:@""
+			                                              usingBlock:^(NSString *collection, NSString *key, NSUInteger index, BOOL *stop) {
+				[actual addObject:key];
+			}];
+			
+			XCTAssertTrue([expected count] > 0, @"Bad test data for query: %@", query);
+			XCTAssertEqualObjects(actual, expected, @"Mismatch for query: %@", query);
+		}];
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Test Logic
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -2,6 +2,8 @@
 
 #import "YapDatabase.h"
 #import "YapDatabaseSecondaryIndex.h"
+#import "YapDatabaseFullTextSearch.h"
+#import "YapDatabaseAutoView.h"
 
 #import "TestObject.h"
 
@@ -459,4 +461,1130 @@
 	}];
 }
 
+
+- (void)testCompositeIndexes
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	__block NSUInteger handlerCount = 0;
+	
+	YapDatabaseSecondaryIndexHandler *handler = [YapDatabaseSecondaryIndexHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object)
+	{
+		__unsafe_unretained NSDictionary *message = (NSDictionary *)object;
+		
+		dict[@"accountId"] = message[@"accountId"];
+		dict[@"unread"]    = message[@"unread"];
+		dict[@"date"]      = message[@"date"];
+		dict[@"subject"]   = message[@"subject"];
+		
+		handlerCount++;
+	}];
+	
+	YapDatabaseSecondaryIndexSetup *setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
+	[setup addColumn:@"accountId" withType:YapDatabaseSecondaryIndexTypeInteger indexed:NO];
+	[setup addColumn:@"unread" withType:YapDatabaseSecondaryIndexTypeInteger indexed:NO];
+	[setup addColumn:@"date" withType:YapDatabaseSecondaryIndexTypeReal indexed:NO];
+	[setup addColumn:@"subject" withType:YapDatabaseSecondaryIndexTypeText];
+	
+	[setup addIndexWithName:@"test_account_unread_date" columns:@[ @"accountId", @"unread", @"date" ]];
+	
+	XCTAssertTrue([[setup indexes] count] == 1);
+	
+	YapDatabaseSecondaryIndex *secondaryIndex =
+	  [[YapDatabaseSecondaryIndex alloc] initWithSetup:setup handler:handler versionTag:@"1"];
+	
+	XCTAssertTrue([database registerExtension:secondaryIndex withName:@"idx"]);
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (int i = 0; i < 100; i++)
+		{
+			NSDictionary *message = @{
+			  @"accountId" : @(i % 4),
+			  @"unread"    : @((i % 3) == 0 ? 1 : 0),
+			  @"date"      : @(i),
+			  @"subject"   : [NSString stringWithFormat:@"subject %d", i]
+			};
+			
+			[transaction setObject:message forKey:[NSString stringWithFormat:@"%d", i] inCollection:@"messages"];
+		}
+	}];
+	
+	XCTAssertTrue(handlerCount == 100);
+	
+	NSArray* (^UnreadKeys)(YapDatabaseReadTransaction *) = ^NSArray* (YapDatabaseReadTransaction *transaction){
+		
+		NSMutableArray *keys = [NSMutableArray array];
+		
+		YapDatabaseQuery *query =
+		  [YapDatabaseQuery queryWithFormat:@"WHERE accountId = ? AND unread = 1 ORDER BY date DESC", @(1)];
+		
+		[[transaction ext:@"idx"] enumerateKeysMatchingQuery:query usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+			[keys addObject:key];
+		}];
+		
+		return keys;
+	};
+	
+	NSMutableArray *expectedKeys = [NSMutableArray array];
+	for (int i = 99; i >= 0; i--)
+	{
+		if ((i % 4) == 1 && (i % 3) == 0) {
+			[expectedKeys addObject:[NSString stringWithFormat:@"%d", i]];
+		}
+	}
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertEqualObjects(UnreadKeys(transaction), expectedKeys);
+		
+		YapDatabaseQuery *query =
+		  [YapDatabaseQuery queryWithFormat:@"WHERE accountId = ? AND unread = 1 ORDER BY date DESC", @(1)];
+		
+		NSString *plan = [[transaction ext:@"idx"] queryPlanForQuery:query];
+		
+		XCTAssertTrue([plan rangeOfString:@"test_account_unread_date"].location != NSNotFound, @"plan: %@", plan);
+		XCTAssertTrue([plan rangeOfString:@"TEMP B-TREE"].location == NSNotFound, @"plan: %@", plan);
+		
+		// Columns added with indexed:NO don't get their own index
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE date > ?", @(50)];
+		plan = [[transaction ext:@"idx"] queryPlanForQuery:query];
+		
+		XCTAssertTrue([plan rangeOfString:@"INDEX date"].location == NSNotFound, @"plan: %@", plan);
+		
+		// Columns added with the default are still indexed
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE subject = ?", @"subject 7"];
+		plan = [[transaction ext:@"idx"] queryPlanForQuery:query];
+		
+		XCTAssertTrue([plan rangeOfString:@"INDEX subject"].location != NSNotFound, @"plan: %@", plan);
+		
+		// Invalid query
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE nonExistentColumn = 1"];
+		XCTAssertNil([[transaction ext:@"idx"] queryPlanForQuery:query]);
+	}];
+	
+	//
+	// Re-open the database with a different set of indexes (but the same versionTag).
+	// The indexes should be migrated, without re-populating the table.
+	//
+	
+	connection = nil;
+	secondaryIndex = nil;
+	database = nil;
+	
+	for (int i = 0; i < 100 && database == nil; i++)
+	{
+		// Wait for the previous database instance to be deallocated
+		if (i > 0) [NSThread sleepForTimeInterval:0.05];
+		
+		database = [[YapDatabase alloc] initWithURL:databaseURL];
+	}
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	connection = [database newConnection];
+	handlerCount = 0;
+	
+	setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
+	[setup addColumn:@"accountId" withType:YapDatabaseSecondaryIndexTypeInteger indexed:NO];
+	[setup addColumn:@"unread" withType:YapDatabaseSecondaryIndexTypeInteger indexed:NO];
+	[setup addColumn:@"date" withType:YapDatabaseSecondaryIndexTypeReal indexed:NO];
+	[setup addColumn:@"subject" withType:YapDatabaseSecondaryIndexTypeText indexed:NO];
+	
+	[setup addIndexWithName:@"test_unread_by_date"
+	                columns:@[ @"accountId", @"date" ]
+	        coveringColumns:@[ @"subject" ]
+	              predicate:@"unread = 1"];
+	
+	secondaryIndex = [[YapDatabaseSecondaryIndex alloc] initWithSetup:setup handler:handler versionTag:@"1"];
+	
+	XCTAssertTrue([database registerExtension:secondaryIndex withName:@"idx"]);
+	XCTAssertTrue(handlerCount == 0);
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertEqualObjects(UnreadKeys(transaction), expectedKeys);
+		
+		YapDatabaseQuery *query =
+		  [YapDatabaseQuery queryWithFormat:@"WHERE accountId = ? AND unread = 1 ORDER BY date DESC", @(1)];
+		
+		NSString *plan = [[transaction ext:@"idx"] queryPlanForQuery:query];
+		
+		XCTAssertTrue([plan rangeOfString:@"test_unread_by_date"].location != NSNotFound, @"plan: %@", plan);
+		XCTAssertTrue([plan rangeOfString:@"TEMP B-TREE"].location == NSNotFound, @"plan: %@", plan);
+		
+		// The partial index only applies if the query implies the predicate
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE accountId = ? ORDER BY date DESC", @(1)];
+		plan = [[transaction ext:@"idx"] queryPlanForQuery:query];
+		
+		XCTAssertTrue([plan rangeOfString:@"test_unread_by_date"].location == NSNotFound, @"plan: %@", plan);
+		
+		// The removed indexes are gone
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE subject = ?", @"subject 7"];
+		plan = [[transaction ext:@"idx"] queryPlanForQuery:query];
+		
+		XCTAssertTrue([plan rangeOfString:@"INDEX subject"].location == NSNotFound, @"plan: %@", plan);
+	}];
+}
+
+
+- (void)testPendingChanges
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseSecondaryIndexSetup *setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
+	[setup addColumn:@"value" withType:YapDatabaseSecondaryIndexTypeInteger];
+	[setup addColumn:@"name" withType:YapDatabaseSecondaryIndexTypeText];
+	
+	YapDatabaseSecondaryIndexHandler *handler = [YapDatabaseSecondaryIndexHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object)
+	{
+		if (![object isKindOfClass:[NSDictionary class]]) return;
+		
+		__unsafe_unretained NSDictionary *item = (NSDictionary *)object;
+		
+		dict[@"value"] = item[@"value"];
+		dict[@"name"]  = item[@"name"];
+	}];
+	
+	YapDatabaseSecondaryIndex *secondaryIndex =
+	  [[YapDatabaseSecondaryIndex alloc] initWithSetup:setup handler:handler];
+	
+	XCTAssertTrue([database registerExtension:secondaryIndex withName:@"idx"]);
+	
+	NSUInteger (^Count)(YapDatabaseReadTransaction *, YapDatabaseQuery *) =
+	  ^NSUInteger (YapDatabaseReadTransaction *transaction, YapDatabaseQuery *query)
+	{
+		NSUInteger count = 0;
+		[[transaction ext:@"idx"] getNumberOfRows:&count matchingQuery:query];
+		return count;
+	};
+	
+	YapDatabaseQuery *allQuery = [YapDatabaseQuery queryMatchingAll];
+	YapDatabaseQuery *bigQuery = [YapDatabaseQuery queryWithFormat:@"WHERE value >= ?", @(100)];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (int i = 0; i < 10; i++)
+		{
+			NSString *key = [NSString stringWithFormat:@"%d", i];
+			
+			// Multiple changes to the same row within a transaction
+			
+			[transaction setObject:@{ @"value":@(i), @"name":@"a" } forKey:key inCollection:nil];
+			[transaction setObject:@{ @"value":@(i * 100), @"name":@"b" } forKey:key inCollection:nil];
+		}
+		
+		// Insert & remove within the same transaction
+		
+		[transaction setObject:@{ @"value":@(1000), @"name":@"temp" } forKey:@"temp" inCollection:nil];
+		[transaction removeObjectForKey:@"temp" inCollection:nil];
+		
+		// Queries within the transaction must see the changes
+		
+		XCTAssertTrue(Count(transaction, allQuery) == 10);
+		XCTAssertTrue(Count(transaction, bigQuery) == 9);
+		
+		// And changes made after a query
+		
+		[transaction setObject:@{ @"value":@(1), @"name":@"c" } forKey:@"9" inCollection:nil];
+		XCTAssertTrue(Count(transaction, bigQuery) == 8);
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue(Count(transaction, allQuery) == 10);
+		XCTAssertTrue(Count(transaction, bigQuery) == 8);
+		
+		YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:@"WHERE name = ?", @"b"];
+		XCTAssertTrue(Count(transaction, query) == 9);
+	}];
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		// Unchanged values (the write is skipped)
+		
+		[transaction setObject:@{ @"value":@(100), @"name":@"b" } forKey:@"1" inCollection:nil];
+		
+		// Remove, then re-add (the same rowid may be re-used)
+		
+		[transaction removeObjectForKey:@"2" inCollection:nil];
+		[transaction setObject:@{ @"value":@(2), @"name":@"d" } forKey:@"2" inCollection:nil];
+		
+		// Changed to a value that isn't indexed (the row is removed from the index)
+		
+		[transaction setObject:@"not a dictionary" forKey:@"3" inCollection:nil];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue(Count(transaction, allQuery) == 9);
+		XCTAssertTrue(Count(transaction, bigQuery) == 6);
+		
+		YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:@"WHERE name = ?", @"d"];
+		XCTAssertTrue(Count(transaction, query) == 1);
+	}];
+	
+	// Rolled back changes are discarded
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@{ @"value":@(5000), @"name":@"e" } forKey:@"4" inCollection:nil];
+		[transaction removeObjectForKey:@"5" inCollection:nil];
+		
+		[transaction rollback];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue(Count(transaction, allQuery) == 9);
+		XCTAssertTrue(Count(transaction, bigQuery) == 6);
+	}];
+}
+
+- (void)testNonPersistent
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection1 = [database newConnection];
+	YapDatabaseConnection *connection2 = [database newConnection];
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		// Objects that exist before the extension is registered (populate)
+		
+		for (int i = 0; i < 500; i++)
+		{
+			NSString *key = [NSString stringWithFormat:@"%d", i];
+			NSString *name = (i % 2) ? @"odd" : @"even";
+			
+			[transaction setObject:@{ @"value":@(i), @"name":name } forKey:key inCollection:nil];
+		}
+	}];
+	
+	YapDatabaseSecondaryIndexSetup *setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
+	[setup addColumn:@"value" withType:YapDatabaseSecondaryIndexTypeInteger];
+	[setup addColumn:@"name" withType:YapDatabaseSecondaryIndexTypeText];
+	
+	YapDatabaseSecondaryIndexHandler *handler = [YapDatabaseSecondaryIndexHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object)
+	{
+		if (![object isKindOfClass:[NSDictionary class]]) return;
+		
+		__unsafe_unretained NSDictionary *item = (NSDictionary *)object;
+		
+		dict[@"value"] = item[@"value"];
+		dict[@"name"]  = item[@"name"];
+	}];
+	
+	YapDatabaseSecondaryIndexOptions *options = [[YapDatabaseSecondaryIndexOptions alloc] init];
+	options.isPersistent = NO;
+	
+	YapDatabaseSecondaryIndex *secondaryIndex =
+	  [[YapDatabaseSecondaryIndex alloc] initWithSetup:setup handler:handler versionTag:nil options:options];
+	
+	XCTAssertTrue([database registerExtension:secondaryIndex withName:@"idx"]);
+	
+	NSUInteger (^Count)(YapDatabaseReadTransaction *, YapDatabaseQuery *) =
+	  ^NSUInteger (YapDatabaseReadTransaction *transaction, YapDatabaseQuery *query)
+	{
+		NSUInteger count = 0;
+		XCTAssertTrue([[transaction ext:@"idx"] getNumberOfRows:&count matchingQuery:query]);
+		return count;
+	};
+	
+	NSArray<NSString *> *(^Keys)(YapDatabaseReadTransaction *, YapDatabaseQuery *) =
+	  ^NSArray<NSString *> *(YapDatabaseReadTransaction *transaction, YapDatabaseQuery *query)
+	{
+		NSMutableArray<NSString *> *keys = [NSMutableArray array];
+		BOOL result = [[transaction ext:@"idx"] enumerateKeysMatchingQuery:query
+		                                                        usingBlock:^(NSString *collection, NSString *key, BOOL *stop)
+		{
+			[keys addObject:key];
+		}];
+		
+		XCTAssertTrue(result);
+		return keys;
+	};
+	
+	[connection1 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		YapDatabaseQuery *query = nil;
+		
+		query = [YapDatabaseQuery queryMatchingAll];
+		XCTAssertTrue(Count(transaction, query) == 500);
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE value = ?", @(42)];
+		XCTAssertEqualObjects(Keys(transaction, query), @[ @"42" ]);
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE value >= ? AND value < ? AND name = ?", @(100), @(200), @"odd"];
+		XCTAssertTrue(Count(transaction, query) == 50);
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE value IN (?)", @[ @(1), @(3), @(1000) ]];
+		XCTAssertTrue(Count(transaction, query) == 2);
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE name = ? ORDER BY value DESC LIMIT 3", @"even"];
+		XCTAssertEqualObjects(Keys(transaction, query), (@[ @"498", @"496", @"494" ]));
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE value BETWEEN ? AND ? ORDER BY value LIMIT 2 OFFSET 1", @(10), @(20)];
+		XCTAssertEqualObjects(Keys(transaction, query), (@[ @"11", @"12" ]));
+		
+		query = [YapDatabaseQuery queryWithAggregateFunction:@"SUM(value)" format:@"WHERE value < ?", @(10)];
+		XCTAssertTrue([[[transaction ext:@"idx"] performAggregateQuery:query] integerValue] == 45);
+		
+		query = [YapDatabaseQuery queryWithAggregateFunction:@"MAX(value)" format:@"WHERE name = ?", @"odd"];
+		XCTAssertTrue([[[transaction ext:@"idx"] performAggregateQuery:query] integerValue] == 499);
+		
+		NSMutableArray *values = [NSMutableArray array];
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE value > ? ORDER BY value", @(496)];
+		
+		[[transaction ext:@"idx"] enumerateIndexedValuesInColumn:@"value"
+		                                           matchingQuery:query
+		                                              usingBlock:^(id indexedValue, BOOL *stop)
+		{
+			[values addObject:indexedValue];
+		}];
+		XCTAssertEqualObjects(values, (@[ @(497), @(498), @(499) ]));
+		
+		// Query plan
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE value > ?", @(10)];
+		NSString *plan = [[transaction ext:@"idx"] queryPlanForQuery:query];
+		XCTAssertTrue([plan hasPrefix:@"SEARCH MEMORY INDEX value"], @"plan: %@", plan);
+		
+		// Queries outside the supported subset fail (instead of returning incorrect results)
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE value > ? OR name = ?", @(10), @"odd"];
+		BOOL result = [[transaction ext:@"idx"] enumerateKeysMatchingQuery:query
+		                                                        usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {}];
+		XCTAssertFalse(result);
+	}];
+	
+	// Snapshot isolation: connection2 sees the old state until its next transaction
+	
+	[connection2 beginLongLivedReadTransaction];
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@{ @"value":@(1000), @"name":@"odd" } forKey:@"42" inCollection:nil];
+		[transaction removeObjectForKey:@"43" inCollection:nil];
+		[transaction setObject:@{ @"value":@(2000), @"name":@"new" } forKey:@"new" inCollection:nil];
+		
+		// Changes are visible within the transaction
+		
+		YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:@"WHERE value >= ?", @(1000)];
+		XCTAssertEqualObjects(Keys(transaction, query), (@[ @"42", @"new" ]));
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:@"WHERE value >= ?", @(1000)];
+		XCTAssertTrue(Count(transaction, query) == 0);
+		XCTAssertTrue(Count(transaction, [YapDatabaseQuery queryMatchingAll]) == 500);
+	}];
+	
+	[connection2 endLongLivedReadTransaction];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:@"WHERE value >= ? ORDER BY value", @(1000)];
+		XCTAssertEqualObjects(Keys(transaction, query), (@[ @"42", @"new" ]));
+		XCTAssertTrue(Count(transaction, [YapDatabaseQuery queryMatchingAll]) == 500);
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE value = ?", @(43)];
+		XCTAssertTrue(Count(transaction, query) == 0);
+	}];
+	
+	// Rolled back changes are discarded
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeAllObjectsInAllCollections];
+		[transaction rollback];
+	}];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertTrue(Count(transaction, [YapDatabaseQuery queryMatchingAll]) == 500);
+	}];
+}
+
+- (void)testPreparedQuery
+{
+	[self _testPreparedQueryPersistent:YES];
+	[self _testPreparedQueryPersistent:NO];
+}
+
+- (void)_testPreparedQueryPersistent:(BOOL)isPersistent
+{
+	NSString *suffix = [NSString stringWithFormat:@"%@-%d", NSStringFromSelector(_cmd), isPersistent];
+	NSURL *databaseURL = [self databaseURL:suffix];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseSecondaryIndexSetup *setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
+	[setup addColumn:@"value" withType:YapDatabaseSecondaryIndexTypeInteger];
+	[setup addColumn:@"name" withType:YapDatabaseSecondaryIndexTypeText];
+	
+	YapDatabaseSecondaryIndexHandler *handler = [YapDatabaseSecondaryIndexHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object)
+	{
+		if (![object isKindOfClass:[NSDictionary class]]) return;
+		
+		__unsafe_unretained NSDictionary *item = (NSDictionary *)object;
+		
+		dict[@"value"] = item[@"value"];
+		dict[@"name"]  = item[@"name"];
+	}];
+	
+	YapDatabaseSecondaryIndexOptions *options = [[YapDatabaseSecondaryIndexOptions alloc] init];
+	options.isPersistent = isPersistent;
+	
+	YapDatabaseSecondaryIndex *secondaryIndex =
+	  [[YapDatabaseSecondaryIndex alloc] initWithSetup:setup handler:handler versionTag:nil options:options];
+	
+	XCTAssertTrue([database registerExtension:secondaryIndex withName:@"idx"]);
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (int i = 0; i < 100; i++)
+		{
+			NSString *key = [NSString stringWithFormat:@"%d", i];
+			NSString *name = (i % 2) ? @"odd" : @"even";
+			
+			[transaction setObject:@{ @"value":@(i), @"name":name } forKey:key inCollection:nil];
+		}
+	}];
+	
+	YapDatabaseSecondaryIndexQueryBuilder *builder = [[YapDatabaseSecondaryIndexQueryBuilder alloc] init];
+	
+	NSUInteger nameIdx  = [builder whereEqual:@"name"];
+	NSUInteger valueIdx = [builder whereRange:@"value" inclusive:NO];
+	[builder orderBy:@"value" ascending:NO];
+	[builder limit:3];
+	
+	XCTAssertTrue(nameIdx == 0);
+	XCTAssertTrue(valueIdx == 1);
+	XCTAssertTrue(builder.numberOfParameters == 3);
+	
+	YapDatabaseSecondaryIndexPreparedQuery *rangeQuery = [builder preparedQuery];
+	
+	XCTAssertEqualObjects(rangeQuery.queryString,
+	  @"WHERE \"name\" = ? AND \"value\" >= ? AND \"value\" < ? ORDER BY \"value\" DESC LIMIT 3");
+	
+	builder = [[YapDatabaseSecondaryIndexQueryBuilder alloc] init];
+	NSUInteger inIdx = [builder whereIn:@"value" count:3];
+	[builder orderBy:@"value" ascending:YES];
+	
+	YapDatabaseSecondaryIndexPreparedQuery *inQuery = [builder preparedQuery];
+	
+	// An empty IN matches nothing (in either mode), and may be combined with other constraints
+	
+	builder = [[YapDatabaseSecondaryIndexQueryBuilder alloc] init];
+	NSUInteger emptyIdx = [builder whereIn:@"value" count:0];
+	NSUInteger emptyNameIdx = [builder whereEqual:@"name"];
+	
+	XCTAssertTrue(emptyIdx == 0);
+	XCTAssertTrue(emptyNameIdx == 0);
+	
+	YapDatabaseSecondaryIndexPreparedQuery *emptyInQuery = [builder preparedQuery];
+	
+	NSArray<NSString *> *(^Keys)(YapDatabaseReadTransaction *, YapDatabaseSecondaryIndexPreparedQuery *) =
+	  ^NSArray<NSString *> *(YapDatabaseReadTransaction *transaction, YapDatabaseSecondaryIndexPreparedQuery *query)
+	{
+		NSMutableArray<NSString *> *keys = [NSMutableArray array];
+		BOOL result = [[transaction ext:@"idx"] enumerateKeysMatchingPreparedQuery:query
+		                                                                usingBlock:^(NSString *collection, NSString *key, BOOL *stop)
+		{
+			[keys addObject:key];
+		}];
+		
+		XCTAssertTrue(result);
+		return keys;
+	};
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		[rangeQuery setText:@"even" forParameterAtIndex:nameIdx];
+		[rangeQuery setInteger:10 forParameterAtIndex:valueIdx];
+		[rangeQuery setInteger:20 forParameterAtIndex:(valueIdx + 1)];
+		
+		XCTAssertEqualObjects(Keys(transaction, rangeQuery), (@[ @"18", @"16", @"14" ]));
+		
+		// Count ignores ORDER BY & LIMIT
+		
+		NSUInteger count = 0;
+		XCTAssertTrue([[transaction ext:@"idx"] getNumberOfRows:&count matchingPreparedQuery:rangeQuery]);
+		XCTAssertTrue(count == 5);
+		
+		// Reuse with different values (and types)
+		
+		[rangeQuery setText:@"odd" forParameterAtIndex:nameIdx];
+		[rangeQuery setDouble:90.5 forParameterAtIndex:valueIdx];
+		[rangeQuery setInteger:1000 forParameterAtIndex:(valueIdx + 1)];
+		
+		XCTAssertEqualObjects(Keys(transaction, rangeQuery), (@[ @"99", @"97", @"95" ]));
+		
+		// Unset (NULL) parameters never match
+		
+		[rangeQuery clearParameters];
+		XCTAssertTrue(Keys(transaction, rangeQuery).count == 0);
+		
+		[inQuery setInteger:7 forParameterAtIndex:inIdx];
+		[inQuery setInteger:3 forParameterAtIndex:(inIdx + 1)];
+		[inQuery setInteger:500 forParameterAtIndex:(inIdx + 2)];
+		
+		XCTAssertEqualObjects(Keys(transaction, inQuery), (@[ @"3", @"7" ]));
+		
+		[emptyInQuery setText:@"odd" forParameterAtIndex:emptyNameIdx];
+		
+		XCTAssertTrue(Keys(transaction, emptyInQuery).count == 0);
+		
+		count = NSNotFound;
+		XCTAssertTrue([[transaction ext:@"idx"] getNumberOfRows:&count matchingPreparedQuery:emptyInQuery]);
+		XCTAssertTrue(count == 0);
+	}];
+	
+	// Changes made within a transaction are visible to prepared queries
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@{ @"value":@(500), @"name":@"odd" } forKey:@"new" inCollection:nil];
+		[transaction removeObjectForKey:@"3" inCollection:nil];
+		
+		XCTAssertEqualObjects(Keys(transaction, inQuery), (@[ @"7", @"new" ]));
+	}];
+	
+	// Flushing the statements (e.g. due to a memory warning) just means the query gets compiled again
+	
+	[connection flushMemoryWithFlags:YapDatabaseConnectionFlushMemoryFlags_All];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertEqualObjects(Keys(transaction, inQuery), (@[ @"7", @"new" ]));
+	}];
+}
+
+- (void)testAggregateIntegerOverflow
+{
+	[self _testAggregateIntegerOverflowPersistent:YES];
+	[self _testAggregateIntegerOverflowPersistent:NO];
+}
+
+- (void)_testAggregateIntegerOverflowPersistent:(BOOL)isPersistent
+{
+	NSString *suffix = [NSString stringWithFormat:@"%@-%d", NSStringFromSelector(_cmd), isPersistent];
+	NSURL *databaseURL = [self databaseURL:suffix];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	YapDatabaseSecondaryIndexSetup *setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
+	[setup addColumn:@"value" withType:YapDatabaseSecondaryIndexTypeInteger];
+	
+	YapDatabaseSecondaryIndexHandler *handler = [YapDatabaseSecondaryIndexHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object)
+	{
+		dict[@"value"] = object;
+	}];
+	
+	YapDatabaseSecondaryIndexOptions *options = [[YapDatabaseSecondaryIndexOptions alloc] init];
+	options.isPersistent = isPersistent;
+	
+	YapDatabaseSecondaryIndex *secondaryIndex =
+	  [[YapDatabaseSecondaryIndex alloc] initWithSetup:setup handler:handler versionTag:nil options:options];
+	
+	XCTAssertTrue([database registerExtension:secondaryIndex withName:@"idx"]);
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@(INT64_MAX) forKey:@"max" inCollection:nil];
+		[transaction setObject:@(1) forKey:@"1" inCollection:nil];
+		[transaction setObject:@(2) forKey:@"2" inCollection:nil];
+	}];
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		YapDatabaseQuery *query = nil;
+		
+		// SUM() fails on integer overflow (same as sqlite)
+		
+		query = [YapDatabaseQuery queryWithAggregateFunction:@"SUM(value)" string:@"" parameters:nil];
+		XCTAssertNil([[transaction ext:@"idx"] performAggregateQuery:query]);
+		
+		query = [YapDatabaseQuery queryWithAggregateFunction:@"SUM(value)" format:@"WHERE value < ?", @(10)];
+		XCTAssertEqualObjects([[transaction ext:@"idx"] performAggregateQuery:query], @(3));
+		
+		query = [YapDatabaseQuery queryWithAggregateFunction:@"SUM(value)" format:@"WHERE value > ?", @(1)];
+		XCTAssertNil([[transaction ext:@"idx"] performAggregateQuery:query]);
+		
+		// TOTAL() & AVG() are floating point, and don't overflow
+		
+		query = [YapDatabaseQuery queryWithAggregateFunction:@"TOTAL(value)" string:@"" parameters:nil];
+		XCTAssertEqualWithAccuracy([[[transaction ext:@"idx"] performAggregateQuery:query] doubleValue],
+		                           (double)INT64_MAX + 3.0, 1.0e5);
+		
+		query = [YapDatabaseQuery queryWithAggregateFunction:@"AVG(value)" string:@"" parameters:nil];
+		XCTAssertEqualWithAccuracy([[[transaction ext:@"idx"] performAggregateQuery:query] doubleValue],
+		                           ((double)INT64_MAX + 3.0) / 3.0, 1.0e5);
+	}];
+}
+
+- (void)testJoinedQuery
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	// Secondary index
+	
+	YapDatabaseSecondaryIndexSetup *setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
+	[setup addColumn:@"value" withType:YapDatabaseSecondaryIndexTypeInteger];
+	[setup addColumn:@"name" withType:YapDatabaseSecondaryIndexTypeText];
+	
+	YapDatabaseSecondaryIndexHandler *handler = [YapDatabaseSecondaryIndexHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object)
+	{
+		__unsafe_unretained NSDictionary *item = (NSDictionary *)object;
+		
+		dict[@"value"] = item[@"value"];
+		dict[@"name"]  = item[@"name"];
+	}];
+	
+	YapDatabaseSecondaryIndex *secondaryIndex =
+	  [[YapDatabaseSecondaryIndex alloc] initWithSetup:setup handler:handler];
+	
+	XCTAssertTrue([database registerExtension:secondaryIndex withName:@"idx"]);
+	
+	// Full text search
+	
+	YapDatabaseFullTextSearchHandler *ftsHandler = [YapDatabaseFullTextSearchHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object)
+	{
+		__unsafe_unretained NSDictionary *item = (NSDictionary *)object;
+		
+		dict[@"content"] = item[@"text"];
+	}];
+	
+	YapDatabaseFullTextSearch *fts =
+	  [[YapDatabaseFullTextSearch alloc] initWithColumnNames:@[@"content"] handler:ftsHandler];
+	
+	XCTAssertTrue([database registerExtension:fts withName:@"fts"]);
+	
+	// View (sorted by value, descending)
+	
+	YapDatabaseViewGrouping *grouping = [YapDatabaseViewGrouping withObjectBlock:
+	    ^NSString *(YapDatabaseReadTransaction *transaction, NSString *collection, NSString *key, id object)
+	{
+		__unsafe_unretained NSDictionary *item = (NSDictionary *)object;
+		
+		return ([item[@"value"] integerValue] < 20) ? @"inbox" : @"archive";
+	}];
+	
+	YapDatabaseViewSorting *sorting = [YapDatabaseViewSorting withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSString *group,
+	        NSString *collection1, NSString *key1, id obj1,
+	        NSString *collection2, NSString *key2, id obj2)
+	{
+		__unsafe_unretained NSDictionary *item1 = (NSDictionary *)obj1;
+		__unsafe_unretained NSDictionary *item2 = (NSDictionary *)obj2;
+		
+		return [item2[@"value"] compare:item1[@"value"]];
+	}];
+	
+	YapDatabaseAutoView *view = [[YapDatabaseAutoView alloc] initWithGrouping:grouping sorting:sorting];
+	
+	XCTAssertTrue([database registerExtension:view withName:@"order"]);
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (int i = 0; i < 40; i++)
+		{
+			NSString *key = [NSString stringWithFormat:@"%d", i];
+			NSString *name = (i % 2) ? @"odd" : @"even";
+			NSString *text = (i % 3) ? @"message receipt" : @"message invoice";
+			
+			[transaction setObject:@{ @"value":@(i), @"name":name, @"text":text } forKey:key inCollection:nil];
+		}
+	}];
+	
+	NSArray<NSString *> *(^Keys)(YapDatabaseReadTransaction *, YapDatabaseSecondaryIndexJoinedQuery *) =
+	  ^NSArray<NSString *> *(YapDatabaseReadTransaction *transaction, YapDatabaseSecondaryIndexJoinedQuery *query)
+	{
+		NSMutableArray<NSString *> *keys = [NSMutableArray array];
+		BOOL result = [[transaction ext:@"idx"] enumerateKeysMatchingJoinedQuery:query
+		                                                              usingBlock:^(NSString *collection, NSString *key, BOOL *stop)
+		{
+			[keys addObject:key];
+		}];
+		
+		XCTAssertTrue(result);
+		return keys;
+	};
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:@"WHERE name = ? ORDER BY idx.value ASC", @"even"];
+		YapDatabaseSecondaryIndexJoinedQuery *joinedQuery = [[YapDatabaseSecondaryIndexJoinedQuery alloc] initWithQuery:query];
+		
+		// Secondary index + full text search
+		
+		joinedQuery.fullTextSearchName = @"fts";
+		joinedQuery.fullTextSearchMatch = @"invoice";
+		
+		XCTAssertEqualObjects(Keys(transaction, joinedQuery), (@[ @"0", @"6", @"12", @"18", @"24", @"30", @"36" ]));
+		
+		// + view membership
+		
+		joinedQuery.viewName = @"order";
+		joinedQuery.viewGroup = @"inbox";
+		
+		XCTAssertEqualObjects(Keys(transaction, joinedQuery), (@[ @"0", @"6", @"12", @"18" ]));
+		
+		// + view order & limit
+		
+		joinedQuery.sortByViewOrder = YES;
+		joinedQuery.limit = 2;
+		
+		XCTAssertEqualObjects(Keys(transaction, joinedQuery), (@[ @"18", @"12" ]));
+		
+		// Secondary index + view (without full text search)
+		
+		query = [YapDatabaseQuery queryWithFormat:@"WHERE value >= ?", @(16)];
+		joinedQuery = [[YapDatabaseSecondaryIndexJoinedQuery alloc] initWithQuery:query];
+		joinedQuery.viewName = @"order";
+		joinedQuery.viewGroup = @"inbox";
+		joinedQuery.sortByViewOrder = YES;
+		
+		XCTAssertEqualObjects(Keys(transaction, joinedQuery), (@[ @"19", @"18", @"17", @"16" ]));
+		
+		// Unknown extension
+		
+		joinedQuery.viewName = @"nonexistent";
+		
+		BOOL result = [[transaction ext:@"idx"] enumerateKeysMatchingJoinedQuery:joinedQuery
+		                                                              usingBlock:^(NSString *collection, NSString *key, BOOL *stop)
+		{
+			XCTFail(@"Unexpected result");
+		}];
+		XCTAssertFalse(result);
+	}];
+	
+	// Changes made within a transaction are visible to joined queries
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction setObject:@{ @"value":@(3), @"name":@"even", @"text":@"invoice" } forKey:@"new" inCollection:nil];
+		[transaction removeObjectForKey:@"6" inCollection:nil];
+		
+		YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:@"WHERE name = ? ORDER BY idx.value ASC", @"even"];
+		YapDatabaseSecondaryIndexJoinedQuery *joinedQuery = [[YapDatabaseSecondaryIndexJoinedQuery alloc] initWithQuery:query];
+		joinedQuery.fullTextSearchName = @"fts";
+		joinedQuery.fullTextSearchMatch = @"invoice";
+		joinedQuery.viewName = @"order";
+		joinedQuery.viewGroup = @"inbox";
+		
+		XCTAssertEqualObjects(Keys(transaction, joinedQuery), (@[ @"0", @"new", @"12", @"18" ]));
+	}];
+}
+
+- (void)testAggregates
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection1 = [database newConnection];
+	YapDatabaseConnection *connection2 = [database newConnection];
+	
+	YapDatabaseSecondaryIndexSetup *setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
+	[setup addColumn:@"folder" withType:YapDatabaseSecondaryIndexTypeText];
+	[setup addColumn:@"unread" withType:YapDatabaseSecondaryIndexTypeInteger];
+	[setup addColumn:@"size" withType:YapDatabaseSecondaryIndexTypeReal];
+	
+	[setup addAggregateWithName:@"countPerFolder"
+	                   function:YapDatabaseSecondaryIndexAggregateFunctionCount
+	                     column:nil
+	              groupByColumn:@"folder"];
+	[setup addAggregateWithName:@"unreadPerFolder"
+	                   function:YapDatabaseSecondaryIndexAggregateFunctionSum
+	                     column:@"unread"
+	              groupByColumn:@"folder"];
+	[setup addAggregateWithName:@"minSizePerFolder"
+	                   function:YapDatabaseSecondaryIndexAggregateFunctionMin
+	                     column:@"size"
+	              groupByColumn:@"folder"];
+	[setup addAggregateWithName:@"maxSizePerFolder"
+	                   function:YapDatabaseSecondaryIndexAggregateFunctionMax
+	                     column:@"size"
+	              groupByColumn:@"folder"];
+	
+	YapDatabaseSecondaryIndexHandler *handler = [YapDatabaseSecondaryIndexHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object)
+	{
+		__unsafe_unretained NSDictionary *item = (NSDictionary *)object;
+		
+		dict[@"folder"] = item[@"folder"];
+		dict[@"unread"] = item[@"unread"];
+		dict[@"size"]   = item[@"size"];
+	}];
+	
+	YapDatabaseSecondaryIndex *secondaryIndex = [[YapDatabaseSecondaryIndex alloc] initWithSetup:setup handler:handler];
+	
+	XCTAssertTrue([database registerExtension:secondaryIndex withName:@"idx"]);
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		// inbox   : 0 ..< 6 (unread: 1, 3, 5)
+		// archive : 6 ..< 10
+		
+		for (int i = 0; i < 10; i++)
+		{
+			NSString *key = [NSString stringWithFormat:@"%d", i];
+			NSString *folder = (i < 6) ? @"inbox" : @"archive";
+			
+			[transaction setObject:@{ @"folder":folder, @"unread":@(i % 2), @"size":@(i * 1.5) }
+			                forKey:key
+			          inCollection:nil];
+		}
+		
+		// No folder (not part of any group)
+		[transaction setObject:@{ @"unread":@(1), @"size":@(100) } forKey:@"draft" inCollection:nil];
+		
+		// Changes within the transaction are visible
+		XCTAssertEqualObjects([[transaction ext:@"idx"] valueForAggregate:@"countPerFolder" group:@"inbox"], @(6));
+	}];
+	
+	[connection2 beginLongLivedReadTransaction];
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertEqualObjects([[transaction ext:@"idx"] valueForAggregate:@"countPerFolder" group:@"inbox"], @(6));
+		XCTAssertEqualObjects([[transaction ext:@"idx"] valueForAggregate:@"countPerFolder" group:@"archive"], @(4));
+		XCTAssertEqualObjects([[transaction ext:@"idx"] valueForAggregate:@"unreadPerFolder" group:@"inbox"], @(3));
+		XCTAssertEqualObjects([[transaction ext:@"idx"] valueForAggregate:@"minSizePerFolder" group:@"inbox"], @(0.0));
+		XCTAssertEqualObjects([[transaction ext:@"idx"] valueForAggregate:@"maxSizePerFolder" group:@"inbox"], @(7.5));
+		XCTAssertNil([[transaction ext:@"idx"] valueForAggregate:@"countPerFolder" group:@"spam"]);
+		
+		NSMutableDictionary *counts = [NSMutableDictionary dictionary];
+		[[transaction ext:@"idx"] enumerateValuesForAggregate:@"countPerFolder"
+		                                           usingBlock:^(id group, NSNumber *value, BOOL *stop)
+		{
+			counts[group] = value;
+		}];
+		XCTAssertEqualObjects(counts, (@{ @"inbox":@(6), @"archive":@(4) }));
+	}];
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		// Move the largest inbox item to the archive (inbox max must be recalculated)
+		[transaction setObject:@{ @"folder":@"archive", @"unread":@(1), @"size":@(7.5) } forKey:@"5" inCollection:nil];
+		
+		// Remove the smallest inbox item (inbox min must be recalculated)
+		[transaction removeObjectForKey:@"0" inCollection:nil];
+		
+		// Mark an archived item as read
+		[transaction setObject:@{ @"folder":@"archive", @"unread":@(0), @"size":@(10.5) } forKey:@"7" inCollection:nil];
+	}];
+	
+	NSArray *notifications = [connection2 beginLongLivedReadTransaction];
+	
+	NSSet *changedFolders = [[connection2 ext:@"idx"] changedGroupsForAggregate:@"countPerFolder"
+	                                                            inNotifications:notifications];
+	XCTAssertEqualObjects(changedFolders, ([NSSet setWithObjects:@"inbox", @"archive", nil]));
+	
+	XCTAssertTrue([[connection2 ext:@"idx"] hasChangesForAggregate:@"unreadPerFolder"
+	                                                          group:@"archive"
+	                                                inNotifications:notifications]);
+	XCTAssertFalse([[connection2 ext:@"idx"] hasChangesForAggregate:@"countPerFolder"
+	                                                           group:@"spam"
+	                                                 inNotifications:notifications]);
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		YapDatabaseSecondaryIndexTransaction *idx = [transaction ext:@"idx"];
+		
+		XCTAssertEqualObjects([idx valueForAggregate:@"countPerFolder" group:@"inbox"], @(4));
+		XCTAssertEqualObjects([idx valueForAggregate:@"countPerFolder" group:@"archive"], @(5));
+		XCTAssertEqualObjects([idx valueForAggregate:@"unreadPerFolder" group:@"inbox"], @(2));
+		XCTAssertEqualObjects([idx valueForAggregate:@"unreadPerFolder" group:@"archive"], @(2));
+		XCTAssertEqualObjects([idx valueForAggregate:@"minSizePerFolder" group:@"inbox"], @(1.5));
+		XCTAssertEqualObjects([idx valueForAggregate:@"maxSizePerFolder" group:@"inbox"], @(6.0));
+		XCTAssertEqualObjects([idx valueForAggregate:@"minSizePerFolder" group:@"archive"], @(7.5));
+		
+		// Incremental values match a full aggregate query
+		
+		YapDatabaseQuery *query =
+		  [YapDatabaseQuery queryWithAggregateFunction:@"SUM(unread)" format:@"WHERE folder = ?", @"archive"];
+		
+		XCTAssertEqualObjects([idx performAggregateQuery:query], [idx valueForAggregate:@"unreadPerFolder" group:@"archive"]);
+	}];
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		// Only affects unreadPerFolder
+		[transaction setObject:@{ @"folder":@"archive", @"unread":@(1), @"size":@(10.5) } forKey:@"7" inCollection:nil];
+	}];
+	
+	notifications = [connection2 beginLongLivedReadTransaction];
+	
+	XCTAssertTrue([[connection2 ext:@"idx"] hasChangesForAggregate:@"unreadPerFolder"
+	                                                          group:@"archive"
+	                                                inNotifications:notifications]);
+	XCTAssertFalse([[connection2 ext:@"idx"] hasChangesForAggregate:@"countPerFolder"
+	                                                           group:@"archive"
+	                                                 inNotifications:notifications]);
+	XCTAssertFalse([[connection2 ext:@"idx"] hasChangesForAggregate:@"maxSizePerFolder"
+	                                                           group:@"archive"
+	                                                 inNotifications:notifications]);
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertEqualObjects([[transaction ext:@"idx"] valueForAggregate:@"unreadPerFolder" group:@"archive"], @(3));
+	}];
+	
+	[connection1 readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		[transaction removeAllObjectsInAllCollections];
+	}];
+	
+	notifications = [connection2 beginLongLivedReadTransaction];
+	
+	changedFolders = [[connection2 ext:@"idx"] changedGroupsForAggregate:@"maxSizePerFolder"
+	                                                     inNotifications:notifications];
+	XCTAssertEqualObjects(changedFolders, ([NSSet setWithObjects:@"inbox", @"archive", nil]));
+	
+	[connection2 readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertNil([[transaction ext:@"idx"] valueForAggregate:@"countPerFolder" group:@"inbox"]);
+		XCTAssertNil([[transaction ext:@"idx"] valueForAggregate:@"maxSizePerFolder" group:@"archive"]);
+	}];
+}
+
+- (void)testAggregatesMigration
+{
+	NSURL *databaseURL = [self databaseURL:NSStringFromSelector(_cmd)];
+	
+	[[NSFileManager defaultManager] removeItemAtURL:databaseURL error:NULL];
+	YapDatabase *database = [[YapDatabase alloc] initWithURL:databaseURL];
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	YapDatabaseConnection *connection = [database newConnection];
+	
+	__block NSUInteger handlerCount = 0;
+	
+	YapDatabaseSecondaryIndexSetup *setup = [[YapDatabaseSecondaryIndexSetup alloc] init];
+	[setup addColumn:@"value" withType:YapDatabaseSecondaryIndexTypeInteger];
+	[setup addColumn:@"name" withType:YapDatabaseSecondaryIndexTypeText];
+	
+	YapDatabaseSecondaryIndexHandler *handler = [YapDatabaseSecondaryIndexHandler withObjectBlock:
+	    ^(YapDatabaseReadTransaction *transaction, NSMutableDictionary *dict, NSString *collection, NSString *key, id object)
+	{
+		__unsafe_unretained NSDictionary *item = (NSDictionary *)object;
+		
+		dict[@"value"] = item[@"value"];
+		dict[@"name"]  = item[@"name"];
+		
+		handlerCount++;
+	}];
+	
+	YapDatabaseSecondaryIndex *secondaryIndex =
+	  [[YapDatabaseSecondaryIndex alloc] initWithSetup:setup handler:handler versionTag:@"1"];
+	
+	XCTAssertTrue([database registerExtension:secondaryIndex withName:@"idx"]);
+	
+	[connection readWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		for (int i = 0; i < 10; i++)
+		{
+			NSString *key = [NSString stringWithFormat:@"%d", i];
+			NSString *name = (i % 2) ? @"odd" : @"even";
+			
+			[transaction setObject:@{ @"value":@(i), @"name":name } forKey:key inCollection:nil];
+		}
+	}];
+	
+	//
+	// Re-open the database with an aggregate (but the same versionTag).
+	// The aggregate should be built from the existing table, without re-populating it.
+	//
+	
+	connection = nil;
+	secondaryIndex = nil;
+	database = nil;
+	
+	for (int i = 0; i < 100 && database == nil; i++)
+	{
+		// Wait for the previous database instance to be deallocated
+		if (i > 0) [NSThread sleepForTimeInterval:0.05];
+		
+		database = [[YapDatabase alloc] initWithURL:databaseURL];
+	}
+	
+	XCTAssertNotNil(database, @"Oops");
+	
+	connection = [database newConnection];
+	handlerCount = 0;
+	
+	[setup addAggregateWithName:@"sumPerName"
+	                   function:YapDatabaseSecondaryIndexAggregateFunctionSum
+	                     column:@"value"
+	              groupByColumn:@"name"];
+	
+	secondaryIndex = [[YapDatabaseSecondaryIndex alloc] initWithSetup:setup handler:handler versionTag:@"1"];
+	
+	XCTAssertTrue([database registerExtension:secondaryIndex withName:@"idx"]);
+	
+	[connection readWithBlock:^(YapDatabaseReadTransaction *transaction) {
+		
+		XCTAssertEqualObjects([[transaction ext:@"idx"] valueForAggregate:@"sumPerName" group:@"even"], @(20));
+		XCTAssertEqualObjects([[transaction ext:@"idx"] valueForAggregate:@"sumPerName" group:@"odd"], @(25));
+	}];
+	
+	XCTAssertTrue(handlerCount == 0);
+}
+
 @end
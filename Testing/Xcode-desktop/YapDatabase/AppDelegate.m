@@ -2,6 +2,10 @@
 
 #import "BenchmarkYapCache.h"
 #import "BenchmarkYapDatabase.h"
+#import "BenchmarkYapDatabaseRelationship.h"
+#import "BenchmarkYapDatabaseFullTextSearch.h"
+#import "BenchmarkYapDatabaseRTreeIndex.h"
+#import "BenchmarkYDBCKChangeQueue.h"
 
 #import <YapDatabase/YapDatabase.h>
 #import <YapDatabase/YapDatabaseFilteredView.h>
@@ -29,13 +33,22 @@
 	dispatch_after(popTime, dispatch_get_main_queue(), ^(void){
 		
 		[BenchmarkYapDatabase runTestsWithCompletion:^{
-		#pragma clang diagnostic push
-		#pragma clang diagnostic ignored "-Wimplicit-retain-self"
 			
-			databaseBenchmarksButton.enabled = YES;
-			cacheBenchmarksButton.enabled = YES;
-			
-		#pragma clang diagnostic pop
+			[BenchmarkYapDatabaseRelationship runTestsWithCompletion:^{
+				
+				[BenchmarkYapDatabaseFullTextSearch runTestsWithCompletion:^{
+					
+					[BenchmarkYapDatabaseRTreeIndex runTestsWithCompletion:^{
+					#pragma clang diagnostic push
+					#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+						
+						databaseBenchmarksButton.enabled = YES;
+						cacheBenchmarksButton.enabled = YES;
+						
+					#pragma clang diagnostic pop
+					}];
+				}];
+			}];
 		}];
 	});
 }
@@ -50,13 +63,16 @@
 	dispatch_after(popTime, dispatch_get_main_queue(), ^(void){
 		
 		[BenchmarkYapCache runTestsWithCompletion:^{
-		#pragma clang diagnostic push
-		#pragma clang diagnostic ignored "-Wimplicit-retain-self"
-			
-			databaseBenchmarksButton.enabled = YES;
-			cacheBenchmarksButton.enabled = YES;
 			
-		#pragma clang diagnostic pop
+			[BenchmarkYDBCKChangeQueue runTestsWithCompletion:^{
+			#pragma clang diagnostic push
+			#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+				
+				databaseBenchmarksButton.enabled = YES;
+				cacheBenchmarksButton.enabled = YES;
+				
+			#pragma clang diagnostic pop
+			}];
 		}];
 	});
 }
@@ -14,6 +14,8 @@
 - (instancetype)initWithSnapshot:(uint64_t)snapshot
                       operations:(NSArray<YapDatabaseCloudCoreOperation *> *)operations;
 
+- (instancetype)initPendingRestoreWithSnapshot:(uint64_t)snapshot;
+
 @property (nonatomic, assign, readonly) uint64_t snapshot;
 @property (nonatomic, copy, readonly) NSArray<YapDatabaseCloudCoreOperation *> *operations;
 
@@ -29,12 +31,29 @@
  */
 @property (nonatomic, weak, readwrite) YapDatabaseCloudCoreGraph *previousGraph;
 
-- (void)insertOperations:(NSArray<YapDatabaseCloudCoreOperation *> *)insertedOperations
+/**
+ * When YapDatabaseCloudCoreOptions.restoreGraphLimit is used, graphs beyond the limit are
+ * restored lazily. Until then, the pipeline holds a placeholder graph (with the proper snapshot),
+ * and this property is YES.
+ */
+@property (nonatomic, assign, readonly) BOOL pendingRestore;
+
+- (NSArray<YapDatabaseCloudCoreOperation *> *)restoreOperations:(NSArray<YapDatabaseCloudCoreOperation *> *)operations;
+
+- (BOOL)insertOperations:(NSArray<YapDatabaseCloudCoreOperation *> *)insertedOperations
         modifyOperations:(NSDictionary<NSUUID *, YapDatabaseCloudCoreOperation *> *)modifiedOperations
                 modified:(NSMutableArray<YapDatabaseCloudCoreOperation *> *)matchedModifiedOperations;
 
 - (NSArray *)removeCompletedAndSkippedOperations;
 
+/**
+ * The graph maintains a ready queue (operations whose dependencies have all completed or been skipped).
+ * The pipeline must inform every graph when an operation transitions to completed or skipped,
+ * since (in FlatGraph mode) operations in later graphs may depend on it.
+ */
+- (void)didFinishOperationWithUUID:(NSUUID *)opUUID;
+- (void)invalidateReadyQueue;
+
 - (YapDatabaseCloudCoreOperation *)nextReadyOperation:(NSNumber *)minPriority;
 
 @end
@@ -64,4 +64,18 @@ NS_INLINE BOOL YDB_IsEqualOrBothNil(id obj1, id obj2)
 
 - (void)clearTransactionVariables;
 
+#pragma mark Binary Encoding
+
+/**
+ * Compact (versioned) binary encoding, used by [YapDatabaseCloudCore binaryOperationSerializer].
+ *
+ * The base fields (uuid, priority, dependencies) are encoded directly.
+ * NSKeyedArchiver is only used for the "extras": the persistentUserInfo, plus any fields added by subclasses.
+ * (Subclasses continue to use the standard NSCoding methods, and should invoke super as usual.)
+ *
+ * The decoding method also supports operations that were persisted (via NSKeyedArchiver) by older versions.
+ */
+- (NSData *)serializedData;
++ (YapDatabaseCloudCoreOperation *)operationWithSerializedData:(NSData *)data;
+
 @end
@@ -35,6 +35,17 @@
 
 - (void)restoreGraphs:(NSArray<YapDatabaseCloudCoreGraph *> *)graphs previousAlgorithm:(NSNumber *)algorithm;
 
+/**
+ * Invoked (by the owner) with the operations for graphs that were pending restore.
+ * See YapDatabaseCloudCoreOptions.restoreGraphLimit.
+ *
+ * @param operations
+ *   Maps from @(snapshot) to the list of operations read from the queue table.
+ *   If nil, the restore failed, and will be re-attempted later.
+ */
+- (void)restoreDeferredGraphs:(NSArray<NSNumber *> *)snapshots
+               withOperations:(NSDictionary<NSNumber *, NSArray<YapDatabaseCloudCoreOperation *> *> *)operations;
+
 - (BOOL)getSnapshot:(uint64_t *)snapshotPtr forGraphIndex:(NSUInteger)graphIdx;
 - (BOOL)getGraphIndex:(NSUInteger *)graphIdxPtr forSnapshot:(uint64_t)snapshot;
 
@@ -50,6 +61,7 @@
  */
 
 - (YapDatabaseCloudCoreOperation *)_operationWithUUID:(NSUUID *)uuid;
+- (NSDictionary<NSUUID*, YapDatabaseCloudCoreOperation*> *)_operationsWithUUIDs:(NSArray<NSUUID*> *)uuids;
 
 - (void)_enumerateOperationsUsingBlock:(void (NS_NOESCAPE^)(YapDatabaseCloudCoreOperation *operation,
                                                             NSUInteger graphIdx, BOOL *stop))enumBlock;
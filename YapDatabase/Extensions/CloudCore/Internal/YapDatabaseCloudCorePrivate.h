@@ -69,6 +69,8 @@ static NSString *const changeset_key_reset            = @"reset";
        insertedOperations:(NSDictionary<NSString *, NSDictionary *> *)insertedOperations
        modifiedOperations:(NSDictionary<NSUUID *, YapDatabaseCloudCoreOperation *> *)modifiedOperations;
 
+- (void)restoreDeferredGraphs:(NSArray<NSNumber *> *)snapshots forPipeline:(YapDatabaseCloudCorePipeline *)pipeline;
+
 @end
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -195,6 +197,10 @@ typedef NS_OPTIONS(uint8_t, YDBCloudCore_EnumOps) {
 - (void)didCompleteOperation:(YapDatabaseCloudCoreOperation *)operation;
 - (void)didSkipOperation:(YapDatabaseCloudCoreOperation *)operation;
 
+- (NSDictionary<NSNumber *, NSArray<YapDatabaseCloudCoreOperation *> *> *)
+  restoreDeferredOperationsForPipeline:(YapDatabaseCloudCorePipeline *)pipeline
+                             snapshots:(NSArray<NSNumber *> *)snapshots;
+
 /**
  * All of the public methods that return an operation (directly, or via enumeration block),
  * always return a copy of the internally held operation.
@@ -205,6 +211,9 @@ typedef NS_OPTIONS(uint8_t, YDBCloudCore_EnumOps) {
 - (YapDatabaseCloudCoreOperation *)_operationWithUUID:(NSUUID *)uuid;
 - (YapDatabaseCloudCoreOperation *)_operationWithUUID:(NSUUID *)uuid inPipeline:(NSString *)pipelineName;
 
+- (NSDictionary<NSUUID *, YapDatabaseCloudCoreOperation *> *)_operationsWithUUIDs:(NSArray<NSUUID *> *)uuids
+                                                                        inPipeline:(NSString *)pipelineName;
+
 - (void)_enumerateOperationsUsingBlock:(void (NS_NOESCAPE^)(YapDatabaseCloudCorePipeline *pipeline,
                                                             YapDatabaseCloudCoreOperation *operation,
                                                             NSUInteger graphIdx, BOOL *stop))enumBlock;
@@ -20,11 +20,37 @@
 
 
 @implementation YapDatabaseCloudCoreGraph
+{
+	NSMutableDictionary<NSUUID *, YapDatabaseCloudCoreOperation *> *operationsByUUID;
+	NSMutableSet<NSUUID *> *finishedOpUUIDs;
+	
+	// Operations that were inserted into the graph (via a transaction) while it was pending restore.
+	// These will already be in the graph, and must not be restored (again) from disk.
+	NSMutableSet<NSUUID *> *insertedWhilePendingRestore;
+	
+	//
+	// The ready queue:
+	//
+	// Rather than re-checking every dependency of every operation each time we dequeue,
+	// we keep a counter of unmet dependencies for each operation, along with a reverse mapping
+	// from a dependency to the operations waiting on it. When an operation is completed or skipped,
+	// we decrement the counters of its dependents. Those that reach zero are moved into readyOperations,
+	// which is kept sorted in the same order as the operations array (priority, then insertion order).
+	//
+	// The ready queue is (re)built lazily, after any structural change to the graph.
+	//
+	BOOL needsRebuildReadyQueue;
+	NSMutableDictionary<NSUUID *, NSNumber *> *sequenceNumbers;
+	NSMutableDictionary<NSUUID *, NSNumber *> *unmetDependencyCounts;
+	NSMutableDictionary<NSUUID *, NSMutableArray<NSUUID *> *> *dependents;
+	NSMutableArray<YapDatabaseCloudCoreOperation *> *readyOperations;
+}
 
 @synthesize snapshot = snapshot;
 @synthesize operations = operations;
 @synthesize pipeline = pipeline;
 @synthesize previousGraph = previousGraph;
+@synthesize pendingRestore = pendingRestore;
 
 - (instancetype)initWithSnapshot:(uint64_t)inSnapshot
                       operations:(NSArray<YapDatabaseCloudCoreOperation *> *)inOperations
@@ -33,6 +59,15 @@
 	{
 		snapshot = inSnapshot;
 		operations = [[self class] sortOperationsByPriority:inOperations];
+		
+		operationsByUUID = [[NSMutableDictionary alloc] initWithCapacity:operations.count];
+		for (YapDatabaseCloudCoreOperation *op in operations)
+		{
+			operationsByUUID[op.uuid] = op;
+		}
+		
+		finishedOpUUIDs = [[NSMutableSet alloc] init];
+		needsRebuildReadyQueue = YES;
 	
 		if ([self hasCircularDependency])
 		{
@@ -42,6 +77,19 @@
 	return self;
 }
 
+/**
+ * Creates a placeholder for a persisted graph that hasn't been loaded from disk yet.
+ * See YapDatabaseCloudCoreOptions.restoreGraphLimit.
+**/
+- (instancetype)initPendingRestoreWithSnapshot:(uint64_t)inSnapshot
+{
+	if ((self = [self initWithSnapshot:inSnapshot operations:@[]]))
+	{
+		pendingRestore = YES;
+	}
+	return self;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Utilities
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -74,12 +122,9 @@
 
 - (YapDatabaseCloudCoreOperation *)operationWithUUID:(NSUUID *)opUUID
 {
-	for (YapDatabaseCloudCoreOperation *op in operations)
-	{
-		if ([op.uuid isEqual:opUUID])
-		{
-			return op;
-		}
+	YapDatabaseCloudCoreOperation *op = operationsByUUID[opUUID];
+	if (op) {
+		return op;
 	}
 	
 	__strong YapDatabaseCloudCoreGraph *previousGraph = self.previousGraph;
@@ -112,30 +157,47 @@
  * @param matchedModifiedOperations
  *   Each modified operation may or may not belong to this graph.
  *   When the method identifies ones that do, they are added to matchedOperations.
+ *
+ * @return
+ *   YES if the graph was changed (operations were inserted and/or modified). NO otherwise.
 **/
-- (void)insertOperations:(NSArray<YapDatabaseCloudCoreOperation *> *)insertedOperations
+- (BOOL)insertOperations:(NSArray<YapDatabaseCloudCoreOperation *> *)insertedOperations
         modifyOperations:(NSDictionary<NSUUID *, YapDatabaseCloudCoreOperation *> *)modifiedOperations
                 modified:(NSMutableArray<YapDatabaseCloudCoreOperation *> *)matchedModifiedOperations
 {
 	__block NSMutableIndexSet *indexesToReplace = nil;
 	
-	[operations enumerateObjectsUsingBlock:^(YapDatabaseCloudCoreOperation *operation, NSUInteger index, BOOL *stop) {
-		
-		if ([modifiedOperations objectForKey:operation.uuid])
-		{
-			if (indexesToReplace == nil)
-				indexesToReplace = [NSMutableIndexSet indexSet];
+	if (modifiedOperations.count > 0)
+	{
+		[operations enumerateObjectsUsingBlock:^(YapDatabaseCloudCoreOperation *operation, NSUInteger index, BOOL *stop) {
 			
-			[indexesToReplace addIndex:index];
-		}
-	}];
+			if ([modifiedOperations objectForKey:operation.uuid])
+			{
+				if (indexesToReplace == nil)
+					indexesToReplace = [NSMutableIndexSet indexSet];
+				
+				[indexesToReplace addIndex:index];
+			}
+		}];
+	}
 	
 	if ((insertedOperations.count > 0) || indexesToReplace)
 	{
 		NSMutableArray *newOperations = [operations mutableCopy];
 		
-		if (insertedOperations)
-			[newOperations addObjectsFromArray:insertedOperations];
+		for (YapDatabaseCloudCoreOperation *insertedOperation in insertedOperations)
+		{
+			[newOperations addObject:insertedOperation];
+			operationsByUUID[insertedOperation.uuid] = insertedOperation;
+			
+			if (pendingRestore)
+			{
+				if (insertedWhilePendingRestore == nil)
+					insertedWhilePendingRestore = [[NSMutableSet alloc] init];
+				
+				[insertedWhilePendingRestore addObject:insertedOperation.uuid];
+			}
+		}
 		
 		[indexesToReplace enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
 		#pragma clang diagnostic push
@@ -147,36 +209,92 @@
 			[newOperations replaceObjectAtIndex:index withObject:newOperation];
 			[matchedModifiedOperations addObject:newOperation];
 			
+			operationsByUUID[newOperation.uuid] = newOperation;
+			
 		#pragma clang diagnostic pop
 		}];
 		
 		operations = [[self class] sortOperationsByPriority:newOperations];
+		
+		// Priorities and/or dependencies may have changed
+		needsRebuildReadyQueue = YES;
+		return YES;
+	}
+	
+	return NO;
+}
+
+/**
+ * Loads the operations of a graph that was pending restore.
+ *
+ * @param restoredOperations
+ *   The operations for this graph, as read from the queue table.
+ *
+ * @return
+ *   The operations that were actually added to the graph.
+ *   Operations that were inserted into the graph in the meantime are ignored.
+**/
+- (NSArray<YapDatabaseCloudCoreOperation *> *)restoreOperations:(NSArray<YapDatabaseCloudCoreOperation *> *)restoredOperations
+{
+	if (!pendingRestore) {
+		return [NSArray array];
+	}
+	
+	NSMutableArray<YapDatabaseCloudCoreOperation *> *addedOperations =
+	  [NSMutableArray arrayWithCapacity:restoredOperations.count];
+	
+	for (YapDatabaseCloudCoreOperation *op in restoredOperations)
+	{
+		if ((operationsByUUID[op.uuid] == nil) && ![insertedWhilePendingRestore containsObject:op.uuid])
+		{
+			[addedOperations addObject:op];
+		}
+	}
+	
+	pendingRestore = NO;
+	insertedWhilePendingRestore = nil;
+	
+	if (addedOperations.count > 0)
+	{
+		[self insertOperations:addedOperations modifyOperations:nil modified:nil];
 	}
+	
+	return addedOperations;
 }
 
 /**
  * Removes any operations from the graph that have been marked as completed.
+ *
+ * The pipeline informs us (via didFinishOperationWithUUID:) as operations are completed or skipped.
+ * So we only need to do work here if one of our own operations has finished.
 **/
 - (NSArray *)removeCompletedAndSkippedOperations
 {
+	if (finishedOpUUIDs.count == 0) {
+		return [NSArray array];
+	}
+	
 	NSMutableIndexSet *indexesToRemove = [NSMutableIndexSet indexSet];
-	NSMutableArray *removedOperations = [NSMutableArray arrayWithCapacity:1];
+	NSMutableArray *removedOperations = [NSMutableArray arrayWithCapacity:finishedOpUUIDs.count];
 	
 	NSUInteger index = 0;
 	for (YapDatabaseCloudCoreOperation *operation in operations)
 	{
-		YDBCloudCoreOperationStatus status = [pipeline statusForOperationWithUUID:operation.uuid];
-		
-		if (status == YDBCloudOperationStatus_Completed ||
-		    status == YDBCloudOperationStatus_Skipped)
+		if ([finishedOpUUIDs containsObject:operation.uuid])
 		{
 			[indexesToRemove addIndex:index];
 			[removedOperations addObject:operation];
+			
+			[operationsByUUID removeObjectForKey:operation.uuid];
+			[sequenceNumbers removeObjectForKey:operation.uuid];
+			[unmetDependencyCounts removeObjectForKey:operation.uuid];
 		}
 		
 		index++;
 	}
 	
+	[finishedOpUUIDs removeAllObjects];
+	
 	if (indexesToRemove.count > 0)
 	{
 		NSMutableArray *newOperations = [operations mutableCopy];
@@ -188,6 +306,77 @@
 	return removedOperations;
 }
 
+/**
+ * Invoked by the pipeline when an operation transitions to completed or skipped.
+ * The operation may belong to this graph, or (when using the FlatGraph algorithm) to an earlier graph.
+ *
+ * This is the only status transition the ready queue cares about, because it's a permanent one.
+ * An operation that is active (or on hold) remains in the ready queue,
+ * and is simply passed over in nextReadyOperation.
+**/
+- (void)didFinishOperationWithUUID:(NSUUID *)opUUID
+{
+	YapDatabaseCloudCoreOperation *finishedOp = operationsByUUID[opUUID];
+	if (finishedOp)
+	{
+		[finishedOpUUIDs addObject:opUUID];
+	}
+	
+	if (needsRebuildReadyQueue)
+	{
+		// The ready queue will be rebuilt from scratch (using the current status of each operation)
+		// the next time it's needed.
+		return;
+	}
+	
+	if (finishedOp)
+	{
+		NSUInteger readyIdx = [self indexOfReadyOperation:finishedOp];
+		if (readyIdx != NSNotFound) {
+			[readyOperations removeObjectAtIndex:readyIdx];
+		}
+		[unmetDependencyCounts removeObjectForKey:opUUID];
+	}
+	
+	NSArray<NSUUID *> *waitingOpUUIDs = dependents[opUUID];
+	if (waitingOpUUIDs == nil) return;
+	
+	[dependents removeObjectForKey:opUUID];
+	
+	for (NSUUID *waitingOpUUID in waitingOpUUIDs)
+	{
+		NSNumber *count = unmetDependencyCounts[waitingOpUUID];
+		if (count == nil) continue;
+		
+		NSUInteger remaining = count.unsignedIntegerValue - 1;
+		if (remaining > 0)
+		{
+			unmetDependencyCounts[waitingOpUUID] = @(remaining);
+		}
+		else
+		{
+			[unmetDependencyCounts removeObjectForKey:waitingOpUUID];
+			
+			YapDatabaseCloudCoreOperation *waitingOp = operationsByUUID[waitingOpUUID];
+			if (waitingOp && ![finishedOpUUIDs containsObject:waitingOpUUID])
+			{
+				[self insertReadyOperation:waitingOp];
+			}
+		}
+	}
+}
+
+/**
+ * Forces the ready queue to be rebuilt the next time it's needed.
+ *
+ * This is used by the pipeline (in FlatGraph mode) when an earlier graph is modified,
+ * since the dependencies of our operations may point into that graph.
+**/
+- (void)invalidateReadyQueue
+{
+	needsRebuildReadyQueue = YES;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Dequeue Logic
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -198,6 +387,10 @@
  * If found, sets the isStarted property to YES, and returns the next operation.
  * Otherwise returns nil.
  *
+ * Only operations in the ready queue (all dependencies completed or skipped) are considered.
+ * So the cost is proportional to the number of ready operations that are active or on hold,
+ * rather than the number of operations in the graph.
+ *
  * @param minPriority
  *   If non-nil, the returned operation must have a priorty > minPriority
 **/
@@ -205,40 +398,35 @@
 {
 	YDBLogVerbose(@"[graph:%llu] - nextReadyOperation", self.snapshot);
 	
+	if (needsRebuildReadyQueue) {
+		[self rebuildReadyQueue];
+	}
+	
 	YapDatabaseCloudCoreOperation *nextOpToStart = nil;
 	
-	for (YapDatabaseCloudCoreOperation *op in operations)
+	for (YapDatabaseCloudCoreOperation *op in readyOperations)
 	{
 		if (minPriority != nil)
 		{
 			// Note:
-			//   The operations are already sorted by priority.
-			//   This sorting was done in the init method.
+			//   The ready queue is sorted by priority (same order as the operations array).
 			
 			if (op.priority <= minPriority.intValue) {
 				break;
 			}
 		}
 		
-		if ([self hasUnmetDependency:op])
-		{
-			YDBLogVerbose(@"[graph:%llu] - op(%@) - has unmet dependency",
-							  self.snapshot, op.uuid);
-		}
-		else
+		YDBLogVerbose(@"[graph:%llu] - op(%@) - checking op status",
+			self.snapshot, op.uuid);
+		
+		YDBCloudCoreOperationStatus status = YDBCloudOperationStatus_Pending;
+		BOOL isOnHold = NO;
+		[pipeline getStatus:&status isOnHold:&isOnHold forOperationUUID:op.uuid];
+		
+		if ((status == YDBCloudOperationStatus_Pending) && !isOnHold)
 		{
-			YDBLogVerbose(@"[graph:%llu] - op(%@) - checking op status",
-				self.snapshot, op.uuid);
-			
-			YDBCloudCoreOperationStatus status = YDBCloudOperationStatus_Pending;
-			BOOL isOnHold = NO;
-			[pipeline getStatus:&status isOnHold:&isOnHold forOperationUUID:op.uuid];
-			
-			if ((status == YDBCloudOperationStatus_Pending) && !isOnHold)
-			{
-				nextOpToStart = op;
-				break;
-			}
+			nextOpToStart = op;
+			break;
 		}
 	}
 	
@@ -248,43 +436,130 @@
 }
 
 /**
- * Recursive helper method.
- *
- * A baseOperation cannot be started until all of its dependencies have completed (or been skipped).
- * So all we need to know (about the baseOperation) is:
+ * Rebuilds the ready queue from scratch.
  *
- * - is there a dependency that isn't finished yet
+ * For each operation, we count the number of dependencies that are not yet completed (or skipped).
+ * A dependency that cannot be found (in this graph, or a previous graph) is considered completed.
 **/
-- (BOOL)hasUnmetDependency:(YapDatabaseCloudCoreOperation *)baseOp
+- (void)rebuildReadyQueue
 {
-	for (NSUUID *depUUID in baseOp.dependencies)
+	YDBLogVerbose(@"[graph:%llu] - rebuildReadyQueue", self.snapshot);
+	
+	NSUInteger capacity = operations.count;
+	
+	sequenceNumbers       = [[NSMutableDictionary alloc] initWithCapacity:capacity];
+	unmetDependencyCounts = [[NSMutableDictionary alloc] init];
+	dependents            = [[NSMutableDictionary alloc] init];
+	readyOperations       = [[NSMutableArray alloc] initWithCapacity:capacity];
+	
+	NSUInteger sequence = 0;
+	for (YapDatabaseCloudCoreOperation *op in operations)
 	{
-		YapDatabaseCloudCoreOperation *dependentOp = [self operationWithUUID:depUUID];
-		if (dependentOp)
+		sequenceNumbers[op.uuid] = @(sequence);
+		sequence++;
+		
+		if ([self isFinishedOperation:op])
 		{
-			YDBCloudCoreOperationStatus status = YDBCloudOperationStatus_Pending;
-			[pipeline getStatus:&status isOnHold:NULL forOperationUUID:dependentOp.uuid];
-			
-			if (status == YDBCloudOperationStatus_Completed ||
-			    status == YDBCloudOperationStatus_Skipped)
-			{
-				// Dependency completed
-			}
-			else
+			[finishedOpUUIDs addObject:op.uuid];
+			continue;
+		}
+		
+		NSUInteger unmetCount = 0;
+		for (NSUUID *depUUID in op.dependencies)
+		{
+			YapDatabaseCloudCoreOperation *depOp = [self operationWithUUID:depUUID];
+			if (depOp && ![self isFinishedOperation:depOp])
 			{
-				YDBLogVerbose(@"[graph:%llu] - op(%@) - waiting for dependency(%@)",
-					self.snapshot, baseOp.uuid, depUUID);
+				unmetCount++;
 				
-				return YES;
+				NSMutableArray<NSUUID *> *waitingOpUUIDs = dependents[depUUID];
+				if (waitingOpUUIDs == nil)
+				{
+					waitingOpUUIDs = [[NSMutableArray alloc] initWithCapacity:1];
+					dependents[depUUID] = waitingOpUUIDs;
+				}
+				[waitingOpUUIDs addObject:op.uuid];
 			}
 		}
+		
+		if (unmetCount > 0)
+		{
+			YDBLogVerbose(@"[graph:%llu] - op(%@) - has %lu unmet dependencies",
+				self.snapshot, op.uuid, (unsigned long)unmetCount);
+			
+			unmetDependencyCounts[op.uuid] = @(unmetCount);
+		}
 		else
 		{
-			// Dependency completed
+			// The operations array is already sorted, so we can simply append.
+			[readyOperations addObject:op];
 		}
 	}
 	
-	return NO;
+	needsRebuildReadyQueue = NO;
+}
+
+- (BOOL)isFinishedOperation:(YapDatabaseCloudCoreOperation *)op
+{
+	YDBCloudCoreOperationStatus status = YDBCloudOperationStatus_Pending;
+	[pipeline getStatus:&status isOnHold:NULL forOperationUUID:op.uuid];
+	
+	return (status == YDBCloudOperationStatus_Completed ||
+	        status == YDBCloudOperationStatus_Skipped);
+}
+
+/**
+ * The ready queue is sorted by priority (highest first),
+ * and then by the order in which the operations appear in the operations array.
+**/
+- (NSComparator)readyQueueComparator
+{
+	__unsafe_unretained NSDictionary<NSUUID *, NSNumber *> *seqNums = sequenceNumbers;
+	
+	return ^NSComparisonResult(id obj1, id obj2) {
+		
+		__unsafe_unretained YapDatabaseCloudCoreOperation *op1 = obj1;
+		__unsafe_unretained YapDatabaseCloudCoreOperation *op2 = obj2;
+		
+		int32_t priority1 = op1.priority;
+		int32_t priority2 = op2.priority;
+		
+		if (priority1 > priority2) return NSOrderedAscending;
+		if (priority1 < priority2) return NSOrderedDescending;
+		
+		NSUInteger seq1 = [seqNums[op1.uuid] unsignedIntegerValue];
+		NSUInteger seq2 = [seqNums[op2.uuid] unsignedIntegerValue];
+		
+		if (seq1 < seq2) return NSOrderedAscending;
+		if (seq1 > seq2) return NSOrderedDescending;
+		
+		return NSOrderedSame;
+	};
+}
+
+- (NSUInteger)indexOfReadyOperation:(YapDatabaseCloudCoreOperation *)op
+{
+	NSRange range = NSMakeRange(0, readyOperations.count);
+	NSUInteger idx = [readyOperations indexOfObject:op
+	                                  inSortedRange:range
+	                                        options:NSBinarySearchingFirstEqual
+	                                usingComparator:[self readyQueueComparator]];
+	
+	if (idx != NSNotFound && readyOperations[idx] != op) {
+		idx = NSNotFound;
+	}
+	return idx;
+}
+
+- (void)insertReadyOperation:(YapDatabaseCloudCoreOperation *)op
+{
+	NSRange range = NSMakeRange(0, readyOperations.count);
+	NSUInteger idx = [readyOperations indexOfObject:op
+	                                  inSortedRange:range
+	                                        options:NSBinarySearchingInsertionIndex
+	                                usingComparator:[self readyQueueComparator]];
+	
+	[readyOperations insertObject:op atIndex:idx];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -38,6 +38,31 @@ NSString *const YDBCloudCorePipelineActiveStatusChangedNotification =
 NSString *const YDBCloudCore_EphemeralKey_Status   = @"status";
 NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 
+/**
+ * An entry in the pipeline's hold index (a binary min-heap ordered by fireTime).
+ *
+ * Entries are never updated in place. When a hold is changed or removed, the old entry simply becomes stale,
+ * and is discarded when it reaches the top of the heap. An entry is valid only if the operation's
+ * current hold (for the entry's context) is the very same NSDate instance.
+**/
+@interface YapDatabaseCloudCoreHoldEntry : NSObject {
+@public
+	
+	NSTimeInterval fireTime; // timeIntervalSinceReferenceDate
+	
+	__strong NSDate *date;
+	__strong NSUUID *opUUID;
+	__strong NSString *context;
+}
+@end
+
+@implementation YapDatabaseCloudCoreHoldEntry
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 
 @implementation YapDatabaseCloudCorePipeline
 {
@@ -55,10 +80,15 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 	NSMutableDictionary<NSUUID *, NSMutableDictionary *> *ephemeralInfo;
 	NSMutableArray<YapDatabaseCloudCoreGraph *> *graphs;
 	NSMutableSet<NSUUID *> *startedOpUUIDs;
+	NSMutableSet<NSNumber *> *restoringSnapshots;
 	
 	dispatch_source_t holdTimer;
 	BOOL holdTimerSuspended;
 	
+	NSMutableArray<YapDatabaseCloudCoreHoldEntry *> *holdHeap;
+	NSMutableDictionary<NSString *, NSMutableDictionary<NSUUID *, NSDate *> *> *holdsByContext;
+	NSUInteger holdCount;
+	
 	__weak YapDatabaseCloudCore *_atomic_setOnce_owner;
 	
 	BOOL isActive;
@@ -150,6 +180,10 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 		graphs           = [[NSMutableArray alloc] initWithCapacity:8];
 		
 		startedOpUUIDs   = [[NSMutableSet alloc] initWithCapacity:8];
+		restoringSnapshots = [[NSMutableSet alloc] init];
+		
+		holdHeap         = [[NSMutableArray alloc] init];
+		holdsByContext   = [[NSMutableDictionary alloc] init];
 		
 		_atomic_maxConcurrentOperationCount = 8;
 	}
@@ -302,6 +336,21 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
  *         Operations which were not found won't be present in the returned dictionary.
 **/
 - (NSDictionary<NSUUID*, YapDatabaseCloudCoreOperation*> *)operationsWithUUIDs:(NSArray<NSUUID*> *)uuids
+{
+	NSDictionary<NSUUID*, YapDatabaseCloudCoreOperation*> *matches = [self _operationsWithUUIDs:uuids];
+	
+	NSMutableDictionary<NSUUID*, YapDatabaseCloudCoreOperation*> *results =
+		[NSMutableDictionary dictionaryWithCapacity:matches.count];
+	
+	[matches enumerateKeysAndObjectsUsingBlock:^(NSUUID *uuid, YapDatabaseCloudCoreOperation *operation, BOOL *stop) {
+		
+		results[uuid] = [operation copy];
+	}];
+	
+	return results;
+}
+
+- (NSDictionary<NSUUID*, YapDatabaseCloudCoreOperation*> *)_operationsWithUUIDs:(NSArray<NSUUID*> *)uuids
 {
 	if (uuids.count == 0) return [NSDictionary dictionary];
 	
@@ -320,7 +369,9 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 			{
 				if ([uuids_set containsObject:operation.uuid])
 				{
-					results[operation.uuid] = [operation copy];
+					results[operation.uuid] = operation;
+					
+					if (results.count == uuids_set.count) return;
 				}
 			}
 		}
@@ -556,23 +607,6 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 #pragma mark Utility Methods
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-- (NSDate *)earliestDate:(NSDictionary<NSString*, NSDate*> *)dates
-{
-	NSDate *earliestDate = nil;
-	
-	for (NSDate *date in [dates objectEnumerator])
-	{
-		if (earliestDate == nil) {
-			earliestDate = date;
-		}
-		else {
-			earliestDate = [earliestDate earlierDate:date];
-		}
-	}
-	
-	return earliestDate;
-}
-
 - (NSDate *)latestDate:(NSDictionary<NSString*, NSDate*> *)dates
 {
 	NSDate *latestDate = nil;
@@ -627,6 +661,18 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 		if (allowed)
 		{
 			opInfo[YDBCloudCore_EphemeralKey_Status] = @(status);
+			
+			if (status == YDBCloudOperationStatus_Completed ||
+			    status == YDBCloudOperationStatus_Skipped)
+			{
+				// Update the ready queue of each graph.
+				// In FlatGraph mode, operations in later graphs may depend on this operation.
+				
+				for (YapDatabaseCloudCoreGraph *graph in graphs)
+				{
+					[graph didFinishOperationWithUUID:uuid];
+				}
+			}
 		}
 		
 	#pragma clang diagnostic pop
@@ -857,8 +903,11 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 			opInfo[YDBCloudCore_EphemeralKey_Hold] = holds;
 		}
 		
+		NSDate *oldDate = holds[context];
 		holds[context] = date;
 		
+		[strongSelf _updateHoldIndexForOperationUUID:opUUID context:context oldDate:oldDate newDate:date];
+		
 		[strongSelf updateHoldTimer];
 		[strongSelf startNextOperationIfPossible];
 	}};
@@ -939,20 +988,11 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 	#pragma clang diagnostic push
 	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
 		
-		[ephemeralInfo enumerateKeysAndObjectsUsingBlock:^(NSUUID *opUUID, NSDictionary *opInfo, BOOL *stop) {
-			
-			NSDictionary<NSString*, NSDate*> *holdDict = opInfo[YDBCloudCore_EphemeralKey_Hold];
-			NSDate *holdDate = holdDict[context];
-			
-			if (holdDate)
-			{
-				if (results == nil) {
-					results = [NSMutableDictionary dictionary];
-				}
-				
-				results[opUUID] = holdDate;
-			}
-		}];
+		NSDictionary<NSUUID*, NSDate*> *holds = holdsByContext[context];
+		if (holds.count > 0)
+		{
+			results = [holds mutableCopy];
+		}
 		
 	#pragma clang diagnostic pop
 	}};
@@ -992,23 +1032,11 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 		holdTimerSuspended = YES;
 	}
 	
-	// Calculate when to fire next
+	// Calculate when to fire next.
+	// This is simply the top of the hold index.
 	
-	__block NSDate *nextFireDate = nil;
-	
-	[ephemeralInfo enumerateKeysAndObjectsUsingBlock:^(NSUUID *uuid, NSMutableDictionary *opInfo, BOOL *stop) {
-		
-		NSDictionary<NSString*, NSDate*> *holdDict = opInfo[YDBCloudCore_EphemeralKey_Hold];
-		if (holdDict)
-		{
-			NSDate *earliestHold = [self earliestDate:holdDict];
-			
-			if (nextFireDate == nil)
-				nextFireDate = earliestHold;
-			else
-				nextFireDate = [nextFireDate earlierDate:earliestHold];
-		}
-	}];
+	YapDatabaseCloudCoreHoldEntry *nextEntry = [self _holdHeapTop];
+	NSDate *nextFireDate = nextEntry ? nextEntry->date : nil;
 	
 	// Update timer
 	
@@ -1048,58 +1076,227 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
 	
 	// Remove the stored hold date for any items in which: hold <= now
+	//
+	// The hold index is ordered by date, so we only touch the holds that have actually expired.
 	
-	NSDate *now = [NSDate date];
-	__block NSMutableArray<NSUUID *> *uuidsToRemove = nil;
+	NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
 	
-	[ephemeralInfo enumerateKeysAndObjectsUsingBlock:^(NSUUID *uuid, NSMutableDictionary *opInfo, BOOL *stop) {
+	YapDatabaseCloudCoreHoldEntry *entry = nil;
+	while ((entry = [self _holdHeapTop]) && (entry->fireTime <= now))
+	{
+		[self _holdHeapPop];
+		
+		NSUUID *uuid = entry->opUUID;
+		NSString *context = entry->context;
 		
+		NSMutableDictionary *opInfo = ephemeralInfo[uuid];
 		NSMutableDictionary<NSString*, NSDate*> *holdDict = opInfo[YDBCloudCore_EphemeralKey_Hold];
-		if (holdDict)
+		
+		[holdDict removeObjectForKey:context];
+		[self _updateHoldIndexForOperationUUID:uuid context:context oldDate:entry->date newDate:nil];
+		
+		if (holdDict.count == 0)
 		{
-			__block NSMutableArray<NSString *> *contextsToRemove = nil;
+			opInfo[YDBCloudCore_EphemeralKey_Hold] = nil;
 			
-			[holdDict enumerateKeysAndObjectsUsingBlock:^(NSString *context, NSDate *holdDate, BOOL *stop) {
-				
-				NSTimeInterval interval = [holdDate timeIntervalSinceDate:now];
-				if (interval <= 0)
-				{
-					if (contextsToRemove == nil) {
-						contextsToRemove = [[NSMutableArray alloc] initWithCapacity:4];
-					}
-					
-					[contextsToRemove addObject:context];
-				}
-			}];
-			
-			if (contextsToRemove.count > 0)
+			if (opInfo.count == 0)
 			{
-				[holdDict removeObjectsForKeys:contextsToRemove];
-				
-				if (holdDict.count == 0)
-				{
-					opInfo[YDBCloudCore_EphemeralKey_Hold] = nil;
-					
-					if (opInfo.count == 0)
-					{
-						if (uuidsToRemove == nil)
-							uuidsToRemove = [[NSMutableArray alloc] initWithCapacity:4];
-						
-						[uuidsToRemove addObject:uuid];
-					}
-
-				}
+				[ephemeralInfo removeObjectForKey:uuid];
 			}
 		}
+	}
+	
+	[self updateHoldTimer];
+	[self startNextOperationIfPossible];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Hold Index
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Keeps holdsByContext & the hold heap in sync with a change to an operation's hold (for a single context).
+ * This method must be invoked AFTER the ephemeralInfo has been updated.
+**/
+- (void)_updateHoldIndexForOperationUUID:(NSUUID *)opUUID
+                                 context:(NSString *)context
+                                 oldDate:(NSDate *)oldDate
+                                 newDate:(NSDate *)newDate
+{
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	if (oldDate)
+	{
+		NSMutableDictionary<NSUUID*, NSDate*> *holds = holdsByContext[context];
+		[holds removeObjectForKey:opUUID];
+		
+		if (holds.count == 0) {
+			[holdsByContext removeObjectForKey:context];
+		}
+		
+		holdCount--;
+		
+		// The old heap entry is now stale, and will be discarded lazily.
+	}
+	
+	if (newDate)
+	{
+		NSMutableDictionary<NSUUID*, NSDate*> *holds = holdsByContext[context];
+		if (holds == nil)
+		{
+			holds = [[NSMutableDictionary alloc] initWithCapacity:1];
+			holdsByContext[context] = holds;
+		}
+		holds[opUUID] = newDate;
+		
+		holdCount++;
+		
+		YapDatabaseCloudCoreHoldEntry *entry = [[YapDatabaseCloudCoreHoldEntry alloc] init];
+		entry->fireTime = [newDate timeIntervalSinceReferenceDate];
+		entry->date = newDate;
+		entry->opUUID = opUUID;
+		entry->context = context;
+		
+		[self _holdHeapPush:entry];
+	}
+}
+
+/**
+ * Removes all ephemeral info for the given operation (including holds).
+**/
+- (void)_removeEphemeralInfoForOperationUUID:(NSUUID *)opUUID
+{
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	NSMutableDictionary *opInfo = ephemeralInfo[opUUID];
+	NSDictionary<NSString*, NSDate*> *holdDict = opInfo[YDBCloudCore_EphemeralKey_Hold];
+	
+	[ephemeralInfo removeObjectForKey:opUUID];
+	
+	[holdDict enumerateKeysAndObjectsUsingBlock:^(NSString *context, NSDate *date, BOOL *stop) {
+		
+		[self _updateHoldIndexForOperationUUID:opUUID context:context oldDate:date newDate:nil];
 	}];
+}
+
+- (BOOL)_isValidHoldEntry:(YapDatabaseCloudCoreHoldEntry *)entry
+{
+	NSDictionary<NSString*, NSDate*> *holdDict = ephemeralInfo[entry->opUUID][YDBCloudCore_EphemeralKey_Hold];
 	
-	if (uuidsToRemove)
+	return (holdDict[entry->context] == entry->date);
+}
+
+/**
+ * Returns the earliest (valid) entry in the hold heap, discarding any stale entries along the way.
+**/
+- (YapDatabaseCloudCoreHoldEntry *)_holdHeapTop
+{
+	while (holdHeap.count > 0)
 	{
-		[ephemeralInfo removeObjectsForKeys:uuidsToRemove];
+		YapDatabaseCloudCoreHoldEntry *top = holdHeap[0];
+		if ([self _isValidHoldEntry:top]) {
+			return top;
+		}
+		
+		[self _holdHeapPop];
 	}
 	
-	[self updateHoldTimer];
-	[self startNextOperationIfPossible];
+	return nil;
+}
+
+- (void)_holdHeapPush:(YapDatabaseCloudCoreHoldEntry *)entry
+{
+	// If the heap is mostly stale entries, rebuild it from the valid ones.
+	if (holdHeap.count > ((holdCount * 2) + 32))
+	{
+		NSMutableArray<YapDatabaseCloudCoreHoldEntry *> *validEntries =
+		  [[NSMutableArray alloc] initWithCapacity:(holdCount + 1)];
+		
+		for (YapDatabaseCloudCoreHoldEntry *existing in holdHeap)
+		{
+			if ([self _isValidHoldEntry:existing]) {
+				[validEntries addObject:existing];
+			}
+		}
+		
+		holdHeap = validEntries;
+		
+		NSUInteger count = holdHeap.count;
+		for (NSUInteger i = count / 2; i > 0; i--)
+		{
+			[self _holdHeapSiftDown:(i - 1)];
+		}
+	}
+	
+	[holdHeap addObject:entry];
+	[self _holdHeapSiftUp:(holdHeap.count - 1)];
+}
+
+- (void)_holdHeapPop
+{
+	NSUInteger count = holdHeap.count;
+	if (count == 0) return;
+	
+	[holdHeap exchangeObjectAtIndex:0 withObjectAtIndex:(count - 1)];
+	[holdHeap removeLastObject];
+	
+	if (holdHeap.count > 1) {
+		[self _holdHeapSiftDown:0];
+	}
+}
+
+- (void)_holdHeapSiftUp:(NSUInteger)idx
+{
+	while (idx > 0)
+	{
+		NSUInteger parentIdx = (idx - 1) / 2;
+		
+		__unsafe_unretained YapDatabaseCloudCoreHoldEntry *entry = holdHeap[idx];
+		__unsafe_unretained YapDatabaseCloudCoreHoldEntry *parent = holdHeap[parentIdx];
+		
+		if (entry->fireTime >= parent->fireTime) {
+			break;
+		}
+		
+		[holdHeap exchangeObjectAtIndex:idx withObjectAtIndex:parentIdx];
+		idx = parentIdx;
+	}
+}
+
+- (void)_holdHeapSiftDown:(NSUInteger)idx
+{
+	NSUInteger count = holdHeap.count;
+	
+	while (YES)
+	{
+		NSUInteger leftIdx = (idx * 2) + 1;
+		NSUInteger rightIdx = leftIdx + 1;
+		NSUInteger minIdx = idx;
+		NSTimeInterval minFireTime = ((YapDatabaseCloudCoreHoldEntry *)holdHeap[idx])->fireTime;
+		
+		if (leftIdx < count)
+		{
+			__unsafe_unretained YapDatabaseCloudCoreHoldEntry *left = holdHeap[leftIdx];
+			if (left->fireTime < minFireTime) {
+				minIdx = leftIdx;
+				minFireTime = left->fireTime;
+			}
+		}
+		if (rightIdx < count)
+		{
+			__unsafe_unretained YapDatabaseCloudCoreHoldEntry *right = holdHeap[rightIdx];
+			if (right->fireTime < minFireTime) {
+				minIdx = rightIdx;
+			}
+		}
+		
+		if (minIdx == idx) {
+			break;
+		}
+		
+		[holdHeap exchangeObjectAtIndex:idx withObjectAtIndex:minIdx];
+		idx = minIdx;
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1436,6 +1633,7 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 		
 		if (strongSelf->graphs.count > 0) {
 			[strongSelf startNextOperationIfPossible];
+			[strongSelf restoreDeferredGraphsIfNeeded];
 		}
 	}};
 	
@@ -1489,6 +1687,8 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 			NSMutableArray<YapDatabaseCloudCoreOperation *> *insertedOpsInThisPipeline = [NSMutableArray array];
 			NSMutableArray<YapDatabaseCloudCoreOperation *> *modifiedOpsInThisPipeline = [NSMutableArray array];
 			
+			BOOL earlierGraphChanged = NO;
+			
 			NSUInteger graphIdx = 0;
 			for (YapDatabaseCloudCoreGraph *graph in graphs)
 			{
@@ -1499,9 +1699,20 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 					[insertedOpsInThisPipeline addObjectsFromArray:insertedInGraph];
 				}
 				
-				[graph insertOperations:insertedInGraph
-				       modifyOperations:modifiedOperations
-				               modified:modifiedOpsInThisPipeline];
+				if (earlierGraphChanged)
+				{
+					// FlatGraph: operations in this graph may depend on operations in an earlier graph.
+					[graph invalidateReadyQueue];
+				}
+				
+				BOOL graphChanged =
+				  [graph insertOperations:insertedInGraph
+				         modifyOperations:modifiedOperations
+				                 modified:modifiedOpsInThisPipeline];
+				
+				if (graphChanged && (algorithm == YDBCloudCorePipelineAlgorithm_FlatGraph)) {
+					earlierGraphChanged = YES;
+				}
 				
 				graphIdx++;
 			}
@@ -1558,33 +1769,16 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 				for (YapDatabaseCloudCoreOperation *operation in removedOperations)
 				{
 					[startedOpUUIDs removeObject:operation.uuid];
-					[ephemeralInfo removeObjectForKey:operation.uuid];
+					[self _removeEphemeralInfoForOperationUUID:operation.uuid];
 					
 					[removedOpUUIDs addObject:operation.uuid];
 					[modifiedOpUUIDs removeObject:operation.uuid];
 				}
 			}
 			
-			if (graph.operations.count == 0)
+			if ((graph.operations.count == 0) && !graph.pendingRestore)
 			{
-				[graphs removeObjectAtIndex:graphIdx];
-				
-				if (algorithm == YDBCloudCorePipelineAlgorithm_FlatGraph)
-				{
-					// Careful: Graphs (in FlatCommit mode) are setup in a linked-list,
-					// where each graph has a (weak) pointer to the previous graph.
-					// So we need to fixup the link.
-					if (graphIdx < graphs.count)
-					{
-						YapDatabaseCloudCoreGraph *nextGraph = graphs[graphIdx];
-						if (graphIdx == 0) {
-							nextGraph.previousGraph = nil;
-						}
-						else {
-							nextGraph.previousGraph = graphs[graphIdx - 1];
-						}
-					}
-				}
+				[self removeGraphAtIndex:graphIdx];
 			}
 			else
 			{
@@ -1592,6 +1786,8 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 			}
 		}
 		
+		[self restoreDeferredGraphsIfNeeded];
+		
 		if (addedOpUUIDs.count    > 0 ||
 		    insertedOpUUIDs.count > 0 ||
 		    modifiedOpUUIDs.count > 0 ||
@@ -1622,6 +1818,167 @@ NSString *const YDBCloudCore_EphemeralKey_Hold     = @"hold";
 		dispatch_sync(queue, block);
 }
 
+- (void)removeGraphAtIndex:(NSUInteger)graphIdx
+{
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	[graphs removeObjectAtIndex:graphIdx];
+	
+	if (algorithm == YDBCloudCorePipelineAlgorithm_FlatGraph)
+	{
+		// Careful: Graphs (in FlatCommit mode) are setup in a linked-list,
+		// where each graph has a (weak) pointer to the previous graph.
+		// So we need to fixup the link.
+		if (graphIdx < graphs.count)
+		{
+			YapDatabaseCloudCoreGraph *nextGraph = graphs[graphIdx];
+			if (graphIdx == 0) {
+				nextGraph.previousGraph = nil;
+			}
+			else {
+				nextGraph.previousGraph = graphs[graphIdx - 1];
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Deferred Restore
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * When YapDatabaseCloudCoreOptions.restoreGraphLimit is non-zero, only the first N graphs are restored
+ * during registration. The others are placeholders (graph.pendingRestore == YES).
+ *
+ * This method checks to see if the number of restored graphs (at the front of the queue) has dropped below the limit,
+ * and if so, asks the owner to load the next batch of graphs from the database (asynchronously).
+**/
+- (void)restoreDeferredGraphsIfNeeded
+{
+	NSAssert(dispatch_get_specific(IsOnQueueKey), @"Must be executed within queue");
+	
+	if (graphs.count == 0) return;
+	
+	YapDatabaseCloudCore *owner = _atomic_setOnce_owner;
+	if (owner == nil) return;
+	
+	NSUInteger restoreGraphLimit = owner->options.restoreGraphLimit;
+	if (restoreGraphLimit == 0) return;
+	
+	NSUInteger restoredCount = 0;
+	NSMutableArray<NSNumber *> *snapshotsToRestore = nil;
+	
+	for (YapDatabaseCloudCoreGraph *graph in graphs)
+	{
+		if (restoredCount >= restoreGraphLimit) break;
+		
+		if (graph.pendingRestore)
+		{
+			NSNumber *snapshot = @(graph.snapshot);
+			if (![restoringSnapshots containsObject:snapshot])
+			{
+				if (snapshotsToRestore == nil)
+					snapshotsToRestore = [NSMutableArray arrayWithCapacity:restoreGraphLimit];
+				
+				[snapshotsToRestore addObject:snapshot];
+				[restoringSnapshots addObject:snapshot];
+			}
+		}
+		
+		restoredCount++;
+	}
+	
+	if (snapshotsToRestore.count > 0)
+	{
+		YDBLogVerbose(@"Requesting restore of %lu deferred graph(s) for pipeline: %@",
+		              (unsigned long)snapshotsToRestore.count, name);
+		
+		[owner restoreDeferredGraphs:snapshotsToRestore forPipeline:self];
+	}
+}
+
+- (void)restoreDeferredGraphs:(NSArray<NSNumber *> *)snapshots
+               withOperations:(NSDictionary<NSNumber *, NSArray<YapDatabaseCloudCoreOperation *> *> *)operations
+{
+	YDBLogAutoTrace();
+	
+	__weak YapDatabaseCloudCorePipeline *weakSelf = self;
+	
+	dispatch_block_t block = ^{ @autoreleasepool {
+		
+		__strong YapDatabaseCloudCorePipeline *strongSelf = weakSelf;
+		if (strongSelf == nil) return;
+		
+		[strongSelf->restoringSnapshots minusSet:[NSSet setWithArray:snapshots]];
+		
+		if (operations == nil)
+		{
+			// Restore failed (e.g. the extension isn't ready yet).
+			// We'll try again the next time the queue changes.
+			return;
+		}
+		
+		NSMutableSet<NSUUID *> *restoredOpUUIDs = nil;
+		
+		NSUInteger graphIdx = 0;
+		while (graphIdx < strongSelf->graphs.count)
+		{
+			YapDatabaseCloudCoreGraph *graph = strongSelf->graphs[graphIdx];
+			NSNumber *snapshot = @(graph.snapshot);
+			
+			if (graph.pendingRestore && [snapshots containsObject:snapshot])
+			{
+				NSArray<YapDatabaseCloudCoreOperation *> *restoredOps =
+				  [graph restoreOperations:(operations[snapshot] ?: @[])];
+				
+				for (YapDatabaseCloudCoreOperation *op in restoredOps)
+				{
+					if (restoredOpUUIDs == nil)
+						restoredOpUUIDs = [NSMutableSet setWithCapacity:restoredOps.count];
+					
+					[restoredOpUUIDs addObject:op.uuid];
+				}
+				
+				if (graph.operations.count == 0)
+				{
+					[strongSelf removeGraphAtIndex:graphIdx];
+					continue;
+				}
+				
+				if (strongSelf->algorithm == YDBCloudCorePipelineAlgorithm_FlatGraph)
+				{
+					// FlatGraph: operations in later graphs may depend on the restored operations.
+					for (NSUInteger i = graphIdx + 1; i < strongSelf->graphs.count; i++)
+					{
+						[strongSelf->graphs[i] invalidateReadyQueue];
+					}
+				}
+			}
+			
+			graphIdx++;
+		}
+		
+		YDBLogInfo(@"Restored %lu deferred graph(s) (%lu operations) for pipeline: %@",
+		           (unsigned long)snapshots.count, (unsigned long)restoredOpUUIDs.count, strongSelf->name);
+		
+		[strongSelf startNextOperationIfPossible];
+		[strongSelf restoreDeferredGraphsIfNeeded];
+		
+		if (restoredOpUUIDs.count > 0)
+		{
+			[strongSelf postQueueChangedNotificationWithAdded: nil
+			                                         modified: nil
+			                                         inserted: restoredOpUUIDs
+			                                          removed: nil];
+		}
+	}};
+	
+	if (dispatch_get_specific(IsOnQueueKey))
+		block();
+	else
+		dispatch_async(queue, block); // ASYNC
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Dequeue Logic
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
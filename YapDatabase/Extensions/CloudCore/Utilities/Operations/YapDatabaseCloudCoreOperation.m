@@ -28,6 +28,49 @@ static NSString *const k_priority           = @"priority";
 static NSString *const k_dependencies       = @"dependencies";
 static NSString *const k_persistentUserInfo = @"persistentUserInfo";
 
+/**
+ * Binary encoding of the base fields (see serializedData).
+ *
+ * Layout (multi-byte integers are big-endian):
+ *
+ * [magic: 4 bytes]
+ * [version: uint8]
+ * [flags: uint8]
+ * [uuid: 16 bytes]
+ * [priority: int32]
+ * [dependencies count: uint32]
+ * [dependencies: 16 bytes each]
+ * [extras: remaining bytes] <- NSKeyedArchiver data, only present if flag is set
+ *
+ * Operations persisted by older versions are plain NSKeyedArchiver data (which never starts with the magic).
+**/
+static uint8_t const kBinaryMagic[4] = { 'Y', 'D', 'C', 'O' };
+static uint8_t const kBinaryCurrentVersion = 1;
+static uint8_t const kBinaryFlag_HasExtras = 1 << 0;
+
+static NSUInteger const kBinaryHeaderLength = 4 + 1 + 1 + 16 + 4 + 4;
+
+
+/**
+ * When encoding an operation via the binary format,
+ * the base class fields are written directly, and the (keyed) archiver is only used for the "extras".
+ * That is, the persistentUserInfo, plus whatever subclasses choose to encode.
+ *
+ * These subclasses allow YapDatabaseCloudCoreOperation's NSCoding methods to detect this situation.
+**/
+@interface YDBCloudCoreOperationExtrasArchiver : NSKeyedArchiver
+@end
+
+@implementation YDBCloudCoreOperationExtrasArchiver
+@end
+
+@interface YDBCloudCoreOperationExtrasUnarchiver : NSKeyedUnarchiver
+@end
+
+@implementation YDBCloudCoreOperationExtrasUnarchiver
+@end
+
+
 
 NSString *const YDBCloudCoreOperationIsReadyToStartNotification = @"YDBCloudCoreOperationIsReadyToStart";
 
@@ -76,6 +119,16 @@ NSString *const YDBCloudCoreOperationIsReadyToStartNotification = @"YDBCloudCore
 {
 	if ((self = [super init]))
 	{
+		if ([decoder isKindOfClass:[YDBCloudCoreOperationExtrasUnarchiver class]])
+		{
+			// Binary format:
+			// The base fields (uuid, priority, dependencies) are decoded directly from the binary header,
+			// and set after this method returns. See operationWithSerializedData:.
+			
+			persistentUserInfo = [decoder decodeObjectForKey:k_persistentUserInfo];
+			return self;
+		}
+		
 		int version = [decoder decodeIntForKey:k_version];
 		
 		// The pipeline property is NOT encoded.
@@ -106,6 +159,16 @@ NSString *const YDBCloudCoreOperationIsReadyToStartNotification = @"YDBCloudCore
 
 - (void)encodeWithCoder:(NSCoder *)coder
 {
+	if ([coder isKindOfClass:[YDBCloudCoreOperationExtrasArchiver class]])
+	{
+		// Binary format:
+		// The base fields (uuid, priority, dependencies) are written directly into the binary header.
+		// See serializedData.
+		
+		[coder encodeObject:persistentUserInfo forKey:k_persistentUserInfo];
+		return;
+	}
+	
 	if (kYapDatabaseCloudCoreOperation_CurrentVersion != 0) {
 		[coder encodeInt:kYapDatabaseCloudCoreOperation_CurrentVersion forKey:k_version];
 	}
@@ -127,6 +190,157 @@ NSString *const YDBCloudCoreOperationIsReadyToStartNotification = @"YDBCloudCore
 	[coder encodeObject:persistentUserInfo forKey:k_persistentUserInfo];
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Binary Encoding
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (NSData *)serializedData
+{
+	NSData *extras = nil;
+	
+	if ([self class] != [YapDatabaseCloudCoreOperation class] || persistentUserInfo != nil)
+	{
+		NSMutableData *extrasData = [NSMutableData data];
+		
+		YDBCloudCoreOperationExtrasArchiver *archiver =
+		  [[YDBCloudCoreOperationExtrasArchiver alloc] initForWritingWithMutableData:extrasData];
+		
+		[archiver encodeObject:self forKey:NSKeyedArchiveRootObjectKey];
+		[archiver finishEncoding];
+		
+		extras = extrasData;
+	}
+	
+	uint32_t dependenciesCount = (uint32_t)dependencies.count;
+	
+	NSMutableData *data =
+	  [NSMutableData dataWithCapacity:(kBinaryHeaderLength + (dependenciesCount * 16) + extras.length)];
+	
+	uint8_t version = kBinaryCurrentVersion;
+	uint8_t flags = extras ? kBinaryFlag_HasExtras : 0;
+	
+	[data appendBytes:kBinaryMagic length:sizeof(kBinaryMagic)];
+	[data appendBytes:&version length:sizeof(version)];
+	[data appendBytes:&flags length:sizeof(flags)];
+	
+	uuid_t uuidBytes;
+	[uuid getUUIDBytes:uuidBytes];
+	[data appendBytes:uuidBytes length:sizeof(uuid_t)];
+	
+	uint32_t priorityBE = CFSwapInt32HostToBig((uint32_t)priority);
+	[data appendBytes:&priorityBE length:sizeof(priorityBE)];
+	
+	uint32_t dependenciesCountBE = CFSwapInt32HostToBig(dependenciesCount);
+	[data appendBytes:&dependenciesCountBE length:sizeof(dependenciesCountBE)];
+	
+	for (NSUUID *dependency in dependencies)
+	{
+		[dependency getUUIDBytes:uuidBytes];
+		[data appendBytes:uuidBytes length:sizeof(uuid_t)];
+	}
+	
+	if (extras) {
+		[data appendData:extras];
+	}
+	
+	return data;
+}
+
++ (YapDatabaseCloudCoreOperation *)operationWithSerializedData:(NSData *)data
+{
+	if (data.length == 0) return nil;
+	
+	const uint8_t *bytes = (const uint8_t *)data.bytes;
+	NSUInteger length = data.length;
+	
+	if (length < sizeof(kBinaryMagic) || memcmp(bytes, kBinaryMagic, sizeof(kBinaryMagic)) != 0)
+	{
+		// Operation was persisted by an older version (plain keyed archive)
+		
+		return [NSKeyedUnarchiver unarchiveObjectWithData:data];
+	}
+	
+	if (length < kBinaryHeaderLength)
+	{
+		YDBLogWarn(@"Truncated operation data (length = %lu)", (unsigned long)length);
+		return nil;
+	}
+	
+	NSUInteger offset = sizeof(kBinaryMagic);
+	
+	uint8_t version = bytes[offset]; offset += 1;
+	uint8_t flags   = bytes[offset]; offset += 1;
+	
+	if (version > kBinaryCurrentVersion)
+	{
+		YDBLogWarn(@"Unknown operation encoding version (%u)", (unsigned int)version);
+		return nil;
+	}
+	
+	NSUUID *opUUID = [[NSUUID alloc] initWithUUIDBytes:(bytes + offset)];
+	offset += sizeof(uuid_t);
+	
+	uint32_t priorityBE;
+	memcpy(&priorityBE, (bytes + offset), sizeof(priorityBE));
+	offset += sizeof(priorityBE);
+	
+	uint32_t dependenciesCountBE;
+	memcpy(&dependenciesCountBE, (bytes + offset), sizeof(dependenciesCountBE));
+	offset += sizeof(dependenciesCountBE);
+	
+	NSUInteger dependenciesCount = CFSwapInt32BigToHost(dependenciesCountBE);
+	
+	if ((length - offset) / sizeof(uuid_t) < dependenciesCount)
+	{
+		YDBLogWarn(@"Truncated operation data (length = %lu)", (unsigned long)length);
+		return nil;
+	}
+	
+	NSSet<NSUUID *> *opDependencies = nil;
+	if (dependenciesCount > 0)
+	{
+		NSMutableSet<NSUUID *> *set = [NSMutableSet setWithCapacity:dependenciesCount];
+		for (NSUInteger i = 0; i < dependenciesCount; i++)
+		{
+			[set addObject:[[NSUUID alloc] initWithUUIDBytes:(bytes + offset)]];
+			offset += sizeof(uuid_t);
+		}
+		
+		opDependencies = [set copy];
+	}
+	
+	YapDatabaseCloudCoreOperation *operation = nil;
+	
+	if (flags & kBinaryFlag_HasExtras)
+	{
+		NSData *extras = [data subdataWithRange:NSMakeRange(offset, (length - offset))];
+		
+		YDBCloudCoreOperationExtrasUnarchiver *unarchiver =
+		  [[YDBCloudCoreOperationExtrasUnarchiver alloc] initForReadingWithData:extras];
+		
+		id object = [unarchiver decodeObjectForKey:NSKeyedArchiveRootObjectKey];
+		[unarchiver finishDecoding];
+		
+		if (![object isKindOfClass:[YapDatabaseCloudCoreOperation class]])
+		{
+			YDBLogWarn(@"Unable to decode operation extras");
+			return nil;
+		}
+		
+		operation = (YapDatabaseCloudCoreOperation *)object;
+	}
+	else
+	{
+		operation = [[YapDatabaseCloudCoreOperation alloc] init];
+	}
+	
+	operation->uuid = opUUID;
+	operation->priority = (int32_t)CFSwapInt32BigToHost(priorityBE);
+	operation->dependencies = opDependencies;
+	
+	return operation;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark NSCopying
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -40,9 +40,29 @@ extern NSString *const YapDatabaseCloudCoreDefaultPipelineName; // = @"default";
 
 #pragma mark General Configuration
 
+/**
+ * The default serializer uses NSKeyedArchiver.
+ * The default deserializer supports both NSKeyedArchiver & the binaryOperationSerializer format.
+ */
 + (YDBCloudCoreOperationSerializer)defaultOperationSerializer;
 + (YDBCloudCoreOperationDeserializer)defaultOperationDeserializer;
 
+/**
+ * An optional serializer that uses a compact binary format.
+ * The uuid, priority & dependencies are written directly,
+ * and NSKeyedArchiver is only used for the persistentUserInfo & any fields added by subclasses.
+ *
+ * Use it along with the defaultOperationDeserializer:
+ *
+ * [cloudCore setOperationSerializer:[YapDatabaseCloudCore binaryOperationSerializer]
+ *                      deserializer:[YapDatabaseCloudCore defaultOperationDeserializer]];
+ *
+ * Important: Older versions of YapDatabase are unable to decode this format.
+ * So only opt-in if the database will never be opened by an older version
+ * (e.g. after a downgrade, or by an app extension that embeds an older framework).
+ */
++ (YDBCloudCoreOperationSerializer)binaryOperationSerializer;
+
 - (BOOL)setOperationSerializer:(YDBCloudCoreOperationSerializer)serializer
                   deserializer:(YDBCloudCoreOperationDeserializer)deserializer;
 
@@ -34,6 +34,8 @@ NSString *const YapDatabaseCloudCoreDefaultPipelineName = @"default";
 	NSMutableDictionary *pipelineNameAlias;
 	
 	NSUInteger suspendCount;
+	
+	YapDatabaseConnection *restoreDatabaseConnection;
 }
 
 /**
@@ -121,7 +123,14 @@ NSString *const YapDatabaseCloudCoreDefaultPipelineName = @"default";
 + (YDBCloudCoreOperationDeserializer)defaultOperationDeserializer
 {
 	return ^ YapDatabaseCloudCoreOperation * (NSData *operationBlob){
-		return (operationBlob.length > 0) ? [NSKeyedUnarchiver unarchiveObjectWithData:operationBlob] : nil;
+		return [YapDatabaseCloudCoreOperation operationWithSerializedData:operationBlob];
+	};
+}
+
++ (YDBCloudCoreOperationSerializer)binaryOperationSerializer
+{
+	return ^ NSData* (YapDatabaseCloudCoreOperation *operation){
+		return [operation serializedData];
 	};
 }
 
@@ -568,4 +577,54 @@ withRegisteredExtensions:(NSDictionary __unused *)registeredExtensions
 		dispatch_sync(queue, block);
 }
 
+/**
+ * Invoked by a pipeline when it's ready to restore graphs that were deferred during the initial restore.
+ * (See YapDatabaseCloudCoreOptions.restoreGraphLimit)
+ *
+ * The operations are read from the database using a dedicated connection,
+ * and then handed back to the pipeline via [pipeline restoreDeferredGraphs:withOperations:].
+**/
+- (void)restoreDeferredGraphs:(NSArray<NSNumber *> *)snapshots forPipeline:(YapDatabaseCloudCorePipeline *)pipeline
+{
+	YDBLogAutoTrace();
+	
+	// Note: This method may be invoked from within the pipeline's queue,
+	// which itself may be executing synchronously within our queue (via commitAddedGraphs:).
+	// So we must go ASYNC here.
+	
+	dispatch_async(queue, ^{ @autoreleasepool {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		NSString *extName = self.registeredName;
+		
+		if (restoreDatabaseConnection == nil)
+		{
+			restoreDatabaseConnection = [self.registeredDatabase newConnection];
+			restoreDatabaseConnection.objectCacheEnabled = NO;
+			restoreDatabaseConnection.metadataCacheEnabled = NO;
+			restoreDatabaseConnection.name = [NSString stringWithFormat:@"YapDatabaseCloudCore(%@).restore", extName];
+		}
+		
+		YapDatabaseConnection *connection = restoreDatabaseConnection;
+		if (connection == nil || extName == nil)
+		{
+			[pipeline restoreDeferredGraphs:snapshots withOperations:nil];
+			return;
+		}
+		
+		[connection asyncReadWithBlock:^(YapDatabaseReadTransaction *transaction) {
+			
+			YapDatabaseCloudCoreTransaction *cloudCoreTransaction = [transaction ext:extName];
+			
+			NSDictionary *operations =
+			  [cloudCoreTransaction restoreDeferredOperationsForPipeline:pipeline snapshots:snapshots];
+			
+			[pipeline restoreDeferredGraphs:snapshots withOperations:operations];
+		}];
+		
+	#pragma clang diagnostic pop
+	}});
+}
+
 @end
@@ -40,6 +40,30 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, assign, readwrite) BOOL enableAttachDetachSupport;
 
+/**
+ * When the extension is registered (e.g. on app launch), all operations stored in the queue table
+ * are normally deserialized & loaded into their pipeline's graphs before the pipeline can start.
+ * If a large number of operations have been queued (e.g. after a long offline period),
+ * this can noticeably delay app launch, and consume a lot of memory.
+ *
+ * If you set a non-zero value, then only the first N graphs (per pipeline) are restored during registration.
+ * The remaining graphs are restored lazily (in the background) as earlier graphs complete.
+ *
+ * Important: Operations within graphs that haven't been restored yet are not visible to the pipeline,
+ * nor to methods such as `[YapDatabaseCloudCoreTransaction operationWithUUID:]` or
+ * `[YapDatabaseCloudCoreTransaction enumerateOperationsUsingBlock:]`.
+ * (The graphs themselves are visible, and are reported as empty.)
+ *
+ * Note: This option only applies to pipelines using the CommitGraph algorithm.
+ * In a FlatGraph pipeline, operations may depend on (and must not be started ahead of) operations in any earlier graph.
+ * So all graphs of a FlatGraph pipeline are restored during registration.
+ * Similarly, if a pipeline's algorithm has changed since the operations were stored,
+ * then all of that pipeline's graphs are restored during registration.
+ *
+ * The default value is 0 (restore all graphs during registration).
+ */
+@property (nonatomic, assign, readwrite) NSUInteger restoreGraphLimit;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -10,6 +10,7 @@
 @synthesize allowedOperationClasses = allowedOperationClasses;
 @synthesize enableAttachDetachSupport = enableAttachDetachSupport;
 @synthesize enableTagSupport = enableTagSupport;
+@synthesize restoreGraphLimit = restoreGraphLimit;
 
 
 - (instancetype)init
@@ -18,6 +19,7 @@
 	{
 		enableAttachDetachSupport = NO;
 		enableTagSupport = NO;
+		restoreGraphLimit = 0;
 	}
 	return self;
 }
@@ -28,6 +30,7 @@
 	copy->allowedOperationClasses = allowedOperationClasses;
 	copy->enableAttachDetachSupport = enableAttachDetachSupport;
 	copy->enableTagSupport = enableTagSupport;
+	copy->restoreGraphLimit = restoreGraphLimit;
 	
 	return copy;
 }
@@ -89,6 +89,19 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)skipOperationWithUUID:(NSUUID *)operationUUID;
 - (void)skipOperationWithUUID:(NSUUID *)operationUUID inPipeline:(nullable NSString *)pipelineName;
 
+/**
+ * Batch versions of `completeOperationWithUUID:` & `skipOperationWithUUID:`.
+ *
+ * These are considerably faster when marking many operations at once (e.g. after a batch upload),
+ * as each pipeline is only searched once, and the rows are removed from the internal sqlite table in bulk.
+ * UUIDs that don't match an operation are ignored.
+ */
+- (void)completeOperationsWithUUIDs:(NSArray<NSUUID *> *)operationUUIDs;
+- (void)completeOperationsWithUUIDs:(NSArray<NSUUID *> *)operationUUIDs inPipeline:(nullable NSString *)pipelineName;
+
+- (void)skipOperationsWithUUIDs:(NSArray<NSUUID *> *)operationUUIDs;
+- (void)skipOperationsWithUUIDs:(NSArray<NSUUID *> *)operationUUIDs inPipeline:(nullable NSString *)pipelineName;
+
 - (void)skipOperationsPassingTest:(BOOL (NS_NOESCAPE^)(YapDatabaseCloudCorePipeline *pipeline,
                                                        YapDatabaseCloudCoreOperation *operation,
                                                        NSUInteger graphIdx, BOOL *stop))testBlock;
@@ -929,111 +929,107 @@ static NSString *const ext_key_versionTag   = @"versionTag";
 	// Step 3 of 4:
 	//
 	// Read queue table
+	//
+	// If the `restoreGraphLimit` option is set, we only deserialize the operations
+	// for the first N graphs of each pipeline. The remaining graphs are restored as "pending" placeholders,
+	// and their operations are streamed in later (by the pipeline) as earlier graphs complete.
 	
-	NSMutableDictionary *operations = [NSMutableDictionary dictionary];
+	NSTimeInterval restoreStart = [NSDate timeIntervalSinceReferenceDate];
+	
+	NSUInteger restoreGraphLimit = parentConnection->parent->options.restoreGraphLimit;
 	
+	NSMutableDictionary<NSString *, NSArray<NSNumber *> *> *sortedGraphIDsPerPipeline = nil;
+	NSMutableDictionary<NSString *, NSSet<NSNumber *> *> *eagerGraphIDsPerPipeline = nil;
+	
+	if (restoreGraphLimit > 0)
 	{
-		sqlite3_stmt *statement;
-		int status;
+		NSDictionary<NSString *, NSSet<NSNumber *> *> *graphIDsPerPipeline =
+		  [self readQueueGraphIDsWithPipelineNames:rowidToPipelineName];
 		
-		NSString *enumerate = [NSString stringWithFormat:@"SELECT * FROM \"%@\";", [self queueTableName]];
-		
-		int const column_idx_rowid       = SQLITE_COLUMN_START +  0; // INTEGER PRIMARY KEY
-		int const column_idx_pipelineID  = SQLITE_COLUMN_START +  1; // INTEGER
-		int const column_idx_graphID     = SQLITE_COLUMN_START +  2; // INTEGER NOT NULL
-		int const column_idx_operation   = SQLITE_COLUMN_START +  3; // BLOB
-		
-		status = sqlite3_prepare_v2(db, [enumerate UTF8String], -1, &statement, NULL);
-		if (status != SQLITE_OK)
-		{
-			YDBLogError(@"Error creating prepared statement (B): %d %s", status, sqlite3_errmsg(db));
+		if (graphIDsPerPipeline == nil) {
 			return NO;
 		}
 		
-		while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+		sortedGraphIDsPerPipeline = [NSMutableDictionary dictionaryWithCapacity:graphIDsPerPipeline.count];
+		eagerGraphIDsPerPipeline = [NSMutableDictionary dictionaryWithCapacity:graphIDsPerPipeline.count];
+		
+		for (NSString *pipelineName in graphIDsPerPipeline)
 		{
-			// - Extract pipeline information
-			
-			NSString *pipelineName = nil;
-			
-			int column_type = sqlite3_column_type(statement, column_idx_pipelineID);
-			if (column_type != SQLITE_NULL)
-			{
-				int64_t pipelineRowid = sqlite3_column_int64(statement, column_idx_pipelineID);
-				
-				pipelineName = rowidToPipelineName[@(pipelineRowid)];
-			}
+			NSArray<NSNumber *> *sortedGraphIDs =
+			  [[graphIDsPerPipeline[pipelineName] allObjects] sortedArrayUsingSelector:@selector(compare:)];
 			
-			// ensure pipelineName is valid (and convert from alias if needed)
+			YapDatabaseCloudCorePipeline *pipeline = [parentConnection->parent pipelineWithName:pipelineName];
 			
-			if (pipelineName == nil) {
-				pipelineName = YapDatabaseCloudCoreDefaultPipelineName;
-			}
-			else {
-				NSString *standardizedPipelineName =
-					[[parentConnection->parent pipelineWithName:pipelineName] name];
-				if (standardizedPipelineName) {
-					pipelineName = standardizedPipelineName;
-				}
-			}
-			
-			// - Extract graph order information
-			
-			uint64_t snapshot = (uint64_t)sqlite3_column_int64(statement, column_idx_graphID);
-			
-			// - Extract operation information
-			// - Create operation instance
+			NSArray *prvInfo = prvPipelineInfo[pipelineName];
+			NSNumber *prvAlgorithm = [prvInfo isKindOfClass:[NSArray class]] ? prvInfo[1] : nil;
 			
-			const void *blob = sqlite3_column_blob(statement, column_idx_operation);
-			int blobSize = sqlite3_column_bytes(statement, column_idx_operation);
-			
-			NSData *operationBlob = [NSData dataWithBytesNoCopy:(void *)blob length:blobSize freeWhenDone:NO];
+			// If the algorithm changed, the pipeline may need to inspect every graph during the restore.
+			// (E.g. when migrating from CommitGraph to FlatGraph.) So we restore everything in this case.
+			//
+			// FlatGraph pipelines are always restored in full.
+			// Operations in any graph may be started (as soon as their dependencies are met),
+			// and may depend on operations in earlier graphs. So if an earlier graph was a placeholder,
+			// its operations would be invisible, and later operations would be started ahead of them.
 			
-			YapDatabaseCloudCoreOperation *operation = [self deserializeOperation:operationBlob];
+			BOOL algorithmChanged = (prvAlgorithm != nil) && ([prvAlgorithm unsignedIntegerValue] != pipeline.algorithm);
+			BOOL isFlatGraph = (pipeline.algorithm == YDBCloudCorePipelineAlgorithm_FlatGraph);
 			
-			operation.operationRowid = sqlite3_column_int64(statement, column_idx_rowid);
-			operation.pipeline = pipelineName;
-			operation.snapshot = snapshot;
-			
-			// - Add to operationsPerPipeline
-			
-			NSMutableDictionary *operationsPerPipeline = operations[pipelineName];
-			if (operationsPerPipeline == nil)
+			if (algorithmChanged || isFlatGraph || sortedGraphIDs.count <= restoreGraphLimit)
 			{
-				operationsPerPipeline = operations[pipelineName] = [NSMutableDictionary dictionary];
+				eagerGraphIDsPerPipeline[pipelineName] = [NSSet setWithArray:sortedGraphIDs];
 			}
-			
-			NSMutableArray *operationsPerGraph = operationsPerPipeline[@(snapshot)];
-			if (operationsPerGraph == nil)
+			else
 			{
-				operationsPerGraph = operationsPerPipeline[@(snapshot)] = [NSMutableArray array];
+				NSRange range = NSMakeRange(0, restoreGraphLimit);
+				eagerGraphIDsPerPipeline[pipelineName] = [NSSet setWithArray:[sortedGraphIDs subarrayWithRange:range]];
 			}
 			
-			[operationsPerGraph addObject:operation];
-		}
-		
-		if (status != SQLITE_DONE)
-		{
-			YDBLogError(@"Error executing statement (A): %d %s", status, sqlite3_errmsg(db));
+			sortedGraphIDsPerPipeline[pipelineName] = sortedGraphIDs;
 		}
+	}
+	
+	NSDictionary<NSString *, NSDictionary *> *operations =
+	  [self readQueueOperationsWithPipelineNames:rowidToPipelineName
+	                                    graphIDs:nil
+	                                      filter:^BOOL(NSString *pipelineName, uint64_t snapshot)
+	{
+		if (eagerGraphIDsPerPipeline == nil) return YES;
 		
-		sqlite3_finalize(statement);
-		statement = NULL;
+		return [eagerGraphIDsPerPipeline[pipelineName] containsObject:@(snapshot)];
+	}];
+	
+	if (operations == nil) {
+		return NO;
 	}
 	
+	NSTimeInterval readQueueElapsed = [NSDate timeIntervalSinceReferenceDate] - restoreStart;
+	
 	// Step 4 of 4:
 	//
 	// Create the graphs (per pipeline)
 	
-	for (NSString *pipelineName in operations)
+	NSMutableSet<NSString *> *pipelineNames = [NSMutableSet setWithArray:[operations allKeys]];
+	if (sortedGraphIDsPerPipeline) {
+		[pipelineNames addObjectsFromArray:[sortedGraphIDsPerPipeline allKeys]];
+	}
+	
+	NSUInteger restoredOperationCount = 0;
+	NSUInteger restoredGraphCount = 0;
+	NSUInteger deferredGraphCount = 0;
+	
+	for (NSString *pipelineName in pipelineNames)
 	{
 		NSDictionary *operationsPerPipeline = operations[pipelineName];
 		
 		// key   : @(snapshot) (uint64_t)
 		// value : @[operation, ...]
 		
-		NSArray<NSNumber *> *unsortedGraphIDs = [operationsPerPipeline allKeys];
-		NSArray<NSNumber *> *sortedGraphIDs = [unsortedGraphIDs sortedArrayUsingSelector:@selector(compare:)];
+		NSArray<NSNumber *> *sortedGraphIDs = sortedGraphIDsPerPipeline[pipelineName];
+		if (sortedGraphIDs == nil)
+		{
+			NSArray<NSNumber *> *unsortedGraphIDs = [operationsPerPipeline allKeys];
+			sortedGraphIDs = [unsortedGraphIDs sortedArrayUsingSelector:@selector(compare:)];
+		}
 		
 		NSMutableArray<YapDatabaseCloudCoreGraph *> *sortedGraphs =
 		  [NSMutableArray arrayWithCapacity:[sortedGraphIDs count]];
@@ -1042,9 +1038,22 @@ static NSString *const ext_key_versionTag   = @"versionTag";
 		{
 			NSArray<YapDatabaseCloudCoreOperation *> *operationsPerGraph = operationsPerPipeline[snapshot];
 			
-			YapDatabaseCloudCoreGraph *graph =
-			  [[YapDatabaseCloudCoreGraph alloc] initWithSnapshot:[snapshot unsignedLongLongValue]
-			                                           operations:operationsPerGraph];
+			YapDatabaseCloudCoreGraph *graph = nil;
+			
+			if (operationsPerGraph)
+			{
+				graph = [[YapDatabaseCloudCoreGraph alloc] initWithSnapshot:[snapshot unsignedLongLongValue]
+				                                                 operations:operationsPerGraph];
+				
+				restoredOperationCount += operationsPerGraph.count;
+				restoredGraphCount++;
+			}
+			else
+			{
+				graph = [[YapDatabaseCloudCoreGraph alloc] initPendingRestoreWithSnapshot:[snapshot unsignedLongLongValue]];
+				
+				deferredGraphCount++;
+			}
 			
 			[sortedGraphs addObject:graph];
 		}
@@ -1057,9 +1066,289 @@ static NSString *const ext_key_versionTag   = @"versionTag";
 		[pipeline restoreGraphs:sortedGraphs previousAlgorithm:prvAlgorithm];
 	}
 	
+	NSTimeInterval restoreElapsed = [NSDate timeIntervalSinceReferenceDate] - restoreStart;
+	
+	YDBLogInfo(@"Restored %lu operation(s) in %lu graph(s), deferred %lu graph(s):"
+	           @" read queue = %.2f ms, total = %.2f ms",
+	           (unsigned long)restoredOperationCount,
+	           (unsigned long)restoredGraphCount,
+	           (unsigned long)deferredGraphCount,
+	           (readQueueElapsed * 1000.0),
+	           (restoreElapsed * 1000.0));
+	
 	return YES;
 }
 
+/**
+ * Returns the set of graphIDs (snapshots) present in the queue table, per pipeline.
+ * Only the (pipelineID, graphID) columns are read, so no operations are deserialized.
+ *
+ * Returns nil on error.
+**/
+- (NSDictionary<NSString *, NSSet<NSNumber *> *> *)readQueueGraphIDsWithPipelineNames:
+                                                      (NSDictionary<NSNumber *, NSString *> *)rowidToPipelineName
+{
+	sqlite3 *db = databaseTransaction->connection->db;
+	
+	sqlite3_stmt *statement;
+	int status;
+	
+	NSString *enumerate = [NSString stringWithFormat:
+	  @"SELECT \"pipelineID\", \"graphID\" FROM \"%@\" GROUP BY \"pipelineID\", \"graphID\";",
+	  [self queueTableName]];
+	
+	int const column_idx_pipelineID = SQLITE_COLUMN_START + 0; // INTEGER
+	int const column_idx_graphID    = SQLITE_COLUMN_START + 1; // INTEGER NOT NULL
+	
+	status = sqlite3_prepare_v2(db, [enumerate UTF8String], -1, &statement, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error creating prepared statement: %d %s", status, sqlite3_errmsg(db));
+		return nil;
+	}
+	
+	NSMutableDictionary<NSString *, NSMutableSet<NSNumber *> *> *result = [NSMutableDictionary dictionary];
+	
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		NSString *pipelineName = [self restoredPipelineNameForStatement:statement
+		                                                         column:column_idx_pipelineID
+		                                                      withNames:rowidToPipelineName];
+		
+		uint64_t snapshot = (uint64_t)sqlite3_column_int64(statement, column_idx_graphID);
+		
+		NSMutableSet<NSNumber *> *graphIDs = result[pipelineName];
+		if (graphIDs == nil)
+		{
+			graphIDs = result[pipelineName] = [NSMutableSet set];
+		}
+		
+		[graphIDs addObject:@(snapshot)];
+	}
+	
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing statement: %d %s", status, sqlite3_errmsg(db));
+	}
+	
+	sqlite3_finalize(statement);
+	statement = NULL;
+	
+	return result;
+}
+
+/**
+ * Reads the queue table, and deserializes the operations.
+ *
+ * If graphIDs is non-nil, only rows belonging to the given graphs are read.
+ * If filter is non-nil, only rows for which the filter returns YES are deserialized.
+ *
+ * Rows that cannot be deserialized (e.g. the operation class no longer exists) are skipped, but are NOT removed.
+ * They may represent unsynced changes, which a future version (or a re-added class) may be able to decode.
+ *
+ * Returns a dictionary of the form:
+ * key   : pipelineName
+ * value : { @(snapshot) : @[operation, ...] }
+ *
+ * Returns nil on error.
+**/
+- (NSDictionary<NSString *, NSDictionary *> *)
+  readQueueOperationsWithPipelineNames:(NSDictionary<NSNumber *, NSString *> *)rowidToPipelineName
+                              graphIDs:(NSArray<NSNumber *> *)graphIDs
+                                filter:(BOOL (NS_NOESCAPE^)(NSString *pipelineName, uint64_t snapshot))filter
+{
+	sqlite3 *db = databaseTransaction->connection->db;
+	
+	sqlite3_stmt *statement;
+	int status;
+	
+	NSMutableString *enumerate = [NSMutableString stringWithFormat:
+	  @"SELECT \"rowid\", \"pipelineID\", \"graphID\", \"operation\" FROM \"%@\"", [self queueTableName]];
+	
+	if (graphIDs)
+	{
+		// The graphIDs are integers, so they can be safely inlined into the query.
+		
+		[enumerate appendString:@" WHERE \"graphID\" IN ("];
+		
+		NSUInteger i = 0;
+		for (NSNumber *graphID in graphIDs)
+		{
+			if (i == 0)
+				[enumerate appendFormat:@"%lld", [graphID longLongValue]];
+			else
+				[enumerate appendFormat:@", %lld", [graphID longLongValue]];
+			
+			i++;
+		}
+		
+		[enumerate appendString:@")"];
+	}
+	
+	[enumerate appendString:@";"];
+	
+	int const column_idx_rowid       = SQLITE_COLUMN_START +  0; // INTEGER PRIMARY KEY
+	int const column_idx_pipelineID  = SQLITE_COLUMN_START +  1; // INTEGER
+	int const column_idx_graphID     = SQLITE_COLUMN_START +  2; // INTEGER NOT NULL
+	int const column_idx_operation   = SQLITE_COLUMN_START +  3; // BLOB
+	
+	status = sqlite3_prepare_v2(db, [enumerate UTF8String], -1, &statement, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error creating prepared statement (B): %d %s", status, sqlite3_errmsg(db));
+		return nil;
+	}
+	
+	NSMutableDictionary *operations = [NSMutableDictionary dictionary];
+	
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		// - Extract pipeline information
+		
+		NSString *pipelineName = [self restoredPipelineNameForStatement:statement
+		                                                         column:column_idx_pipelineID
+		                                                      withNames:rowidToPipelineName];
+		
+		// - Extract graph order information
+		
+		uint64_t snapshot = (uint64_t)sqlite3_column_int64(statement, column_idx_graphID);
+		
+		if (filter && !filter(pipelineName, snapshot))
+		{
+			// Skip the (comparatively expensive) blob read & deserialization
+			continue;
+		}
+		
+		// - Extract operation information
+		// - Create operation instance
+		
+		const void *blob = sqlite3_column_blob(statement, column_idx_operation);
+		int blobSize = sqlite3_column_bytes(statement, column_idx_operation);
+		
+		NSData *operationBlob = [NSData dataWithBytesNoCopy:(void *)blob length:blobSize freeWhenDone:NO];
+		
+		int64_t operationRowid = sqlite3_column_int64(statement, column_idx_rowid);
+		
+		YapDatabaseCloudCoreOperation *operation = [self deserializeOperation:operationBlob];
+		if (operation == nil)
+		{
+			YDBLogWarn(@"Unable to deserialize operation (rowid = %lld) - skipping", operationRowid);
+			continue;
+		}
+		
+		operation.operationRowid = operationRowid;
+		operation.pipeline = pipelineName;
+		operation.snapshot = snapshot;
+		
+		// - Add to operationsPerPipeline
+		
+		NSMutableDictionary *operationsPerPipeline = operations[pipelineName];
+		if (operationsPerPipeline == nil)
+		{
+			operationsPerPipeline = operations[pipelineName] = [NSMutableDictionary dictionary];
+		}
+		
+		NSMutableArray *operationsPerGraph = operationsPerPipeline[@(snapshot)];
+		if (operationsPerGraph == nil)
+		{
+			operationsPerGraph = operationsPerPipeline[@(snapshot)] = [NSMutableArray array];
+		}
+		
+		[operationsPerGraph addObject:operation];
+	}
+	
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing statement (A): %d %s", status, sqlite3_errmsg(db));
+	}
+	
+	sqlite3_finalize(statement);
+	statement = NULL;
+	
+	return operations;
+}
+
+/**
+ * Maps the pipelineID column of a queue table row to a (standardized) pipeline name.
+ * Unknown pipelines are mapped to the default pipeline.
+**/
+- (NSString *)restoredPipelineNameForStatement:(sqlite3_stmt *)statement
+                                        column:(int)column_idx_pipelineID
+                                     withNames:(NSDictionary<NSNumber *, NSString *> *)rowidToPipelineName
+{
+	NSString *pipelineName = nil;
+	
+	int column_type = sqlite3_column_type(statement, column_idx_pipelineID);
+	if (column_type != SQLITE_NULL)
+	{
+		int64_t pipelineRowid = sqlite3_column_int64(statement, column_idx_pipelineID);
+		
+		pipelineName = rowidToPipelineName[@(pipelineRowid)];
+	}
+	
+	// ensure pipelineName is valid (and convert from alias if needed)
+	
+	if (pipelineName == nil) {
+		pipelineName = YapDatabaseCloudCoreDefaultPipelineName;
+	}
+	else {
+		NSString *standardizedPipelineName =
+			[[parentConnection->parent pipelineWithName:pipelineName] name];
+		if (standardizedPipelineName) {
+			pipelineName = standardizedPipelineName;
+		}
+	}
+	
+	return pipelineName;
+}
+
+/**
+ * Invoked (via a dedicated connection) when a pipeline is ready to restore graphs
+ * that were deferred during the initial restore. (See YapDatabaseCloudCoreOptions.restoreGraphLimit)
+ *
+ * Returns a dictionary of the form { @(snapshot) : @[operation, ...] }.
+ * Graphs that no longer have any operations in the queue table won't appear in the result.
+ * Returns nil on error.
+**/
+- (NSDictionary<NSNumber *, NSArray<YapDatabaseCloudCoreOperation *> *> *)
+  restoreDeferredOperationsForPipeline:(YapDatabaseCloudCorePipeline *)pipeline
+                             snapshots:(NSArray<NSNumber *> *)snapshots
+{
+	YDBLogAutoTrace();
+	
+	if (snapshots.count == 0) return @{};
+	
+	NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+	
+	NSMutableDictionary<NSNumber *, NSString *> *rowidToPipelineName = [NSMutableDictionary dictionary];
+	for (YapDatabaseCloudCorePipeline *registeredPipeline in [parentConnection->parent registeredPipelines])
+	{
+		rowidToPipelineName[@(registeredPipeline.rowid)] = registeredPipeline.name;
+	}
+	
+	NSString *pipelineName = pipeline.name;
+	
+	NSDictionary<NSString *, NSDictionary *> *operations =
+	  [self readQueueOperationsWithPipelineNames:rowidToPipelineName
+	                                    graphIDs:snapshots
+	                                      filter:^BOOL(NSString *rowPipelineName, uint64_t snapshot)
+	{
+		return [rowPipelineName isEqualToString:pipelineName];
+	}];
+	
+	if (operations == nil) {
+		return nil; // error reading queue table - pipeline will try again later
+	}
+	
+	NSDictionary *result = operations[pipelineName] ?: @{};
+	
+	YDBLogInfo(@"Restored %lu deferred graph(s) for pipeline(%@) in %.2f ms",
+	           (unsigned long)result.count, pipelineName,
+	           (([NSDate timeIntervalSinceReferenceDate] - start) * 1000.0));
+	
+	return result;
+}
+
 - (BOOL)populateTables
 {
 	// Subclasses may wish to override me.
@@ -1346,6 +1635,91 @@ static NSString *const ext_key_versionTag   = @"versionTag";
 	sqlite3_reset(statement);
 }
 
+- (void)queueTable_removeRowsWithRowids:(NSArray<NSNumber *> *)operationRowids
+{
+	YDBLogAutoTrace();
+	
+	NSUInteger count = operationRowids.count;
+	if (count == 0) return;
+	
+	if (count == 1)
+	{
+		[self queueTable_removeRowWithRowid:[[operationRowids firstObject] longLongValue]];
+		return;
+	}
+	
+	sqlite3 *db = databaseTransaction->connection->db;
+	
+	NSUInteger maxHostParams = (NSUInteger) sqlite3_limit(db, SQLITE_LIMIT_VARIABLE_NUMBER, -1);
+	
+	sqlite3_stmt *statement = NULL;
+	NSUInteger statementParams = 0;
+	
+	NSUInteger offset = 0;
+	do
+	{
+		NSUInteger left = count - offset;
+		NSUInteger numParams = MIN(left, maxHostParams);
+		
+		// DELETE FROM "queueTableName" WHERE "rowid" IN (?, ?, ...);
+		//
+		// Every batch (except possibly the last) is the same size,
+		// so we can generally reuse the prepared statement.
+		
+		if (numParams != statementParams)
+		{
+			sqlite_finalize_null(&statement);
+			
+			NSUInteger capacity = 60 + (numParams * 3);
+			NSMutableString *query = [NSMutableString stringWithCapacity:capacity];
+			
+			[query appendFormat:@"DELETE FROM \"%@\" WHERE \"rowid\" IN (", [self queueTableName]];
+			
+			for (NSUInteger i = 0; i < numParams; i++)
+			{
+				if (i == 0)
+					[query appendString:@"?"];
+				else
+					[query appendString:@", ?"];
+			}
+			
+			[query appendString:@");"];
+			
+			int status = sqlite3_prepare_v2(db, [query UTF8String], -1, &statement, NULL);
+			if (status != SQLITE_OK)
+			{
+				YDBLogError(@"Error creating statement: %d %s", status, sqlite3_errmsg(db));
+				return;
+			}
+			
+			statementParams = numParams;
+		}
+		
+		for (NSUInteger i = 0; i < numParams; i++)
+		{
+			int64_t rowid = [[operationRowids objectAtIndex:(offset + i)] longLongValue];
+			
+			sqlite3_bind_int64(statement, (int)(SQLITE_BIND_START + i), rowid);
+		}
+		
+		YDBLogVerbose(@"Deleting %lu rows from queue table...", (unsigned long)numParams);
+		
+		int status = sqlite3_step(statement);
+		if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"Error executing statement: %d %s", status, sqlite3_errmsg(db));
+		}
+		
+		sqlite3_clear_bindings(statement);
+		sqlite3_reset(statement);
+		
+		offset += numParams;
+		
+	} while (offset < count);
+	
+	sqlite_finalize_null(&statement);
+}
+
 - (void)queueTable_removeAllRows
 {
 	YDBLogAutoTrace();
@@ -2504,6 +2878,102 @@ static NSString *const ext_key_versionTag   = @"versionTag";
 	}
 }
 
+/**
+ * Batch version of completeOperationWithUUID:.
+ *
+ * Use this method when marking many operations as complete at once (e.g. after a batch upload).
+ * Each pipeline is only searched once, and the corresponding rows are removed
+ * from the internal sqlite table using set-based deletes.
+**/
+- (void)completeOperationsWithUUIDs:(NSArray<NSUUID *> *)uuids
+{
+	[self completeOperationsWithUUIDs:uuids inPipeline:nil];
+}
+
+- (void)completeOperationsWithUUIDs:(NSArray<NSUUID *> *)uuids inPipeline:(NSString *)pipelineName
+{
+	YDBLogAutoTrace();
+	
+	// Proper API usage check
+	if (!databaseTransaction->isReadWriteTransaction)
+	{
+		@throw [self requiresReadWriteTransactionException:NSStringFromSelector(_cmd)];
+		return;
+	}
+	
+	// The same uuid may appear multiple times in the given array.
+	// But each operation must only be modified (and reported as completed/skipped) once.
+	
+	NSArray<NSUUID *> *uniqueUUIDs = [[NSOrderedSet orderedSetWithArray:uuids] array];
+	
+	NSDictionary<NSUUID *, YapDatabaseCloudCoreOperation *> *ops =
+	  [self _operationsWithUUIDs:uniqueUUIDs inPipeline:pipelineName];
+	
+	for (NSUUID *uuid in uniqueUUIDs)
+	{
+		YapDatabaseCloudCoreOperation *op = ops[uuid];
+		
+		if (op && !op.pendingStatusIsCompleted)
+		{
+			op = [op copy];
+			
+			op.needsDeleteDatabaseRow = YES;
+			op.pendingStatus = @(YDBCloudOperationStatus_Completed);
+			
+			[self addModifiedOperation:op];
+			[self didCompleteOperation:op];
+		}
+	}
+}
+
+/**
+ * Batch version of skipOperationWithUUID:.
+ *
+ * Use this method when skipping many operations at once.
+ * Each pipeline is only searched once, and the corresponding rows are removed
+ * from the internal sqlite table using set-based deletes.
+**/
+- (void)skipOperationsWithUUIDs:(NSArray<NSUUID *> *)uuids
+{
+	[self skipOperationsWithUUIDs:uuids inPipeline:nil];
+}
+
+- (void)skipOperationsWithUUIDs:(NSArray<NSUUID *> *)uuids inPipeline:(NSString *)pipelineName
+{
+	YDBLogAutoTrace();
+	
+	// Proper API usage check
+	if (!databaseTransaction->isReadWriteTransaction)
+	{
+		@throw [self requiresReadWriteTransactionException:NSStringFromSelector(_cmd)];
+		return;
+	}
+	
+	// The same uuid may appear multiple times in the given array.
+	// But each operation must only be modified (and reported as completed/skipped) once.
+	
+	NSArray<NSUUID *> *uniqueUUIDs = [[NSOrderedSet orderedSetWithArray:uuids] array];
+	
+	NSDictionary<NSUUID *, YapDatabaseCloudCoreOperation *> *ops =
+	  [self _operationsWithUUIDs:uniqueUUIDs inPipeline:pipelineName];
+	
+	for (NSUUID *uuid in uniqueUUIDs)
+	{
+		YapDatabaseCloudCoreOperation *op = ops[uuid];
+		
+		if (op && !op.pendingStatusIsCompletedOrSkipped)
+		{
+			op = [op copy];
+			
+			op.needsDeleteDatabaseRow = YES;
+			op.pendingStatus = @(YDBCloudOperationStatus_Skipped);
+			
+			[self addModifiedOperation:op];
+			[self didSkipOperation:op];
+		}
+	}
+}
+
 /**
  * Use this method to skip/abort operations (across all registered pipelines).
 **/
@@ -2794,6 +3264,96 @@ static NSString *const ext_key_versionTag   = @"versionTag";
 	return matchedOp;
 }
 
+/**
+ * Batch version of '_operationWithUUID:' & '_operationWithUUID:inPipeline:'.
+ * If the pipelineName is nil, all registered pipelines are searched.
+ *
+ * Each pipeline is only queried once, regardless of the number of uuids.
+ *
+ * @return A dictionary with all the found operations (sans copy).
+ *         Operations which were not found won't be present in the returned dictionary.
+**/
+- (NSDictionary<NSUUID *, YapDatabaseCloudCoreOperation *> *)_operationsWithUUIDs:(NSArray<NSUUID *> *)uuids
+                                                                        inPipeline:(NSString *)pipelineName
+{
+	if (uuids.count == 0) return [NSDictionary dictionary];
+	
+	NSSet<NSUUID *> *uuids_set = [NSSet setWithArray:uuids];
+	
+	NSMutableDictionary<NSUUID *, YapDatabaseCloudCoreOperation *> *results =
+	  [NSMutableDictionary dictionaryWithCapacity:uuids_set.count];
+	
+	NSArray<YapDatabaseCloudCorePipeline *> *pipelines = nil;
+	if (pipelineName)
+	{
+		YapDatabaseCloudCorePipeline *pipeline = [parentConnection->parent pipelineWithName:pipelineName];
+		pipelines = pipeline ? @[ pipeline ] : @[];
+	}
+	else
+	{
+		pipelines = [parentConnection->parent registeredPipelines];
+	}
+	
+	NSMutableSet<NSString *> *pipelineNames = [NSMutableSet setWithCapacity:pipelines.count];
+	
+	// Search operations from previous commits.
+	
+	for (YapDatabaseCloudCorePipeline *pipeline in pipelines)
+	{
+		[pipelineNames addObject:pipeline.name];
+		
+		[[pipeline _operationsWithUUIDs:uuids] enumerateKeysAndObjectsUsingBlock:
+		  ^(NSUUID *uuid, YapDatabaseCloudCoreOperation *originalOp, BOOL *stop)
+		{
+			YapDatabaseCloudCoreOperation *modifiedOp = self->parentConnection->operations_modified[uuid];
+			
+			results[uuid] = modifiedOp ?: originalOp;
+		}];
+		
+		if (results.count == uuids_set.count) {
+			return results;
+		}
+	}
+	
+	// Search operations that have been added (to a new graph) during this transaction.
+	
+	[parentConnection->operations_added enumerateKeysAndObjectsUsingBlock:
+	  ^(NSString *addedPipelineName, NSArray<YapDatabaseCloudCoreOperation *> *ops, BOOL *stop)
+	{
+		if (![pipelineNames containsObject:addedPipelineName]) return;
+		
+		for (YapDatabaseCloudCoreOperation *op in ops)
+		{
+			if ([uuids_set containsObject:op.uuid] && results[op.uuid] == nil)
+			{
+				results[op.uuid] = op;
+			}
+		}
+	}];
+	
+	// Search operations that have been inserted (into a previous graph) during this transaction.
+	
+	[parentConnection->operations_inserted enumerateKeysAndObjectsUsingBlock:
+	  ^(NSString *insertedPipelineName, NSDictionary *graphs, BOOL *outerStop)
+	{
+		if (![pipelineNames containsObject:insertedPipelineName]) return;
+		
+		[graphs enumerateKeysAndObjectsUsingBlock:
+		  ^(NSNumber *graphIdx, NSArray<YapDatabaseCloudCoreOperation *> *ops, BOOL *innerStop)
+		{
+			for (YapDatabaseCloudCoreOperation *op in ops)
+			{
+				if ([uuids_set containsObject:op.uuid] && results[op.uuid] == nil)
+				{
+					results[op.uuid] = op;
+				}
+			}
+		}];
+	}];
+	
+	return results;
+}
+
 /**
  * Fetches the graph index that corresponds to newly added operations.
  * That is, operations that are added during this commit (read-write transaction).
@@ -3759,11 +4319,19 @@ static NSString *const ext_key_versionTag   = @"versionTag";
 		}];
 	}
 	
+	NSMutableArray<NSNumber *> *rowidsToDelete = nil;
+	
 	for (YapDatabaseCloudCoreOperation *modifiedOp in [parentConnection->operations_modified objectEnumerator])
 	{
 		if (modifiedOp.needsDeleteDatabaseRow)
 		{
-			[self queueTable_removeRowWithRowid:modifiedOp.operationRowid];
+			// Deletes are performed in bulk (below).
+			// Completing/skipping a large batch of operations is a common pattern.
+			
+			if (rowidsToDelete == nil)
+				rowidsToDelete = [NSMutableArray arrayWithCapacity:parentConnection->operations_modified.count];
+			
+			[rowidsToDelete addObject:@(modifiedOp.operationRowid)];
 		}
 		else if (modifiedOp.needsModifyDatabaseRow)
 		{
@@ -3771,6 +4339,11 @@ static NSString *const ext_key_versionTag   = @"versionTag";
 		}
 	}
 	
+	if (rowidsToDelete)
+	{
+		[self queueTable_removeRowsWithRowids:rowidsToDelete];
+	}
+	
 	// Step 2 of 3:
 	//
 	// Flush changes to mapping table
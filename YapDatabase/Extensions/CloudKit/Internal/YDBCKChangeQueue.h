@@ -102,6 +102,10 @@
  * So a single commit may possibly generate multiple changeSets.
  *
  * Thus a changeSet encompasses all the relavent CloudKit related changes per database, per commit.
+ *
+ * For the masterQueue, changeSetsFromPreviousCommits returns a copy of every changeSet in the queue.
+ * For a pendingQueue, it only returns the changeSets that were touched during the transaction
+ * (ordered from oldest commit to newest commit), as these are the only ones that may need to be written to disk.
  */
 - (NSArray *)changeSetsFromPreviousCommits;
 - (NSArray *)changeSetsFromCurrentCommit;
@@ -9,12 +9,87 @@
 @property (atomic, readwrite, strong) NSString *lockUUID;
 @end
 
+static void AddToRecordIndex(NSMutableDictionary *recordIndex, id key, CKRecordID *recordID, NSUInteger ordinal)
+{
+	NSMutableDictionary<CKRecordID *, NSMutableIndexSet *> *recordIDs = recordIndex[key];
+	if (recordIDs == nil)
+	{
+		recordIDs = recordIndex[key] = [[NSMutableDictionary alloc] init];
+	}
+	
+	NSMutableIndexSet *ordinals = recordIDs[recordID];
+	if (ordinals == nil)
+	{
+		ordinals = recordIDs[recordID] = [[NSMutableIndexSet alloc] init];
+	}
+	
+	[ordinals addIndex:ordinal];
+}
+
+static void RemoveFromRecordIndex(NSMutableDictionary *recordIndex, id key, CKRecordID *recordID, NSUInteger ordinal)
+{
+	NSMutableDictionary<CKRecordID *, NSMutableIndexSet *> *recordIDs = recordIndex[key];
+	NSMutableIndexSet *ordinals = recordIDs[recordID];
+	
+	if (ordinals)
+	{
+		[ordinals removeIndex:ordinal];
+		
+		if (ordinals.count == 0)
+		{
+			[recordIDs removeObjectForKey:recordID];
+			
+			if (recordIDs.count == 0) {
+				[recordIndex removeObjectForKey:key];
+			}
+		}
+	}
+}
+
 @implementation YDBCKChangeQueue
 {
 	BOOL isMasterQueue;
 	NSLock *masterQueueLock;
 	
-	NSMutableArray *oldChangeSets;
+	// MasterQueue only:
+	//
+	// oldChangeSets: Every changeSet in the queue, ordered from oldest commit to newest commit.
+	//
+	// Each changeSet is assigned an ordinal when it's added to the queue.
+	// ChangeSets are only ever removed from the front of the queue, and only ever added to the end.
+	// So the index of a changeSet within oldChangeSets is simply (ordinal - firstChangeSetOrdinal).
+	//
+	// The record indexes allow us to find the changeSets that reference a particular record,
+	// without having to scan every changeSet in the queue:
+	//
+	// key   : databaseIdentifier (or NSNull)
+	// value : { CKRecordID : NSMutableIndexSet (ordinals) }
+	
+	NSMutableArray<YDBCKChangeSet *> *oldChangeSets;
+	NSUInteger firstChangeSetOrdinal;
+	
+	NSMutableDictionary<id, NSMutableDictionary<CKRecordID *, NSMutableIndexSet *> *> *modifiedRecordsIndex;
+	NSMutableDictionary<id, NSMutableDictionary<CKRecordID *, NSMutableIndexSet *> *> *deletedRecordIDsIndex;
+	
+	// PendingQueue only:
+	//
+	// pendingOldChangeSets: The changeSets (from previous commits) that have been touched by this transaction.
+	// The changeSets are copied from the masterQueue on demand (copy-on-write).
+	//
+	// key   : index within masterQueue.oldChangeSets
+	// value : YDBCKChangeSet
+	//
+	// The pendingModifiedRecords dictionaries are shallow copies of the masterQueue's dictionaries.
+	// Individual YDBCKChangeRecord's are only copied before being changed (copiedRecordIDs).
+	//
+	// The removed sets allow mergePendingQueue to update the masterQueue's record indexes
+	// in time proportional to the number of records that were actually touched.
+	
+	NSMutableDictionary<NSNumber *, YDBCKChangeSet *> *pendingOldChangeSets;
+	NSMutableDictionary<NSNumber *, NSMutableSet<CKRecordID *> *> *copiedRecordIDs;
+	NSMutableDictionary<NSNumber *, NSMutableSet<CKRecordID *> *> *removedModifiedRecordIDs;
+	NSMutableDictionary<NSNumber *, NSMutableSet<CKRecordID *> *> *removedDeletedRecordIDs;
+	NSString *prevChangeSetUUID;
 	
 	NSArray *newChangeSets;
 	NSMutableDictionary *newChangeSetsDict;
@@ -33,6 +108,10 @@
 		masterQueueLock = [[NSLock alloc] init];
 		
 		oldChangeSets = [[NSMutableArray alloc] init];
+		firstChangeSetOrdinal = 0;
+		
+		modifiedRecordsIndex = [[NSMutableDictionary alloc] init];
+		deletedRecordIDsIndex = [[NSMutableDictionary alloc] init];
 	}
 	return self;
 }
@@ -50,7 +129,11 @@
 	// Get lock for access to 'oldChangeSets'
 	[masterQueueLock lock];
 	{
-		[oldChangeSets addObjectsFromArray:inOldChangeSets];
+		for (YDBCKChangeSet *changeSet in inOldChangeSets)
+		{
+			[self indexChangeSet:changeSet withOrdinal:(firstChangeSetOrdinal + oldChangeSets.count)];
+			[oldChangeSets addObject:changeSet];
+		}
 	}
 	[masterQueueLock unlock];
 }
@@ -101,7 +184,10 @@
 		if (firstChangeSet.isInFlight)
 		{
 			firstChangeSet.isInFlight = NO;
+			
+			[self unindexChangeSet:firstChangeSet withOrdinal:firstChangeSetOrdinal];
 			[oldChangeSets removeObjectAtIndex:0];
+			firstChangeSetOrdinal++;
 		}
 	}
 	[masterQueueLock unlock];
@@ -135,22 +221,21 @@
 {
 	NSAssert(self.isMasterQueue, @"Method can only be invoked on masterQueue");
 	
-	NSUInteger capacity = [oldChangeSets count] + 1;
-	
 	YDBCKChangeQueue *pendingQueue = [[YDBCKChangeQueue alloc] init];
 	pendingQueue->isMasterQueue = NO;
-	pendingQueue->oldChangeSets = [[NSMutableArray alloc] initWithCapacity:capacity];
 	
-	for (YDBCKChangeSet *changeSet in oldChangeSets)
-	{
-		[pendingQueue->oldChangeSets addObject:[changeSet emptyCopy]];
-	}
+	// The changeSets from previous commits are copied on demand.
+	// So the cost of a pendingQueue is proportional to the number of records it touches,
+	// and not to the size of the masterQueue.
 	
+	pendingQueue->pendingOldChangeSets = [[NSMutableDictionary alloc] init];
 	pendingQueue->newChangeSetsDict = [[NSMutableDictionary alloc] initWithCapacity:1];
 	
 	[masterQueueLock lock];
 	self.lockUUID = pendingQueue.lockUUID = [[NSUUID UUID] UUIDString];
 	
+	pendingQueue->prevChangeSetUUID = [[oldChangeSets lastObject] uuid];
+	
 	return pendingQueue;
 }
 
@@ -164,21 +249,48 @@
 	NSAssert(pendingQueue.isPendingQueue, @"Bad parameter: 'pendingQueue' is not a pendingQueue");
 	NSAssert([self.lockUUID isEqualToString:pendingQueue.lockUUID], @"Bad state: Not locked for pendingQueue");
 	
-	NSUInteger count = [oldChangeSets count];
-	NSAssert(count == [pendingQueue->oldChangeSets count], @"Logic error !");
-	
-	for (NSUInteger index = 0; index < count; index++)
+	for (NSNumber *indexNum in pendingQueue->pendingOldChangeSets)
 	{
-		YDBCKChangeSet *pending_oldChangeSet = [pendingQueue->oldChangeSets objectAtIndex:index];
-		if (pending_oldChangeSet.hasChangesToDeletedRecordIDs || pending_oldChangeSet.hasChangesToModifiedRecords)
+		YDBCKChangeSet *pending_oldChangeSet = pendingQueue->pendingOldChangeSets[indexNum];
+		
+		if (!pending_oldChangeSet.hasChangesToDeletedRecordIDs && !pending_oldChangeSet.hasChangesToModifiedRecords)
 		{
-			YDBCKChangeSet *master_oldChangeSet = [self->oldChangeSets objectAtIndex:index];
+			continue;
+		}
+		
+		NSUInteger index = [indexNum unsignedIntegerValue];
+		NSAssert(index < [oldChangeSets count], @"Logic error !");
+		
+		YDBCKChangeSet *master_oldChangeSet = [self->oldChangeSets objectAtIndex:index];
+		
+		id key = [self keyForDatabaseIdentifier:master_oldChangeSet.databaseIdentifier];
+		NSUInteger ordinal = firstChangeSetOrdinal + index;
+		
+		if (pending_oldChangeSet.hasChangesToDeletedRecordIDs)
+		{
+			master_oldChangeSet->deletedRecordIDs = pending_oldChangeSet->deletedRecordIDs;
 			
-			if (pending_oldChangeSet.hasChangesToDeletedRecordIDs)
-				master_oldChangeSet->deletedRecordIDs = pending_oldChangeSet->deletedRecordIDs;
+			for (CKRecordID *recordID in pendingQueue->removedDeletedRecordIDs[indexNum])
+			{
+				// Remember: the same recordID may be listed multiple times
+				if (![master_oldChangeSet->deletedRecordIDs containsObject:recordID])
+				{
+					RemoveFromRecordIndex(deletedRecordIDsIndex, key, recordID, ordinal);
+				}
+			}
+		}
+		
+		if (pending_oldChangeSet.hasChangesToModifiedRecords)
+		{
+			master_oldChangeSet->modifiedRecords = pending_oldChangeSet->modifiedRecords;
 			
-			if (pending_oldChangeSet.hasChangesToModifiedRecords)
-				master_oldChangeSet->modifiedRecords = pending_oldChangeSet->modifiedRecords;
+			for (CKRecordID *recordID in pendingQueue->removedModifiedRecordIDs[indexNum])
+			{
+				if ([master_oldChangeSet->modifiedRecords objectForKey:recordID] == nil)
+				{
+					RemoveFromRecordIndex(modifiedRecordsIndex, key, recordID, ordinal);
+				}
+			}
 		}
 	}
 	
@@ -188,6 +300,7 @@
 		pending_newChangeSet.hasChangesToDeletedRecordIDs = NO;
 		pending_newChangeSet.hasChangesToModifiedRecords = NO;
 		
+		[self indexChangeSet:pending_newChangeSet withOrdinal:(firstChangeSetOrdinal + oldChangeSets.count)];
 		[oldChangeSets addObject:pending_newChangeSet];
 	}
 	
@@ -285,7 +398,19 @@
 	}
 	else // if (self.isPendingQueue)
 	{
-		return [oldChangeSets copy];
+		// Only the changeSets that have been touched by the pendingQueue are returned.
+		// These are the only changeSets that may have changes that need to be written to disk.
+		
+		NSArray<NSNumber *> *sortedIndexes =
+		  [[pendingOldChangeSets allKeys] sortedArrayUsingSelector:@selector(compare:)];
+		
+		NSMutableArray *touchedChangeSets = [NSMutableArray arrayWithCapacity:sortedIndexes.count];
+		for (NSNumber *index in sortedIndexes)
+		{
+			[touchedChangeSets addObject:pendingOldChangeSets[index]];
+		}
+		
+		return touchedChangeSets;
 	}
 }
 - (NSArray *)changeSetsFromCurrentCommit
@@ -297,15 +422,15 @@
 		NSMutableArray *orderedChangeSets = [NSMutableArray arrayWithCapacity:[newChangeSetsDict count]];
 		
 		NSString *baseUUID = [[NSUUID UUID] UUIDString];
-		NSString *prevChangeSetUUID = [[oldChangeSets lastObject] uuid];
+		NSString *prevUUID = prevChangeSetUUID;
 		
 		for (YDBCKChangeSet *newChangeSet in [newChangeSetsDict objectEnumerator])
 		{
 			NSString *uuid = [NSString stringWithFormat:@"%@@%lu", baseUUID, (unsigned long)[orderedChangeSets count]];
 			
 			newChangeSet.uuid = uuid;
-			newChangeSet.prev = prevChangeSetUUID;
-			prevChangeSetUUID = newChangeSet.uuid;
+			newChangeSet.prev = prevUUID;
+			prevUUID = newChangeSet.uuid;
 			
 			[orderedChangeSets addObject:newChangeSet];
 		}
@@ -409,16 +534,236 @@
 		return [NSNull null];
 }
 
-static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
+#pragma mark Record Index
+
+/**
+ * Adds all the records referenced by the given changeSet to the record indexes.
+ * Must be invoked while holding the masterQueueLock.
+**/
+- (void)indexChangeSet:(YDBCKChangeSet *)changeSet withOrdinal:(NSUInteger)ordinal
 {
-	if (dbid1 == nil) {
-		return (dbid2 == nil);
+	id key = [self keyForDatabaseIdentifier:changeSet.databaseIdentifier];
+	
+	for (CKRecordID *recordID in changeSet->modifiedRecords)
+	{
+		AddToRecordIndex(modifiedRecordsIndex, key, recordID, ordinal);
 	}
-	else {
-		return [dbid1 isEqualToString:dbid2];
+	
+	for (CKRecordID *recordID in changeSet->deletedRecordIDs)
+	{
+		AddToRecordIndex(deletedRecordIDsIndex, key, recordID, ordinal);
 	}
 }
 
+/**
+ * Removes all the records referenced by the given changeSet from the record indexes.
+ * Must be invoked while holding the masterQueueLock.
+**/
+- (void)unindexChangeSet:(YDBCKChangeSet *)changeSet withOrdinal:(NSUInteger)ordinal
+{
+	id key = [self keyForDatabaseIdentifier:changeSet.databaseIdentifier];
+	
+	for (CKRecordID *recordID in changeSet->modifiedRecords)
+	{
+		RemoveFromRecordIndex(modifiedRecordsIndex, key, recordID, ordinal);
+	}
+	
+	for (CKRecordID *recordID in changeSet->deletedRecordIDs)
+	{
+		RemoveFromRecordIndex(deletedRecordIDsIndex, key, recordID, ordinal);
+	}
+}
+
+/**
+ * Returns the indexes (within oldChangeSets) of the changeSets that reference the given record,
+ * according to the given record index.
+ * Must be invoked while holding the masterQueueLock.
+**/
+- (NSIndexSet *)changeSetIndexesInRecordIndex:(NSDictionary *)recordIndex
+                                  forRecordID:(CKRecordID *)recordID
+                           databaseIdentifier:(NSString *)databaseIdentifier
+{
+	id key = [self keyForDatabaseIdentifier:databaseIdentifier];
+	
+	NSIndexSet *ordinals = recordIndex[key][recordID];
+	if (ordinals.count == 0) return nil;
+	
+	NSMutableIndexSet *indexes = [ordinals mutableCopy];
+	if (firstChangeSetOrdinal > 0)
+	{
+		[indexes shiftIndexesStartingAtIndex:firstChangeSetOrdinal by:-((NSInteger)firstChangeSetOrdinal)];
+	}
+	
+	return indexes;
+}
+
+- (NSIndexSet *)changeSetIndexesWithModifiedRecordID:(CKRecordID *)recordID
+                                  databaseIdentifier:(NSString *)databaseIdentifier
+{
+	return [self changeSetIndexesInRecordIndex:modifiedRecordsIndex
+	                               forRecordID:recordID
+	                        databaseIdentifier:databaseIdentifier];
+}
+
+- (NSIndexSet *)changeSetIndexesWithDeletedRecordID:(CKRecordID *)recordID
+                                 databaseIdentifier:(NSString *)databaseIdentifier
+{
+	return [self changeSetIndexesInRecordIndex:deletedRecordIDsIndex
+	                               forRecordID:recordID
+	                        databaseIdentifier:databaseIdentifier];
+}
+
+#pragma mark PendingQueue Copy-On-Write
+
+/**
+ * Returns the pendingQueue's version of the changeSet at the given index (within masterQueue.oldChangeSets).
+ * The changeSet is copied from the masterQueue (via emptyCopy) on first access.
+**/
+- (YDBCKChangeSet *)pendingQueue:(YDBCKChangeQueue *)pendingQueue changeSetAtIndex:(NSUInteger)index
+{
+	NSNumber *indexNum = @(index);
+	
+	YDBCKChangeSet *pqChangeSet = pendingQueue->pendingOldChangeSets[indexNum];
+	if (pqChangeSet == nil)
+	{
+		YDBCKChangeSet *mqChangeSet = [oldChangeSets objectAtIndex:index];
+		
+		pqChangeSet = [mqChangeSet emptyCopy];
+		pendingQueue->pendingOldChangeSets[indexNum] = pqChangeSet;
+	}
+	
+	return pqChangeSet;
+}
+
+/**
+ * Returns the pendingQueue's version of the changeSet at the given index,
+ * ensuring it has its own modifiedRecords dictionary.
+ *
+ * The dictionary is a shallow copy of the masterQueue's dictionary.
+ * Use pendingQueue:recordForRecordID:inChangeSetAtIndex: to get a record that can safely be changed.
+**/
+- (YDBCKChangeSet *)pendingQueue:(YDBCKChangeQueue *)pendingQueue
+    modifiedRecordsChangeSetAtIndex:(NSUInteger)index
+{
+	YDBCKChangeSet *pqChangeSet = [self pendingQueue:pendingQueue changeSetAtIndex:index];
+	
+	if (pqChangeSet->modifiedRecords == nil)
+	{
+		YDBCKChangeSet *mqChangeSet = [oldChangeSets objectAtIndex:index];
+		
+		if (mqChangeSet->modifiedRecords)
+			pqChangeSet->modifiedRecords = [mqChangeSet->modifiedRecords mutableCopy];
+		else
+			pqChangeSet->modifiedRecords = [[NSMutableDictionary alloc] init];
+		
+		pqChangeSet.hasChangesToModifiedRecords = YES;
+	}
+	
+	return pqChangeSet;
+}
+
+/**
+ * Returns the pendingQueue's version of the changeSet at the given index,
+ * ensuring it has its own deletedRecordIDs array.
+**/
+- (YDBCKChangeSet *)pendingQueue:(YDBCKChangeQueue *)pendingQueue
+   deletedRecordIDsChangeSetAtIndex:(NSUInteger)index
+{
+	YDBCKChangeSet *pqChangeSet = [self pendingQueue:pendingQueue changeSetAtIndex:index];
+	
+	if (pqChangeSet->deletedRecordIDs == nil)
+	{
+		YDBCKChangeSet *mqChangeSet = [oldChangeSets objectAtIndex:index];
+		
+		pqChangeSet->deletedRecordIDs = [mqChangeSet->deletedRecordIDs mutableCopy];
+	}
+	
+	return pqChangeSet;
+}
+
+/**
+ * Returns the pendingQueue's private copy of the record (within the changeSet at the given index),
+ * which can be safely modified without affecting the masterQueue.
+**/
+- (YDBCKChangeRecord *)pendingQueue:(YDBCKChangeQueue *)pendingQueue
+                  recordForRecordID:(CKRecordID *)recordID
+                 inChangeSetAtIndex:(NSUInteger)index
+{
+	YDBCKChangeSet *pqChangeSet = [self pendingQueue:pendingQueue modifiedRecordsChangeSetAtIndex:index];
+	
+	YDBCKChangeRecord *pqRecord = [pqChangeSet->modifiedRecords objectForKey:recordID];
+	if (pqRecord == nil) return nil;
+	
+	NSNumber *indexNum = @(index);
+	
+	if (pendingQueue->copiedRecordIDs == nil)
+		pendingQueue->copiedRecordIDs = [[NSMutableDictionary alloc] init];
+	
+	NSMutableSet<CKRecordID *> *copied = pendingQueue->copiedRecordIDs[indexNum];
+	if (copied == nil)
+	{
+		copied = pendingQueue->copiedRecordIDs[indexNum] = [[NSMutableSet alloc] init];
+	}
+	
+	if (![copied containsObject:recordID])
+	{
+		pqRecord = [pqRecord copy];
+		[pqChangeSet->modifiedRecords setObject:pqRecord forKey:recordID];
+		
+		[copied addObject:recordID];
+	}
+	
+	return pqRecord;
+}
+
+/**
+ * Removes the record from the pendingQueue's version of the changeSet at the given index,
+ * and makes a note of it so the masterQueue's record index can be updated during mergePendingQueue.
+**/
+- (void)pendingQueue:(YDBCKChangeQueue *)pendingQueue
+    removeModifiedRecordID:(CKRecordID *)recordID
+        fromChangeSetAtIndex:(NSUInteger)index
+{
+	YDBCKChangeSet *pqChangeSet = [self pendingQueue:pendingQueue modifiedRecordsChangeSetAtIndex:index];
+	
+	[pqChangeSet->modifiedRecords removeObjectForKey:recordID];
+	
+	NSNumber *indexNum = @(index);
+	
+	if (pendingQueue->removedModifiedRecordIDs == nil)
+		pendingQueue->removedModifiedRecordIDs = [[NSMutableDictionary alloc] init];
+	
+	NSMutableSet<CKRecordID *> *removed = pendingQueue->removedModifiedRecordIDs[indexNum];
+	if (removed == nil)
+	{
+		removed = pendingQueue->removedModifiedRecordIDs[indexNum] = [[NSMutableSet alloc] init];
+	}
+	
+	[removed addObject:recordID];
+}
+
+/**
+ * Makes a note that the recordID was removed from the deletedRecordIDs of the pendingQueue's version
+ * of the changeSet at the given index, so the masterQueue's record index can be updated during mergePendingQueue.
+**/
+- (void)pendingQueue:(YDBCKChangeQueue *)pendingQueue
+    didRemoveDeletedRecordID:(CKRecordID *)recordID
+        fromChangeSetAtIndex:(NSUInteger)index
+{
+	NSNumber *indexNum = @(index);
+	
+	if (pendingQueue->removedDeletedRecordIDs == nil)
+		pendingQueue->removedDeletedRecordIDs = [[NSMutableDictionary alloc] init];
+	
+	NSMutableSet<CKRecordID *> *removed = pendingQueue->removedDeletedRecordIDs[indexNum];
+	if (removed == nil)
+	{
+		removed = pendingQueue->removedDeletedRecordIDs[indexNum] = [[NSMutableSet alloc] init];
+	}
+	
+	[removed addObject:recordID];
+}
+
 #pragma mark Merge Handling
 
 /**
@@ -432,31 +777,15 @@ static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
 	BOOL hasPendingModification = NO;
 	BOOL hasPendingDelete = NO;
 	
-	// Get lock for access to 'oldChangeSets'
-	[masterQueueLock lock];
-	
-	@try {
-		
-		for (YDBCKChangeSet *prevChangeSet in oldChangeSets)
-		{
-			if (CompareDatabaseIdentifiers(databaseIdentifier, prevChangeSet.databaseIdentifier))
-			{
-				if ([prevChangeSet->modifiedRecords objectForKey:recordID])
-				{
-					hasPendingModification = YES;
-				}
-				
-				if ([prevChangeSet->deletedRecordIDs containsObject:recordID])
-				{
-					hasPendingDelete = YES;
-				}
-			}
-		}
-		
-	} @finally {
+	id key = [self keyForDatabaseIdentifier:databaseIdentifier];
 	
-		[masterQueueLock unlock];
+	// Get lock for access to 'oldChangeSets' & record indexes
+	[masterQueueLock lock];
+	{
+		hasPendingModification = ([modifiedRecordsIndex[key][recordID] count] > 0);
+		hasPendingDelete = ([deletedRecordIDsIndex[key][recordID] count] > 0);
 	}
+	[masterQueueLock unlock];
 	
 	if (outHasPendingModification) *outHasPendingModification = hasPendingModification;
 	if (outHasPendingDelete) *outHasPendingDelete = hasPendingDelete;
@@ -478,20 +807,21 @@ static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
 {
 	BOOL hasPendingChanges = NO;
 	
-	// Get lock for access to 'oldChangeSets'
+	// Get lock for access to 'oldChangeSets' & record indexes
 	[masterQueueLock lock];
 	{
-		for (YDBCKChangeSet *prevChangeSet in oldChangeSets)
+		NSIndexSet *indexes = [self changeSetIndexesWithModifiedRecordID:recordID databaseIdentifier:databaseIdentifier];
+		
+		for (NSUInteger index = [indexes firstIndex]; index != NSNotFound; index = [indexes indexGreaterThanIndex:index])
 		{
-			if (CompareDatabaseIdentifiers(databaseIdentifier, prevChangeSet.databaseIdentifier))
+			YDBCKChangeSet *prevChangeSet = [oldChangeSets objectAtIndex:index];
+			
+			YDBCKChangeRecord *prevRecord = [prevChangeSet->modifiedRecords objectForKey:recordID];
+			if (prevRecord)
 			{
-				YDBCKChangeRecord *prevRecord = [prevChangeSet->modifiedRecords objectForKey:recordID];
-				if (prevRecord)
-				{
-					[mergeInfo mergeNewerRecord:prevRecord.record newerOriginalValues:prevRecord.originalValues];
-					
-					hasPendingChanges = YES;
-				}
+				[mergeInfo mergeNewerRecord:prevRecord.record newerOriginalValues:prevRecord.originalValues];
+				
+				hasPendingChanges = YES;
 			}
 		}
 	}
@@ -502,6 +832,12 @@ static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
 
 #pragma mark Transaction Handling
 
+// Note: The pendingQueue holds the masterQueueLock (from newPendingQueue until mergePendingQueue).
+// So all the methods below have safe access to 'oldChangeSets' & the record indexes.
+//
+// Rather than scanning every changeSet in the queue, we use the record indexes to visit
+// only those changeSets (from previous commits) that actually reference the given record.
+
 /**
  * This method:
  * - creates a changeSet for the given databaseIdentifier for the current commit (if needed)
@@ -574,48 +910,38 @@ static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
 	
 	// Update previous changeSets (if needed)
 	
-	NSUInteger index = 0;
-	for (YDBCKChangeSet *mqPrevChangeSet in masterQueue->oldChangeSets)
+	NSIndexSet *indexes =
+	  [masterQueue changeSetIndexesWithModifiedRecordID:recordID databaseIdentifier:databaseIdentifier];
+	
+	for (NSUInteger index = [indexes firstIndex]; index != NSNotFound; index = [indexes indexGreaterThanIndex:index])
 	{
-		if (CompareDatabaseIdentifiers(databaseIdentifier, mqPrevChangeSet.databaseIdentifier))
+		YDBCKChangeSet *mqPrevChangeSet = [masterQueue->oldChangeSets objectAtIndex:index];
+		
+		YDBCKChangeRecord *mqPrevRecord = [mqPrevChangeSet->modifiedRecords objectForKey:recordID];
+		if (mqPrevRecord)
 		{
-			YDBCKChangeRecord *mqPrevRecord = [mqPrevChangeSet->modifiedRecords objectForKey:recordID];
-			if (mqPrevRecord)
+			if (mqPrevRecord.needsStoreFullRecord == NO &&
+			    [mqPrevRecord.changedKeysSet intersectsSet:currentRecord.changedKeysSet])
 			{
-				if (mqPrevRecord.needsStoreFullRecord == NO &&
-				    [mqPrevRecord.changedKeysSet intersectsSet:currentRecord.changedKeysSet])
-				{
-					// The prevRecord is configured to only store the changedKeys array to disk.
-					//
-					// However, we're now seeing conflicting changes to the same CKRecord.
-					// For example:
-					// - a previous commit (not yet pushed to the cloud) changed CKRecord.firstName.
-					// - and this commit is also changing CKRecord.firstName.
-					//
-					// We can only use the changedKeys shortcut when it's possible for use to retrieve
-					// the corresponding values from the object. However, when this type of 'conflict' occurs,
-					// we can no longer use that shortcut. So we must modify the persisted information for
-					// the previous commit so that it stores the previous CKRecord in full,
-					// as opposed to just the changedKeys.
-					
-					YDBCKChangeSet *pqPrevChangeSet = [pendingQueue->oldChangeSets objectAtIndex:index];
-					if (pqPrevChangeSet->modifiedRecords == nil)
-					{
-						pqPrevChangeSet->modifiedRecords =
-						  [[NSMutableDictionary alloc] initWithDictionary:mqPrevChangeSet->modifiedRecords
-						                                        copyItems:YES];
-						
-						pqPrevChangeSet.hasChangesToModifiedRecords = YES;
-					}
-					
-					YDBCKChangeRecord *pqPrevRecord = [pqPrevChangeSet->modifiedRecords objectForKey:recordID];
-					pqPrevRecord.needsStoreFullRecord = YES;
-				}
+				// The prevRecord is configured to only store the changedKeys array to disk.
+				//
+				// However, we're now seeing conflicting changes to the same CKRecord.
+				// For example:
+				// - a previous commit (not yet pushed to the cloud) changed CKRecord.firstName.
+				// - and this commit is also changing CKRecord.firstName.
+				//
+				// We can only use the changedKeys shortcut when it's possible for use to retrieve
+				// the corresponding values from the object. However, when this type of 'conflict' occurs,
+				// we can no longer use that shortcut. So we must modify the persisted information for
+				// the previous commit so that it stores the previous CKRecord in full,
+				// as opposed to just the changedKeys.
+				
+				YDBCKChangeRecord *pqPrevRecord =
+				  [masterQueue pendingQueue:pendingQueue recordForRecordID:recordID inChangeSetAtIndex:index];
+				pqPrevRecord.needsStoreFullRecord = YES;
 			}
 		}
-		
-		index++;
-	} // end for (YDBCKChangeSet *mqPrevChangeSet in changeSets)
+	}
 	
 	// Update current changeSet
 	
@@ -654,44 +980,34 @@ static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
 	
 	// Update previous changeSets (if needed)
 	
-	NSUInteger index = 0;
-	for (YDBCKChangeSet *mqPrevChangeSet in masterQueue->oldChangeSets)
+	NSIndexSet *indexes =
+	  [masterQueue changeSetIndexesWithModifiedRecordID:recordID databaseIdentifier:databaseIdentifier];
+	
+	for (NSUInteger index = [indexes firstIndex]; index != NSNotFound; index = [indexes indexGreaterThanIndex:index])
 	{
-		if (CompareDatabaseIdentifiers(databaseIdentifier, mqPrevChangeSet.databaseIdentifier))
+		YDBCKChangeSet *mqPrevChangeSet = [masterQueue->oldChangeSets objectAtIndex:index];
+		
+		YDBCKChangeRecord *mqPrevRecord = [mqPrevChangeSet->modifiedRecords objectForKey:recordID];
+		if (mqPrevRecord)
 		{
-			YDBCKChangeRecord *mqPrevRecord = [mqPrevChangeSet->modifiedRecords objectForKey:recordID];
-			if (mqPrevRecord)
+			if (mqPrevRecord.needsStoreFullRecord == NO)
 			{
-				if (mqPrevRecord.needsStoreFullRecord == NO)
-				{
-					// The masterPrevRecord is configured to only store the changedKeys array to disk.
-					//
-					// However, we're now detaching the rowid from the CKRecord.
-					//
-					// We can only use the changedKeys shortcut when it's possible for use to retrieve
-					// the corresponding values from the object. However, when the rowid is detached,
-					// we can no longer use that shortcut. So we must modify the persisted information for
-					// the previous commit so that it stores the previous CKRecord in full,
-					// as opposed to just the changedKeys.
-					
-					YDBCKChangeSet *pqPrevChangeSet = [pendingQueue->oldChangeSets objectAtIndex:index];
-					if (pqPrevChangeSet->modifiedRecords == nil)
-					{
-						pqPrevChangeSet->modifiedRecords =
-						  [[NSMutableDictionary alloc] initWithDictionary:mqPrevChangeSet->modifiedRecords
-						                                        copyItems:YES];
-						
-						pqPrevChangeSet.hasChangesToModifiedRecords = YES;
-					}
-					
-					YDBCKChangeRecord *pqPrevRecord = [pqPrevChangeSet->modifiedRecords objectForKey:recordID];
-					pqPrevRecord.needsStoreFullRecord = YES;
-				}
+				// The masterPrevRecord is configured to only store the changedKeys array to disk.
+				//
+				// However, we're now detaching the rowid from the CKRecord.
+				//
+				// We can only use the changedKeys shortcut when it's possible for use to retrieve
+				// the corresponding values from the object. However, when the rowid is detached,
+				// we can no longer use that shortcut. So we must modify the persisted information for
+				// the previous commit so that it stores the previous CKRecord in full,
+				// as opposed to just the changedKeys.
+				
+				YDBCKChangeRecord *pqPrevRecord =
+				  [masterQueue pendingQueue:pendingQueue recordForRecordID:recordID inChangeSetAtIndex:index];
+				pqPrevRecord.needsStoreFullRecord = YES;
 			}
 		}
-		
-		index++;
-	} // end for (YDBCKChangeSet *mqPrevChangeSet in changeSets)
+	}
 }
 
 /**
@@ -717,47 +1033,37 @@ static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
 	
 	// Update previous changeSets (if needed)
 	
-	NSUInteger index = 0;
-	for (YDBCKChangeSet *mqPrevChangeSet in masterQueue->oldChangeSets)
+	NSIndexSet *indexes =
+	  [masterQueue changeSetIndexesWithModifiedRecordID:recordID databaseIdentifier:databaseIdentifier];
+	
+	for (NSUInteger index = [indexes firstIndex]; index != NSNotFound; index = [indexes indexGreaterThanIndex:index])
 	{
-		if (CompareDatabaseIdentifiers(databaseIdentifier, mqPrevChangeSet.databaseIdentifier))
+		YDBCKChangeSet *mqPrevChangeSet = [masterQueue->oldChangeSets objectAtIndex:index];
+		
+		YDBCKChangeRecord *mqPrevRecord = [mqPrevChangeSet->modifiedRecords objectForKey:recordID];
+		if (mqPrevRecord)
 		{
-			YDBCKChangeRecord *mqPrevRecord = [mqPrevChangeSet->modifiedRecords objectForKey:recordID];
-			if (mqPrevRecord)
+			if (mqPrevRecord.needsStoreFullRecord == NO)
 			{
-				if (mqPrevRecord.needsStoreFullRecord == NO)
-				{
-					// The mqPrevRecord is configured to only store the changedKeys array to disk.
-					//
-					// However, we're now seeing conflicting changes to the same CKRecord.
-					// For example:
-					// - a previous commit (not yet pushed to the cloud) changed CKRecord.firstName.
-					// - and this commit is deleting the same CKRecord.
-					//
-					// We can only use the changedKeys shortcut when it's possible for use to retrieve
-					// the corresponding values from the object. However, when this type of 'conflict' occurs,
-					// we can no longer use that shortcut. So we must modify the persisted information for
-					// the previous commit so that it stores the previous CKRecord in full,
-					// as opposed to just the changedKeys.
-					
-					YDBCKChangeSet *pqPrevChangeSet = [pendingQueue->oldChangeSets objectAtIndex:index];
-					if (pqPrevChangeSet->modifiedRecords == nil)
-					{
-						pqPrevChangeSet->modifiedRecords =
-						  [[NSMutableDictionary alloc] initWithDictionary:mqPrevChangeSet->modifiedRecords
-						                                        copyItems:YES];
-						
-						pqPrevChangeSet.hasChangesToModifiedRecords = YES;
-					}
-					
-					YDBCKChangeRecord *pqPrevRecord = [pqPrevChangeSet->modifiedRecords objectForKey:recordID];
-					pqPrevRecord.needsStoreFullRecord = YES;
-				}
+				// The mqPrevRecord is configured to only store the changedKeys array to disk.
+				//
+				// However, we're now seeing conflicting changes to the same CKRecord.
+				// For example:
+				// - a previous commit (not yet pushed to the cloud) changed CKRecord.firstName.
+				// - and this commit is deleting the same CKRecord.
+				//
+				// We can only use the changedKeys shortcut when it's possible for use to retrieve
+				// the corresponding values from the object. However, when this type of 'conflict' occurs,
+				// we can no longer use that shortcut. So we must modify the persisted information for
+				// the previous commit so that it stores the previous CKRecord in full,
+				// as opposed to just the changedKeys.
+				
+				YDBCKChangeRecord *pqPrevRecord =
+				  [masterQueue pendingQueue:pendingQueue recordForRecordID:recordID inChangeSetAtIndex:index];
+				pqPrevRecord.needsStoreFullRecord = YES;
 			}
 		}
-		
-		index++;
-	} // end for (YDBCKChangeSet *mqPrevChangeSet in masterQueue->oldChangeSets)
+	}
 	
 	// Update current changeSet
 	
@@ -812,96 +1118,86 @@ static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
 	
 	CKRecordID *recordID = mergedRecord.recordID;
 	
-	NSUInteger index = 0;
-	for (YDBCKChangeSet *mqPrevChangeSet in masterQueue->oldChangeSets)
+	NSIndexSet *indexes =
+	  [masterQueue changeSetIndexesWithModifiedRecordID:recordID databaseIdentifier:databaseIdentifier];
+	
+	for (NSUInteger index = [indexes firstIndex]; index != NSNotFound; index = [indexes indexGreaterThanIndex:index])
 	{
-		if (CompareDatabaseIdentifiers(databaseIdentifier, mqPrevChangeSet.databaseIdentifier))
+		YDBCKChangeSet *mqPrevChangeSet = [masterQueue->oldChangeSets objectAtIndex:index];
+		
+		YDBCKChangeRecord *mqPrevRecord = [mqPrevChangeSet->modifiedRecords objectForKey:recordID];
+		if (mqPrevRecord)
 		{
-			YDBCKChangeRecord *mqPrevRecord = [mqPrevChangeSet->modifiedRecords objectForKey:recordID];
-			if (mqPrevRecord)
+			CKRecord *localRecord = mqPrevRecord.record;
+			NSSet *localRecordChangedKeysSet = mqPrevRecord.changedKeysSet;
+			
+			if (keysToRemove == nil)
+				keysToRemove = [NSMutableSet setWithCapacity:localRecordChangedKeysSet.count];
+			else
+				[keysToRemove removeAllObjects];
+			
+			if (keysToCompare == nil)
+				keysToCompare = [NSMutableSet setWithCapacity:localRecordChangedKeysSet.count];
+			else
+				[keysToCompare removeAllObjects];
+			
+			for (NSString *key in localRecordChangedKeysSet)
 			{
-				CKRecord *localRecord = mqPrevRecord.record;
-				NSSet *localRecordChangedKeysSet = mqPrevRecord.changedKeysSet;
-				
-				if (keysToRemove == nil)
-					keysToRemove = [NSMutableSet setWithCapacity:localRecordChangedKeysSet.count];
+				if ([mergedRecordChangedKeysSet containsObject:key])
+					[keysToCompare addObject:key];
 				else
-					[keysToRemove removeAllObjects];
-				
-				if (keysToCompare == nil)
-					keysToCompare = [NSMutableSet setWithCapacity:localRecordChangedKeysSet.count];
-				else
-					[keysToCompare removeAllObjects];
-				
-				for (NSString *key in localRecordChangedKeysSet)
-				{
-					if ([mergedRecordChangedKeysSet containsObject:key])
-						[keysToCompare addObject:key];
-					else
-						[keysToRemove addObject:key];
-				}
-				
-				for (NSString *key in keysToCompare)
-				{
-					id localValue = [localRecord objectForKey:key];
-					id mergedValue = [mergedRecord objectForKey:key];
-					
-					if ((localValue == nil && mergedValue == nil) || [localValue isEqual:mergedValue])
-					{
-						[mergedRecordHandledKeys addObject:key];
-					}
-					else
-					{
-						[keysToRemove addObject:key];
-					}
-				}
-				
-				// We need to get the system metadata from the mergedRecord,
-				// and inject the values from the localRecord.
-				CKRecord *newLocalRecord = [mergedRecord sanitizedCopy];
+					[keysToRemove addObject:key];
+			}
+			
+			for (NSString *key in keysToCompare)
+			{
+				id localValue = [localRecord objectForKey:key];
+				id mergedValue = [mergedRecord objectForKey:key];
 				
-				for (NSString *key in localRecord.changedKeys)
+				if ((localValue == nil && mergedValue == nil) || [localValue isEqual:mergedValue])
 				{
-					if (![keysToRemove containsObject:key])
-					{
-						// Remember: nil is a valid value.
-						// It indicates removal of the value for the key, which is a valid action.
-						
-						id value = [localRecord objectForKey:key];
-						[newLocalRecord setObject:value forKey:key];
-					}
+					[mergedRecordHandledKeys addObject:key];
 				}
-				
-				YDBCKChangeSet *pqPrevChangeSet = [pendingQueue->oldChangeSets objectAtIndex:index];
-				if (pqPrevChangeSet->modifiedRecords == nil)
+				else
 				{
-					pqPrevChangeSet->modifiedRecords =
-					  [[NSMutableDictionary alloc] initWithDictionary:mqPrevChangeSet->modifiedRecords
-					                                        copyItems:YES];
-					
-					pqPrevChangeSet.hasChangesToModifiedRecords = YES;
+					[keysToRemove addObject:key];
 				}
-				
-				if (newLocalRecord.changedKeys.count > 0)
-				{
-					// Update the record using the merged newLocalRecord
-					
-					YDBCKChangeRecord *pqPrevRecord = [pqPrevChangeSet->modifiedRecords objectForKey:recordID];
-					pqPrevRecord.record = newLocalRecord;
-				}
-				else
+			}
+			
+			// We need to get the system metadata from the mergedRecord,
+			// and inject the values from the localRecord.
+			CKRecord *newLocalRecord = [mergedRecord sanitizedCopy];
+			
+			for (NSString *key in localRecord.changedKeys)
+			{
+				if (![keysToRemove containsObject:key])
 				{
-					// Remove the record from the change-set.
-					// There's no longer any need to upload it since we've dismissed all the queued changes.
+					// Remember: nil is a valid value.
+					// It indicates removal of the value for the key, which is a valid action.
 					
-					[pqPrevChangeSet->modifiedRecords removeObjectForKey:recordID];
+					id value = [localRecord objectForKey:key];
+					[newLocalRecord setObject:value forKey:key];
 				}
+			}
 			
-			} // end if (mqPrevRecord)
-		} // end if (CompareDatabaseIdentifiers(databaseIdentifier, mqPrevChangeSet.databaseIdentifier))
+			if (newLocalRecord.changedKeys.count > 0)
+			{
+				// Update the record using the merged newLocalRecord
+				
+				YDBCKChangeRecord *pqPrevRecord =
+				  [masterQueue pendingQueue:pendingQueue recordForRecordID:recordID inChangeSetAtIndex:index];
+				pqPrevRecord.record = newLocalRecord;
+			}
+			else
+			{
+				// Remove the record from the change-set.
+				// There's no longer any need to upload it since we've dismissed all the queued changes.
+				
+				[masterQueue pendingQueue:pendingQueue removeModifiedRecordID:recordID fromChangeSetAtIndex:index];
+			}
 		
-		index++;
-	} // end for (YDBCKChangeSet *mqPrevChangeSet in masterQueue->oldChangeSets)
+		} // end if (mqPrevRecord)
+	} // end for (index in indexes)
 	
 	if (mergedRecordChangedKeysSet.count != mergedRecordHandledKeys.count)
 	{
@@ -963,48 +1259,36 @@ static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
 	__unsafe_unretained typeof(self) masterQueue = self;
 	
 	// Update previous changeSets (if needed)
+	//
+	// Check to see if we have queued modifications to push for this item
 	
-	NSUInteger index = 0;
-	for (YDBCKChangeSet *mqPrevChangeSet in masterQueue->oldChangeSets)
+	NSIndexSet *modifiedIndexes =
+	  [masterQueue changeSetIndexesWithModifiedRecordID:recordID databaseIdentifier:databaseIdentifier];
+	
+	for (NSUInteger index = [modifiedIndexes firstIndex];
+	     index != NSNotFound;
+	     index = [modifiedIndexes indexGreaterThanIndex:index])
 	{
-		if (CompareDatabaseIdentifiers(databaseIdentifier, mqPrevChangeSet.databaseIdentifier))
-		{
-			// Check to see if we have queued modifications to push for this item
-			
-			YDBCKChangeRecord *mqPrevRecord = [mqPrevChangeSet->modifiedRecords objectForKey:recordID];
-			if (mqPrevRecord)
-			{
-				YDBCKChangeSet *pqPrevChangeSet = [pendingQueue->oldChangeSets objectAtIndex:index];
-				if (pqPrevChangeSet->modifiedRecords == nil)
-				{
-					pqPrevChangeSet->modifiedRecords =
-					  [[NSMutableDictionary alloc] initWithDictionary:mqPrevChangeSet->modifiedRecords copyItems:YES];
-					
-					pqPrevChangeSet.hasChangesToModifiedRecords = YES;
-				}
-				
-				[pqPrevChangeSet->modifiedRecords removeObjectForKey:recordID];
-			}
-			
-			// Check to see if we have queued deletion for this item
-			
-			if ([mqPrevChangeSet->deletedRecordIDs containsObject:recordID])
-			{
-				YDBCKChangeSet *pqPrevChangeSet = [pendingQueue->oldChangeSets objectAtIndex:index];
-				if (pqPrevChangeSet->deletedRecordIDs == nil)
-				{
-					pqPrevChangeSet->deletedRecordIDs = [mqPrevChangeSet->deletedRecordIDs mutableCopy];
-					pqPrevChangeSet.hasChangesToDeletedRecordIDs = YES;
-				}
-				
-				[pqPrevChangeSet->deletedRecordIDs removeObject:recordID];
-			
-			}
-			
-		} // end if (CompareDatabaseIdentifiers(databaseIdentifier, mqPrevChangeSet.databaseIdentifier))
+		[masterQueue pendingQueue:pendingQueue removeModifiedRecordID:recordID fromChangeSetAtIndex:index];
+	}
+	
+	// Check to see if we have queued deletion for this item
+	
+	NSIndexSet *deletedIndexes =
+	  [masterQueue changeSetIndexesWithDeletedRecordID:recordID databaseIdentifier:databaseIdentifier];
+	
+	for (NSUInteger index = [deletedIndexes firstIndex];
+	     index != NSNotFound;
+	     index = [deletedIndexes indexGreaterThanIndex:index])
+	{
+		YDBCKChangeSet *pqPrevChangeSet =
+		  [masterQueue pendingQueue:pendingQueue deletedRecordIDsChangeSetAtIndex:index];
+		
+		[pqPrevChangeSet->deletedRecordIDs removeObject:recordID];
+		pqPrevChangeSet.hasChangesToDeletedRecordIDs = YES;
 		
-		index++;
-	} // end for (YDBCKChangeSet *mqPrevChangeSet in masterQueue->oldChangeSets)
+		[masterQueue pendingQueue:pendingQueue didRemoveDeletedRecordID:recordID fromChangeSetAtIndex:index];
+	}
 }
 
 /**
@@ -1031,93 +1315,62 @@ static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
 	
 	// Update inFlight changeSet of pendingQueue (if needed)
 	
-	if (isOpPartialCompletion)
+	if (isOpPartialCompletion && (masterQueue->oldChangeSets.count > 0))
 	{
-		YDBCKChangeSet *pqInFlightChangeSet = [pendingQueue->oldChangeSets firstObject];
-		
-		if (pqInFlightChangeSet->modifiedRecords == nil)
-		{
-			YDBCKChangeSet *mqInFlightChangeSet = [masterQueue->oldChangeSets firstObject];
-			
-			if (mqInFlightChangeSet->modifiedRecords)
-			{
-				pqInFlightChangeSet->modifiedRecords =
-				  [[NSMutableDictionary alloc] initWithDictionary:mqInFlightChangeSet->modifiedRecords copyItems:YES];
-			}
-			else
-			{
-				pqInFlightChangeSet->modifiedRecords = [[NSMutableDictionary alloc] init];
-			}
-			
-			pqInFlightChangeSet.hasChangesToModifiedRecords = YES;
-		}
-		
-		[pqInFlightChangeSet->modifiedRecords removeObjectForKey:recordID];
+		[masterQueue pendingQueue:pendingQueue removeModifiedRecordID:recordID fromChangeSetAtIndex:0];
 	}
 	
 	// Update previous changeSets (if needed)
 	
 	CKRecord *sanitizedRecord = nil;
 	
-	NSUInteger i = 0;
-	for (YDBCKChangeSet *mqPrevChangeSet in masterQueue->oldChangeSets)
+	NSIndexSet *indexes =
+	  [masterQueue changeSetIndexesWithModifiedRecordID:recordID databaseIdentifier:databaseIdentifier];
+	
+	for (NSUInteger i = [indexes firstIndex]; i != NSNotFound; i = [indexes indexGreaterThanIndex:i])
 	{
 		// Skip inFlight changeSet
 		if (i == 0) {
-			i++;
 			continue;
 		}
 		
 		// Process other previous changeSets
-
-		if (CompareDatabaseIdentifiers(databaseIdentifier, mqPrevChangeSet.databaseIdentifier))
+		
+		YDBCKChangeRecord *pqChangeRecord =
+		  [masterQueue pendingQueue:pendingQueue recordForRecordID:recordID inChangeSetAtIndex:i];
+		
+		if (pqChangeRecord == nil) {
+			continue;
+		}
+		
+		if (sanitizedRecord == nil)
 		{
-			if ([mqPrevChangeSet->modifiedRecords objectForKey:recordID])
-			{
-				YDBCKChangeSet *pqPrevChangeSet = [pendingQueue->oldChangeSets objectAtIndex:i];
-				
-				if (pqPrevChangeSet->modifiedRecords == nil)
-				{
-					pqPrevChangeSet->modifiedRecords =
-					  [[NSMutableDictionary alloc] initWithDictionary:mqPrevChangeSet->modifiedRecords copyItems:YES];
-					
-					pqPrevChangeSet.hasChangesToModifiedRecords = YES;
-				}
-				
-				if (sanitizedRecord == nil)
-				{
-					sanitizedRecord = [record sanitizedCopy];
-				}
-				
-				YDBCKChangeRecord *pqChangeRecord = [pqPrevChangeSet->modifiedRecords objectForKey:recordID];
-				
-				CKRecord *originalRecord = pqChangeRecord.record;
-				CKRecord *mergedRecord = [sanitizedRecord safeCopy];
-				
-				// The 'originalRecord' contains all the values we need to sync to the cloud.
-				// But the 'sanitizedRecord' contains the proper system fields within the CKRecord internals
-				// that reflect the proper sync state we have with the server.
-				//
-				// Because the internal sync-state stuff is private, we cannot access it.
-				// So we copy the needed values from the originalRecord into a new CKRecord container
-				// that already has the updated sync-state fields.
-				
-				for (NSString *changedKey in [originalRecord changedKeys])
-				{
-					// Remember: nil is a valid value.
-					// It indicates removal of the value for the key, which is a valid action.
-					
-					id value = [originalRecord objectForKey:changedKey];
-					[mergedRecord setObject:value forKey:changedKey];
-				}
-				
-				pqChangeRecord.record = mergedRecord;
-				
-			} // end if ([mqPrevChangeSet->modifiedRecords objectForKey:recordID])
-		} // end if (CompareDatabaseIdentifiers(databaseIdentifier, mqPrevChangeSet.databaseIdentifier))
+			sanitizedRecord = [record sanitizedCopy];
+		}
 		
-		i++;
-	} // end for (YDBCKChangeSet *mqPrevChangeSet in masterQueue->oldChangeSets)
+		CKRecord *originalRecord = pqChangeRecord.record;
+		CKRecord *mergedRecord = [sanitizedRecord safeCopy];
+		
+		// The 'originalRecord' contains all the values we need to sync to the cloud.
+		// But the 'sanitizedRecord' contains the proper system fields within the CKRecord internals
+		// that reflect the proper sync state we have with the server.
+		//
+		// Because the internal sync-state stuff is private, we cannot access it.
+		// So we copy the needed values from the originalRecord into a new CKRecord container
+		// that already has the updated sync-state fields.
+		
+		for (NSString *changedKey in [originalRecord changedKeys])
+		{
+			// Remember: nil is a valid value.
+			// It indicates removal of the value for the key, which is a valid action.
+			
+			id value = [originalRecord objectForKey:changedKey];
+			[mergedRecord setObject:value forKey:changedKey];
+		}
+		
+		pqChangeRecord.record = mergedRecord;
+		
+	} // end for (i in indexes)
 }
 
 /**
@@ -1138,22 +1391,19 @@ static BOOL CompareDatabaseIdentifiers(NSString *dbid1, NSString *dbid2)
 	
 	__unsafe_unretained typeof(self) masterQueue = self;
 	
-	// Update inFlight changeSet of pendingQueue
+	if (masterQueue->oldChangeSets.count == 0) return;
 	
-	YDBCKChangeSet *pqInFlightChangeSet = [pendingQueue->oldChangeSets firstObject];
+	// Update inFlight changeSet of pendingQueue
 	
-	if (pqInFlightChangeSet->deletedRecordIDs == nil)
-	{
-		YDBCKChangeSet *mqInFlightChangeSet = [masterQueue->oldChangeSets firstObject];
-		
-		pqInFlightChangeSet->deletedRecordIDs = [mqInFlightChangeSet->deletedRecordIDs mutableCopy];
-	}
+	YDBCKChangeSet *pqInFlightChangeSet = [masterQueue pendingQueue:pendingQueue deletedRecordIDsChangeSetAtIndex:0];
 	
 	NSUInteger index = [pqInFlightChangeSet->deletedRecordIDs indexOfObject:recordID];
 	if (index != NSNotFound)
 	{
 		[pqInFlightChangeSet->deletedRecordIDs removeObjectAtIndex:index];
 		pqInFlightChangeSet.hasChangesToDeletedRecordIDs = YES;
+		
+		[masterQueue pendingQueue:pendingQueue didRemoveDeletedRecordID:recordID fromChangeSetAtIndex:0];
 	}
 }
 
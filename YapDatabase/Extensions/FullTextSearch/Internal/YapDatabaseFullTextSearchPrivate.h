@@ -8,6 +8,7 @@
 #import "YapDatabaseTransaction.h"
 
 #import "YapMutationStack.h"
+#import "YapCache.h"
 
 #ifdef SQLITE_HAS_CODEC
   #import <SQLCipher/sqlite3.h>
@@ -22,6 +23,11 @@
  */
 #define YAP_DATABASE_FTS_CLASS_VERSION 1
 
+/**
+ * Changeset keys (for changeset notification dictionary)
+ */
+static NSString *const changeset_key_indexChanged = @"indexChanged";
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark -
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -50,10 +56,38 @@
 	NSString *ftsVersion;
 	NSString *versionTag;
 	
+	NSUInteger populationChunkSize;
+	BOOL contentless;
+	
 	id columnNamesSharedKeySet;
 }
 
 - (NSString *)tableName;
+- (NSString *)snippetTableName;
+
+- (BOOL)isContentless;
++ (BOOL)supportsContentlessDelete;
+- (BOOL)usesFastTokenizer;
+
++ (void)registerFastTokenizerIfNeededForTable:(NSString *)tableName database:(sqlite3 *)db;
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The (complete) results of a query, as stored in the connection's queryCache.
+ */
+@interface YapDatabaseFullTextSearchCachedResult : NSObject {
+@public
+	
+	NSData *rowids;      // int64_t[]
+	NSArray *snippets;   // NSString[] (same order as rowids, NSNull for a nil snippet), or nil if snippets weren't requested
+}
+
+- (NSUInteger)count;
 
 @end
 
@@ -70,6 +104,14 @@
 	NSMutableDictionary *blockDict;
 	
 	YapMutationStack_Bool *mutationStack;
+	
+	BOOL hasSnippetTable;
+	BOOL hasFastTokenizer;
+	
+	YapCache<NSString *, YapDatabaseFullTextSearchCachedResult *> *queryCache;
+	NSUInteger queryCacheLimit;
+	
+	BOOL indexChanged;
 }
 
 - (id)initWithParent:(YapDatabaseFullTextSearch *)parent databaseConnection:(YapDatabaseConnection *)databaseConnection;
@@ -77,6 +119,11 @@
 - (void)postCommitCleanup;
 - (void)postRollbackCleanup;
 
+- (void)didChangeIndex;
+
+- (YapDatabaseFullTextSearchCachedResult *)cachedResultForKey:(NSString *)key;
+- (void)setCachedResult:(YapDatabaseFullTextSearchCachedResult *)result forKey:(NSString *)key;
+
 - (sqlite3_stmt *)insertRowidStatement;
 - (sqlite3_stmt *)setRowidStatement;
 - (sqlite3_stmt *)removeRowidStatement;
@@ -84,9 +131,20 @@
 - (sqlite3_stmt *)queryStatement;
 - (sqlite3_stmt *)bm25QueryStatement;
 - (sqlite3_stmt *)bm25QueryStatementWithWeights:(NSArray<NSNumber *> *)weights;
+
+// These are only cached when using the default weights.
+// If weights are given, the caller must finalize the returned statement.
+- (sqlite3_stmt *)bm25LimitQueryStatementWithWeights:(NSArray<NSNumber *> *)weights;
+- (sqlite3_stmt *)bm25KeysetQueryStatementWithWeights:(NSArray<NSNumber *> *)weights;
+- (sqlite3_stmt *)bm25RankQueryStatementWithWeights:(NSArray<NSNumber *> *)weights;
+
 - (sqlite3_stmt *)querySnippetStatement;
 - (sqlite3_stmt *)rowidQueryStatement;
 - (sqlite3_stmt *)rowidQuerySnippetStatement;
+- (sqlite3_stmt *)populateChunkStatement;
+- (sqlite3_stmt *)snippetTableInsertStatement;
+- (sqlite3_stmt *)snippetTableQueryStatement;
+- (sqlite3_stmt *)snippetTableRemoveAllStatement;
 
 @end
 
@@ -116,4 +174,28 @@
 - (NSString *)rowid:(int64_t)rowid matches:(NSString *)query
                         withSnippetOptions:(YapDatabaseFullTextSearchSnippetOptions *)options;
 
+- (BOOL)populateNextChunkOfSize:(NSUInteger)chunkSize;
+
+- (void)enumerateBm25OrderedRowidsMatching:(NSString *)query
+                               withWeights:(NSArray<NSNumber *> *)weights
+                                     limit:(NSUInteger)limit
+                                    offset:(NSUInteger)offset
+                               afterCursor:(YapDatabaseFullTextSearchBm25Cursor *)cursor
+                                usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, double rank, BOOL *stop))block;
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface YapDatabaseFullTextSearchBm25Cursor () {
+@public
+	
+	double rank;
+	int64_t rowid;
+}
+
+- (instancetype)initWithRank:(double)rank rowid:(int64_t)rowid;
+
 @end
@@ -0,0 +1,34 @@
+#import <Foundation/Foundation.h>
+
+#ifdef SQLITE_HAS_CODEC
+  #import <SQLCipher/sqlite3.h>
+#else
+  #import "sqlite3.h"
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Registers the YapDatabaseFullTextSearchFastTokenizer with the given sqlite connection.
+ * (An FTS5 tokenizer must be registered with every connection that reads from or writes to the FTS table.)
+ *
+ * The tokenizer produces the same tokens as the default unicode61 tokenizer.
+ * However, text that is pure ASCII is handled by a vectorized (SSE2/NEON) fast path,
+ * which classifies & case-folds 16 bytes at a time.
+ * Any text containing non-ASCII characters is handed to the unicode61 tokenizer.
+ *
+ * Supported arguments:
+ * - edge_ngram MIN MAX : Also index the prefixes (of MIN to MAX characters) of each token.
+ *
+ * Returns SQLITE_OK on success.
+ * Returns SQLITE_ERROR (and logs an error) if the tokenizer isn't supported, or FTS5 isn't available.
+ */
+int YapDatabaseFullTextSearchRegisterFastTokenizer(sqlite3 *db);
+
+/**
+ * Returns non-zero if the tokenizer can be registered with this version of sqlite.
+ * (Registration requires sqlite3_bind_pointer, which was added in sqlite 3.20.0.)
+ */
+int YapDatabaseFullTextSearchFastTokenizerIsSupported(void);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,468 @@
+#import "YapDatabaseFullTextSearchTokenizer.h"
+#import "YapDatabaseFullTextSearch.h"
+#import "YapDatabaseLogging.h"
+
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+  #define YDB_TOKENIZER_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  #include <arm_neon.h>
+  #define YDB_TOKENIZER_NEON 1
+#endif
+
+#if ! __has_feature(objc_arc)
+#warning This file must be compiled with ARC. Use -fobjc-arc flag (or convert project to ARC).
+#endif
+
+/**
+ * Define log level for this file: OFF, ERROR, WARN, INFO, VERBOSE
+ * See YapDatabaseLogging.h for more information.
+**/
+#if DEBUG
+  static const int ydbLogLevel = YDBLogLevelWarning;
+#else
+  static const int ydbLogLevel = YDBLogLevelWarning;
+#endif
+#pragma unused(ydbLogLevel)
+
+/**
+ * Text up to this size is case-folded into a buffer on the stack.
+ * Larger text uses a heap allocated buffer.
+**/
+#define YDB_TOKENIZER_STACK_BUFFER_SIZE 1024
+
+typedef int (*YDBTokenCallback)(void *pCtx, int tflags, const char *pToken, int nToken, int iStart, int iEnd);
+
+typedef struct YDBFastTokenizer {
+
+	fts5_tokenizer unicode61;       // fallback for non-ASCII text
+	Fts5Tokenizer *unicode61Instance;
+
+	int ngramMin;                   // zero if edge n-grams are disabled
+	int ngramMax;
+
+} YDBFastTokenizer;
+
+typedef struct YDBFallbackContext {
+
+	YDBFastTokenizer *tokenizer;
+	void *pCtx;
+	int flags;
+	YDBTokenCallback xToken;
+
+} YDBFallbackContext;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Classification
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns YES if every byte is 7-bit ASCII.
+**/
+static BOOL IsASCII(const uint8_t *text, int length)
+{
+	int i = 0;
+
+#if YDB_TOKENIZER_SSE2
+
+	for (; (i + 16) <= length; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+		if (_mm_movemask_epi8(v) != 0) return NO;
+	}
+
+#elif YDB_TOKENIZER_NEON
+
+	for (; (i + 16) <= length; i += 16)
+	{
+		uint8x16_t v = vld1q_u8(text + i);
+		if (vmaxvq_u8(v) >= 0x80) return NO;
+	}
+
+#endif
+
+	for (; i < length; i++)
+	{
+		if (text[i] >= 0x80) return NO;
+	}
+
+	return YES;
+}
+
+/**
+ * Case-folds the given bytes (ASCII only) into dst,
+ * and returns a bitmask where bit N is set if src[N] is a token character ([A-Za-z0-9]).
+ *
+ * This matches the behavior of the unicode61 tokenizer for ASCII text.
+**/
+static uint32_t ClassifyAndFold_Scalar(const uint8_t *src, uint8_t *dst, int length)
+{
+	uint32_t mask = 0;
+
+	for (int i = 0; i < length; i++)
+	{
+		uint8_t c = src[i];
+
+		if ((uint8_t)(c - 'A') <= ('Z' - 'A')) {
+			c |= 0x20;
+		}
+
+		if (((uint8_t)(c - 'a') <= ('z' - 'a')) || ((uint8_t)(c - '0') <= 9)) {
+			mask |= (1u << i);
+		}
+
+		dst[i] = c;
+	}
+
+	return mask;
+}
+
+/**
+ * Vectorized version of ClassifyAndFold_Scalar, for exactly 16 bytes.
+**/
+static inline uint32_t ClassifyAndFold_16(const uint8_t *src, uint8_t *dst)
+{
+#if YDB_TOKENIZER_SSE2
+
+	// Signed comparisons are fine here, as the text is known to be ASCII.
+
+	__m128i v = _mm_loadu_si128((const __m128i *)src);
+
+	__m128i isUpper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+	                                _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+
+	__m128i folded = _mm_or_si128(v, _mm_and_si128(isUpper, _mm_set1_epi8(0x20)));
+
+	__m128i isLower = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)),
+	                                _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+
+	__m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+	                                _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+
+	_mm_storeu_si128((__m128i *)dst, folded);
+
+	return (uint32_t)_mm_movemask_epi8(_mm_or_si128(isLower, isDigit));
+
+#elif YDB_TOKENIZER_NEON
+
+	static const uint8_t kBits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+
+	uint8x16_t v = vld1q_u8(src);
+
+	uint8x16_t isUpper = vcleq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8('Z' - 'A'));
+	uint8x16_t folded = vorrq_u8(v, vandq_u8(isUpper, vdupq_n_u8(0x20)));
+
+	uint8x16_t isLower = vcleq_u8(vsubq_u8(folded, vdupq_n_u8('a')), vdupq_n_u8('z' - 'a'));
+	uint8x16_t isDigit = vcleq_u8(vsubq_u8(v, vdupq_n_u8('0')), vdupq_n_u8(9));
+
+	vst1q_u8(dst, folded);
+
+	// There's no movemask on NEON, so we weight each lane by its bit, and sum each half.
+
+	uint8x16_t bits = vandq_u8(vorrq_u8(isLower, isDigit), vld1q_u8(kBits));
+
+	return (uint32_t)vaddv_u8(vget_low_u8(bits)) | ((uint32_t)vaddv_u8(vget_high_u8(bits)) << 8);
+
+#else
+
+	return ClassifyAndFold_Scalar(src, dst, 16);
+
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Token Emission
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Emits the edge n-grams (prefixes) of a token as colocated tokens.
+ * Lengths are measured in characters, so multi-byte UTF-8 characters are never split.
+**/
+static int EmitEdgeNgrams(YDBFastTokenizer *tokenizer,
+                          void *pCtx, int flags, YDBTokenCallback xToken,
+                          const char *pToken, int nToken, int iStart, int iEnd)
+{
+	if (tokenizer->ngramMin == 0) return SQLITE_OK;
+
+	// Prefixes are only indexed. A query token simply matches against the indexed prefixes.
+	if ((flags & FTS5_TOKENIZE_DOCUMENT) == 0) return SQLITE_OK;
+
+	int rc = SQLITE_OK;
+	int numChars = 0;
+
+	for (int i = 0; i < nToken && rc == SQLITE_OK; i++)
+	{
+		// Skip UTF-8 continuation bytes
+		if ((((uint8_t)pToken[i]) & 0xC0) == 0x80) continue;
+
+		// A prefix of numChars characters ends at byte i.
+		if (numChars >= tokenizer->ngramMin)
+		{
+			rc = xToken(pCtx, FTS5_TOKEN_COLOCATED, pToken, i, iStart, iEnd);
+		}
+
+		numChars++;
+		if (numChars > tokenizer->ngramMax) break;
+	}
+
+	return rc;
+}
+
+static int FallbackTokenCallback(void *pCtx, int tflags, const char *pToken, int nToken, int iStart, int iEnd)
+{
+	YDBFallbackContext *context = (YDBFallbackContext *)pCtx;
+
+	int rc = context->xToken(context->pCtx, tflags, pToken, nToken, iStart, iEnd);
+
+	if ((rc == SQLITE_OK) && ((tflags & FTS5_TOKEN_COLOCATED) == 0))
+	{
+		rc = EmitEdgeNgrams(context->tokenizer, context->pCtx, context->flags, context->xToken,
+		                    pToken, nToken, iStart, iEnd);
+	}
+
+	return rc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark FTS5 Tokenizer
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void FastTokenizerDelete(Fts5Tokenizer *pTok)
+{
+	YDBFastTokenizer *tokenizer = (YDBFastTokenizer *)pTok;
+	if (tokenizer == NULL) return;
+
+	if (tokenizer->unicode61Instance) {
+		tokenizer->unicode61.xDelete(tokenizer->unicode61Instance);
+	}
+
+	sqlite3_free(tokenizer);
+}
+
+static int FastTokenizerCreate(void *pUserData, const char **azArg, int nArg, Fts5Tokenizer **ppOut)
+{
+	fts5_api *api = (fts5_api *)pUserData;
+
+	*ppOut = NULL;
+
+	YDBFastTokenizer *tokenizer = sqlite3_malloc(sizeof(YDBFastTokenizer));
+	if (tokenizer == NULL) return SQLITE_NOMEM;
+
+	memset(tokenizer, 0, sizeof(YDBFastTokenizer));
+
+	for (int i = 0; i < nArg; i++)
+	{
+		if ((sqlite3_stricmp(azArg[i], "edge_ngram") == 0) && ((i + 2) < nArg))
+		{
+			tokenizer->ngramMin = atoi(azArg[i + 1]);
+			tokenizer->ngramMax = atoi(azArg[i + 2]);
+			i += 2;
+
+			if ((tokenizer->ngramMin < 1) || (tokenizer->ngramMax < tokenizer->ngramMin))
+			{
+				sqlite3_free(tokenizer);
+				return SQLITE_ERROR;
+			}
+		}
+		else
+		{
+			// Unknown argument.
+			// Note: Options such as tokenchars & separators aren't supported by the fast path.
+
+			sqlite3_free(tokenizer);
+			return SQLITE_ERROR;
+		}
+	}
+
+	void *unicode61UserData = NULL;
+
+	int rc = api->xFindTokenizer(api, "unicode61", &unicode61UserData, &tokenizer->unicode61);
+	if (rc == SQLITE_OK)
+	{
+		rc = tokenizer->unicode61.xCreate(unicode61UserData, NULL, 0, &tokenizer->unicode61Instance);
+	}
+
+	if (rc != SQLITE_OK)
+	{
+		FastTokenizerDelete((Fts5Tokenizer *)tokenizer);
+		return rc;
+	}
+
+	*ppOut = (Fts5Tokenizer *)tokenizer;
+	return SQLITE_OK;
+}
+
+static int FastTokenizerTokenize(Fts5Tokenizer *pTok,
+                                 void *pCtx,
+                                 int flags,
+                                 const char *pText, int nText,
+                                 YDBTokenCallback xToken)
+{
+	YDBFastTokenizer *tokenizer = (YDBFastTokenizer *)pTok;
+
+	const uint8_t *src = (const uint8_t *)pText;
+
+	if (!IsASCII(src, nText))
+	{
+		// Scalar fallback
+
+		YDBFallbackContext context = { tokenizer, pCtx, flags, xToken };
+
+		return tokenizer->unicode61.xTokenize(tokenizer->unicode61Instance, &context, flags,
+		                                      pText, nText, FallbackTokenCallback);
+	}
+
+	uint8_t stackBuffer[YDB_TOKENIZER_STACK_BUFFER_SIZE];
+	uint8_t *folded = stackBuffer;
+
+	if (nText > YDB_TOKENIZER_STACK_BUFFER_SIZE)
+	{
+		folded = sqlite3_malloc(nText);
+		if (folded == NULL) return SQLITE_NOMEM;
+	}
+
+	int rc = SQLITE_OK;
+
+	BOOL inToken = NO;
+	int tokenStart = 0;
+
+	for (int base = 0; (base < nText) && (rc == SQLITE_OK); base += 16)
+	{
+		int length = MIN(16, nText - base);
+
+		uint32_t mask;
+		uint32_t lengthMask;
+
+		if (length == 16)
+		{
+			mask = ClassifyAndFold_16(src + base, folded + base);
+			lengthMask = 0xFFFF;
+		}
+		else
+		{
+			mask = ClassifyAndFold_Scalar(src + base, folded + base, length);
+			lengthMask = (1u << length) - 1;
+		}
+
+		// Each set bit in transitions is a byte where the class differs from the previous byte.
+		// That is, either the start or the end of a token.
+
+		uint32_t transitions = (mask ^ ((mask << 1) | (inToken ? 1 : 0))) & lengthMask;
+
+		while (transitions && (rc == SQLITE_OK))
+		{
+			int i = __builtin_ctz(transitions);
+			transitions &= (transitions - 1);
+
+			if (mask & (1u << i))
+			{
+				tokenStart = base + i;
+				inToken = YES;
+			}
+			else
+			{
+				int tokenEnd = base + i;
+				const char *token = (const char *)(folded + tokenStart);
+
+				rc = xToken(pCtx, 0, token, (tokenEnd - tokenStart), tokenStart, tokenEnd);
+				if (rc == SQLITE_OK)
+				{
+					rc = EmitEdgeNgrams(tokenizer, pCtx, flags, xToken,
+					                    token, (tokenEnd - tokenStart), tokenStart, tokenEnd);
+				}
+
+				inToken = NO;
+			}
+		}
+	}
+
+	if (inToken && (rc == SQLITE_OK))
+	{
+		const char *token = (const char *)(folded + tokenStart);
+
+		rc = xToken(pCtx, 0, token, (nText - tokenStart), tokenStart, nText);
+		if (rc == SQLITE_OK)
+		{
+			rc = EmitEdgeNgrams(tokenizer, pCtx, flags, xToken, token, (nText - tokenStart), tokenStart, nText);
+		}
+	}
+
+	if (folded != stackBuffer) {
+		sqlite3_free(folded);
+	}
+
+	return rc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Registration
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The fts5_api pointer is fetched via sqlite3_bind_pointer, which was added in sqlite 3.20.0.
+ * We check both the headers (compile time) and the linked library (runtime),
+ * as the library may be older than the headers.
+**/
+#define YDB_TOKENIZER_MIN_SQLITE_VERSION 3020000
+
+int YapDatabaseFullTextSearchFastTokenizerIsSupported(void)
+{
+#if SQLITE_VERSION_NUMBER >= YDB_TOKENIZER_MIN_SQLITE_VERSION
+	return (sqlite3_libversion_number() >= YDB_TOKENIZER_MIN_SQLITE_VERSION);
+#else
+	return 0;
+#endif
+}
+
+static fts5_api *FTS5API(sqlite3 *db)
+{
+	fts5_api *api = NULL;
+
+	if (!YapDatabaseFullTextSearchFastTokenizerIsSupported())
+	{
+		YDBLogError(@"The %@ tokenizer requires sqlite 3.20.0 or later (found %s)",
+		            YapDatabaseFullTextSearchFastTokenizer, sqlite3_libversion());
+		return NULL;
+	}
+
+#if SQLITE_VERSION_NUMBER >= YDB_TOKENIZER_MIN_SQLITE_VERSION
+	sqlite3_stmt *statement = NULL;
+
+	int status = sqlite3_prepare_v2(db, "SELECT fts5(?1);", -1, &statement, NULL);
+	if (status == SQLITE_OK)
+	{
+		sqlite3_bind_pointer(statement, 1, (void *)&api, "fts5_api_ptr", NULL);
+		sqlite3_step(statement);
+	}
+	else
+	{
+		YDBLogError(@"Error fetching fts5_api: %d %s", status, sqlite3_errmsg(db));
+	}
+
+	sqlite3_finalize(statement);
+#endif
+
+	return api;
+}
+
+int YapDatabaseFullTextSearchRegisterFastTokenizer(sqlite3 *db)
+{
+	fts5_api *api = FTS5API(db);
+	if (api == NULL) return SQLITE_ERROR;
+
+	fts5_tokenizer tokenizer = {
+		FastTokenizerCreate,
+		FastTokenizerDelete,
+		FastTokenizerTokenize
+	};
+
+	const char *name = [YapDatabaseFullTextSearchFastTokenizer UTF8String];
+
+	int status = api->xCreateTokenizer(api, name, (void *)api, &tokenizer, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error registering FTS tokenizer (%s): %d %s", name, status, sqlite3_errmsg(db));
+	}
+
+	return status;
+}
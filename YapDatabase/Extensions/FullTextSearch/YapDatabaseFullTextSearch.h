@@ -24,6 +24,27 @@ extern NSString *const YapDatabaseFullTextSearchFTS5Version;
 extern NSString *const YapDatabaseFullTextSearchFTS4Version;
 extern NSString *const YapDatabaseFullTextSearchFTS3Version;
 
+/**
+ * The name of a custom FTS5 tokenizer that ships with YapDatabase.
+ *
+ * It produces the same tokens as the default unicode61 tokenizer,
+ * but uses a vectorized (SSE2/NEON) fast path for text that is pure ASCII,
+ * which classifies & case-folds 16 bytes at a time.
+ * Text containing non-ASCII characters is handed to the unicode61 tokenizer.
+ *
+ * To use it, pass it via the 'tokenize' option, and the extension will automatically register it per connection:
+ *
+ * options = @{ @"tokenize": @"'yap_fast'" };
+ *
+ * The tokenizer can optionally index the edge n-grams (prefixes) of each token,
+ * which allows prefix matching without the '*' syntax:
+ *
+ * options = @{ @"tokenize": @"'yap_fast edge_ngram 2 8'" };
+ *
+ * Requires FTS5 (YapDatabaseFullTextSearchFTS5Version).
+ */
+extern NSString *const YapDatabaseFullTextSearchFastTokenizer;
+
 
 @interface YapDatabaseFullTextSearch : YapDatabaseExtension
 
@@ -64,6 +85,51 @@ extern NSString *const YapDatabaseFullTextSearchFTS3Version;
 @property (nonatomic, copy, readonly, nullable) NSString *versionTag;
 @property (nonatomic, copy, readonly, nullable) NSString *ftsVersion;
 
+/**
+ * By default, the FTS table is populated within the same readWriteTransaction that registers the extension.
+ * For a large database, this may take a considerable amount of time, during which all writers are blocked.
+ *
+ * If you set a non-zero chunk size, the extension will instead populate the FTS table incrementally.
+ * Registration will only create the (empty) table, and the existing rows are then indexed
+ * in chunks of the given size, each within its own short readWriteTransaction.
+ * (See -[YapDatabaseFullTextSearchConnection asyncPopulateWithCompletionQueue:completionBlock:].)
+ *
+ * New writes are indexed immediately, as usual.
+ * But until population completes, queries may not include older rows that have yet to be indexed.
+ * You can check for this via -[YapDatabaseFullTextSearchTransaction isPartialIndex].
+ *
+ * The progress is persisted, so population will resume where it left off if the app is relaunched.
+ *
+ * This property must be set before registering the extension.
+ *
+ * The default value is zero (populate everything during registration).
+ */
+@property (nonatomic, assign, readwrite) NSUInteger populationChunkSize;
+
+/**
+ * By default, the FTS table stores its own copy of the indexed text.
+ * So the text is effectively stored twice: once (serialized) in the database, and again within the FTS table.
+ *
+ * If you enable this option, the extension instead creates a contentless FTS5 table,
+ * which only stores the full-text index itself. This significantly reduces the disk footprint (and write volume).
+ *
+ * Queries (including bm25 ordering) work as usual.
+ * Snippets are also supported, but since the FTS table no longer stores the text,
+ * the handler is invoked (for each matching row) to supply the column text on demand.
+ * Snippet queries are therefore more expensive than with a regular table.
+ *
+ * This option requires FTS5 (YapDatabaseFullTextSearchFTS5Version),
+ * and a version of sqlite that supports contentless_delete (3.43.0 or later).
+ * It's ignored (and a warning is logged) for other FTS versions, or if the sqlite version is too old.
+ * In which case the regular FTS table is used.
+ *
+ * This property must be set before registering the extension.
+ * Changing the value will automatically re-create & re-populate the FTS table.
+ *
+ * The default value is NO.
+ */
+@property (nonatomic, assign, readwrite) BOOL contentless;
+
 @end
 
 NS_ASSUME_NONNULL_END
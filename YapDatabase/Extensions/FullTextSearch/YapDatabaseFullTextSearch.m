@@ -1,8 +1,10 @@
 #import "YapDatabaseFullTextSearch.h"
 #import "YapDatabaseFullTextSearchPrivate.h"
+#import "YapDatabaseFullTextSearchTokenizer.h"
 
 #import "YapDatabasePrivate.h"
 #import "YapDatabaseExtensionPrivate.h"
+#import "YapDatabaseString.h"
 
 #import "YapDatabaseLogging.h"
 
@@ -26,6 +28,8 @@ NSString *const YapDatabaseFullTextSearchFTS5Version = @"fts5";
 NSString *const YapDatabaseFullTextSearchFTS4Version = @"fts4";
 NSString *const YapDatabaseFullTextSearchFTS3Version = @"fts3";
 
+NSString *const YapDatabaseFullTextSearchFastTokenizer = @"yap_fast";
+
 
 @implementation YapDatabaseFullTextSearch
 
@@ -38,6 +42,8 @@ NSString *const YapDatabaseFullTextSearchFTS3Version = @"fts3";
 	NSString *tableName = [self tableNameForRegisteredName:registeredName];
 	NSString *dropTable = [NSString stringWithFormat:@"DROP TABLE IF EXISTS \"%@\";", tableName];
 	
+	[self registerFastTokenizerIfNeededForTable:tableName database:db];
+	
 	int status;
 	
 	status = sqlite3_exec(db, [dropTable UTF8String], NULL, NULL, NULL);
@@ -47,6 +53,46 @@ NSString *const YapDatabaseFullTextSearchFTS3Version = @"fts3";
 	}
 }
 
+/**
+ * FTS5 instantiates the table's tokenizer in order to DROP the table.
+ * So if the existing table uses our custom tokenizer, it must first be registered with the given connection.
+ * (The extension may no longer be registered, or may no longer be using the custom tokenizer.)
+**/
++ (void)registerFastTokenizerIfNeededForTable:(NSString *)tableName database:(sqlite3 *)db
+{
+	sqlite3_stmt *statement = NULL;
+	
+	int status = sqlite3_prepare_v2(db, "SELECT \"sql\" FROM \"sqlite_master\" WHERE \"name\" = ?;", -1, &statement, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error creating statement: %d %s", status, sqlite3_errmsg(db));
+		return;
+	}
+	
+	YapDatabaseString _tableName; MakeYapDatabaseString(&_tableName, tableName);
+	sqlite3_bind_text(statement, SQLITE_BIND_START, _tableName.str, _tableName.length, SQLITE_STATIC);
+	
+	BOOL usesFastTokenizer = NO;
+	
+	if (sqlite3_step(statement) == SQLITE_ROW)
+	{
+		const unsigned char *text = sqlite3_column_text(statement, SQLITE_COLUMN_START);
+		if (text)
+		{
+			NSString *sql = [NSString stringWithUTF8String:(const char *)text];
+			usesFastTokenizer = ([sql rangeOfString:YapDatabaseFullTextSearchFastTokenizer].location != NSNotFound);
+		}
+	}
+	
+	sqlite3_finalize(statement);
+	FreeYapDatabaseString(&_tableName);
+	
+	if (usesFastTokenizer)
+	{
+		YapDatabaseFullTextSearchRegisterFastTokenizer(db);
+	}
+}
+
 + (NSArray *)previousClassNames
 {
 	return @[ @"YapCollectionsDatabaseFullTextSearch" ];
@@ -64,6 +110,8 @@ NSString *const YapDatabaseFullTextSearchFTS3Version = @"fts3";
 @synthesize handler = handler;
 @synthesize versionTag = versionTag;
 @synthesize ftsVersion = ftsVersion;
+@synthesize populationChunkSize = populationChunkSize;
+@synthesize contentless = contentless;
 
 - (id)initWithColumnNames:(NSArray *)inColumnNames
                   handler:(YapDatabaseFullTextSearchHandler *)inHandler
@@ -147,4 +195,49 @@ NSString *const YapDatabaseFullTextSearchFTS3Version = @"fts3";
 	return [[self class] tableNameForRegisteredName:self.registeredName];
 }
 
+/**
+ * Returns YES if the 'tokenize' option references our custom tokenizer,
+ * in which case it needs to be registered with every connection.
+**/
+- (BOOL)usesFastTokenizer
+{
+	if (![ftsVersion isEqualToString:YapDatabaseFullTextSearchFTS5Version]) return NO;
+	
+	NSString *tokenize = [options objectForKey:@"tokenize"];
+	if (![tokenize isKindOfClass:[NSString class]]) return NO;
+	
+	return [tokenize rangeOfString:YapDatabaseFullTextSearchFastTokenizer].location != NSNotFound;
+}
+
+/**
+ * The contentless option is only supported for FTS5,
+ * and requires the contentless_delete option (sqlite 3.43.0 or later).
+ * Otherwise the regular FTS table (which stores its own copy of the text) is used.
+**/
+- (BOOL)isContentless
+{
+	if (!contentless) return NO;
+	if (![ftsVersion isEqualToString:YapDatabaseFullTextSearchFTS5Version]) return NO;
+	
+	return [[self class] supportsContentlessDelete];
+}
+
+/**
+ * The contentless_delete option was added in sqlite 3.43.0.
+ * We check the runtime version, as the linked library may be older than the headers.
+**/
++ (BOOL)supportsContentlessDelete
+{
+	return (sqlite3_libversion_number() >= 3043000);
+}
+
+/**
+ * The snippet table is a TEMP table (per connection),
+ * used to generate snippets when the FTS table is contentless.
+**/
+- (NSString *)snippetTableName
+{
+	return [NSString stringWithFormat:@"fts_%@_snippet", self.registeredName];
+}
+
 @end
@@ -31,6 +31,45 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, strong, readonly) YapDatabaseFullTextSearch *fullTextSearch;
 
+/**
+ * The queryCache speeds up repeated queries. (enumerateXMatching:usingBlock: & enumerateXMatching:withSnippetOptions:)
+ *
+ * When a query is fully enumerated, its matching rowids (and snippets, if requested) are stored in the cache.
+ * So running the same query again, at the same database snapshot, is served from memory.
+ * The cache is cleared whenever the FTS index changes,
+ * either by a readWriteTransaction on this connection, or by a commit from another connection.
+ *
+ * Queries that were stopped early, or that match more than 10,000 rows, aren't cached.
+ *
+ * By default the queryCache is enabled and has a limit of 10.
+ *
+ * To disable the cache entirely, set queryCacheEnabled to NO.
+ * To use an inifinite cache size, set the queryCacheLimit to ZERO.
+ */
+@property (atomic, assign, readwrite) BOOL queryCacheEnabled;
+@property (atomic, assign, readwrite) NSUInteger queryCacheLimit;
+
+/**
+ * If the extension was configured with a non-zero populationChunkSize,
+ * then the FTS table is populated incrementally (see YapDatabaseFullTextSearch.populationChunkSize).
+ *
+ * This method drives that population.
+ * It asynchronously executes a series of short readWriteTransactions on this connection,
+ * each of which indexes the next chunk of rows, until the index has caught up with the database.
+ * Other connections are free to perform writes in between the chunks.
+ *
+ * If the index is already complete, the completionBlock is invoked after a single (no-op) transaction.
+ *
+ * @param completionQueue
+ *   The dispatch_queue to invoke the completionBlock on.
+ *   If NULL, dispatch_get_main_queue() is automatically used.
+ *
+ * @param completionBlock
+ *   An optional block to execute once the FTS table has been fully populated.
+ */
+- (void)asyncPopulateWithCompletionQueue:(nullable dispatch_queue_t)completionQueue
+                         completionBlock:(nullable dispatch_block_t)completionBlock;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -1,5 +1,6 @@
 #import "YapDatabaseFullTextSearchConnection.h"
 #import "YapDatabaseFullTextSearchPrivate.h"
+#import "YapDatabaseFullTextSearchTokenizer.h"
 
 #import "YapDatabasePrivate.h"
 #import "YapDatabaseExtensionPrivate.h"
@@ -21,6 +22,11 @@
 #endif
 #pragma unused(ydbLogLevel)
 
+/**
+ * The chunk size used by asyncPopulate if the extension wasn't configured with a populationChunkSize.
+**/
+static NSUInteger const kDefaultPopulationChunkSize = 500;
+
 
 @implementation YapDatabaseFullTextSearchConnection {
 @private
@@ -31,9 +37,16 @@
 	sqlite3_stmt *removeAllStatement;
 	sqlite3_stmt *queryStatement;
 	sqlite3_stmt *bm25QueryStatement;
+	sqlite3_stmt *bm25LimitQueryStatement;
+	sqlite3_stmt *bm25KeysetQueryStatement;
+	sqlite3_stmt *bm25RankQueryStatement;
 	sqlite3_stmt *querySnippetStatement;
 	sqlite3_stmt *rowidQueryStatement;
 	sqlite3_stmt *rowidQuerySnippetStatement;
+	sqlite3_stmt *populateChunkStatement;
+	sqlite3_stmt *snippetTableInsertStatement;
+	sqlite3_stmt *snippetTableQueryStatement;
+	sqlite3_stmt *snippetTableRemoveAllStatement;
 }
 
 @synthesize fullTextSearch = parent;
@@ -45,12 +58,29 @@
 	{
 		parent = inParent;
 		databaseConnection = inDatabaseConnection;
+		
+		queryCacheLimit = 10;
+		queryCache = [[YapCache alloc] initWithCountLimit:queryCacheLimit];
+		queryCache.allowedKeyClasses = [NSSet setWithObject:[NSString class]];
+		queryCache.allowedObjectClasses = [NSSet setWithObject:[YapDatabaseFullTextSearchCachedResult class]];
+		
+		// FTS5 tokenizers are registered per sqlite connection,
+		// and must be available before the FTS table is created or accessed.
+		
+		// If registration fails, the extension transaction refuses to create or use the FTS table.
+		
+		if ([parent usesFastTokenizer])
+		{
+			int status = YapDatabaseFullTextSearchRegisterFastTokenizer(databaseConnection->db);
+			hasFastTokenizer = (status == SQLITE_OK);
+		}
 	}
 	return self;
 }
 
 - (void)dealloc
 {
+	[queryCache removeAllObjects];
 	[self _flushStatements];
 }
 
@@ -62,9 +92,16 @@
 	sqlite_finalize_null(&removeAllStatement);
 	sqlite_finalize_null(&queryStatement);
 	sqlite_finalize_null(&bm25QueryStatement);
+	sqlite_finalize_null(&bm25LimitQueryStatement);
+	sqlite_finalize_null(&bm25KeysetQueryStatement);
+	sqlite_finalize_null(&bm25RankQueryStatement);
 	sqlite_finalize_null(&querySnippetStatement);
 	sqlite_finalize_null(&rowidQueryStatement);
 	sqlite_finalize_null(&rowidQuerySnippetStatement);
+	sqlite_finalize_null(&populateChunkStatement);
+	sqlite_finalize_null(&snippetTableInsertStatement);
+	sqlite_finalize_null(&snippetTableQueryStatement);
+	sqlite_finalize_null(&snippetTableRemoveAllStatement);
 }
 
 /**
@@ -72,6 +109,11 @@
 **/
 - (void)_flushMemoryWithFlags:(YapDatabaseConnectionFlushMemoryFlags)flags
 {
+	if (flags & YapDatabaseConnectionFlushMemoryFlags_Caches)
+	{
+		[queryCache removeAllObjects];
+	}
+	
 	if (flags & YapDatabaseConnectionFlushMemoryFlags_Statements)
 	{
 		[self _flushStatements];
@@ -90,6 +132,83 @@
 	return parent;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Configuration
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (BOOL)queryCacheEnabled
+{
+	__block BOOL result = NO;
+	
+	dispatch_block_t block = ^{
+		
+		result = (self->queryCache == nil) ? NO : YES;
+	};
+	
+	if (dispatch_get_specific(databaseConnection->IsOnConnectionQueueKey))
+		block();
+	else
+		dispatch_sync(databaseConnection->connectionQueue, block);
+	
+	return result;
+}
+
+- (void)setQueryCacheEnabled:(BOOL)queryCacheEnabled
+{
+	dispatch_block_t block = ^{
+		
+		if (queryCacheEnabled)
+		{
+			if (self->queryCache == nil)
+			{
+				self->queryCache = [[YapCache alloc] initWithCountLimit:self->queryCacheLimit];
+				self->queryCache.allowedKeyClasses = [NSSet setWithObject:[NSString class]];
+				self->queryCache.allowedObjectClasses = [NSSet setWithObject:[YapDatabaseFullTextSearchCachedResult class]];
+			}
+		}
+		else
+		{
+			self->queryCache = nil;
+		}
+	};
+	
+	if (dispatch_get_specific(databaseConnection->IsOnConnectionQueueKey))
+		block();
+	else
+		dispatch_async(databaseConnection->connectionQueue, block);
+}
+
+- (NSUInteger)queryCacheLimit
+{
+	__block NSUInteger result = 0;
+	
+	dispatch_block_t block = ^{
+		
+		result = self->queryCacheLimit;
+	};
+	
+	if (dispatch_get_specific(databaseConnection->IsOnConnectionQueueKey))
+		block();
+	else
+		dispatch_sync(databaseConnection->connectionQueue, block);
+	
+	return result;
+}
+
+- (void)setQueryCacheLimit:(NSUInteger)newQueryCacheLimit
+{
+	dispatch_block_t block = ^{
+		
+		self->queryCacheLimit = newQueryCacheLimit;
+		self->queryCache.countLimit = self->queryCacheLimit;
+	};
+	
+	if (dispatch_get_specific(databaseConnection->IsOnConnectionQueueKey))
+		block();
+	else
+		dispatch_async(databaseConnection->connectionQueue, block);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Transactions
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -138,35 +257,144 @@
 - (void)postCommitCleanup
 {
 	[mutationStack clear];
+	
+	indexChanged = NO;
 }
 
 - (void)postRollbackCleanup
 {
 	[mutationStack clear];
+	
+	if (indexChanged)
+	{
+		[queryCache removeAllObjects];
+		indexChanged = NO;
+	}
 }
 
 /**
  * Required override method from YapDatabaseExtensionConnection
 **/
-- (void)getInternalChangeset:(NSMutableDictionary __unused **)internalChangesetPtr
-           externalChangeset:(NSMutableDictionary __unused **)externalChangesetPtr
-              hasDiskChanges:(BOOL __unused *)hasDiskChangesPtr
+- (void)getInternalChangeset:(NSMutableDictionary **)internalChangesetPtr
+           externalChangeset:(NSMutableDictionary **)externalChangesetPtr
+              hasDiskChanges:(BOOL *)hasDiskChangesPtr
 {
-	// Nothing to do for this particular extension.
-	//
-	// YapDatabaseExtension rows a "not implemented" exception
-	// to ensure extensions have implementations of all required methods.
+	NSMutableDictionary *internalChangeset = nil;
+	BOOL hasDiskChanges = NO;
+	
+	if (indexChanged)
+	{
+		// Other connections need to know the FTS index changed, so they can clear their queryCache.
+		
+		internalChangeset = [NSMutableDictionary dictionaryWithCapacity:1];
+		internalChangeset[changeset_key_indexChanged] = @(YES);
+		
+		hasDiskChanges = YES;
+	}
+	
+	*internalChangesetPtr = internalChangeset;
+	*externalChangesetPtr = nil;
+	*hasDiskChangesPtr = hasDiskChanges;
 }
 
 /**
  * Required override method from YapDatabaseExtensionConnection
 **/
-- (void)processChangeset:(NSDictionary __unused *)changeset
+- (void)processChangeset:(NSDictionary *)changeset
 {
-	// Nothing to do for this particular extension.
-	//
-	// YapDatabaseExtension rows a "not implemented" exception
-	// to ensure extensions have implementations of all required methods.
+	if ([changeset[changeset_key_indexChanged] boolValue])
+	{
+		[queryCache removeAllObjects];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Query Cache
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Invoked by our transaction whenever it modifies the FTS table.
+**/
+- (void)didChangeIndex
+{
+	if (!indexChanged)
+	{
+		indexChanged = YES;
+		[queryCache removeAllObjects];
+	}
+}
+
+- (YapDatabaseFullTextSearchCachedResult *)cachedResultForKey:(NSString *)key
+{
+	// Once the index has been modified within a readWriteTransaction,
+	// the cache is bypassed until the transaction is committed (or rolled back).
+	
+	if (indexChanged) return nil;
+	
+	return [queryCache objectForKey:key];
+}
+
+- (void)setCachedResult:(YapDatabaseFullTextSearchCachedResult *)result forKey:(NSString *)key
+{
+	if (indexChanged) return;
+	
+	[queryCache setObject:result forKey:key];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Population
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)asyncPopulateWithCompletionQueue:(dispatch_queue_t)completionQueue
+                         completionBlock:(dispatch_block_t)completionBlock
+{
+	if (completionQueue == NULL && completionBlock != NULL)
+		completionQueue = dispatch_get_main_queue();
+	
+	NSUInteger chunkSize = parent->populationChunkSize;
+	if (chunkSize == 0)
+		chunkSize = kDefaultPopulationChunkSize;
+	
+	[self _asyncPopulateNextChunkOfSize:chunkSize completionQueue:completionQueue completionBlock:completionBlock];
+}
+
+/**
+ * Each chunk is indexed within its own readWriteTransaction.
+ * Once the transaction completes, the next one is queued (if needed).
+ * This gives other connections a chance to acquire the write lock in between chunks.
+**/
+- (void)_asyncPopulateNextChunkOfSize:(NSUInteger)chunkSize
+                      completionQueue:(dispatch_queue_t)completionQueue
+                      completionBlock:(dispatch_block_t)completionBlock
+{
+	YapDatabaseConnection *dbConnection = databaseConnection;
+	NSString *extName = [parent registeredName];
+	
+	__block BOOL isComplete = NO;
+	
+	[dbConnection asyncReadWriteWithBlock:^(YapDatabaseReadWriteTransaction *transaction) {
+		
+		YapDatabaseFullTextSearchTransaction *ftsTransaction = [transaction ext:extName];
+		if (ftsTransaction)
+			isComplete = [ftsTransaction populateNextChunkOfSize:chunkSize];
+		else
+			isComplete = YES; // extension was unregistered
+		
+	} completionQueue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) completionBlock:^{
+		
+		if (isComplete)
+		{
+			if (completionBlock) {
+				dispatch_async(completionQueue, completionBlock);
+			}
+		}
+		else
+		{
+			[self _asyncPopulateNextChunkOfSize:chunkSize
+			                    completionQueue:completionQueue
+			                    completionBlock:completionBlock];
+		}
+	}];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -269,7 +497,17 @@
 	sqlite3_stmt **statement = &removeAllStatement;
 	if (*statement == NULL)
 	{
-		NSString *string = [NSString stringWithFormat:@"DELETE FROM \"%@\";", [parent tableName]];
+		NSString *string;
+		if ([parent isContentless])
+		{
+			// Contentless tables support a more efficient command for this
+			string = [NSString stringWithFormat:
+			  @"INSERT INTO \"%1$@\" (\"%1$@\") VALUES ('delete-all');", [parent tableName]];
+		}
+		else
+		{
+			string = [NSString stringWithFormat:@"DELETE FROM \"%@\";", [parent tableName]];
+		}
 		
 		sqlite3 *db = databaseConnection->db;
 		
@@ -346,6 +584,76 @@
     return statement;
 }
 
+/**
+ * Prepares one of the top-K bm25 statements.
+ *
+ * The format is given the tableName (%1$@) and the bm25 expression (%2$@).
+ * When the default weights are used, the statement is cached.
+ * Otherwise it's prepared on demand, and the caller is responsible for finalizing it.
+**/
+- (sqlite3_stmt *)bm25StatementWithFormat:(NSString *)format
+                                  weights:(NSArray<NSNumber *> *)weights
+                                    cache:(sqlite3_stmt **)cachedStatement
+{
+	BOOL useCache = ([weights count] == 0);
+	
+	if (useCache && *cachedStatement) {
+		return *cachedStatement;
+	}
+	
+	NSString *tableName = [parent tableName];
+	NSString *bm25;
+	
+	if (useCache)
+		bm25 = [NSString stringWithFormat:@"bm25(\"%@\")", tableName];
+	else
+		bm25 = [NSString stringWithFormat:@"bm25(\"%@\", %@)", tableName, [weights componentsJoinedByString:@", "]];
+	
+	NSString *string = [NSString stringWithFormat:format, tableName, bm25];
+	
+	sqlite3 *db = databaseConnection->db;
+	sqlite3_stmt *statement = NULL;
+	
+	int status = sqlite3_prepare_v2(db, [string UTF8String], -1, &statement, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error creating prepared statement: %d %s", status, sqlite3_errmsg(db));
+		return NULL;
+	}
+	
+	if (useCache) {
+		*cachedStatement = statement;
+	}
+	return statement;
+}
+
+- (sqlite3_stmt *)bm25LimitQueryStatementWithWeights:(NSArray<NSNumber *> *)weights
+{
+	NSString *format =
+	  @"SELECT \"rowid\", %2$@ FROM \"%1$@\" WHERE \"%1$@\" MATCH ?"
+	  @" ORDER BY %2$@ ASC, \"rowid\" ASC LIMIT ? OFFSET ?;";
+	
+	return [self bm25StatementWithFormat:format weights:weights cache:&bm25LimitQueryStatement];
+}
+
+- (sqlite3_stmt *)bm25KeysetQueryStatementWithWeights:(NSArray<NSNumber *> *)weights
+{
+	NSString *format =
+	  @"SELECT \"rowid\", %2$@ FROM \"%1$@\" WHERE \"%1$@\" MATCH ?1"
+	  @" AND (%2$@ > ?2 OR (%2$@ = ?2 AND \"rowid\" > ?3))"
+	  @" ORDER BY %2$@ ASC, \"rowid\" ASC LIMIT ?4 OFFSET ?5;";
+	
+	return [self bm25StatementWithFormat:format weights:weights cache:&bm25KeysetQueryStatement];
+}
+
+- (sqlite3_stmt *)bm25RankQueryStatementWithWeights:(NSArray<NSNumber *> *)weights
+{
+	NSString *format =
+	  @"SELECT \"rowid\", %2$@ FROM \"%1$@\" WHERE \"%1$@\" MATCH ?;";
+	
+	return [self bm25StatementWithFormat:format weights:weights cache:&bm25RankQueryStatement];
+}
+
 - (sqlite3_stmt *)querySnippetStatement
 {
 	sqlite3_stmt **statement = &querySnippetStatement;
@@ -408,4 +716,121 @@
 	return *statement;
 }
 
+- (sqlite3_stmt *)populateChunkStatement
+{
+	sqlite3_stmt **statement = &populateChunkStatement;
+	if (*statement == NULL)
+	{
+		const char *stmt =
+		  "SELECT \"rowid\", \"collection\", \"key\" FROM \"database2\""
+		  " WHERE \"rowid\" > ? ORDER BY \"rowid\" ASC LIMIT ?;";
+		
+		sqlite3 *db = databaseConnection->db;
+		
+		int status = sqlite3_prepare_v2(db, stmt, (int)strlen(stmt)+1, statement, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Error creating prepared statement: %d %s", status, sqlite3_errmsg(db));
+		}
+	}
+	
+	return *statement;
+}
+
+/**
+ * The snippet table statements are only used if the FTS table is contentless.
+ * The snippet table must be created before these statements are prepared.
+**/
+- (sqlite3_stmt *)snippetTableInsertStatement
+{
+	sqlite3_stmt **statement = &snippetTableInsertStatement;
+	if (*statement == NULL)
+	{
+		NSMutableString *string = [NSMutableString stringWithCapacity:100];
+		[string appendFormat:@"INSERT INTO temp.\"%@\" (\"rowid\"", [parent snippetTableName]];
+		
+		for (NSString *columnName in parent->columnNames)
+		{
+			[string appendFormat:@", \"%@\"", columnName];
+		}
+		
+		[string appendString:@") VALUES (?"];
+		
+		NSUInteger count = [parent->columnNames count];
+		NSUInteger i;
+		for (i = 0; i < count; i++)
+		{
+			[string appendString:@", ?"];
+		}
+		
+		[string appendString:@");"];
+		
+		sqlite3 *db = databaseConnection->db;
+		
+		int status = sqlite3_prepare_v2(db, [string UTF8String], -1, statement, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Error creating prepared statement: %d %s", status, sqlite3_errmsg(db));
+		}
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)snippetTableQueryStatement
+{
+	sqlite3_stmt **statement = &snippetTableQueryStatement;
+	if (*statement == NULL)
+	{
+		// Note: The snippet table is always fts5,
+		// and the fts5 snippet function takes the column index as its first parameter.
+		
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT snippet(\"%1$@\", ?, ?, ?, ?, ?) FROM temp.\"%1$@\" WHERE \"%1$@\" MATCH ?;",
+		  [parent snippetTableName]];
+		
+		sqlite3 *db = databaseConnection->db;
+		
+		int status = sqlite3_prepare_v2(db, [string UTF8String], -1, statement, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Error creating prepared statement: %d %s", status, sqlite3_errmsg(db));
+		}
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)snippetTableRemoveAllStatement
+{
+	sqlite3_stmt **statement = &snippetTableRemoveAllStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:@"DELETE FROM temp.\"%@\";", [parent snippetTableName]];
+		
+		sqlite3 *db = databaseConnection->db;
+		
+		int status = sqlite3_prepare_v2(db, [string UTF8String], -1, statement, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Error creating prepared statement: %d %s", status, sqlite3_errmsg(db));
+		}
+	}
+	
+	return *statement;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation YapDatabaseFullTextSearchCachedResult
+
+- (NSUInteger)count
+{
+	return [rowids length] / sizeof(int64_t);
+}
+
 @end
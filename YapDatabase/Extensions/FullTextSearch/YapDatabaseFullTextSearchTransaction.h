@@ -5,6 +5,25 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ * Marks a position within a bm25 ordered result set.
+ *
+ * Returned from the cursor-based bm25 methods, and passed back in to fetch the next page.
+ * Unlike an offset, the cost of fetching the next page doesn't grow with the number of pages already fetched,
+ * and rows inserted/removed before the cursor don't cause rows to be skipped or repeated.
+ *
+ * A cursor is only meaningful for the same query & weights that produced it.
+ */
+@interface YapDatabaseFullTextSearchBm25Cursor : NSObject <NSCopying>
+
+/**
+ * The bm25 rank of the row at the cursor position.
+ * Better matches have lower (more negative) values.
+ */
+@property (nonatomic, readonly) double rank;
+
+@end
+
 /**
  * Welcome to YapDatabase!
  *
@@ -30,6 +49,16 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @interface YapDatabaseFullTextSearchTransaction : YapDatabaseExtensionTransaction
 
+/**
+ * Returns YES if the FTS table is still being populated incrementally.
+ * (See YapDatabaseFullTextSearch.populationChunkSize)
+ *
+ * While this is the case, query results are only partial:
+ * rows that were inserted or modified after population began are indexed,
+ * but older rows may not be indexed yet.
+ */
+@property (nonatomic, readonly) BOOL isPartialIndex;
+
 // Regular query matching
 
 - (void)enumerateKeysMatching:(NSString *)query
@@ -62,6 +91,85 @@ NS_ASSUME_NONNULL_BEGIN
                              withWeights:(nullable NSArray<NSNumber *> *)weights
                               usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, __nullable id metadata, BOOL *stop))block;
 
+// FTS5 bm25 ordering (top-K)
+//
+// Only the best matching rows are computed, via "ORDER BY bm25(...) LIMIT ? OFFSET ?",
+// so latency tracks the limit rather than the total number of matches.
+// Rows with equal rank are ordered by rowid, so pages are stable.
+//
+// A limit of zero returns no results.
+
+- (void)enumerateBm25OrderedKeysMatching:(NSString *)query
+                             withWeights:(nullable NSArray<NSNumber *> *)weights
+                                   limit:(NSUInteger)limit
+                                  offset:(NSUInteger)offset
+                              usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block;
+
+- (void)enumerateBm25OrderedKeysAndMetadataMatching:(NSString *)query
+                                        withWeights:(nullable NSArray<NSNumber *> *)weights
+                                              limit:(NSUInteger)limit
+                                             offset:(NSUInteger)offset
+                                         usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, __nullable id metadata, BOOL *stop))block;
+
+- (void)enumerateBm25OrderedKeysAndObjectsMatching:(NSString *)query
+                                       withWeights:(nullable NSArray<NSNumber *> *)weights
+                                             limit:(NSUInteger)limit
+                                            offset:(NSUInteger)offset
+                                        usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, BOOL *stop))block;
+
+- (void)enumerateBm25OrderedRowsMatching:(NSString *)query
+                             withWeights:(nullable NSArray<NSNumber *> *)weights
+                                   limit:(NSUInteger)limit
+                                  offset:(NSUInteger)offset
+                              usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, __nullable id metadata, BOOL *stop))block;
+
+// FTS5 bm25 ordering (keyset pagination)
+//
+// Enumerates up to limit rows, starting immediately after the given cursor (or from the beginning if nil).
+// Returns a cursor for the last enumerated row, to be passed in to fetch the next page.
+// Returns nil if the end of the result set was reached.
+
+- (nullable YapDatabaseFullTextSearchBm25Cursor *)
+        enumerateBm25OrderedKeysMatching:(NSString *)query
+                             withWeights:(nullable NSArray<NSNumber *> *)weights
+                                   limit:(NSUInteger)limit
+                             afterCursor:(nullable YapDatabaseFullTextSearchBm25Cursor *)cursor
+                              usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block;
+
+- (nullable YapDatabaseFullTextSearchBm25Cursor *)
+        enumerateBm25OrderedKeysAndMetadataMatching:(NSString *)query
+                                        withWeights:(nullable NSArray<NSNumber *> *)weights
+                                              limit:(NSUInteger)limit
+                                        afterCursor:(nullable YapDatabaseFullTextSearchBm25Cursor *)cursor
+                                         usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, __nullable id metadata, BOOL *stop))block;
+
+- (nullable YapDatabaseFullTextSearchBm25Cursor *)
+        enumerateBm25OrderedKeysAndObjectsMatching:(NSString *)query
+                                       withWeights:(nullable NSArray<NSNumber *> *)weights
+                                             limit:(NSUInteger)limit
+                                       afterCursor:(nullable YapDatabaseFullTextSearchBm25Cursor *)cursor
+                                        usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, BOOL *stop))block;
+
+- (nullable YapDatabaseFullTextSearchBm25Cursor *)
+        enumerateBm25OrderedRowsMatching:(NSString *)query
+                             withWeights:(nullable NSArray<NSNumber *> *)weights
+                                   limit:(NSUInteger)limit
+                             afterCursor:(nullable YapDatabaseFullTextSearchBm25Cursor *)cursor
+                              usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, __nullable id metadata, BOOL *stop))block;
+
+// FTS5 bm25 ordering (top-K + filtering)
+//
+// When matches need to be filtered in Objective-C, the limit can't be pushed into sqlite.
+// Instead, the matches are streamed unsorted (in a single pass),
+// and the best limit rows that pass the filter are kept in a bounded heap.
+// This avoids sorting the full match set, and only the top rows are fetched from the database.
+
+- (void)enumerateBm25OrderedKeysMatching:(NSString *)query
+                             withWeights:(nullable NSArray<NSNumber *> *)weights
+                                   limit:(NSUInteger)limit
+                                  filter:(BOOL (NS_NOESCAPE^)(NSString *collection, NSString *key))filter
+                              usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block;
+
 // Query matching + Snippets
 
 - (void)enumerateKeysMatching:(NSString *)query
@@ -24,6 +24,13 @@ static NSString *const ext_key__classVersion       = @"classVersion";
 static NSString *const ext_key__versionTag         = @"versionTag";
 static NSString *const ext_key__ftsVersion         = @"ftsVersion";
 static NSString *const ext_key__version_deprecated = @"version";
+static NSString *const ext_key__populateRowid      = @"populateRowid";
+static NSString *const ext_key__contentless        = @"contentless";
+
+/**
+ * Query results with more rows than this aren't added to the connection's queryCache.
+**/
+static NSUInteger const kMaxCachedResultCount = 10000;
 
 
 @implementation YapDatabaseFullTextSearchTransaction
@@ -51,6 +58,8 @@ static NSString *const ext_key__version_deprecated = @"version";
 **/
 - (BOOL)createIfNeeded
 {
+	if (![self hasRequiredTokenizer]) return NO;
+	
 	int oldClassVersion = 0;
 	BOOL hasOldClassVersion = [self getIntValue:&oldClassVersion forExtensionKey:ext_key__classVersion persistent:YES];
 	int classVersion = YAP_DATABASE_FTS_CLASS_VERSION;
@@ -64,10 +73,13 @@ static NSString *const ext_key__version_deprecated = @"version";
 		}
 		
 		if (![self createTable]) return NO;
-		if (![self populate]) return NO;
+		if (![self beginPopulation]) return NO;
 		
 		[self setIntValue:classVersion forExtensionKey:ext_key__classVersion persistent:YES];
 		
+		BOOL contentless = [parentConnection->parent isContentless];
+		[self setBoolValue:contentless forExtensionKey:ext_key__contentless persistent:YES];
+		
 		NSString *versionTag = parentConnection->parent->versionTag;
 		[self setStringValue:versionTag forExtensionKey:ext_key__versionTag persistent:YES];
         
@@ -87,6 +99,9 @@ static NSString *const ext_key__version_deprecated = @"version";
         
         NSString *oldFtsVesrion = [self stringValueForExtensionKey:ext_key__ftsVersion persistent:YES];
 		
+		BOOL contentless = [parentConnection->parent isContentless];
+		BOOL oldContentless = [self boolValueForExtensionKey:ext_key__contentless persistent:YES];
+		
 		BOOL hasOldVersion_deprecated = NO;
 		if (oldVersionTag == nil)
 		{
@@ -101,22 +116,37 @@ static NSString *const ext_key__version_deprecated = @"version";
 			}
 		}
 		
-		if (![oldVersionTag isEqualToString:versionTag] || ![oldFtsVesrion isEqualToString:ftsVersion])
+		if (![oldVersionTag isEqualToString:versionTag] ||
+		    ![oldFtsVesrion isEqualToString:ftsVersion] ||
+		    (oldContentless != contentless))
 		{
 			if (![self dropTable]) return NO;
 			if (![self createTable]) return NO;
-			if (![self populate]) return NO;
+			if (![self beginPopulation]) return NO;
 			
 			[self setStringValue:versionTag forExtensionKey:ext_key__versionTag persistent:YES];
 			[self setStringValue:ftsVersion forExtensionKey:ext_key__ftsVersion persistent:YES];
+			[self setBoolValue:contentless forExtensionKey:ext_key__contentless persistent:YES];
 			
 			if (hasOldVersion_deprecated)
 				[self removeValueForExtensionKey:ext_key__version_deprecated persistent:YES];
 		}
-		else if (hasOldVersion_deprecated)
+		else
 		{
-			[self removeValueForExtensionKey:ext_key__version_deprecated persistent:YES];
-			[self setStringValue:versionTag forExtensionKey:ext_key__versionTag persistent:YES];
+			if (hasOldVersion_deprecated)
+			{
+				[self removeValueForExtensionKey:ext_key__version_deprecated persistent:YES];
+				[self setStringValue:versionTag forExtensionKey:ext_key__versionTag persistent:YES];
+			}
+			
+			// An incremental population may have been interrupted (e.g. app was quit).
+			// If the extension is no longer configured for incremental population,
+			// then we finish it now, as the user is expecting a complete index after registration.
+			
+			if ([self isPartialIndex] && (parentConnection->parent->populationChunkSize == 0))
+			{
+				[self populateNextChunkOfSize:0];
+			}
 		}
 	}
 	
@@ -136,6 +166,24 @@ static NSString *const ext_key__version_deprecated = @"version";
 **/
 - (BOOL)prepareIfNeeded
 {
+	return [self hasRequiredTokenizer];
+}
+
+/**
+ * Internal method.
+ *
+ * If the extension is configured to use the custom tokenizer,
+ * the FTS table can't be created or accessed unless the tokenizer was registered with this connection.
+**/
+- (BOOL)hasRequiredTokenizer
+{
+	if ([parentConnection->parent usesFastTokenizer] && !parentConnection->hasFastTokenizer)
+	{
+		YDBLogError(@"Unable to use FTS extension (%@): failed registering the %@ tokenizer",
+		            [self registeredName], YapDatabaseFullTextSearchFastTokenizer);
+		return NO;
+	}
+	
 	return YES;
 }
 
@@ -151,6 +199,10 @@ static NSString *const ext_key__version_deprecated = @"version";
 	NSString *tableName = [self tableName];
 	NSString *dropTable = [NSString stringWithFormat:@"DROP TABLE IF EXISTS \"%@\";", tableName];
 	
+	// The old table may have used a different tokenizer (which must be registered in order to drop it).
+	
+	[YapDatabaseFullTextSearch registerFastTokenizerIfNeededForTable:tableName database:db];
+	
 	int status = sqlite3_exec(db, [dropTable UTF8String], NULL, NULL, NULL);
 	if (status != SQLITE_OK)
 	{
@@ -178,8 +230,53 @@ static NSString *const ext_key__version_deprecated = @"version";
     
     NSString *ftsVersion = parentConnection->parent->ftsVersion;
 	
+	if (parentConnection->parent->contentless && ![parentConnection->parent isContentless])
+	{
+		if (![ftsVersion isEqualToString:YapDatabaseFullTextSearchFTS5Version])
+		{
+			YDBLogWarn(@"Ignoring contentless option for registeredName(%@): requires fts5", [self registeredName]);
+		}
+		else
+		{
+			YDBLogWarn(@"Ignoring contentless option for registeredName(%@):"
+			           @" requires sqlite 3.43.0 or later (contentless_delete), found %s",
+			           [self registeredName], sqlite3_libversion());
+		}
+	}
+	
 	NSMutableString *createTable = [NSMutableString stringWithCapacity:100];
 	[createTable appendFormat:@"CREATE VIRTUAL TABLE IF NOT EXISTS \"%@\" USING %@(", tableName, ftsVersion];
+	[createTable appendString:[self columnsAndOptions]];
+	
+	if ([parentConnection->parent isContentless])
+	{
+		// The contentless_delete option allows us to use DELETE & INSERT OR REPLACE as usual.
+		// Without it, we'd be required to supply the old values in order to remove a row.
+		
+		[createTable appendString:@", content='', contentless_delete=1"];
+	}
+	
+	[createTable appendString:@");"];
+	
+	int status = sqlite3_exec(db, [createTable UTF8String], NULL, NULL, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Failed creating FTS table (%@): %d %s", tableName, status, sqlite3_errmsg(db));
+		return NO;
+	}
+	
+	return YES;
+}
+
+/**
+ * Internal method.
+ *
+ * Returns the column names & options, as used within the CREATE VIRTUAL TABLE statement.
+ * E.g.: "column1", "column2", option1=value1
+**/
+- (NSString *)columnsAndOptions
+{
+	NSMutableString *string = [NSMutableString stringWithCapacity:100];
 	
 	__block NSUInteger i = 0;
 	
@@ -187,9 +284,9 @@ static NSString *const ext_key__version_deprecated = @"version";
 	for (NSString *columnName in columnNames)
 	{
 		if (i == 0)
-			[createTable appendFormat:@"\"%@\"", columnName];
+			[string appendFormat:@"\"%@\"", columnName];
 		else
-			[createTable appendFormat:@", \"%@\"", columnName];
+			[string appendFormat:@", \"%@\"", columnName];
 		
 		i++;
 	}
@@ -201,22 +298,65 @@ static NSString *const ext_key__version_deprecated = @"version";
 		NSString *value = (NSString *)obj;
 		
 		if (i == 0)
-			[createTable appendFormat:@"%@=%@", option, value];
+			[string appendFormat:@"%@=%@", option, value];
 		else
-			[createTable appendFormat:@", %@=%@", option, value];
+			[string appendFormat:@", %@=%@", option, value];
 		
 		i++;
 	}];
 	
-	[createTable appendString:@");"];
+	return string;
+}
+
+/**
+ * Internal method.
+ *
+ * When the FTS table is contentless, snippets are generated using a (per-connection) TEMP table,
+ * which has the same columns & options as the FTS table, but stores its content.
+ * The table only ever contains the row we're currently generating a snippet for.
+**/
+- (BOOL)createSnippetTableIfNeeded
+{
+	if (parentConnection->hasSnippetTable) return YES;
+	
+	sqlite3 *db = databaseTransaction->connection->db;
+	
+	NSString *snippetTableName = [parentConnection->parent snippetTableName];
+	
+	NSString *createTable =
+	  [NSString stringWithFormat:@"CREATE VIRTUAL TABLE IF NOT EXISTS temp.\"%@\" USING %@(%@);",
+	    snippetTableName, YapDatabaseFullTextSearchFTS5Version, [self columnsAndOptions]];
 	
 	int status = sqlite3_exec(db, [createTable UTF8String], NULL, NULL, NULL);
 	if (status != SQLITE_OK)
 	{
-		YDBLogError(@"Failed creating FTS table (%@): %d %s", tableName, status, sqlite3_errmsg(db));
+		YDBLogError(@"Failed creating FTS snippet table (%@): %d %s", snippetTableName, status, sqlite3_errmsg(db));
 		return NO;
 	}
 	
+	parentConnection->hasSnippetTable = YES;
+	return YES;
+}
+
+/**
+ * Internal method.
+ *
+ * This method is called, if needed, to (re)populate the FTS indexes during registration.
+ *
+ * If the extension is configured with a populationChunkSize, we don't actually populate anything here.
+ * Instead we simply persist the high-water rowid (zero), and the rows are indexed later via populateNextChunkOfSize:.
+**/
+- (BOOL)beginPopulation
+{
+	if (parentConnection->parent->populationChunkSize == 0)
+	{
+		[self removeValueForExtensionKey:ext_key__populateRowid persistent:YES];
+		return [self populate];
+	}
+	
+	[self removeAllRowids];
+	[self setPopulateRowid:0];
+	
 	return YES;
 }
 
@@ -328,6 +468,146 @@ static NSString *const ext_key__version_deprecated = @"version";
 	return YES;
 }
 
+/**
+ * The high-water rowid of an incremental population.
+ * All rows with a rowid less than or equal to this value have been indexed.
+ *
+ * The value is only present (in the yap2 table) while an incremental population is in progress.
+ * It's stored as a string, as the int helpers are only 32 bits.
+**/
+- (BOOL)getPopulateRowid:(int64_t *)rowidPtr
+{
+	NSString *value = [self stringValueForExtensionKey:ext_key__populateRowid persistent:YES];
+	
+	if (rowidPtr) *rowidPtr = [value longLongValue];
+	return (value != nil);
+}
+
+- (void)setPopulateRowid:(int64_t)rowid
+{
+	NSString *value = [NSString stringWithFormat:@"%lld", rowid];
+	[self setStringValue:value forExtensionKey:ext_key__populateRowid persistent:YES];
+}
+
+/**
+ * Indexes the next chunk of rows (in rowid order) of an incremental population.
+ * A chunkSize of zero means everything that remains.
+ *
+ * Rows beyond the high-water rowid may have already been indexed (if they were inserted or modified
+ * since the population began). We simply re-index them, as the insertion replaces the existing row.
+ *
+ * Returns YES if the population is complete.
+**/
+- (BOOL)populateNextChunkOfSize:(NSUInteger)chunkSize
+{
+	YDBLogAutoTrace();
+	
+	if (![databaseTransaction isKindOfClass:[YapDatabaseReadWriteTransaction class]])
+	{
+		YDBLogError(@"Attempting to populate FTS index within a read-only transaction");
+		return NO;
+	}
+	
+	int64_t populateRowid = 0;
+	if (![self getPopulateRowid:&populateRowid])
+	{
+		// Not populating (or already complete)
+		return YES;
+	}
+	
+	sqlite3_stmt *statement = [parentConnection populateChunkStatement];
+	if (statement == NULL) return NO;
+	
+	// SELECT "rowid", "collection", "key" FROM "database2" WHERE "rowid" > ? ORDER BY "rowid" ASC LIMIT ?;
+	
+	int const column_idx_rowid      = SQLITE_COLUMN_START + 0;
+	int const column_idx_collection = SQLITE_COLUMN_START + 1;
+	int const column_idx_key        = SQLITE_COLUMN_START + 2;
+	
+	int const bind_idx_rowid = SQLITE_BIND_START + 0;
+	int const bind_idx_limit = SQLITE_BIND_START + 1;
+	
+	sqlite3_bind_int64(statement, bind_idx_rowid, populateRowid);
+	sqlite3_bind_int64(statement, bind_idx_limit, (chunkSize > 0) ? (sqlite3_int64)chunkSize : -1);
+	
+	// We collect the rows first, and then process them.
+	// This is because the block may perform its own queries.
+	
+	NSMutableArray<NSNumber *> *rowids = [NSMutableArray arrayWithCapacity:chunkSize];
+	NSMutableArray<YapCollectionKey *> *collectionKeys = [NSMutableArray arrayWithCapacity:chunkSize];
+	
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		int64_t rowid = sqlite3_column_int64(statement, column_idx_rowid);
+		
+		const unsigned char *text = sqlite3_column_text(statement, column_idx_collection);
+		int textSize = sqlite3_column_bytes(statement, column_idx_collection);
+		
+		NSString *collection = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+		
+		text = sqlite3_column_text(statement, column_idx_key);
+		textSize = sqlite3_column_bytes(statement, column_idx_key);
+		
+		NSString *key = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+		
+		[rowids addObject:@(rowid)];
+		[collectionKeys addObject:YapCollectionKeyCreate(collection, key)];
+	}
+	
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'populateChunkStatement': %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	if (status != SQLITE_DONE) return NO;
+	
+	__unsafe_unretained YapDatabaseFullTextSearchHandler *handler = parentConnection->parent->handler;
+	
+	NSUInteger count = [rowids count];
+	for (NSUInteger i = 0; i < count; i++)
+	{ @autoreleasepool {
+		
+		int64_t rowid = [[rowids objectAtIndex:i] longLongValue];
+		YapCollectionKey *collectionKey = [collectionKeys objectAtIndex:i];
+		
+		id object = nil;
+		if (handler->blockType & YapDatabaseBlockType_ObjectFlag)
+		{
+			object = [databaseTransaction objectForCollectionKey:collectionKey withRowid:rowid];
+		}
+		
+		id metadata = nil;
+		if (handler->blockType & YapDatabaseBlockType_MetadataFlag)
+		{
+			metadata = [databaseTransaction metadataForCollectionKey:collectionKey withRowid:rowid];
+		}
+		
+		[self _handleChangeWithRowid:rowid
+		               collectionKey:collectionKey
+		                      object:object
+		                    metadata:metadata
+		                    isInsert:NO];
+	}}
+	
+	if ((chunkSize == 0) || (count < chunkSize))
+	{
+		YDBLogVerbose(@"Finished populating FTS table for registeredName(%@)", [self registeredName]);
+		
+		[self removeValueForExtensionKey:ext_key__populateRowid persistent:YES];
+		return YES;
+	}
+	else
+	{
+		[self setPopulateRowid:[[rowids lastObject] longLongValue]];
+		return NO;
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Accessors
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -358,6 +638,11 @@ static NSString *const ext_key__version_deprecated = @"version";
 	return [parentConnection->parent tableName];
 }
 
+- (BOOL)isPartialIndex
+{
+	return [self getPopulateRowid:NULL];
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Logic
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -404,6 +689,7 @@ static NSString *const ext_key__version_deprecated = @"version";
 	sqlite3_reset(statement);
 	
 	[parentConnection->mutationStack markAsMutated];
+	[parentConnection didChangeIndex];
 }
 
 - (void)removeRowid:(int64_t)rowid
@@ -430,6 +716,7 @@ static NSString *const ext_key__version_deprecated = @"version";
 	sqlite3_reset(statement);
 	
 	[parentConnection->mutationStack markAsMutated];
+	[parentConnection didChangeIndex];
 }
 
 - (void)removeRowids:(NSArray *)rowids
@@ -495,6 +782,7 @@ static NSString *const ext_key__version_deprecated = @"version";
 	sqlite3_finalize(statement);
 	
 	[parentConnection->mutationStack markAsMutated];
+	[parentConnection didChangeIndex];
 }
 
 - (void)removeAllRowids
@@ -522,6 +810,7 @@ static NSString *const ext_key__version_deprecated = @"version";
 	sqlite3_reset(statement);
 	
 	[parentConnection->mutationStack markAsMutated];
+	[parentConnection didChangeIndex];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -569,21 +858,16 @@ static NSString *const ext_key__version_deprecated = @"version";
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * Private helper method for other handleXXX hook methods.
+ * Invokes the handler's block, which fills the given dict with the column values for the row.
 **/
-- (void)_handleChangeWithRowid:(int64_t)rowid
-                 collectionKey:(YapCollectionKey *)collectionKey
-                        object:(id)object
-                      metadata:(id)metadata
-                      isInsert:(BOOL)isInsert
+- (void)invokeHandlerWithDict:(NSMutableDictionary *)dict
+                collectionKey:(YapCollectionKey *)collectionKey
+                       object:(id)object
+                     metadata:(id)metadata
 {
-	YDBLogAutoTrace();
-	
 	__unsafe_unretained NSString *collection = collectionKey.collection;
 	__unsafe_unretained NSString *key = collectionKey.key;
 	
-	// Invoke the block to find out if the object should be included in the index.
-	
 	__unsafe_unretained YapDatabaseFullTextSearchHandler *handler = parentConnection->parent->handler;
 	
 	if (handler->blockType == YapDatabaseBlockTypeWithKey)
@@ -591,29 +875,48 @@ static NSString *const ext_key__version_deprecated = @"version";
 		__unsafe_unretained YapDatabaseFullTextSearchWithKeyBlock block =
 		    (YapDatabaseFullTextSearchWithKeyBlock)handler->block;
 		
-		block(databaseTransaction, parentConnection->blockDict, collection, key);
+		block(databaseTransaction, dict, collection, key);
 	}
 	else if (handler->blockType == YapDatabaseBlockTypeWithObject)
 	{
 		__unsafe_unretained YapDatabaseFullTextSearchWithObjectBlock block =
 		    (YapDatabaseFullTextSearchWithObjectBlock)handler->block;
 		
-		block(databaseTransaction, parentConnection->blockDict, collection, key, object);
+		block(databaseTransaction, dict, collection, key, object);
 	}
 	else if (handler->blockType == YapDatabaseBlockTypeWithMetadata)
 	{
 		__unsafe_unretained YapDatabaseFullTextSearchWithMetadataBlock block =
 		    (YapDatabaseFullTextSearchWithMetadataBlock)handler->block;
 		
-		block(databaseTransaction, parentConnection->blockDict, collection, key, metadata);
+		block(databaseTransaction, dict, collection, key, metadata);
 	}
 	else
 	{
 		__unsafe_unretained YapDatabaseFullTextSearchWithRowBlock block =
 		    (YapDatabaseFullTextSearchWithRowBlock)handler->block;
 		
-		block(databaseTransaction, parentConnection->blockDict, collection, key, object, metadata);
+		block(databaseTransaction, dict, collection, key, object, metadata);
 	}
+}
+
+/**
+ * Private helper method for other handleXXX hook methods.
+**/
+- (void)_handleChangeWithRowid:(int64_t)rowid
+                 collectionKey:(YapCollectionKey *)collectionKey
+                        object:(id)object
+                      metadata:(id)metadata
+                      isInsert:(BOOL)isInsert
+{
+	YDBLogAutoTrace();
+	
+	// Invoke the block to find out if the object should be included in the index.
+	
+	[self invokeHandlerWithDict:parentConnection->blockDict
+	              collectionKey:collectionKey
+	                     object:object
+	                   metadata:metadata];
 	
 	if ([parentConnection->blockDict count] == 0)
 	{
@@ -875,6 +1178,11 @@ static NSString *const ext_key__version_deprecated = @"version";
 	YDBLogAutoTrace();
 	
 	[self removeAllRowids];
+	
+	// Nothing left to index
+	if ([self isPartialIndex]) {
+		[self removeValueForExtensionKey:ext_key__populateRowid persistent:YES];
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -887,6 +1195,49 @@ static NSString *const ext_key__version_deprecated = @"version";
 	if (block == nil) return;
 	if ([query length] == 0) return;
 	
+	YapDatabaseFullTextSearchCachedResult *cachedResult = [parentConnection cachedResultForKey:query];
+	if (cachedResult)
+	{
+		[self enumerateCachedResult:cachedResult usingBlock:^(NSString *snippet, int64_t rowid, BOOL *stop) {
+			
+			block(rowid, stop);
+		}];
+		return;
+	}
+	
+	// Record the results as they're enumerated.
+	// If the enumeration runs to completion, the results are added to the cache.
+	
+	__block NSMutableData *rowids = [NSMutableData data];
+	__block BOOL stopped = NO;
+	
+	[self _enumerateRowidsMatching:query usingBlock:^(int64_t rowid, BOOL *stop) {
+		
+		if (rowids)
+		{
+			if (([rowids length] / sizeof(int64_t)) < kMaxCachedResultCount)
+				[rowids appendBytes:&rowid length:sizeof(int64_t)];
+			else
+				rowids = nil;
+		}
+		
+		block(rowid, stop);
+		
+		if (*stop) stopped = YES;
+	}];
+	
+	if (rowids && !stopped)
+	{
+		cachedResult = [[YapDatabaseFullTextSearchCachedResult alloc] init];
+		cachedResult->rowids = rowids;
+		
+		[parentConnection setCachedResult:cachedResult forKey:query];
+	}
+}
+
+- (void)_enumerateRowidsMatching:(NSString *)query
+                      usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, BOOL *stop))block
+{
 	sqlite3_stmt *statement = [parentConnection queryStatement];
 	if (statement == NULL) return;
 
@@ -982,9 +1333,7 @@ static NSString *const ext_key__version_deprecated = @"version";
 #pragma mark bm25  Queries
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-- (void)enumerateBm25OrderedRowidsMatching:(NSString *)query
-                               withWeights:(nullable NSArray<NSNumber *> *)weights
-                                usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, BOOL *stop))block
+- (void)checkBm25Support
 {
     if (![parentConnection->parent.ftsVersion isEqualToString:YapDatabaseFullTextSearchFTS5Version]) {
         NSString *reason = [NSString stringWithFormat:
@@ -994,8 +1343,14 @@ static NSString *const ext_key__version_deprecated = @"version";
                                     @"You may want to initialize that extension with YapDatabaseFullTextSearchFTS5Version" };
         
         @throw [NSException exceptionWithName:@"YapDatabaseFullTextSearch" reason:reason userInfo:userInfo];
-        return;
     }
+}
+
+- (void)enumerateBm25OrderedRowidsMatching:(NSString *)query
+                               withWeights:(nullable NSArray<NSNumber *> *)weights
+                                usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, BOOL *stop))block
+{
+    [self checkBm25Support];
     
     if (block == nil) return;
     if ([query length] == 0) return;
@@ -1034,6 +1389,10 @@ static NSString *const ext_key__version_deprecated = @"version";
     sqlite3_reset(statement);
     FreeYapDatabaseString(&_query);
     
+    if ([weights count] > 0) {
+        sqlite3_finalize(statement); // not cached
+    }
+    
     if (!stop && mutation.isMutated)
     {
         @throw [databaseTransaction mutationDuringEnumerationException];
@@ -1092,43 +1451,599 @@ static NSString *const ext_key__version_deprecated = @"version";
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#pragma mark Queries with Snippets
+#pragma mark bm25 Top-K Queries
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-- (void)enumerateRowidsMatching:(NSString *)query
-             withSnippetOptions:(YapDatabaseFullTextSearchSnippetOptions *)inOptions
-                     usingBlock:
-            (void (NS_NOESCAPE^)(NSString *snippet, int64_t rowid, BOOL *stop))block
+/**
+ * Core top-K method.
+ *
+ * If a cursor is given, enumeration starts immediately after the cursor position (and then skips offset rows).
+ * Otherwise enumeration starts at the beginning of the result set (and then skips offset rows).
+**/
+- (void)enumerateBm25OrderedRowidsMatching:(NSString *)query
+                               withWeights:(NSArray<NSNumber *> *)weights
+                                     limit:(NSUInteger)limit
+                                    offset:(NSUInteger)offset
+                               afterCursor:(YapDatabaseFullTextSearchBm25Cursor *)cursor
+                                usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, double rank, BOOL *stop))block
 {
+	[self checkBm25Support];
+	
 	if (block == nil) return;
 	if ([query length] == 0) return;
+	if (limit == 0) return;
 	
-	sqlite3_stmt *statement = [parentConnection querySnippetStatement];
-	if (statement == NULL) return;
-	
-	YapDatabaseFullTextSearchSnippetOptions *options;
-	if (inOptions)
-		options = [inOptions copy];
+	sqlite3_stmt *statement = NULL;
+	if (cursor)
+		statement = [parentConnection bm25KeysetQueryStatementWithWeights:weights];
 	else
-		options = [[YapDatabaseFullTextSearchSnippetOptions alloc] init]; // default snippet options
+		statement = [parentConnection bm25LimitQueryStatementWithWeights:weights];
+	
+	if (statement == NULL) return;
 	
 	BOOL stop = NO;
 	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
 	
-	// SELECT "rowid", snippet("tableName", ?, ?, ?, ?, ?) FROM "tableName" WHERE "tableName" MATCH ?;
+	// SELECT "rowid", bm25(...) FROM "tableName" WHERE "tableName" MATCH ?
+	//   ORDER BY bm25(...) ASC, "rowid" ASC LIMIT ? OFFSET ?;
+	//
+	// SELECT "rowid", bm25(...) FROM "tableName" WHERE "tableName" MATCH ?1
+	//   AND (bm25(...) > ?2 OR (bm25(...) = ?2 AND "rowid" > ?3))
+	//   ORDER BY bm25(...) ASC, "rowid" ASC LIMIT ?4 OFFSET ?5;
 	
-	int const column_idx_rowid        = SQLITE_COLUMN_START + 0;
-	int const column_idx_snippet      = SQLITE_COLUMN_START + 1;
+	int const column_idx_rowid = SQLITE_COLUMN_START + 0;
+	int const column_idx_rank  = SQLITE_COLUMN_START + 1;
 	
-	int const bind_idx_startMatchText = SQLITE_BIND_START + 0;
-	int const bind_idx_endMatchText   = SQLITE_BIND_START + 1;
-	int const bind_idx_ellipsesText   = SQLITE_BIND_START + 2;
-	int const bind_idx_columnIndex    = SQLITE_BIND_START + 3;
-	int const bind_idx_numTokens      = SQLITE_BIND_START + 4;
-	int const bind_idx_query          = SQLITE_BIND_START + 5;
+	int bind_idx = SQLITE_BIND_START;
 	
-	YapDatabaseString _startMatchText; MakeYapDatabaseString(&_startMatchText, options.startMatchText);
-	sqlite3_bind_text(statement, bind_idx_startMatchText, _startMatchText.str, _startMatchText.length, SQLITE_STATIC);
+	YapDatabaseString _query; MakeYapDatabaseString(&_query, query);
+	sqlite3_bind_text(statement, bind_idx++, _query.str, _query.length, SQLITE_STATIC);
+	
+	if (cursor)
+	{
+		sqlite3_bind_double(statement, bind_idx++, cursor->rank);
+		sqlite3_bind_int64(statement, bind_idx++, cursor->rowid);
+	}
+	
+	sqlite3_bind_int64(statement, bind_idx++, (limit > INT64_MAX) ? INT64_MAX : (sqlite3_int64)limit);
+	sqlite3_bind_int64(statement, bind_idx++, (offset > INT64_MAX) ? INT64_MAX : (sqlite3_int64)offset);
+	
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		int64_t rowid = sqlite3_column_int64(statement, column_idx_rowid);
+		double rank = sqlite3_column_double(statement, column_idx_rank);
+		
+		block(rowid, rank, &stop);
+		
+		if (stop || mutation.isMutated) break;
+	}
+	
+	if ((status != SQLITE_DONE) && !stop && !mutation.isMutated)
+	{
+		YDBLogError(@"sqlite_step error: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	FreeYapDatabaseString(&_query);
+	
+	if ([weights count] > 0) {
+		sqlite3_finalize(statement); // not cached
+	}
+	
+	if (!stop && mutation.isMutated)
+	{
+		@throw [databaseTransaction mutationDuringEnumerationException];
+	}
+}
+
+- (void)enumerateBm25OrderedKeysMatching:(NSString *)query
+                             withWeights:(nullable NSArray<NSNumber *> *)weights
+                                   limit:(NSUInteger)limit
+                                  offset:(NSUInteger)offset
+                              usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block
+{
+	if (block == nil) return;
+	
+	[self enumerateBm25OrderedRowidsMatching:query
+	                             withWeights:weights
+	                                   limit:limit
+	                                  offset:offset
+	                             afterCursor:nil
+	                              usingBlock:^(int64_t rowid, double rank, BOOL *stop)
+	{
+		YapCollectionKey *ck = [self->databaseTransaction collectionKeyForRowid:rowid];
+		
+		block(ck.collection, ck.key, stop);
+	}];
+}
+
+- (void)enumerateBm25OrderedKeysAndMetadataMatching:(NSString *)query
+                                        withWeights:(nullable NSArray<NSNumber *> *)weights
+                                              limit:(NSUInteger)limit
+                                             offset:(NSUInteger)offset
+                                         usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id metadata, BOOL *stop))block
+{
+	if (block == nil) return;
+	
+	[self enumerateBm25OrderedRowidsMatching:query
+	                             withWeights:weights
+	                                   limit:limit
+	                                  offset:offset
+	                             afterCursor:nil
+	                              usingBlock:^(int64_t rowid, double rank, BOOL *stop)
+	{
+		YapCollectionKey *ck = nil;
+		id metadata = nil;
+		[self->databaseTransaction getCollectionKey:&ck metadata:&metadata forRowid:rowid];
+		
+		block(ck.collection, ck.key, metadata, stop);
+	}];
+}
+
+- (void)enumerateBm25OrderedKeysAndObjectsMatching:(NSString *)query
+                                       withWeights:(nullable NSArray<NSNumber *> *)weights
+                                             limit:(NSUInteger)limit
+                                            offset:(NSUInteger)offset
+                                        usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, BOOL *stop))block
+{
+	if (block == nil) return;
+	
+	[self enumerateBm25OrderedRowidsMatching:query
+	                             withWeights:weights
+	                                   limit:limit
+	                                  offset:offset
+	                             afterCursor:nil
+	                              usingBlock:^(int64_t rowid, double rank, BOOL *stop)
+	{
+		YapCollectionKey *ck = nil;
+		id object = nil;
+		[self->databaseTransaction getCollectionKey:&ck object:&object forRowid:rowid];
+		
+		block(ck.collection, ck.key, object, stop);
+	}];
+}
+
+- (void)enumerateBm25OrderedRowsMatching:(NSString *)query
+                             withWeights:(nullable NSArray<NSNumber *> *)weights
+                                   limit:(NSUInteger)limit
+                                  offset:(NSUInteger)offset
+                              usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, id metadata, BOOL *stop))block
+{
+	if (block == nil) return;
+	
+	[self enumerateBm25OrderedRowidsMatching:query
+	                             withWeights:weights
+	                                   limit:limit
+	                                  offset:offset
+	                             afterCursor:nil
+	                              usingBlock:^(int64_t rowid, double rank, BOOL *stop)
+	{
+		YapCollectionKey *ck = nil;
+		id object = nil;
+		id metadata = nil;
+		[self->databaseTransaction getCollectionKey:&ck object:&object metadata:&metadata forRowid:rowid];
+		
+		block(ck.collection, ck.key, object, metadata, stop);
+	}];
+}
+
+/**
+ * Enumerates a single page (via the core top-K method),
+ * and returns the cursor for the next page (or nil if the end of the result set was reached).
+**/
+- (YapDatabaseFullTextSearchBm25Cursor *)enumerateBm25OrderedRowidsMatching:(NSString *)query
+                                                                withWeights:(NSArray<NSNumber *> *)weights
+                                                                      limit:(NSUInteger)limit
+                                                                afterCursor:(YapDatabaseFullTextSearchBm25Cursor *)cursor
+                                                                 usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, BOOL *stop))block
+{
+	if (block == nil) return nil;
+	
+	__block NSUInteger count = 0;
+	__block BOOL stopped = NO;
+	__block int64_t lastRowid = 0;
+	__block double lastRank = 0.0;
+	
+	[self enumerateBm25OrderedRowidsMatching:query
+	                             withWeights:weights
+	                                   limit:limit
+	                                  offset:0
+	                             afterCursor:cursor
+	                              usingBlock:^(int64_t rowid, double rank, BOOL *stop)
+	{
+		count++;
+		lastRowid = rowid;
+		lastRank = rank;
+		
+		block(rowid, stop);
+		
+		if (*stop) stopped = YES;
+	}];
+	
+	if (count == 0) return nil;
+	if (count < limit && !stopped) return nil;
+	
+	return [[YapDatabaseFullTextSearchBm25Cursor alloc] initWithRank:lastRank rowid:lastRowid];
+}
+
+- (YapDatabaseFullTextSearchBm25Cursor *)enumerateBm25OrderedKeysMatching:(NSString *)query
+                                                              withWeights:(nullable NSArray<NSNumber *> *)weights
+                                                                    limit:(NSUInteger)limit
+                                                              afterCursor:(YapDatabaseFullTextSearchBm25Cursor *)cursor
+                                                               usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block
+{
+	if (block == nil) return nil;
+	
+	return [self enumerateBm25OrderedRowidsMatching:query
+	                                    withWeights:weights
+	                                          limit:limit
+	                                    afterCursor:cursor
+	                                     usingBlock:^(int64_t rowid, BOOL *stop)
+	{
+		YapCollectionKey *ck = [self->databaseTransaction collectionKeyForRowid:rowid];
+		
+		block(ck.collection, ck.key, stop);
+	}];
+}
+
+- (YapDatabaseFullTextSearchBm25Cursor *)enumerateBm25OrderedKeysAndMetadataMatching:(NSString *)query
+                                                                         withWeights:(nullable NSArray<NSNumber *> *)weights
+                                                                               limit:(NSUInteger)limit
+                                                                         afterCursor:(YapDatabaseFullTextSearchBm25Cursor *)cursor
+                                                                          usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id metadata, BOOL *stop))block
+{
+	if (block == nil) return nil;
+	
+	return [self enumerateBm25OrderedRowidsMatching:query
+	                                    withWeights:weights
+	                                          limit:limit
+	                                    afterCursor:cursor
+	                                     usingBlock:^(int64_t rowid, BOOL *stop)
+	{
+		YapCollectionKey *ck = nil;
+		id metadata = nil;
+		[self->databaseTransaction getCollectionKey:&ck metadata:&metadata forRowid:rowid];
+		
+		block(ck.collection, ck.key, metadata, stop);
+	}];
+}
+
+- (YapDatabaseFullTextSearchBm25Cursor *)enumerateBm25OrderedKeysAndObjectsMatching:(NSString *)query
+                                                                        withWeights:(nullable NSArray<NSNumber *> *)weights
+                                                                              limit:(NSUInteger)limit
+                                                                        afterCursor:(YapDatabaseFullTextSearchBm25Cursor *)cursor
+                                                                         usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, BOOL *stop))block
+{
+	if (block == nil) return nil;
+	
+	return [self enumerateBm25OrderedRowidsMatching:query
+	                                    withWeights:weights
+	                                          limit:limit
+	                                    afterCursor:cursor
+	                                     usingBlock:^(int64_t rowid, BOOL *stop)
+	{
+		YapCollectionKey *ck = nil;
+		id object = nil;
+		[self->databaseTransaction getCollectionKey:&ck object:&object forRowid:rowid];
+		
+		block(ck.collection, ck.key, object, stop);
+	}];
+}
+
+- (YapDatabaseFullTextSearchBm25Cursor *)enumerateBm25OrderedRowsMatching:(NSString *)query
+                                                              withWeights:(nullable NSArray<NSNumber *> *)weights
+                                                                    limit:(NSUInteger)limit
+                                                              afterCursor:(YapDatabaseFullTextSearchBm25Cursor *)cursor
+                                                               usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, id metadata, BOOL *stop))block
+{
+	if (block == nil) return nil;
+	
+	return [self enumerateBm25OrderedRowidsMatching:query
+	                                    withWeights:weights
+	                                          limit:limit
+	                                    afterCursor:cursor
+	                                     usingBlock:^(int64_t rowid, BOOL *stop)
+	{
+		YapCollectionKey *ck = nil;
+		id object = nil;
+		id metadata = nil;
+		[self->databaseTransaction getCollectionKey:&ck object:&object metadata:&metadata forRowid:rowid];
+		
+		block(ck.collection, ck.key, object, metadata, stop);
+	}];
+}
+
+/**
+ * Ordering for the bounded heap: by rank, then by rowid (matching the ORDER BY of the top-K statements).
+**/
+typedef struct {
+	double rank;
+	int64_t rowid;
+} YDBFTSRankedRowid;
+
+static inline BOOL YDBFTSRankedRowidIsWorse(YDBFTSRankedRowid a, YDBFTSRankedRowid b)
+{
+	if (a.rank != b.rank) return (a.rank > b.rank);
+	return (a.rowid > b.rowid);
+}
+
+static int YDBFTSRankedRowidCompare(const void *a, const void *b)
+{
+	YDBFTSRankedRowid ra = *(const YDBFTSRankedRowid *)a;
+	YDBFTSRankedRowid rb = *(const YDBFTSRankedRowid *)b;
+	
+	if (YDBFTSRankedRowidIsWorse(ra, rb)) return 1;
+	if (YDBFTSRankedRowidIsWorse(rb, ra)) return -1;
+	return 0;
+}
+
+/**
+ * Restores the (max) heap property, where heap[0] is the worst row currently kept.
+**/
+static void YDBFTSHeapSiftDown(YDBFTSRankedRowid *heap, NSUInteger count, NSUInteger idx)
+{
+	while (YES)
+	{
+		NSUInteger left = (2 * idx) + 1;
+		NSUInteger right = left + 1;
+		NSUInteger worst = idx;
+		
+		if (left < count && YDBFTSRankedRowidIsWorse(heap[left], heap[worst]))
+			worst = left;
+		if (right < count && YDBFTSRankedRowidIsWorse(heap[right], heap[worst]))
+			worst = right;
+		
+		if (worst == idx) break;
+		
+		YDBFTSRankedRowid tmp = heap[idx];
+		heap[idx] = heap[worst];
+		heap[worst] = tmp;
+		
+		idx = worst;
+	}
+}
+
+static void YDBFTSHeapSiftUp(YDBFTSRankedRowid *heap, NSUInteger idx)
+{
+	while (idx > 0)
+	{
+		NSUInteger parent = (idx - 1) / 2;
+		
+		if (!YDBFTSRankedRowidIsWorse(heap[idx], heap[parent])) break;
+		
+		YDBFTSRankedRowid tmp = heap[idx];
+		heap[idx] = heap[parent];
+		heap[parent] = tmp;
+		
+		idx = parent;
+	}
+}
+
+- (void)enumerateBm25OrderedKeysMatching:(NSString *)query
+                             withWeights:(nullable NSArray<NSNumber *> *)weights
+                                   limit:(NSUInteger)limit
+                                  filter:(BOOL (NS_NOESCAPE^)(NSString *collection, NSString *key))filter
+                              usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block
+{
+	if (filter == nil)
+	{
+		[self enumerateBm25OrderedKeysMatching:query withWeights:weights limit:limit offset:0 usingBlock:block];
+		return;
+	}
+	
+	[self checkBm25Support];
+	
+	if (block == nil) return;
+	if ([query length] == 0) return;
+	if (limit == 0) return;
+	
+	sqlite3_stmt *statement = [parentConnection bm25RankQueryStatementWithWeights:weights];
+	if (statement == NULL) return;
+	
+	// The heap grows as needed, so a large limit with only a few matches doesn't allocate a large buffer.
+	
+	NSUInteger capacity = MIN(limit, (NSUInteger)64);
+	NSUInteger count = 0;
+	YDBFTSRankedRowid *heap = malloc(sizeof(YDBFTSRankedRowid) * capacity);
+	
+	BOOL stop = NO;
+	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
+	
+	// SELECT "rowid", bm25(...) FROM "tableName" WHERE "tableName" MATCH ?;
+	
+	int const column_idx_rowid = SQLITE_COLUMN_START + 0;
+	int const column_idx_rank  = SQLITE_COLUMN_START + 1;
+	int const bind_idx_query   = SQLITE_BIND_START;
+	
+	YapDatabaseString _query; MakeYapDatabaseString(&_query, query);
+	sqlite3_bind_text(statement, bind_idx_query, _query.str, _query.length, SQLITE_STATIC);
+	
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		YDBFTSRankedRowid item;
+		item.rowid = sqlite3_column_int64(statement, column_idx_rowid);
+		item.rank = sqlite3_column_double(statement, column_idx_rank);
+		
+		// Skip the filter entirely if the row couldn't make it into the heap anyway
+		
+		if (count == limit && !YDBFTSRankedRowidIsWorse(heap[0], item)) {
+			continue;
+		}
+		
+		YapCollectionKey *ck = [databaseTransaction collectionKeyForRowid:item.rowid];
+		BOOL passes = filter(ck.collection, ck.key);
+		
+		if (mutation.isMutated) break;
+		if (!passes) continue;
+		
+		if (count < limit)
+		{
+			if (count == capacity)
+			{
+				capacity = MIN(limit, capacity * 2);
+				heap = reallocf(heap, sizeof(YDBFTSRankedRowid) * capacity);
+			}
+			
+			heap[count] = item;
+			YDBFTSHeapSiftUp(heap, count);
+			count++;
+		}
+		else
+		{
+			heap[0] = item;
+			YDBFTSHeapSiftDown(heap, count, 0);
+		}
+	}
+	
+	if ((status != SQLITE_DONE) && !mutation.isMutated)
+	{
+		YDBLogError(@"sqlite_step error: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	FreeYapDatabaseString(&_query);
+	
+	if ([weights count] > 0) {
+		sqlite3_finalize(statement); // not cached
+	}
+	
+	if (!mutation.isMutated && heap)
+	{
+		qsort(heap, count, sizeof(YDBFTSRankedRowid), YDBFTSRankedRowidCompare);
+		
+		for (NSUInteger i = 0; i < count; i++)
+		{
+			YapCollectionKey *ck = [databaseTransaction collectionKeyForRowid:heap[i].rowid];
+			
+			block(ck.collection, ck.key, &stop);
+			
+			if (stop || mutation.isMutated) break;
+		}
+	}
+	
+	free(heap);
+	
+	if (!stop && mutation.isMutated)
+	{
+		@throw [databaseTransaction mutationDuringEnumerationException];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Queries with Snippets
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)enumerateRowidsMatching:(NSString *)query
+             withSnippetOptions:(YapDatabaseFullTextSearchSnippetOptions *)inOptions
+                     usingBlock:
+            (void (NS_NOESCAPE^)(NSString *snippet, int64_t rowid, BOOL *stop))block
+{
+	if (block == nil) return;
+	if ([query length] == 0) return;
+	
+	YapDatabaseFullTextSearchSnippetOptions *options;
+	if (inOptions)
+		options = [inOptions copy];
+	else
+		options = [[YapDatabaseFullTextSearchSnippetOptions alloc] init]; // default snippet options
+	
+	// The cache key includes the snippet options, as they affect the generated snippets.
+	// (The 0x1F unit separator can't appear in a sane query.)
+	
+	NSString *cacheKey = [NSString stringWithFormat:@"%@\x1F%@\x1F%@\x1F%@\x1F%d\x1F%@",
+	  options.startMatchText, options.endMatchText, options.ellipsesText,
+	  (options.columnName ?: @""), options.numberOfTokens, query];
+	
+	YapDatabaseFullTextSearchCachedResult *cachedResult = [parentConnection cachedResultForKey:cacheKey];
+	if (cachedResult)
+	{
+		[self enumerateCachedResult:cachedResult usingBlock:block];
+		return;
+	}
+	
+	// Record the results as they're enumerated.
+	// If the enumeration runs to completion, the results are added to the cache.
+	
+	__block NSMutableData *rowids = [NSMutableData data];
+	__block NSMutableArray *snippets = [NSMutableArray array];
+	__block BOOL stopped = NO;
+	
+	[self _enumerateRowidsMatching:query withSnippetOptions:options usingBlock:
+	    ^(NSString *snippet, int64_t rowid, BOOL *stop)
+	{
+		if (rowids)
+		{
+			if ([snippets count] < kMaxCachedResultCount)
+			{
+				[rowids appendBytes:&rowid length:sizeof(int64_t)];
+				[snippets addObject:(snippet ?: (id)[NSNull null])];
+			}
+			else
+			{
+				rowids = nil;
+				snippets = nil;
+			}
+		}
+		
+		block(snippet, rowid, stop);
+		
+		if (*stop) stopped = YES;
+	}];
+	
+	if (rowids && !stopped)
+	{
+		cachedResult = [[YapDatabaseFullTextSearchCachedResult alloc] init];
+		cachedResult->rowids = rowids;
+		cachedResult->snippets = snippets;
+		
+		[parentConnection setCachedResult:cachedResult forKey:cacheKey];
+	}
+}
+
+- (void)_enumerateRowidsMatching:(NSString *)query
+              withSnippetOptions:(YapDatabaseFullTextSearchSnippetOptions *)options
+                      usingBlock:
+            (void (NS_NOESCAPE^)(NSString *snippet, int64_t rowid, BOOL *stop))block
+{
+	if ([parentConnection->parent isContentless])
+	{
+		// The FTS table doesn't store the text, so sqlite's snippet function won't work here.
+		
+		[self _enumerateRowidsMatching:query usingBlock:^(int64_t rowid, BOOL *stop) {
+			
+			NSString *snippet = [self contentlessSnippetForRowid:rowid matching:query withSnippetOptions:options];
+			
+			block(snippet, rowid, stop);
+		}];
+		return;
+	}
+	
+	sqlite3_stmt *statement = [parentConnection querySnippetStatement];
+	if (statement == NULL) return;
+	
+	BOOL stop = NO;
+	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
+	
+	// SELECT "rowid", snippet("tableName", ?, ?, ?, ?, ?) FROM "tableName" WHERE "tableName" MATCH ?;
+	
+	int const column_idx_rowid        = SQLITE_COLUMN_START + 0;
+	int const column_idx_snippet      = SQLITE_COLUMN_START + 1;
+	
+	int const bind_idx_startMatchText = SQLITE_BIND_START + 0;
+	int const bind_idx_endMatchText   = SQLITE_BIND_START + 1;
+	int const bind_idx_ellipsesText   = SQLITE_BIND_START + 2;
+	int const bind_idx_columnIndex    = SQLITE_BIND_START + 3;
+	int const bind_idx_numTokens      = SQLITE_BIND_START + 4;
+	int const bind_idx_query          = SQLITE_BIND_START + 5;
+	
+	YapDatabaseString _startMatchText; MakeYapDatabaseString(&_startMatchText, options.startMatchText);
+	sqlite3_bind_text(statement, bind_idx_startMatchText, _startMatchText.str, _startMatchText.length, SQLITE_STATIC);
 	
 	YapDatabaseString _endMatchText; MakeYapDatabaseString(&_endMatchText, options.endMatchText);
 	sqlite3_bind_text(statement, bind_idx_endMatchText, _endMatchText.str, _endMatchText.length, SQLITE_STATIC);
@@ -1257,6 +2172,40 @@ static NSString *const ext_key__version_deprecated = @"version";
 	}];
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Query Cache
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Enumerates a result from the connection's queryCache,
+ * with the same mutation-during-enumeration protection as a query that hits the database.
+**/
+- (void)enumerateCachedResult:(YapDatabaseFullTextSearchCachedResult *)cachedResult
+                   usingBlock:(void (NS_NOESCAPE^)(NSString *snippet, int64_t rowid, BOOL *stop))block
+{
+	BOOL stop = NO;
+	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
+	
+	const int64_t *rowids = (const int64_t *)[cachedResult->rowids bytes];
+	NSArray *snippets = cachedResult->snippets;
+	
+	NSUInteger count = [cachedResult count];
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		NSString *snippet = snippets ? snippets[i] : nil;
+		if ((id)snippet == [NSNull null]) snippet = nil;
+		
+		block(snippet, rowids[i], &stop);
+		
+		if (stop || mutation.isMutated) break;
+	}
+	
+	if (!stop && mutation.isMutated)
+	{
+		@throw [databaseTransaction mutationDuringEnumerationException];
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Individual Query
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1303,15 +2252,22 @@ static NSString *const ext_key__version_deprecated = @"version";
 {
 	if ([query length] == 0) return nil;
 	
-	sqlite3_stmt *statement = [parentConnection rowidQuerySnippetStatement];
-	if (statement == NULL) return nil;
-	
 	YapDatabaseFullTextSearchSnippetOptions *options;
 	if (inOptions)
 		options = [inOptions copy];
 	else
 		options = [[YapDatabaseFullTextSearchSnippetOptions alloc] init]; // default snippet options
 	
+	if ([parentConnection->parent isContentless])
+	{
+		if (![self rowid:rowid matches:query]) return nil;
+		
+		return [self contentlessSnippetForRowid:rowid matching:query withSnippetOptions:options];
+	}
+	
+	sqlite3_stmt *statement = [parentConnection rowidQuerySnippetStatement];
+	if (statement == NULL) return nil;
+	
 	// SELECT "rowid", snippet("tableName", ?, ?, ?, ?, ?) FROM "tableName" WHERE "rowid" = ? AND "tableName" MATCH ?;
 	
 //	int const column_idx_rowid        = SQLITE_COLUMN_START + 0;
@@ -1383,4 +2339,183 @@ static NSString *const ext_key__version_deprecated = @"version";
 	return snippet;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Contentless Snippets
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Generates a snippet for a row when the FTS table is contentless.
+ *
+ * The handler is invoked to supply the column text for the row,
+ * which is inserted into the (temp) snippet table, where sqlite's snippet function can be used.
+ * Afterwards the snippet table is cleared again.
+ *
+ * Note: The snippet table is always fts5, so the snippet function uses the fts5 parameter ordering.
+**/
+- (NSString *)contentlessSnippetForRowid:(int64_t)rowid
+                                matching:(NSString *)query
+                      withSnippetOptions:(YapDatabaseFullTextSearchSnippetOptions *)options
+{
+	if (![self createSnippetTableIfNeeded]) return nil;
+	
+	YapCollectionKey *ck = nil;
+	id object = nil;
+	id metadata = nil;
+	
+	if (![databaseTransaction getCollectionKey:&ck object:&object metadata:&metadata forRowid:rowid]) {
+		return nil;
+	}
+	
+	NSMutableDictionary *columnValues =
+	  [NSMutableDictionary dictionaryWithSharedKeySet:parentConnection->parent->columnNamesSharedKeySet];
+	
+	[self invokeHandlerWithDict:columnValues collectionKey:ck object:object metadata:metadata];
+	
+	if ([columnValues count] == 0) return nil;
+	
+	sqlite3 *db = databaseTransaction->connection->db;
+	
+	sqlite3_stmt *insertStatement = [parentConnection snippetTableInsertStatement];
+	sqlite3_stmt *queryStatement = [parentConnection snippetTableQueryStatement];
+	sqlite3_stmt *removeAllStatement = [parentConnection snippetTableRemoveAllStatement];
+	
+	if (insertStatement == NULL || queryStatement == NULL || removeAllStatement == NULL) {
+		return nil;
+	}
+	
+	int status;
+	
+	// INSERT INTO "snippetTableName" ("rowid", "column1", "column2", ...) VALUES (?, ?, ? ...)
+	
+	sqlite3_bind_int64(insertStatement, SQLITE_BIND_START, rowid);
+	
+	int i = SQLITE_BIND_START + 1;
+	for (NSString *columnName in parentConnection->parent->columnNames)
+	{
+		NSString *columnValue = [columnValues objectForKey:columnName];
+		if (columnValue)
+		{
+			sqlite3_bind_text(insertStatement, i, [columnValue UTF8String], -1, SQLITE_TRANSIENT);
+		}
+		
+		i++;
+	}
+	
+	status = sqlite3_step(insertStatement);
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'snippetTableInsertStatement': %d %s", status, sqlite3_errmsg(db));
+	}
+	
+	sqlite3_clear_bindings(insertStatement);
+	sqlite3_reset(insertStatement);
+	
+	if (status != SQLITE_DONE) return nil;
+	
+	// SELECT snippet("snippetTableName", ?, ?, ?, ?, ?) FROM "snippetTableName" WHERE "snippetTableName" MATCH ?;
+	
+	int const column_idx_snippet      = SQLITE_COLUMN_START;
+	
+	int const bind_idx_columnIndex    = SQLITE_BIND_START + 0;
+	int const bind_idx_startMatchText = SQLITE_BIND_START + 1;
+	int const bind_idx_endMatchText   = SQLITE_BIND_START + 2;
+	int const bind_idx_ellipsesText   = SQLITE_BIND_START + 3;
+	int const bind_idx_numTokens      = SQLITE_BIND_START + 4;
+	int const bind_idx_query          = SQLITE_BIND_START + 5;
+	
+	int columnIndex = -1;
+	if (options.columnName)
+	{
+		NSUInteger index = [parentConnection->parent->columnNames indexOfObject:options.columnName];
+		if (index == NSNotFound)
+		{
+			YDBLogWarn(@"Invalid snippet option: columnName(%@) not found", options.columnName);
+		}
+		else
+		{
+			columnIndex = (int)index;
+		}
+	}
+	sqlite3_bind_int(queryStatement, bind_idx_columnIndex, columnIndex);
+	
+	YapDatabaseString _startMatchText; MakeYapDatabaseString(&_startMatchText, options.startMatchText);
+	sqlite3_bind_text(queryStatement, bind_idx_startMatchText, _startMatchText.str, _startMatchText.length, SQLITE_STATIC);
+	
+	YapDatabaseString _endMatchText; MakeYapDatabaseString(&_endMatchText, options.endMatchText);
+	sqlite3_bind_text(queryStatement, bind_idx_endMatchText, _endMatchText.str, _endMatchText.length, SQLITE_STATIC);
+	
+	YapDatabaseString _ellipsesText; MakeYapDatabaseString(&_ellipsesText, options.ellipsesText);
+	sqlite3_bind_text(queryStatement, bind_idx_ellipsesText, _ellipsesText.str, _ellipsesText.length, SQLITE_STATIC);
+	
+	sqlite3_bind_int(queryStatement, bind_idx_numTokens, options.numberOfTokens);
+	
+	YapDatabaseString _query; MakeYapDatabaseString(&_query, query);
+	sqlite3_bind_text(queryStatement, bind_idx_query, _query.str, _query.length, SQLITE_STATIC);
+	
+	NSString *snippet = nil;
+	
+	status = sqlite3_step(queryStatement);
+	if (status == SQLITE_ROW)
+	{
+		const unsigned char *text = sqlite3_column_text(queryStatement, column_idx_snippet);
+		int textSize = sqlite3_column_bytes(queryStatement, column_idx_snippet);
+		
+		snippet = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+	}
+	else if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'snippetTableQueryStatement': %d %s", status, sqlite3_errmsg(db));
+	}
+	
+	sqlite3_clear_bindings(queryStatement);
+	sqlite3_reset(queryStatement);
+	FreeYapDatabaseString(&_startMatchText);
+	FreeYapDatabaseString(&_endMatchText);
+	FreeYapDatabaseString(&_ellipsesText);
+	FreeYapDatabaseString(&_query);
+	
+	// DELETE FROM "snippetTableName";
+	
+	status = sqlite3_step(removeAllStatement);
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'snippetTableRemoveAllStatement': %d %s", status, sqlite3_errmsg(db));
+	}
+	
+	sqlite3_reset(removeAllStatement);
+	
+	return snippet;
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation YapDatabaseFullTextSearchBm25Cursor
+
+@synthesize rank = rank;
+
+- (instancetype)initWithRank:(double)inRank rowid:(int64_t)inRowid
+{
+	if ((self = [super init]))
+	{
+		rank = inRank;
+		rowid = inRowid;
+	}
+	return self;
+}
+
+- (id)copyWithZone:(NSZone __unused *)zone
+{
+	return self; // Immutable
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<YapDatabaseFullTextSearchBm25Cursor[%p] rank(%f) rowid(%lld)>",
+	                                   self, rank, rowid];
+}
+
 @end
@@ -92,6 +92,9 @@
 	NSUInteger queryCacheLimit;
 	
 	YapMutationStack_Bool *mutationStack;
+	
+	NSMutableDictionary<NSNumber*, id> *pendingChanges; // rowid -> NSData (coordinates) || NSNull (remove)
+	NSMutableSet<NSNumber*> *pendingInserts;            // rowids not yet in the table (plain INSERT, no comparison)
 }
 
 - (id)initWithParent:(YapDatabaseRTreeIndex *)parent databaseConnection:(YapDatabaseConnection *)databaseConnection;
@@ -99,6 +102,10 @@
 - (void)postCommitCleanup;
 - (void)postRollbackCleanup;
 
+- (sqlite3_stmt *)selectStatement;
+- (sqlite3_stmt *)selectAllStatement;
+- (sqlite3_stmt *)countStatement;
+- (sqlite3_stmt *)nodeStatement;
 - (sqlite3_stmt *)insertStatement;
 - (sqlite3_stmt *)updateStatement;
 - (sqlite3_stmt *)removeStatement;
@@ -115,6 +122,8 @@
 
 	__unsafe_unretained YapDatabaseRTreeIndexConnection *parentConnection;
 	__unsafe_unretained YapDatabaseReadTransaction *databaseTransaction;
+	
+	NSMutableData *bulkLoadEntries; // non-nil while populating
 }
 
 - (id)initWithParentConnection:(YapDatabaseRTreeIndexConnection *)parentConnection
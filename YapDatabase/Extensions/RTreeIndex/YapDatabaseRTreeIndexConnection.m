@@ -24,6 +24,10 @@ static const int ydbLogLevel = YDBLogLevelWarning;
 
 @implementation YapDatabaseRTreeIndexConnection
 {
+	sqlite3_stmt *selectStatement;
+	sqlite3_stmt *selectAllStatement;
+	sqlite3_stmt *countStatement;
+	sqlite3_stmt *nodeStatement;
 	sqlite3_stmt *insertStatement;
 	sqlite3_stmt *updateStatement;
 	sqlite3_stmt *removeStatement;
@@ -55,6 +59,10 @@ static const int ydbLogLevel = YDBLogLevelWarning;
 
 - (void)_flushStatements
 {
+	sqlite_finalize_null(&selectStatement);
+	sqlite_finalize_null(&selectAllStatement);
+	sqlite_finalize_null(&countStatement);
+	sqlite_finalize_null(&nodeStatement);
 	sqlite_finalize_null(&insertStatement);
 	sqlite_finalize_null(&updateStatement);
 	sqlite_finalize_null(&removeStatement);
@@ -209,16 +217,30 @@ static const int ydbLogLevel = YDBLogLevelWarning;
 	
 	if (mutationStack == nil)
 		mutationStack = [[YapMutationStack_Bool alloc] init];
+	
+	if (pendingChanges == nil)
+		pendingChanges = [[NSMutableDictionary alloc] init];
+	
+	if (pendingInserts == nil)
+		pendingInserts = [[NSMutableSet alloc] init];
 }
 
 - (void)postCommitCleanup
 {
 	[mutationStack clear];
+	
+	// These should already be empty (flushed in flushPendingChangesToExtensionTables)
+	
+	[pendingChanges removeAllObjects];
+	[pendingInserts removeAllObjects];
 }
 
 - (void)postRollbackCleanup
 {
 	[mutationStack clear];
+	
+	[pendingChanges removeAllObjects];
+	[pendingInserts removeAllObjects];
 }
 
 /**
@@ -264,6 +286,79 @@ static const int ydbLogLevel = YDBLogLevelWarning;
 	FreeYapDatabaseString(&stmt);
 }
 
+- (sqlite3_stmt *)selectStatement
+{
+	sqlite3_stmt **statement = &selectStatement;
+	if (*statement == NULL)
+	{
+		NSMutableString *string = [NSMutableString stringWithCapacity:100];
+		[string appendString:@"SELECT \"rowid\""];
+
+		for (NSString *columnName in parent->setup)
+		{
+			[string appendFormat:@", \"%@\"", columnName];
+		}
+
+		[string appendFormat:@" FROM \"%@\" WHERE \"rowid\" = ?;", [parent tableName]];
+
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+
+	return *statement;
+}
+
+- (sqlite3_stmt *)selectAllStatement
+{
+	sqlite3_stmt **statement = &selectAllStatement;
+	if (*statement == NULL)
+	{
+		NSMutableString *string = [NSMutableString stringWithCapacity:100];
+		[string appendString:@"SELECT \"rowid\""];
+
+		for (NSString *columnName in parent->setup)
+		{
+			[string appendFormat:@", \"%@\"", columnName];
+		}
+
+		[string appendFormat:@" FROM \"%@\";", [parent tableName]];
+
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+
+	return *statement;
+}
+
+- (sqlite3_stmt *)countStatement
+{
+	sqlite3_stmt **statement = &countStatement;
+	if (*statement == NULL)
+	{
+		// The rtree module maintains a shadow table with one row per entry,
+		// which is cheaper to count than the virtual table itself.
+		
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT COUNT(*) FROM \"%@_rowid\";", [parent tableName]];
+
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+
+	return *statement;
+}
+
+- (sqlite3_stmt *)nodeStatement
+{
+	sqlite3_stmt **statement = &nodeStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT \"data\" FROM \"%@_node\" WHERE \"nodeno\" = ?;", [parent tableName]];
+
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+
+	return *statement;
+}
+
 - (sqlite3_stmt *)insertStatement
 {
 	sqlite3_stmt **statement = &insertStatement;
@@ -55,6 +55,46 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (BOOL)getNumberOfRows:(NSUInteger *)count matchingQuery:(YapDatabaseQuery *)query;
 
+/**
+ * Nearest neighbour (k-NN) queries.
+ * These methods enumerate the entries in order of increasing distance from the given point.
+ *
+ * The point has one value per dimension, in the order of the setup.
+ * E.g. for a setup of @[@"minLat", @"maxLat", @"minLon", @"maxLon"], the point is @[lat, lon].
+ *
+ * The distance is the euclidean distance from the point to the entry's bounding box (zero if the box contains the point),
+ * in the same units as the coordinates. (So for lat/lon coordinates, it's in degrees, and doesn't account for the
+ * curvature of the earth. If you need exact distances, use these results as candidates, and refine them yourself.)
+ *
+ * The results are streamed: the rtree is searched incrementally (best-first), and only as far as needed.
+ * So to get the closest 20 entries, simply stop after the 20th one:
+ *
+ * __block NSUInteger count = 0;
+ * [[transaction ext:@"idx"] enumerateKeysNearestToPoint:@[@(lat), @(lon)]
+ *                                            usingBlock:^(NSString *collection, NSString *key, double distance, BOOL *stop)
+ * {
+ *     // ...
+ *     if (++count == 20) *stop = YES;
+ * }];
+ *
+ * @return NO if there was a problem with the given point (e.g. wrong number of values). YES otherwise.
+ */
+- (BOOL)enumerateKeysNearestToPoint:(NSArray<NSNumber *> *)point
+                         usingBlock:
+            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, double distance, BOOL *stop))block;
+
+- (BOOL)enumerateKeysAndMetadataNearestToPoint:(NSArray<NSNumber *> *)point
+                                    usingBlock:
+            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, _Nullable id metadata, double distance, BOOL *stop))block;
+
+- (BOOL)enumerateKeysAndObjectsNearestToPoint:(NSArray<NSNumber *> *)point
+                                   usingBlock:
+            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, double distance, BOOL *stop))block;
+
+- (BOOL)enumerateRowsNearestToPoint:(NSArray<NSNumber *> *)point
+                         usingBlock:
+  (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, _Nullable id metadata, double distance, BOOL *stop))block;
+
 /**
  * This method assists in performing a query over a subset of rows,
  * where the subset is a known set of keys.
@@ -72,6 +112,21 @@ NS_ASSUME_NONNULL_BEGIN
 - (NSDictionary<NSString*, NSNumber*> *)rowidsForKeys:(NSArray<NSString *> *)keys
 										 inCollection:(nullable NSString *)collection;
 
+/**
+ * Rebuilds the rtree as a packed tree.
+ * The entries are sorted using Sort-Tile-Recursive, which groups spatially close entries into the same nodes,
+ * and every node is filled to capacity. So queries visit fewer nodes, with less overlap between them.
+ *
+ * The rtree is automatically packed when the extension populates itself,
+ * and when a large batch of entries is inserted (within a single transaction).
+ * But after many small incremental changes, the nodes tend to become loosely packed & overlapping,
+ * which makes queries visit more nodes than necessary.
+ * So if you've made a lot of incremental changes, you may want to occasionally repack the rtree.
+ *
+ * This method may only be invoked within a read-write transaction.
+ */
+- (void)repack;
+
 @end
 
 NS_ASSUME_NONNULL_END
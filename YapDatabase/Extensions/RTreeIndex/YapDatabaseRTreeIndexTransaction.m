@@ -25,6 +25,200 @@ static NSString *const ext_key_classVersion       = @"classVersion";
 static NSString *const ext_key_versionTag         = @"versionTag";
 static NSString *const ext_key_version_deprecated = @"version";
 
+/**
+ * Pending changes are flushed to the table once there are this many of them,
+ * which bounds the memory used by large transactions.
+ * (Each pending change is just a small buffer of coordinates.)
+**/
+static NSUInteger const kMaxPendingChanges = 10000;
+
+/**
+ * A batch of inserts is bulk loaded (along with the existing entries) if it's at least this large,
+ * and at least as large as the existing rtree. See flushPendingChanges.
+**/
+static NSUInteger const kMinBulkLoadCount = 1000;
+
+/**
+ * An entry that's about to be written to the rtree.
+ * Entries are variable length (the coordinates follow the struct), and are stored consecutively in an NSMutableData.
+ *
+ * During a bulk load, the same struct is used for the cells of the internal nodes,
+ * in which case the rowid is the index of the child node (within the level below).
+**/
+typedef struct {
+	double key;            // sort key (scratch space for YDBRTreeSortTileRecursive)
+	int64_t rowid;
+	double coordinates[];  // in the order of the setup: min0, max0, min1, max1, ...
+} YDBRTreeEntry;
+
+static int YDBRTreeEntryCompare(const void *a, const void *b)
+{
+	const YDBRTreeEntry *entryA = (const YDBRTreeEntry *)a;
+	const YDBRTreeEntry *entryB = (const YDBRTreeEntry *)b;
+
+	if (entryA->key < entryB->key) return -1;
+	if (entryA->key > entryB->key) return  1;
+
+	if (entryA->rowid < entryB->rowid) return -1;
+	if (entryA->rowid > entryB->rowid) return  1;
+
+	return 0;
+}
+
+/**
+ * Sort-Tile-Recursive (Leutenegger et al.)
+ *
+ * Sorts the entries by the center of the given dimension, and splits them into slabs,
+ * such that the slabs (recursively tiled by the remaining dimensions) each contain a whole number of nodes.
+ * When finished, each run of nodeCapacity entries is a tile of spatially close entries.
+**/
+static void YDBRTreeSortTileRecursive(uint8_t *entries, NSUInteger count, size_t entrySize,
+                                      NSUInteger dimension, NSUInteger numDimensions, NSUInteger nodeCapacity)
+{
+	if (count <= nodeCapacity) return;
+
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		YDBRTreeEntry *entry = (YDBRTreeEntry *)(entries + (i * entrySize));
+
+		double min = entry->coordinates[(dimension * 2) + 0];
+		double max = entry->coordinates[(dimension * 2) + 1];
+
+		entry->key = (min * 0.5) + (max * 0.5);
+	}
+
+	qsort(entries, count, entrySize, YDBRTreeEntryCompare);
+
+	if ((dimension + 1) >= numDimensions) return;
+
+	NSUInteger nodeCount = (count + nodeCapacity - 1) / nodeCapacity;
+	NSUInteger slabCount = (NSUInteger)ceil(pow((double)nodeCount, 1.0 / (double)(numDimensions - dimension)));
+	NSUInteger slabSize = nodeCapacity * ((nodeCount + slabCount - 1) / slabCount);
+
+	for (NSUInteger offset = 0; offset < count; offset += slabSize)
+	{
+		YDBRTreeSortTileRecursive(entries + (offset * entrySize), MIN(slabSize, (count - offset)), entrySize,
+		                          (dimension + 1), numDimensions, nodeCapacity);
+	}
+}
+
+/**
+ * The rtree stores 32-bit floats, rounding the min down, and the max up.
+ * These functions match the rounding performed by sqlite's rtree module (rtreeValueDown & rtreeValueUp),
+ * so a bulk loaded rtree is identical to one built via INSERT.
+**/
+#define YDB_RTREE_RNDTOWARDS (1.0 - 1.0/8388608.0)
+#define YDB_RTREE_RNDAWAY    (1.0 + 1.0/8388608.0)
+
+static float YDBRTreeValueDown(double d)
+{
+	float f = (float)d;
+	if (f > d) {
+		f = (float)(d * (d < 0 ? YDB_RTREE_RNDAWAY : YDB_RTREE_RNDTOWARDS));
+	}
+	return f;
+}
+
+static float YDBRTreeValueUp(double d)
+{
+	float f = (float)d;
+	if (f < d) {
+		f = (float)(d * (d < 0 ? YDB_RTREE_RNDTOWARDS : YDB_RTREE_RNDAWAY));
+	}
+	return f;
+}
+
+/**
+ * Returns YES if the stored coordinate (which is a 32-bit float) is the rounded form of the given value.
+**/
+static BOOL YDBRTreeCoordinateMatches(double stored, double value, BOOL isMin)
+{
+	float f = isMin ? YDBRTreeValueDown(value) : YDBRTreeValueUp(value);
+
+	return (stored == (double)f);
+}
+
+/**
+ * An item in the priority queue of a nearest neighbour search.
+ * Either a node of the rtree (which is expanded when popped), or an entry (which is returned when popped).
+**/
+typedef struct {
+	double distance; // squared distance from the point to the bounding box
+	int64_t pointer; // nodeno (node) or rowid (entry)
+	int level;       // depth of the node (0 == leaf node), or -1 for an entry
+} YDBRTreeSearchItem;
+
+/**
+ * A binary min-heap of YDBRTreeSearchItem's, ordered by distance.
+ * At the same distance, entries are popped before nodes (so they're returned as early as possible).
+**/
+typedef struct {
+	YDBRTreeSearchItem *items;
+	NSUInteger count;
+	NSUInteger capacity;
+} YDBRTreeSearchQueue;
+
+static BOOL YDBRTreeSearchItemPrecedes(const YDBRTreeSearchItem *a, const YDBRTreeSearchItem *b)
+{
+	if (a->distance != b->distance)
+		return (a->distance < b->distance);
+	else
+		return (a->level < b->level);
+}
+
+static void YDBRTreeSearchQueuePush(YDBRTreeSearchQueue *queue, YDBRTreeSearchItem item)
+{
+	if (queue->count == queue->capacity)
+	{
+		queue->capacity = MAX(queue->capacity * 2, (NSUInteger)64);
+		queue->items = reallocf(queue->items, queue->capacity * sizeof(YDBRTreeSearchItem));
+	}
+
+	YDBRTreeSearchItem *items = queue->items;
+	NSUInteger i = queue->count++;
+
+	while (i > 0)
+	{
+		NSUInteger parent = (i - 1) / 2;
+		if (!YDBRTreeSearchItemPrecedes(&item, &items[parent])) break;
+
+		items[i] = items[parent];
+		i = parent;
+	}
+
+	items[i] = item;
+}
+
+static YDBRTreeSearchItem YDBRTreeSearchQueuePop(YDBRTreeSearchQueue *queue)
+{
+	YDBRTreeSearchItem *items = queue->items;
+
+	YDBRTreeSearchItem result = items[0];
+	YDBRTreeSearchItem last = items[--queue->count];
+
+	NSUInteger count = queue->count;
+	NSUInteger i = 0;
+
+	while (YES)
+	{
+		NSUInteger child = (2 * i) + 1;
+		if (child >= count) break;
+
+		if ((child + 1 < count) && YDBRTreeSearchItemPrecedes(&items[child + 1], &items[child]))
+			child++;
+
+		if (!YDBRTreeSearchItemPrecedes(&items[child], &last)) break;
+
+		items[i] = items[child];
+		i = child;
+	}
+
+	if (count > 0) {
+		items[i] = last;
+	}
+
+	return result;
+}
 
 @implementation YapDatabaseRTreeIndexTransaction
 
@@ -249,6 +443,11 @@ static NSString *const ext_key_version_deprecated = @"version";
 
 	[self removeAllRowids];
 
+	// The entries are collected (rather than inserted one at a time),
+	// so they can be bulk loaded at the end (see bulkLoad:).
+
+	bulkLoadEntries = [[NSMutableData alloc] init];
+
 	// Enumerate the existing rows in the database and populate the indexes
 
 	__unsafe_unretained YapDatabaseRTreeIndex *rTreeIndex = parentConnection->parent;
@@ -387,6 +586,11 @@ static NSString *const ext_key_version_deprecated = @"version";
 		}
 	}
 
+	NSMutableData *entries = bulkLoadEntries;
+	bulkLoadEntries = nil;
+
+	[self loadEntries:entries];
+
 	return YES;
 	
 #pragma clang diagnostic pop
@@ -417,205 +621,845 @@ static NSString *const ext_key_version_deprecated = @"version";
 	return [parentConnection->parent registeredName];
 }
 
-- (NSString *)tableName
-{
-	return [parentConnection->parent tableName];
-}
+- (NSString *)tableName
+{
+	return [parentConnection->parent tableName];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Logic
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Extracts the coordinates from the 'blockDict' ivar, in the order of the setup.
+ * Returns NO (and logs a warning) if any of the values are missing, or aren't numbers.
+**/
+- (BOOL)getCoordinates:(double *)coordinates
+{
+	NSUInteger i = 0;
+	for (NSString *columnName in parentConnection->parent->setup)
+	{
+		id columnValue = [parentConnection->blockDict objectForKey:columnName];
+		if (columnValue && columnValue != [NSNull null])
+		{
+			if ([columnValue isKindOfClass:[NSNumber class]])
+			{
+				__unsafe_unretained NSNumber *cast = (NSNumber *)columnValue;
+
+				coordinates[i] = [cast doubleValue];
+			}
+			else
+			{
+				YDBLogWarn(@"Unable to bind value for column(name=%@, type=real) with unsupported class: %@."
+				           @" Column requires NSNumber.",
+				           columnName, NSStringFromClass([columnValue class]));
+				return NO;
+			}
+		}
+		else
+		{
+			YDBLogWarn(@"Unable to find value for column(name=%@, type=real)."
+			           @" Column required.",
+			           columnName);
+			return NO;
+		}
+
+		i++;
+	}
+
+	return YES;
+}
+
+/**
+ * The size of a single YDBRTreeEntry (which is followed by its coordinates).
+**/
+- (size_t)entrySize
+{
+	return sizeof(YDBRTreeEntry) + ([parentConnection->parent->setup count] * sizeof(double));
+}
+
+/**
+ * Adds a row to the table, using the given rowid along with the values in the 'blockDict' ivar.
+ *
+ * The write is deferred until flushPendingChanges is invoked.
+ * This allows multiple changes to the same row (within the same transaction) to result in a single write,
+ * and allows a large batch of inserts to be bulk loaded.
+ *
+ * While populating, the rows are collected into the bulkLoadEntries buffer instead.
+**/
+- (void)addRowid:(int64_t)rowid isNew:(BOOL)isNew
+{
+	YDBLogAutoTrace();
+
+	if (bulkLoadEntries)
+	{
+		size_t entrySize = [self entrySize];
+		NSUInteger offset = [bulkLoadEntries length];
+
+		[bulkLoadEntries increaseLengthBy:entrySize];
+
+		YDBRTreeEntry *entry = (YDBRTreeEntry *)((uint8_t *)[bulkLoadEntries mutableBytes] + offset);
+		entry->rowid = rowid;
+
+		if (![self getCoordinates:entry->coordinates])
+		{
+			[bulkLoadEntries setLength:offset];
+		}
+		return;
+	}
+
+	NSMutableData *coordinates =
+	  [NSMutableData dataWithLength:([parentConnection->parent->setup count] * sizeof(double))];
+
+	if (![self getCoordinates:(double *)[coordinates mutableBytes]])
+	{
+		return;
+	}
+
+	NSNumber *number = @(rowid);
+
+	if (isNew && ([parentConnection->pendingChanges objectForKey:number] == nil))
+	{
+		// The row isn't in the table, so there's nothing to compare against (or replace) during the flush.
+		// Note: If there's a pending remove for this rowid, then the old row is still in the table.
+
+		[parentConnection->pendingInserts addObject:number];
+	}
+
+	[parentConnection->pendingChanges setObject:coordinates forKey:number];
+
+	[parentConnection->mutationStack markAsMutated];
+
+	if ([parentConnection->pendingChanges count] >= kMaxPendingChanges)
+	{
+		[self flushPendingChanges];
+	}
+}
+
+- (void)removeRowid:(int64_t)rowid
+{
+	YDBLogAutoTrace();
+
+	NSNumber *number = @(rowid);
+
+	if ([parentConnection->pendingInserts containsObject:number])
+	{
+		// The row was added during this transaction, and was never written to the table.
+
+		[parentConnection->pendingInserts removeObject:number];
+		[parentConnection->pendingChanges removeObjectForKey:number];
+	}
+	else
+	{
+		[parentConnection->pendingChanges setObject:[NSNull null] forKey:number];
+	}
+
+	[parentConnection->mutationStack markAsMutated];
+
+	if ([parentConnection->pendingChanges count] >= kMaxPendingChanges)
+	{
+		[self flushPendingChanges];
+	}
+}
+
+- (void)removeRowids:(NSArray *)rowids
+{
+	YDBLogAutoTrace();
+
+	for (NSNumber *number in rowids)
+	{
+		[self removeRowid:[number longLongValue]];
+	}
+}
+
+/**
+ * Writes all pending changes to the table (in rowid order).
+ *
+ * If the batch of inserts is at least as large as the existing rtree (e.g. the first large import),
+ * then the rtree is rebuilt via a bulk load instead. See bulkLoad:.
+ *
+ * This method is invoked from flushPendingChangesToExtensionTables,
+ * as well as before executing any query (so queries within a readWriteTransaction see its changes).
+**/
+- (void)flushPendingChanges
+{
+	YDBLogAutoTrace();
+
+	NSMutableDictionary<NSNumber*, id> *pendingChanges = parentConnection->pendingChanges;
+	NSMutableSet<NSNumber*> *pendingInserts = parentConnection->pendingInserts;
+
+	if ([pendingChanges count] == 0) return;
+
+	size_t entrySize = [self entrySize];
+	size_t coordinatesSize = entrySize - sizeof(YDBRTreeEntry);
+
+	NSMutableData *insertEntries = [NSMutableData dataWithCapacity:([pendingInserts count] * entrySize)];
+	NSMutableData *updateEntries = [NSMutableData data];
+
+	NSArray<NSNumber*> *rowids = [[pendingChanges allKeys] sortedArrayUsingSelector:@selector(compare:)];
+
+	for (NSNumber *number in rowids)
+	{
+		int64_t rowid = [number longLongValue];
+		id change = [pendingChanges objectForKey:number];
+
+		if (change == [NSNull null])
+		{
+			[self deleteRowid:rowid];
+			continue;
+		}
+
+		__unsafe_unretained NSData *coordinates = (NSData *)change;
+		NSMutableData *entries = nil;
+
+		if ([pendingInserts containsObject:number])
+			entries = insertEntries;
+		else if (![self rowid:rowid hasCoordinates:(const double *)[coordinates bytes]])
+			entries = updateEntries;
+
+		if (entries)
+		{
+			NSUInteger offset = [entries length];
+			[entries increaseLengthBy:entrySize];
+
+			YDBRTreeEntry *entry = (YDBRTreeEntry *)((uint8_t *)[entries mutableBytes] + offset);
+			entry->rowid = rowid;
+			memcpy(entry->coordinates, [coordinates bytes], coordinatesSize);
+		}
+	}
+
+	[pendingChanges removeAllObjects];
+	[pendingInserts removeAllObjects];
+
+	[self writeEntries:updateEntries isNew:NO];
+
+	NSUInteger insertCount = [insertEntries length] / entrySize;
+	if ((insertCount >= kMinBulkLoadCount) && (insertCount >= [self numberOfEntries]))
+	{
+		[self rebuildWithEntries:insertEntries];
+	}
+	else
+	{
+		[self writeEntries:insertEntries isNew:YES];
+	}
+}
+
+/**
+ * Writes the given batch of entries (a buffer of YDBRTreeEntry's) to the table, one INSERT at a time.
+**/
+- (void)writeEntries:(NSData *)entries isNew:(BOOL)isNew
+{
+	size_t entrySize = [self entrySize];
+	NSUInteger count = [entries length] / entrySize;
+
+	if (count == 0) return;
+
+	NSUInteger numCoordinates = [parentConnection->parent->setup count];
+
+	sqlite3_stmt *statement = NULL;
+	if (isNew)
+		statement = [parentConnection insertStatement];
+	else
+		statement = [parentConnection updateStatement];
+
+	if (statement == NULL)
+		return;
+
+	//  isNew : INSERT            INTO "tableName" ("rowid", "column1", "column2", ...) VALUES (?, ?, ? ...);
+	// !isNew : INSERT OR REPLACE INTO "tableName" ("rowid", "column1", "column2", ...) VALUES (?, ?, ? ...);
+
+	const uint8_t *bytes = (const uint8_t *)[entries bytes];
+
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		const YDBRTreeEntry *entry = (const YDBRTreeEntry *)(bytes + (i * entrySize));
+
+		int bind_idx = SQLITE_BIND_START;
+
+		sqlite3_bind_int64(statement, bind_idx, entry->rowid);
+		bind_idx++;
+
+		for (NSUInteger c = 0; c < numCoordinates; c++)
+		{
+			sqlite3_bind_double(statement, bind_idx, entry->coordinates[c]);
+			bind_idx++;
+		}
+
+		int status = sqlite3_step(statement);
+		if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"Error executing '%s': %d %s",
+			            isNew ? "insertStatement" : "updateStatement",
+			            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		}
+
+		sqlite3_reset(statement);
+	}
+
+	sqlite3_clear_bindings(statement);
+}
+
+/**
+ * Returns YES if the table already contains the given row, with the same coordinates.
+ * In which case there's no need to re-write it (which, for an rtree, means removing & re-inserting the entry).
+**/
+- (BOOL)rowid:(int64_t)rowid hasCoordinates:(const double *)coordinates
+{
+	sqlite3_stmt *statement = [parentConnection selectStatement];
+	if (statement == NULL) return NO;
+
+	// SELECT "rowid", "column1", "column2", ... FROM "tableName" WHERE "rowid" = ?;
+
+	sqlite3_bind_int64(statement, SQLITE_BIND_START, rowid);
+
+	BOOL result = NO;
+
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		result = YES;
+
+		NSUInteger numCoordinates = [parentConnection->parent->setup count];
+		for (NSUInteger i = 0; i < numCoordinates; i++)
+		{
+			double stored = sqlite3_column_double(statement, (int)(SQLITE_COLUMN_START + 1 + i));
+
+			if (!YDBRTreeCoordinateMatches(stored, coordinates[i], ((i % 2) == 0)))
+			{
+				result = NO;
+				break;
+			}
+		}
+	}
+	else if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'selectStatement': %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+
+	return result;
+}
+
+- (void)deleteRowid:(int64_t)rowid
+{
+	sqlite3_stmt *statement = [parentConnection removeStatement];
+	if (statement == NULL) return;
+
+	// DELETE FROM "tableName" WHERE "rowid" = ?;
+
+	int const bind_idx_rowid = SQLITE_BIND_START;
+
+	sqlite3_bind_int64(statement, bind_idx_rowid, rowid);
+
+	int status = sqlite3_step(statement);
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'removeStatement': %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+}
+
+- (void)removeAllRowids
+{
+	YDBLogAutoTrace();
+
+	// Any pending changes are moot
+
+	[parentConnection->pendingChanges removeAllObjects];
+	[parentConnection->pendingInserts removeAllObjects];
+
+	sqlite3_stmt *statement = [parentConnection removeAllStatement];
+	if (statement == NULL)
+		return;
+
+	int status;
+
+	// DELETE FROM "tableName";
+
+	YDBLogVerbose(@"DELETE FROM '%@';", [self tableName]);
+
+	status = sqlite3_step(statement);
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"(%@): Error in removeAllStatement: %d %s",
+		            [self registeredName],
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+
+	sqlite3_reset(statement);
+
+	[parentConnection->mutationStack markAsMutated];
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Bulk Load
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns the number of entries in the rtree.
+**/
+- (NSUInteger)numberOfEntries
+{
+	sqlite3_stmt *statement = [parentConnection countStatement];
+	if (statement == NULL) return 0;
+
+	// SELECT COUNT(*) FROM "tableName_rowid";
+
+	NSUInteger count = 0;
+
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		count = (NSUInteger)sqlite3_column_int64(statement, SQLITE_COLUMN_START);
+	}
+	else
+	{
+		YDBLogError(@"Error executing 'countStatement': %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+
+	sqlite3_reset(statement);
+
+	return count;
+}
+
+/**
+ * Appends every entry in the rtree to the given buffer (of YDBRTreeEntry's).
+ *
+ * Note: The stored values are 32-bit floats, so re-inserting them is lossless.
+**/
+- (BOOL)getAllEntries:(NSMutableData *)entries
+{
+	sqlite3_stmt *statement = [parentConnection selectAllStatement];
+	if (statement == NULL) return NO;
+
+	// SELECT "rowid", "column1", "column2", ... FROM "tableName";
+
+	size_t entrySize = [self entrySize];
+	NSUInteger numCoordinates = [parentConnection->parent->setup count];
+
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		NSUInteger offset = [entries length];
+		[entries increaseLengthBy:entrySize];
+
+		YDBRTreeEntry *entry = (YDBRTreeEntry *)((uint8_t *)[entries mutableBytes] + offset);
+		entry->rowid = sqlite3_column_int64(statement, SQLITE_COLUMN_START);
+
+		for (NSUInteger i = 0; i < numCoordinates; i++)
+		{
+			entry->coordinates[i] = sqlite3_column_double(statement, (int)(SQLITE_COLUMN_START + 1 + i));
+		}
+	}
+
+	BOOL result = YES;
+
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'selectAllStatement': %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		result = NO;
+	}
+
+	sqlite3_reset(statement);
+
+	return result;
+}
+
+/**
+ * Rebuilds the rtree (via a bulk load) from its existing entries, plus the given entries (which may be nil).
+**/
+- (void)rebuildWithEntries:(NSData *)additionalEntries
+{
+	YDBLogAutoTrace();
+
+	NSMutableData *entries = [NSMutableData data];
+
+	if (![self getAllEntries:entries])
+	{
+		[self writeEntries:additionalEntries isNew:YES];
+		return;
+	}
+
+	if (additionalEntries)
+	{
+		[entries appendData:additionalEntries];
+	}
+
+	[self loadEntries:entries];
+}
+
+/**
+ * Replaces the content of the rtree with the given entries.
+ * Uses a bulk load if possible, and otherwise falls back to inserting the entries one at a time.
+**/
+- (void)loadEntries:(NSMutableData *)entries
+{
+	if (![self bulkLoad:entries])
+	{
+		[self removeAllRowids];
+		[self writeEntries:entries isNew:YES];
+	}
+
+	[parentConnection->mutationStack markAsMutated];
+}
+
+/**
+ * Replaces the content of the rtree with the given entries,
+ * by building a packed rtree (bottom up), and writing its nodes directly into the shadow tables of the rtree module:
+ *
+ * - "tableName_node"   ("nodeno" INTEGER PRIMARY KEY, "data")
+ * - "tableName_parent" ("nodeno" INTEGER PRIMARY KEY, "parentnode")
+ * - "tableName_rowid"  ("rowid" INTEGER PRIMARY KEY, "nodeno")
+ *
+ * When entries are inserted one at a time, sqlite splits the nodes as they overflow,
+ * which leaves most of the nodes partially empty, with overlapping bounding boxes.
+ * Instead, the entries are sorted using Sort-Tile-Recursive, and each run of nodeCapacity entries becomes a full leaf.
+ * The leaves are then packed the same way into the level above, and so on up to the root.
+ *
+ * The node format (see sqlite's rtree.c):
+ * - 2 bytes : depth of the tree (root node only)
+ * - 2 bytes : number of cells
+ * - cells   : 8 byte rowid (leaf) or child nodeno (internal node), followed by the coordinates (4 byte floats)
+ * Integers & floats are big-endian, and every node is zero-padded to the same size (the size of the root node).
+ *
+ * Everything is written within a savepoint.
+ * Returns NO if anything fails (e.g. the shadow tables are read-only due to SQLITE_DBCONFIG_DEFENSIVE),
+ * in which case the rtree is left unchanged.
+**/
+- (BOOL)bulkLoad:(NSMutableData *)entries
+{
+	YDBLogAutoTrace();
+
+	sqlite3 *db = databaseTransaction->connection->db;
+
+	NSString *tableName = [self tableName];
+	NSUInteger numCoordinates = [parentConnection->parent->setup count];
+	NSUInteger numDimensions = numCoordinates / 2;
+	size_t entrySize = [self entrySize];
+
+	if (numDimensions == 0) return NO;
+
+	// The node size is set when the rtree is created (based on the page size),
+	// and every node has the same size as the root node.
+
+	NSUInteger nodeSize = 0;
+	{
+		NSString *query = [NSString stringWithFormat:
+		  @"SELECT length(\"data\") FROM \"%@_node\" WHERE \"nodeno\" = 1;", tableName];
+
+		sqlite3_stmt *statement;
+		int status = sqlite3_prepare_v2(db, [query UTF8String], -1, &statement, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogWarn(@"Unable to bulk load rtree index (%@): %d %s", tableName, status, sqlite3_errmsg(db));
+			return NO;
+		}
+
+		if (sqlite3_step(statement) == SQLITE_ROW)
+		{
+			nodeSize = (NSUInteger)sqlite3_column_int64(statement, SQLITE_COLUMN_START);
+		}
+
+		sqlite3_finalize(statement);
+	}
+
+	size_t cellSize = 8 + (4 * numCoordinates);
+	NSUInteger nodeCapacity = (nodeSize > 4) ? ((nodeSize - 4) / cellSize) : 0;
+
+	if (nodeCapacity < 2)
+	{
+		YDBLogWarn(@"Unable to bulk load rtree index (%@): unexpected node size (%lu)",
+		           tableName, (unsigned long)nodeSize);
+		return NO;
+	}
+
+	// Round the coordinates to floats (exactly as the rtree module would),
+	// and drop any entries the rtree module would reject (min > max).
+
+	NSUInteger count = 0;
+	{
+		uint8_t *bytes = (uint8_t *)[entries mutableBytes];
+		NSUInteger entryCount = [entries length] / entrySize;
+
+		for (NSUInteger i = 0; i < entryCount; i++)
+		{
+			YDBRTreeEntry *entry = (YDBRTreeEntry *)(bytes + (i * entrySize));
+			BOOL isValid = YES;
+
+			for (NSUInteger c = 0; c < numCoordinates; c += 2)
+			{
+				float min = YDBRTreeValueDown(entry->coordinates[c]);
+				float max = YDBRTreeValueUp(entry->coordinates[c + 1]);
+
+				if (min > max)
+				{
+					isValid = NO;
+					break;
+				}
+
+				entry->coordinates[c]     = min;
+				entry->coordinates[c + 1] = max;
+			}
+
+			if (isValid)
+			{
+				if (count != i) {
+					memmove(bytes + (count * entrySize), entry, entrySize);
+				}
+				count++;
+			}
+			else
+			{
+				YDBLogError(@"Unable to add rowid(%lld) to rtree index (%@): min value is greater than max value",
+				            entry->rowid, tableName);
+			}
+		}
+
+		[entries setLength:(count * entrySize)];
+	}
+
+	if (count == 0) return NO;
+
+	// Build the levels of the tree, bottom up.
+	// Each level is a buffer of cells, ordered such that each run of nodeCapacity cells is a node.
+	// The cells of the level above have the bounding box of each node, and its index (as the rowid).
+
+	NSMutableArray<NSMutableData *> *levels = [NSMutableArray arrayWithCapacity:4];
+	NSMutableData *cells = entries;
+
+	while (YES)
+	{
+		NSUInteger cellCount = [cells length] / entrySize;
+		YDBRTreeSortTileRecursive((uint8_t *)[cells mutableBytes], cellCount, entrySize,
+		                          0, numDimensions, nodeCapacity);
+
+		[levels addObject:cells];
+
+		NSUInteger nodeCount = (cellCount + nodeCapacity - 1) / nodeCapacity;
+		if (nodeCount == 1) break;
+
+		NSMutableData *parentCells = [NSMutableData dataWithLength:(nodeCount * entrySize)];
+
+		const uint8_t *cellBytes = (const uint8_t *)[cells bytes];
+		uint8_t *parentCellBytes = (uint8_t *)[parentCells mutableBytes];
+
+		for (NSUInteger n = 0; n < nodeCount; n++)
+		{
+			YDBRTreeEntry *parentCell = (YDBRTreeEntry *)(parentCellBytes + (n * entrySize));
+			parentCell->rowid = (int64_t)n;
+
+			NSUInteger first = n * nodeCapacity;
+			NSUInteger last = MIN(first + nodeCapacity, cellCount);
+
+			for (NSUInteger i = first; i < last; i++)
+			{
+				const YDBRTreeEntry *cell = (const YDBRTreeEntry *)(cellBytes + (i * entrySize));
+
+				for (NSUInteger c = 0; c < numCoordinates; c += 2)
+				{
+					if (i == first || cell->coordinates[c] < parentCell->coordinates[c])
+						parentCell->coordinates[c] = cell->coordinates[c];
+
+					if (i == first || cell->coordinates[c + 1] > parentCell->coordinates[c + 1])
+						parentCell->coordinates[c + 1] = cell->coordinates[c + 1];
+				}
+			}
+		}
+
+		cells = parentCells;
+	}
+
+	// Number the nodes, top down. (The root is always node 1.)
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#pragma mark Logic
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	NSUInteger levelCount = [levels count];
 
-/**
- * Adds a row to the table, using the given rowid along with the values in the 'blockDict' ivar.
-**/
-- (void)addRowid:(int64_t)rowid isNew:(BOOL)isNew
-{
-	YDBLogAutoTrace();
+	int64_t *firstNodeno = malloc(levelCount * sizeof(int64_t));
+	firstNodeno[levelCount - 1] = 1;
 
-	sqlite3_stmt *statement = NULL;
-	if (isNew)
-		statement = [parentConnection insertStatement];
-	else
-		statement = [parentConnection updateStatement];
+	for (NSUInteger level = levelCount - 1; level > 0; level--)
+	{
+		NSUInteger cellCount = [levels[level] length] / entrySize;
+		NSUInteger nodeCount = (cellCount + nodeCapacity - 1) / nodeCapacity;
 
-	if (statement == NULL)
-		return;
+		firstNodeno[level - 1] = firstNodeno[level] + (int64_t)nodeCount;
+	}
 
-	//  isNew : INSERT            INTO "tableName" ("rowid", "column1", "column2", ...) VALUES (?, ?, ? ...);
-	// !isNew : INSERT OR REPLACE INTO "tableName" ("rowid", "column1", "column2", ...) VALUES (?, ?, ? ...);
+	// Write the nodes
 
-	int bind_idx = SQLITE_BIND_START;
+	NSString *savepoint = @"SAVEPOINT yap_rtree_bulk_load;";
+	NSString *clear = [NSString stringWithFormat:
+	  @"DELETE FROM \"%1$@_node\"; DELETE FROM \"%1$@_parent\"; DELETE FROM \"%1$@_rowid\";", tableName];
 
-	sqlite3_bind_int64(statement, bind_idx, rowid);
-	bind_idx++;
+	NSString *insertNode = [NSString stringWithFormat:
+	  @"INSERT INTO \"%@_node\" (\"nodeno\", \"data\") VALUES (?, ?);", tableName];
+	NSString *insertParent = [NSString stringWithFormat:
+	  @"INSERT INTO \"%@_parent\" (\"nodeno\", \"parentnode\") VALUES (?, ?);", tableName];
+	NSString *insertRowid = [NSString stringWithFormat:
+	  @"INSERT INTO \"%@_rowid\" (\"rowid\", \"nodeno\") VALUES (?, ?);", tableName];
 
-	for (NSString *columnName in parentConnection->parent->setup)
+	sqlite3_stmt *nodeStatement = NULL;
+	sqlite3_stmt *parentStatement = NULL;
+	sqlite3_stmt *rowidStatement = NULL;
+
+	int status = sqlite3_exec(db, [savepoint UTF8String], NULL, NULL, NULL);
+	if (status != SQLITE_OK)
 	{
-		id columnValue = [parentConnection->blockDict objectForKey:columnName];
-		if (columnValue && columnValue != [NSNull null])
-		{
-            if ([columnValue isKindOfClass:[NSNumber class]])
-            {
-                __unsafe_unretained NSNumber *cast = (NSNumber *)columnValue;
-
-                double num = [cast doubleValue];
-                sqlite3_bind_double(statement, bind_idx, num);
-            }
-            else
-            {
-                YDBLogWarn(@"Unable to bind value for column(name=%@, type=real) with unsupported class: %@."
-                           @" Column requires NSNumber.",
-                           columnName, NSStringFromClass([columnValue class]));
-                return;
-            }
-		}
-        else {
-            YDBLogWarn(@"Unable to find value for column(name=%@, type=real)."
-                       @" Column required.",
-                       columnName);
-            return;
-        }
+		YDBLogWarn(@"Unable to bulk load rtree index (%@): %d %s", tableName, status, sqlite3_errmsg(db));
 
-		bind_idx++;
+		free(firstNodeno);
+		return NO;
 	}
 
-	int status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
+	if (status == SQLITE_OK)
+		status = sqlite3_exec(db, [clear UTF8String], NULL, NULL, NULL);
+	if (status == SQLITE_OK)
+		status = sqlite3_prepare_v2(db, [insertNode UTF8String], -1, &nodeStatement, NULL);
+	if (status == SQLITE_OK)
+		status = sqlite3_prepare_v2(db, [insertParent UTF8String], -1, &parentStatement, NULL);
+	if (status == SQLITE_OK)
+		status = sqlite3_prepare_v2(db, [insertRowid UTF8String], -1, &rowidStatement, NULL);
+
+	uint8_t *node = malloc(nodeSize);
+
+	for (NSUInteger l = levelCount; l > 0 && status == SQLITE_OK; l--)
 	{
-		YDBLogError(@"Error executing '%s': %d %s",
-		            isNew ? "insertStatement" : "updateStatement",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
-	}
+		NSUInteger level = l - 1;
 
-	sqlite3_clear_bindings(statement);
-	sqlite3_reset(statement);
+		const uint8_t *cellBytes = (const uint8_t *)[levels[level] bytes];
+		NSUInteger cellCount = [levels[level] length] / entrySize;
+		NSUInteger nodeCount = (cellCount + nodeCapacity - 1) / nodeCapacity;
 
-	[parentConnection->mutationStack markAsMutated];
-}
+		// Leaf cells point to rows (via rowid), and internal cells point to the nodes in the level below.
 
-- (void)removeRowid:(int64_t)rowid
-{
-	YDBLogAutoTrace();
+		sqlite3_stmt *pointerStatement = (level == 0) ? rowidStatement : parentStatement;
 
-	sqlite3_stmt *statement = [parentConnection removeStatement];
-	if (statement == NULL) return;
+		for (NSUInteger n = 0; n < nodeCount && status == SQLITE_OK; n++)
+		{
+			int64_t nodeno = firstNodeno[level] + (int64_t)n;
 
-	// DELETE FROM "tableName" WHERE "rowid" = ?;
+			NSUInteger first = n * nodeCapacity;
+			NSUInteger last = MIN(first + nodeCapacity, cellCount);
 
-	int const bind_idx_rowid = SQLITE_BIND_START;
+			memset(node, 0, nodeSize);
 
-	sqlite3_bind_int64(statement, bind_idx_rowid, rowid);
+			uint16_t depthBE = CFSwapInt16HostToBig((nodeno == 1) ? (uint16_t)(levelCount - 1) : 0);
+			uint16_t cellCountBE = CFSwapInt16HostToBig((uint16_t)(last - first));
 
-	int status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
-	{
-		YDBLogError(@"Error executing 'removeStatement': %d %s",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
-	}
+			memcpy(node + 0, &depthBE, 2);
+			memcpy(node + 2, &cellCountBE, 2);
 
-	sqlite3_clear_bindings(statement);
-	sqlite3_reset(statement);
+			uint8_t *ptr = node + 4;
 
-	[parentConnection->mutationStack markAsMutated];
-}
+			for (NSUInteger i = first; i < last && status == SQLITE_OK; i++)
+			{
+				const YDBRTreeEntry *cell = (const YDBRTreeEntry *)(cellBytes + (i * entrySize));
 
-- (void)removeRowids:(NSArray *)rowids
-{
-	YDBLogAutoTrace();
+				int64_t pointer = (level == 0) ? cell->rowid : (firstNodeno[level - 1] + cell->rowid);
 
-	NSUInteger count = [rowids count];
+				uint64_t pointerBE = CFSwapInt64HostToBig((uint64_t)pointer);
+				memcpy(ptr, &pointerBE, 8);
+				ptr += 8;
 
-	if (count == 0) return;
-	if (count == 1)
-	{
-		int64_t rowid = [[rowids objectAtIndex:0] longLongValue];
+				for (NSUInteger c = 0; c < numCoordinates; c++)
+				{
+					float value = (float)cell->coordinates[c];
 
-		[self removeRowid:rowid];
-		return;
-	}
+					uint32_t valueBE;
+					memcpy(&valueBE, &value, 4);
+					valueBE = CFSwapInt32HostToBig(valueBE);
 
-	// DELETE FROM "tableName" WHERE "rowid" in (?, ?, ...);
-	//
-	// Note: We don't have to worry sqlite's max number of host parameters.
-	// YapDatabase gives us the rowids in batches where each batch is already capped at this number.
+					memcpy(ptr, &valueBE, 4);
+					ptr += 4;
+				}
 
-	NSUInteger capacity = 50 + (count * 3);
-	NSMutableString *query = [NSMutableString stringWithCapacity:capacity];
+				sqlite3_bind_int64(pointerStatement, SQLITE_BIND_START + 0, pointer);
+				sqlite3_bind_int64(pointerStatement, SQLITE_BIND_START + 1, nodeno);
 
-	[query appendFormat:@"DELETE FROM \"%@\" WHERE \"rowid\" IN (", [self tableName]];
+				status = sqlite3_step(pointerStatement);
+				status = (status == SQLITE_DONE) ? SQLITE_OK : status;
 
-	NSUInteger i;
-	for (i = 0; i < count; i++)
-	{
-		if (i == 0)
-			[query appendString:@"?"];
-		else
-			[query appendString:@", ?"];
-	}
+				sqlite3_reset(pointerStatement);
+			}
+
+			if (status == SQLITE_OK)
+			{
+				sqlite3_bind_int64(nodeStatement, SQLITE_BIND_START + 0, nodeno);
+				sqlite3_bind_blob(nodeStatement, SQLITE_BIND_START + 1, node, (int)nodeSize, SQLITE_STATIC);
 
-	[query appendString:@");"];
+				status = sqlite3_step(nodeStatement);
+				status = (status == SQLITE_DONE) ? SQLITE_OK : status;
 
-	sqlite3_stmt *statement;
+				sqlite3_clear_bindings(nodeStatement);
+				sqlite3_reset(nodeStatement);
+			}
+		}
+	}
 
-	int status = sqlite3_prepare_v2(databaseTransaction->connection->db, [query UTF8String], -1, &statement, NULL);
 	if (status != SQLITE_OK)
 	{
-		YDBLogError(@"Error creating 'removeRowids' statement: %d %s",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
-		return;
+		YDBLogWarn(@"Unable to bulk load rtree index (%@): %d %s", tableName, status, sqlite3_errmsg(db));
 	}
 
-	for (i = 0; i < count; i++)
-	{
-		int64_t rowid = [[rowids objectAtIndex:i] longLongValue];
+	free(node);
+	free(firstNodeno);
 
-		sqlite3_bind_int64(statement, (int)(SQLITE_BIND_START + i), rowid);
-	}
+	sqlite3_finalize(nodeStatement);
+	sqlite3_finalize(parentStatement);
+	sqlite3_finalize(rowidStatement);
 
-	status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
+	if (status != SQLITE_OK)
 	{
-		YDBLogError(@"Error executing 'removeRowids' statement: %d %s",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		sqlite3_exec(db, "ROLLBACK TO yap_rtree_bulk_load;", NULL, NULL, NULL);
 	}
+	sqlite3_exec(db, "RELEASE yap_rtree_bulk_load;", NULL, NULL, NULL);
 
-	sqlite3_finalize(statement);
-
-	[parentConnection->mutationStack markAsMutated];
+	return (status == SQLITE_OK);
 }
 
-- (void)removeAllRowids
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Packing
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Rebuilds the rtree via a bulk load. See bulkLoad:.
+**/
+- (void)repack
 {
 	YDBLogAutoTrace();
 
-	sqlite3_stmt *statement = [parentConnection removeAllStatement];
-	if (statement == NULL)
-		return;
-
-	int status;
-
-	// DELETE FROM "tableName";
-
-	YDBLogVerbose(@"DELETE FROM '%@';", [self tableName]);
-
-	status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
+	if (![databaseTransaction isKindOfClass:[YapDatabaseReadWriteTransaction class]])
 	{
-		YDBLogError(@"(%@): Error in removeAllStatement: %d %s",
-		            [self registeredName],
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		YDBLogError(@"Attempting to repack rtree index within a read-only transaction");
+		return;
 	}
 
-	sqlite3_reset(statement);
-
-	[parentConnection->mutationStack markAsMutated];
+	[self flushPendingChanges];
+	[self rebuildWithEntries:nil];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Cleanup & Commit
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Optional override method from YapDatabaseExtensionTransaction.
+**/
+- (void)flushPendingChangesToExtensionTables
+{
+	YDBLogAutoTrace();
+
+	[self flushPendingChanges];
+}
+
 /**
  * Required override method from YapDatabaseExtension
 **/
@@ -993,6 +1837,10 @@ static NSString *const ext_key_version_deprecated = @"version";
 - (BOOL)_enumerateRowidsMatchingQuery:(YapDatabaseQuery *)query
                            usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, BOOL *stop))block
 {
+	// Write any pending changes, so the query includes them
+
+	[self flushPendingChanges];
+
 	// Create full query using given filtering clause(s)
 
 	NSString *fullQueryString =
@@ -1181,12 +2029,249 @@ static NSString *const ext_key_version_deprecated = @"version";
 	return result;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Nearest Neighbours
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Performs a best-first search of the rtree, starting from the root node.
+ *
+ * The priority queue contains both nodes & entries, ordered by their (minimum) distance from the point.
+ * When a node is popped, its cells are pushed. When an entry is popped, it's closer than anything left in the queue
+ * (because a node's bounding box contains everything beneath it), so it's passed to the block immediately.
+ * Thus only the nodes that are closer than the last entry returned are ever read.
+ *
+ * The nodes are read directly from the "tableName_node" shadow table (see bulkLoad: for the node format),
+ * because sqlite doesn't expose a nearest neighbour search (the query callback API isn't available everywhere).
+**/
+- (BOOL)_enumerateRowidsNearestToPoint:(NSArray<NSNumber *> *)point
+                            usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, double distance, BOOL *stop))block
+{
+	NSUInteger numCoordinates = [parentConnection->parent->setup count];
+	NSUInteger numDimensions = numCoordinates / 2;
+
+	if ([point count] != numDimensions)
+	{
+		YDBLogWarn(@"%@ - Invalid point: expected %lu values (one per dimension), but got %lu",
+		           NSStringFromSelector(_cmd), (unsigned long)numDimensions, (unsigned long)[point count]);
+		return NO;
+	}
+
+	NSMutableData *pointData = [NSMutableData dataWithLength:(numDimensions * sizeof(double))];
+	double *p = (double *)[pointData mutableBytes];
+
+	for (NSUInteger d = 0; d < numDimensions; d++)
+	{
+		id value = point[d];
+		if (![value isKindOfClass:[NSNumber class]])
+		{
+			YDBLogWarn(@"%@ - Invalid point: unsupported class: %@. Requires NSNumber.",
+			           NSStringFromSelector(_cmd), NSStringFromClass([value class]));
+			return NO;
+		}
+
+		p[d] = [(NSNumber *)value doubleValue];
+	}
+
+	// Write any pending changes, so the search includes them
+
+	[self flushPendingChanges];
+
+	sqlite3_stmt *statement = [parentConnection nodeStatement];
+	if (statement == NULL) return NO;
+
+	// SELECT "data" FROM "tableName_node" WHERE "nodeno" = ?;
+
+	size_t cellSize = 8 + (4 * numCoordinates);
+
+	YDBRTreeSearchQueue queue = { NULL, 0, 0 };
+	YDBRTreeSearchQueuePush(&queue, (YDBRTreeSearchItem){ .distance = 0.0, .pointer = 1, .level = 0 });
+
+	BOOL result = YES;
+	BOOL stop = NO;
+	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
+
+	while (queue.count > 0)
+	{
+		YDBRTreeSearchItem item = YDBRTreeSearchQueuePop(&queue);
+
+		if (item.level < 0)
+		{
+			block(item.pointer, sqrt(item.distance), &stop);
+
+			if (stop || mutation.isMutated) break;
+			continue;
+		}
+
+		sqlite3_bind_int64(statement, SQLITE_BIND_START, item.pointer);
+
+		int status = sqlite3_step(statement);
+		if (status != SQLITE_ROW)
+		{
+			YDBLogError(@"Error executing 'nodeStatement': %d %s",
+			            status, sqlite3_errmsg(databaseTransaction->connection->db));
+
+			sqlite3_reset(statement);
+			result = NO;
+			break;
+		}
+
+		const uint8_t *data = (const uint8_t *)sqlite3_column_blob(statement, SQLITE_COLUMN_START);
+		int length = sqlite3_column_bytes(statement, SQLITE_COLUMN_START);
+
+		uint16_t header[2] = { 0, 0 }; // depth (root node only), number of cells
+		if (length >= 4) {
+			memcpy(header, data, 4);
+		}
+
+		int level = (item.pointer == 1) ? (int)CFSwapInt16BigToHost(header[0]) : item.level;
+		NSUInteger cellCount = CFSwapInt16BigToHost(header[1]);
+
+		if ((length < 4) || ((4 + (cellCount * cellSize)) > (NSUInteger)length))
+		{
+			YDBLogError(@"Unexpected rtree node format (nodeno=%lld, length=%d)", item.pointer, length);
+
+			sqlite3_reset(statement);
+			result = NO;
+			break;
+		}
+
+		for (NSUInteger i = 0; i < cellCount; i++)
+		{
+			const uint8_t *cell = data + 4 + (i * cellSize);
+
+			uint64_t pointer;
+			memcpy(&pointer, cell, 8);
+
+			double distance = 0.0;
+
+			for (NSUInteger d = 0; d < numDimensions; d++)
+			{
+				uint32_t bits[2];
+				memcpy(bits, cell + 8 + (d * 8), 8);
+
+				bits[0] = CFSwapInt32BigToHost(bits[0]);
+				bits[1] = CFSwapInt32BigToHost(bits[1]);
+
+				float min, max;
+				memcpy(&min, &bits[0], 4);
+				memcpy(&max, &bits[1], 4);
+
+				double delta = 0.0;
+				if (p[d] < min)
+					delta = min - p[d];
+				else if (p[d] > max)
+					delta = p[d] - max;
+
+				distance += delta * delta;
+			}
+
+			YDBRTreeSearchQueuePush(&queue, (YDBRTreeSearchItem){
+				.distance = distance,
+				.pointer = (int64_t)CFSwapInt64BigToHost(pointer),
+				.level = (level == 0) ? -1 : (level - 1)
+			});
+		}
+
+		sqlite3_reset(statement);
+	}
+
+	sqlite3_clear_bindings(statement);
+	free(queue.items);
+
+	if (!stop && mutation.isMutated)
+	{
+		@throw [self mutationDuringEnumerationException];
+	}
+
+	return result;
+}
+
+- (BOOL)enumerateKeysNearestToPoint:(NSArray<NSNumber *> *)point
+                         usingBlock:
+            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, double distance, BOOL *stop))block
+{
+	if (point == nil) return NO;
+	if (block == nil) return NO;
+
+	BOOL result = [self _enumerateRowidsNearestToPoint:point usingBlock:^(int64_t rowid, double distance, BOOL *stop) {
+
+		YapCollectionKey *ck = [self->databaseTransaction collectionKeyForRowid:rowid];
+
+		block(ck.collection, ck.key, distance, stop);
+	}];
+
+	return result;
+}
+
+- (BOOL)enumerateKeysAndMetadataNearestToPoint:(NSArray<NSNumber *> *)point
+                                    usingBlock:
+            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id metadata, double distance, BOOL *stop))block
+{
+	if (point == nil) return NO;
+	if (block == nil) return NO;
+
+	BOOL result = [self _enumerateRowidsNearestToPoint:point usingBlock:^(int64_t rowid, double distance, BOOL *stop) {
+
+		YapCollectionKey *ck = nil;
+		id metadata = nil;
+		[self->databaseTransaction getCollectionKey:&ck metadata:&metadata forRowid:rowid];
+
+		block(ck.collection, ck.key, metadata, distance, stop);
+	}];
+
+	return result;
+}
+
+- (BOOL)enumerateKeysAndObjectsNearestToPoint:(NSArray<NSNumber *> *)point
+                                   usingBlock:
+            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, double distance, BOOL *stop))block
+{
+	if (point == nil) return NO;
+	if (block == nil) return NO;
+
+	BOOL result = [self _enumerateRowidsNearestToPoint:point usingBlock:^(int64_t rowid, double distance, BOOL *stop) {
+
+		YapCollectionKey *ck = nil;
+		id object = nil;
+		[self->databaseTransaction getCollectionKey:&ck object:&object forRowid:rowid];
+
+		block(ck.collection, ck.key, object, distance, stop);
+	}];
+
+	return result;
+}
+
+- (BOOL)enumerateRowsNearestToPoint:(NSArray<NSNumber *> *)point
+                         usingBlock:
+  (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, id metadata, double distance, BOOL *stop))block
+{
+	if (point == nil) return NO;
+	if (block == nil) return NO;
+
+	BOOL result = [self _enumerateRowidsNearestToPoint:point usingBlock:^(int64_t rowid, double distance, BOOL *stop) {
+
+		YapCollectionKey *ck = nil;
+		id object = nil;
+		id metadata = nil;
+		[self->databaseTransaction getCollectionKey:&ck object:&object metadata:&metadata forRowid:rowid];
+
+		block(ck.collection, ck.key, object, metadata, distance, stop);
+	}];
+
+	return result;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Count
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 - (BOOL)getNumberOfRows:(NSUInteger *)countPtr matchingQuery:(YapDatabaseQuery *)query
 {
+	// Write any pending changes, so the count includes them
+
+	[self flushPendingChanges];
+
 	// Create full query using given filtering clause(s)
 
 	NSString *fullQueryString =
@@ -0,0 +1,87 @@
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * An in-memory adjacency structure for all the edges with a particular name,
+ * stored in compressed-sparse-row (CSR) format.
+ *
+ * That is, for each direction (outgoing & incoming), the neighbors of every node are packed into a single
+ * contiguous array, and each node maps to a range within that array.
+ * This allows multi-hop traversals to run entirely in memory, without touching sqlite.
+ *
+ * Only edges where the destination is a node (i.e. a rowid in the database) are stored.
+ * Edges with a destinationFileURL are ignored.
+ *
+ * Changes made after the CSR arrays were built are stored in a small overlay (additions & tombstones).
+ * Once the overlay grows large enough, the CSR arrays are automatically rebuilt.
+ *
+ * This class is NOT thread-safe.
+ * It's owned by a YapDatabaseRelationshipConnection, and only accessed within the connection's transactions.
+ */
+@interface YapDatabaseRelationshipAdjacency : NSObject
+
+- (instancetype)initWithName:(NSString *)name;
+
+@property (nonatomic, copy, readonly) NSString *name;
+
+/**
+ * The number of edges currently represented.
+ */
+@property (nonatomic, readonly) NSUInteger edgeCount;
+
+/**
+ * Adds the edge (if not already present).
+ * If an edge with the same edgeRowid already exists, but with a different src/dst, it is replaced.
+ */
+- (void)addEdgeWithRowid:(int64_t)edgeRowid sourceRowid:(int64_t)srcRowid destinationRowid:(int64_t)dstRowid;
+
+/**
+ * Removes the edge (if present).
+ * Returns YES if the edge was found.
+ */
+- (BOOL)removeEdgeWithRowid:(int64_t)edgeRowid;
+
+/**
+ * Enumerates the neighbors of the given node.
+ *
+ * If outgoing is YES, enumerates the destinations of all edges where the node is the source.
+ * If outgoing is NO, enumerates the sources of all edges where the node is the destination.
+ */
+- (void)enumerateNeighborsOfNode:(int64_t)rowid
+                        outgoing:(BOOL)outgoing
+                      usingBlock:(void (NS_NOESCAPE^)(int64_t neighborRowid, BOOL *stop))block;
+
+@end
+
+/**
+ * Provides the neighbors of a node during a traversal.
+ * The provider invokes the visit block for each neighbor, and should stop if visit returns NO.
+ */
+typedef void (^YapDatabaseRelationshipNeighborProvider)(int64_t rowid, BOOL (NS_NOESCAPE^visit)(int64_t neighborRowid));
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * Generic graph traversal over rowids.
+ *
+ * Every node is visited at most once (cycles are handled), and the start node is not reported.
+ * The depth of a node is the number of hops from the start node.
+ * A maxDepth of zero means no limit.
+ *
+ * If depthFirst is NO, nodes are visited in breadth-first order,
+ * and each node is reported with its shortest distance from the start node.
+ */
+void YapDatabaseRelationshipTraverse(int64_t startRowid,
+                                     BOOL depthFirst,
+                                     NSUInteger maxDepth,
+                                     YapDatabaseRelationshipNeighborProvider neighbors,
+                                     void (NS_NOESCAPE^block)(int64_t rowid, NSUInteger depth, BOOL *stop));
+
+#if defined(__cplusplus)
+}
+#endif
+
+NS_ASSUME_NONNULL_END
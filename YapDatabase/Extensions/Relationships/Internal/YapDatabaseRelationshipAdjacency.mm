@@ -0,0 +1,377 @@
+#import "YapDatabaseRelationshipAdjacency.h"
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#if ! __has_feature(objc_arc)
+#warning This file must be compiled with ARC. Use -fobjc-arc flag (or convert project to ARC).
+#endif
+
+/**
+ * The overlay (additions & tombstones) is folded back into the CSR arrays
+ * once it exceeds this many entries, or a quarter of the edge count (whichever is larger).
+**/
+static const size_t kMinCompactionThreshold = 256;
+
+struct YDBAdjacencyEntry {
+	int64_t edgeRowid;
+	int64_t nodeRowid;
+};
+
+struct YDBAdjacencyRange {
+	size_t offset;
+	size_t length;
+};
+
+typedef std::unordered_map<int64_t, std::pair<int64_t, int64_t>> YDBAdjacencyEdgeMap;      // edgeRowid -> (src, dst)
+typedef std::unordered_map<int64_t, YDBAdjacencyRange>            YDBAdjacencyRangeMap;     // nodeRowid -> range
+typedef std::unordered_map<int64_t, std::vector<YDBAdjacencyEntry>> YDBAdjacencyOverlayMap; // nodeRowid -> entries
+
+static void BuildCSR(const YDBAdjacencyEdgeMap *edges,
+                     BOOL outgoing,
+                     std::vector<YDBAdjacencyEntry> *entries,
+                     YDBAdjacencyRangeMap *ranges)
+{
+	entries->clear();
+	ranges->clear();
+
+	// Pass 1: Count the degree of each node
+
+	for (auto it = edges->begin(); it != edges->end(); ++it)
+	{
+		int64_t nodeRowid = outgoing ? it->second.first : it->second.second;
+
+		YDBAdjacencyRange &range = (*ranges)[nodeRowid];
+		range.length++;
+	}
+
+	// Pass 2: Assign offsets (prefix sum)
+
+	size_t offset = 0;
+	for (auto it = ranges->begin(); it != ranges->end(); ++it)
+	{
+		it->second.offset = offset;
+		offset += it->second.length;
+
+		it->second.length = 0; // reset, re-counted while filling below
+	}
+
+	// Pass 3: Fill
+
+	entries->resize(edges->size());
+
+	for (auto it = edges->begin(); it != edges->end(); ++it)
+	{
+		int64_t nodeRowid     = outgoing ? it->second.first  : it->second.second;
+		int64_t neighborRowid = outgoing ? it->second.second : it->second.first;
+
+		YDBAdjacencyRange &range = (*ranges)[nodeRowid];
+
+		YDBAdjacencyEntry &entry = (*entries)[range.offset + range.length];
+		entry.edgeRowid = it->first;
+		entry.nodeRowid = neighborRowid;
+
+		range.length++;
+	}
+}
+
+static BOOL RemoveFromOverlay(YDBAdjacencyOverlayMap *overlay, int64_t nodeRowid, int64_t edgeRowid)
+{
+	auto found = overlay->find(nodeRowid);
+	if (found == overlay->end()) return NO;
+
+	std::vector<YDBAdjacencyEntry> &entries = found->second;
+
+	for (auto it = entries.begin(); it != entries.end(); ++it)
+	{
+		if (it->edgeRowid == edgeRowid)
+		{
+			entries.erase(it);
+
+			if (entries.empty()) {
+				overlay->erase(found);
+			}
+			return YES;
+		}
+	}
+
+	return NO;
+}
+
+
+@implementation YapDatabaseRelationshipAdjacency
+{
+	YDBAdjacencyEdgeMap *edges;
+
+	std::vector<YDBAdjacencyEntry> *outEntries;
+	YDBAdjacencyRangeMap *outRanges;
+
+	std::vector<YDBAdjacencyEntry> *inEntries;
+	YDBAdjacencyRangeMap *inRanges;
+
+	std::unordered_set<int64_t> *tombstones; // edgeRowids within the CSR arrays that have since been removed
+
+	YDBAdjacencyOverlayMap *outOverlay;
+	YDBAdjacencyOverlayMap *inOverlay;
+	size_t overlayCount;
+}
+
+@synthesize name = name;
+
+- (instancetype)initWithName:(NSString *)inName
+{
+	if ((self = [super init]))
+	{
+		name = [inName copy];
+
+		edges = new YDBAdjacencyEdgeMap();
+
+		outEntries = new std::vector<YDBAdjacencyEntry>();
+		outRanges = new YDBAdjacencyRangeMap();
+
+		inEntries = new std::vector<YDBAdjacencyEntry>();
+		inRanges = new YDBAdjacencyRangeMap();
+
+		tombstones = new std::unordered_set<int64_t>();
+
+		outOverlay = new YDBAdjacencyOverlayMap();
+		inOverlay = new YDBAdjacencyOverlayMap();
+		overlayCount = 0;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	delete edges;
+	delete outEntries;
+	delete outRanges;
+	delete inEntries;
+	delete inRanges;
+	delete tombstones;
+	delete outOverlay;
+	delete inOverlay;
+}
+
+- (NSUInteger)edgeCount
+{
+	return (NSUInteger)edges->size();
+}
+
+- (void)addEdgeWithRowid:(int64_t)edgeRowid sourceRowid:(int64_t)srcRowid destinationRowid:(int64_t)dstRowid
+{
+	auto found = edges->find(edgeRowid);
+	if (found != edges->end())
+	{
+		if (found->second.first == srcRowid && found->second.second == dstRowid) {
+			return; // already present
+		}
+
+		[self removeEdgeWithRowid:edgeRowid];
+	}
+
+	edges->emplace(edgeRowid, std::make_pair(srcRowid, dstRowid));
+
+	(*outOverlay)[srcRowid].push_back({ edgeRowid, dstRowid });
+	(*inOverlay)[dstRowid].push_back({ edgeRowid, srcRowid });
+	overlayCount++;
+}
+
+- (BOOL)removeEdgeWithRowid:(int64_t)edgeRowid
+{
+	auto found = edges->find(edgeRowid);
+	if (found == edges->end()) return NO;
+
+	int64_t srcRowid = found->second.first;
+	int64_t dstRowid = found->second.second;
+
+	edges->erase(found);
+
+	if (RemoveFromOverlay(outOverlay, srcRowid, edgeRowid))
+	{
+		RemoveFromOverlay(inOverlay, dstRowid, edgeRowid);
+		overlayCount--;
+	}
+	else
+	{
+		tombstones->insert(edgeRowid);
+	}
+
+	return YES;
+}
+
+/**
+ * Folds the overlay back into the CSR arrays, if it has grown large enough to matter.
+**/
+- (void)compactIfNeeded
+{
+	size_t pending = overlayCount + tombstones->size();
+	if (pending == 0) return;
+
+	size_t threshold = MAX(kMinCompactionThreshold, edges->size() / 4);
+
+	// If the CSR arrays are empty (e.g. freshly loaded), there's no reason to wait.
+
+	if ((pending > threshold) || (outEntries->empty() && inEntries->empty()))
+	{
+		BuildCSR(edges, YES, outEntries, outRanges);
+		BuildCSR(edges, NO,  inEntries,  inRanges);
+
+		tombstones->clear();
+		outOverlay->clear();
+		inOverlay->clear();
+		overlayCount = 0;
+	}
+}
+
+- (void)enumerateNeighborsOfNode:(int64_t)rowid
+                        outgoing:(BOOL)outgoing
+                      usingBlock:(void (NS_NOESCAPE^)(int64_t neighborRowid, BOOL *stop))block
+{
+	[self compactIfNeeded];
+
+	BOOL stop = NO;
+
+	std::vector<YDBAdjacencyEntry> *entries = outgoing ? outEntries : inEntries;
+	YDBAdjacencyRangeMap *ranges            = outgoing ? outRanges  : inRanges;
+	YDBAdjacencyOverlayMap *overlay         = outgoing ? outOverlay : inOverlay;
+
+	auto range = ranges->find(rowid);
+	if (range != ranges->end())
+	{
+		const BOOL hasTombstones = !tombstones->empty();
+
+		const YDBAdjacencyEntry *entry = entries->data() + range->second.offset;
+		const YDBAdjacencyEntry *end = entry + range->second.length;
+
+		for (; entry < end; entry++)
+		{
+			if (hasTombstones && (tombstones->find(entry->edgeRowid) != tombstones->end())) {
+				continue;
+			}
+
+			block(entry->nodeRowid, &stop);
+			if (stop) return;
+		}
+	}
+
+	auto added = overlay->find(rowid);
+	if (added != overlay->end())
+	{
+		for (const YDBAdjacencyEntry &entry : added->second)
+		{
+			block(entry.nodeRowid, &stop);
+			if (stop) return;
+		}
+	}
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Traversal
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void YapDatabaseRelationshipTraverse(int64_t startRowid,
+                                     BOOL depthFirst,
+                                     NSUInteger maxDepth,
+                                     YapDatabaseRelationshipNeighborProvider neighbors,
+                                     void (NS_NOESCAPE^block)(int64_t rowid, NSUInteger depth, BOOL *stop))
+{
+	if (neighbors == NULL) return;
+	if (block == NULL) return;
+
+	// Blocks capture C++ objects by const copy, so they're referenced via pointers within the blocks below.
+
+	std::unordered_set<int64_t> visited;
+	std::unordered_set<int64_t> *visitedPtr = &visited;
+
+	visited.insert(startRowid);
+
+	__block BOOL stop = NO;
+
+	if (depthFirst)
+	{
+		// Iterative depth-first (pre-order).
+		// A node is reported (and marked as visited) when it's popped off the stack.
+
+		std::vector<std::pair<int64_t, NSUInteger>> stack;
+		std::vector<int64_t> children;
+		std::vector<int64_t> *childrenPtr = &children;
+
+		stack.push_back(std::make_pair(startRowid, (NSUInteger)0));
+
+		while (!stack.empty() && !stop)
+		{
+			std::pair<int64_t, NSUInteger> item = stack.back();
+			stack.pop_back();
+
+			int64_t rowid = item.first;
+			NSUInteger depth = item.second;
+
+			if (depth > 0)
+			{
+				if (visited.find(rowid) != visited.end()) continue;
+				visited.insert(rowid);
+
+				block(rowid, depth, &stop);
+				if (stop) break;
+			}
+
+			if (maxDepth > 0 && depth >= maxDepth) continue;
+
+			children.clear();
+			neighbors(rowid, ^BOOL (int64_t neighborRowid) {
+
+				if (visitedPtr->find(neighborRowid) == visitedPtr->end()) {
+					childrenPtr->push_back(neighborRowid);
+				}
+				return YES;
+			});
+
+			// Push in reverse, so children are visited in the order they were provided
+			for (auto it = children.rbegin(); it != children.rend(); ++it)
+			{
+				stack.push_back(std::make_pair(*it, depth + 1));
+			}
+		}
+	}
+	else
+	{
+		// Breadth-first.
+		// A node is marked as visited when it's discovered, so each node is reported at its shortest depth.
+
+		std::deque<std::pair<int64_t, NSUInteger>> queue;
+		std::deque<std::pair<int64_t, NSUInteger>> *queuePtr = &queue;
+
+		queue.push_back(std::make_pair(startRowid, (NSUInteger)0));
+
+		while (!queue.empty() && !stop)
+		{
+			std::pair<int64_t, NSUInteger> item = queue.front();
+			queue.pop_front();
+
+			int64_t rowid = item.first;
+			NSUInteger depth = item.second;
+
+			if (maxDepth > 0 && depth >= maxDepth) continue;
+
+			neighbors(rowid, ^BOOL (int64_t neighborRowid) {
+
+				if (visitedPtr->find(neighborRowid) != visitedPtr->end()) {
+					return YES;
+				}
+				visitedPtr->insert(neighborRowid);
+
+				block(neighborRowid, depth + 1, &stop);
+				if (stop) return NO;
+
+				queuePtr->push_back(std::make_pair(neighborRowid, depth + 1));
+				return YES;
+			});
+		}
+	}
+}
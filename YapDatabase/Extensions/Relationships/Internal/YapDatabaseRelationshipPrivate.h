@@ -14,6 +14,8 @@
 
 #import "YapCache.h"
 
+@class YapDatabaseRelationshipAdjacency;
+
 /**
  * This version number is stored in the yap2 table.
  * If there is a major re-write to this class, then the version number will be incremented,
@@ -36,6 +38,7 @@ static NSString *const ext_key_version_deprecated = @"version";
 static NSString *const changeset_key_deletedEdges  = @"deletedEdges";
 static NSString *const changeset_key_modifiedEdges = @"modifiedEdges";
 static NSString *const changeset_key_reset         = @"reset";
+static NSString *const changeset_key_insertedEdges = @"insertedEdges";
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark -
@@ -49,6 +52,8 @@ static NSString *const changeset_key_reset         = @"reset";
 }
 
 - (NSString *)tableName;
+- (NSString *)deletedNodesTableName;
+- (NSString *)reachableNodesTableName;
 
 /**
  * The dispatch queue for performing file deletion operations.
@@ -67,6 +72,8 @@ static NSString *const changeset_key_reset         = @"reset";
 	
 	BOOL disableYapDatabaseRelationshipNodeProtocol;
 	YapWhitelistBlacklist *allowedCollections;
+	NSUInteger populateConcurrency;
+	NSSet<NSString *> *adjacencyCacheEdgeNames;
 }
 
 @end
@@ -99,8 +106,11 @@ static NSString *const changeset_key_reset         = @"reset";
 	
 	NSMutableSet<NSNumber *> *deletedEdges;                                      // values:edgeRowid
 	NSMutableDictionary<NSNumber*, YapDatabaseRelationshipEdge*> *modifiedEdges; // key:edgeRowid, value:edge
+	NSMutableDictionary<NSNumber*, YapDatabaseRelationshipEdge*> *insertedEdges; // key:edgeRowid, value:edge
 	
 	NSMutableSet<NSURL *> *filesToDelete;
+	
+	NSMutableDictionary<NSString*, YapDatabaseRelationshipAdjacency*> *adjacencyCache; // key:edgeName
 }
 
 - (id)initWithParent:(YapDatabaseRelationship *)parent databaseConnection:(YapDatabaseConnection *)databaseConnection;
@@ -108,13 +118,22 @@ static NSString *const changeset_key_reset         = @"reset";
 - (void)postCommitCleanup;
 - (void)postRollbackCleanup;
 
+- (void)updateAdjacencyCacheWithDeletedEdges:(NSSet<NSNumber*> *)deletedEdges
+                               insertedEdges:(NSDictionary<NSNumber*, YapDatabaseRelationshipEdge*> *)insertedEdges
+                                       reset:(BOOL)reset;
+
 - (sqlite3_stmt *)findEdgesWithNodeStatement;
+- (sqlite3_stmt *)findEdgesWithDeletedNodeStatement;
 - (sqlite3_stmt *)findManualEdgeWithDstStatement;
 - (sqlite3_stmt *)findManualEdgeWithDstFileURLStatement;
 - (sqlite3_stmt *)insertEdgeStatement;
 - (sqlite3_stmt *)updateEdgeStatement;
 - (sqlite3_stmt *)deleteEdgeStatement;
 - (sqlite3_stmt *)deleteEdgesWithNodeStatement;
+- (sqlite3_stmt *)deleteEdgesWithDeletedSrcStatement;
+- (sqlite3_stmt *)deleteEdgesWithDeletedDstStatement;
+- (sqlite3_stmt *)insertDeletedNodeStatement;
+- (sqlite3_stmt *)removeAllDeletedNodesStatement;
 - (sqlite3_stmt *)enumerateDstFileURLWithSrcStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateDstFileURLWithSrcNameStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateDstFileURLWithNameStatement:(BOOL *)needsFinalizePtr;
@@ -122,13 +141,22 @@ static NSString *const changeset_key_reset         = @"reset";
 - (sqlite3_stmt *)enumerateAllDstFileURLStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateForSrcStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateForDstStatement:(BOOL *)needsFinalizePtr;
+- (sqlite3_stmt *)enumerateForDeletedSrcStatement:(BOOL *)needsFinalizePtr;
+- (sqlite3_stmt *)enumerateForDeletedDstStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateForSrcNameStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateForDstNameStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateForNameStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateForSrcDstStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateForSrcDstNameStatement:(BOOL *)needsFinalizePtr;
+- (sqlite3_stmt *)insertReachableForSrcNameStatement;
+- (sqlite3_stmt *)insertReachableForDstNameStatement;
+- (sqlite3_stmt *)insertReachableStartStatement;
+- (sqlite3_stmt *)enumerateReachableForDepthStatement;
+- (sqlite3_stmt *)removeAllReachableStatement;
 - (sqlite3_stmt *)countForSrcExcludingDstStatement;
 - (sqlite3_stmt *)countForDstExcludingSrcStatement;
+- (sqlite3_stmt *)countForSrcExcludingDeletedDstStatement;
+- (sqlite3_stmt *)countForDstExcludingDeletedSrcStatement;
 - (sqlite3_stmt *)countForNameStatement;
 - (sqlite3_stmt *)countForSrcStatement;
 - (sqlite3_stmt *)countForSrcNameStatement;
@@ -155,4 +183,14 @@ static NSString *const changeset_key_reset         = @"reset";
 - (id)initWithParentConnection:(YapDatabaseRelationshipConnection *)parentConnection
            databaseTransaction:(YapDatabaseReadTransaction *)databaseTransaction;
 
+/**
+ * Rowid based version of the recursive queries, for use by other extensions.
+ * The starting node is not reported. Pass zero for maxDepth for no limit.
+**/
+- (void)_enumerateRowidsReachableFromRowid:(int64_t)startRowid
+                              withEdgeName:(NSString *)edgeName
+                                  outgoing:(BOOL)outgoing
+                                  maxDepth:(NSUInteger)maxDepth
+                                usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, NSUInteger depth, BOOL *stop))block;
+
 @end
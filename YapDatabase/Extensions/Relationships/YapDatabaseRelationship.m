@@ -133,6 +133,27 @@
 	return [[self class] tableNameForRegisteredName:self.registeredName];
 }
 
+/**
+ * The name of the TEMP table used (per connection) during flush processing,
+ * to hold the rowids of nodes that have been deleted, but whose edges haven't yet been processed.
+ *
+ * Note: Temp tables shadow tables in the main database with the same name.
+ * So we use a different prefix than tableNameForRegisteredName.
+**/
+- (NSString *)deletedNodesTableName
+{
+	return [NSString stringWithFormat:@"yap_relationship_deleted_%@", self.registeredName];
+}
+
+/**
+ * The name of the TEMP table used (per connection) by the recursive queries,
+ * to hold the visited nodes (and their depth) during a breadth-first search.
+**/
+- (NSString *)reachableNodesTableName
+{
+	return [NSString stringWithFormat:@"yap_relationship_reachable_%@", self.registeredName];
+}
+
 /**
  * The dispatch queue for performing file deletion operations.
  * Note: This method is not thread-safe, as it expects to only be invoked from within a read-write transaction.
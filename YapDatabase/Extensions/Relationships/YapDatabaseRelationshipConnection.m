@@ -1,5 +1,7 @@
 #import "YapDatabaseRelationshipConnection.h"
 #import "YapDatabaseRelationshipPrivate.h"
+#import "YapDatabaseRelationshipEdgePrivate.h"
+#import "YapDatabaseRelationshipAdjacency.h"
 #import "YapDatabaseExtensionPrivate.h"
 #import "YapDatabasePrivate.h"
 #import "YapCollectionKey.h"
@@ -27,12 +29,17 @@
 @implementation YapDatabaseRelationshipConnection
 {
 	sqlite3_stmt *findEdgesWithNodeStatement;
+	sqlite3_stmt *findEdgesWithDeletedNodeStatement;
 	sqlite3_stmt *findManualEdgeWithDstStatement;
 	sqlite3_stmt *findManualEdgeWithDstFileURLStatement;
 	sqlite3_stmt *insertEdgeStatement;
 	sqlite3_stmt *updateEdgeStatement;
 	sqlite3_stmt *deleteEdgeStatement;
 	sqlite3_stmt *deleteEdgesWithNodeStatement;
+	sqlite3_stmt *deleteEdgesWithDeletedSrcStatement;
+	sqlite3_stmt *deleteEdgesWithDeletedDstStatement;
+	sqlite3_stmt *insertDeletedNodeStatement;
+	sqlite3_stmt *removeAllDeletedNodesStatement;
 	sqlite3_stmt *enumerateDstFileURLWithSrcStatement;
 	sqlite3_stmt *enumerateDstFileURLWithSrcNameStatement;
 	sqlite3_stmt *enumerateDstFileURLWithNameStatement;
@@ -40,11 +47,18 @@
 	sqlite3_stmt *enumerateAllDstFileURLStatement;
 	sqlite3_stmt *enumerateForSrcStatement;
 	sqlite3_stmt *enumerateForDstStatement;
+	sqlite3_stmt *enumerateForDeletedSrcStatement;
+	sqlite3_stmt *enumerateForDeletedDstStatement;
 	sqlite3_stmt *enumerateForSrcNameStatement;
 	sqlite3_stmt *enumerateForDstNameStatement;
 	sqlite3_stmt *enumerateForNameStatement;
 	sqlite3_stmt *enumerateForSrcDstStatement;
 	sqlite3_stmt *enumerateForSrcDstNameStatement;
+	sqlite3_stmt *insertReachableForSrcNameStatement;
+	sqlite3_stmt *insertReachableForDstNameStatement;
+	sqlite3_stmt *insertReachableStartStatement;
+	sqlite3_stmt *enumerateReachableForDepthStatement;
+	sqlite3_stmt *removeAllReachableStatement;
 	sqlite3_stmt *countForSrcStatement;
 	sqlite3_stmt *countForDstStatement;
 	sqlite3_stmt *countForSrcNameStatement;
@@ -54,6 +68,8 @@
 	sqlite3_stmt *countForSrcDstNameStatement;
 	sqlite3_stmt *countForSrcExcludingDstStatement;
 	sqlite3_stmt *countForDstExcludingSrcStatement;
+	sqlite3_stmt *countForSrcExcludingDeletedDstStatement;
+	sqlite3_stmt *countForDstExcludingDeletedSrcStatement;
 	sqlite3_stmt *removeAllStatement;
 	sqlite3_stmt *removeAllProtocolStatement;
 }
@@ -84,12 +100,17 @@
 - (void)_flushStatements
 {
 	sqlite_finalize_null(&findEdgesWithNodeStatement);
+	sqlite_finalize_null(&findEdgesWithDeletedNodeStatement);
 	sqlite_finalize_null(&findManualEdgeWithDstStatement);
 	sqlite_finalize_null(&findManualEdgeWithDstFileURLStatement);
 	sqlite_finalize_null(&insertEdgeStatement);
 	sqlite_finalize_null(&updateEdgeStatement);
 	sqlite_finalize_null(&deleteEdgeStatement);
 	sqlite_finalize_null(&deleteEdgesWithNodeStatement);
+	sqlite_finalize_null(&deleteEdgesWithDeletedSrcStatement);
+	sqlite_finalize_null(&deleteEdgesWithDeletedDstStatement);
+	sqlite_finalize_null(&insertDeletedNodeStatement);
+	sqlite_finalize_null(&removeAllDeletedNodesStatement);
 	sqlite_finalize_null(&enumerateDstFileURLWithSrcStatement);
 	sqlite_finalize_null(&enumerateDstFileURLWithSrcNameStatement);
 	sqlite_finalize_null(&enumerateDstFileURLWithNameStatement);
@@ -97,11 +118,18 @@
 	sqlite_finalize_null(&enumerateAllDstFileURLStatement);
 	sqlite_finalize_null(&enumerateForSrcStatement);
 	sqlite_finalize_null(&enumerateForDstStatement);
+	sqlite_finalize_null(&enumerateForDeletedSrcStatement);
+	sqlite_finalize_null(&enumerateForDeletedDstStatement);
 	sqlite_finalize_null(&enumerateForSrcNameStatement);
 	sqlite_finalize_null(&enumerateForDstNameStatement);
 	sqlite_finalize_null(&enumerateForNameStatement);
 	sqlite_finalize_null(&enumerateForSrcDstStatement);
 	sqlite_finalize_null(&enumerateForSrcDstNameStatement);
+	sqlite_finalize_null(&insertReachableForSrcNameStatement);
+	sqlite_finalize_null(&insertReachableForDstNameStatement);
+	sqlite_finalize_null(&insertReachableStartStatement);
+	sqlite_finalize_null(&enumerateReachableForDepthStatement);
+	sqlite_finalize_null(&removeAllReachableStatement);
 	sqlite_finalize_null(&countForSrcStatement);
 	sqlite_finalize_null(&countForSrcNameStatement);
 	sqlite_finalize_null(&countForDstStatement);
@@ -111,6 +139,8 @@
 	sqlite_finalize_null(&countForSrcDstNameStatement);
 	sqlite_finalize_null(&countForSrcExcludingDstStatement);
 	sqlite_finalize_null(&countForDstExcludingSrcStatement);
+	sqlite_finalize_null(&countForSrcExcludingDeletedDstStatement);
+	sqlite_finalize_null(&countForDstExcludingDeletedSrcStatement);
 	sqlite_finalize_null(&removeAllStatement);
 	sqlite_finalize_null(&removeAllProtocolStatement);
 }
@@ -128,6 +158,7 @@
 	if (flags & YapDatabaseConnectionFlushMemoryFlags_Caches)
 	{
 		[edgeCache removeAllObjects];
+		adjacencyCache = nil;
 	}
 }
 
@@ -202,6 +233,9 @@
 	if (modifiedEdges == nil)
 		modifiedEdges = [[NSMutableDictionary alloc] init];
 	
+	if (insertedEdges == nil)
+		insertedEdges = [[NSMutableDictionary alloc] init];
+	
 	if (filesToDelete == nil)
 		filesToDelete = [[NSMutableSet alloc] init];
 }
@@ -224,6 +258,7 @@
 	// The following may be stored in the changeset notification:
 	// - deletedEdges
 	// - modifiedEdges
+	// - insertedEdges
 	// - reset
 	//
 	// The following are used post-transaction:
@@ -237,6 +272,9 @@
 	if (modifiedEdges.count > 0)
 		modifiedEdges = nil;
 	
+	if (insertedEdges.count > 0)
+		insertedEdges = nil;
+	
 	if ([filesToDelete count] > 0)
 		filesToDelete = nil;
 }
@@ -258,13 +296,19 @@
 	
 	[deletedEdges removeAllObjects];
 	[modifiedEdges removeAllObjects];
+	[insertedEdges removeAllObjects];
 	[filesToDelete removeAllObjects];
+	
+	// An adjacency graph may have been loaded from within the rolled back transaction.
+	// Edges with other names aren't tracked, so we can't be certain it reflects the committed state.
+	adjacencyCache = nil;
 }
 
 - (NSArray *)internalChangesetKeys
 {
 	return @[ changeset_key_deletedEdges,
 	          changeset_key_modifiedEdges,
+	          changeset_key_insertedEdges,
 	          changeset_key_reset ];
 }
 
@@ -280,6 +324,7 @@
 	
 	if (deletedEdges.count  > 0 ||
 	    modifiedEdges.count > 0 ||
+	    insertedEdges.count > 0 ||
 		reset)
 	{
 		internalChangeset = [NSMutableDictionary dictionaryWithSharedKeySet:sharedKeySetForInternalChangeset];
@@ -294,6 +339,11 @@
 			internalChangeset[changeset_key_modifiedEdges] = modifiedEdges;
 		}
 		
+		if (insertedEdges.count > 0)
+		{
+			internalChangeset[changeset_key_insertedEdges] = insertedEdges;
+		}
+		
 		if (reset)
 		{
 			internalChangeset[changeset_key_reset] = @(reset);
@@ -313,6 +363,7 @@
 	
 	NSSet        *changeset_deletedEdges  = changeset[changeset_key_deletedEdges];
 	NSDictionary *changeset_modifiedEdges = changeset[changeset_key_modifiedEdges];
+	NSDictionary *changeset_insertedEdges = changeset[changeset_key_insertedEdges];
 	
 	BOOL changeset_reset = [changeset[changeset_key_reset] boolValue];
 	
@@ -356,6 +407,57 @@
 			[edgeCache setObject:[edge copy] forKey:edgeRowid];
 		}
 	}
+	
+	// Update adjacencyCache
+	
+	[self updateAdjacencyCacheWithDeletedEdges:changeset_deletedEdges
+	                             insertedEdges:changeset_insertedEdges
+	                                     reset:changeset_reset];
+}
+
+/**
+ * Applies the changes from a commit to any in-memory adjacency graphs.
+ *
+ * This is invoked for commits from other connections (via processChangeset),
+ * as well as for our own commits (via didCommitTransaction).
+**/
+- (void)updateAdjacencyCacheWithDeletedEdges:(NSSet<NSNumber*> *)inDeletedEdges
+                               insertedEdges:(NSDictionary<NSNumber*, YapDatabaseRelationshipEdge*> *)inInsertedEdges
+                                       reset:(BOOL)inReset
+{
+	if (adjacencyCache.count == 0) return;
+	
+	if (inReset)
+	{
+		// Graphs will be reloaded on demand
+		[adjacencyCache removeAllObjects];
+		return;
+	}
+	
+	// Order matters.
+	// It's possible for an edgeRowid to be deleted, and then re-used for a new edge, within the same commit.
+	
+	for (NSNumber *edgeRowid in inDeletedEdges)
+	{
+		int64_t rowid = [edgeRowid longLongValue];
+		
+		for (YapDatabaseRelationshipAdjacency *adjacency in [adjacencyCache objectEnumerator])
+		{
+			if ([adjacency removeEdgeWithRowid:rowid]) break;
+		}
+	}
+	
+	[inInsertedEdges enumerateKeysAndObjectsUsingBlock:
+	    ^(NSNumber *edgeRowid, YapDatabaseRelationshipEdge *edge, BOOL __unused *stop)
+	{
+		YapDatabaseRelationshipAdjacency *adjacency = self->adjacencyCache[edge->name];
+		if (adjacency)
+		{
+			[adjacency addEdgeWithRowid:[edgeRowid longLongValue]
+			                sourceRowid:edge->sourceRowid
+			           destinationRowid:edge->destinationRowid];
+		}
+	}];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -371,6 +473,18 @@
  *    "rules" INTEGER,
  *    "manual" INTEGER
  *   );
+ *
+ * CREATE TEMP TABLE IF NOT EXISTS "deletedNodesTableName"
+ *   ("rowid" INTEGER PRIMARY KEY);
+ *
+ * CREATE TEMP TABLE IF NOT EXISTS "reachableNodesTableName"
+ *   ("rowid" INTEGER PRIMARY KEY,
+ *    "depth" INTEGER NOT NULL
+ *   );
+ *
+ * Statements referencing the temp tables must only be created after the temp tables exist.
+ * See: [YapDatabaseRelationshipTransaction createDeletedNodesTableIfNeeded]
+ *      [YapDatabaseRelationshipTransaction createReachableNodesTableIfNeeded]
 **/
 
 - (void)prepareStatement:(sqlite3_stmt **)statement withString:(NSString *)stmtString caller:(SEL)caller_cmd
@@ -402,6 +516,23 @@
 	return *statement;
 }
 
+- (sqlite3_stmt *)findEdgesWithDeletedNodeStatement
+{
+	sqlite3_stmt **statement = &findEdgesWithDeletedNodeStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT \"rowid\" FROM \"%1$@\" WHERE \"src\" IN (SELECT \"rowid\" FROM \"temp\".\"%2$@\")"
+		  @" UNION ALL"
+		  @" SELECT \"rowid\" FROM \"%1$@\" WHERE \"dst\" IN (SELECT \"rowid\" FROM \"temp\".\"%2$@\");",
+		  [parent tableName], [parent deletedNodesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
 
 - (sqlite3_stmt *)findManualEdgeWithDstStatement
 {
@@ -492,6 +623,64 @@
 	return *statement;
 }
 
+- (sqlite3_stmt *)deleteEdgesWithDeletedSrcStatement
+{
+	sqlite3_stmt **statement = &deleteEdgesWithDeletedSrcStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"DELETE FROM \"%@\" WHERE \"src\" IN (SELECT \"rowid\" FROM \"temp\".\"%@\");",
+		  [parent tableName], [parent deletedNodesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)deleteEdgesWithDeletedDstStatement
+{
+	sqlite3_stmt **statement = &deleteEdgesWithDeletedDstStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"DELETE FROM \"%@\" WHERE \"dst\" IN (SELECT \"rowid\" FROM \"temp\".\"%@\");",
+		  [parent tableName], [parent deletedNodesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)insertDeletedNodeStatement
+{
+	sqlite3_stmt **statement = &insertDeletedNodeStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"INSERT OR IGNORE INTO \"temp\".\"%@\" (\"rowid\") VALUES (?);", [parent deletedNodesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)removeAllDeletedNodesStatement
+{
+	sqlite3_stmt **statement = &removeAllDeletedNodesStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"DELETE FROM \"temp\".\"%@\";", [parent deletedNodesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
 - (sqlite3_stmt *)enumerateDstFileURLWithSrcStatement:(BOOL *)needsFinalizePtr
 {
 	sqlite3_stmt **statement = &enumerateDstFileURLWithSrcStatement;
@@ -832,6 +1021,88 @@
 	return result;
 }
 
+- (sqlite3_stmt *)enumerateForDeletedSrcStatement:(BOOL *)needsFinalizePtr
+{
+	sqlite3_stmt **statement = &enumerateForDeletedSrcStatement;
+	
+	sqlite3_stmt* (^CreateStatement)(void) = ^{
+		
+		// Only edges with nodeDeleteRules require processing when a node is deleted.
+		
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT \"rowid\", \"name\", \"src\", \"dst\", \"rules\", \"manual\" FROM \"%@\""
+		  @" WHERE \"src\" IN (SELECT \"rowid\" FROM \"temp\".\"%@\") AND \"rules\" != 0;",
+		  [self->parent tableName], [self->parent deletedNodesTableName]];
+		
+		sqlite3_stmt *stmt = NULL;
+		[self prepareStatement:&stmt withString:string caller:_cmd];
+		
+		return stmt;
+	};
+	
+	BOOL needsFinalize = NO;
+	sqlite3_stmt *result = NULL;
+	
+	if (*statement == NULL)
+	{
+		result = *statement = CreateStatement();
+	}
+	else if (sqlite3_stmt_busy(*statement))
+	{
+		result = CreateStatement();
+		needsFinalize = YES;
+	}
+	else
+	{
+		result = *statement;
+	}
+	
+	NSParameterAssert(needsFinalizePtr != NULL);
+	*needsFinalizePtr = needsFinalize;
+	return result;
+}
+
+- (sqlite3_stmt *)enumerateForDeletedDstStatement:(BOOL *)needsFinalizePtr
+{
+	sqlite3_stmt **statement = &enumerateForDeletedDstStatement;
+	
+	sqlite3_stmt* (^CreateStatement)(void) = ^{
+		
+		// Only edges with nodeDeleteRules require processing when a node is deleted.
+		
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT \"rowid\", \"name\", \"src\", \"dst\", \"rules\", \"manual\" FROM \"%@\""
+		  @" WHERE \"dst\" IN (SELECT \"rowid\" FROM \"temp\".\"%@\") AND \"rules\" != 0;",
+		  [self->parent tableName], [self->parent deletedNodesTableName]];
+		
+		sqlite3_stmt *stmt = NULL;
+		[self prepareStatement:&stmt withString:string caller:_cmd];
+		
+		return stmt;
+	};
+	
+	BOOL needsFinalize = NO;
+	sqlite3_stmt *result = NULL;
+	
+	if (*statement == NULL)
+	{
+		result = *statement = CreateStatement();
+	}
+	else if (sqlite3_stmt_busy(*statement))
+	{
+		result = CreateStatement();
+		needsFinalize = YES;
+	}
+	else
+	{
+		result = *statement;
+	}
+	
+	NSParameterAssert(needsFinalizePtr != NULL);
+	*needsFinalizePtr = needsFinalize;
+	return result;
+}
+
 - (sqlite3_stmt *)enumerateForSrcNameStatement:(BOOL *)needsFinalizePtr
 {
 	sqlite3_stmt **statement = &enumerateForSrcNameStatement;
@@ -1022,6 +1293,96 @@
 	return result;
 }
 
+/**
+ * Breadth-first search, one level at a time, using the TEMP table of reachable nodes as the visited set.
+ *
+ * Each step inserts the next level (depth + 1) into the temp table, following edges with a given name,
+ * from source to destination. Since "rowid" is the primary key, nodes that have already been visited
+ * are ignored. So every node & edge is processed at most once, even if the graph has cycles.
+**/
+- (sqlite3_stmt *)insertReachableForSrcNameStatement
+{
+	sqlite3_stmt **statement = &insertReachableForSrcNameStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"INSERT OR IGNORE INTO \"temp\".\"%@\" (\"rowid\", \"depth\")"
+		  @" SELECT \"e\".\"dst\", \"r\".\"depth\" + 1 FROM \"temp\".\"%@\" AS \"r\""
+		  @" JOIN \"%@\" AS \"e\" ON \"e\".\"src\" = \"r\".\"rowid\""
+		  @" WHERE \"r\".\"depth\" = ? AND \"e\".\"name\" = ? AND typeof(\"e\".\"dst\") = 'integer';",
+		  [parent reachableNodesTableName], [parent reachableNodesTableName], [parent tableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+/**
+ * Same as insertReachableForSrcNameStatement, but in the opposite direction (from destination to source).
+**/
+- (sqlite3_stmt *)insertReachableForDstNameStatement
+{
+	sqlite3_stmt **statement = &insertReachableForDstNameStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"INSERT OR IGNORE INTO \"temp\".\"%@\" (\"rowid\", \"depth\")"
+		  @" SELECT \"e\".\"src\", \"r\".\"depth\" + 1 FROM \"temp\".\"%@\" AS \"r\""
+		  @" JOIN \"%@\" AS \"e\" ON \"e\".\"dst\" = \"r\".\"rowid\""
+		  @" WHERE \"r\".\"depth\" = ? AND \"e\".\"name\" = ?;",
+		  [parent reachableNodesTableName], [parent reachableNodesTableName], [parent tableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)insertReachableStartStatement
+{
+	sqlite3_stmt **statement = &insertReachableStartStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"INSERT OR IGNORE INTO \"temp\".\"%@\" (\"rowid\", \"depth\") VALUES (?, 0);",
+		  [parent reachableNodesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)enumerateReachableForDepthStatement
+{
+	sqlite3_stmt **statement = &enumerateReachableForDepthStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT \"rowid\" FROM \"temp\".\"%@\" WHERE \"depth\" = ?;",
+		  [parent reachableNodesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)removeAllReachableStatement
+{
+	sqlite3_stmt **statement = &removeAllReachableStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"DELETE FROM \"temp\".\"%@\";", [parent reachableNodesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
 - (sqlite3_stmt *)countForSrcExcludingDstStatement
 {
 	sqlite3_stmt **statement = &countForSrcExcludingDstStatement;
@@ -1052,6 +1413,38 @@
 	return *statement;
 }
 
+- (sqlite3_stmt *)countForSrcExcludingDeletedDstStatement
+{
+	sqlite3_stmt **statement = &countForSrcExcludingDeletedDstStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT COUNT(*) AS NumberOfRows FROM \"%@\""
+		  @" WHERE \"src\" = ? AND \"dst\" NOT IN (SELECT \"rowid\" FROM \"temp\".\"%@\");",
+		  [parent tableName], [parent deletedNodesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)countForDstExcludingDeletedSrcStatement
+{
+	sqlite3_stmt **statement = &countForDstExcludingDeletedSrcStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT COUNT(*) AS NumberOfRows FROM \"%@\""
+		  @" WHERE \"dst\" = ? AND \"src\" NOT IN (SELECT \"rowid\" FROM \"temp\".\"%@\");",
+		  [parent tableName], [parent deletedNodesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
 - (sqlite3_stmt *)countForSrcStatement
 {
 	sqlite3_stmt **statement = &countForSrcStatement;
@@ -97,6 +97,43 @@ typedef NSURL* _Nullable (^YapDatabaseRelationshipMigration)(NSString *_Nullable
  */
 @property (nonatomic, strong, readwrite, nullable) YapWhitelistBlacklist *allowedCollections;
 
+/**
+ * When the extension is first registered (or its table needs to be rebuilt), it enumerates the existing objects
+ * in the database, and asks each one for its yapDatabaseRelationshipEdges.
+ * For large databases, most of this time is spent deserializing objects & extracting their edges.
+ *
+ * If you set this value to 2 or more, the rows are still read (in rowid order) on the registering thread,
+ * but deserialization & edge extraction fan out across this many concurrent workers.
+ * The extracted edges are then applied in rowid order, so the end result is identical to the serial version.
+ *
+ * IMPORTANT:
+ * Only enable this if the configured deserializer(s), and the yapDatabaseRelationshipEdges method
+ * of your objects, are thread-safe.
+ *
+ * Note: This only affects the population step. Changes made after registration are processed as usual.
+ *
+ * The default value is 0 (serial).
+ */
+@property (nonatomic, assign, readwrite) NSUInteger populateConcurrency;
+
+/**
+ * You can optionally keep an in-memory adjacency graph for edges with particular names.
+ *
+ * When an edge name is included here, the first traversal that involves that name
+ * (e.g. enumerateNodesReachableFromKey:collection:withEdgeNames:...) loads every edge with that name
+ * into a compact in-memory structure (owned by the connection).
+ * From then on, multi-hop traversals over that edge name run entirely in memory,
+ * and the graph is kept in sync as edges are added, modified & removed.
+ *
+ * This is a trade-off of memory for speed.
+ * It's a good fit for edge names that form large graphs which are traversed often (e.g. "parent", "child").
+ *
+ * Note: Edges with a destinationFileURL are never part of the in-memory graph.
+ *
+ * The default value is nil (no in-memory graphs are kept).
+ */
+@property (nonatomic, copy, readwrite, nullable) NSSet<NSString *> *adjacencyCacheEdgeNames;
+
 /**
  * The relationship extension allows you to create relationships between objects in the database & files on disk.
  * This allows you to use the relationship extension to automatically delete files
@@ -22,6 +22,8 @@ static NSString *const kPlistKey_PathComponents = @"pathComponents";
 
 @synthesize disableYapDatabaseRelationshipNodeProtocol = disableYapDatabaseRelationshipNodeProtocol;
 @synthesize allowedCollections = allowedCollections;
+@synthesize populateConcurrency = populateConcurrency;
+@synthesize adjacencyCacheEdgeNames = adjacencyCacheEdgeNames;
 @synthesize fileURLSerializer = fileURLSerializer;
 @synthesize fileURLDeserializer = fileURLDeserializer;
 @synthesize migration = migration;
@@ -32,6 +34,8 @@ static NSString *const kPlistKey_PathComponents = @"pathComponents";
 	{
 		disableYapDatabaseRelationshipNodeProtocol = NO;
 		allowedCollections = nil;
+		populateConcurrency = 0;
+		adjacencyCacheEdgeNames = nil;
 		fileURLSerializer = [[self class] defaultFileURLSerializer];
 		fileURLDeserializer = [[self class] defaultFileURLDeserializer];
 		migration = [[self class] defaultMigration];
@@ -68,6 +72,8 @@ static NSString *const kPlistKey_PathComponents = @"pathComponents";
 	YapDatabaseRelationshipOptions *copy = [[YapDatabaseRelationshipOptions alloc] init];
 	copy->disableYapDatabaseRelationshipNodeProtocol = disableYapDatabaseRelationshipNodeProtocol;
 	copy->allowedCollections = allowedCollections;
+	copy->populateConcurrency = populateConcurrency;
+	copy->adjacencyCacheEdgeNames = adjacencyCacheEdgeNames;
 	copy->fileURLSerializer = fileURLSerializer;
 	copy->fileURLDeserializer = fileURLDeserializer;
 	copy->migration = migration;
@@ -3,6 +3,7 @@
 #import "YapDatabaseExtensionTransaction.h"
 #import "YapDatabaseRelationshipEdge.h"
 #import "YapDatabaseRelationshipNode.h"
+#import "YapCollectionKey.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -22,6 +23,25 @@ NS_ASSUME_NONNULL_BEGIN
  * https://github.com/yapstudios/YapDatabase/wiki/Relationships
  */
 
+/**
+ * Which way to follow edges during a traversal.
+ *
+ * - Outgoing : from an edge's source node to its destination node
+ * - Incoming : from an edge's destination node to its source node
+ */
+typedef NS_ENUM(NSInteger, YDB_TraversalDirection) {
+	YDB_TraversalDirectionOutgoing,
+	YDB_TraversalDirectionIncoming,
+};
+
+/**
+ * The order in which nodes are visited during a traversal.
+ */
+typedef NS_ENUM(NSInteger, YDB_TraversalOrder) {
+	YDB_TraversalOrderBreadthFirst,
+	YDB_TraversalOrderDepthFirst,
+};
+
 @interface YapDatabaseRelationshipTransaction : YapDatabaseExtensionTransaction
 
 #pragma mark Node Fetch
@@ -336,6 +356,140 @@ NS_ASSUME_NONNULL_BEGIN
                      collection:(nullable NSString *)sourceCollection
              destinationFileURL:(nullable NSURL *)destinationFileURL;
 
+#pragma mark Traversal
+
+/**
+ * Enumerates every node reachable from the given node, by following edges with the given name(s).
+ *
+ * Each node is reported only once (cycles are handled), and the starting node itself is not reported.
+ * Edges with a destinationFileURL are ignored.
+ *
+ * If the edge names are listed in YapDatabaseRelationshipOptions.adjacencyCacheEdgeNames,
+ * then the traversal runs against an in-memory graph, which is much faster than hopping through sqlite.
+ * Otherwise (or if the current read-write transaction has pending edge changes) it uses the regular enumeration.
+ *
+ * @param key
+ *   The key of the starting node.
+ *
+ * @param collection
+ *   The collection of the starting node.
+ *   If nil, the collection is treated as the empty string, just like the rest of the YapDatabase framework.
+ *
+ * @param edgeNames
+ *   The names of the edges to follow (case sensitive).
+ *
+ * @param direction
+ *   Outgoing follows edges from source to destination. Incoming follows edges from destination to source.
+ *
+ * @param order
+ *   Breadth-first reports each node with its shortest distance (depth) from the starting node.
+ *   Depth-first reports each node with the depth at which it was first discovered.
+ *
+ * @param maxDepth
+ *   The maximum number of hops from the starting node. Pass zero for no limit.
+ */
+- (void)enumerateNodesReachableFromKey:(NSString *)key
+                            collection:(nullable NSString *)collection
+                         withEdgeNames:(NSArray<NSString *> *)edgeNames
+                             direction:(YDB_TraversalDirection)direction
+                                 order:(YDB_TraversalOrder)order
+                              maxDepth:(NSUInteger)maxDepth
+                            usingBlock:(void (NS_NOESCAPE^)(NSString *key, NSString *collection,
+                                                            NSUInteger depth, BOOL *stop))block;
+
+/**
+ * Returns YES if there's a path from the source node to the destination node,
+ * following edges (from source to destination) with the given name(s), within maxDepth hops.
+ *
+ * Pass zero for maxDepth for no limit.
+ * A node is always considered reachable from itself.
+ */
+- (BOOL)isNodeWithKey:(NSString *)destinationKey
+           collection:(nullable NSString *)destinationCollection
+     reachableFromKey:(NSString *)sourceKey
+           collection:(nullable NSString *)sourceCollection
+        withEdgeNames:(NSArray<NSString *> *)edgeNames
+             maxDepth:(NSUInteger)maxDepth;
+
+/**
+ * Returns the number of distinct nodes reachable from the given node (not counting the node itself),
+ * following edges with the given name(s) in the given direction, within maxDepth hops.
+ *
+ * For example, with a "parent" edge pointing from child to parent:
+ * - YDB_TraversalDirectionOutgoing gives the number of ancestors
+ * - YDB_TraversalDirectionIncoming gives the number of descendants
+ *
+ * Pass zero for maxDepth for no limit.
+ */
+- (NSUInteger)reachableNodeCountFromKey:(NSString *)key
+                             collection:(nullable NSString *)collection
+                          withEdgeNames:(NSArray<NSString *> *)edgeNames
+                              direction:(YDB_TraversalDirection)direction
+                               maxDepth:(NSUInteger)maxDepth;
+
+#pragma mark Recursive Queries
+
+/**
+ * The methods below run the traversal directly against the relationship table,
+ * as a breadth-first search with one query per level (rather than one query per node).
+ * The visited nodes are kept in a temp table, so each node & edge is processed at most once.
+ *
+ * Only edges with the given name are followed, and edges with a destinationFileURL are ignored.
+ *
+ * If the edge name is listed in YapDatabaseRelationshipOptions.adjacencyCacheEdgeNames,
+ * or if the current read-write transaction has pending edge changes (which aren't yet in the table),
+ * then the regular traversal is used instead. The results are the same either way.
+ *
+ * Cycles (and multiple paths to the same node) are handled, so passing zero for maxDepth (no limit) is fine.
+ */
+
+/**
+ * Enumerates every node reachable from the given node, in breadth-first order,
+ * reporting each node once along with its shortest distance (depth) from the starting node.
+ * The starting node itself is not reported.
+ *
+ * For example, with a "parent" edge pointing from child to parent:
+ * - YDB_TraversalDirectionOutgoing enumerates all ancestors
+ * - YDB_TraversalDirectionIncoming enumerates all descendants
+ *
+ * @param key
+ *   The key of the starting node.
+ *
+ * @param collection
+ *   The collection of the starting node.
+ *   If nil, the collection is treated as the empty string, just like the rest of the YapDatabase framework.
+ *
+ * @param edgeName
+ *   The name of the edges to follow (case sensitive).
+ *
+ * @param maxDepth
+ *   The maximum number of hops from the starting node. Pass zero for no limit.
+ */
+- (void)enumerateKeysReachableFromKey:(NSString *)key
+                           collection:(nullable NSString *)collection
+                          viaEdgeName:(NSString *)edgeName
+                            direction:(YDB_TraversalDirection)direction
+                             maxDepth:(NSUInteger)maxDepth
+                           usingBlock:(void (NS_NOESCAPE^)(NSString *key, NSString *collection,
+                                                           NSUInteger depth, BOOL *stop))block;
+
+/**
+ * Returns the shortest path from the source node to the destination node,
+ * following edges (from source to destination) with the given name, within maxDepth hops.
+ *
+ * The returned array starts with the source node, and ends with the destination node.
+ * If there are multiple shortest paths, an arbitrary one is returned.
+ * Returns nil if there is no such path.
+ *
+ * Pass zero for maxDepth for no limit.
+ */
+- (nullable NSArray<YapCollectionKey *> *)shortestPathFromKey:(NSString *)sourceKey
+                                                   collection:(nullable NSString *)sourceCollection
+                                                        toKey:(NSString *)destinationKey
+                                                   collection:(nullable NSString *)destinationCollection
+                                                  viaEdgeName:(NSString *)edgeName
+                                                     maxDepth:(NSUInteger)maxDepth;
+
 @end
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1,6 +1,7 @@
 #import "YapDatabaseRelationshipTransaction.h"
 #import "YapDatabaseRelationshipPrivate.h"
 #import "YapDatabaseRelationshipEdgePrivate.h"
+#import "YapDatabaseRelationshipAdjacency.h"
 #import "YapDatabasePrivate.h"
 #import "YapCollectionKey.h"
 #import "YapDatabaseString.h"
@@ -140,9 +141,70 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 	return [iNode1 isEqual:iNode2];
 }
 
+/**
+ * Asks the given object for its protocol edges (if it implements the YapDatabaseRelationshipNode protocol),
+ * and returns a cleaned copy of each, with the source set to the given row.
+ *
+ * This function doesn't touch any transaction state, so it can be invoked concurrently during population.
+**/
+static NSArray<YapDatabaseRelationshipEdge *> *ProtocolEdgesForObject(id object, int64_t rowid,
+                                                                      NSString *collection, NSString *key)
+{
+	NSArray *givenEdges = nil;
+	
+//	if ([object conformsToProtocol:@protocol(YapDatabaseRelationshipNode)])
+	if ([object respondsToSelector:@selector(yapDatabaseRelationshipEdges)])
+	{
+		givenEdges = [object yapDatabaseRelationshipEdges];
+	}
+	
+	if ([givenEdges count] == 0) return nil;
+	
+	NSMutableArray *edges = [NSMutableArray arrayWithCapacity:[givenEdges count]];
+	
+	for (YapDatabaseRelationshipEdge *edge in givenEdges)
+	{
+		YapDatabaseRelationshipEdge *cleanEdge = [edge copyWithSourceKey:key collection:collection rowid:rowid];
+		cleanEdge->isManualEdge = NO; // Force proper value
+		
+		[edges addObject:cleanEdge];
+	}
+	
+	return edges;
+}
+
+/**
+ * The number of rows read per batch during concurrent population.
+ * One batch is processed by the workers while the next is being read.
+**/
+static const NSUInteger kPopulateBatchSize = 1024;
+
+/**
+ * A row read during concurrent population.
+ * The row is filled in by the reading thread, and the edges are filled in by a worker.
+**/
+@interface YDBRelationshipPopulateRow : NSObject {
+@public
+	int64_t rowid;
+	NSString *collection;
+	NSString *key;
+	NSData *data;
+	YapDatabaseDeserializer deserializer;
+	
+	NSArray<YapDatabaseRelationshipEdge *> *edges;
+}
+@end
+
+@implementation YDBRelationshipPopulateRow
+@end
+
+
 @implementation YapDatabaseRelationshipTransaction
 {
 	BOOL isFlushing;
+	BOOL hasDeletedNodesTable;
+	BOOL hasReachableNodesTable;
+	BOOL isEnumeratingReachableNodes;
 }
 
 - (id)initWithParentConnection:(YapDatabaseRelationshipConnection *)inParentConnection
@@ -503,31 +565,22 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 		return YES;
 	}
 	
+	if (parentConnection->parent->options->populateConcurrency > 1)
+	{
+		[self populateProtocolEdgesConcurrently];
+		
+		[self flush];
+		return YES;
+	}
+	
 	// Enumerate the existing rows in the database and populate the view
 	
 	void (^ProcessRow)(int64_t rowid, NSString *collection, NSString *key, id object);
 	ProcessRow = ^(int64_t rowid, NSString *collection, NSString *key, id object){
 		
-		NSArray *givenEdges = nil;
-		
-	//	if ([object conformsToProtocol:@protocol(YapDatabaseRelationshipNode)])
-		if ([object respondsToSelector:@selector(yapDatabaseRelationshipEdges)])
-		{
-			givenEdges = [object yapDatabaseRelationshipEdges];
-		}
-		
-		if ([givenEdges count] > 0)
+		NSArray *edges = ProtocolEdgesForObject(object, rowid, collection, key);
+		if (edges)
 		{
-			NSMutableArray *edges = [NSMutableArray arrayWithCapacity:[givenEdges count]];
-			
-			for (YapDatabaseRelationshipEdge *edge in givenEdges)
-			{
-				YapDatabaseRelationshipEdge *cleanEdge = [edge copyWithSourceKey:key collection:collection rowid:rowid];
-				cleanEdge->isManualEdge = NO; // Force proper value
-				
-				[edges addObject:cleanEdge];
-			}
-			
 			[self->parentConnection->protocolChanges setObject:edges forKey:@(rowid)];
 		}
 	};
@@ -562,6 +615,166 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 	return YES;
 }
 
+/**
+ * Concurrent version of the enumeration step within populateTable.
+ * See YapDatabaseRelationshipOptions.populateConcurrency.
+ *
+ * The serialized rows are read (in rowid order) on the current thread, in batches.
+ * Each batch is handed to the workers, which deserialize the objects and extract their protocol edges,
+ * while the next batch is being read. The extracted edges are then applied on the current thread, in rowid order.
+**/
+- (void)populateProtocolEdgesConcurrently
+{
+	YapDatabaseConnection *dbConnection = databaseTransaction->connection;
+	sqlite3 *db = dbConnection->db;
+	
+	__unsafe_unretained YapWhitelistBlacklist *allowedCollections =
+	    parentConnection->parent->options->allowedCollections;
+	
+	size_t const concurrency = (size_t)parentConnection->parent->options->populateConcurrency;
+	
+	// We don't use the objectCache here (it's not thread-safe),
+	// so we read the serialized data directly from the database table.
+	
+	sqlite3_stmt *statement = NULL;
+	
+	const char *stmt = "SELECT \"rowid\", \"collection\", \"key\", \"data\" FROM \"database2\";";
+	
+	int status = sqlite3_prepare_v2(db, stmt, (int)strlen(stmt)+1, &statement, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error creating populate statement: %d %s", status, sqlite3_errmsg(db));
+		return;
+	}
+	
+	int const column_idx_rowid      = SQLITE_COLUMN_START + 0;
+	int const column_idx_collection = SQLITE_COLUMN_START + 1;
+	int const column_idx_key        = SQLITE_COLUMN_START + 2;
+	int const column_idx_data       = SQLITE_COLUMN_START + 3;
+	
+	// Maps collection -> deserializer (or NSNull if the collection isn't allowed).
+	// Only accessed on the current thread.
+	
+	NSMutableDictionary<NSString *, id> *collectionInfo = [NSMutableDictionary dictionary];
+	
+	dispatch_queue_t workerQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+	dispatch_group_t group = dispatch_group_create();
+	
+	void (^ApplyRows)(NSArray<YDBRelationshipPopulateRow *> *) = ^(NSArray<YDBRelationshipPopulateRow *> *rows){
+		
+		for (YDBRelationshipPopulateRow *row in rows)
+		{
+			if (row->edges)
+			{
+				[self->parentConnection->protocolChanges setObject:row->edges forKey:@(row->rowid)];
+			}
+		}
+	};
+	
+	NSArray<YDBRelationshipPopulateRow *> *inFlightRows = nil;
+	
+	status = SQLITE_ROW;
+	while (status == SQLITE_ROW)
+	{
+		// Read the next batch (while the workers process the previous batch)
+		
+		NSMutableArray<YDBRelationshipPopulateRow *> *rows = [NSMutableArray arrayWithCapacity:kPopulateBatchSize];
+		
+		while (([rows count] < kPopulateBatchSize) && ((status = sqlite3_step(statement)) == SQLITE_ROW))
+		{ @autoreleasepool {
+			const unsigned char *text = sqlite3_column_text(statement, column_idx_collection);
+			int textSize = sqlite3_column_bytes(statement, column_idx_collection);
+			
+			NSString *collection =
+			  [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+			
+			id info = [collectionInfo objectForKey:collection];
+			if (info == nil)
+			{
+				if (allowedCollections && ![allowedCollections isAllowed:collection])
+					info = [NSNull null];
+				else
+					info = [dbConnection->database objectDeserializerForCollection:collection];
+				
+				[collectionInfo setObject:info forKey:collection];
+			}
+			
+			if (info == [NSNull null]) continue;
+			
+			YDBRelationshipPopulateRow *row = [[YDBRelationshipPopulateRow alloc] init];
+			row->rowid = sqlite3_column_int64(statement, column_idx_rowid);
+			row->collection = collection;
+			row->deserializer = (YapDatabaseDeserializer)info;
+			
+			text = sqlite3_column_text(statement, column_idx_key);
+			textSize = sqlite3_column_bytes(statement, column_idx_key);
+			
+			row->key = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+			
+			// The data must be copied, as the blob is only valid until the next sqlite3_step.
+			
+			const void *blob = sqlite3_column_blob(statement, column_idx_data);
+			int blobSize = sqlite3_column_bytes(statement, column_idx_data);
+			
+			row->data = [NSData dataWithBytes:blob length:blobSize];
+			
+			[rows addObject:row];
+		}}
+		
+		// Wait for the previous batch, and apply its edges (in rowid order)
+		
+		if (inFlightRows)
+		{
+			dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+			ApplyRows(inFlightRows);
+			
+			inFlightRows = nil;
+		}
+		
+		// Hand the new batch to the workers
+		
+		if ([rows count] > 0)
+		{
+			inFlightRows = [rows copy];
+			NSArray<YDBRelationshipPopulateRow *> *workerRows = inFlightRows;
+			
+			dispatch_group_async(group, workerQueue, ^{
+				
+				NSUInteger count = [workerRows count];
+				
+				dispatch_apply(concurrency, workerQueue, ^(size_t worker) {
+					
+					NSUInteger start = (NSUInteger)((count * worker) / concurrency);
+					NSUInteger end   = (NSUInteger)((count * (worker + 1)) / concurrency);
+					
+					for (NSUInteger i = start; i < end; i++)
+					{ @autoreleasepool {
+						YDBRelationshipPopulateRow *row = workerRows[i];
+						
+						id object = row->deserializer(row->collection, row->key, row->data);
+						
+						row->edges = ProtocolEdgesForObject(object, row->rowid, row->collection, row->key);
+						row->data = nil;
+					}}
+				});
+			});
+		}
+	}
+	
+	if (inFlightRows)
+	{
+		dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+		ApplyRows(inFlightRows);
+	}
+	
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error enumerating rows during populate: %d %s", status, sqlite3_errmsg(db));
+	}
+	
+	sqlite3_finalize(statement);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Accessors
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1986,70 +2199,109 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 }
 
 /**
- * Queries the database for the number of edges matching the given source.
- * This method only queries the database, and doesn't inspect anything in memory.
+ * Creates the TEMP table that holds the rowids of deleted nodes during flush processing (if needed).
+ *
+ * Temp tables are private to the sqlite connection, and are only created on demand.
+ * Since the CREATE is part of the transaction, a rollback also drops the table,
+ * which is why this is tracked per transaction.
 **/
-- (int64_t)edgeCountWithSource:(int64_t)srcRowid
-          excludingDestination:(int64_t)dstRowid
+- (BOOL)createDeletedNodesTableIfNeeded
 {
-	sqlite3_stmt *statement = [parentConnection countForSrcExcludingDstStatement];
-	if (statement == NULL) return 0;
+	if (hasDeletedNodesTable) return YES;
 	
-	int64_t count = 0;
+	sqlite3 *db = databaseTransaction->connection->db;
 	
-	// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "src" = ? AND "dst" != ?;
+	NSString *createTable = [NSString stringWithFormat:
+	  @"CREATE TEMP TABLE IF NOT EXISTS \"%@\" (\"rowid\" INTEGER PRIMARY KEY);",
+	  [parentConnection->parent deletedNodesTableName]];
 	
-	int const column_idx_count = SQLITE_COLUMN_START;
-	int const bind_idx_src     = SQLITE_BIND_START + 0;
-	int const bind_idx_dst     = SQLITE_BIND_START + 1;
+	int status = sqlite3_exec(db, [createTable UTF8String], NULL, NULL, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Failed creating temp table (%@): %d %s",
+		            [parentConnection->parent deletedNodesTableName], status, sqlite3_errmsg(db));
+		return NO;
+	}
 	
-	sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
-	sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
+	hasDeletedNodesTable = YES;
+	return YES;
+}
+
+/**
+ * Creates the TEMP table used as the visited set by the recursive queries (if needed).
+ *
+ * Like the table of deleted nodes, this is tracked per transaction (a rollback also drops the table).
+**/
+- (BOOL)createReachableNodesTableIfNeeded
+{
+	if (hasReachableNodesTable) return YES;
 	
-	int status = sqlite3_step(statement);
-	if (status == SQLITE_ROW)
+	sqlite3 *db = databaseTransaction->connection->db;
+	
+	NSString *tableName = [parentConnection->parent reachableNodesTableName];
+	
+	NSString *createTable = [NSString stringWithFormat:
+	  @"CREATE TEMP TABLE IF NOT EXISTS \"%@\" (\"rowid\" INTEGER PRIMARY KEY, \"depth\" INTEGER NOT NULL);",
+	  tableName];
+	
+	NSString *createIndex = [NSString stringWithFormat:
+	  @"CREATE INDEX IF NOT EXISTS \"temp\".\"%@_depth\" ON \"%@\" (\"depth\");",
+	  tableName, tableName];
+	
+	int status = sqlite3_exec(db, [createTable UTF8String], NULL, NULL, NULL);
+	if (status != SQLITE_OK)
 	{
-		count = sqlite3_column_int64(statement, column_idx_count);
+		YDBLogError(@"Failed creating temp table (%@): %d %s", tableName, status, sqlite3_errmsg(db));
+		return NO;
 	}
-	else if (status == SQLITE_ERROR)
+	
+	status = sqlite3_exec(db, [createIndex UTF8String], NULL, NULL, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Failed creating index on temp table (%@): %d %s", tableName, status, sqlite3_errmsg(db));
+		return NO;
+	}
+	
+	hasReachableNodesTable = YES;
+	return YES;
+}
+
+/**
+ * Clears the temp table used as the visited set by the recursive queries.
+**/
+- (void)removeAllReachableNodes
+{
+	sqlite3_stmt *statement = [parentConnection removeAllReachableStatement];
+	if (statement == NULL) return;
+	
+	// DELETE FROM "temp"."reachableNodesTableName";
+	
+	int status = sqlite3_step(statement);
+	if (status != SQLITE_DONE)
 	{
 		YDBLogError(@"Error executing statement: %d %s",
 		            status, sqlite3_errmsg(databaseTransaction->connection->db));
 	}
 	
-	sqlite3_clear_bindings(statement);
 	sqlite3_reset(statement);
-	
-	return count;
 }
 
 /**
- * Queries the database for the number of edges matching the given destination.
- * This method only queries the database, and doesn't inspect anything in memory.
+ * Adds the given node rowid to the temp table of deleted nodes.
 **/
-- (int64_t)edgeCountWithDestination:(int64_t)dstRowid
-                    excludingSource:(int64_t)srcRowid
+- (void)insertDeletedNode:(int64_t)rowid
 {
-	sqlite3_stmt *statement = [parentConnection countForDstExcludingSrcStatement];
-	if (statement == NULL) return 0;
-	
-	int64_t count = 0;
+	sqlite3_stmt *statement = [parentConnection insertDeletedNodeStatement];
+	if (statement == NULL) return;
 	
-	// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "dst" = ? AND "src" != ?;
+	// INSERT OR IGNORE INTO "temp"."deletedNodesTableName" ("rowid") VALUES (?);
 	
-	int const column_idx_count = SQLITE_COLUMN_START;
-	int const bind_idx_dst     = SQLITE_BIND_START + 0;
-	int const bind_idx_src     = SQLITE_BIND_START + 1;
+	int const bind_idx_rowid = SQLITE_BIND_START;
 	
-	sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
-	sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
+	sqlite3_bind_int64(statement, bind_idx_rowid, rowid);
 	
 	int status = sqlite3_step(statement);
-	if (status == SQLITE_ROW)
-	{
-		count = sqlite3_column_int64(statement, column_idx_count);
-	}
-	else if (status == SQLITE_ERROR)
+	if (status != SQLITE_DONE)
 	{
 		YDBLogError(@"Error executing statement: %d %s",
 		            status, sqlite3_errmsg(databaseTransaction->connection->db));
@@ -2057,29 +2309,35 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 	
 	sqlite3_clear_bindings(statement);
 	sqlite3_reset(statement);
-	
-	return count;
 }
 
 /**
- * Queries the database for the number of edges matching the given destination and name.
- * This method only queries the database, and doesn't inspect anything in memory.
+ * Enumerates every edge (with nodeDeleteRules) where the source or destination is in the temp table of deleted nodes.
+ * Edges without any nodeDeleteRules don't require processing, and so aren't fetched.
+ *
+ * Simple enumeration of existing data in database, via a SELECT query.
+ * Does not take into account anything in memory (parentConnection->changes dictionary).
 **/
-- (int64_t)edgeCountWithDestinationFileURL:(NSURL *)dstFileURL
-                           excludingSource:(int64_t)exclSrcRowid
+- (void)enumerateExistingEdgesWithDeletedNodeAsSource:(BOOL)deletedNodeIsSource
+                                           usingBlock:(void (NS_NOESCAPE^)(YapDatabaseRelationshipEdge *edge))block
 {
-	NSAssert(dstFileURL != nil, @"Internal logic error");
-	
 	BOOL needsFinalize;
-	sqlite3_stmt *statement = [parentConnection enumerateDstFileURLExcludingSrcStatement:&needsFinalize];
-	if (statement == NULL) return 0;
+	sqlite3_stmt *statement;
 	
-	int64_t count = 0;
+	if (deletedNodeIsSource)
+		statement = [parentConnection enumerateForDeletedSrcStatement:&needsFinalize];
+	else
+		statement = [parentConnection enumerateForDeletedDstStatement:&needsFinalize];
+	
+	if (statement == NULL) return;
 	
 	// SELECT "rowid", "name", "src", "dst", "rules", "manual" FROM "tableName"
-	//  WHERE "dst" > INT64_MAX AND "src" != ?;
+	//  WHERE "src" IN (SELECT "rowid" FROM "temp"."deletedNodesTableName") AND "rules" != 0;
 	//
-	// AKA: typeof(dst) IS BLOB
+	// -OR-
+	//
+	// SELECT "rowid", "name", "src", "dst", "rules", "manual" FROM "tableName"
+	//  WHERE "dst" IN (SELECT "rowid" FROM "temp"."deletedNodesTableName") AND "rules" != 0;
 	
 	int const column_idx_rowid  = SQLITE_COLUMN_START + 0;
 	int const column_idx_name   = SQLITE_COLUMN_START + 1;
@@ -2088,25 +2346,26 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 	int const column_idx_rules  = SQLITE_COLUMN_START + 4;
 	int const column_idx_manual = SQLITE_COLUMN_START + 5;
 	
-	int const bind_idx_src = SQLITE_BIND_START + 0;
-
-	sqlite3_bind_int64(statement, bind_idx_src, exclSrcRowid);
-	
 	int status;
 	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
 	{
 		int64_t edgeRowid = sqlite3_column_int64(statement, column_idx_rowid);
+		int64_t srcRowid = sqlite3_column_int64(statement, column_idx_src);
 		
 		YapDatabaseRelationshipEdge *edge = [parentConnection->edgeCache objectForKey:@(edgeRowid)];
 		if (edge)
 		{
-			edge->sourceRowid = sqlite3_column_int64(statement, column_idx_src);
+			edge->sourceRowid = srcRowid;
 			edge->state |= YDB_EdgeState_HasSourceRowid;
+			
+			if (sqlite3_column_type(statement, column_idx_dst) == SQLITE_INTEGER)
+			{
+				edge->destinationRowid = sqlite3_column_int64(statement, column_idx_dst);
+				edge->state |= YDB_EdgeState_HasDestinationRowid;
+			}
 		}
 		else
 		{
-			int64_t srcRowid = sqlite3_column_int64(statement, column_idx_src);
-			
 			const unsigned char *text = sqlite3_column_text(statement, column_idx_name);
 			int textSize = sqlite3_column_bytes(statement, column_idx_name);
 			
@@ -2130,7 +2389,7 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 			
 			int rules = sqlite3_column_int(statement, column_idx_rules);
 			BOOL manual = (BOOL)sqlite3_column_int(statement, column_idx_manual);
-		
+			
 			edge = [[YapDatabaseRelationshipEdge alloc] initWithEdgeRowid:edgeRowid
 			                                                         name:name
 			                                                     srcRowid:srcRowid
@@ -2142,12 +2401,7 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 			[parentConnection->edgeCache setObject:edge forKey:@(edgeRowid)];
 		}
 		
-		[self lookupEdgeDestinationFileURL:edge];
-		
-		if (URLMatchesURL(dstFileURL, edge->destinationFileURL))
-		{
-			count++;
-		}
+		block(edge);
 	}
 	
 	if (status != SQLITE_DONE)
@@ -2156,16 +2410,309 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 		            status, sqlite3_errmsg(databaseTransaction->connection->db));
 	}
 	
-	sqlite3_reset(statement);
-	
-	return count;
+	sqlite_enum_reset(statement, needsFinalize);
 }
 
-- (YapDatabaseRelationshipEdge *)findExistingManualEdgeMatching:(YapDatabaseRelationshipEdge *)inEdge
+/**
+ * Queries the database for the number of edges with the given name.
+ * This method only queries the database, and doesn't inspect anything in memory.
+**/
+- (int64_t)existingEdgeCountWithName:(NSString *)name
 {
-	// Lookup the sourceRowid and destinationRowid for the given edge (if missing).
-	//
-	// Note: Zero is a valid rowid.
+	sqlite3_stmt *statement = [parentConnection countForNameStatement];
+	if (statement == NULL) return 0;
+	
+	int64_t count = 0;
+	
+	// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "name" = ?;
+	
+	int const column_idx_count = SQLITE_COLUMN_START;
+	int const bind_idx_name    = SQLITE_BIND_START;
+	
+	YapDatabaseString _name; MakeYapDatabaseString(&_name, name);
+	sqlite3_bind_text(statement, bind_idx_name, _name.str, _name.length, SQLITE_STATIC);
+	
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		count = sqlite3_column_int64(statement, column_idx_count);
+	}
+	else if (status == SQLITE_ERROR)
+	{
+		YDBLogError(@"Error executing statement: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	FreeYapDatabaseString(&_name);
+	
+	return count;
+}
+
+/**
+ * Queries the database for the number of edges matching the given source.
+ * This method only queries the database, and doesn't inspect anything in memory.
+**/
+- (int64_t)edgeCountWithSource:(int64_t)srcRowid
+          excludingDestination:(int64_t)dstRowid
+{
+	sqlite3_stmt *statement = [parentConnection countForSrcExcludingDstStatement];
+	if (statement == NULL) return 0;
+	
+	int64_t count = 0;
+	
+	// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "src" = ? AND "dst" != ?;
+	
+	int const column_idx_count = SQLITE_COLUMN_START;
+	int const bind_idx_src     = SQLITE_BIND_START + 0;
+	int const bind_idx_dst     = SQLITE_BIND_START + 1;
+	
+	sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
+	sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
+	
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		count = sqlite3_column_int64(statement, column_idx_count);
+	}
+	else if (status == SQLITE_ERROR)
+	{
+		YDBLogError(@"Error executing statement: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	return count;
+}
+
+/**
+ * Queries the database for the number of edges matching the given destination.
+ * This method only queries the database, and doesn't inspect anything in memory.
+**/
+- (int64_t)edgeCountWithDestination:(int64_t)dstRowid
+                    excludingSource:(int64_t)srcRowid
+{
+	sqlite3_stmt *statement = [parentConnection countForDstExcludingSrcStatement];
+	if (statement == NULL) return 0;
+	
+	int64_t count = 0;
+	
+	// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "dst" = ? AND "src" != ?;
+	
+	int const column_idx_count = SQLITE_COLUMN_START;
+	int const bind_idx_dst     = SQLITE_BIND_START + 0;
+	int const bind_idx_src     = SQLITE_BIND_START + 1;
+	
+	sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
+	sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
+	
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		count = sqlite3_column_int64(statement, column_idx_count);
+	}
+	else if (status == SQLITE_ERROR)
+	{
+		YDBLogError(@"Error executing statement: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	return count;
+}
+
+/**
+ * Queries the database for the number of edges matching the given source,
+ * excluding those whose destination is in the temp table of deleted nodes.
+ * This method only queries the database, and doesn't inspect anything in memory.
+**/
+- (int64_t)edgeCountWithSourceExcludingDeletedDestinations:(int64_t)srcRowid
+{
+	sqlite3_stmt *statement = [parentConnection countForSrcExcludingDeletedDstStatement];
+	if (statement == NULL) return 0;
+	
+	int64_t count = 0;
+	
+	// SELECT COUNT(*) AS NumberOfRows FROM "tableName"
+	//  WHERE "src" = ? AND "dst" NOT IN (SELECT "rowid" FROM "temp"."deletedNodesTableName");
+	
+	int const column_idx_count = SQLITE_COLUMN_START;
+	int const bind_idx_src     = SQLITE_BIND_START;
+	
+	sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
+	
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		count = sqlite3_column_int64(statement, column_idx_count);
+	}
+	else if (status == SQLITE_ERROR)
+	{
+		YDBLogError(@"Error executing statement: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	return count;
+}
+
+/**
+ * Queries the database for the number of edges matching the given destination,
+ * excluding those whose source is in the temp table of deleted nodes.
+ * This method only queries the database, and doesn't inspect anything in memory.
+**/
+- (int64_t)edgeCountWithDestinationExcludingDeletedSources:(int64_t)dstRowid
+{
+	sqlite3_stmt *statement = [parentConnection countForDstExcludingDeletedSrcStatement];
+	if (statement == NULL) return 0;
+	
+	int64_t count = 0;
+	
+	// SELECT COUNT(*) AS NumberOfRows FROM "tableName"
+	//  WHERE "dst" = ? AND "src" NOT IN (SELECT "rowid" FROM "temp"."deletedNodesTableName");
+	
+	int const column_idx_count = SQLITE_COLUMN_START;
+	int const bind_idx_dst     = SQLITE_BIND_START;
+	
+	sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
+	
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		count = sqlite3_column_int64(statement, column_idx_count);
+	}
+	else if (status == SQLITE_ERROR)
+	{
+		YDBLogError(@"Error executing statement: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	return count;
+}
+
+/**
+ * Queries the database for the number of edges matching the given destination and name.
+ * This method only queries the database, and doesn't inspect anything in memory.
+ *
+ * Edges whose source node has been deleted (within this transaction) are not counted,
+ * as they're going to be removed during flush processing.
+**/
+- (int64_t)edgeCountWithDestinationFileURL:(NSURL *)dstFileURL
+                           excludingSource:(int64_t)exclSrcRowid
+{
+	NSAssert(dstFileURL != nil, @"Internal logic error");
+	
+	BOOL needsFinalize;
+	sqlite3_stmt *statement = [parentConnection enumerateDstFileURLExcludingSrcStatement:&needsFinalize];
+	if (statement == NULL) return 0;
+	
+	int64_t count = 0;
+	
+	// SELECT "rowid", "name", "src", "dst", "rules", "manual" FROM "tableName"
+	//  WHERE "dst" > INT64_MAX AND "src" != ?;
+	//
+	// AKA: typeof(dst) IS BLOB
+	
+	int const column_idx_rowid  = SQLITE_COLUMN_START + 0;
+	int const column_idx_name   = SQLITE_COLUMN_START + 1;
+	int const column_idx_src    = SQLITE_COLUMN_START + 2;
+	int const column_idx_dst    = SQLITE_COLUMN_START + 3;
+	int const column_idx_rules  = SQLITE_COLUMN_START + 4;
+	int const column_idx_manual = SQLITE_COLUMN_START + 5;
+	
+	int const bind_idx_src = SQLITE_BIND_START + 0;
+
+	sqlite3_bind_int64(statement, bind_idx_src, exclSrcRowid);
+	
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		int64_t edgeRowid = sqlite3_column_int64(statement, column_idx_rowid);
+		
+		YapDatabaseRelationshipEdge *edge = [parentConnection->edgeCache objectForKey:@(edgeRowid)];
+		if (edge)
+		{
+			edge->sourceRowid = sqlite3_column_int64(statement, column_idx_src);
+			edge->state |= YDB_EdgeState_HasSourceRowid;
+		}
+		else
+		{
+			int64_t srcRowid = sqlite3_column_int64(statement, column_idx_src);
+			
+			const unsigned char *text = sqlite3_column_text(statement, column_idx_name);
+			int textSize = sqlite3_column_bytes(statement, column_idx_name);
+			
+			NSString *name = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+			
+			int64_t dstRowid = 0;
+			NSData *dstFileURLData = nil;
+			
+			int column_type = sqlite3_column_type(statement, column_idx_dst);
+			if (column_type == SQLITE_INTEGER)
+			{
+				dstRowid = sqlite3_column_int64(statement, column_idx_dst);
+			}
+			else if (column_type == SQLITE_BLOB)
+			{
+				const void *blob = sqlite3_column_blob(statement, column_idx_dst);
+				int blobSize = sqlite3_column_bytes(statement, column_idx_dst);
+				
+				dstFileURLData = [NSData dataWithBytes:(void *)blob length:blobSize];
+			}
+			
+			int rules = sqlite3_column_int(statement, column_idx_rules);
+			BOOL manual = (BOOL)sqlite3_column_int(statement, column_idx_manual);
+		
+			edge = [[YapDatabaseRelationshipEdge alloc] initWithEdgeRowid:edgeRowid
+			                                                         name:name
+			                                                     srcRowid:srcRowid
+			                                                     dstRowid:dstRowid
+			                                                      dstData:dstFileURLData
+			                                                        rules:rules
+			                                                       manual:manual];
+			
+			[parentConnection->edgeCache setObject:edge forKey:@(edgeRowid)];
+		}
+		
+		if ([parentConnection->deletedInfo ydb_containsKey:@(edge->sourceRowid)])
+		{
+			continue;
+		}
+		
+		[self lookupEdgeDestinationFileURL:edge];
+		
+		if (URLMatchesURL(dstFileURL, edge->destinationFileURL))
+		{
+			count++;
+		}
+	}
+	
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing statement: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_reset(statement);
+	
+	return count;
+}
+
+- (YapDatabaseRelationshipEdge *)findExistingManualEdgeMatching:(YapDatabaseRelationshipEdge *)inEdge
+{
+	// Lookup the sourceRowid and destinationRowid for the given edge (if missing).
+	//
+	// Note: Zero is a valid rowid.
 	// So we use flags to properly handle this edge case.
 	
 	BOOL missingSrc = NO;
@@ -2736,6 +3283,14 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 		edge->flags = 0;
 		
 		[parentConnection->edgeCache setObject:edge forKey:@(edge->edgeRowid)];
+		
+		// Inserted edges only need to be tracked (in the changeset) if they may be part of an in-memory graph.
+		
+		if (!(edge->state & YDB_EdgeState_DestinationFileURL) &&
+		    [parentConnection->parent->options->adjacencyCacheEdgeNames containsObject:edge->name])
+		{
+			[parentConnection->insertedEdges setObject:[edge copy] forKey:@(edge->edgeRowid)];
+		}
 	}
 	else
 	{
@@ -2810,6 +3365,7 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 		
 		[parentConnection->deletedEdges addObject:@(edge->edgeRowid)];
 		[parentConnection->modifiedEdges removeObjectForKey:@(edge->edgeRowid)];
+		[parentConnection->insertedEdges removeObjectForKey:@(edge->edgeRowid)];
 	}
 	else
 	{
@@ -2822,7 +3378,10 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 }
 
 /**
- * Helper method for executing the sqlite statement to delete all edges touching the given rowid.
+ * Helper method for executing the sqlite statements to delete all edges touching the given node.
+ *
+ * This is the per-node version of deleteEdgesWithDeletedNodes,
+ * used if the temp table of deleted nodes isn't available.
 **/
 - (void)deleteEdgesWithSourceOrDestination:(int64_t)rowid
 {
@@ -2845,9 +3404,77 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 		int status;
 		while ((status = sqlite3_step(statement)) == SQLITE_ROW)
 		{
-			int64_t edgeRowid = sqlite3_column_int64(statement, column_idx_rowid);
+			NSNumber *edgeRowid = @(sqlite3_column_int64(statement, column_idx_rowid));
+			
+			[parentConnection->edgeCache removeObjectForKey:edgeRowid];
+			
+			[parentConnection->deletedEdges addObject:edgeRowid];
+			[parentConnection->insertedEdges removeObjectForKey:edgeRowid];
+		}
+		
+		if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"sqlite_step error: %d %s",
+			            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		}
+		
+		sqlite3_clear_bindings(statement);
+		sqlite3_reset(statement);
+	}
+	
+	// Step 2:
+	// Then actually go ahead and delete the edges
+	{
+		sqlite3_stmt *statement = [parentConnection deleteEdgesWithNodeStatement];
+		if (statement == NULL) return;
+		
+		// DELETE FROM "tableName" WHERE "src" = ? OR "dst" = ?;
+		
+		int const bind_idx_src = SQLITE_BIND_START + 0;
+		int const bind_idx_dst = SQLITE_BIND_START + 1;
+		
+		sqlite3_bind_int64(statement, bind_idx_src, rowid);
+		sqlite3_bind_int64(statement, bind_idx_dst, rowid);
+		
+		int status = sqlite3_step(statement);
+		if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"Error executing statement: %d %s",
+			            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		}
+		
+		sqlite3_clear_bindings(statement);
+		sqlite3_reset(statement);
+	}
+}
+
+/**
+ * Helper method for executing the sqlite statements to delete all edges touching any node
+ * in the temp table of deleted nodes. Afterwards the temp table is cleared.
+**/
+- (void)deleteEdgesWithDeletedNodes
+{
+	// Step 1:
+	// First record the edges that are getting deleted
+	{
+		sqlite3_stmt *statement = [parentConnection findEdgesWithDeletedNodeStatement];
+		if (statement == NULL) return;
+		
+		// SELECT "rowid" FROM "tableName" WHERE "src" IN (SELECT "rowid" FROM "temp"."deletedNodesTableName")
+		//  UNION ALL
+		// SELECT "rowid" FROM "tableName" WHERE "dst" IN (SELECT "rowid" FROM "temp"."deletedNodesTableName");
+		
+		int const column_idx_rowid = SQLITE_COLUMN_START;
+		
+		int status;
+		while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+		{
+			NSNumber *edgeRowid = @(sqlite3_column_int64(statement, column_idx_rowid));
+			
+			[parentConnection->edgeCache removeObjectForKey:edgeRowid];
 			
-			[parentConnection->deletedEdges addObject:@(edgeRowid)];
+			[parentConnection->deletedEdges addObject:edgeRowid];
+			[parentConnection->insertedEdges removeObjectForKey:edgeRowid];
 		}
 		
 		if (status != SQLITE_DONE)
@@ -2856,32 +3483,49 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 			            status, sqlite3_errmsg(databaseTransaction->connection->db));
 		}
 		
-		sqlite3_clear_bindings(statement);
 		sqlite3_reset(statement);
 	}
 	
 	// Step 2:
-	// Then actually go ahead and delete the edges
+	// Then actually go ahead and delete the edges.
+	// This is done with 2 separate statements (one for each column) so that each can use its index.
+	
+	sqlite3_stmt *srcStatement = [parentConnection deleteEdgesWithDeletedSrcStatement];
+	sqlite3_stmt *dstStatement = [parentConnection deleteEdgesWithDeletedDstStatement];
+	
+	for (int i = 0; i < 2; i++)
 	{
-		sqlite3_stmt *statement = [parentConnection deleteEdgesWithNodeStatement];
-		if (statement == NULL) return;
+		sqlite3_stmt *statement = (i == 0) ? srcStatement : dstStatement;
+		if (statement == NULL) continue;
 		
-		// DELETE FROM "tableName" WHERE "src" = ? OR "dst" = ?;
+		// DELETE FROM "tableName" WHERE "src" IN (SELECT "rowid" FROM "temp"."deletedNodesTableName");
+		// DELETE FROM "tableName" WHERE "dst" IN (SELECT "rowid" FROM "temp"."deletedNodesTableName");
 		
-		int const bind_idx_src = SQLITE_BIND_START + 0;
-		int const bind_idx_dst = SQLITE_BIND_START + 1;
+		int status = sqlite3_step(statement);
+		if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"Error executing statement: %d %s",
+			            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		}
 		
-		sqlite3_bind_int64(statement, bind_idx_src, rowid);
-		sqlite3_bind_int64(statement, bind_idx_dst, rowid);
+		sqlite3_reset(statement);
+	}
+	
+	// Step 3:
+	// Clear the temp table
+	{
+		sqlite3_stmt *statement = [parentConnection removeAllDeletedNodesStatement];
+		if (statement == NULL) return;
+		
+		// DELETE FROM "temp"."deletedNodesTableName";
 		
 		int status = sqlite3_step(statement);
 		if (status != SQLITE_DONE)
 		{
 			YDBLogError(@"Error executing statement: %d %s",
-						status, sqlite3_errmsg(databaseTransaction->connection->db));
+			            status, sqlite3_errmsg(databaseTransaction->connection->db));
 		}
 		
-		sqlite3_clear_bindings(statement);
 		sqlite3_reset(statement);
 	}
 }
@@ -3040,6 +3684,7 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 	
 	[parentConnection->modifiedEdges removeAllObjects];
 	[parentConnection->deletedEdges removeAllObjects];
+	[parentConnection->insertedEdges removeAllObjects];
 	
 	parentConnection->reset = YES;
 }
@@ -3527,335 +4172,403 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 	// STEP 4:
 	//
 	// Process all the deleted nodes.
-	// For each deleted node we're going to enumerate all connected edges.
+	//
+	// The deleted nodes are processed in passes (set-based, rather than one node at a time).
+	// For each pass, the pending deleted rowids are copied into a TEMP table,
+	// and then we enumerate all connected edges (that have nodeDeleteRules) with a single query per direction.
 	// First the edges where the deleted node is the source.
 	// Then the edges where the deleted node is the destination.
+	// Finally all edges touching the deleted nodes are removed with a single DELETE per direction.
+	//
+	// Any nodes deleted during a pass (due to cascading delete rules) get appended to deletedOrder,
+	// and are processed in the next pass. So the number of passes is bounded by the depth of the cascade,
+	// not by the number of deleted nodes.
+	//
+	// If the TEMP table can't be created, we fallback to processing one deleted node per pass,
+	// using the per-node queries.
 	//
 	// Note that at this point, the database is up-to-date (we've written all changes).
 	// So we can simply enumerate and query the database without any fuss.
 	
-	NSUInteger i = 0;
-	while (i < [parentConnection->deletedOrder count])
+	BOOL useDeletedNodesTable = YES;
+	
+	NSUInteger passStart = 0;
+	while (passStart < [parentConnection->deletedOrder count])
 	{
-		NSNumber *deletedRowidNumber = [parentConnection->deletedOrder objectAtIndex:i];
-		int64_t deletedRowid = deletedRowidNumber.longLongValue;
+		if (useDeletedNodesTable && ![self createDeletedNodesTableIfNeeded])
+		{
+			// We can't skip the deleted nodes, as that would leave behind edges pointing to them.
+			// So fallback to processing the deleted nodes one at a time (one pass per node).
+			
+			YDBLogWarn(@"Falling back to per-node processing of deleted nodes");
+			useDeletedNodesTable = NO;
+		}
+		
+		NSUInteger passEnd;
+		if (useDeletedNodesTable)
+		{
+			passEnd = [parentConnection->deletedOrder count];
+			
+			for (NSUInteger i = passStart; i < passEnd; i++)
+			{
+				NSNumber *deletedRowidNumber = [parentConnection->deletedOrder objectAtIndex:i];
+				[self insertDeletedNode:deletedRowidNumber.longLongValue];
+			}
+		}
+		else
+		{
+			passEnd = passStart + 1;
+		}
 		
-		YapCollectionKey *deletedCollectionKey = [parentConnection->deletedInfo objectForKey:deletedRowidNumber];
+		// Within a pass, the same node may be checked multiple times for the "All" rules.
+		// The answer can't change during the pass (newly deleted nodes aren't in the temp table until the next pass),
+		// so we only query once.
 		
-		{ // Enumerate all edges where source node is the deleted node
-	
-			int64_t srcRowid = deletedRowid;
-			YapCollectionKey *src = deletedCollectionKey;
+		NSMutableDictionary *dstCounts = [NSMutableDictionary dictionary];
+		NSMutableDictionary *srcCounts = [NSMutableDictionary dictionary];
+		
+		// Processing for an edge where the source node is a deleted node
+		
+		void (^processEdgeWithDeletedSource)(YapDatabaseRelationshipEdge *) = ^(YapDatabaseRelationshipEdge *edge) {
+		#pragma clang diagnostic push
+		#pragma clang diagnostic ignored "-Wimplicit-retain-self"
 			
-			[self enumerateExistingEdgesWithSource:srcRowid usingBlock:^(YapDatabaseRelationshipEdge *edge) {
-			#pragma clang diagnostic push
-			#pragma clang diagnostic ignored "-Wimplicit-retain-self"
-				
-				// Reminder:
-				//
-				// When using the enumerateExistingEdges...:: method,
-				// the 'edges' parameter is only guaranteed to contain the information that's in the database row.
-				//
-				// To be more specific, they'll have the rowid's but the following values may be nil:
-				// - sourceKey/sourceCollection
-				// - destinationKey/destinationCollection
-				// - destinationFileURL
-				
-				if (edge->state & YDB_EdgeState_DestinationFileURL)
+			int64_t srcRowid = edge->sourceRowid;
+			YapCollectionKey *src = [parentConnection->deletedInfo objectForKey:@(srcRowid)];
+			
+			// Reminder:
+			//
+			// When using the enumerateExistingEdges...:: method,
+			// the 'edges' parameter is only guaranteed to contain the information that's in the database row.
+			//
+			// To be more specific, they'll have the rowid's but the following values may be nil:
+			// - sourceKey/sourceCollection
+			// - destinationKey/destinationCollection
+			// - destinationFileURL
+			
+			if (edge->state & YDB_EdgeState_DestinationFileURL)
+			{
+				if (edge->nodeDeleteRules & YDB_DeleteDestinationIfAllSourcesDeleted)
 				{
-					if (edge->nodeDeleteRules & YDB_DeleteDestinationIfAllSourcesDeleted)
+					// Delete the destination file IF there are no other edges pointing to it
+					
+					if (!(edge->state & YDB_EdgeState_HasDestinationFileURL))
 					{
-						// Delete the destination file IF there are no other edges pointing to it
-						
-						if (!(edge->state & YDB_EdgeState_HasDestinationFileURL))
-						{
-							[self lookupEdgeDestinationFileURL:edge];
-						}
-						
-						if (edge->destinationFileURL)
-						{
-							int64_t count = [self edgeCountWithDestinationFileURL:edge->destinationFileURL
-							                                      excludingSource:srcRowid];
-							if (count == 0)
-							{
-								// Mark the file for deletion
-								
-								[parentConnection->filesToDelete addObject:edge->destinationFileURL];
-							}
-						}
+						[self lookupEdgeDestinationFileURL:edge];
 					}
-					else if (edge->nodeDeleteRules & YDB_DeleteDestinationIfSourceDeleted)
+					
+					if (edge->destinationFileURL)
 					{
-						// Mark the file for deletion
-						
-						if (!(edge->state & YDB_EdgeState_HasDestinationFileURL))
+						int64_t count = [self edgeCountWithDestinationFileURL:edge->destinationFileURL
+						                                      excludingSource:srcRowid];
+						if (count == 0)
 						{
-							[self lookupEdgeDestinationFileURL:edge];
-						}
-						
-						if (edge->destinationFileURL) {
+							// Mark the file for deletion
+							
 							[parentConnection->filesToDelete addObject:edge->destinationFileURL];
 						}
 					}
 				}
-				else // if (!(edge->state & YDB_EdgeState_DestinationFileURL))
+				else if (edge->nodeDeleteRules & YDB_DeleteDestinationIfSourceDeleted)
 				{
-					if ([parentConnection->deletedInfo ydb_containsKey:@(edge->destinationRowid)])
+					// Mark the file for deletion
+					
+					if (!(edge->state & YDB_EdgeState_HasDestinationFileURL))
 					{
-						// Both source and destination node have been deleted
+						[self lookupEdgeDestinationFileURL:edge];
 					}
-					else
-					{
-						BOOL shouldDeleteDestination = NO;
-						
-						if (edge->nodeDeleteRules & YDB_DeleteDestinationIfAllSourcesDeleted)
-						{
-							// Delete the destination node IF there are no other edges pointing to it
-							
-							int64_t count = [self edgeCountWithDestination:edge->destinationRowid
-                                                           excludingSource:srcRowid];
-							if (count == 0)
-							{
-								shouldDeleteDestination = YES;
-							}
-						}
-						else if (edge->nodeDeleteRules & YDB_DeleteDestinationIfSourceDeleted)
-						{
-							shouldDeleteDestination = YES;
-						}
-						
-						// Note: YDB_NotifyIfSourceDeleted may be set in addition to the delete rules.
-						
-						if (edge->nodeDeleteRules & YDB_NotifyIfSourceDeleted)
-						{
-							// Notify the destination node
-							
-							if (edge->sourceKey == nil)
-							{
-								edge->destinationKey = src.key;
-								edge->destinationCollection = src.collection;
-							}
-							
-							YapCollectionKey *dst = nil;
-							
-							if (edge->destinationKey == nil)
-							{
-								dst = [databaseTransaction collectionKeyForRowid:edge->destinationRowid];
-								
-								edge->destinationKey = dst.key;
-								edge->destinationCollection = dst.collection;
-							}
-							
-							id dstNode = nil;
-							
-							if (dst)
-								dstNode = [databaseTransaction objectForCollectionKey:dst
-								                                            withRowid:edge->destinationRowid];
-							else
-								dstNode = [databaseTransaction objectForKey:edge->destinationKey
-								                               inCollection:edge->destinationCollection
-								                                  withRowid:edge->destinationRowid];
-							
-							SEL selector = @selector(yapDatabaseRelationshipEdgeDeleted:withReason:);
-							if ([dstNode respondsToSelector:selector])
-							{
-								id updatedDstNode =
-								  [dstNode yapDatabaseRelationshipEdgeDeleted:edge withReason:YDB_SourceNodeDeleted];
-								
-								if (shouldDeleteDestination)
-								{
-									// Don't bother writing the updated node to the database,
-									// since we're going to immediately delete it.
-								}
-								else if (updatedDstNode)
-								{
-									__unsafe_unretained YapDatabaseReadWriteTransaction *databaseRwTransaction =
-									  (YapDatabaseReadWriteTransaction *)databaseTransaction;
-									
-									[databaseRwTransaction replaceObject:updatedDstNode
-									                              forKey:edge->destinationKey
-									                        inCollection:edge->destinationCollection
-									                           withRowid:edge->destinationRowid
-									                    serializedObject:nil];
-								}
-							}
-						}
-						
-						if (shouldDeleteDestination)
-						{
-							// Delete the destination node
-							
-							YapCollectionKey *dst = nil;
-							
-							if (edge->destinationKey == nil)
-							{
-								dst = [databaseTransaction collectionKeyForRowid:edge->destinationRowid];
-								
-								edge->destinationKey = dst.key;
-								edge->destinationCollection = dst.collection;
-							}
-							
-							YDBLogVerbose(@"Deleting destination node: key(%@) collection(%@)",
-							              edge->destinationKey, edge->destinationCollection);
-							
-							__unsafe_unretained YapDatabaseReadWriteTransaction *databaseRwTransaction =
-							  (YapDatabaseReadWriteTransaction *)databaseTransaction;
-							
-							if (dst)
-								[databaseRwTransaction removeObjectForCollectionKey:dst
-								                                          withRowid:edge->destinationRowid];
-							else
-								[databaseRwTransaction removeObjectForKey:edge->destinationKey
-								                             inCollection:edge->destinationCollection
-								                                withRowid:edge->destinationRowid];
-						}
+					
+					if (edge->destinationFileURL) {
+						[parentConnection->filesToDelete addObject:edge->destinationFileURL];
 					}
-				} // end else if (!dstFilePath)
-				
-			#pragma clang diagnostic pop
-			}]; // end enumerateExistingRowsWithSrc:usingBlock:
-		
-		} // end "Enumerate all edges where source node is the deleted node"
-		
-		
-		{ // Enumerate all edges where destination node is the deleted node
-
-			int64_t dstRowid = deletedRowid;
-			YapCollectionKey *dst = deletedCollectionKey;
-			
-			[self enumerateExistingEdgesWithDestination:dstRowid usingBlock:^(YapDatabaseRelationshipEdge *edge) {
-			#pragma clang diagnostic push
-			#pragma clang diagnostic ignored "-Wimplicit-retain-self"
-				
-				// Reminder:
-				//
-				// When using the enumerateExistingEdges...:: method,
-				// the 'edges' parameter is only guaranteed to contain the information that's in the database row.
-				//
-				// To be more specific, they'll have the rowid's but the following values may be nil:
-				// - sourceKey/sourceCollection
-				// - destinationKey/destinationCollection
-				// - destinationFileURL
-				
-				if ([parentConnection->deletedInfo ydb_containsKey:@(edge->sourceRowid)])
+				}
+			}
+			else // if (!(edge->state & YDB_EdgeState_DestinationFileURL))
+			{
+				if ([parentConnection->deletedInfo ydb_containsKey:@(edge->destinationRowid)])
 				{
 					// Both source and destination node have been deleted
 				}
 				else
 				{
-					BOOL shouldDeleteSource = NO;
+					BOOL shouldDeleteDestination = NO;
 					
-					if (edge->nodeDeleteRules & YDB_DeleteSourceIfAllDestinationsDeleted)
+					if (edge->nodeDeleteRules & YDB_DeleteDestinationIfAllSourcesDeleted)
 					{
-						// Delete the source node IF there are no other edges pointing from it
+						// Delete the destination node IF there are no other edges pointing to it
 						
-						int64_t count = [self edgeCountWithSource:edge->sourceRowid
-                                             excludingDestination:dstRowid];
-						if (count == 0)
+						NSNumber *dstRowidNumber = @(edge->destinationRowid);
+						NSNumber *count = [dstCounts objectForKey:dstRowidNumber];
+						if (count == nil)
+						{
+							if (useDeletedNodesTable)
+							count = @([self edgeCountWithDestinationExcludingDeletedSources:edge->destinationRowid]);
+						else
+							count = @([self edgeCountWithDestination:edge->destinationRowid excludingSource:srcRowid]);
+							[dstCounts setObject:count forKey:dstRowidNumber];
+						}
+						
+						if (count.longLongValue == 0)
 						{
-							shouldDeleteSource = YES;
+							shouldDeleteDestination = YES;
 						}
 					}
-					else if (edge->nodeDeleteRules & YDB_DeleteSourceIfDestinationDeleted)
+					else if (edge->nodeDeleteRules & YDB_DeleteDestinationIfSourceDeleted)
 					{
-						shouldDeleteSource = YES;
+						shouldDeleteDestination = YES;
 					}
 					
-					// Note: YDB_NotifyIfDestinationDeleted may be set in addition to the delete rules.
+					// Note: YDB_NotifyIfSourceDeleted may be set in addition to the delete rules.
 					
-					if (edge->nodeDeleteRules & YDB_NotifyIfDestinationDeleted)
+					if (edge->nodeDeleteRules & YDB_NotifyIfSourceDeleted)
 					{
-						// Notify the source node
+						// Notify the destination node
 						
-						if (edge->destinationKey == nil)
+						if (edge->sourceKey == nil)
 						{
-							edge->destinationKey = dst.key;
-							edge->destinationCollection = dst.collection;
+							edge->sourceKey = src.key;
+							edge->sourceCollection = src.collection;
 						}
 						
-						YapCollectionKey *src = nil;
+						YapCollectionKey *dst = nil;
 						
-						if (edge->sourceKey == nil)
+						if (edge->destinationKey == nil)
 						{
-							src = [databaseTransaction collectionKeyForRowid:edge->sourceRowid];
+							dst = [databaseTransaction collectionKeyForRowid:edge->destinationRowid];
 							
-							edge->sourceKey = src.key;
-							edge->sourceCollection = src.collection;
+							edge->destinationKey = dst.key;
+							edge->destinationCollection = dst.collection;
 						}
 						
-						id srcNode = nil;
+						id dstNode = nil;
 						
-						if (src)
-							srcNode = [databaseTransaction objectForCollectionKey:src withRowid:edge->sourceRowid];
+						if (dst)
+							dstNode = [databaseTransaction objectForCollectionKey:dst
+							                                            withRowid:edge->destinationRowid];
 						else
-							srcNode = [databaseTransaction objectForKey:edge->sourceKey
-						                                   inCollection:edge->sourceCollection
-						                                      withRowid:edge->sourceRowid];
+							dstNode = [databaseTransaction objectForKey:edge->destinationKey
+							                               inCollection:edge->destinationCollection
+							                                  withRowid:edge->destinationRowid];
 						
 						SEL selector = @selector(yapDatabaseRelationshipEdgeDeleted:withReason:);
-						if ([srcNode respondsToSelector:selector])
+						if ([dstNode respondsToSelector:selector])
 						{
-							id updatedSrcNode =
-							  [srcNode yapDatabaseRelationshipEdgeDeleted:edge withReason:YDB_DestinationNodeDeleted];
+							id updatedDstNode =
+							  [dstNode yapDatabaseRelationshipEdgeDeleted:edge withReason:YDB_SourceNodeDeleted];
 							
-							if (shouldDeleteSource)
+							if (shouldDeleteDestination)
 							{
 								// Don't bother writing the updated node to the database,
 								// since we're going to immediately delete it.
 							}
-							else if (updatedSrcNode)
+							else if (updatedDstNode)
 							{
 								__unsafe_unretained YapDatabaseReadWriteTransaction *databaseRwTransaction =
 								  (YapDatabaseReadWriteTransaction *)databaseTransaction;
 								
-								[databaseRwTransaction replaceObject:updatedSrcNode
-								                              forKey:edge->sourceKey
-								                        inCollection:edge->sourceCollection
-								                           withRowid:edge->sourceRowid
+								[databaseRwTransaction replaceObject:updatedDstNode
+								                              forKey:edge->destinationKey
+								                        inCollection:edge->destinationCollection
+								                           withRowid:edge->destinationRowid
 								                    serializedObject:nil];
 							}
 						}
 					}
 					
-					if (shouldDeleteSource)
+					if (shouldDeleteDestination)
 					{
-						// Delete the source node
+						// Delete the destination node
 						
-						YapCollectionKey *src = nil;
+						YapCollectionKey *dst = nil;
 						
-						if (edge->sourceKey == nil)
+						if (edge->destinationKey == nil)
 						{
-							src = [databaseTransaction collectionKeyForRowid:edge->sourceRowid];
+							dst = [databaseTransaction collectionKeyForRowid:edge->destinationRowid];
 							
-							edge->sourceKey = src.key;
-							edge->sourceCollection = src.collection;
+							edge->destinationKey = dst.key;
+							edge->destinationCollection = dst.collection;
 						}
 						
-						YDBLogVerbose(@"Deleting source node: key(%@) collection(%@)",
-						              edge->sourceKey, edge->sourceCollection);
+						YDBLogVerbose(@"Deleting destination node: key(%@) collection(%@)",
+						              edge->destinationKey, edge->destinationCollection);
 						
 						__unsafe_unretained YapDatabaseReadWriteTransaction *databaseRwTransaction =
 						  (YapDatabaseReadWriteTransaction *)databaseTransaction;
 						
-						if (src)
-							[databaseRwTransaction removeObjectForCollectionKey:src
-							                                          withRowid:edge->sourceRowid];
+						if (dst)
+							[databaseRwTransaction removeObjectForCollectionKey:dst
+							                                          withRowid:edge->destinationRowid];
 						else
-							[databaseRwTransaction removeObjectForKey:edge->sourceKey
-							                             inCollection:edge->sourceCollection
-							                                withRowid:edge->sourceRowid];
+							[databaseRwTransaction removeObjectForKey:edge->destinationKey
+							                             inCollection:edge->destinationCollection
+							                                withRowid:edge->destinationRowid];
+					}
+				}
+			} // end else if (!dstFilePath)
+			
+		#pragma clang diagnostic pop
+		};
+		
+		// Processing for an edge where the destination node is a deleted node
+		
+		void (^processEdgeWithDeletedDestination)(YapDatabaseRelationshipEdge *) = ^(YapDatabaseRelationshipEdge *edge) {
+		#pragma clang diagnostic push
+		#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+			
+			YapCollectionKey *dst = [parentConnection->deletedInfo objectForKey:@(edge->destinationRowid)];
+			
+			// Reminder:
+			//
+			// When using the enumerateExistingEdges...:: method,
+			// the 'edges' parameter is only guaranteed to contain the information that's in the database row.
+			//
+			// To be more specific, they'll have the rowid's but the following values may be nil:
+			// - sourceKey/sourceCollection
+			// - destinationKey/destinationCollection
+			// - destinationFileURL
+			
+			if ([parentConnection->deletedInfo ydb_containsKey:@(edge->sourceRowid)])
+			{
+				// Both source and destination node have been deleted
+			}
+			else
+			{
+				BOOL shouldDeleteSource = NO;
+				
+				if (edge->nodeDeleteRules & YDB_DeleteSourceIfAllDestinationsDeleted)
+				{
+					// Delete the source node IF there are no other edges pointing from it
+					
+					NSNumber *srcRowidNumber = @(edge->sourceRowid);
+					NSNumber *count = [srcCounts objectForKey:srcRowidNumber];
+					if (count == nil)
+					{
+						if (useDeletedNodesTable)
+							count = @([self edgeCountWithSourceExcludingDeletedDestinations:edge->sourceRowid]);
+						else
+							count = @([self edgeCountWithSource:edge->sourceRowid excludingDestination:edge->destinationRowid]);
+						[srcCounts setObject:count forKey:srcRowidNumber];
+					}
+					
+					if (count.longLongValue == 0)
+					{
+						shouldDeleteSource = YES;
+					}
+				}
+				else if (edge->nodeDeleteRules & YDB_DeleteSourceIfDestinationDeleted)
+				{
+					shouldDeleteSource = YES;
+				}
+				
+				// Note: YDB_NotifyIfDestinationDeleted may be set in addition to the delete rules.
+				
+				if (edge->nodeDeleteRules & YDB_NotifyIfDestinationDeleted)
+				{
+					// Notify the source node
+					
+					if (edge->destinationKey == nil)
+					{
+						edge->destinationKey = dst.key;
+						edge->destinationCollection = dst.collection;
+					}
+					
+					YapCollectionKey *src = nil;
+					
+					if (edge->sourceKey == nil)
+					{
+						src = [databaseTransaction collectionKeyForRowid:edge->sourceRowid];
+						
+						edge->sourceKey = src.key;
+						edge->sourceCollection = src.collection;
+					}
+					
+					id srcNode = nil;
+					
+					if (src)
+						srcNode = [databaseTransaction objectForCollectionKey:src withRowid:edge->sourceRowid];
+					else
+						srcNode = [databaseTransaction objectForKey:edge->sourceKey
+					                                   inCollection:edge->sourceCollection
+					                                      withRowid:edge->sourceRowid];
+					
+					SEL selector = @selector(yapDatabaseRelationshipEdgeDeleted:withReason:);
+					if ([srcNode respondsToSelector:selector])
+					{
+						id updatedSrcNode =
+						  [srcNode yapDatabaseRelationshipEdgeDeleted:edge withReason:YDB_DestinationNodeDeleted];
+						
+						if (shouldDeleteSource)
+						{
+							// Don't bother writing the updated node to the database,
+							// since we're going to immediately delete it.
+						}
+						else if (updatedSrcNode)
+						{
+							__unsafe_unretained YapDatabaseReadWriteTransaction *databaseRwTransaction =
+							  (YapDatabaseReadWriteTransaction *)databaseTransaction;
+							
+							[databaseRwTransaction replaceObject:updatedSrcNode
+							                              forKey:edge->sourceKey
+							                        inCollection:edge->sourceCollection
+							                           withRowid:edge->sourceRowid
+							                    serializedObject:nil];
+						}
+					}
+				}
+				
+				if (shouldDeleteSource)
+				{
+					// Delete the source node
+					
+					YapCollectionKey *src = nil;
+					
+					if (edge->sourceKey == nil)
+					{
+						src = [databaseTransaction collectionKeyForRowid:edge->sourceRowid];
+						
+						edge->sourceKey = src.key;
+						edge->sourceCollection = src.collection;
 					}
+					
+					YDBLogVerbose(@"Deleting source node: key(%@) collection(%@)",
+					              edge->sourceKey, edge->sourceCollection);
+					
+					__unsafe_unretained YapDatabaseReadWriteTransaction *databaseRwTransaction =
+					  (YapDatabaseReadWriteTransaction *)databaseTransaction;
+					
+					if (src)
+						[databaseRwTransaction removeObjectForCollectionKey:src
+						                                          withRowid:edge->sourceRowid];
+					else
+						[databaseRwTransaction removeObjectForKey:edge->sourceKey
+						                             inCollection:edge->sourceCollection
+						                                withRowid:edge->sourceRowid];
 				}
-			
-			#pragma clang diagnostic pop
-			}]; // end enumerateExistingRowsWithDst:usingBlock:
+			}
 		
-		} // end "Enumerate all edges where destination node is the deleted node"
+		#pragma clang diagnostic pop
+		};
 		
-		// Delete all the edges from the database where src or dst is the deleted node
-		[self deleteEdgesWithSourceOrDestination:deletedRowid];
+		if (useDeletedNodesTable)
+		{
+			[self enumerateExistingEdgesWithDeletedNodeAsSource:YES usingBlock:processEdgeWithDeletedSource];
+			[self enumerateExistingEdgesWithDeletedNodeAsSource:NO usingBlock:processEdgeWithDeletedDestination];
+			
+			// Delete all the edges from the database where src or dst is a deleted node (from this pass).
+			// This also clears the temp table.
+			[self deleteEdgesWithDeletedNodes];
+		}
+		else
+		{
+			int64_t deletedRowid = [[parentConnection->deletedOrder objectAtIndex:passStart] longLongValue];
+			
+			[self enumerateExistingEdgesWithSource:deletedRowid usingBlock:processEdgeWithDeletedSource];
+			[self enumerateExistingEdgesWithDestination:deletedRowid usingBlock:processEdgeWithDeletedDestination];
+			
+			[self deleteEdgesWithSourceOrDestination:deletedRowid];
+		}
 		
-		i++;
+		passStart = passEnd;
 	}
 	
 	[parentConnection->inserted removeAllObjects];
@@ -3935,6 +4648,13 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 		}});
 	}
 	
+	// Update our own in-memory graphs (if any).
+	// Other connections will do the same via processChangeset.
+	
+	[parentConnection updateAdjacencyCacheWithDeletedEdges:parentConnection->deletedEdges
+	                                         insertedEdges:parentConnection->insertedEdges
+	                                                 reset:parentConnection->reset];
+	
 	// Commit is complete.
 	// Cleanup time.
 	
@@ -6209,23 +6929,194 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 		return count;
 	}
 	
-	sqlite3_stmt *statement = [parentConnection countForNameStatement];
-	if (statement == NULL) return 0;
+	return (NSUInteger)[self existingEdgeCountWithName:name];
+}
+
+/**
+ * Returns a count of every edge that matches any parameters you specify.
+ * You can specify any combination of the following:
+ *
+ * - name only
+ * - sourceKey & sourceCollection only
+ * - name + sourceKey & sourceCollection
+ *
+ * @param name (optional)
+ *   The name of the edge (case sensitive).
+ *
+ * @param srcKey (optional)
+ *   The edge.sourceKey to match.
+ *
+ * @param srcCollection (optional)
+ *   The edge.sourceCollection to match.
+ *
+ * If you pass a non-nil sourceKey, and sourceCollection is nil,
+ * then the sourceCollection is treated as the empty string, just like the rest of the YapDatabase framework.
+**/
+- (NSUInteger)edgeCountWithName:(NSString *)name
+                      sourceKey:(NSString *)srcKey
+                     collection:(NSString *)srcCollection
+{
+	if (srcKey == nil) {
+		return [self edgeCountWithName:name];
+	}
+	
+	if (databaseTransaction->isReadWriteTransaction)
+	{
+		__block NSUInteger count = 0;
+		[self _enumerateEdgesWithName:name
+		                    sourceKey:srcKey
+		                   collection:srcCollection
+		                   usingBlock:^(YapDatabaseRelationshipEdge __unused *edge, BOOL __unused *stop)
+		{
+			count++;
+		}];
+		
+		return count;
+	}
+	
+	if (srcCollection == nil)
+		srcCollection = @"";
+	
+	int64_t srcRowid = 0;
+	BOOL found = [databaseTransaction getRowid:&srcRowid forKey:srcKey inCollection:srcCollection];
+	if (!found)
+	{
+		// The item doesn't exist in the database.
+		return 0;
+	}
+	
+	sqlite3_stmt *statement = NULL;
+	YapDatabaseString _name;
+	
+	if (name)
+	{
+		statement = [parentConnection countForSrcNameStatement];
+		if (statement == NULL) return 0;
+		
+		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "src" = ? AND "name" = ?;
+		
+		int const bind_idx_src  = SQLITE_BIND_START + 0;
+		int const bind_idx_name = SQLITE_BIND_START + 1;
+		
+		sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
+		
+		MakeYapDatabaseString(&_name, name);
+		sqlite3_bind_text(statement, bind_idx_name, _name.str, _name.length, SQLITE_STATIC);
+	}
+	else
+	{
+		statement = [parentConnection countForSrcStatement];
+		if (statement == NULL) return 0;
+		
+		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "src" = ?;
+		
+		int const bind_idx_src = SQLITE_BIND_START;
+		
+		sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
+	}
 	
 	int64_t count = 0;
 	
-	// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "name" = ?;
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		count = sqlite3_column_int64(statement, SQLITE_COLUMN_START);
+	}
+	else if (status == SQLITE_ERROR)
+	{
+		YDBLogError(@"Error executing statement: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
 	
-	int const column_idx_count = SQLITE_COLUMN_START;
-	int const bind_idx_name    = SQLITE_BIND_START;
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	if (name) {
+		FreeYapDatabaseString(&_name);
+	}
 	
-	YapDatabaseString _name; MakeYapDatabaseString(&_name, name);
-	sqlite3_bind_text(statement, bind_idx_name, _name.str, _name.length, SQLITE_STATIC);
+	return (NSUInteger)count;
+}
+
+/**
+ * Returns a count of every edge that matches any parameters you specify.
+ * You can specify any combination of the following:
+ *
+ * - name only
+ * - destinationKey & destinationCollection only
+ * - name + destinationKey & destinationCollection
+ *
+ * If you pass a non-nil destinationKey, and destinationCollection is nil,
+ * then the destinationCollection is treated as the empty string, just like the rest of the YapDatabase framework.
+**/
+- (NSUInteger)edgeCountWithName:(NSString *)name
+                 destinationKey:(NSString *)dstKey
+                     collection:(NSString *)dstCollection
+{
+	if (dstKey == nil) {
+		return [self edgeCountWithName:name];
+	}
+	
+	if (databaseTransaction->isReadWriteTransaction)
+	{
+		__block NSUInteger count = 0;
+		[self _enumerateEdgesWithName:name
+		               destinationKey:dstKey
+		                   collection:dstCollection
+		                   usingBlock:^(YapDatabaseRelationshipEdge __unused *edge, BOOL __unused *stop)
+		{
+			count++;
+		}];
+		
+		return count;
+	}
+	
+	if (dstCollection == nil)
+		dstCollection = @"";
+	
+	int64_t dstRowid = 0;
+	BOOL found = [databaseTransaction getRowid:&dstRowid forKey:dstKey inCollection:dstCollection];
+	if (!found)
+	{
+		// The item doesn't exist in the database.
+		return 0;
+	}
+	
+	sqlite3_stmt *statement = NULL;
+	YapDatabaseString _name;
+	
+	if (name)
+	{
+		statement = [parentConnection countForDstNameStatement];
+		if (statement == NULL) return 0;
+		
+		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "dst" = ? AND "name" = ?;
+		
+		int const bind_idx_dst  = SQLITE_BIND_START + 0;
+		int const bind_idx_name = SQLITE_BIND_START + 1;
+		
+		sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
+		
+		MakeYapDatabaseString(&_name, name);
+		sqlite3_bind_text(statement, bind_idx_name, _name.str, _name.length, SQLITE_STATIC);
+	}
+	else
+	{
+		statement = [parentConnection countForDstStatement];
+		if (statement == NULL) return 0;
+		
+		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "dst" = ?;
+		
+		int const bind_idx_dst = SQLITE_BIND_START;
+		
+		sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
+	}
+	
+	int64_t count = 0;
 	
 	int status = sqlite3_step(statement);
 	if (status == SQLITE_ROW)
 	{
-		count = sqlite3_column_int64(statement, column_idx_count);
+		count = sqlite3_column_int64(statement, SQLITE_COLUMN_START);
 	}
 	else if (status == SQLITE_ERROR)
 	{
@@ -6235,18 +7126,55 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 	
 	sqlite3_clear_bindings(statement);
 	sqlite3_reset(statement);
-	FreeYapDatabaseString(&_name);
+	if (name) {
+		FreeYapDatabaseString(&_name);
+	}
 	
 	return (NSUInteger)count;
 }
 
+/**
+ * Returns a count of every edge that matches any parameters you specify.
+ * You can specify any combination of the following:
+ *
+ * - name only
+ * - destinationFileURL
+ * - name + destinationFileURL
+ *
+ * @param name (optional)
+ *   The name of the edge (case sensitive).
+ *
+ * @param dstFileURL (optional)
+ *   The edge.destinationFileURL to match.
+**/
+- (NSUInteger)edgeCountWithName:(NSString *)name
+             destinationFileURL:(NSURL *)dstFileURL
+{
+	if (dstFileURL == nil) {
+		return [self edgeCountWithName:name];
+	}
+	
+	__block NSUInteger count = 0;
+	[self _enumerateEdgesWithName:name
+	           destinationFileURL:dstFileURL
+	                   usingBlock:^(YapDatabaseRelationshipEdge __unused *edge, BOOL __unused *stop)
+	{
+		count++;
+	}];
+	
+	return count;
+}
+
 /**
  * Returns a count of every edge that matches any parameters you specify.
  * You can specify any combination of the following:
  *
  * - name only
  * - sourceKey & sourceCollection only
+ * - destinationKey & destinationCollection only
  * - name + sourceKey & sourceCollection
+ * - name + destinationKey & destinationCollection
+ * - name + sourceKey & sourceCollection + destinationKey & destinationCollection
  *
  * @param name (optional)
  *   The name of the edge (case sensitive).
@@ -6257,15 +7185,34 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
  * @param srcCollection (optional)
  *   The edge.sourceCollection to match.
  *
+ * @param dstKey (optional)
+ *   The edge.destinationKey to match.
+ *
+ * @param dstCollection (optional)
+ *   The edge.destinationCollection to match.
+ *
  * If you pass a non-nil sourceKey, and sourceCollection is nil,
  * then the sourceCollection is treated as the empty string, just like the rest of the YapDatabase framework.
+ *
+ * If you pass a non-nil destinationKey, and destinationCollection is nil,
+ * then the destinationCollection is treated as the empty string, just like the rest of the YapDatabase framework.
 **/
 - (NSUInteger)edgeCountWithName:(NSString *)name
                       sourceKey:(NSString *)srcKey
                      collection:(NSString *)srcCollection
+                 destinationKey:(NSString *)dstKey
+                     collection:(NSString *)dstCollection
 {
-	if (srcKey == nil) {
-		return [self edgeCountWithName:name];
+	if (srcKey == nil)
+	{
+		if (dstKey == nil)
+			return [self edgeCountWithName:name];
+		else
+			return [self edgeCountWithName:name destinationKey:dstKey collection:dstCollection];
+	}
+	if (dstKey == nil)
+	{
+		return [self edgeCountWithName:name sourceKey:srcKey collection:srcCollection];
 	}
 	
 	if (databaseTransaction->isReadWriteTransaction)
@@ -6274,6 +7221,8 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 		[self _enumerateEdgesWithName:name
 		                    sourceKey:srcKey
 		                   collection:srcCollection
+		               destinationKey:dstKey
+		                   collection:dstCollection
 		                   usingBlock:^(YapDatabaseRelationshipEdge __unused *edge, BOOL __unused *stop)
 		{
 			count++;
@@ -6285,8 +7234,21 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 	if (srcCollection == nil)
 		srcCollection = @"";
 	
+	if (dstCollection == nil)
+		dstCollection = @"";
+	
+	BOOL found;
+	
 	int64_t srcRowid = 0;
-	BOOL found = [databaseTransaction getRowid:&srcRowid forKey:srcKey inCollection:srcCollection];
+	found = [databaseTransaction getRowid:&srcRowid forKey:srcKey inCollection:srcCollection];
+	if (!found)
+	{
+		// The item doesn't exist in the database.
+		return 0;
+	}
+	
+	int64_t dstRowid = 0;
+	found = [databaseTransaction getRowid:&dstRowid forKey:dstKey inCollection:dstCollection];
 	if (!found)
 	{
 		// The item doesn't exist in the database.
@@ -6298,33 +7260,38 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 	
 	if (name)
 	{
-		statement = [parentConnection countForSrcNameStatement];
+		statement = [parentConnection countForSrcDstNameStatement];
 		if (statement == NULL) return 0;
 		
-		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "src" = ? AND "name" = ?;
+		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "src" = ? AND "dst" = ? AND "name" = ?;
 		
 		int const bind_idx_src  = SQLITE_BIND_START + 0;
-		int const bind_idx_name = SQLITE_BIND_START + 1;
+		int const bind_idx_dst  = SQLITE_BIND_START + 1;
+		int const bind_idx_name = SQLITE_BIND_START + 2;
 		
 		sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
+		sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
 		
 		MakeYapDatabaseString(&_name, name);
 		sqlite3_bind_text(statement, bind_idx_name, _name.str, _name.length, SQLITE_STATIC);
 	}
 	else
 	{
-		statement = [parentConnection countForSrcStatement];
+		statement = [parentConnection countForSrcDstStatement];
 		if (statement == NULL) return 0;
 		
-		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "src" = ?;
+		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "src" = ? AND "dst" = ?;
 		
-		int const bind_idx_src = SQLITE_BIND_START;
+		int const bind_idx_src = SQLITE_BIND_START + 0;
+		int const bind_idx_dst = SQLITE_BIND_START + 1;
 		
 		sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
+		sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
 	}
 	
 	int64_t count = 0;
 	
+	
 	int status = sqlite3_step(statement);
 	if (status == SQLITE_ROW)
 	{
@@ -6350,122 +7317,350 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
  * You can specify any combination of the following:
  *
  * - name only
- * - destinationKey & destinationCollection only
- * - name + destinationKey & destinationCollection
+ * - sourceKey & sourceCollection only
+ * - destinationFileURL
+ * - name + sourceKey & sourceCollection
+ * - name + destinationFileURL
+ * - name + sourceKey & sourceCollection + destinationFileURL
  *
- * If you pass a non-nil destinationKey, and destinationCollection is nil,
- * then the destinationCollection is treated as the empty string, just like the rest of the YapDatabase framework.
+ * If you pass a non-nil sourceKey, and sourceCollection is nil,
+ * then the sourceCollection is treated as the empty string,
+ * just like the rest of the YapDatabase framework.
 **/
 - (NSUInteger)edgeCountWithName:(NSString *)name
-                 destinationKey:(NSString *)dstKey
-                     collection:(NSString *)dstCollection
+                      sourceKey:(NSString *)srcKey
+                     collection:(NSString *)srcCollection
+             destinationFileURL:(NSURL *)dstFileURL
 {
-	if (dstKey == nil) {
-		return [self edgeCountWithName:name];
+	if (srcKey == nil)
+	{
+		if (dstFileURL == nil)
+			return [self edgeCountWithName:name];
+		else
+			return [self edgeCountWithName:name destinationFileURL:dstFileURL];
 	}
-	
-	if (databaseTransaction->isReadWriteTransaction)
+	if (dstFileURL == nil)
 	{
-		__block NSUInteger count = 0;
-		[self _enumerateEdgesWithName:name
-		               destinationKey:dstKey
-		                   collection:dstCollection
-		                   usingBlock:^(YapDatabaseRelationshipEdge __unused *edge, BOOL __unused *stop)
-		{
-			count++;
-		}];
-		
-		return count;
+		return [self edgeCountWithName:name sourceKey:srcKey collection:srcCollection];
 	}
 	
-	if (dstCollection == nil)
-		dstCollection = @"";
-	
-	int64_t dstRowid = 0;
-	BOOL found = [databaseTransaction getRowid:&dstRowid forKey:dstKey inCollection:dstCollection];
-	if (!found)
+	__block NSUInteger count = 0;
+	[self _enumerateEdgesWithName:name
+	                    sourceKey:srcKey
+	                   collection:srcCollection
+	           destinationFileURL:dstFileURL
+	                   usingBlock:^(YapDatabaseRelationshipEdge __unused *edge, BOOL __unused *stop)
 	{
-		// The item doesn't exist in the database.
-		return 0;
-	}
+		count++;
+	}];
 	
-	sqlite3_stmt *statement = NULL;
-	YapDatabaseString _name;
+	return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Private API - Traversal
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns YES if there are changes within the current read-write transaction
+ * that haven't yet been applied to the in-memory graphs.
+**/
+- (BOOL)hasPendingAdjacencyChanges
+{
+	if (!databaseTransaction->isReadWriteTransaction) return NO;
+	
+	return ([parentConnection->protocolChanges count] > 0 ||
+	        [parentConnection->manualChanges   count] > 0 ||
+	        [parentConnection->inserted        count] > 0 ||
+	        [parentConnection->deletedOrder    count] > 0 ||
+	        [parentConnection->deletedEdges    count] > 0 ||
+	        [parentConnection->insertedEdges   count] > 0 ||
+	        parentConnection->reset);
+}
+
+/**
+ * Returns the in-memory graph for the given edge name, loading it from disk if needed.
+ *
+ * Returns nil if the edge name isn't configured for caching (YapDatabaseRelationshipOptions.adjacencyCacheEdgeNames),
+ * or if the current transaction has pending changes that aren't reflected in the graph.
+ * In which case the caller should fallback to the regular (sqlite-backed) enumeration.
+**/
+- (YapDatabaseRelationshipAdjacency *)adjacencyWithName:(NSString *)name
+{
+	if (![parentConnection->parent->options->adjacencyCacheEdgeNames containsObject:name]) return nil;
+	if ([self hasPendingAdjacencyChanges]) return nil;
 	
-	if (name)
+	YapDatabaseRelationshipAdjacency *adjacency = parentConnection->adjacencyCache[name];
+	if (adjacency) return adjacency;
+	
+	BOOL needsFinalize;
+	sqlite3_stmt *statement = [parentConnection enumerateForNameStatement:&needsFinalize];
+	if (statement == NULL)
+		return nil;
+	
+	adjacency = [[YapDatabaseRelationshipAdjacency alloc] initWithName:name];
+	
+	// SELECT "rowid", "src", "dst", "rules", "manual" FROM "tableName" WHERE "name" = ?;
+	
+	int const column_idx_rowid = SQLITE_COLUMN_START + 0;
+	int const column_idx_src   = SQLITE_COLUMN_START + 1;
+	int const column_idx_dst   = SQLITE_COLUMN_START + 2;
+	int const bind_idx_name    = SQLITE_BIND_START;
+	
+	YapDatabaseString _name; MakeYapDatabaseString(&_name, name);
+	sqlite3_bind_text(statement, bind_idx_name, _name.str, _name.length, SQLITE_STATIC);
+	
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
 	{
-		statement = [parentConnection countForDstNameStatement];
-		if (statement == NULL) return 0;
-		
-		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "dst" = ? AND "name" = ?;
-		
-		int const bind_idx_dst  = SQLITE_BIND_START + 0;
-		int const bind_idx_name = SQLITE_BIND_START + 1;
+		if (sqlite3_column_type(statement, column_idx_dst) != SQLITE_INTEGER)
+		{
+			// destinationFileURL
+			continue;
+		}
 		
-		sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
+		int64_t edgeRowid = sqlite3_column_int64(statement, column_idx_rowid);
+		int64_t srcRowid  = sqlite3_column_int64(statement, column_idx_src);
+		int64_t dstRowid  = sqlite3_column_int64(statement, column_idx_dst);
 		
-		MakeYapDatabaseString(&_name, name);
-		sqlite3_bind_text(statement, bind_idx_name, _name.str, _name.length, SQLITE_STATIC);
+		[adjacency addEdgeWithRowid:edgeRowid sourceRowid:srcRowid destinationRowid:dstRowid];
 	}
-	else
+	
+	if (status != SQLITE_DONE)
 	{
-		statement = [parentConnection countForDstStatement];
-		if (statement == NULL) return 0;
-		
-		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "dst" = ?;
-		
-		int const bind_idx_dst = SQLITE_BIND_START;
+		YDBLogError(@"Error executing statement: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
 		
-		sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
+		adjacency = nil;
 	}
 	
-	int64_t count = 0;
+	sqlite_enum_reset(statement, needsFinalize);
+	FreeYapDatabaseString(&_name);
 	
-	int status = sqlite3_step(statement);
-	if (status == SQLITE_ROW)
+	if (adjacency)
 	{
-		count = sqlite3_column_int64(statement, SQLITE_COLUMN_START);
+		if (parentConnection->adjacencyCache == nil)
+			parentConnection->adjacencyCache = [[NSMutableDictionary alloc] init];
+		
+		parentConnection->adjacencyCache[name] = adjacency;
 	}
-	else if (status == SQLITE_ERROR)
+	
+	return adjacency;
+}
+
+/**
+ * Walks the graph formed by the given edge names, starting at (but not including) the given node.
+ *
+ * Edge names with an in-memory graph are traversed without touching sqlite.
+ * All other edge names fallback to the regular enumeration (which also includes pending in-memory changes).
+**/
+- (void)_traverseFromRowid:(int64_t)startRowid
+             withEdgeNames:(NSArray<NSString *> *)edgeNames
+                  outgoing:(BOOL)outgoing
+                depthFirst:(BOOL)depthFirst
+                  maxDepth:(NSUInteger)maxDepth
+                usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, NSUInteger depth, BOOL *stop))block
+{
+	NSMutableArray<YapDatabaseRelationshipAdjacency *> *graphs = [NSMutableArray arrayWithCapacity:edgeNames.count];
+	NSMutableArray<NSString *> *uncachedNames = [NSMutableArray arrayWithCapacity:edgeNames.count];
+	
+	for (NSString *name in [NSOrderedSet orderedSetWithArray:edgeNames])
 	{
-		YDBLogError(@"Error executing statement: %d %s",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		YapDatabaseRelationshipAdjacency *adjacency = [self adjacencyWithName:name];
+		if (adjacency)
+			[graphs addObject:adjacency];
+		else
+			[uncachedNames addObject:name];
 	}
 	
-	sqlite3_clear_bindings(statement);
-	sqlite3_reset(statement);
-	if (name) {
-		FreeYapDatabaseString(&_name);
-	}
+	YapDatabaseRelationshipNeighborProvider neighbors =
+	  ^(int64_t rowid, BOOL (NS_NOESCAPE^visit)(int64_t neighborRowid)) {
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		__block BOOL done = NO;
+		
+		for (YapDatabaseRelationshipAdjacency *adjacency in graphs)
+		{
+			[adjacency enumerateNeighborsOfNode:rowid outgoing:outgoing usingBlock:^(int64_t neighborRowid, BOOL *stop) {
+				
+				if (!visit(neighborRowid)) {
+					done = YES;
+					*stop = YES;
+				}
+			}];
+			
+			if (done) return;
+		}
+		
+		if (uncachedNames.count == 0) return;
+		
+		YapCollectionKey *ck = [databaseTransaction collectionKeyForRowid:rowid];
+		if (ck == nil) return;
+		
+		for (NSString *name in uncachedNames)
+		{
+			if (outgoing)
+			{
+				[self _enumerateEdgesWithName:name
+				                    sourceKey:ck.key
+				                   collection:ck.collection
+				                   usingBlock:^(YapDatabaseRelationshipEdge *edge, BOOL *stop)
+				{
+					if (edge->state & YDB_EdgeState_DestinationFileURL) return;
+					if (![self lookupEdgeDestinationRowid:edge isDeleted:NULL]) return;
+					
+					if (!visit(edge->destinationRowid)) {
+						done = YES;
+						*stop = YES;
+					}
+				}];
+			}
+			else
+			{
+				[self _enumerateEdgesWithName:name
+				               destinationKey:ck.key
+				                   collection:ck.collection
+				                   usingBlock:^(YapDatabaseRelationshipEdge *edge, BOOL *stop)
+				{
+					if (![self lookupEdgeSourceRowid:edge isDeleted:NULL]) return;
+					
+					if (!visit(edge->sourceRowid)) {
+						done = YES;
+						*stop = YES;
+					}
+				}];
+			}
+			
+			if (done) return;
+		}
+		
+	#pragma clang diagnostic pop
+	};
 	
-	return (NSUInteger)count;
+	YapDatabaseRelationshipTraverse(startRowid, depthFirst, maxDepth, neighbors, block);
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Public API - Traversal
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 /**
- * Returns a count of every edge that matches any parameters you specify.
- * You can specify any combination of the following:
+ * Enumerates every node reachable from the given node, by following edges with the given name(s).
  *
- * - name only
- * - destinationFileURL
- * - name + destinationFileURL
+ * @see YapDatabaseRelationshipTransaction.h for full documentation.
+**/
+- (void)enumerateNodesReachableFromKey:(NSString *)key
+                            collection:(NSString *)collection
+                         withEdgeNames:(NSArray<NSString *> *)edgeNames
+                             direction:(YDB_TraversalDirection)direction
+                                 order:(YDB_TraversalOrder)order
+                              maxDepth:(NSUInteger)maxDepth
+                            usingBlock:(void (NS_NOESCAPE^)(NSString *key, NSString *collection,
+                                                            NSUInteger depth, BOOL *stop))block
+{
+	if (key == nil) return;
+	if (edgeNames.count == 0) return;
+	if (block == NULL) return;
+	
+	if (collection == nil)
+		collection = @"";
+	
+	int64_t startRowid = 0;
+	if (![databaseTransaction getRowid:&startRowid forKey:key inCollection:collection]) return;
+	
+	[self _traverseFromRowid:startRowid
+	           withEdgeNames:edgeNames
+	                outgoing:(direction == YDB_TraversalDirectionOutgoing)
+	              depthFirst:(order == YDB_TraversalOrderDepthFirst)
+	                maxDepth:maxDepth
+	              usingBlock:^(int64_t rowid, NSUInteger depth, BOOL *stop)
+	{
+		YapCollectionKey *ck = [self->databaseTransaction collectionKeyForRowid:rowid];
+		if (ck) {
+			block(ck.key, ck.collection, depth, stop);
+		}
+	}];
+}
+
+/**
+ * Returns whether or not there's a path from the source node to the destination node,
+ * by following edges (from source to destination) with the given name(s).
  *
- * @param name (optional)
- *   The name of the edge (case sensitive).
+ * @see YapDatabaseRelationshipTransaction.h for full documentation.
+**/
+- (BOOL)isNodeWithKey:(NSString *)dstKey
+           collection:(NSString *)dstCollection
+     reachableFromKey:(NSString *)srcKey
+           collection:(NSString *)srcCollection
+        withEdgeNames:(NSArray<NSString *> *)edgeNames
+             maxDepth:(NSUInteger)maxDepth
+{
+	if (srcKey == nil) return NO;
+	if (dstKey == nil) return NO;
+	if (edgeNames.count == 0) return NO;
+	
+	if (srcCollection == nil)
+		srcCollection = @"";
+	
+	if (dstCollection == nil)
+		dstCollection = @"";
+	
+	int64_t srcRowid = 0;
+	int64_t dstRowid = 0;
+	
+	if (![databaseTransaction getRowid:&srcRowid forKey:srcKey inCollection:srcCollection]) return NO;
+	if (![databaseTransaction getRowid:&dstRowid forKey:dstKey inCollection:dstCollection]) return NO;
+	
+	if (srcRowid == dstRowid) return YES;
+	
+	__block BOOL found = NO;
+	
+	[self _traverseFromRowid:srcRowid
+	           withEdgeNames:edgeNames
+	                outgoing:YES
+	              depthFirst:NO
+	                maxDepth:maxDepth
+	              usingBlock:^(int64_t rowid, NSUInteger __unused depth, BOOL *stop)
+	{
+		if (rowid == dstRowid) {
+			found = YES;
+			*stop = YES;
+		}
+	}];
+	
+	return found;
+}
+
+/**
+ * Returns the number of distinct nodes reachable from the given node,
+ * by following edges with the given name(s) in the given direction.
  *
- * @param dstFileURL (optional)
- *   The edge.destinationFileURL to match.
+ * @see YapDatabaseRelationshipTransaction.h for full documentation.
 **/
-- (NSUInteger)edgeCountWithName:(NSString *)name
-             destinationFileURL:(NSURL *)dstFileURL
+- (NSUInteger)reachableNodeCountFromKey:(NSString *)key
+                             collection:(NSString *)collection
+                          withEdgeNames:(NSArray<NSString *> *)edgeNames
+                              direction:(YDB_TraversalDirection)direction
+                               maxDepth:(NSUInteger)maxDepth
 {
-	if (dstFileURL == nil) {
-		return [self edgeCountWithName:name];
-	}
+	if (key == nil) return 0;
+	if (edgeNames.count == 0) return 0;
+	
+	if (collection == nil)
+		collection = @"";
+	
+	int64_t startRowid = 0;
+	if (![databaseTransaction getRowid:&startRowid forKey:key inCollection:collection]) return 0;
 	
 	__block NSUInteger count = 0;
-	[self _enumerateEdgesWithName:name
-	           destinationFileURL:dstFileURL
-	                   usingBlock:^(YapDatabaseRelationshipEdge __unused *edge, BOOL __unused *stop)
+	
+	[self _traverseFromRowid:startRowid
+	           withEdgeNames:edgeNames
+	                outgoing:(direction == YDB_TraversalDirectionOutgoing)
+	              depthFirst:NO
+	                maxDepth:maxDepth
+	              usingBlock:^(int64_t __unused rowid, NSUInteger __unused depth, BOOL __unused *stop)
 	{
 		count++;
 	}];
@@ -6473,196 +7668,302 @@ NS_INLINE BOOL URLMatchesURL(NSURL *url1, NSURL *url2)
 	return count;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Private API - Recursive Queries
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 /**
- * Returns a count of every edge that matches any parameters you specify.
- * You can specify any combination of the following:
- *
- * - name only
- * - sourceKey & sourceCollection only
- * - destinationKey & destinationCollection only
- * - name + sourceKey & sourceCollection
- * - name + destinationKey & destinationCollection
- * - name + sourceKey & sourceCollection + destinationKey & destinationCollection
- *
- * @param name (optional)
- *   The name of the edge (case sensitive).
- *
- * @param srcKey (optional)
- *   The edge.sourceKey to match.
- *
- * @param srcCollection (optional)
- *   The edge.sourceCollection to match.
- *
- * @param dstKey (optional)
- *   The edge.destinationKey to match.
- *
- * @param dstCollection (optional)
- *   The edge.destinationCollection to match.
+ * Enumerates every node reachable from the given node (in breadth-first order),
+ * by following edges with the given name.
  *
- * If you pass a non-nil sourceKey, and sourceCollection is nil,
- * then the sourceCollection is treated as the empty string, just like the rest of the YapDatabase framework.
- *
- * If you pass a non-nil destinationKey, and destinationCollection is nil,
- * then the destinationCollection is treated as the empty string, just like the rest of the YapDatabase framework.
+ * When the relationship table is authoritative, this runs as a level-by-level search in sqlite,
+ * with one INSERT (of the next level into a temp table of visited nodes) & one SELECT per level.
+ * Otherwise (in-memory graph available, or pending changes in this read-write transaction),
+ * it falls back to the regular traversal.
 **/
-- (NSUInteger)edgeCountWithName:(NSString *)name
-                      sourceKey:(NSString *)srcKey
-                     collection:(NSString *)srcCollection
-                 destinationKey:(NSString *)dstKey
-                     collection:(NSString *)dstCollection
+- (void)_enumerateRowidsReachableFromRowid:(int64_t)startRowid
+                              withEdgeName:(NSString *)edgeName
+                                  outgoing:(BOOL)outgoing
+                                  maxDepth:(NSUInteger)maxDepth
+                                usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, NSUInteger depth, BOOL *stop))block
 {
-	if (srcKey == nil)
+	if (edgeName == nil) return;
+	if (block == NULL) return;
+	
+	if ([self hasPendingAdjacencyChanges] || [self adjacencyWithName:edgeName])
 	{
-		if (dstKey == nil)
-			return [self edgeCountWithName:name];
-		else
-			return [self edgeCountWithName:name destinationKey:dstKey collection:dstCollection];
+		[self _traverseFromRowid:startRowid
+		           withEdgeNames:@[ edgeName ]
+		                outgoing:outgoing
+		              depthFirst:NO
+		                maxDepth:maxDepth
+		              usingBlock:block];
+		return;
 	}
-	if (dstKey == nil)
+	
+	// The search uses a (per-connection) temp table as its visited set.
+	// So a nested search (from within the block) falls back to the regular traversal.
+	
+	if (isEnumeratingReachableNodes || ![self createReachableNodesTableIfNeeded])
 	{
-		return [self edgeCountWithName:name sourceKey:srcKey collection:srcCollection];
+		[self _traverseFromRowid:startRowid
+		           withEdgeNames:@[ edgeName ]
+		                outgoing:outgoing
+		              depthFirst:NO
+		                maxDepth:maxDepth
+		              usingBlock:block];
+		return;
 	}
 	
-	if (databaseTransaction->isReadWriteTransaction)
+	sqlite3_stmt *insertStartStatement = [parentConnection insertReachableStartStatement];
+	sqlite3_stmt *insertNextStatement = outgoing ? [parentConnection insertReachableForSrcNameStatement]
+	                                             : [parentConnection insertReachableForDstNameStatement];
+	sqlite3_stmt *enumerateStatement = [parentConnection enumerateReachableForDepthStatement];
+	
+	if (insertStartStatement == NULL || insertNextStatement == NULL || enumerateStatement == NULL) return;
+	
+	isEnumeratingReachableNodes = YES;
+	
+	sqlite3 *db = databaseTransaction->connection->db;
+	
+	[self removeAllReachableNodes];
+	
+	// INSERT OR IGNORE INTO "temp"."reachableNodesTableName" ("rowid", "depth") VALUES (?, 0);
 	{
-		__block NSUInteger count = 0;
-		[self _enumerateEdgesWithName:name
-		                    sourceKey:srcKey
-		                   collection:srcCollection
-		               destinationKey:dstKey
-		                   collection:dstCollection
-		                   usingBlock:^(YapDatabaseRelationshipEdge __unused *edge, BOOL __unused *stop)
+		sqlite3_bind_int64(insertStartStatement, SQLITE_BIND_START, startRowid);
+		
+		int status = sqlite3_step(insertStartStatement);
+		if (status != SQLITE_DONE)
 		{
-			count++;
-		}];
+			YDBLogError(@"Error executing statement: %d %s", status, sqlite3_errmsg(db));
+		}
 		
-		return count;
+		sqlite3_clear_bindings(insertStartStatement);
+		sqlite3_reset(insertStartStatement);
 	}
 	
-	if (srcCollection == nil)
-		srcCollection = @"";
+	// INSERT OR IGNORE INTO "temp"."reachableNodesTableName" ("rowid", "depth")
+	//   SELECT "e"."dst", "r"."depth" + 1 FROM "temp"."reachableNodesTableName" AS "r"
+	//   JOIN "tableName" AS "e" ON "e"."src" = "r"."rowid"
+	//   WHERE "r"."depth" = ? AND "e"."name" = ? AND typeof("e"."dst") = 'integer';
+	//
+	// (or the reverse for incoming: join on "dst", select "src")
+	//
+	// SELECT "rowid" FROM "temp"."reachableNodesTableName" WHERE "depth" = ?;
 	
-	if (dstCollection == nil)
-		dstCollection = @"";
+	int const bind_idx_depth = SQLITE_BIND_START + 0;
+	int const bind_idx_name  = SQLITE_BIND_START + 1;
 	
-	BOOL found;
+	int const column_idx_rowid = SQLITE_COLUMN_START;
 	
-	int64_t srcRowid = 0;
-	found = [databaseTransaction getRowid:&srcRowid forKey:srcKey inCollection:srcCollection];
-	if (!found)
-	{
-		// The item doesn't exist in the database.
-		return 0;
-	}
+	YapDatabaseString _name; MakeYapDatabaseString(&_name, edgeName);
 	
-	int64_t dstRowid = 0;
-	found = [databaseTransaction getRowid:&dstRowid forKey:dstKey inCollection:dstCollection];
-	if (!found)
-	{
-		// The item doesn't exist in the database.
-		return 0;
-	}
+	NSMutableArray<NSNumber *> *level = [NSMutableArray array];
 	
-	sqlite3_stmt *statement = NULL;
-	YapDatabaseString _name;
+	BOOL stop = NO;
+	int64_t depth = 0;
 	
-	if (name)
+	while (!stop && (maxDepth == 0 || depth < (int64_t)maxDepth))
 	{
-		statement = [parentConnection countForSrcDstNameStatement];
-		if (statement == NULL) return 0;
+		// Step 1:
+		// Insert the next level (skipping nodes that have already been visited)
 		
-		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "src" = ? AND "dst" = ? AND "name" = ?;
+		sqlite3_bind_int64(insertNextStatement, bind_idx_depth, depth);
+		sqlite3_bind_text(insertNextStatement, bind_idx_name, _name.str, _name.length, SQLITE_STATIC);
 		
-		int const bind_idx_src  = SQLITE_BIND_START + 0;
-		int const bind_idx_dst  = SQLITE_BIND_START + 1;
-		int const bind_idx_name = SQLITE_BIND_START + 2;
+		int status = sqlite3_step(insertNextStatement);
+		if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"Error executing statement: %d %s", status, sqlite3_errmsg(db));
+		}
 		
-		sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
-		sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
+		int changes = (status == SQLITE_DONE) ? sqlite3_changes(db) : 0;
 		
-		MakeYapDatabaseString(&_name, name);
-		sqlite3_bind_text(statement, bind_idx_name, _name.str, _name.length, SQLITE_STATIC);
-	}
-	else
-	{
-		statement = [parentConnection countForSrcDstStatement];
-		if (statement == NULL) return 0;
+		sqlite3_clear_bindings(insertNextStatement);
+		sqlite3_reset(insertNextStatement);
 		
-		// SELECT COUNT(*) AS NumberOfRows FROM "tableName" WHERE "src" = ? AND "dst" = ?;
+		if (changes == 0) break;
+		depth++;
 		
-		int const bind_idx_src = SQLITE_BIND_START + 0;
-		int const bind_idx_dst = SQLITE_BIND_START + 1;
+		// Step 2:
+		// Read the new level.
+		// The statement is reset before invoking the block, as the block may perform its own queries.
 		
-		sqlite3_bind_int64(statement, bind_idx_src, srcRowid);
-		sqlite3_bind_int64(statement, bind_idx_dst, dstRowid);
+		sqlite3_bind_int64(enumerateStatement, SQLITE_BIND_START, depth);
+		
+		while ((status = sqlite3_step(enumerateStatement)) == SQLITE_ROW)
+		{
+			[level addObject:@(sqlite3_column_int64(enumerateStatement, column_idx_rowid))];
+		}
+		
+		if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"sqlite_step error: %d %s", status, sqlite3_errmsg(db));
+		}
+		
+		sqlite3_clear_bindings(enumerateStatement);
+		sqlite3_reset(enumerateStatement);
+		
+		// Step 3:
+		// Report the new level
+		
+		for (NSNumber *rowidNumber in level)
+		{
+			block(rowidNumber.longLongValue, (NSUInteger)depth, &stop);
+			if (stop) break;
+		}
+		
+		[level removeAllObjects];
 	}
 	
-	int64_t count = 0;
+	[self removeAllReachableNodes];
 	
+	FreeYapDatabaseString(&_name);
+	isEnumeratingReachableNodes = NO;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Public API - Recursive Queries
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Enumerates every node reachable from the given node, by following edges with the given name,
+ * using a level-by-level search against the relationship table.
+ *
+ * @see YapDatabaseRelationshipTransaction.h for full documentation.
+**/
+- (void)enumerateKeysReachableFromKey:(NSString *)key
+                           collection:(NSString *)collection
+                          viaEdgeName:(NSString *)edgeName
+                            direction:(YDB_TraversalDirection)direction
+                             maxDepth:(NSUInteger)maxDepth
+                           usingBlock:(void (NS_NOESCAPE^)(NSString *key, NSString *collection,
+                                                           NSUInteger depth, BOOL *stop))block
+{
+	if (key == nil) return;
+	if (edgeName == nil) return;
+	if (block == NULL) return;
 	
-	int status = sqlite3_step(statement);
-	if (status == SQLITE_ROW)
-	{
-		count = sqlite3_column_int64(statement, SQLITE_COLUMN_START);
-	}
-	else if (status == SQLITE_ERROR)
-	{
-		YDBLogError(@"Error executing statement: %d %s",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
-	}
+	if (collection == nil)
+		collection = @"";
 	
-	sqlite3_clear_bindings(statement);
-	sqlite3_reset(statement);
-	if (name) {
-		FreeYapDatabaseString(&_name);
-	}
+	int64_t startRowid = 0;
+	if (![databaseTransaction getRowid:&startRowid forKey:key inCollection:collection]) return;
 	
-	return (NSUInteger)count;
+	[self _enumerateRowidsReachableFromRowid:startRowid
+	                            withEdgeName:edgeName
+	                                outgoing:(direction == YDB_TraversalDirectionOutgoing)
+	                                maxDepth:maxDepth
+	                              usingBlock:^(int64_t rowid, NSUInteger depth, BOOL *stop)
+	{
+		YapCollectionKey *ck = [self->databaseTransaction collectionKeyForRowid:rowid];
+		if (ck) {
+			block(ck.key, ck.collection, depth, stop);
+		}
+	}];
 }
 
 /**
- * Returns a count of every edge that matches any parameters you specify.
- * You can specify any combination of the following:
- *
- * - name only
- * - sourceKey & sourceCollection only
- * - destinationFileURL
- * - name + sourceKey & sourceCollection
- * - name + destinationFileURL
- * - name + sourceKey & sourceCollection + destinationFileURL
+ * Returns the shortest path from the source node to the destination node,
+ * following edges (from source to destination) with the given name.
  *
- * If you pass a non-nil sourceKey, and sourceCollection is nil,
- * then the sourceCollection is treated as the empty string,
- * just like the rest of the YapDatabase framework.
+ * @see YapDatabaseRelationshipTransaction.h for full documentation.
 **/
-- (NSUInteger)edgeCountWithName:(NSString *)name
-                      sourceKey:(NSString *)srcKey
-                     collection:(NSString *)srcCollection
-             destinationFileURL:(NSURL *)dstFileURL
+- (NSArray<YapCollectionKey *> *)shortestPathFromKey:(NSString *)srcKey
+                                          collection:(NSString *)srcCollection
+                                               toKey:(NSString *)dstKey
+                                          collection:(NSString *)dstCollection
+                                         viaEdgeName:(NSString *)edgeName
+                                            maxDepth:(NSUInteger)maxDepth
 {
-	if (srcKey == nil)
+	if (srcKey == nil) return nil;
+	if (dstKey == nil) return nil;
+	if (edgeName == nil) return nil;
+	
+	if (srcCollection == nil)
+		srcCollection = @"";
+	
+	if (dstCollection == nil)
+		dstCollection = @"";
+	
+	int64_t srcRowid = 0;
+	int64_t dstRowid = 0;
+	
+	if (![databaseTransaction getRowid:&srcRowid forKey:srcKey inCollection:srcCollection]) return nil;
+	if (![databaseTransaction getRowid:&dstRowid forKey:dstKey inCollection:dstCollection]) return nil;
+	
+	if (srcRowid == dstRowid) {
+		return @[ YapCollectionKeyCreate(srcCollection, srcKey) ];
+	}
+	
+	// Step 1:
+	//
+	// Breadth-first search from the source, until we reach the destination.
+	// This gives us the shortest distance to every node we pass along the way.
+	
+	NSMutableDictionary<NSNumber *, NSNumber *> *depths = [NSMutableDictionary dictionary];
+	__block NSUInteger dstDepth = 0;
+	
+	[self _enumerateRowidsReachableFromRowid:srcRowid
+	                            withEdgeName:edgeName
+	                                outgoing:YES
+	                                maxDepth:maxDepth
+	                              usingBlock:^(int64_t rowid, NSUInteger depth, BOOL *stop)
 	{
-		if (dstFileURL == nil)
-			return [self edgeCountWithName:name];
+		if (rowid == dstRowid)
+		{
+			dstDepth = depth;
+			*stop = YES;
+		}
 		else
-			return [self edgeCountWithName:name destinationFileURL:dstFileURL];
-	}
-	if (dstFileURL == nil)
+		{
+			depths[@(rowid)] = @(depth);
+		}
+	}];
+	
+	if (dstDepth == 0) return nil;
+	
+	// Step 2:
+	//
+	// Walk backwards from the destination.
+	// At each hop, any predecessor that's exactly one hop closer to the source is on a shortest path.
+	
+	NSMutableArray<YapCollectionKey *> *path = [NSMutableArray arrayWithCapacity:(dstDepth + 1)];
+	[path addObject:YapCollectionKeyCreate(dstCollection, dstKey)];
+	
+	YapCollectionKey *current = path[0];
+	
+	for (NSUInteger depth = dstDepth; depth > 1; depth--)
 	{
-		return [self edgeCountWithName:name sourceKey:srcKey collection:srcCollection];
+		__block int64_t predecessorRowid = 0;
+		__block BOOL found = NO;
+		
+		[self _enumerateEdgesWithName:edgeName
+		               destinationKey:current.key
+		                   collection:current.collection
+		                   usingBlock:^(YapDatabaseRelationshipEdge *edge, BOOL *stop)
+		{
+			if (![self lookupEdgeSourceRowid:edge isDeleted:NULL]) return;
+			
+			if ([depths[@(edge->sourceRowid)] unsignedIntegerValue] == (depth - 1))
+			{
+				predecessorRowid = edge->sourceRowid;
+				found = YES;
+				*stop = YES;
+			}
+		}];
+		
+		if (!found) return nil;
+		
+		current = [databaseTransaction collectionKeyForRowid:predecessorRowid];
+		if (current == nil) return nil;
+		
+		[path addObject:current];
 	}
 	
-	__block NSUInteger count = 0;
-	[self _enumerateEdgesWithName:name
-	                    sourceKey:srcKey
-	                   collection:srcCollection
-	           destinationFileURL:dstFileURL
-	                   usingBlock:^(YapDatabaseRelationshipEdge __unused *edge, BOOL __unused *stop)
-	{
-		count++;
-	}];
+	[path addObject:YapCollectionKeyCreate(srcCollection, srcKey)];
 	
-	return count;
+	return [[path reverseObjectEnumerator] allObjects];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -39,12 +39,17 @@ static NSString *const changeset_key_query = @"query";
 	
 	NSString *query;
 	BOOL queryChanged;
+	
+	NSString *completedQuery;
 }
 
 - (NSString *)query;
 - (void)getQuery:(NSString **)queryPtr wasChanged:(BOOL *)wasChangedPtr;
 - (void)setQuery:(NSString *)newQuery isChange:(BOOL)isChange;
 
+- (NSString *)completedQuery;
+- (void)setCompletedQuery:(NSString *)query;
+
 @end
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
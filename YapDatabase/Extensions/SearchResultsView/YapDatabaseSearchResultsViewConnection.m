@@ -82,6 +82,7 @@
 	
 	query = nil;
 	queryChanged = NO;
+	completedQuery = nil;
 }
 
 - (NSArray *)internalChangesetKeys
@@ -128,6 +129,9 @@
 	if (changeset_query)
 	{
 		query = [changeset_query copy];
+		
+		// We can't tell whether the search that produced the view completed (vs. being aborted).
+		completedQuery = nil;
 	}
 }
 
@@ -168,4 +172,24 @@
 	queryChanged = queryChanged || isChange;
 }
 
+/**
+ * The most recent query for which the view is known to contain the complete set of search results.
+ * That is, the search wasn't aborted part-way through (via a YapDatabaseSearchQueue).
+ *
+ * This is used to determine if a new query can be performed by refining the existing results.
+**/
+- (NSString *)completedQuery
+{
+	NSAssert(dispatch_get_specific(databaseConnection->IsOnConnectionQueueKey), @"Expected to be on connectionQueue");
+	
+	return completedQuery;
+}
+
+- (void)setCompletedQuery:(NSString *)newCompletedQuery
+{
+	NSAssert(dispatch_get_specific(databaseConnection->IsOnConnectionQueueKey), @"Expected to be on connectionQueue");
+	
+	completedQuery = [newCompletedQuery copy];
+}
+
 @end
@@ -29,6 +29,13 @@ NS_ASSUME_NONNULL_BEGIN
  * This method will run the given query on the parent FTS extension,
  * and then properly pipe the results into the view.
  * 
+ * If the new query only narrows the previous query, then the existing search results are filtered,
+ * rather than searching the full index & rebuilding the view. This applies when terms are added
+ * (e.g. "apple" => "apple pie"), or when a prefix term is extended (e.g. "app*" => "appl*" or "apple").
+ * Any other change (or a query using phrases, OR/NOT/NEAR, etc) performs a full search.
+ * Prefix extension isn't considered a refinement when the FTS extension uses the porter tokenizer,
+ * as stemming can cause the longer term to match rows the shorter prefix didn't.
+ * 
  * @see performSearchWithQueue:
  */
 - (void)performSearchFor:(NSString *)query;
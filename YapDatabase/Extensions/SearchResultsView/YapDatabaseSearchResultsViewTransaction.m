@@ -29,6 +29,16 @@
 static NSString *const ext_key_subclassVersion = @"searchResultViewClassVersion";
 static NSString *const ext_key_query           = @"query";
 
+/**
+ * When refining the search results, if the view contains at most this many rows,
+ * then each row is checked against the new query individually.
+ * Otherwise the new query is run against the FTS index (but the view still only needs to remove rows).
+ *
+ * Each individual check is itself an FTS query (the query is parsed, and the doclist of every term is loaded),
+ * restricted to a single rowid. So it only beats a single query for a handful of rows.
+**/
+static NSUInteger const kMaxRowsForIndividualMatching = 16;
+
 
 @implementation YapDatabaseSearchResultsViewTransaction
 {
@@ -1494,6 +1504,257 @@ static NSString *const ext_key_query           = @"query";
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Query Refinement
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Splits a query into its terms, if it's a "simple" query.
+ * That is, a list of terms (implicitly AND'ed together), where each term is alphanumeric,
+ * with an optional trailing '*' for a prefix query.
+ *
+ * Returns nil for anything more complicated (phrases, OR/NOT/NEAR, column filters, parentheses, etc).
+**/
+static NSArray<NSString *> *YDBSimpleQueryTerms(NSString *query)
+{
+	static NSCharacterSet *invalidCharacters;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		
+		NSMutableCharacterSet *validCharacters = [[NSCharacterSet alphanumericCharacterSet] mutableCopy];
+		[validCharacters addCharactersInString:@"*"];
+		
+		invalidCharacters = [validCharacters invertedSet];
+	});
+	
+	NSMutableArray<NSString *> *terms = [NSMutableArray array];
+	
+	for (NSString *term in [query componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceCharacterSet]])
+	{
+		if ([term length] == 0) continue;
+		
+		if ([term rangeOfCharacterFromSet:invalidCharacters].location != NSNotFound) {
+			return nil;
+		}
+		
+		NSRange star = [term rangeOfString:@"*"];
+		if (star.location != NSNotFound && (star.location == 0 || star.location != ([term length] - 1))) {
+			return nil;
+		}
+		
+		if ([term isEqualToString:@"AND"] ||
+		    [term isEqualToString:@"OR"]  ||
+		    [term isEqualToString:@"NOT"] ||
+		    [term isEqualToString:@"NEAR"])
+		{
+			return nil;
+		}
+		
+		[terms addObject:term];
+	}
+	
+	return ([terms count] > 0) ? terms : nil;
+}
+
+/**
+ * Returns YES if every row that matches the new query is guaranteed to also match the old query.
+ *
+ * This is the case if every term in the old query is also in the new query (i.e. terms were added),
+ * or if an old prefix term was extended (e.g. "app*" => "appl*" or "apple").
+ *
+ * The latter doesn't hold for stemming tokenizers (e.g. porter stems "hopeful" to "hope",
+ * which doesn't match "hopefu*"), so prefix extension is only allowed if allowPrefixExtension is YES.
+**/
+static BOOL YDBQueryIsRefinement(NSString *oldQuery, NSString *newQuery, BOOL allowPrefixExtension)
+{
+	if (oldQuery == nil || newQuery == nil) return NO;
+	
+	NSArray<NSString *> *oldTerms = YDBSimpleQueryTerms(oldQuery);
+	NSArray<NSString *> *newTerms = YDBSimpleQueryTerms(newQuery);
+	
+	if (oldTerms == nil || newTerms == nil) return NO;
+	
+	for (NSString *oldTerm in oldTerms)
+	{
+		BOOL found = NO;
+		
+		if ([newTerms containsObject:oldTerm])
+		{
+			found = YES;
+		}
+		else if (allowPrefixExtension && [oldTerm hasSuffix:@"*"])
+		{
+			NSString *oldPrefix = [oldTerm substringToIndex:([oldTerm length] - 1)];
+			
+			for (NSString *newTerm in newTerms)
+			{
+				if ([newTerm hasPrefix:oldPrefix]) {
+					found = YES;
+					break;
+				}
+			}
+		}
+		
+		if (!found) return NO;
+	}
+	
+	return YES;
+}
+
+/**
+ * Returns YES if the new query can be performed by refining the current search results (removing rows),
+ * rather than re-running the search from scratch.
+**/
+- (BOOL)canRefineSearchResultsForQuery:(NSString *)newQuery
+{
+	__unsafe_unretained YapDatabaseSearchResultsViewConnection *searchResultsViewConnection =
+	  (YapDatabaseSearchResultsViewConnection *)parentConnection;
+	
+	__unsafe_unretained YapDatabaseSearchResultsView *searchResultsView =
+	  (YapDatabaseSearchResultsView *)parentConnection->parent;
+	
+	NSString *oldQuery = [searchResultsViewConnection completedQuery];
+	if (oldQuery == nil) return NO;
+	
+	YapDatabaseFullTextSearchTransaction *ftsTransaction =
+	  (YapDatabaseFullTextSearchTransaction *)[databaseTransaction ext:searchResultsView->fullTextSearchName];
+	
+	if (ftsTransaction == nil || ftsTransaction.isPartialIndex) {
+		return NO;
+	}
+	
+	__unsafe_unretained YapDatabaseFullTextSearch *fts =
+	  (YapDatabaseFullTextSearch *)ftsTransaction.extensionConnection.extension;
+	
+	NSString *tokenize = [fts->options objectForKey:@"tokenize"];
+	BOOL allowPrefixExtension = ([tokenize rangeOfString:@"porter" options:NSCaseInsensitiveSearch].location == NSNotFound);
+	
+	return YDBQueryIsRefinement(oldQuery, newQuery, allowPrefixExtension);
+}
+
+/**
+ * Updates the view by removing any rows that don't match the new query.
+ * Only use this method if canRefineSearchResultsForQuery returned YES.
+ *
+ * Since every row that matches the new query also matched the previous query,
+ * there's nothing to insert, and there's no need to enumerate the parentView (or the FTS matches) to find new rows.
+**/
+- (void)refineSearchResults
+{
+	YDBLogAutoTrace();
+	
+	if ([searchQueue shouldAbortSearchInProgressAndRollback:NULL]) {
+		return;
+	}
+	
+	__unsafe_unretained YapDatabaseSearchResultsView *searchResultsView =
+	  (YapDatabaseSearchResultsView *)parentConnection->parent;
+	
+	__unsafe_unretained YapDatabaseSearchResultsViewOptions *searchResultsOptions =
+	  (YapDatabaseSearchResultsViewOptions *)searchResultsView->options;
+	
+	YapDatabaseFullTextSearchTransaction *ftsTransaction =
+	  (YapDatabaseFullTextSearchTransaction *)[databaseTransaction ext:searchResultsView->fullTextSearchName];
+	
+	BOOL hasSnippetOptions = (searchResultsOptions.snippetOptions != nil);
+	
+	NSString *query = [self query];
+	
+	// For a very small view, checking each row individually is cheaper than running the query against the full index.
+	
+	BOOL matchIndividually = ([self numberOfItemsInAllGroups] <= kMaxRowsForIndividualMatching);
+	
+	if (!matchIndividually)
+	{
+		[self repopulateFtsRowids];
+		
+		if ([searchQueue shouldAbortSearchInProgressAndRollback:NULL]) {
+			return;
+		}
+	}
+	
+	NSArray *allGroups = [self allGroups];
+	__block int processed = 0;
+	
+	for (NSString *group in allGroups)
+	{
+		__block NSUInteger groupCount = [self numberOfItemsInGroup:group];
+		__block NSRange range = NSMakeRange(0, groupCount);
+		__block BOOL done;
+		do
+		{
+			done = YES;
+			
+			[self enumerateRowidsInGroup:group
+			                 withOptions:0
+			                       range:range
+			                  usingBlock:^(int64_t rowid, NSUInteger index, BOOL *stop)
+			{
+			#pragma clang diagnostic push
+			#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+				
+				BOOL matches;
+				if (matchIndividually)
+					matches = [ftsTransaction rowid:rowid matches:query];
+				else
+					matches = YapRowidSetContains(ftsRowids, rowid);
+				
+				if (matches)
+				{
+					// The row was previously in the view (in old search results),
+					// and is still in the view (in new search results).
+					
+					if (hasSnippetOptions)
+					{
+						YapDatabaseViewChangesBitMask flags = YapDatabaseViewChangedSnippets;
+						
+						[parentConnection->changes addObject:
+						  [YapDatabaseViewRowChange updateCollectionKey:nil
+						                                        inGroup:group
+						                                        atIndex:index
+						                                    withChanges:flags]];
+					}
+				}
+				else
+				{
+					// The row was previously in the view (in old search results),
+					// but is no longer in the view (not in new search results).
+					
+					YapCollectionKey *ck = [databaseTransaction collectionKeyForRowid:rowid];
+					
+					[self removeRowid:rowid collectionKey:ck atIndex:index inGroup:group];
+					*stop = YES;
+					
+					groupCount--;
+					
+					range.location = index;
+					range.length = groupCount - index;
+					
+					if (range.length > 0){
+						done = NO;
+					}
+				}
+				
+				if (++processed == 500)
+				{
+					processed = 0;
+					if ([searchQueue shouldAbortSearchInProgressAndRollback:NULL]) {
+						*stop = YES;
+						done = YES;
+					}
+				}
+				
+			#pragma clang diagnostic pop
+			}];
+			
+		} while (!done);
+		
+		if ([searchQueue shouldAbortSearchInProgressAndRollback:NULL]) {
+			return;
+		}
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Searching
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1878,6 +2139,9 @@ static NSString *const ext_key_query           = @"query";
  * This method will run the given query on the parent FTS extension,
  * and then properly pipe the results into the view.
  *
+ * If the new query only narrows the previous query (e.g. "app*" => "apple*", or "apple" => "apple pie"),
+ * then the existing search results are filtered instead.
+ *
  * @see performSearchWithQueue:
 **/
 - (void)performSearchFor:(NSString *)query
@@ -1890,26 +2154,44 @@ static NSString *const ext_key_query           = @"query";
 		return;
 	}
 	
-	// Update stored query
-	
 	__unsafe_unretained YapDatabaseSearchResultsViewConnection *searchResultsViewConnection =
 	  (YapDatabaseSearchResultsViewConnection *)parentConnection;
 	
-	[searchResultsViewConnection setQuery:query isChange:YES];
-	
-	// Run the query against the FTS extension, and populate the ftsRowids & snippets ivars
-	
-	[self repopulateFtsRowids];
+	BOOL isRefinement = [self canRefineSearchResultsForQuery:query];
 	
-	// Update the view (using FTS results stored in ftsRowids)
+	// Update stored query
 	
-	__unsafe_unretained YapDatabaseSearchResultsView *searchResultsView =
-	  (YapDatabaseSearchResultsView *)parentConnection->parent;
+	[searchResultsViewConnection setQuery:query isChange:YES];
+	[searchResultsViewConnection setCompletedQuery:nil];
 	
-	if (searchResultsView->parentViewName)
-		[self updateViewFromParent];
+	if (isRefinement)
+	{
+		// Every row matching the new query is already in the view.
+		// So we only need to remove the rows that no longer match.
+		
+		[self refineSearchResults];
+	}
 	else
-		[self updateViewUsingBlocks];
+	{
+		// Run the query against the FTS extension, and populate the ftsRowids & snippets ivars
+		
+		[self repopulateFtsRowids];
+		
+		// Update the view (using FTS results stored in ftsRowids)
+		
+		__unsafe_unretained YapDatabaseSearchResultsView *searchResultsView =
+		  (YapDatabaseSearchResultsView *)parentConnection->parent;
+		
+		if (searchResultsView->parentViewName)
+			[self updateViewFromParent];
+		else
+			[self updateViewUsingBlocks];
+	}
+	
+	if (![searchQueue shouldAbortSearchInProgressAndRollback:NULL])
+	{
+		[searchResultsViewConnection setCompletedQuery:query];
+	}
 }
 
 /**
@@ -0,0 +1,91 @@
+#import <Foundation/Foundation.h>
+
+#import "YapDatabaseSecondaryIndexSetup.h"
+#import "YapDatabaseQuery.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * The storage for a non-persistent secondary index (YapDatabaseSecondaryIndexOptions.isPersistent == NO).
+ *
+ * The store holds the column values of every row (grouped into pages by rowid),
+ * along with a sorted index for every indexed column.
+ * Each sorted index is a list of small sorted chunks (essentially a two-level B+tree),
+ * which allows for equality lookups, range scans & ordered scans without touching sqlite.
+ *
+ * A store is either mutable or immutable.
+ * Copies share their underlying storage (copy-on-write), and a mutable store only duplicates
+ * the pages & chunks it actually modifies. So taking an immutable copy is a cheap snapshot,
+ * which is what gets stored in the extension's YapMemoryTable (and thus gets snapshot isolation for free).
+ *
+ * Immutable stores are thread-safe. Mutable stores are NOT.
+ * A mutable store is owned by a YapDatabaseSecondaryIndexConnection,
+ * and only accessed within the connection's readWriteTransaction.
+ */
+@interface YapDatabaseSecondaryIndexMemoryStore : NSObject <NSCopying, NSMutableCopying>
+
+/**
+ * Creates an empty (mutable) store for the given setup.
+ */
+- (instancetype)initWithSetup:(YapDatabaseSecondaryIndexSetup *)setup;
+
+@property (nonatomic, readonly) BOOL isImmutable;
+
+/**
+ * The number of rows in the store.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+#pragma mark Mutation
+
+/**
+ * Applies a batch of changes.
+ * The dictionary maps rowid to either a dictionary of column values, or NSNull (to remove the row).
+ *
+ * The sorted indexes are updated in parallel (one column per thread) for large batches.
+ */
+- (void)applyChanges:(NSDictionary<NSNumber*, id> *)changes;
+
+- (void)removeAllRowids;
+
+/**
+ * Between these calls, applyChanges only updates the rows.
+ * The sorted indexes are then built from scratch (in parallel) by endBulkLoad.
+ * Used when populating the extension.
+ */
+- (void)beginBulkLoad;
+- (void)endBulkLoad;
+
+#pragma mark Queries
+
+/**
+ * Enumerates the rowids matching the given query (honoring ORDER BY, LIMIT & OFFSET).
+ * If a column is given, its value (for the matching row) is passed to the block as well.
+ *
+ * Returns NO if the query isn't supported by the in-memory engine (the error is logged).
+ *
+ * If the block may modify the store, then enumerate an immutable copy instead.
+ */
+- (BOOL)enumerateRowidsMatchingQuery:(YapDatabaseQuery *)query
+                  withValuesInColumn:(nullable NSString *)column
+                          usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, id _Nullable value, BOOL *stop))block;
+
+/**
+ * Counts the rows matching the given query (ignoring ORDER BY, LIMIT & OFFSET, just like "SELECT COUNT(*)").
+ */
+- (BOOL)getNumberOfRows:(NSUInteger *)countPtr matchingQuery:(YapDatabaseQuery *)query;
+
+/**
+ * Supports count, min, max, sum, total & avg of a single column (or count(*)).
+ * Returns NSNull if the result is NULL, and nil if the query isn't supported.
+ */
+- (nullable id)performAggregateQuery:(YapDatabaseQuery *)query;
+
+/**
+ * Describes how the query would be executed (the in-memory counterpart of EXPLAIN QUERY PLAN).
+ */
+- (nullable NSString *)queryPlanForQuery:(YapDatabaseQuery *)query;
+
+@end
+
+NS_ASSUME_NONNULL_END
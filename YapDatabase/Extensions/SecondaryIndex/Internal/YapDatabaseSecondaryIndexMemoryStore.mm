@@ -0,0 +1,1850 @@
+#import "YapDatabaseSecondaryIndexMemoryStore.h"
+#import "YapDatabaseLogging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if ! __has_feature(objc_arc)
+#warning This file must be compiled with ARC. Use -fobjc-arc flag (or convert project to ARC).
+#endif
+
+/**
+ * Define log level for this file: OFF, ERROR, WARN, INFO, VERBOSE
+ * See YapDatabaseLogging.h for more information.
+**/
+#if DEBUG
+  static const int ydbLogLevel = YDBLogLevelWarning;
+#else
+  static const int ydbLogLevel = YDBLogLevelWarning;
+#endif
+#pragma unused(ydbLogLevel)
+
+/**
+ * The sorted indexes are stored as a list of chunks.
+ * A chunk is split once it grows beyond twice this size,
+ * and merged into its neighbor once it shrinks below a quarter of this size.
+**/
+static const size_t kChunkSize = 256;
+
+/**
+ * Rows are grouped into pages (rowid >> kRowPageShift),
+ * so a write only duplicates the page it touches (if that page is shared with a snapshot).
+**/
+static const int kRowPageShift = 8;
+
+/**
+ * Batches of at least this many changes update the sorted indexes in parallel (one column per thread).
+**/
+static const size_t kMinParallelChanges = 256;
+
+/**
+ * Storage classes, ordered the same way sqlite orders values of different storage classes.
+**/
+enum YDBSIValueType : uint8_t {
+	YDBSIValueTypeNull = 0,
+	YDBSIValueTypeNumeric,
+	YDBSIValueTypeText,
+	YDBSIValueTypeBlob
+};
+
+struct YDBSIValue {
+	YDBSIValueType type;
+	bool isReal;
+	int64_t i;
+	double d;
+	std::string bytes; // text (utf8) or blob
+
+	YDBSIValue() : type(YDBSIValueTypeNull), isReal(false), i(0), d(0) {}
+};
+
+struct YDBSIEntry {
+	YDBSIValue value;
+	int64_t rowid;
+
+	YDBSIEntry(const YDBSIValue &inValue, int64_t inRowid) : value(inValue), rowid(inRowid) {}
+};
+
+struct YDBSIColumnInfo {
+	YapDatabaseSecondaryIndexType type;
+	bool indexed;
+};
+
+typedef std::vector<YDBSIValue> YDBSIRow;                               // values, in setup order
+typedef std::map<int64_t, YDBSIRow> YDBSIRowPage;                        // rowid -> row
+typedef std::map<int64_t, std::shared_ptr<YDBSIRowPage>> YDBSIRows;      // (rowid >> kRowPageShift) -> page
+
+typedef std::vector<YDBSIEntry> YDBSIChunk;
+typedef std::vector<std::shared_ptr<YDBSIChunk>> YDBSIColumnIndex;       // sorted by (value, rowid), no empty chunks
+
+struct YDBSIStoreData {
+	std::vector<YDBSIColumnInfo> columns;
+	YDBSIRows rows;
+	size_t rowCount;
+	std::vector<std::shared_ptr<YDBSIColumnIndex>> indexes;              // nullptr for non-indexed columns
+
+	YDBSIStoreData() : rowCount(0) {}
+};
+
+struct YDBSIPosition {
+	size_t chunk;
+	size_t offset;
+};
+
+typedef std::pair<YDBSIPosition, YDBSIPosition> YDBSIRange;              // [begin, end)
+
+enum YDBSIOperator {
+	YDBSIOperatorEq,
+	YDBSIOperatorNe,
+	YDBSIOperatorLt,
+	YDBSIOperatorLe,
+	YDBSIOperatorGt,
+	YDBSIOperatorGe,
+	YDBSIOperatorIn,
+	YDBSIOperatorNotIn,
+	YDBSIOperatorBetween,
+	YDBSIOperatorIsNull,
+	YDBSIOperatorIsNotNull
+};
+
+struct YDBSITerm {
+	size_t column;
+	YDBSIOperator op;
+	std::vector<YDBSIValue> operands;
+};
+
+struct YDBSIQuery {
+	std::vector<YDBSITerm> terms;
+	bool hasOrder;
+	size_t orderColumn;
+	bool descending;
+	int64_t limit;  // negative == no limit
+	int64_t offset;
+
+	YDBSIQuery() : hasOrder(false), orderColumn(0), descending(false), limit(-1), offset(0) {}
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Values
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int YDBSICompare(const YDBSIValue &a, const YDBSIValue &b)
+{
+	if (a.type != b.type) return (a.type < b.type) ? -1 : 1;
+
+	switch (a.type)
+	{
+		case YDBSIValueTypeNull:
+		{
+			return 0;
+		}
+		case YDBSIValueTypeNumeric:
+		{
+			if (!a.isReal && !b.isReal) {
+				return (a.i < b.i) ? -1 : ((a.i > b.i) ? 1 : 0);
+			}
+
+			double x = a.isReal ? a.d : (double)a.i;
+			double y = b.isReal ? b.d : (double)b.i;
+
+			return (x < y) ? -1 : ((x > y) ? 1 : 0);
+		}
+		default:
+		{
+			// Equivalent to memcmp, which is what sqlite's BINARY collation uses
+			int cmp = a.bytes.compare(b.bytes);
+			return (cmp < 0) ? -1 : ((cmp > 0) ? 1 : 0);
+		}
+	}
+}
+
+static bool YDBSIEntryLess(const YDBSIEntry &a, const YDBSIEntry &b)
+{
+	int cmp = YDBSICompare(a.value, b.value);
+	if (cmp != 0) return (cmp < 0);
+
+	return (a.rowid < b.rowid);
+}
+
+static bool YDBSIRowsEqual(const YDBSIRow &a, const YDBSIRow &b)
+{
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].type != b[i].type) return false;
+		if (a[i].isReal != b[i].isReal) return false;
+		if (YDBSICompare(a[i], b[i]) != 0) return false;
+	}
+	return true;
+}
+
+static YDBSIValue YDBSIIntegerValue(int64_t i)
+{
+	YDBSIValue value;
+	value.type = YDBSIValueTypeNumeric;
+	value.i = i;
+	return value;
+}
+
+static YDBSIValue YDBSIRealValue(double d)
+{
+	YDBSIValue value;
+	if (!std::isnan(d)) // sqlite stores NaN as NULL
+	{
+		value.type = YDBSIValueTypeNumeric;
+		value.isReal = true;
+		value.d = d;
+	}
+	return value;
+}
+
+static YDBSIValue YDBSITextValue(NSString *string)
+{
+	YDBSIValue value;
+	value.type = YDBSIValueTypeText;
+	value.bytes = std::string([string UTF8String] ?: "");
+	return value;
+}
+
+/**
+ * Converts the given object, using the same rules as bindValue:forColumn:... & bindQueryParameters:...
+ * (NSNumber, NSDate & NSString). Anything else is NULL.
+**/
+static YDBSIValue YDBSIValueFromObject(id object)
+{
+	if ([object isKindOfClass:[NSNumber class]])
+	{
+		__unsafe_unretained NSNumber *number = (NSNumber *)object;
+
+		CFNumberType numberType = CFNumberGetType((CFNumberRef)number);
+
+		if (numberType == kCFNumberFloat32Type ||
+		    numberType == kCFNumberFloat64Type ||
+		    numberType == kCFNumberFloatType   ||
+		    numberType == kCFNumberDoubleType  ||
+		    numberType == kCFNumberCGFloatType  )
+		{
+			return YDBSIRealValue([number doubleValue]);
+		}
+		else
+		{
+			return YDBSIIntegerValue([number longLongValue]);
+		}
+	}
+	else if ([object isKindOfClass:[NSDate class]])
+	{
+		return YDBSIRealValue([(NSDate *)object timeIntervalSinceReferenceDate]);
+	}
+	else if ([object isKindOfClass:[NSString class]])
+	{
+		return YDBSITextValue((NSString *)object);
+	}
+
+	return YDBSIValue();
+}
+
+static id YDBSIObjectFromValue(const YDBSIValue &value)
+{
+	switch (value.type)
+	{
+		case YDBSIValueTypeNumeric :
+			return value.isReal ? @(value.d) : @(value.i);
+		case YDBSIValueTypeText    :
+			return [[NSString alloc] initWithBytes:value.bytes.data()
+			                                length:value.bytes.size()
+			                              encoding:NSUTF8StringEncoding];
+		case YDBSIValueTypeBlob    :
+			return [NSData dataWithBytes:value.bytes.data() length:value.bytes.size()];
+		default                    :
+			return nil;
+	}
+}
+
+/**
+ * Parses text that looks like a number (which is what sqlite does when applying numeric affinity).
+**/
+static bool YDBSIParseNumber(const std::string &text, YDBSIValue *outValue)
+{
+	size_t first = text.find_first_not_of(" \t\n\r");
+	if (first == std::string::npos) return false;
+
+	size_t last = text.find_last_not_of(" \t\n\r");
+	std::string trimmed = text.substr(first, last - first + 1);
+
+	if (trimmed.find_first_not_of("0123456789+-.eE") != std::string::npos) return false;
+
+	const char *start = trimmed.c_str();
+	char *end = NULL;
+
+	errno = 0;
+	long long i = strtoll(start, &end, 10);
+	if (end != start && *end == '\0' && errno == 0)
+	{
+		*outValue = YDBSIIntegerValue((int64_t)i);
+		return true;
+	}
+
+	double d = strtod(start, &end);
+	if (end != start && *end == '\0')
+	{
+		*outValue = YDBSIRealValue(d);
+		return true;
+	}
+
+	return false;
+}
+
+static std::string YDBSINumberToText(const YDBSIValue &value)
+{
+	char buffer[64];
+
+	if (!value.isReal)
+	{
+		snprintf(buffer, sizeof(buffer), "%lld", (long long)value.i);
+		return std::string(buffer);
+	}
+
+	snprintf(buffer, sizeof(buffer), "%.15g", value.d);
+
+	std::string text(buffer);
+	if (text.find_first_not_of("-0123456789") == std::string::npos) {
+		text.append(".0"); // sqlite renders 3.0 as "3.0"
+	}
+	return text;
+}
+
+/**
+ * Applies the column's affinity (https://www.sqlite.org/datatype3.html),
+ * both to stored values & to the operands they're compared against.
+**/
+static void YDBSIApplyAffinity(YDBSIValue &value, YapDatabaseSecondaryIndexType type)
+{
+	if (type == YapDatabaseSecondaryIndexTypeBlob) return;
+
+	if (type == YapDatabaseSecondaryIndexTypeText)
+	{
+		if (value.type == YDBSIValueTypeNumeric)
+		{
+			value.bytes = YDBSINumberToText(value);
+			value.type = YDBSIValueTypeText;
+		}
+		return;
+	}
+
+	// Integer, Real & Numeric
+
+	if (value.type == YDBSIValueTypeText)
+	{
+		YDBSIValue number;
+		if (YDBSIParseNumber(value.bytes, &number)) {
+			value = number;
+		}
+	}
+
+	if (value.type == YDBSIValueTypeNumeric)
+	{
+		if (type == YapDatabaseSecondaryIndexTypeReal)
+		{
+			if (!value.isReal) {
+				value.d = (double)value.i;
+				value.isReal = true;
+			}
+		}
+		else if (value.isReal)
+		{
+			if (value.d >= -9.2e18 && value.d <= 9.2e18 && value.d == (double)(int64_t)value.d)
+			{
+				value.i = (int64_t)value.d;
+				value.isReal = false;
+			}
+		}
+	}
+}
+
+/**
+ * Converts a value from the secondaryIndexBlock into its stored form.
+ * Just like the sqlite table, a column only accepts the class(es) it can bind (anything else is stored as NULL).
+**/
+static YDBSIValue YDBSIStoredValue(id object, NSString *columnName, const YDBSIColumnInfo &column)
+{
+	if (object == nil || object == [NSNull null]) return YDBSIValue();
+
+	BOOL supported = NO;
+	YDBSIValue value;
+
+	switch (column.type)
+	{
+		case YapDatabaseSecondaryIndexTypeText :
+		{
+			if ([object isKindOfClass:[NSString class]])
+			{
+				value = YDBSITextValue((NSString *)object);
+				supported = YES;
+			}
+			break;
+		}
+		case YapDatabaseSecondaryIndexTypeBlob :
+		{
+			if ([object isKindOfClass:[NSData class]])
+			{
+				__unsafe_unretained NSData *data = (NSData *)object;
+
+				if ([data length] > 0)
+				{
+					value.type = YDBSIValueTypeBlob;
+					value.bytes = std::string((const char *)[data bytes], [data length]);
+				}
+				supported = YES;
+			}
+			break;
+		}
+		default :
+		{
+			if ([object isKindOfClass:[NSNumber class]] || [object isKindOfClass:[NSDate class]])
+			{
+				value = YDBSIValueFromObject(object);
+				supported = YES;
+			}
+			break;
+		}
+	}
+
+	if (!supported)
+	{
+		YDBLogWarn(@"Unable to store value for column(name=%@, type=%@) with unsupported class: %@",
+		           columnName,
+		           NSStringFromYapDatabaseSecondaryIndexType(column.type),
+		           NSStringFromClass([object class]));
+	}
+
+	YDBSIApplyAffinity(value, column.type);
+	return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Rows
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static const YDBSIRow* YDBSIFindRow(const YDBSIRows &rows, int64_t rowid)
+{
+	auto page = rows.find(rowid >> kRowPageShift);
+	if (page == rows.end()) return NULL;
+
+	auto row = page->second->find(rowid);
+	if (row == page->second->end()) return NULL;
+
+	return &row->second;
+}
+
+/**
+ * Returns the page for the given rowid, creating it (or duplicating it, if shared with a snapshot) as needed.
+**/
+static YDBSIRowPage& YDBSIMutablePage(YDBSIRows &rows, int64_t rowid)
+{
+	std::shared_ptr<YDBSIRowPage> &page = rows[rowid >> kRowPageShift];
+
+	if (!page)
+		page = std::make_shared<YDBSIRowPage>();
+	else if (page.use_count() > 1)
+		page = std::make_shared<YDBSIRowPage>(*page);
+	else
+		std::atomic_thread_fence(std::memory_order_acquire); // pairs with the release of the last snapshot
+
+	return *page;
+}
+
+template <typename Fn> // bool fn(int64_t rowid, const YDBSIRow &row), return false to stop
+static bool YDBSIEnumerateRows(const YDBSIRows &rows, Fn fn)
+{
+	for (auto page = rows.begin(); page != rows.end(); ++page)
+	{
+		for (auto row = page->second->begin(); row != page->second->end(); ++row)
+		{
+			if (!fn(row->first, row->second)) return false;
+		}
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Sorted Indexes
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns the position of the first entry for which isBefore(entry) is false.
+ * Or {index.size(), 0} if there is no such entry.
+**/
+template <typename IsBefore>
+static YDBSIPosition YDBSILowerBound(const YDBSIColumnIndex &index, IsBefore isBefore)
+{
+	auto chunk = std::partition_point(index.begin(), index.end(), [&](const std::shared_ptr<YDBSIChunk> &c) {
+		return isBefore(c->back());
+	});
+
+	if (chunk == index.end()) {
+		return { index.size(), 0 };
+	}
+
+	auto entry = std::partition_point((*chunk)->begin(), (*chunk)->end(), isBefore);
+
+	return { (size_t)(chunk - index.begin()), (size_t)(entry - (*chunk)->begin()) };
+}
+
+static YDBSIPosition YDBSIFirstPositionNotLess(const YDBSIColumnIndex &index, const YDBSIValue &value)
+{
+	return YDBSILowerBound(index, [&](const YDBSIEntry &e) { return YDBSICompare(e.value, value) < 0; });
+}
+
+static YDBSIPosition YDBSIFirstPositionGreater(const YDBSIColumnIndex &index, const YDBSIValue &value)
+{
+	return YDBSILowerBound(index, [&](const YDBSIEntry &e) { return YDBSICompare(e.value, value) <= 0; });
+}
+
+static bool YDBSIPositionLess(const YDBSIPosition &a, const YDBSIPosition &b)
+{
+	return (a.chunk < b.chunk) || (a.chunk == b.chunk && a.offset < b.offset);
+}
+
+template <typename Fn> // bool fn(const YDBSIEntry &entry), return false to stop
+static bool YDBSIEnumerateRange(const YDBSIColumnIndex &index, const YDBSIRange &range, bool reverse, Fn fn)
+{
+	if (!reverse)
+	{
+		YDBSIPosition pos = range.first;
+		while (YDBSIPositionLess(pos, range.second))
+		{
+			const YDBSIChunk &chunk = *index[pos.chunk];
+
+			if (!fn(chunk[pos.offset])) return false;
+
+			if (++pos.offset >= chunk.size()) {
+				pos.chunk++;
+				pos.offset = 0;
+			}
+		}
+	}
+	else
+	{
+		YDBSIPosition pos = range.second;
+		while (YDBSIPositionLess(range.first, pos))
+		{
+			if (pos.offset == 0) {
+				pos.chunk--;
+				pos.offset = index[pos.chunk]->size();
+			}
+			pos.offset--;
+
+			if (!fn((*index[pos.chunk])[pos.offset])) return false;
+		}
+	}
+	return true;
+}
+
+static YDBSIColumnIndex& YDBSIMutableIndex(std::shared_ptr<YDBSIColumnIndex> &index)
+{
+	if (index.use_count() > 1)
+		index = std::make_shared<YDBSIColumnIndex>(*index);
+	else
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+	return *index;
+}
+
+static YDBSIChunk& YDBSIMutableChunk(std::shared_ptr<YDBSIChunk> &chunk)
+{
+	if (chunk.use_count() > 1)
+		chunk = std::make_shared<YDBSIChunk>(*chunk);
+	else
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+	return *chunk;
+}
+
+static void YDBSIInsertEntry(YDBSIColumnIndex &index, const YDBSIEntry &entry)
+{
+	if (index.empty())
+	{
+		index.push_back(std::make_shared<YDBSIChunk>(1, entry));
+		return;
+	}
+
+	YDBSIPosition pos = YDBSILowerBound(index, [&](const YDBSIEntry &e) { return YDBSIEntryLess(e, entry); });
+	if (pos.chunk == index.size())
+	{
+		// Goes at the very end
+		pos.chunk = index.size() - 1;
+		pos.offset = index.back()->size();
+	}
+
+	YDBSIChunk &chunk = YDBSIMutableChunk(index[pos.chunk]);
+	chunk.insert(chunk.begin() + pos.offset, entry);
+
+	if (chunk.size() > (2 * kChunkSize))
+	{
+		auto tail = std::make_shared<YDBSIChunk>(chunk.begin() + kChunkSize, chunk.end());
+		chunk.erase(chunk.begin() + kChunkSize, chunk.end());
+
+		index.insert(index.begin() + pos.chunk + 1, tail);
+	}
+}
+
+static void YDBSIRemoveEntry(YDBSIColumnIndex &index, const YDBSIEntry &entry)
+{
+	YDBSIPosition pos = YDBSILowerBound(index, [&](const YDBSIEntry &e) { return YDBSIEntryLess(e, entry); });
+	if (pos.chunk == index.size()) return;
+
+	const YDBSIEntry &found = (*index[pos.chunk])[pos.offset];
+	if (found.rowid != entry.rowid || YDBSICompare(found.value, entry.value) != 0) return;
+
+	YDBSIChunk &chunk = YDBSIMutableChunk(index[pos.chunk]);
+	chunk.erase(chunk.begin() + pos.offset);
+
+	if (chunk.empty())
+	{
+		index.erase(index.begin() + pos.chunk);
+	}
+	else if ((chunk.size() < (kChunkSize / 4)) && (pos.chunk + 1 < index.size()))
+	{
+		const YDBSIChunk &next = *index[pos.chunk + 1];
+		if (chunk.size() + next.size() <= kChunkSize)
+		{
+			chunk.insert(chunk.end(), next.begin(), next.end());
+			index.erase(index.begin() + pos.chunk + 1);
+		}
+	}
+}
+
+static std::shared_ptr<YDBSIColumnIndex> YDBSIBuildIndex(const YDBSIStoreData &data, size_t column)
+{
+	std::vector<YDBSIEntry> entries;
+	entries.reserve(data.rowCount);
+
+	YDBSIEnumerateRows(data.rows, [&](int64_t rowid, const YDBSIRow &row) {
+		entries.emplace_back(row[column], rowid);
+		return true;
+	});
+
+	std::sort(entries.begin(), entries.end(), YDBSIEntryLess);
+
+	auto index = std::make_shared<YDBSIColumnIndex>();
+	index->reserve((entries.size() / kChunkSize) + 1);
+
+	for (size_t i = 0; i < entries.size(); i += kChunkSize)
+	{
+		auto begin = entries.begin() + i;
+		auto end = entries.begin() + std::min(entries.size(), i + kChunkSize);
+
+		index->push_back(std::make_shared<YDBSIChunk>(std::make_move_iterator(begin), std::make_move_iterator(end)));
+	}
+
+	return index;
+}
+
+/**
+ * Performs the given block for each column, concurrently if requested.
+ * The columns are independent of each other, so each one can be built/updated on its own thread.
+**/
+static void YDBSIForEachColumn(size_t columnCount, bool concurrent, void (^block)(size_t column))
+{
+	if (concurrent && columnCount > 1)
+	{
+		dispatch_apply(columnCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), block);
+	}
+	else
+	{
+		for (size_t column = 0; column < columnCount; column++) {
+			block(column);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Parsing
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum YDBSITokenType {
+	YDBSITokenTypeEnd,
+	YDBSITokenTypeIdentifier,
+	YDBSITokenTypeQuotedIdentifier,
+	YDBSITokenTypeString,
+	YDBSITokenTypeNumber,
+	YDBSITokenTypeParameter,
+	YDBSITokenTypeSymbol
+};
+
+struct YDBSIToken {
+	YDBSITokenType type;
+	std::string text;
+};
+
+static bool YDBSITokenize(NSString *string, std::vector<YDBSIToken> &tokens)
+{
+	std::string s([string UTF8String] ?: "");
+	size_t i = 0;
+
+	while (i < s.size())
+	{
+		unsigned char c = (unsigned char)s[i];
+
+		if (isspace(c))
+		{
+			i++;
+		}
+		else if (isalpha(c) || c == '_')
+		{
+			size_t start = i;
+			while (i < s.size() && (isalnum((unsigned char)s[i]) || s[i] == '_')) i++;
+
+			tokens.push_back({ YDBSITokenTypeIdentifier, s.substr(start, i - start) });
+		}
+		else if (isdigit(c) || (c == '.' && i + 1 < s.size() && isdigit((unsigned char)s[i + 1])))
+		{
+			size_t start = i;
+			while (i < s.size() && (isdigit((unsigned char)s[i]) || s[i] == '.')) i++;
+
+			if (i < s.size() && (s[i] == 'e' || s[i] == 'E'))
+			{
+				i++;
+				if (i < s.size() && (s[i] == '+' || s[i] == '-')) i++;
+				while (i < s.size() && isdigit((unsigned char)s[i])) i++;
+			}
+
+			tokens.push_back({ YDBSITokenTypeNumber, s.substr(start, i - start) });
+		}
+		else if (c == '\'' || c == '"' || c == '`' || c == '[')
+		{
+			char close = (c == '[') ? ']' : (char)c;
+			std::string text;
+
+			i++;
+			for (;;)
+			{
+				if (i >= s.size()) return false; // unterminated
+
+				if (s[i] == close)
+				{
+					if (close != ']' && i + 1 < s.size() && s[i + 1] == close) {
+						text.push_back(close); // escaped quote
+						i += 2;
+						continue;
+					}
+					i++;
+					break;
+				}
+				text.push_back(s[i++]);
+			}
+
+			YDBSITokenType type = (c == '\'') ? YDBSITokenTypeString : YDBSITokenTypeQuotedIdentifier;
+			tokens.push_back({ type, text });
+		}
+		else if (c == '?')
+		{
+			tokens.push_back({ YDBSITokenTypeParameter, "?" });
+			i++;
+		}
+		else
+		{
+			static const char *const symbols[] = { "==", "!=", "<>", "<=", ">=", "=", "<", ">", "(", ")", ",", ";", "*", "-" };
+
+			bool found = false;
+			for (const char *symbol : symbols)
+			{
+				size_t length = strlen(symbol);
+				if (s.compare(i, length, symbol) == 0)
+				{
+					tokens.push_back({ YDBSITokenTypeSymbol, symbol });
+					i += length;
+					found = true;
+					break;
+				}
+			}
+
+			if (!found) return false;
+		}
+	}
+
+	tokens.push_back({ YDBSITokenTypeEnd, "" });
+	return true;
+}
+
+/**
+ * A recursive-descent parser for the subset of sqlite supported by the in-memory engine.
+ * (See YapDatabaseSecondaryIndexOptions.isPersistent for the details.)
+**/
+class YDBSIParser
+{
+public:
+
+	YDBSIParser(const std::vector<YDBSIToken> &inTokens,
+	            NSArray *inParameters,
+	            NSDictionary<NSString*, NSNumber*> *inColumnIndexes,
+	            const YDBSIStoreData *inData)
+	  : tokens(inTokens), pos(0), parameters(inParameters), parameterIndex(0),
+	    columnIndexes(inColumnIndexes), data(inData) {}
+
+	bool parseQuery(YDBSIQuery &query)
+	{
+		if (matchKeyword("WHERE"))
+		{
+			do {
+				YDBSITerm term;
+				if (!parseTerm(term)) return false;
+
+				query.terms.push_back(term);
+
+			} while (matchKeyword("AND"));
+		}
+
+		if (matchKeyword("ORDER"))
+		{
+			if (!matchKeyword("BY")) return false;
+			if (!parseColumn(&query.orderColumn)) return false;
+
+			query.hasOrder = true;
+
+			if (matchKeyword("DESC"))
+				query.descending = true;
+			else
+				matchKeyword("ASC");
+		}
+
+		if (matchKeyword("LIMIT"))
+		{
+			int64_t first = 0;
+			if (!parseInteger(&first)) return false;
+
+			if (matchSymbol(","))
+			{
+				// LIMIT offset, limit
+				query.offset = first;
+				if (!parseInteger(&query.limit)) return false;
+			}
+			else
+			{
+				query.limit = first;
+
+				if (matchKeyword("OFFSET")) {
+					if (!parseInteger(&query.offset)) return false;
+				}
+			}
+		}
+
+		matchSymbol(";");
+
+		return (tokens[pos].type == YDBSITokenTypeEnd) && (parameterIndex == [parameters count]);
+	}
+
+	/**
+	 * Parses an aggregate function of the form: name(*) or name(column)
+	**/
+	bool parseAggregate(std::string &function, bool *isStar, size_t *column)
+	{
+		if (tokens[pos].type != YDBSITokenTypeIdentifier) return false;
+
+		function = lowercase(tokens[pos].text);
+		pos++;
+
+		if (!matchSymbol("(")) return false;
+
+		if (matchSymbol("*"))
+			*isStar = true;
+		else if (parseColumn(column))
+			*isStar = false;
+		else
+			return false;
+
+		if (!matchSymbol(")")) return false;
+
+		return (tokens[pos].type == YDBSITokenTypeEnd);
+	}
+
+private:
+
+	const std::vector<YDBSIToken> &tokens;
+	size_t pos;
+
+	__unsafe_unretained NSArray *parameters;
+	NSUInteger parameterIndex;
+
+	__unsafe_unretained NSDictionary<NSString*, NSNumber*> *columnIndexes;
+	const YDBSIStoreData *data;
+
+	static std::string lowercase(const std::string &s)
+	{
+		std::string result(s);
+		std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+		return result;
+	}
+
+	bool matchKeyword(const char *keyword)
+	{
+		const YDBSIToken &token = tokens[pos];
+		if (token.type != YDBSITokenTypeIdentifier) return false;
+		if (strcasecmp(token.text.c_str(), keyword) != 0) return false;
+
+		pos++;
+		return true;
+	}
+
+	bool matchSymbol(const char *symbol)
+	{
+		const YDBSIToken &token = tokens[pos];
+		if (token.type != YDBSITokenTypeSymbol) return false;
+		if (token.text != symbol) return false;
+
+		pos++;
+		return true;
+	}
+
+	bool parseColumn(size_t *column)
+	{
+		const YDBSIToken &token = tokens[pos];
+		if (token.type != YDBSITokenTypeIdentifier && token.type != YDBSITokenTypeQuotedIdentifier) return false;
+
+		NSString *name = [[NSString alloc] initWithBytes:token.text.data()
+		                                          length:token.text.size()
+		                                        encoding:NSUTF8StringEncoding];
+
+		NSNumber *index = [columnIndexes objectForKey:[name lowercaseString]];
+		if (index == nil) return false;
+
+		*column = [index unsignedIntegerValue];
+		pos++;
+		return true;
+	}
+
+	bool parseOperand(YDBSIValue &value)
+	{
+		bool negative = matchSymbol("-");
+		const YDBSIToken &token = tokens[pos];
+
+		if (token.type == YDBSITokenTypeNumber)
+		{
+			if (!YDBSIParseNumber(token.text, &value)) return false;
+
+			if (negative)
+			{
+				if (value.isReal)
+					value.d = -value.d;
+				else
+					value.i = -value.i;
+			}
+		}
+		else if (negative)
+		{
+			return false;
+		}
+		else if (token.type == YDBSITokenTypeParameter)
+		{
+			if (parameterIndex >= [parameters count]) return false;
+
+			id parameter = [parameters objectAtIndex:parameterIndex++];
+
+			if (parameter != [NSNull null] &&
+			    ![parameter isKindOfClass:[NSNumber class]] &&
+			    ![parameter isKindOfClass:[NSDate class]] &&
+			    ![parameter isKindOfClass:[NSString class]])
+			{
+				YDBLogWarn(@"Unable to bind value for with unsupported class: %@", NSStringFromClass([parameter class]));
+			}
+
+			value = YDBSIValueFromObject(parameter);
+		}
+		else if (token.type == YDBSITokenTypeString)
+		{
+			value.type = YDBSIValueTypeText;
+			value.bytes = token.text;
+		}
+		else if (token.type == YDBSITokenTypeIdentifier && strcasecmp(token.text.c_str(), "NULL") == 0)
+		{
+			value = YDBSIValue();
+		}
+		else
+		{
+			return false;
+		}
+
+		pos++;
+		return true;
+	}
+
+	bool parseInteger(int64_t *integer)
+	{
+		YDBSIValue value;
+		if (!parseOperand(value)) return false;
+		if (value.type != YDBSIValueTypeNumeric) return false;
+
+		*integer = value.isReal ? (int64_t)value.d : value.i;
+		return true;
+	}
+
+	bool parseTerm(YDBSITerm &term)
+	{
+		if (!parseColumn(&term.column)) return false;
+
+		static const std::pair<const char*, YDBSIOperator> comparisons[] = {
+			{ "=",  YDBSIOperatorEq }, { "==", YDBSIOperatorEq },
+			{ "!=", YDBSIOperatorNe }, { "<>", YDBSIOperatorNe },
+			{ "<",  YDBSIOperatorLt }, { "<=", YDBSIOperatorLe },
+			{ ">",  YDBSIOperatorGt }, { ">=", YDBSIOperatorGe }
+		};
+
+		bool parsed = false;
+
+		for (const auto &comparison : comparisons)
+		{
+			if (matchSymbol(comparison.first))
+			{
+				term.op = comparison.second;
+				term.operands.resize(1);
+
+				if (!parseOperand(term.operands[0])) return false;
+
+				parsed = true;
+				break;
+			}
+		}
+
+		if (!parsed)
+		{
+			if (matchKeyword("IS"))
+			{
+				term.op = matchKeyword("NOT") ? YDBSIOperatorIsNotNull : YDBSIOperatorIsNull;
+				if (!matchKeyword("NULL")) return false;
+			}
+			else if (matchKeyword("BETWEEN"))
+			{
+				term.op = YDBSIOperatorBetween;
+				term.operands.resize(2);
+
+				if (!parseOperand(term.operands[0])) return false;
+				if (!matchKeyword("AND")) return false;
+				if (!parseOperand(term.operands[1])) return false;
+			}
+			else
+			{
+				term.op = matchKeyword("NOT") ? YDBSIOperatorNotIn : YDBSIOperatorIn;
+
+				if (!matchKeyword("IN")) return false;
+				if (!matchSymbol("(")) return false;
+
+				do {
+					YDBSIValue operand;
+					if (!parseOperand(operand)) return false;
+
+					term.operands.push_back(operand);
+
+				} while (matchSymbol(","));
+
+				if (!matchSymbol(")")) return false;
+			}
+		}
+
+		for (YDBSIValue &operand : term.operands)
+		{
+			YDBSIApplyAffinity(operand, data->columns[term.column].type);
+		}
+
+		return true;
+	}
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Execution
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Follows sqlite's NULL semantics: comparisons involving NULL are never true.
+**/
+static bool YDBSITermMatches(const YDBSITerm &term, const YDBSIValue &value)
+{
+	if (term.op == YDBSIOperatorIsNull) return (value.type == YDBSIValueTypeNull);
+	if (term.op == YDBSIOperatorIsNotNull) return (value.type != YDBSIValueTypeNull);
+
+	if (value.type == YDBSIValueTypeNull) return false;
+
+	switch (term.op)
+	{
+		case YDBSIOperatorIn:
+		{
+			for (const YDBSIValue &operand : term.operands)
+			{
+				if (operand.type != YDBSIValueTypeNull && YDBSICompare(value, operand) == 0) return true;
+			}
+			return false;
+		}
+		case YDBSIOperatorNotIn:
+		{
+			for (const YDBSIValue &operand : term.operands)
+			{
+				if (operand.type == YDBSIValueTypeNull || YDBSICompare(value, operand) == 0) return false;
+			}
+			return true;
+		}
+		case YDBSIOperatorBetween:
+		{
+			const YDBSIValue &low = term.operands[0];
+			const YDBSIValue &high = term.operands[1];
+
+			if (low.type == YDBSIValueTypeNull || high.type == YDBSIValueTypeNull) return false;
+
+			return (YDBSICompare(value, low) >= 0) && (YDBSICompare(value, high) <= 0);
+		}
+		default:
+		{
+			const YDBSIValue &operand = term.operands[0];
+			if (operand.type == YDBSIValueTypeNull) return false;
+
+			int cmp = YDBSICompare(value, operand);
+
+			switch (term.op)
+			{
+				case YDBSIOperatorEq : return (cmp == 0);
+				case YDBSIOperatorNe : return (cmp != 0);
+				case YDBSIOperatorLt : return (cmp <  0);
+				case YDBSIOperatorLe : return (cmp <= 0);
+				case YDBSIOperatorGt : return (cmp >  0);
+				case YDBSIOperatorGe : return (cmp >= 0);
+				default              : return false;
+			}
+		}
+	}
+}
+
+static bool YDBSIRowMatches(const YDBSIQuery &query, const YDBSIRow &row)
+{
+	for (const YDBSITerm &term : query.terms)
+	{
+		if (!YDBSITermMatches(term, row[term.column])) return false;
+	}
+	return true;
+}
+
+/**
+ * Picks the term that's best answered by a sorted index (if any).
+ * Equality beats IN, which beats a bounded range, which beats an open range.
+**/
+static const YDBSITerm* YDBSIChooseTerm(const YDBSIStoreData &data, const YDBSIQuery &query)
+{
+	const YDBSITerm *best = NULL;
+	int bestRank = 0;
+
+	for (const YDBSITerm &term : query.terms)
+	{
+		if (!data.indexes[term.column]) continue;
+
+		int rank = 0;
+		switch (term.op)
+		{
+			case YDBSIOperatorEq      : rank = 5; break;
+			case YDBSIOperatorIn      : rank = 4; break;
+			case YDBSIOperatorBetween : rank = 3; break;
+			case YDBSIOperatorLt      :
+			case YDBSIOperatorLe      :
+			case YDBSIOperatorGt      :
+			case YDBSIOperatorGe      : rank = 2; break;
+			case YDBSIOperatorIsNull  : rank = 1; break;
+			default                   : rank = 0; break;
+		}
+
+		if (rank > bestRank)
+		{
+			best = &term;
+			bestRank = rank;
+		}
+	}
+
+	return best;
+}
+
+/**
+ * Returns the range(s) of the sorted index that satisfy the given term (in ascending order).
+**/
+static std::vector<YDBSIRange> YDBSIRangesForTerm(const YDBSIColumnIndex &index, const YDBSITerm &term)
+{
+	std::vector<YDBSIRange> ranges;
+
+	const YDBSIPosition begin = { 0, 0 };
+	const YDBSIPosition end = { index.size(), 0 };
+	const YDBSIPosition nonNull = YDBSIFirstPositionGreater(index, YDBSIValue());
+
+	switch (term.op)
+	{
+		case YDBSIOperatorIsNull:
+		{
+			ranges.push_back({ begin, nonNull });
+			break;
+		}
+		case YDBSIOperatorIn:
+		{
+			std::vector<YDBSIValue> operands;
+			for (const YDBSIValue &operand : term.operands)
+			{
+				if (operand.type != YDBSIValueTypeNull) operands.push_back(operand);
+			}
+
+			std::sort(operands.begin(), operands.end(), [](const YDBSIValue &a, const YDBSIValue &b) {
+				return YDBSICompare(a, b) < 0;
+			});
+			operands.erase(std::unique(operands.begin(), operands.end(), [](const YDBSIValue &a, const YDBSIValue &b) {
+				return YDBSICompare(a, b) == 0;
+			}), operands.end());
+
+			for (const YDBSIValue &operand : operands)
+			{
+				ranges.push_back({ YDBSIFirstPositionNotLess(index, operand), YDBSIFirstPositionGreater(index, operand) });
+			}
+			break;
+		}
+		case YDBSIOperatorBetween:
+		{
+			const YDBSIValue &low = term.operands[0];
+			const YDBSIValue &high = term.operands[1];
+
+			if (low.type == YDBSIValueTypeNull || high.type == YDBSIValueTypeNull) break;
+			if (YDBSICompare(low, high) > 0) break;
+
+			ranges.push_back({ YDBSIFirstPositionNotLess(index, low), YDBSIFirstPositionGreater(index, high) });
+			break;
+		}
+		default:
+		{
+			const YDBSIValue &operand = term.operands[0];
+			if (operand.type == YDBSIValueTypeNull) break;
+
+			switch (term.op)
+			{
+				case YDBSIOperatorEq :
+					ranges.push_back({ YDBSIFirstPositionNotLess(index, operand),
+					                   YDBSIFirstPositionGreater(index, operand) }); break;
+				case YDBSIOperatorLt :
+					ranges.push_back({ nonNull, YDBSIFirstPositionNotLess(index, operand) }); break;
+				case YDBSIOperatorLe :
+					ranges.push_back({ nonNull, YDBSIFirstPositionGreater(index, operand) }); break;
+				case YDBSIOperatorGt :
+					ranges.push_back({ YDBSIFirstPositionGreater(index, operand), end }); break;
+				case YDBSIOperatorGe :
+					ranges.push_back({ YDBSIFirstPositionNotLess(index, operand), end }); break;
+				default :
+					break;
+			}
+		}
+	}
+
+	return ranges;
+}
+
+enum YDBSIStrategy {
+	YDBSIStrategyScanRows,     // scan every row (in rowid order)
+	YDBSIStrategySearchIndex,  // only visit the range(s) of the sorted index matching the driving term
+	YDBSIStrategyScanIndex     // scan the sorted index of the ORDER BY column
+};
+
+struct YDBSIPlan {
+	YDBSIStrategy strategy;
+	const YDBSITerm *term;     // for YDBSIStrategySearchIndex
+	bool needsSort;            // results must be sorted for ORDER BY
+};
+
+static YDBSIPlan YDBSIMakePlan(const YDBSIStoreData &data, const YDBSIQuery &query, bool ordered)
+{
+	YDBSIPlan plan = { YDBSIStrategyScanRows, NULL, false };
+
+	bool useOrder = ordered && query.hasOrder;
+	bool orderIndexed = useOrder && data.indexes[query.orderColumn];
+
+	plan.term = YDBSIChooseTerm(data, query);
+
+	if (plan.term)
+	{
+		plan.strategy = YDBSIStrategySearchIndex;
+		plan.needsSort = useOrder && (plan.term->column != query.orderColumn);
+	}
+	else if (orderIndexed)
+	{
+		plan.strategy = YDBSIStrategyScanIndex;
+	}
+	else
+	{
+		plan.needsSort = useOrder;
+	}
+
+	return plan;
+}
+
+/**
+ * Executes the query, invoking emit for every matching row.
+ * If ordered is false, then the ORDER BY, LIMIT & OFFSET clauses are ignored (as they are for COUNT(*), etc).
+**/
+template <typename Fn> // bool emit(int64_t rowid, const YDBSIRow &row), return false to stop
+static void YDBSIExecute(const YDBSIStoreData &data, const YDBSIQuery &query, bool ordered, Fn emit)
+{
+	int64_t skip = ordered ? query.offset : 0;
+	int64_t remaining = ordered ? query.limit : -1;
+
+	if (remaining == 0) return;
+
+	auto output = [&](int64_t rowid, const YDBSIRow &row) -> bool {
+
+		if (skip > 0) {
+			skip--;
+			return true;
+		}
+
+		if (!emit(rowid, row)) return false;
+
+		if (remaining > 0 && --remaining == 0) return false;
+		return true;
+	};
+
+	YDBSIPlan plan = YDBSIMakePlan(data, query, ordered);
+
+	bool reverse = ordered && query.hasOrder && query.descending;
+
+	// Step 1: Find the matching rows
+
+	std::vector<std::pair<int64_t, const YDBSIRow*>> matches;
+
+	auto visit = [&](int64_t rowid, const YDBSIRow &row) -> bool {
+
+		if (!YDBSIRowMatches(query, row)) return true;
+
+		if (plan.needsSort)
+		{
+			matches.push_back(std::make_pair(rowid, &row));
+			return true;
+		}
+		return output(rowid, row);
+	};
+
+	auto visitEntry = [&](const YDBSIEntry &entry) -> bool {
+
+		const YDBSIRow *row = YDBSIFindRow(data.rows, entry.rowid);
+		return row ? visit(entry.rowid, *row) : true;
+	};
+
+	if (plan.strategy == YDBSIStrategySearchIndex)
+	{
+		const YDBSIColumnIndex &index = *data.indexes[plan.term->column];
+		std::vector<YDBSIRange> ranges = YDBSIRangesForTerm(index, *plan.term);
+
+		// If the driving term is on the ORDER BY column, then the ranges are already in the proper order.
+		bool reverseRanges = reverse && !plan.needsSort;
+
+		if (reverseRanges) {
+			std::reverse(ranges.begin(), ranges.end());
+		}
+
+		for (const YDBSIRange &range : ranges)
+		{
+			if (!YDBSIEnumerateRange(index, range, reverseRanges, visitEntry)) return;
+		}
+	}
+	else if (plan.strategy == YDBSIStrategyScanIndex)
+	{
+		const YDBSIColumnIndex &index = *data.indexes[query.orderColumn];
+		YDBSIRange range = { { 0, 0 }, { index.size(), 0 } };
+
+		if (!YDBSIEnumerateRange(index, range, reverse, visitEntry)) return;
+	}
+	else
+	{
+		if (!YDBSIEnumerateRows(data.rows, visit)) return;
+	}
+
+	if (!plan.needsSort) return;
+
+	// Step 2: Sort the matching rows for ORDER BY.
+	// Ties are broken by rowid, so the results are deterministic.
+
+	const size_t column = query.orderColumn;
+	auto isBefore = [&](const std::pair<int64_t, const YDBSIRow*> &a, const std::pair<int64_t, const YDBSIRow*> &b) {
+
+		int cmp = YDBSICompare((*a.second)[column], (*b.second)[column]);
+		if (cmp != 0) return reverse ? (cmp > 0) : (cmp < 0);
+
+		return (a.first < b.first);
+	};
+
+	size_t needed = matches.size();
+	if (query.limit >= 0) {
+		needed = (size_t)std::min((uint64_t)matches.size(), (uint64_t)query.offset + (uint64_t)query.limit);
+	}
+
+	if (needed < matches.size())
+		std::partial_sort(matches.begin(), matches.begin() + needed, matches.end(), isBefore);
+	else
+		std::sort(matches.begin(), matches.end(), isBefore);
+
+	for (size_t i = 0; i < needed; i++)
+	{
+		if (!output(matches[i].first, *matches[i].second)) return;
+	}
+}
+
+
+@implementation YapDatabaseSecondaryIndexMemoryStore
+{
+	YDBSIStoreData *data;
+
+	NSArray<NSString *> *columnNames;                   // in setup order
+	NSDictionary<NSString*, NSNumber*> *columnIndexes; // lowercase name -> index (sqlite names are case-insensitive)
+
+	BOOL isImmutable;
+	BOOL isBulkLoading;
+}
+
+@synthesize isImmutable = isImmutable;
+
+- (instancetype)initWithSetup:(YapDatabaseSecondaryIndexSetup *)setup
+{
+	if ((self = [super init]))
+	{
+		data = new YDBSIStoreData();
+
+		NSMutableArray<NSString *> *names = [NSMutableArray arrayWithCapacity:[setup count]];
+		NSMutableDictionary<NSString*, NSNumber*> *indexes = [NSMutableDictionary dictionaryWithCapacity:[setup count]];
+
+		for (YapDatabaseSecondaryIndexColumn *column in setup)
+		{
+			indexes[[column.name lowercaseString]] = @([names count]);
+			[names addObject:column.name];
+
+			data->columns.push_back({ column.type, (bool)column.indexed });
+
+			if (column.indexed)
+				data->indexes.push_back(std::make_shared<YDBSIColumnIndex>());
+			else
+				data->indexes.push_back(nullptr);
+		}
+
+		columnNames = [names copy];
+		columnIndexes = [indexes copy];
+	}
+	return self;
+}
+
+- (instancetype)initWithStore:(YapDatabaseSecondaryIndexMemoryStore *)store immutable:(BOOL)immutable
+{
+	if ((self = [super init]))
+	{
+		// Copies the page & chunk pointers (not the rows or entries themselves)
+		data = new YDBSIStoreData(*store->data);
+
+		columnNames = store->columnNames;
+		columnIndexes = store->columnIndexes;
+
+		isImmutable = immutable;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	delete data;
+}
+
+- (id)copyWithZone:(NSZone __unused *)zone
+{
+	if (isImmutable) return self;
+
+	NSAssert(!isBulkLoading, @"Cannot snapshot a store in the middle of a bulk load");
+
+	return [[YapDatabaseSecondaryIndexMemoryStore alloc] initWithStore:self immutable:YES];
+}
+
+- (id)mutableCopyWithZone:(NSZone __unused *)zone
+{
+	return [[YapDatabaseSecondaryIndexMemoryStore alloc] initWithStore:self immutable:NO];
+}
+
+- (NSUInteger)count
+{
+	return (NSUInteger)data->rowCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Mutation
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (void)applyChanges:(NSDictionary<NSNumber*, id> *)changes
+{
+	NSAssert(!isImmutable, @"Cannot modify an immutable store");
+
+	if ([changes count] == 0) return;
+
+	const size_t columnCount = data->columns.size();
+
+	// Update the rows, keeping track of the entries that need to be removed/added from the sorted indexes
+
+	std::vector<std::pair<int64_t, YDBSIRow>> removed;
+	std::vector<std::pair<int64_t, YDBSIRow>> added;
+
+	for (NSNumber *number in changes)
+	{
+		int64_t rowid = [number longLongValue];
+		id change = [changes objectForKey:number];
+
+		bool hasNewRow = false;
+		YDBSIRow newRow;
+
+		if ([change isKindOfClass:[NSDictionary class]])
+		{
+			__unsafe_unretained NSDictionary *values = (NSDictionary *)change;
+
+			newRow.reserve(columnCount);
+			for (size_t i = 0; i < columnCount; i++)
+			{
+				NSString *name = columnNames[i];
+				newRow.push_back(YDBSIStoredValue([values objectForKey:name], name, data->columns[i]));
+			}
+			hasNewRow = true;
+		}
+
+		const YDBSIRow *oldRow = YDBSIFindRow(data->rows, rowid);
+
+		if (oldRow == NULL && !hasNewRow) continue;
+		if (oldRow && hasNewRow && YDBSIRowsEqual(*oldRow, newRow)) continue;
+
+		if (oldRow)
+		{
+			removed.push_back(std::make_pair(rowid, *oldRow));
+		}
+
+		// Note: Invalidates oldRow (the page may be duplicated)
+		YDBSIRowPage &page = YDBSIMutablePage(data->rows, rowid);
+
+		if (hasNewRow)
+		{
+			if (oldRow == NULL) data->rowCount++;
+
+			page[rowid] = newRow;
+			added.push_back(std::make_pair(rowid, std::move(newRow)));
+		}
+		else
+		{
+			page.erase(rowid);
+			data->rowCount--;
+
+			if (page.empty()) {
+				data->rows.erase(rowid >> kRowPageShift);
+			}
+		}
+	}
+
+	if (isBulkLoading) return; // Indexes are built by endBulkLoad
+
+	size_t changeCount = removed.size() + added.size();
+	if (changeCount == 0) return;
+
+	// If a large fraction of the rows changed, it's faster to rebuild (sort) than to update entry by entry.
+
+	const bool rebuild = (changeCount > (data->rowCount / 4));
+
+	YDBSIStoreData *storeData = data;
+	std::vector<std::pair<int64_t, YDBSIRow>> *removedPtr = &removed;
+	std::vector<std::pair<int64_t, YDBSIRow>> *addedPtr = &added;
+
+	YDBSIForEachColumn(columnCount, (changeCount >= kMinParallelChanges), ^(size_t column) {
+
+		std::shared_ptr<YDBSIColumnIndex> &indexPtr = storeData->indexes[column];
+		if (!indexPtr) return; // not indexed
+
+		if (rebuild)
+		{
+			indexPtr = YDBSIBuildIndex(*storeData, column);
+			return;
+		}
+
+		YDBSIColumnIndex &index = YDBSIMutableIndex(indexPtr);
+
+		for (const auto &pair : *removedPtr) {
+			YDBSIRemoveEntry(index, YDBSIEntry(pair.second[column], pair.first));
+		}
+		for (const auto &pair : *addedPtr) {
+			YDBSIInsertEntry(index, YDBSIEntry(pair.second[column], pair.first));
+		}
+	});
+}
+
+- (void)removeAllRowids
+{
+	NSAssert(!isImmutable, @"Cannot modify an immutable store");
+
+	data->rows.clear();
+	data->rowCount = 0;
+
+	for (size_t column = 0; column < data->columns.size(); column++)
+	{
+		if (data->indexes[column]) {
+			data->indexes[column] = std::make_shared<YDBSIColumnIndex>();
+		}
+	}
+}
+
+- (void)beginBulkLoad
+{
+	NSAssert(!isImmutable, @"Cannot modify an immutable store");
+
+	isBulkLoading = YES;
+}
+
+- (void)endBulkLoad
+{
+	if (!isBulkLoading) return;
+	isBulkLoading = NO;
+
+	YDBSIStoreData *storeData = data;
+
+	YDBSIForEachColumn(data->columns.size(), (data->rowCount >= kMinParallelChanges), ^(size_t column) {
+
+		if (storeData->indexes[column]) {
+			storeData->indexes[column] = YDBSIBuildIndex(*storeData, column);
+		}
+	});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Queries
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (BOOL)parseQuery:(YapDatabaseQuery *)query into:(YDBSIQuery *)parsedQuery
+{
+	NSAssert(!isBulkLoading, @"Cannot query a store in the middle of a bulk load");
+
+	std::vector<YDBSIToken> tokens;
+
+	if (YDBSITokenize(query.queryString, tokens))
+	{
+		YDBSIParser parser(tokens, query.queryParameters, columnIndexes, data);
+
+		if (parser.parseQuery(*parsedQuery)) return YES;
+	}
+
+	YDBLogError(@"Query not supported by a non-persistent secondary index: '%@'."
+	            @" See YapDatabaseSecondaryIndexOptions.isPersistent for the supported subset.", query.queryString);
+	return NO;
+}
+
+- (BOOL)enumerateRowidsMatchingQuery:(YapDatabaseQuery *)query
+                  withValuesInColumn:(NSString *)columnName
+                          usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, id value, BOOL *stop))block
+{
+	YDBSIQuery parsedQuery;
+	if (![self parseQuery:query into:&parsedQuery]) return NO;
+
+	NSInteger column = -1;
+	if (columnName)
+	{
+		NSNumber *index = [columnIndexes objectForKey:[columnName lowercaseString]];
+		if (index == nil)
+		{
+			YDBLogError(@"Unknown column for a non-persistent secondary index: '%@'", columnName);
+			return NO;
+		}
+
+		column = [index integerValue];
+	}
+
+	BOOL stop = NO;
+	YDBSIExecute(*data, parsedQuery, true, [&](int64_t rowid, const YDBSIRow &row) -> bool {
+
+		id value = (column >= 0) ? YDBSIObjectFromValue(row[column]) : nil;
+
+		block(rowid, value, &stop);
+		return !stop;
+	});
+
+	return YES;
+}
+
+- (BOOL)getNumberOfRows:(NSUInteger *)countPtr matchingQuery:(YapDatabaseQuery *)query
+{
+	YDBSIQuery parsedQuery;
+	if (![self parseQuery:query into:&parsedQuery])
+	{
+		if (countPtr) *countPtr = 0;
+		return NO;
+	}
+
+	NSUInteger count = 0;
+
+	if (parsedQuery.terms.empty())
+	{
+		count = (NSUInteger)data->rowCount;
+	}
+	else
+	{
+		YDBSIExecute(*data, parsedQuery, false, [&](int64_t __unused rowid, const YDBSIRow __unused &row) -> bool {
+			count++;
+			return true;
+		});
+	}
+
+	if (countPtr) *countPtr = count;
+	return YES;
+}
+
+- (id)performAggregateQuery:(YapDatabaseQuery *)query
+{
+	std::vector<YDBSIToken> tokens;
+	std::string function;
+	bool isStar = false;
+	size_t column = 0;
+
+	bool supported = YDBSITokenize(query.aggregateFunction, tokens);
+	if (supported)
+	{
+		YDBSIParser parser(tokens, @[], columnIndexes, data);
+		supported = parser.parseAggregate(function, &isStar, &column);
+	}
+
+	if (supported)
+	{
+		supported = (function == "count") ||
+		            (!isStar && (function == "min" || function == "max" ||
+		                         function == "sum" || function == "total" || function == "avg"));
+	}
+
+	if (!supported)
+	{
+		YDBLogError(@"Aggregate function not supported by a non-persistent secondary index: '%@'",
+		            query.aggregateFunction);
+		return nil;
+	}
+
+	YDBSIQuery parsedQuery;
+	if (![self parseQuery:query into:&parsedQuery]) return nil;
+
+	int64_t count = 0;
+
+	int64_t integerSum = 0;
+	double realSum = 0;
+	bool isRealSum = false;
+	bool hasRealValue = false;
+	bool integerOverflow = false;
+
+	const YDBSIValue *extreme = NULL;
+	const bool isMin = (function == "min");
+
+	YDBSIExecute(*data, parsedQuery, false, [&](int64_t __unused rowid, const YDBSIRow &row) -> bool {
+
+		if (isStar) {
+			count++;
+			return true;
+		}
+
+		const YDBSIValue &value = row[column];
+		if (value.type == YDBSIValueTypeNull) return true;
+
+		count++;
+
+		if (extreme == NULL || (isMin ? (YDBSICompare(value, *extreme) < 0) : (YDBSICompare(value, *extreme) > 0))) {
+			extreme = &value;
+		}
+
+		YDBSIValue number = value;
+		if (number.type == YDBSIValueTypeText) {
+			if (!YDBSIParseNumber(number.bytes, &number)) number = YDBSIIntegerValue(0);
+		}
+		else if (number.type != YDBSIValueTypeNumeric) {
+			number = YDBSIIntegerValue(0);
+		}
+
+		if (number.isReal) hasRealValue = true;
+
+		if (number.isReal || isRealSum)
+		{
+			if (!isRealSum) {
+				realSum = (double)integerSum;
+				isRealSum = true;
+			}
+			realSum += number.isReal ? number.d : (double)number.i;
+		}
+		else
+		{
+			int64_t newIntegerSum = 0;
+			if (__builtin_add_overflow(integerSum, number.i, &newIntegerSum))
+			{
+				// Same as sqlite: total() & avg() continue in floating point,
+				// but sum() fails with an "integer overflow" error (unless it also sees a real value).
+				realSum = (double)integerSum + (double)number.i;
+				isRealSum = true;
+				integerOverflow = true;
+			}
+			else
+			{
+				integerSum = newIntegerSum;
+			}
+		}
+
+		return true;
+	});
+
+	double total = isRealSum ? realSum : (double)integerSum;
+
+	if (function == "count") return @(count);
+	if (function == "total") return @(total);
+
+	if (count == 0) return [NSNull null];
+
+	if (function == "avg") return @(total / (double)count);
+	if (function == "sum")
+	{
+		if (integerOverflow && !hasRealValue)
+		{
+			YDBLogError(@"Integer overflow in aggregate function: '%@'", query.aggregateFunction);
+			return nil;
+		}
+
+		return isRealSum ? @(realSum) : @(integerSum);
+	}
+
+	return YDBSIObjectFromValue(*extreme) ?: [NSNull null];
+}
+
+- (NSString *)queryPlanForQuery:(YapDatabaseQuery *)query
+{
+	YDBSIQuery parsedQuery;
+	if (![self parseQuery:query into:&parsedQuery]) return nil;
+
+	YDBSIPlan plan = YDBSIMakePlan(*data, parsedQuery, !query.isAggregateQuery);
+
+	NSMutableString *result = [NSMutableString string];
+
+	if (plan.strategy == YDBSIStrategySearchIndex)
+	{
+		static NSString *const operators[] = {
+			@"=?", @"!=?", @"<?", @"<=?", @">?", @">=?", @" IN (...)", @" NOT IN (...)", @" BETWEEN ? AND ?",
+			@" IS NULL", @" IS NOT NULL"
+		};
+
+		NSString *column = columnNames[plan.term->column];
+		[result appendFormat:@"SEARCH MEMORY INDEX %@ (%@%@)", column, column, operators[plan.term->op]];
+	}
+	else if (plan.strategy == YDBSIStrategyScanIndex)
+	{
+		[result appendFormat:@"SCAN MEMORY INDEX %@", columnNames[parsedQuery.orderColumn]];
+	}
+	else
+	{
+		[result appendString:@"SCAN ROWS"];
+	}
+
+	if (plan.needsSort)
+	{
+		[result appendString:@"\nSORT FOR ORDER BY"];
+	}
+
+	return result;
+}
+
+@end
@@ -7,8 +7,11 @@
 #import "YapDatabaseSecondaryIndexHandler.h"
 #import "YapDatabaseSecondaryIndexConnection.h"
 #import "YapDatabaseSecondaryIndexTransaction.h"
+#import "YapDatabaseSecondaryIndexPreparedQuery.h"
+#import "YapDatabaseSecondaryIndexMemoryStore.h"
 
 #import "YapCache.h"
+#import "YapMemoryTable.h"
 #import "YapMutationStack.h"
 #import "YapDatabaseStatement.h"
 
@@ -76,6 +79,7 @@
 }
 
 - (NSString *)tableName;
+- (NSString *)aggregatesTableName;
 
 @end
 
@@ -95,6 +99,17 @@
 	NSUInteger queryCacheLimit;
 	
 	YapMutationStack_Bool *mutationStack;
+	
+	NSMutableDictionary<NSNumber*, id> *pendingChanges; // rowid -> NSDictionary (column values) || NSNull (remove)
+	NSMutableSet<NSNumber*> *pendingInserts;            // rowids not yet in the table (plain INSERT, no comparison)
+	
+	YapDatabaseSecondaryIndexMemoryStore *memoryStore;  // non-persistent only: mutable store for readWriteTransaction
+	
+	NSMapTable<YapDatabaseSecondaryIndexPreparedQuery *, YapDatabaseStatement *> *preparedStatements;      // weak keys
+	NSMapTable<YapDatabaseSecondaryIndexPreparedQuery *, YapDatabaseStatement *> *preparedCountStatements; // weak keys
+	
+	NSMutableDictionary<NSString*, YapCache*> *aggregateCache;         // aggregateName -> (group -> value || NSNull)
+	NSMutableDictionary<NSString*, NSMutableSet*> *aggregateChanges;  // aggregateName -> changed groups
 }
 
 - (id)initWithParent:(YapDatabaseSecondaryIndex *)parent
@@ -105,9 +120,24 @@
 
 - (sqlite3_stmt *)insertStatement;
 - (sqlite3_stmt *)updateStatement;
+- (sqlite3_stmt *)selectStatement;
 - (sqlite3_stmt *)removeStatement;
 - (sqlite3_stmt *)removeAllStatement;
 
+- (sqlite3_stmt *)aggregateSelectStatement;
+- (sqlite3_stmt *)aggregateSelectAllStatement;
+- (sqlite3_stmt *)aggregateEnumerateStatement;
+- (sqlite3_stmt *)aggregateInsertOrReplaceStatement;
+- (sqlite3_stmt *)aggregateRemoveStatement;
+- (sqlite3_stmt *)aggregateRemoveAllStatement;
+- (sqlite3_stmt *)aggregateRecalculateStatement:(YapDatabaseSecondaryIndexAggregate *)aggregate;
+
+- (YapCache *)aggregateCacheForName:(NSString *)aggregateName;
+- (void)didChangeAggregate:(NSString *)aggregateName group:(id)group;
+
+- (sqlite3_stmt *)statementForPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query;
+- (sqlite3_stmt *)countStatementForPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query;
+
 @end
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -119,9 +149,36 @@
 	
 	__unsafe_unretained YapDatabaseSecondaryIndexConnection *parentConnection;
 	__unsafe_unretained YapDatabaseReadTransaction *databaseTransaction;
+	
+	YapMemoryTableTransaction *memoryTableTransaction; // non-persistent only
 }
 
 - (id)initWithParentConnection:(YapDatabaseSecondaryIndexConnection *)parentConnection
            databaseTransaction:(YapDatabaseReadTransaction *)databaseTransaction;
 
 @end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@interface YapDatabaseSecondaryIndexPreparedQuery () {
+@public
+	
+	NSString *queryString;
+	NSString *whereString; // queryString without the ORDER BY & LIMIT clauses (for counting)
+	NSUInteger numberOfParameters;
+	
+	BOOL matchesNothing; // e.g. whereIn:count:0 (the query can be answered without executing it)
+}
+
+- (instancetype)initWithQueryString:(NSString *)queryString
+                        whereString:(NSString *)whereString
+                 numberOfParameters:(NSUInteger)numberOfParameters
+                     matchesNothing:(BOOL)matchesNothing;
+
+- (void)bindParametersToStatement:(sqlite3_stmt *)statement;
+
+- (YapDatabaseQuery *)queryWithCurrentParameters;
+
+@end
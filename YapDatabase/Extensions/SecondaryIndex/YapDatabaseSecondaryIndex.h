@@ -5,6 +5,8 @@
 #import "YapDatabaseSecondaryIndexSetup.h"
 #import "YapDatabaseSecondaryIndexHandler.h"
 #import "YapDatabaseSecondaryIndexOptions.h"
+#import "YapDatabaseSecondaryIndexPreparedQuery.h"
+#import "YapDatabaseSecondaryIndexJoinedQuery.h"
 #import "YapDatabaseSecondaryIndexConnection.h"
 #import "YapDatabaseSecondaryIndexTransaction.h"
 
@@ -70,6 +72,8 @@ NS_ASSUME_NONNULL_BEGIN
  *   If, after creating the secondary index(es), you need to change the setup or block,
  *   then simply increment the version parameter. If you pass a version that is different from the last
  *   initialization of the extension, then it will automatically re-create itself.
+ *   (Adding, changing or removing indexes via addIndexWithName:... is the exception. Those are migrated
+ *   automatically, without re-populating, and don't require a versionTag change.)
  *
  * @see YapDatabaseSecondaryIndexSetup
  * @see YapDatabaseSecondaryIndexHandler
@@ -99,6 +103,8 @@ NS_ASSUME_NONNULL_BEGIN
  *   If, after creating the secondary index(es), you need to change the setup or block,
  *   then simply increment the version parameter. If you pass a version that is different from the last
  *   initialization of the extension, then it will automatically re-create itself.
+ *   (Adding, changing or removing indexes via addIndexWithName:... is the exception. Those are migrated
+ *   automatically, without re-populating, and don't require a versionTag change.)
  * 
  * @param options
  * 
@@ -26,17 +26,39 @@
 
 + (void)dropTablesForRegisteredName:(NSString *)registeredName
                     withTransaction:(YapDatabaseReadWriteTransaction *)transaction
-                      wasPersistent:(BOOL __unused)wasPersistent
+                      wasPersistent:(BOOL)wasPersistent
 {
-	sqlite3 *db = transaction->connection->db;
 	NSString *tableName = [self tableNameForRegisteredName:registeredName];
 	
-	NSString *dropTable = [NSString stringWithFormat:@"DROP TABLE IF EXISTS \"%@\";", tableName];
-	
-	int status = sqlite3_exec(db, [dropTable UTF8String], NULL, NULL, NULL);
-	if (status != SQLITE_OK)
+	if (wasPersistent)
+	{
+		// Handle persistent secondary index
+		
+		sqlite3 *db = transaction->connection->db;
+		
+		NSString *dropTable = [NSString stringWithFormat:@"DROP TABLE IF EXISTS \"%@\";", tableName];
+		
+		int status = sqlite3_exec(db, [dropTable UTF8String], NULL, NULL, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Failed dropping table (%@): %d %s", tableName, status, sqlite3_errmsg(db));
+		}
+		
+		NSString *aggregatesTableName = [self aggregatesTableNameForRegisteredName:registeredName];
+		NSString *dropAggregatesTable =
+		  [NSString stringWithFormat:@"DROP TABLE IF EXISTS \"%@\";", aggregatesTableName];
+		
+		status = sqlite3_exec(db, [dropAggregatesTable UTF8String], NULL, NULL, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Failed dropping table (%@): %d %s", aggregatesTableName, status, sqlite3_errmsg(db));
+		}
+	}
+	else
 	{
-		YDBLogError(@"Failed dropping table (%@): %d %s", tableName, status, sqlite3_errmsg(db));
+		// Handle memory secondary index
+		
+		[transaction->connection unregisterMemoryTableWithName:tableName];
 	}
 }
 
@@ -50,6 +72,11 @@
 	return [NSString stringWithFormat:@"secondaryIndex_%@", registeredName];
 }
 
++ (NSString *)aggregatesTableNameForRegisteredName:(NSString *)registeredName
+{
+	return [NSString stringWithFormat:@"secondaryIndex_%@_aggregates", registeredName];
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Instance
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -122,6 +149,15 @@
 	return self;
 }
 
+/**
+ * Subclasses MUST implement this method IF they are non-persistent (in-memory only).
+ * By doing so, they allow various optimizations, such as not persisting extension info in the yap2 table.
+**/
+- (BOOL)isPersistent
+{
+	return options.isPersistent;
+}
+
 - (YapDatabaseExtensionConnection *)newConnection:(YapDatabaseConnection *)databaseConnection
 {
 	return [[YapDatabaseSecondaryIndexConnection alloc] initWithParent:self databaseConnection:databaseConnection];
@@ -132,4 +168,13 @@
 	return [[self class] tableNameForRegisteredName:self.registeredName];
 }
 
+/**
+ * The table in which the aggregates (declared in the setup) are maintained.
+ * Only used by persistent secondary indexes with at least one aggregate.
+**/
+- (NSString *)aggregatesTableName
+{
+	return [[self class] aggregatesTableNameForRegisteredName:self.registeredName];
+}
+
 @end
@@ -31,6 +31,27 @@ NS_ASSUME_NONNULL_BEGIN
 @property (atomic, assign, readwrite) BOOL queryCacheEnabled;
 @property (atomic, assign, readwrite) NSUInteger queryCacheLimit;
 
+/**
+ * Returns the groups of the given aggregate whose value changed, within the given notifications.
+ * (That is, the YapDatabaseModifiedNotification's, as returned by [YapDatabaseConnection beginLongLivedReadTransaction].)
+ *
+ * For example:
+ *
+ * NSSet *folders = [[databaseConnection ext:@"idx"] changedGroupsForAggregate:@"unreadPerFolder"
+ *                                                            inNotifications:notifications];
+ * for (NSString *folder in folders) {
+ *     [self updateBadgeForFolder:folder];
+ * }
+ *
+ * @see YapDatabaseSecondaryIndexSetup addAggregateWithName:function:column:groupByColumn:
+ */
+- (NSSet *)changedGroupsForAggregate:(NSString *)aggregateName
+                     inNotifications:(NSArray<NSNotification *> *)notifications;
+
+- (BOOL)hasChangesForAggregate:(NSString *)aggregateName
+                         group:(id)group
+               inNotifications:(NSArray<NSNotification *> *)notifications;
+
 @end
 
 NS_ASSUME_NONNULL_END
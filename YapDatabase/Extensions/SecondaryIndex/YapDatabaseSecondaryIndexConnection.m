@@ -23,13 +23,30 @@
 #endif
 #pragma unused(ydbLogLevel)
 
+static NSString *const changeset_key_aggregates = @"aggregates";
+
+/**
+ * The number of groups (per aggregate) whose values are cached by the connection.
+**/
+static NSUInteger const kAggregateCacheLimit = 250;
+
 
 @implementation YapDatabaseSecondaryIndexConnection
 {
 	sqlite3_stmt *insertStatement;
 	sqlite3_stmt *updateStatement;
+	sqlite3_stmt *selectStatement;
 	sqlite3_stmt *removeStatement;
 	sqlite3_stmt *removeAllStatement;
+	
+	sqlite3_stmt *aggregateSelectStatement;
+	sqlite3_stmt *aggregateSelectAllStatement;
+	sqlite3_stmt *aggregateEnumerateStatement;
+	sqlite3_stmt *aggregateInsertOrReplaceStatement;
+	sqlite3_stmt *aggregateRemoveStatement;
+	sqlite3_stmt *aggregateRemoveAllStatement;
+	
+	NSMutableDictionary<NSString*, YapDatabaseStatement*> *aggregateRecalculateStatements;
 }
 
 @synthesize secondaryIndex = parent;
@@ -60,8 +77,23 @@
 {
 	sqlite_finalize_null(&insertStatement);
 	sqlite_finalize_null(&updateStatement);
+	sqlite_finalize_null(&selectStatement);
 	sqlite_finalize_null(&removeStatement);
 	sqlite_finalize_null(&removeAllStatement);
+	
+	sqlite_finalize_null(&aggregateSelectStatement);
+	sqlite_finalize_null(&aggregateSelectAllStatement);
+	sqlite_finalize_null(&aggregateEnumerateStatement);
+	sqlite_finalize_null(&aggregateInsertOrReplaceStatement);
+	sqlite_finalize_null(&aggregateRemoveStatement);
+	sqlite_finalize_null(&aggregateRemoveAllStatement);
+	
+	[aggregateRecalculateStatements removeAllObjects];
+	
+	// The statements for prepared queries are recompiled the next time they're used.
+	
+	[preparedStatements removeAllObjects];
+	[preparedCountStatements removeAllObjects];
 }
 
 /**
@@ -72,6 +104,7 @@
 	if (flags & YapDatabaseConnectionFlushMemoryFlags_Caches)
 	{
 		[queryCache removeAllObjects];
+		[aggregateCache removeAllObjects];
 	}
 	
 	if (flags & YapDatabaseConnectionFlushMemoryFlags_Statements)
@@ -212,40 +245,180 @@
 	
 	if (mutationStack == nil)
 		mutationStack = [[YapMutationStack_Bool alloc] init];
+	
+	if (pendingChanges == nil)
+		pendingChanges = [[NSMutableDictionary alloc] init];
+	
+	if (pendingInserts == nil)
+		pendingInserts = [[NSMutableSet alloc] init];
+	
+	if (aggregateChanges == nil)
+		aggregateChanges = [[NSMutableDictionary alloc] init];
 }
 
 - (void)postCommitCleanup
 {
 	[mutationStack clear];
+	
+	// These should already be empty (flushed in flushPendingChangesToExtensionTables)
+	
+	[pendingChanges removeAllObjects];
+	[pendingInserts removeAllObjects];
+	
+	// The committed snapshot (an immutable copy) now lives in the memory table
+	
+	memoryStore = nil;
+	
+	[aggregateChanges removeAllObjects];
 }
 
 - (void)postRollbackCleanup
 {
 	[mutationStack clear];
+	
+	[pendingChanges removeAllObjects];
+	[pendingInserts removeAllObjects];
+	
+	memoryStore = nil;
+	
+	if ([aggregateChanges count] > 0)
+	{
+		// The cache may contain values that were read (within the transaction) after the aggregates were changed.
+		
+		[aggregateCache removeAllObjects];
+		[aggregateChanges removeAllObjects];
+	}
 }
 
 /**
  * Required override method from YapDatabaseExtension
 **/
-- (void)getInternalChangeset:(NSMutableDictionary __unused **)internalChangesetPtr
-           externalChangeset:(NSMutableDictionary __unused **)externalChangesetPtr
-              hasDiskChanges:(BOOL __unused *)hasDiskChangesPtr
+- (void)getInternalChangeset:(NSMutableDictionary **)internalChangesetPtr
+           externalChangeset:(NSMutableDictionary **)externalChangesetPtr
+              hasDiskChanges:(BOOL *)hasDiskChangesPtr
 {
-	// Nothing to do for this particular extension.
-	//
-	// YapDatabaseExtension throws a "not implemented" exception
-	// to ensure extensions have implementations of all required methods.
+	NSMutableDictionary *internalChangeset = nil;
+	NSMutableDictionary *externalChangeset = nil;
+	BOOL hasDiskChanges = NO;
+	
+	if ([aggregateChanges count] > 0)
+	{
+		// Other connections need to know which aggregate groups changed, so they can update their aggregateCache.
+		// And the user needs to know, so they can update their UI (via changedGroupsForAggregate:inNotifications:).
+		
+		NSMutableDictionary *changes = [NSMutableDictionary dictionaryWithCapacity:[aggregateChanges count]];
+		
+		[aggregateChanges enumerateKeysAndObjectsUsingBlock:^(NSString *aggregateName, NSMutableSet *groups, BOOL *stop) {
+			
+			changes[aggregateName] = [groups copy];
+		}];
+		
+		internalChangeset = [NSMutableDictionary dictionaryWithCapacity:1];
+		internalChangeset[changeset_key_aggregates] = changes;
+		
+		externalChangeset = [NSMutableDictionary dictionaryWithCapacity:1];
+		externalChangeset[changeset_key_aggregates] = changes;
+		
+		hasDiskChanges = YES;
+	}
+	
+	*internalChangesetPtr = internalChangeset;
+	*externalChangesetPtr = externalChangeset;
+	*hasDiskChangesPtr = hasDiskChanges;
 }
 
 /**
  * Required override method from YapDatabaseExtension
 **/
-- (void)processChangeset:(NSDictionary __unused *)changeset
+- (void)processChangeset:(NSDictionary *)changeset
 {
-	// Nothing to do for this particular extension.
-	//
-	// YapDatabaseExtension throws a "not implemented" exception
-	// to ensure extensions have implementations of all required methods.
+	NSDictionary<NSString*, NSSet*> *changes = changeset[changeset_key_aggregates];
+	
+	[changes enumerateKeysAndObjectsUsingBlock:^(NSString *aggregateName, NSSet *groups, BOOL *stop) {
+		
+		[self->aggregateCache[aggregateName] removeObjectsForKeys:groups];
+	}];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Aggregates
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns the cache for the given aggregate, which maps from group to value (or NSNull if the group is empty).
+**/
+- (YapCache *)aggregateCacheForName:(NSString *)aggregateName
+{
+	if (aggregateCache == nil)
+		aggregateCache = [[NSMutableDictionary alloc] init];
+	
+	YapCache *cache = aggregateCache[aggregateName];
+	if (cache == nil)
+	{
+		cache = [[YapCache alloc] initWithCountLimit:kAggregateCacheLimit];
+		aggregateCache[aggregateName] = cache;
+	}
+	
+	return cache;
+}
+
+/**
+ * Invoked by our transaction whenever it changes the value of an aggregate group.
+**/
+- (void)didChangeAggregate:(NSString *)aggregateName group:(id)group
+{
+	NSMutableSet *groups = aggregateChanges[aggregateName];
+	if (groups == nil)
+	{
+		groups = [[NSMutableSet alloc] init];
+		aggregateChanges[aggregateName] = groups;
+	}
+	
+	[groups addObject:group];
+	[aggregateCache[aggregateName] removeObjectForKey:group];
+}
+
+- (NSSet *)changedGroupsForAggregate:(NSString *)aggregateName inNotifications:(NSArray<NSNotification *> *)notifications
+{
+	NSString *registeredName = parent.registeredName;
+	NSMutableSet *result = [NSMutableSet set];
+	
+	for (NSNotification *notification in notifications)
+	{
+		NSDictionary *changeset =
+		    [[notification.userInfo objectForKey:YapDatabaseExtensionsKey] objectForKey:registeredName];
+		
+		NSSet *groups = [[changeset objectForKey:changeset_key_aggregates] objectForKey:aggregateName];
+		if (groups)
+		{
+			[result unionSet:groups];
+		}
+	}
+	
+	return result;
+}
+
+- (BOOL)hasChangesForAggregate:(NSString *)aggregateName
+                         group:(id)group
+               inNotifications:(NSArray<NSNotification *> *)notifications
+{
+	if (group == nil) return NO;
+	
+	NSString *registeredName = parent.registeredName;
+	
+	for (NSNotification *notification in notifications)
+	{
+		NSDictionary *changeset =
+		    [[notification.userInfo objectForKey:YapDatabaseExtensionsKey] objectForKey:registeredName];
+		
+		NSSet *groups = [[changeset objectForKey:changeset_key_aggregates] objectForKey:aggregateName];
+		if ([groups containsObject:group])
+		{
+			return YES;
+		}
+	}
+	
+	return NO;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -327,6 +500,27 @@
 	return *statement;
 }
 
+- (sqlite3_stmt *)selectStatement
+{
+	sqlite3_stmt **statement = &selectStatement;
+	if (*statement == NULL)
+	{
+		NSMutableString *string = [NSMutableString stringWithCapacity:100];
+		[string appendString:@"SELECT \"rowid\""];
+		
+		for (YapDatabaseSecondaryIndexColumn *column in parent->setup)
+		{
+			[string appendFormat:@", \"%@\"", column.name];
+		}
+		
+		[string appendFormat:@" FROM \"%@\" WHERE \"rowid\" = ?;", [parent tableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
 - (sqlite3_stmt *)removeStatement
 {
 	sqlite3_stmt **statement = &removeStatement;
@@ -355,4 +549,173 @@
 	return *statement;
 }
 
+- (sqlite3_stmt *)aggregateSelectStatement
+{
+	sqlite3_stmt **statement = &aggregateSelectStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT \"value\", \"count\" FROM \"%@\" WHERE \"name\" = ? AND \"group\" = ?;",
+		  [parent aggregatesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)aggregateSelectAllStatement
+{
+	sqlite3_stmt **statement = &aggregateSelectAllStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT \"name\", \"group\" FROM \"%@\";", [parent aggregatesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)aggregateEnumerateStatement
+{
+	sqlite3_stmt **statement = &aggregateEnumerateStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT \"group\", \"value\" FROM \"%@\" WHERE \"name\" = ?;", [parent aggregatesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)aggregateInsertOrReplaceStatement
+{
+	sqlite3_stmt **statement = &aggregateInsertOrReplaceStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"INSERT OR REPLACE INTO \"%@\" (\"name\", \"group\", \"value\", \"count\") VALUES (?, ?, ?, ?);",
+		  [parent aggregatesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)aggregateRemoveStatement
+{
+	sqlite3_stmt **statement = &aggregateRemoveStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"DELETE FROM \"%@\" WHERE \"name\" = ? AND \"group\" = ?;", [parent aggregatesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)aggregateRemoveAllStatement
+{
+	sqlite3_stmt **statement = &aggregateRemoveAllStatement;
+	if (*statement == NULL)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"DELETE FROM \"%@\";", [parent aggregatesTableName]];
+		
+		[self prepareStatement:statement withString:string caller:_cmd];
+	}
+	
+	return *statement;
+}
+
+/**
+ * Returns the statement used to recalculate a min/max aggregate for a single group.
+ * This is only needed when the row holding the current min/max is changed or removed.
+**/
+- (sqlite3_stmt *)aggregateRecalculateStatement:(YapDatabaseSecondaryIndexAggregate *)aggregate
+{
+	if (aggregateRecalculateStatements == nil)
+		aggregateRecalculateStatements = [[NSMutableDictionary alloc] init];
+	
+	YapDatabaseStatement *wrapper = aggregateRecalculateStatements[aggregate.name];
+	if (wrapper == nil)
+	{
+		NSString *function = NSStringFromYapDatabaseSecondaryIndexAggregateFunction(aggregate.function);
+		
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT %@(\"%@\"), COUNT(\"%@\") FROM \"%@\" WHERE \"%@\" = ?;",
+		  function, aggregate.column, aggregate.column, [parent tableName], aggregate.groupByColumn];
+		
+		sqlite3_stmt *statement = NULL;
+		[self prepareStatement:&statement withString:string caller:_cmd];
+		
+		if (statement == NULL) return NULL;
+		
+		wrapper = [[YapDatabaseStatement alloc] initWithStatement:statement];
+		aggregateRecalculateStatements[aggregate.name] = wrapper;
+	}
+	
+	return wrapper.stmt;
+}
+
+/**
+ * Returns the compiled statement for the given prepared query, compiling it the first time it's used.
+ * 
+ * The statement is kept for as long as the prepared query exists (weak keys),
+ * or until the statements are flushed (flushMemoryWithFlags:).
+ * Either way, the statement is only ever released (and thus finalized) on the connection's queue.
+**/
+- (sqlite3_stmt *)statementForPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+{
+	if (preparedStatements == nil)
+		preparedStatements = [NSMapTable weakToStrongObjectsMapTable];
+	
+	YapDatabaseStatement *wrapper = [preparedStatements objectForKey:query];
+	if (wrapper == nil)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT \"rowid\" FROM \"%@\" %@;", [parent tableName], query->queryString];
+		
+		sqlite3_stmt *statement = NULL;
+		[self prepareStatement:&statement withString:string caller:_cmd];
+		
+		if (statement == NULL) return NULL;
+		
+		wrapper = [[YapDatabaseStatement alloc] initWithStatement:statement];
+		[preparedStatements setObject:wrapper forKey:query];
+	}
+	
+	return wrapper.stmt;
+}
+
+- (sqlite3_stmt *)countStatementForPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+{
+	if (preparedCountStatements == nil)
+		preparedCountStatements = [NSMapTable weakToStrongObjectsMapTable];
+	
+	YapDatabaseStatement *wrapper = [preparedCountStatements objectForKey:query];
+	if (wrapper == nil)
+	{
+		NSString *string = [NSString stringWithFormat:
+		  @"SELECT COUNT(*) AS NumberOfRows FROM \"%@\" %@;", [parent tableName], query->whereString];
+		
+		sqlite3_stmt *statement = NULL;
+		[self prepareStatement:&statement withString:string caller:_cmd];
+		
+		if (statement == NULL) return NULL;
+		
+		wrapper = [[YapDatabaseStatement alloc] initWithStatement:statement];
+		[preparedCountStatements setObject:wrapper forKey:query];
+	}
+	
+	return wrapper.stmt;
+}
+
 @end
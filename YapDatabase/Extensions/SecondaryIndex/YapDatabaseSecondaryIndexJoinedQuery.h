@@ -0,0 +1,90 @@
+#import <Foundation/Foundation.h>
+
+#import "YapDatabaseQuery.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Welcome to YapDatabase!
+ * https://github.com/yapstudios/YapDatabase
+ *
+ * The project wiki has a wealth of documentation if you have any questions.
+ * https://github.com/yapstudios/YapDatabase/wiki
+ *
+ * A joined query combines a secondary index query with a full text search query, and/or view membership.
+ * For example: "unread messages in account X, matching 'invoice', in inbox order".
+ *
+ * ```
+ * YapDatabaseQuery *query = [YapDatabaseQuery queryWithFormat:@"WHERE accountId = ? AND unread = 1", accountId];
+ *
+ * YapDatabaseSecondaryIndexJoinedQuery *joinedQuery = [[YapDatabaseSecondaryIndexJoinedQuery alloc] initWithQuery:query];
+ * joinedQuery.fullTextSearchName = @"fts";
+ * joinedQuery.fullTextSearchMatch = @"invoice";
+ * joinedQuery.viewName = @"messages";
+ * joinedQuery.viewGroup = @"inbox";
+ * joinedQuery.sortByViewOrder = YES;
+ * joinedQuery.limit = 50;
+ *
+ * [[transaction ext:@"idx"] enumerateKeysMatchingJoinedQuery:joinedQuery usingBlock:...];
+ * ```
+ *
+ * The secondary index table & the full text search table are joined (on rowid) within sqlite,
+ * so only the rows that match both are ever returned, and results are streamed (no intermediate arrays).
+ *
+ * Within the SQL, the secondary index table is aliased as "idx", and the full text search table as "fts".
+ * So if a column name is ambiguous (exists in both tables), you can qualify it. E.g. "WHERE idx.title = ?".
+ * With FTS5, you can also order by relevance: "WHERE unread = 1 ORDER BY fts.rank".
+ *
+ * A view doesn't store its items in a form that can be joined within sqlite (its pages are blobs).
+ * So view membership is checked (in memory) for every row that matches the SQL,
+ * and sortByViewOrder requires collecting the matching rowids (a plain array of integers) first.
+ *
+ * Joined queries are only supported by persistent secondary indexes.
+ */
+@interface YapDatabaseSecondaryIndexJoinedQuery : NSObject <NSCopying>
+
+/**
+ * The query may include ORDER BY & LIMIT clauses, which are applied within sqlite.
+ * (And thus before the view filtering.)
+ */
+- (instancetype)initWithQuery:(YapDatabaseQuery *)query;
+
+@property (nonatomic, strong, readonly) YapDatabaseQuery *query;
+
+/**
+ * The registered name of a YapDatabaseFullTextSearch extension, and the query to match against it.
+ * E.g. @"invoice", or @"title:invoice* AND paid".
+ *
+ * Both must be set to join the full text search table.
+ */
+@property (nonatomic, copy, readwrite, nullable) NSString *fullTextSearchName;
+@property (nonatomic, copy, readwrite, nullable) NSString *fullTextSearchMatch;
+
+/**
+ * The registered name of a YapDatabaseView extension (or any subclass), and a group within it.
+ * Only rows within the group are returned.
+ *
+ * Both must be set to filter by view membership.
+ */
+@property (nonatomic, copy, readwrite, nullable) NSString *viewName;
+@property (nonatomic, copy, readwrite, nullable) NSString *viewGroup;
+
+/**
+ * If YES, the results are returned in the same order as the view group.
+ * In this case, any ORDER BY clause in the query is ignored.
+ *
+ * The default value is NO.
+ */
+@property (nonatomic, assign, readwrite) BOOL sortByViewOrder;
+
+/**
+ * The maximum number of results, applied after all of the filtering (including the view).
+ * Zero means no limit.
+ *
+ * The default value is zero.
+ */
+@property (nonatomic, assign, readwrite) NSUInteger limit;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,40 @@
+#import "YapDatabaseSecondaryIndexJoinedQuery.h"
+
+#if ! __has_feature(objc_arc)
+#warning This file must be compiled with ARC. Use -fobjc-arc flag (or convert project to ARC).
+#endif
+
+
+@implementation YapDatabaseSecondaryIndexJoinedQuery
+
+@synthesize query = query;
+@synthesize fullTextSearchName = fullTextSearchName;
+@synthesize fullTextSearchMatch = fullTextSearchMatch;
+@synthesize viewName = viewName;
+@synthesize viewGroup = viewGroup;
+@synthesize sortByViewOrder = sortByViewOrder;
+@synthesize limit = limit;
+
+- (instancetype)initWithQuery:(YapDatabaseQuery *)inQuery
+{
+	if ((self = [super init]))
+	{
+		query = inQuery;
+	}
+	return self;
+}
+
+- (id)copyWithZone:(NSZone __unused *)zone
+{
+	YapDatabaseSecondaryIndexJoinedQuery *copy = [[[self class] alloc] initWithQuery:query];
+	copy->fullTextSearchName = fullTextSearchName;
+	copy->fullTextSearchMatch = fullTextSearchMatch;
+	copy->viewName = viewName;
+	copy->viewGroup = viewGroup;
+	copy->sortByViewOrder = sortByViewOrder;
+	copy->limit = limit;
+	
+	return copy;
+}
+
+@end
@@ -17,6 +17,33 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @interface YapDatabaseSecondaryIndexOptions : NSObject <NSCopying>
 
+/**
+ * A secondary index can either be persistent (saved to sqlite), or non-persistent (kept in memory only).
+ *
+ * A persistent secondary index stores its values in an sqlite table (with an sqlite index per column).
+ * Thus it can be restored on subsequent app launches without re-population.
+ *
+ * A non-persistent secondary index keeps its values in memory, along with a sorted index for every indexed column.
+ * It's populated every time the extension is registered, and queries are executed without touching sqlite.
+ * This makes it a good fit for hot, read-heavy indexes over a modest number of rows.
+ *
+ * The in-memory query engine supports a subset of the queries that sqlite supports:
+ * 
+ * - WHERE clauses consisting of one or more terms joined by AND
+ * - terms of the form: column (=, ==, !=, <>, <, <=, >, >=) value
+ * - as well as: column [NOT] IN (...), column BETWEEN value AND value, column IS [NOT] NULL
+ * - where value is either a '?' parameter, a number, a 'string' or NULL
+ * - an optional ORDER BY clause with a single column (ASC or DESC)
+ * - an optional LIMIT (with optional OFFSET)
+ * - aggregate queries using count, min, max, sum, total or avg on a single column (or count(*))
+ *
+ * Queries outside this subset fail (and are logged as errors).
+ * Composite indexes (added via addIndexWithName:...) are ignored by a non-persistent secondary index.
+ *
+ * The default value is YES.
+ */
+@property (nonatomic, assign, readwrite) BOOL isPersistent;
+
 /**
  * You can configure the extension to pre-filter all but a subset of collections.
  *
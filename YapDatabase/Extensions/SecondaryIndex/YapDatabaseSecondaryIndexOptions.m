@@ -14,11 +14,22 @@
 **/
 @implementation YapDatabaseSecondaryIndexOptions
 
+@synthesize isPersistent = isPersistent;
 @synthesize allowedCollections = allowedCollections;
 
+- (id)init
+{
+	if ((self = [super init]))
+	{
+		isPersistent = YES;
+	}
+	return self;
+}
+
 - (id)copyWithZone:(NSZone __unused *)zone
 {
 	YapDatabaseSecondaryIndexOptions *copy = [[YapDatabaseSecondaryIndexOptions alloc] init];
+	copy->isPersistent = isPersistent;
 	copy->allowedCollections = allowedCollections;
 	
 	return copy;
@@ -0,0 +1,146 @@
+#import <Foundation/Foundation.h>
+
+@class YapDatabaseSecondaryIndexPreparedQuery;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Welcome to YapDatabase!
+ * https://github.com/yapstudios/YapDatabase
+ *
+ * The project wiki has a wealth of documentation if you have any questions.
+ * https://github.com/yapstudios/YapDatabase/wiki
+ *
+ * The builder describes the shape of a query (which columns are constrained, and how),
+ * without any of the values. It produces a YapDatabaseSecondaryIndexPreparedQuery,
+ * into which the values are then set (and changed) for every execution.
+ *
+ * For example:
+ * ```
+ * YapDatabaseSecondaryIndexQueryBuilder *builder = [[YapDatabaseSecondaryIndexQueryBuilder alloc] init];
+ *
+ * NSUInteger deptIdx   = [builder whereEqual:@"department"];
+ * NSUInteger salaryIdx = [builder whereRange:@"salary" inclusive:NO]; // salary >= ? AND salary < ?
+ * [builder orderBy:@"salary" ascending:NO];
+ * [builder limit:20];
+ *
+ * self.topEarnersQuery = [builder preparedQuery];
+ *
+ * // Later (and as often as needed):
+ *
+ * [self.topEarnersQuery setText:dept forParameterAtIndex:deptIdx];
+ * [self.topEarnersQuery setInteger:minSalary forParameterAtIndex:salaryIdx];
+ * [self.topEarnersQuery setInteger:maxSalary forParameterAtIndex:(salaryIdx + 1)];
+ *
+ * [[transaction ext:@"idx"] enumerateKeysMatchingPreparedQuery:self.topEarnersQuery usingBlock:...];
+ * ```
+ *
+ * Each "where" method appends a constraint (constraints are joined with AND),
+ * and returns the index of its first parameter.
+ */
+@interface YapDatabaseSecondaryIndexQueryBuilder : NSObject <NSCopying>
+
+/**
+ * Appends "column = ?".
+ * Uses 1 parameter.
+ */
+- (NSUInteger)whereEqual:(NSString *)column;
+
+/**
+ * Appends "column >= ? AND column < ?" (inclusive == NO),
+ * or "column BETWEEN ? AND ?" (inclusive == YES).
+ *
+ * Uses 2 parameters: the lower bound (at the returned index), followed by the upper bound.
+ */
+- (NSUInteger)whereRange:(NSString *)column inclusive:(BOOL)inclusive;
+
+/**
+ * Appends "column IN (?, ?, ...)".
+ * Uses count parameters.
+ *
+ * The number of values is part of the compiled statement, and thus fixed.
+ * If you need fewer values, set the remaining parameters to a duplicate value.
+ */
+- (NSUInteger)whereIn:(NSString *)column count:(NSUInteger)count;
+
+/**
+ * Appends a column to the ORDER BY clause.
+ * Multiple calls produce a multi-column sort (in the order of the calls).
+ *
+ * Note: A non-persistent secondary index only supports a single ORDER BY column.
+ * See YapDatabaseSecondaryIndexOptions.isPersistent for the supported subset of queries.
+ */
+- (void)orderBy:(NSString *)column ascending:(BOOL)ascending;
+
+/**
+ * Sets the LIMIT clause (zero means no limit, which is the default).
+ */
+- (void)limit:(NSUInteger)limit;
+
+/**
+ * The number of parameters used by the constraints so far.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfParameters;
+
+/**
+ * Creates a new prepared query from the current state of the builder.
+ * The builder may be changed (or reused) afterwards, without affecting the prepared query.
+ */
+- (YapDatabaseSecondaryIndexPreparedQuery *)preparedQuery;
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * A prepared query is the reusable, pre-compiled alternative to YapDatabaseQuery,
+ * intended for queries that are executed at a high frequency.
+ *
+ * A YapDatabaseQuery is a format string, so every execution has to build the full SQL string,
+ * look up the compiled statement in the queryCache (by hashing that string),
+ * and then bind each parameter according to its class.
+ *
+ * A prepared query skips all of that:
+ * - the SQL is generated once (by the builder)
+ * - every YapDatabaseSecondaryIndexConnection compiles the query (into an sqlite statement) the first time it's used,
+ *   and keeps the statement for as long as the prepared query exists (it doesn't occupy a slot in the queryCache)
+ * - values are set via typed setters, and bound to the statement without any class checks
+ *
+ * Unset parameters are bound as NULL.
+ *
+ * A prepared query may be used with any connection.
+ * However, the parameter values are stored within the prepared query,
+ * so the same instance must not be used on multiple threads (connections) concurrently.
+ */
+@interface YapDatabaseSecondaryIndexPreparedQuery : NSObject
+
+/**
+ * Everything after the "SELECT ... FROM 'tableName'" component.
+ * E.g. "WHERE "department" = ? ORDER BY "salary" DESC LIMIT 20"
+ */
+@property (nonatomic, copy, readonly) NSString *queryString;
+
+@property (nonatomic, readonly) NSUInteger numberOfParameters;
+
+- (void)setInteger:(int64_t)value forParameterAtIndex:(NSUInteger)idx;
+- (void)setDouble:(double)value forParameterAtIndex:(NSUInteger)idx;
+- (void)setText:(nullable NSString *)value forParameterAtIndex:(NSUInteger)idx;
+
+/**
+ * Dates are stored as a double (via timeIntervalSinceReferenceDate),
+ * which is the same conversion used by YapDatabaseQuery & YapDatabaseSecondaryIndexHandler.
+ */
+- (void)setDate:(nullable NSDate *)value forParameterAtIndex:(NSUInteger)idx;
+
+- (void)setNullForParameterAtIndex:(NSUInteger)idx;
+
+/**
+ * Sets every parameter back to NULL.
+ */
+- (void)clearParameters;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,339 @@
+#import "YapDatabaseSecondaryIndexPreparedQuery.h"
+#import "YapDatabaseSecondaryIndexPrivate.h"
+#import "YapDatabasePrivate.h"
+#import "YapDatabaseLogging.h"
+
+#if ! __has_feature(objc_arc)
+#warning This file must be compiled with ARC. Use -fobjc-arc flag (or convert project to ARC).
+#endif
+
+/**
+ * Define log level for this file: OFF, ERROR, WARN, INFO, VERBOSE
+ * See YapDatabaseLogging.h for more information.
+**/
+#if DEBUG
+  static const int ydbLogLevel = YDBLogLevelWarning;
+#else
+  static const int ydbLogLevel = YDBLogLevelWarning;
+#endif
+#pragma unused(ydbLogLevel)
+
+typedef NS_ENUM(uint8_t, YDBPreparedValueType) {
+	YDBPreparedValueTypeNull = 0,
+	YDBPreparedValueTypeInteger,
+	YDBPreparedValueTypeDouble,
+	YDBPreparedValueTypeText,
+};
+
+typedef struct YDBPreparedValue {
+	
+	YDBPreparedValueType type;
+	union {
+		int64_t integer;
+		double real;
+	};
+	
+} YDBPreparedValue;
+
+
+@implementation YapDatabaseSecondaryIndexQueryBuilder
+{
+	NSMutableArray<NSString *> *constraints;
+	NSMutableArray<NSString *> *orderings;
+	NSUInteger limit;
+	BOOL matchesNothing;
+}
+
+@synthesize numberOfParameters = numberOfParameters;
+
+- (instancetype)init
+{
+	if ((self = [super init]))
+	{
+		constraints = [[NSMutableArray alloc] init];
+		orderings = [[NSMutableArray alloc] init];
+	}
+	return self;
+}
+
+- (id)copyWithZone:(NSZone __unused *)zone
+{
+	YapDatabaseSecondaryIndexQueryBuilder *copy = [[[self class] alloc] init];
+	[copy->constraints addObjectsFromArray:constraints];
+	[copy->orderings addObjectsFromArray:orderings];
+	copy->limit = limit;
+	copy->numberOfParameters = numberOfParameters;
+	copy->matchesNothing = matchesNothing;
+	
+	return copy;
+}
+
+- (NSUInteger)whereEqual:(NSString *)column
+{
+	NSUInteger idx = numberOfParameters;
+	
+	[constraints addObject:[NSString stringWithFormat:@"\"%@\" = ?", column]];
+	numberOfParameters += 1;
+	
+	return idx;
+}
+
+- (NSUInteger)whereRange:(NSString *)column inclusive:(BOOL)inclusive
+{
+	NSUInteger idx = numberOfParameters;
+	
+	if (inclusive)
+		[constraints addObject:[NSString stringWithFormat:@"\"%@\" BETWEEN ? AND ?", column]];
+	else
+		[constraints addObject:[NSString stringWithFormat:@"\"%@\" >= ? AND \"%@\" < ?", column, column]];
+	
+	numberOfParameters += 2;
+	
+	return idx;
+}
+
+- (NSUInteger)whereIn:(NSString *)column count:(NSUInteger)count
+{
+	NSUInteger idx = numberOfParameters;
+	
+	if (count == 0)
+	{
+		// Matches nothing, just like "IN ()" in sqlite.
+		// The transaction skips such queries entirely (the non-persistent engine can't parse "WHERE 0").
+		[constraints addObject:@"0"];
+		matchesNothing = YES;
+		return idx;
+	}
+	
+	NSMutableString *constraint = [NSMutableString stringWithCapacity:(column.length + 8 + (count * 3))];
+	[constraint appendFormat:@"\"%@\" IN (?", column];
+	
+	for (NSUInteger i = 1; i < count; i++)
+	{
+		[constraint appendString:@", ?"];
+	}
+	[constraint appendString:@")"];
+	
+	[constraints addObject:constraint];
+	numberOfParameters += count;
+	
+	return idx;
+}
+
+- (void)orderBy:(NSString *)column ascending:(BOOL)ascending
+{
+	[orderings addObject:[NSString stringWithFormat:@"\"%@\" %@", column, (ascending ? @"ASC" : @"DESC")]];
+}
+
+- (void)limit:(NSUInteger)inLimit
+{
+	limit = inLimit;
+}
+
+- (YapDatabaseSecondaryIndexPreparedQuery *)preparedQuery
+{
+	NSString *whereString = @"";
+	if (constraints.count > 0)
+	{
+		whereString = [NSString stringWithFormat:@"WHERE %@", [constraints componentsJoinedByString:@" AND "]];
+	}
+	
+	NSMutableString *queryString = [whereString mutableCopy];
+	
+	if (orderings.count > 0)
+	{
+		if (queryString.length > 0) [queryString appendString:@" "];
+		[queryString appendFormat:@"ORDER BY %@", [orderings componentsJoinedByString:@", "]];
+	}
+	
+	if (limit > 0)
+	{
+		if (queryString.length > 0) [queryString appendString:@" "];
+		[queryString appendFormat:@"LIMIT %lu", (unsigned long)limit];
+	}
+	
+	return [[YapDatabaseSecondaryIndexPreparedQuery alloc] initWithQueryString:queryString
+	                                                               whereString:whereString
+	                                                        numberOfParameters:numberOfParameters
+	                                                            matchesNothing:matchesNothing];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation YapDatabaseSecondaryIndexPreparedQuery
+{
+	YDBPreparedValue *values;
+	NSMutableArray *textValues; // NSString (for YDBPreparedValueTypeText) || NSNull
+}
+
+@synthesize queryString = queryString;
+@synthesize numberOfParameters = numberOfParameters;
+
+- (instancetype)initWithQueryString:(NSString *)inQueryString
+                        whereString:(NSString *)inWhereString
+                 numberOfParameters:(NSUInteger)count
+                     matchesNothing:(BOOL)inMatchesNothing
+{
+	if ((self = [super init]))
+	{
+		queryString = [inQueryString copy];
+		whereString = [inWhereString copy];
+		numberOfParameters = count;
+		matchesNothing = inMatchesNothing;
+		
+		values = calloc(MAX(count, 1), sizeof(YDBPreparedValue));
+		
+		textValues = [[NSMutableArray alloc] initWithCapacity:count];
+		for (NSUInteger i = 0; i < count; i++)
+		{
+			[textValues addObject:[NSNull null]];
+		}
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	free(values);
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@ %p: %@>", [self class], self, queryString];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Parameters
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (BOOL)isValidParameterIndex:(NSUInteger)idx
+{
+	if (idx < numberOfParameters) return YES;
+	
+	YDBLogWarn(@"Parameter index (%lu) out of bounds for prepared query with %lu parameters: %@",
+	           (unsigned long)idx, (unsigned long)numberOfParameters, queryString);
+	return NO;
+}
+
+- (void)setInteger:(int64_t)value forParameterAtIndex:(NSUInteger)idx
+{
+	if (![self isValidParameterIndex:idx]) return;
+	
+	values[idx].type = YDBPreparedValueTypeInteger;
+	values[idx].integer = value;
+}
+
+- (void)setDouble:(double)value forParameterAtIndex:(NSUInteger)idx
+{
+	if (![self isValidParameterIndex:idx]) return;
+	
+	values[idx].type = YDBPreparedValueTypeDouble;
+	values[idx].real = value;
+}
+
+- (void)setText:(NSString *)value forParameterAtIndex:(NSUInteger)idx
+{
+	if (value == nil)
+	{
+		[self setNullForParameterAtIndex:idx];
+		return;
+	}
+	
+	if (![self isValidParameterIndex:idx]) return;
+	
+	values[idx].type = YDBPreparedValueTypeText;
+	textValues[idx] = [value copy];
+}
+
+- (void)setDate:(NSDate *)value forParameterAtIndex:(NSUInteger)idx
+{
+	if (value == nil)
+		[self setNullForParameterAtIndex:idx];
+	else
+		[self setDouble:[value timeIntervalSinceReferenceDate] forParameterAtIndex:idx];
+}
+
+- (void)setNullForParameterAtIndex:(NSUInteger)idx
+{
+	if (![self isValidParameterIndex:idx]) return;
+	
+	values[idx].type = YDBPreparedValueTypeNull;
+}
+
+- (void)clearParameters
+{
+	memset(values, 0, (MAX(numberOfParameters, 1) * sizeof(YDBPreparedValue)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Internal
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Binds every parameter to the given statement (which must have been compiled from queryString or whereString).
+ *
+ * Text is bound with SQLITE_STATIC, as the strings are retained by the prepared query.
+ * So the caller must clear the bindings before the prepared query (or its parameters) can change.
+**/
+- (void)bindParametersToStatement:(sqlite3_stmt *)statement
+{
+	int const bind_idx_start = SQLITE_BIND_START;
+	
+	for (NSUInteger i = 0; i < numberOfParameters; i++)
+	{
+		int bind_idx = bind_idx_start + (int)i;
+		
+		switch (values[i].type)
+		{
+			case YDBPreparedValueTypeInteger :
+			{
+				sqlite3_bind_int64(statement, bind_idx, (sqlite3_int64)values[i].integer);
+				break;
+			}
+			case YDBPreparedValueTypeDouble :
+			{
+				sqlite3_bind_double(statement, bind_idx, values[i].real);
+				break;
+			}
+			case YDBPreparedValueTypeText :
+			{
+				__unsafe_unretained NSString *text = (NSString *)textValues[i];
+				sqlite3_bind_text(statement, bind_idx, [text UTF8String], -1, SQLITE_STATIC);
+				break;
+			}
+			default :
+			{
+				// Statements start out (and are reset via sqlite3_clear_bindings) with NULL bindings.
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Returns the equivalent YapDatabaseQuery (with the current parameter values).
+ * Used by non-persistent secondary indexes, which don't have any sqlite statements.
+**/
+- (YapDatabaseQuery *)queryWithCurrentParameters
+{
+	NSMutableArray *parameters = [NSMutableArray arrayWithCapacity:numberOfParameters];
+	
+	for (NSUInteger i = 0; i < numberOfParameters; i++)
+	{
+		switch (values[i].type)
+		{
+			case YDBPreparedValueTypeInteger : [parameters addObject:@(values[i].integer)]; break;
+			case YDBPreparedValueTypeDouble  : [parameters addObject:@(values[i].real)];    break;
+			case YDBPreparedValueTypeText    : [parameters addObject:textValues[i]];         break;
+			default                          : [parameters addObject:[NSNull null]];         break;
+		}
+	}
+	
+	return [YapDatabaseQuery queryWithString:queryString parameters:parameters];
+}
+
+@end
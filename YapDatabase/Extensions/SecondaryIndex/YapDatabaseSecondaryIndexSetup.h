@@ -1,6 +1,8 @@
 #import <Foundation/Foundation.h>
 
 @class YapDatabaseSecondaryIndexColumn;
+@class YapDatabaseSecondaryIndexCompositeIndex;
+@class YapDatabaseSecondaryIndexAggregate;
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -18,19 +20,139 @@ typedef NS_ENUM(NSInteger, YapDatabaseSecondaryIndexType) {
 
 NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexType type);
 
+/**
+ * The functions supported by incrementally maintained aggregates.
+ * They have the same semantics as the corresponding sqlite aggregate functions.
+ * 
+ * @see YapDatabaseSecondaryIndexSetup addAggregateWithName:function:column:groupByColumn:
+ */
+typedef NS_ENUM(NSInteger, YapDatabaseSecondaryIndexAggregateFunction) {
+	YapDatabaseSecondaryIndexAggregateFunctionCount,
+	YapDatabaseSecondaryIndexAggregateFunctionSum,
+	YapDatabaseSecondaryIndexAggregateFunctionMin,
+	YapDatabaseSecondaryIndexAggregateFunctionMax
+};
+
+NSString* NSStringFromYapDatabaseSecondaryIndexAggregateFunction(YapDatabaseSecondaryIndexAggregateFunction function);
+
 
 @interface YapDatabaseSecondaryIndexSetup : NSObject <NSCopying, NSFastEnumeration>
 
 - (id)init;
 - (id)initWithCapacity:(NSUInteger)capacity;
 
+/**
+ * Adds a column to the secondary index table.
+ * 
+ * By default, every column gets its own single-column sqlite index (named after the column).
+ * If the column is only ever queried as part of a composite index (see below),
+ * then you can skip the single-column index by passing NO for the indexed parameter.
+ * Every index must be updated on every write, so unused indexes aren't free.
+ */
 - (void)addColumn:(NSString *)name withType:(YapDatabaseSecondaryIndexType)type;
+- (void)addColumn:(NSString *)name withType:(YapDatabaseSecondaryIndexType)type indexed:(BOOL)indexed;
 
 - (NSUInteger)count;
 - (nullable YapDatabaseSecondaryIndexColumn *)columnAtIndex:(NSUInteger)index;
 
 - (NSArray<NSString *> *)columnNames;
 
+/**
+ * Adds an additional sqlite index to the secondary index table.
+ * 
+ * The columns must have already been added to the setup (via addColumn:withType:).
+ * 
+ * @param name
+ *   The name of the sqlite index. This is the name you'll see in the output of EXPLAIN QUERY PLAN.
+ *   Keep in mind that sqlite index names are shared by all the tables in the database,
+ *   so the name should be unique across all your extensions.
+ *   
+ * @param columns
+ *   The (ordered) list of columns to index.
+ *   The order matters: equality constraints should come first, followed by range or ORDER BY columns.
+ *   For example, the query "WHERE accountId = ? AND unread = 1 ORDER BY date DESC"
+ *   is best served by an index on (accountId, unread, date).
+ *   
+ * @param coveringColumns
+ *   Optional additional columns to append to the index.
+ *   If every column a query references is in the index, sqlite can answer the query
+ *   from the index alone, without ever visiting the table ("USING COVERING INDEX").
+ *   
+ * @param predicate
+ *   An optional WHERE clause (without the "WHERE" keyword), which makes this a partial index.
+ *   Only rows matching the predicate are included in the index.
+ *   For example, @"unread = 1" keeps the index small if most items have been read.
+ *   Note that sqlite only uses a partial index if the query's WHERE clause implies the predicate.
+ * 
+ * Adding, changing or removing an index does NOT require a change to the versionTag.
+ * The indexes are migrated automatically (without re-populating the table) when the extension is registered.
+ * 
+ * @see YapDatabaseSecondaryIndexTransaction queryPlanForQuery:
+ */
+- (void)addIndexWithName:(NSString *)name columns:(NSArray<NSString *> *)columns;
+
+- (void)addIndexWithName:(NSString *)name
+                 columns:(NSArray<NSString *> *)columns
+         coveringColumns:(nullable NSArray<NSString *> *)coveringColumns
+               predicate:(nullable NSString *)predicate;
+
+/**
+ * The list of indexes added via addIndexWithName:...
+ */
+- (NSArray<YapDatabaseSecondaryIndexCompositeIndex *> *)indexes;
+
+/**
+ * Declares an aggregate (e.g. "SELECT folder, COUNT(unread) ... GROUP BY folder"),
+ * which is kept up-to-date incrementally as rows are inserted, updated & removed.
+ * 
+ * Reading an aggregate value is then a simple lookup (typically from the connection's cache),
+ * regardless of how many rows are in the group.
+ * And the changeset (the YapDatabaseModifiedNotification) reports which groups of the aggregate changed.
+ * 
+ * For example, "unread count per folder":
+ * 
+ * [setup addColumn:@"folder" withType:YapDatabaseSecondaryIndexTypeText];
+ * [setup addColumn:@"unread" withType:YapDatabaseSecondaryIndexTypeInteger]; // 1 or 0
+ * 
+ * [setup addAggregateWithName:@"unreadPerFolder"
+ *                    function:YapDatabaseSecondaryIndexAggregateFunctionSum
+ *                      column:@"unread"
+ *               groupByColumn:@"folder"];
+ * 
+ * NSNumber *unread = [[transaction ext:@"idx"] valueForAggregate:@"unreadPerFolder" group:@"inbox"];
+ * 
+ * @param name
+ *   The name of the aggregate, which is used to read its values.
+ * 
+ * @param function
+ *   The aggregate function.
+ *   Sum, min & max require a numeric column (integer, real or numeric).
+ * 
+ * @param column
+ *   The column to aggregate. As in sqlite, rows with a NULL value in this column are ignored.
+ *   For count, this may be nil, in which case every row in the group is counted (i.e. "COUNT(*)").
+ * 
+ * @param groupByColumn
+ *   The column to group by. Rows with a NULL value in this column aren't part of any group.
+ *   If the aggregate is queried frequently for groups that are often changed,
+ *   the groupByColumn should be indexed (this speeds up recalculating a min/max, after the min/max row is removed).
+ * 
+ * Adding, changing or removing an aggregate does NOT require a change to the versionTag.
+ * The aggregates are rebuilt automatically (from the existing table) when the extension is registered.
+ * 
+ * Note: A non-persistent secondary index (YapDatabaseSecondaryIndexOptions.isPersistent == NO)
+ * doesn't maintain its aggregates. It calculates them on demand, and doesn't report which groups changed.
+ */
+- (void)addAggregateWithName:(NSString *)name
+                    function:(YapDatabaseSecondaryIndexAggregateFunction)function
+                      column:(nullable NSString *)column
+               groupByColumn:(NSString *)groupByColumn;
+
+/**
+ * The list of aggregates added via addAggregateWithName:...
+ */
+- (NSArray<YapDatabaseSecondaryIndexAggregate *> *)aggregates;
+
 @end
 
 #pragma mark -
@@ -40,6 +162,36 @@ NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexTyp
 @property (nonatomic, copy, readonly) NSString *name;
 @property (nonatomic, assign, readonly) YapDatabaseSecondaryIndexType type;
 
+/**
+ * Whether or not the column has its own single-column sqlite index.
+ */
+@property (nonatomic, assign, readonly) BOOL indexed;
+
+@end
+
+#pragma mark -
+
+@interface YapDatabaseSecondaryIndexCompositeIndex : NSObject
+
+@property (nonatomic, copy, readonly) NSString *name;
+
+@property (nonatomic, copy, readonly) NSArray<NSString *> *columns;
+@property (nonatomic, copy, readonly) NSArray<NSString *> *coveringColumns;
+
+@property (nonatomic, copy, readonly, nullable) NSString *predicate;
+
+@end
+
+#pragma mark -
+
+@interface YapDatabaseSecondaryIndexAggregate : NSObject
+
+@property (nonatomic, copy, readonly) NSString *name;
+@property (nonatomic, assign, readonly) YapDatabaseSecondaryIndexAggregateFunction function;
+
+@property (nonatomic, copy, readonly, nullable) NSString *column;
+@property (nonatomic, copy, readonly) NSString *groupByColumn;
+
 @end
 
 NS_ASSUME_NONNULL_END
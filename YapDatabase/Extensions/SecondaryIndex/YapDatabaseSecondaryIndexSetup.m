@@ -30,8 +30,34 @@ NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexTyp
 	}
 }
 
+NSString* NSStringFromYapDatabaseSecondaryIndexAggregateFunction(YapDatabaseSecondaryIndexAggregateFunction function)
+{
+	switch (function)
+	{
+		case YapDatabaseSecondaryIndexAggregateFunctionCount : return @"COUNT";
+		case YapDatabaseSecondaryIndexAggregateFunctionSum   : return @"SUM";
+		case YapDatabaseSecondaryIndexAggregateFunctionMin   : return @"MIN";
+		case YapDatabaseSecondaryIndexAggregateFunctionMax   : return @"MAX";
+		default                                              : return @"UNKNOWN";
+	}
+}
+
 @interface YapDatabaseSecondaryIndexColumn ()
-- (id)initWithName:(NSString *)name type:(YapDatabaseSecondaryIndexType)type;
+- (id)initWithName:(NSString *)name type:(YapDatabaseSecondaryIndexType)type indexed:(BOOL)indexed;
+@end
+
+@interface YapDatabaseSecondaryIndexCompositeIndex ()
+- (id)initWithName:(NSString *)name
+           columns:(NSArray<NSString *> *)columns
+   coveringColumns:(NSArray<NSString *> *)coveringColumns
+         predicate:(NSString *)predicate;
+@end
+
+@interface YapDatabaseSecondaryIndexAggregate ()
+- (id)initWithName:(NSString *)name
+          function:(YapDatabaseSecondaryIndexAggregateFunction)function
+            column:(NSString *)column
+     groupByColumn:(NSString *)groupByColumn;
 @end
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -41,6 +67,8 @@ NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexTyp
 @implementation YapDatabaseSecondaryIndexSetup
 {
 	NSMutableArray *setup;
+	NSMutableArray *indexes;
+	NSMutableArray *aggregates;
 }
 
 - (id)init
@@ -56,6 +84,9 @@ NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexTyp
 			setup = [[NSMutableArray alloc] initWithCapacity:capacity];
 		else
 			setup = [[NSMutableArray alloc] init];
+		
+		indexes = [[NSMutableArray alloc] init];
+		aggregates = [[NSMutableArray alloc] init];
 	}
 	return self;
 }
@@ -95,7 +126,36 @@ NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexTyp
 	return NO;
 }
 
+- (BOOL)isExistingIndexName:(NSString *)indexName
+{
+	// SQLite index names are not case sensitive.
+	// Indexed columns get an index with the same name as the column.
+	
+	for (YapDatabaseSecondaryIndexColumn *column in setup)
+	{
+		if (column.indexed && [column.name caseInsensitiveCompare:indexName] == NSOrderedSame)
+		{
+			return YES;
+		}
+	}
+	
+	for (YapDatabaseSecondaryIndexCompositeIndex *index in indexes)
+	{
+		if ([index.name caseInsensitiveCompare:indexName] == NSOrderedSame)
+		{
+			return YES;
+		}
+	}
+	
+	return NO;
+}
+
 - (void)addColumn:(NSString *)columnName withType:(YapDatabaseSecondaryIndexType)type
+{
+	[self addColumn:columnName withType:type indexed:YES];
+}
+
+- (void)addColumn:(NSString *)columnName withType:(YapDatabaseSecondaryIndexType)type indexed:(BOOL)indexed
 {
 	if (columnName == nil)
 	{
@@ -121,6 +181,14 @@ NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexTyp
 		return;
 	}
 	
+	if (indexed && [self isExistingIndexName:columnName])
+	{
+		NSAssert(NO, @"Invalid columnName: an index with the same name already exists");
+		
+		YDBLogError(@"Invalid columnName: an index with the same name already exists");
+		return;
+	}
+	
 	if (type != YapDatabaseSecondaryIndexTypeInteger &&
 	    type != YapDatabaseSecondaryIndexTypeReal    &&
 	    type != YapDatabaseSecondaryIndexTypeNumeric &&
@@ -134,7 +202,7 @@ NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexTyp
 	}
 	
 	YapDatabaseSecondaryIndexColumn *column =
-	    [[YapDatabaseSecondaryIndexColumn alloc] initWithName:columnName type:type];
+	    [[YapDatabaseSecondaryIndexColumn alloc] initWithName:columnName type:type indexed:indexed];
 	
 	[setup addObject:column];
 }
@@ -164,10 +232,195 @@ NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexTyp
 	return [columnNames copy];
 }
 
+- (void)addIndexWithName:(NSString *)indexName columns:(NSArray<NSString *> *)columns
+{
+	[self addIndexWithName:indexName columns:columns coveringColumns:nil predicate:nil];
+}
+
+- (void)addIndexWithName:(NSString *)indexName
+                 columns:(NSArray<NSString *> *)columns
+         coveringColumns:(NSArray<NSString *> *)coveringColumns
+               predicate:(NSString *)predicate
+{
+	if (indexName == nil)
+	{
+		NSAssert(NO, @"Invalid indexName: nil");
+		
+		YDBLogError(@"Invalid indexName: nil");
+		return;
+	}
+	
+	if ([self isExistingIndexName:indexName])
+	{
+		NSAssert(NO, @"Invalid indexName: indexName already exists");
+		
+		YDBLogError(@"Invalid indexName: indexName already exists");
+		return;
+	}
+	
+	if ([columns count] == 0)
+	{
+		NSAssert(NO, @"Invalid columns: empty");
+		
+		YDBLogError(@"Invalid columns: empty");
+		return;
+	}
+	
+	NSMutableArray *allColumns = [NSMutableArray arrayWithArray:columns];
+	if (coveringColumns) {
+		[allColumns addObjectsFromArray:coveringColumns];
+	}
+	
+	for (NSUInteger i = 0; i < [allColumns count]; i++)
+	{
+		NSString *columnName = allColumns[i];
+		
+		if (![self isExistingName:columnName])
+		{
+			NSAssert(NO, @"Invalid columns: unknown column(%@)", columnName);
+			
+			YDBLogError(@"Invalid columns: unknown column(%@)", columnName);
+			return;
+		}
+		
+		for (NSUInteger j = 0; j < i; j++)
+		{
+			if ([allColumns[j] caseInsensitiveCompare:columnName] == NSOrderedSame)
+			{
+				NSAssert(NO, @"Invalid columns: duplicate column(%@)", columnName);
+				
+				YDBLogError(@"Invalid columns: duplicate column(%@)", columnName);
+				return;
+			}
+		}
+	}
+	
+	if (predicate && [[predicate stringByTrimmingCharactersInSet:
+	                   [NSCharacterSet whitespaceAndNewlineCharacterSet]] length] == 0)
+	{
+		predicate = nil;
+	}
+	
+	YapDatabaseSecondaryIndexCompositeIndex *index =
+	  [[YapDatabaseSecondaryIndexCompositeIndex alloc] initWithName:indexName
+	                                                        columns:columns
+	                                                coveringColumns:(coveringColumns ?: @[])
+	                                                      predicate:predicate];
+	
+	[indexes addObject:index];
+}
+
+- (NSArray<YapDatabaseSecondaryIndexCompositeIndex *> *)indexes
+{
+	return [indexes copy];
+}
+
+- (YapDatabaseSecondaryIndexColumn *)columnWithName:(NSString *)columnName
+{
+	for (YapDatabaseSecondaryIndexColumn *column in setup)
+	{
+		if ([column.name caseInsensitiveCompare:columnName] == NSOrderedSame)
+		{
+			return column;
+		}
+	}
+	
+	return nil;
+}
+
+- (void)addAggregateWithName:(NSString *)aggregateName
+                    function:(YapDatabaseSecondaryIndexAggregateFunction)function
+                      column:(NSString *)columnName
+               groupByColumn:(NSString *)groupByColumnName
+{
+	if ([aggregateName length] == 0)
+	{
+		NSAssert(NO, @"Invalid aggregateName: nil");
+		
+		YDBLogError(@"Invalid aggregateName: nil");
+		return;
+	}
+	
+	for (YapDatabaseSecondaryIndexAggregate *aggregate in aggregates)
+	{
+		if ([aggregate.name isEqualToString:aggregateName])
+		{
+			NSAssert(NO, @"Invalid aggregateName: aggregateName already exists");
+			
+			YDBLogError(@"Invalid aggregateName: aggregateName already exists");
+			return;
+		}
+	}
+	
+	if (function != YapDatabaseSecondaryIndexAggregateFunctionCount &&
+	    function != YapDatabaseSecondaryIndexAggregateFunctionSum   &&
+	    function != YapDatabaseSecondaryIndexAggregateFunctionMin   &&
+	    function != YapDatabaseSecondaryIndexAggregateFunctionMax    )
+	{
+		NSAssert(NO, @"Invalid function");
+		
+		YDBLogError(@"Invalid function");
+		return;
+	}
+	
+	YapDatabaseSecondaryIndexColumn *groupByColumn = groupByColumnName ? [self columnWithName:groupByColumnName] : nil;
+	if (groupByColumn == nil)
+	{
+		NSAssert(NO, @"Invalid groupByColumn: unknown column(%@)", groupByColumnName);
+		
+		YDBLogError(@"Invalid groupByColumn: unknown column(%@)", groupByColumnName);
+		return;
+	}
+	
+	YapDatabaseSecondaryIndexColumn *column = nil;
+	if (columnName)
+	{
+		column = [self columnWithName:columnName];
+		if (column == nil)
+		{
+			NSAssert(NO, @"Invalid column: unknown column(%@)", columnName);
+			
+			YDBLogError(@"Invalid column: unknown column(%@)", columnName);
+			return;
+		}
+	}
+	
+	if (function != YapDatabaseSecondaryIndexAggregateFunctionCount)
+	{
+		if (column == nil ||
+		   (column.type != YapDatabaseSecondaryIndexTypeInteger &&
+		    column.type != YapDatabaseSecondaryIndexTypeReal    &&
+		    column.type != YapDatabaseSecondaryIndexTypeNumeric  ))
+		{
+			NSAssert(NO, @"Invalid column: %@ requires a numeric column",
+			         NSStringFromYapDatabaseSecondaryIndexAggregateFunction(function));
+			
+			YDBLogError(@"Invalid column: %@ requires a numeric column",
+			            NSStringFromYapDatabaseSecondaryIndexAggregateFunction(function));
+			return;
+		}
+	}
+	
+	YapDatabaseSecondaryIndexAggregate *aggregate =
+	  [[YapDatabaseSecondaryIndexAggregate alloc] initWithName:aggregateName
+	                                                  function:function
+	                                                    column:column.name
+	                                             groupByColumn:groupByColumn.name];
+	
+	[aggregates addObject:aggregate];
+}
+
+- (NSArray<YapDatabaseSecondaryIndexAggregate *> *)aggregates
+{
+	return [aggregates copy];
+}
+
 - (id)copyWithZone:(NSZone __unused *)zone
 {
 	YapDatabaseSecondaryIndexSetup *copy = [[YapDatabaseSecondaryIndexSetup alloc] initForCopy];
 	copy->setup = [setup mutableCopy];
+	copy->indexes = [indexes mutableCopy];
+	copy->aggregates = [aggregates mutableCopy];
 	
 	return copy;
 }
@@ -242,13 +495,15 @@ NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexTyp
 
 @synthesize name = name;
 @synthesize type = type;
+@synthesize indexed = indexed;
 
-- (id)initWithName:(NSString *)inName type:(YapDatabaseSecondaryIndexType)inType
+- (id)initWithName:(NSString *)inName type:(YapDatabaseSecondaryIndexType)inType indexed:(BOOL)inIndexed
 {
 	if ((self = [super init]))
 	{
 		name = [inName copy];
 		type = inType;
+		indexed = inIndexed;
 	}
 	return self;
 }
@@ -257,7 +512,84 @@ NSString* NSStringFromYapDatabaseSecondaryIndexType(YapDatabaseSecondaryIndexTyp
 {
 	NSString *typeStr = NSStringFromYapDatabaseSecondaryIndexType(type);
 	
-	return [NSString stringWithFormat:@"<YapDatabaseSecondaryIndexColumn: name(%@), type(%@)>", name, typeStr];
+	return [NSString stringWithFormat:@"<YapDatabaseSecondaryIndexColumn: name(%@), type(%@), indexed(%@)>",
+	                                   name, typeStr, (indexed ? @"YES" : @"NO")];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation YapDatabaseSecondaryIndexCompositeIndex
+
+@synthesize name = name;
+@synthesize columns = columns;
+@synthesize coveringColumns = coveringColumns;
+@synthesize predicate = predicate;
+
+- (id)initWithName:(NSString *)inName
+           columns:(NSArray<NSString *> *)inColumns
+   coveringColumns:(NSArray<NSString *> *)inCoveringColumns
+         predicate:(NSString *)inPredicate
+{
+	if ((self = [super init]))
+	{
+		name = [inName copy];
+		columns = [inColumns copy];
+		coveringColumns = [inCoveringColumns copy];
+		predicate = [inPredicate copy];
+	}
+	return self;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:
+	  @"<YapDatabaseSecondaryIndexCompositeIndex: name(%@), columns(%@), coveringColumns(%@), predicate(%@)>",
+	  name,
+	  [columns componentsJoinedByString:@", "],
+	  [coveringColumns componentsJoinedByString:@", "],
+	  predicate];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation YapDatabaseSecondaryIndexAggregate
+
+@synthesize name = name;
+@synthesize function = function;
+@synthesize column = column;
+@synthesize groupByColumn = groupByColumn;
+
+- (id)initWithName:(NSString *)inName
+          function:(YapDatabaseSecondaryIndexAggregateFunction)inFunction
+            column:(NSString *)inColumn
+     groupByColumn:(NSString *)inGroupByColumn
+{
+	if ((self = [super init]))
+	{
+		name = [inName copy];
+		function = inFunction;
+		column = [inColumn copy];
+		groupByColumn = [inGroupByColumn copy];
+	}
+	return self;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:
+	  @"<YapDatabaseSecondaryIndexAggregate: name(%@), function(%@), column(%@), groupByColumn(%@)>",
+	  name,
+	  NSStringFromYapDatabaseSecondaryIndexAggregateFunction(function),
+	  (column ?: @"*"),
+	  groupByColumn];
 }
 
 @end
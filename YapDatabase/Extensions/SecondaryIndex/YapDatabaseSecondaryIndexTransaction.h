@@ -2,6 +2,8 @@
 
 #import "YapDatabaseExtensionTransaction.h"
 #import "YapDatabaseQuery.h"
+#import "YapDatabaseSecondaryIndexPreparedQuery.h"
+#import "YapDatabaseSecondaryIndexJoinedQuery.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -69,6 +71,88 @@ NS_REFINED_FOR_SWIFT;
  */
 - (BOOL)getNumberOfRows:(NSUInteger *)count matchingQuery:(YapDatabaseQuery *)query NS_REFINED_FOR_SWIFT;
 
+/**
+ * These methods are the equivalent of the methods above, for a YapDatabaseSecondaryIndexPreparedQuery.
+ *
+ * Use them for queries that are executed at a high frequency:
+ * the SQL is generated once, the compiled statement is kept by the connection,
+ * and the parameter values are bound without any type checks.
+ *
+ * For example:
+ *
+ * YapDatabaseSecondaryIndexQueryBuilder *builder = [[YapDatabaseSecondaryIndexQueryBuilder alloc] init];
+ * NSUInteger ageIdx = [builder whereRange:@"age" inclusive:YES];
+ *
+ * YapDatabaseSecondaryIndexPreparedQuery *query = [builder preparedQuery]; // Keep this around
+ *
+ * [query setInteger:18 forParameterAtIndex:ageIdx];
+ * [query setInteger:35 forParameterAtIndex:(ageIdx + 1)];
+ *
+ * [[transaction ext:@"idx"] enumerateKeysMatchingPreparedQuery:query
+ *                                                       usingBlock:^(NSString *collection, NSString *key, BOOL *stop) {
+ *
+ *     // ...
+ * }];
+ *
+ * getNumberOfRows:matchingPreparedQuery: ignores the ORDER BY & LIMIT clauses of the query.
+ *
+ * @return NO if there was a problem with the given query. YES otherwise.
+ *
+ * @see YapDatabaseSecondaryIndexQueryBuilder
+ */
+- (BOOL)enumerateKeysMatchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+                                usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block;
+
+- (BOOL)enumerateKeysAndMetadataMatchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+                                           usingBlock:
+            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, __nullable id metadata, BOOL *stop))block;
+
+- (BOOL)enumerateKeysAndObjectsMatchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+                                          usingBlock:
+                         (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, BOOL *stop))block;
+
+- (BOOL)enumerateRowsMatchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+                                usingBlock:
+       (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, __nullable id metadata, BOOL *stop))block;
+
+- (BOOL)getNumberOfRows:(NSUInteger *)count matchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query;
+
+/**
+ * Joined queries combine the secondary index with a full text search query, and/or view membership.
+ * The full text search table is joined (on rowid) within sqlite, and the results are streamed.
+ * 
+ * For example, "unread messages in account X, matching 'invoice', in inbox order":
+ * 
+ * query = [YapDatabaseQuery queryWithFormat:@"WHERE accountId = ? AND unread = 1", accountId];
+ * 
+ * joinedQuery = [[YapDatabaseSecondaryIndexJoinedQuery alloc] initWithQuery:query];
+ * joinedQuery.fullTextSearchName = @"fts";
+ * joinedQuery.fullTextSearchMatch = @"invoice";
+ * joinedQuery.viewName = @"messages";
+ * joinedQuery.viewGroup = @"inbox";
+ * joinedQuery.sortByViewOrder = YES;
+ * 
+ * [[transaction ext:@"idx"] enumerateKeysMatchingJoinedQuery:joinedQuery usingBlock:...];
+ * 
+ * @return NO if there was a problem with the given query. YES otherwise.
+ * 
+ * @see YapDatabaseSecondaryIndexJoinedQuery
+ */
+- (BOOL)enumerateKeysMatchingJoinedQuery:(YapDatabaseSecondaryIndexJoinedQuery *)query
+                              usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block;
+
+- (BOOL)enumerateKeysAndMetadataMatchingJoinedQuery:(YapDatabaseSecondaryIndexJoinedQuery *)query
+                                         usingBlock:
+            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, __nullable id metadata, BOOL *stop))block;
+
+- (BOOL)enumerateKeysAndObjectsMatchingJoinedQuery:(YapDatabaseSecondaryIndexJoinedQuery *)query
+                                        usingBlock:
+                         (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, BOOL *stop))block;
+
+- (BOOL)enumerateRowsMatchingJoinedQuery:(YapDatabaseSecondaryIndexJoinedQuery *)query
+                              usingBlock:
+       (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, __nullable id metadata, BOOL *stop))block;
+
 /**
  * Aggregate Queries.
  * 
@@ -79,6 +163,56 @@ NS_REFINED_FOR_SWIFT;
  */
 - (nullable id)performAggregateQuery:(YapDatabaseQuery *)query;
 
+/**
+ * Returns the current value of an aggregate (declared in the setup) for the given group.
+ * Or nil if the group is empty.
+ * 
+ * Unlike performAggregateQuery:, the aggregates are maintained incrementally as rows change,
+ * so this is a simple lookup (and the values are cached by the connection).
+ * 
+ * For example:
+ * 
+ * NSNumber *unread = [[transaction ext:@"idx"] valueForAggregate:@"unreadPerFolder" group:@"inbox"];
+ * 
+ * @see YapDatabaseSecondaryIndexSetup addAggregateWithName:function:column:groupByColumn:
+ */
+- (nullable NSNumber *)valueForAggregate:(NSString *)aggregateName group:(id)group;
+
+/**
+ * Enumerates every (non-empty) group of an aggregate, along with its current value.
+ * The groups are enumerated in no particular order.
+ */
+- (void)enumerateValuesForAggregate:(NSString *)aggregateName
+                         usingBlock:(void (NS_NOESCAPE^)(id group, NSNumber *value, BOOL *stop))block;
+
+/**
+ * Returns the output of sqlite's "EXPLAIN QUERY PLAN" for the given query.
+ * This allows you to confirm that a query is being served by the index you expect.
+ * 
+ * For example:
+ * 
+ * query = [YapDatabaseQuery queryWithFormat:@"WHERE accountId = ? AND unread = 1 ORDER BY date DESC", accountId];
+ * NSLog(@"%@", [[transaction ext:@"idx"] queryPlanForQuery:query]);
+ * 
+ * // SEARCH idx_table USING INDEX unread_by_date (accountId=? AND unread=?)
+ * 
+ * Things to look for:
+ * - "USING INDEX <name>" or "USING COVERING INDEX <name>" : the query uses the named index
+ * - "SCAN <table>" : the query visits every row in the table
+ * - "USE TEMP B-TREE FOR ORDER BY" : the results are sorted after the fact (no index covers the ORDER BY)
+ * 
+ * The exact output format is determined by sqlite, and may differ between sqlite versions.
+ * So this method is intended for debugging & unit tests, and not for making decisions at runtime.
+ * 
+ * For a non-persistent index (YapDatabaseSecondaryIndexOptions.isPersistent == NO),
+ * the plan describes the in-memory engine instead. E.g. "SEARCH MEMORY INDEX date (date>?)".
+ * 
+ * @return The query plan (one line per step), or nil if there was a problem with the given query.
+ * 
+ * @see YapDatabaseSecondaryIndexSetup addIndexWithName:columns:coveringColumns:predicate:
+ */
+- (nullable NSString *)queryPlanForQuery:(YapDatabaseQuery *)query;
+
 /**
  * This method assists in performing a query over a subset of rows,
  * where the subset is a known set of keys.
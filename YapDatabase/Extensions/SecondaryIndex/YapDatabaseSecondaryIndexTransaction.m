@@ -1,9 +1,12 @@
 #import "YapDatabaseSecondaryIndexTransaction.h"
 #import "YapDatabaseSecondaryIndexPrivate.h"
 #import "YapDatabaseStatement.h"
+#import "YapDatabaseString.h"
 
 #import "YapDatabasePrivate.h"
 #import "YapDatabaseExtensionPrivate.h"
+#import "YapDatabaseFullTextSearchPrivate.h"
+#import "YapDatabaseViewTransaction.h"
 
 #import "YapDatabaseLogging.h"
 
@@ -25,6 +28,151 @@
 static NSString *const ext_key_classVersion       = @"classVersion";
 static NSString *const ext_key_versionTag         = @"versionTag";
 static NSString *const ext_key_version_deprecated = @"version";
+static NSString *const ext_key_aggregates         = @"aggregates";
+
+/**
+ * Pending changes are flushed to the table once there are this many of them,
+ * which bounds the memory used by large transactions (such as populating the table).
+**/
+static NSUInteger const kMaxPendingChanges = 1000;
+
+/**
+ * Non-persistent secondary indexes store a single (immutable) YapDatabaseSecondaryIndexMemoryStore
+ * in their memory table, under this key.
+**/
+static NSString *const memory_key_store = @"store";
+
+/**
+ * View membership & order are read from the view's (private) rowid based methods.
+ * YapDatabaseViewPrivate.h can't be imported here, as it defines the same ext_key constants as this file.
+**/
+@interface YapDatabaseViewTransaction (SecondaryIndexJoinedQuery)
+
+- (NSString *)groupForRowid:(int64_t)rowid;
+
+- (void)enumerateRowidsInGroup:(NSString *)group
+                    usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, NSUInteger index, BOOL *stop))block;
+
+@end
+
+/**
+ * The net change to a single group of an aggregate.
+ * Deltas are accumulated while flushing the pending changes, and then applied to the aggregates table.
+**/
+@interface YapDatabaseSecondaryIndexAggregateDelta : NSObject {
+@public
+	
+	int64_t count;      // change to the number of rows in the group
+	
+	int64_t integerSum; // sum: change to the sum of the integer values
+	double realSum;     // sum: change to the sum of the real values
+	BOOL hasRealSum;
+	
+	NSNumber *added;    // min/max: the min/max of the added values
+	NSNumber *removed;  // min/max: the min/max of the removed values
+}
+
+- (void)addValue:(id)value function:(YapDatabaseSecondaryIndexAggregateFunction)function;
+- (void)removeValue:(id)value function:(YapDatabaseSecondaryIndexAggregateFunction)function;
+
+@end
+
+/**
+ * Returns YES if the number is a new min (or max) compared to the current extreme (which may be nil).
+**/
+static BOOL IsExtreme(NSNumber *number, NSNumber *extreme, YapDatabaseSecondaryIndexAggregateFunction function)
+{
+	if (extreme == nil) return YES;
+	
+	if (function == YapDatabaseSecondaryIndexAggregateFunctionMin)
+		return ([number compare:extreme] == NSOrderedAscending);
+	else
+		return ([number compare:extreme] == NSOrderedDescending);
+}
+
+@implementation YapDatabaseSecondaryIndexAggregateDelta
+
+- (void)addValue:(id)value function:(YapDatabaseSecondaryIndexAggregateFunction)function
+{
+	count++;
+	
+	if (function == YapDatabaseSecondaryIndexAggregateFunctionSum)
+	{
+		__unsafe_unretained NSNumber *number = (NSNumber *)value;
+		
+		if (CFNumberIsFloatType((__bridge CFNumberRef)number)) {
+			realSum += [number doubleValue];
+			hasRealSum = YES;
+		}
+		else {
+			integerSum += [number longLongValue];
+		}
+	}
+	else if (function != YapDatabaseSecondaryIndexAggregateFunctionCount)
+	{
+		if (IsExtreme(value, added, function)) added = value;
+	}
+}
+
+- (void)removeValue:(id)value function:(YapDatabaseSecondaryIndexAggregateFunction)function
+{
+	count--;
+	
+	if (function == YapDatabaseSecondaryIndexAggregateFunctionSum)
+	{
+		__unsafe_unretained NSNumber *number = (NSNumber *)value;
+		
+		if (CFNumberIsFloatType((__bridge CFNumberRef)number)) {
+			realSum -= [number doubleValue];
+			hasRealSum = YES;
+		}
+		else {
+			integerSum -= [number longLongValue];
+		}
+	}
+	else if (function != YapDatabaseSecondaryIndexAggregateFunctionCount)
+	{
+		if (IsExtreme(value, removed, function)) removed = value;
+	}
+}
+
+@end
+
+/**
+ * Returns the value of the given column (of the current row), or nil if it's NULL.
+**/
+static id ColumnValue(sqlite3_stmt *statement, int column_idx)
+{
+	switch (sqlite3_column_type(statement, column_idx))
+	{
+		case SQLITE_INTEGER :
+		{
+			return @((int64_t)sqlite3_column_int64(statement, column_idx));
+		}
+		case SQLITE_FLOAT :
+		{
+			return @(sqlite3_column_double(statement, column_idx));
+		}
+		case SQLITE_TEXT :
+		{
+			const unsigned char *text = sqlite3_column_text(statement, column_idx);
+			int textSize = sqlite3_column_bytes(statement, column_idx);
+			
+			return [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+		}
+		case SQLITE_BLOB :
+		{
+			const void *blob = sqlite3_column_blob(statement, column_idx);
+			int blobSize = sqlite3_column_bytes(statement, column_idx);
+			
+			return [[NSData alloc] initWithBytes:blob length:blobSize];
+		}
+		default :
+		{
+			return nil;
+		}
+	}
+}
 
 
 @implementation YapDatabaseSecondaryIndexTransaction
@@ -36,6 +184,11 @@ static NSString *const ext_key_version_deprecated = @"version";
 	{
 		parentConnection = inParentConnection;
 		databaseTransaction = inDatabaseTransaction;
+		
+		if (![self isPersistent])
+		{
+			memoryTableTransaction = [databaseTransaction memoryTableTransaction:[self tableName]];
+		}
 	}
 	return self;
 }
@@ -52,6 +205,32 @@ static NSString *const ext_key_version_deprecated = @"version";
 **/
 - (BOOL)createIfNeeded
 {
+	if (![self isPersistent])
+	{
+		// We're registering an In-Memory-Only secondary index (non-persistent) (not stored in the database).
+		// So we can skip all the checks because we know we need to create (and populate) the memory table.
+		
+		if (![self createMemoryTable]) return NO;
+		if (![self populate]) return NO;
+		
+		NSString *versionTag = parentConnection->parent->versionTag;
+		[self setStringValue:versionTag forExtensionKey:ext_key_versionTag persistent:NO];
+		
+		// If there was a previously registered persistent secondary index with this name,
+		// then we should drop its table from the database.
+		
+		BOOL dropPersistentTable = [self getIntValue:NULL forExtensionKey:ext_key_classVersion persistent:YES];
+		if (dropPersistentTable)
+		{
+			[[parentConnection->parent class]
+			  dropTablesForRegisteredName:[self registeredName]
+			              withTransaction:(YapDatabaseReadWriteTransaction *)databaseTransaction
+			                wasPersistent:YES];
+		}
+		
+		return YES;
+	}
+	
 	int oldClassVersion = 0;
 	BOOL hasOldClassVersion = [self getIntValue:&oldClassVersion forExtensionKey:ext_key_classVersion persistent:YES];
 	
@@ -119,7 +298,8 @@ static NSString *const ext_key_version_deprecated = @"version";
 		//
 		// For this extension, that means you MUST change the version if ANY of the following are true:
 		//
-		// - you changed the setup
+		// - you changed the columns in the setup
+		//   (changes to the indexes are the exception, as they are migrated automatically - see migrateIndexes)
 		// - you changed the block in any meaningful way (which would result in different values for any existing row)
 		//
 		// Note: The code below detects only changes to the setup.
@@ -156,6 +336,15 @@ static NSString *const ext_key_version_deprecated = @"version";
 			}
 		}
 		#endif
+		
+		// Changes to the indexes don't require a change to the versionTag,
+		// as they don't affect the values stored in the table.
+		
+		if (![self migrateIndexes]) return NO;
+		
+		// Same goes for the aggregates, which are derived from the table.
+		
+		if (![self migrateAggregates]) return NO;
 	}
 	
 	return YES;
@@ -197,7 +386,7 @@ static NSString *const ext_key_version_deprecated = @"version";
 		return NO;
 	}
 	
-	return YES;
+	return [self dropAggregatesTable];
 }
 
 /**
@@ -252,18 +441,114 @@ static NSString *const ext_key_version_deprecated = @"version";
 		return NO;
 	}
 	
+	NSDictionary<NSString*, NSString*> *indexDefinitions = [self indexDefinitions];
+	
+	for (NSString *indexName in indexDefinitions)
+	{
+		if (![self createIndex:indexName withDefinition:indexDefinitions[indexName]]) return NO;
+	}
+	
+	// The (empty) aggregates are maintained as the table is populated
+	
+	return [self createAggregatesTableAndRebuild:NO];
+}
+
+/**
+ * Internal method.
+ *
+ * This method is called to create the memory table for a non-persistent secondary index.
+**/
+- (BOOL)createMemoryTable
+{
+	NSString *tableName = [self tableName];
+	
+	YapMemoryTable *memoryTable = [[YapMemoryTable alloc] initWithKeyClass:[NSString class]];
+	
+	if (![databaseTransaction->connection registerMemoryTable:memoryTable withName:tableName])
+	{
+		YDBLogError(@"Failed registering memory table (%@)", tableName);
+		return NO;
+	}
+	
+	memoryTableTransaction = [databaseTransaction memoryTableTransaction:tableName];
+	return YES;
+}
+
+/**
+ * Internal method.
+ *
+ * Returns the CREATE INDEX statement for every index in the setup, keyed by index name.
+ *
+ * The statements are in the same form that sqlite stores in the sqlite_master table
+ * (no "IF NOT EXISTS", no trailing semicolon), so they can be compared against the existing indexes.
+**/
+- (NSDictionary<NSString*, NSString*> *)indexDefinitions
+{
+	NSString *tableName = [self tableName];
+	YapDatabaseSecondaryIndexSetup *setup = parentConnection->parent->setup;
+	
+	NSMutableDictionary<NSString*, NSString*> *indexDefinitions = [NSMutableDictionary dictionary];
+	
+	// CREATE INDEX "column" ON "tableName" ("column")
+	
 	for (YapDatabaseSecondaryIndexColumn *column in setup)
 	{
-		NSString *createIndex =
-		    [NSString stringWithFormat:@"CREATE INDEX IF NOT EXISTS \"%@\" ON \"%@\" (\"%@\");",
+		if (!column.indexed) continue;
+		
+		indexDefinitions[column.name] =
+		    [NSString stringWithFormat:@"CREATE INDEX \"%@\" ON \"%@\" (\"%@\")",
 		        column.name, tableName, column.name];
+	}
+	
+	// CREATE INDEX "name" ON "tableName" ("column1", "column2", "covering1") WHERE predicate
+	
+	for (YapDatabaseSecondaryIndexCompositeIndex *index in [setup indexes])
+	{
+		NSMutableString *createIndex = [NSMutableString stringWithCapacity:100];
+		[createIndex appendFormat:@"CREATE INDEX \"%@\" ON \"%@\" (", index.name, tableName];
 		
-		status = sqlite3_exec(db, [createIndex UTF8String], NULL, NULL, NULL);
-		if (status != SQLITE_OK)
+		NSArray *columnNames = [index.columns arrayByAddingObjectsFromArray:index.coveringColumns];
+		
+		for (NSUInteger i = 0; i < [columnNames count]; i++)
 		{
-			YDBLogError(@"Failed creating index on '%@': %d %s", column.name, status, sqlite3_errmsg(db));
-			return NO;
+			if (i == 0)
+				[createIndex appendFormat:@"\"%@\"", columnNames[i]];
+			else
+				[createIndex appendFormat:@", \"%@\"", columnNames[i]];
 		}
+		
+		[createIndex appendString:@")"];
+		
+		if (index.predicate) {
+			[createIndex appendFormat:@" WHERE %@", index.predicate];
+		}
+		
+		indexDefinitions[index.name] = [createIndex copy];
+	}
+	
+	return indexDefinitions;
+}
+
+/**
+ * Internal method.
+ *
+ * Executes the given index definition (as returned by the indexDefinitions method).
+**/
+- (BOOL)createIndex:(NSString *)indexName withDefinition:(NSString *)indexDefinition
+{
+	sqlite3 *db = databaseTransaction->connection->db;
+	
+	// CREATE INDEX ... -> CREATE INDEX IF NOT EXISTS ...
+	
+	NSString *prefix = @"CREATE INDEX ";
+	NSString *createIndex = [NSString stringWithFormat:@"CREATE INDEX IF NOT EXISTS %@;",
+	                          [indexDefinition substringFromIndex:[prefix length]]];
+	
+	int status = sqlite3_exec(db, [createIndex UTF8String], NULL, NULL, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Failed creating index '%@': %d %s", indexName, status, sqlite3_errmsg(db));
+		return NO;
 	}
 	
 	return YES;
@@ -272,97 +557,371 @@ static NSString *const ext_key_version_deprecated = @"version";
 /**
  * Internal method.
  *
- * This method is called, if needed, to populate the FTS indexes.
- * It does so by enumerating the rows in the database, and invoking the usual blocks and insertion methods.
+ * Compares the indexes of the existing table against the setup,
+ * and drops/creates indexes as needed such that they match.
+ * The table itself (and its content) is untouched, so there's no need to re-populate.
+ *
+ * This handles tables created by older versions of the setup,
+ * including those from before composite/partial/covering indexes were supported.
 **/
-- (BOOL)populate
+- (BOOL)migrateIndexes
 {
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+	sqlite3 *db = databaseTransaction->connection->db;
+	NSString *tableName = [self tableName];
 	
-	// Remove everything from the database
+	NSDictionary<NSString*, NSString*> *indexDefinitions = [self indexDefinitions];
 	
-	[self removeAllRowids];
+	// Fetch existing indexes.
+	// Automatic indexes (for UNIQUE/PRIMARY KEY constraints) have a NULL sql column.
 	
-	// Enumerate the existing rows in the database and populate the indexes
+	NSMutableDictionary<NSString*, NSString*> *existingDefinitions = [NSMutableDictionary dictionary];
 	
-	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
-	__unsafe_unretained YapWhitelistBlacklist *allowedCollections = secondaryIndex->options.allowedCollections;
+	sqlite3_stmt *statement = NULL;
+	const char *stmt = "SELECT \"name\", \"sql\" FROM \"sqlite_master\""
+	                   " WHERE \"type\" = 'index' AND \"tbl_name\" = ? AND \"sql\" IS NOT NULL;";
 	
-	YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
-	YapDatabaseBlockType blockType = handler->blockType;
+	int status = sqlite3_prepare_v2(db, stmt, (int)strlen(stmt)+1, &statement, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error creating statement (sqlite_master): %d %s", status, sqlite3_errmsg(db));
+		return NO;
+	}
 	
-	if (blockType == YapDatabaseBlockTypeWithKey)
+	YapDatabaseString _tableName; MakeYapDatabaseString(&_tableName, tableName);
+	sqlite3_bind_text(statement, SQLITE_BIND_START, _tableName.str, _tableName.length, SQLITE_STATIC);
+	
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
 	{
-		__unsafe_unretained YapDatabaseSecondaryIndexWithKeyBlock secondaryIndexBlock =
-		    (YapDatabaseSecondaryIndexWithKeyBlock)handler->block;
+		const unsigned char *text;
+		int textSize;
 		
-		void (^enumBlock)(int64_t rowid, NSString *collection, NSString *key, BOOL *stop);
-		enumBlock = ^(int64_t rowid, NSString *collection, NSString *key, BOOL __unused *stop) {
-			
-			secondaryIndexBlock(databaseTransaction, parentConnection->blockDict, collection, key);
-			
-			if ([parentConnection->blockDict count] > 0)
-			{
-				[self addRowid:rowid isNew:YES];
-				[parentConnection->blockDict removeAllObjects];
-			}
-		};
+		text = sqlite3_column_text(statement, SQLITE_COLUMN_START + 0);
+		textSize = sqlite3_column_bytes(statement, SQLITE_COLUMN_START + 0);
 		
-		if (allowedCollections)
-		{
-			[databaseTransaction enumerateCollectionsUsingBlock:^(NSString *collection, BOOL __unused *stop) {
-				
-				if ([allowedCollections isAllowed:collection])
-				{
-					[databaseTransaction _enumerateKeysInCollections:@[ collection ] usingBlock:enumBlock];
-				}
-			}];
-		}
-		else // if (!allowedCollections)
-		{
-			[databaseTransaction _enumerateKeysInAllCollectionsUsingBlock:enumBlock];
+		NSString *indexName = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+		
+		text = sqlite3_column_text(statement, SQLITE_COLUMN_START + 1);
+		textSize = sqlite3_column_bytes(statement, SQLITE_COLUMN_START + 1);
+		
+		NSString *indexDefinition = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+		
+		if (indexName && indexDefinition) {
+			existingDefinitions[indexName] = indexDefinition;
 		}
 	}
-	else if (blockType == YapDatabaseBlockTypeWithObject)
+	
+	if (status != SQLITE_DONE)
 	{
-		__unsafe_unretained YapDatabaseSecondaryIndexWithObjectBlock secondaryIndexBlock =
-		    (YapDatabaseSecondaryIndexWithObjectBlock)handler->block;
+		YDBLogError(@"Error executing statement (sqlite_master): %d %s", status, sqlite3_errmsg(db));
+	}
+	
+	sqlite3_finalize(statement);
+	FreeYapDatabaseString(&_tableName);
+	
+	if (status != SQLITE_DONE) return NO;
+	
+	// Drop indexes that were removed or changed (before creating any, in case only the case of a name changed)
+	
+	for (NSString *indexName in existingDefinitions)
+	{
+		if ([indexDefinitions[indexName] isEqualToString:existingDefinitions[indexName]]) continue;
 		
-		void (^enumBlock)(int64_t rowid, NSString *collection, NSString *key, id object, BOOL *stop);
-		enumBlock = ^(int64_t rowid, NSString *collection, NSString *key, id object, BOOL __unused *stop) {
-			
-			secondaryIndexBlock(databaseTransaction, parentConnection->blockDict, collection, key, object);
-			
-			if ([parentConnection->blockDict count] > 0)
-			{
-				[self addRowid:rowid isNew:YES];
-				[parentConnection->blockDict removeAllObjects];
-			}
-		};
+		YDBLogInfo(@"Dropping secondary index '%@' on table: %@", indexName, tableName);
 		
-		if (allowedCollections)
-		{
-			[databaseTransaction enumerateCollectionsUsingBlock:^(NSString *collection, BOOL __unused *stop) {
-				
-				if ([allowedCollections isAllowed:collection])
-				{
-					[databaseTransaction _enumerateKeysAndObjectsInCollections:@[ collection ]
-					                                                usingBlock:enumBlock];
-				}
-			}];
-		}
-		else // if (!allowedCollections)
+		NSString *dropIndex = [NSString stringWithFormat:@"DROP INDEX IF EXISTS \"%@\";", indexName];
+		
+		status = sqlite3_exec(db, [dropIndex UTF8String], NULL, NULL, NULL);
+		if (status != SQLITE_OK)
 		{
-			[databaseTransaction _enumerateKeysAndObjectsInAllCollectionsUsingBlock:enumBlock];
+			YDBLogError(@"Failed dropping index '%@': %d %s", indexName, status, sqlite3_errmsg(db));
+			return NO;
 		}
 	}
-	else if (blockType == YapDatabaseBlockTypeWithMetadata)
+	
+	for (NSString *indexName in indexDefinitions)
 	{
-		__unsafe_unretained YapDatabaseSecondaryIndexWithMetadataBlock secondaryIndexBlock =
-		    (YapDatabaseSecondaryIndexWithMetadataBlock)handler->block;
+		if ([indexDefinitions[indexName] isEqualToString:existingDefinitions[indexName]]) continue;
 		
-		void (^enumBlock)(int64_t rowid, NSString *collection, NSString *key, id metadata, BOOL *stop);
+		YDBLogInfo(@"Creating secondary index '%@' on table: %@", indexName, tableName);
+		
+		if (![self createIndex:indexName withDefinition:indexDefinitions[indexName]]) return NO;
+	}
+	
+	return YES;
+}
+
+/**
+ * Internal method.
+ *
+ * Returns the query used to (re)build every aggregate in the setup from the table, keyed by aggregate name.
+ * The query has a single parameter (the name of the aggregate),
+ * and selects the columns of the aggregates table: ("name", "group", "value", "count").
+**/
+- (NSDictionary<NSString*, NSString*> *)aggregateDefinitions
+{
+	NSString *tableName = [self tableName];
+	YapDatabaseSecondaryIndexSetup *setup = parentConnection->parent->setup;
+	
+	NSMutableDictionary<NSString*, NSString*> *aggregateDefinitions = [NSMutableDictionary dictionary];
+	
+	// SELECT ?, "group", FUNCTION("column"), COUNT("column") FROM "tableName"
+	//   WHERE "group" IS NOT NULL AND "column" IS NOT NULL GROUP BY "group"
+	
+	for (YapDatabaseSecondaryIndexAggregate *aggregate in [setup aggregates])
+	{
+		NSString *function = NSStringFromYapDatabaseSecondaryIndexAggregateFunction(aggregate.function);
+		
+		NSMutableString *query = [NSMutableString stringWithCapacity:200];
+		
+		if (aggregate.column)
+		{
+			[query appendFormat:@"SELECT ?, \"%@\", %@(\"%@\"), COUNT(\"%@\") FROM \"%@\""
+			                    @" WHERE \"%@\" IS NOT NULL AND \"%@\" IS NOT NULL",
+			  aggregate.groupByColumn, function, aggregate.column, aggregate.column, tableName,
+			  aggregate.groupByColumn, aggregate.column];
+		}
+		else
+		{
+			[query appendFormat:@"SELECT ?, \"%@\", COUNT(*), COUNT(*) FROM \"%@\" WHERE \"%@\" IS NOT NULL",
+			  aggregate.groupByColumn, tableName, aggregate.groupByColumn];
+		}
+		
+		[query appendFormat:@" GROUP BY \"%@\"", aggregate.groupByColumn];
+		
+		aggregateDefinitions[aggregate.name] = [query copy];
+	}
+	
+	return aggregateDefinitions;
+}
+
+/**
+ * Internal method.
+ *
+ * Returns a string describing every aggregate in the setup (stored in the yap2 table),
+ * which is used to detect changes to the aggregates between launches.
+**/
+- (NSString *)aggregatesVersion
+{
+	NSDictionary<NSString*, NSString*> *aggregateDefinitions = [self aggregateDefinitions];
+	
+	NSMutableArray<NSString *> *lines = [NSMutableArray arrayWithCapacity:[aggregateDefinitions count]];
+	
+	for (NSString *aggregateName in aggregateDefinitions)
+	{
+		[lines addObject:[NSString stringWithFormat:@"%@: %@", aggregateName, aggregateDefinitions[aggregateName]]];
+	}
+	
+	[lines sortUsingSelector:@selector(compare:)];
+	return [lines componentsJoinedByString:@"\n"];
+}
+
+- (BOOL)dropAggregatesTable
+{
+	sqlite3 *db = databaseTransaction->connection->db;
+	
+	NSString *aggregatesTableName = [parentConnection->parent aggregatesTableName];
+	NSString *dropTable = [NSString stringWithFormat:@"DROP TABLE IF EXISTS \"%@\";", aggregatesTableName];
+	
+	int status = sqlite3_exec(db, [dropTable UTF8String], NULL, NULL, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Failed dropping aggregates table (%@): %d %s", dropTable, status, sqlite3_errmsg(db));
+		return NO;
+	}
+	
+	[self removeValueForExtensionKey:ext_key_aggregates persistent:YES];
+	return YES;
+}
+
+/**
+ * Internal method.
+ *
+ * Creates the aggregates table (if the setup has any aggregates).
+ * If rebuild is YES, the aggregates are calculated from the (already populated) table.
+**/
+- (BOOL)createAggregatesTableAndRebuild:(BOOL)rebuild
+{
+	NSDictionary<NSString*, NSString*> *aggregateDefinitions = [self aggregateDefinitions];
+	if ([aggregateDefinitions count] == 0) return YES;
+	
+	sqlite3 *db = databaseTransaction->connection->db;
+	NSString *aggregatesTableName = [parentConnection->parent aggregatesTableName];
+	
+	YDBLogVerbose(@"Creating aggregates table for registeredName(%@): %@", [self registeredName], aggregatesTableName);
+	
+	// Note: Rows with a NULL group aren't part of any group, so the group is never NULL.
+	
+	NSString *createTable = [NSString stringWithFormat:
+	  @"CREATE TABLE IF NOT EXISTS \"%@\""
+	  @" (\"name\" TEXT NOT NULL, \"group\" NOT NULL, \"value\", \"count\" INTEGER NOT NULL,"
+	  @" PRIMARY KEY (\"name\", \"group\")) WITHOUT ROWID;", aggregatesTableName];
+	
+	int status = sqlite3_exec(db, [createTable UTF8String], NULL, NULL, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Failed creating aggregates table (%@): %d %s", aggregatesTableName, status, sqlite3_errmsg(db));
+		return NO;
+	}
+	
+	if (rebuild)
+	{
+		for (NSString *aggregateName in aggregateDefinitions)
+		{
+			NSString *insert = [NSString stringWithFormat:
+			  @"INSERT INTO \"%@\" (\"name\", \"group\", \"value\", \"count\") %@;",
+			  aggregatesTableName, aggregateDefinitions[aggregateName]];
+			
+			sqlite3_stmt *statement = NULL;
+			
+			status = sqlite3_prepare_v2(db, [insert UTF8String], -1, &statement, NULL);
+			if (status != SQLITE_OK)
+			{
+				YDBLogError(@"Error creating statement (%@): %d %s", insert, status, sqlite3_errmsg(db));
+				return NO;
+			}
+			
+			YapDatabaseString _name; MakeYapDatabaseString(&_name, aggregateName);
+			sqlite3_bind_text(statement, SQLITE_BIND_START, _name.str, _name.length, SQLITE_STATIC);
+			
+			status = sqlite3_step(statement);
+			if (status != SQLITE_DONE)
+			{
+				YDBLogError(@"Error rebuilding aggregate '%@': %d %s", aggregateName, status, sqlite3_errmsg(db));
+			}
+			
+			sqlite3_finalize(statement);
+			FreeYapDatabaseString(&_name);
+			
+			if (status != SQLITE_DONE) return NO;
+		}
+	}
+	
+	[self setStringValue:[self aggregatesVersion] forExtensionKey:ext_key_aggregates persistent:YES];
+	return YES;
+}
+
+/**
+ * Internal method.
+ *
+ * Compares the aggregates of the existing table against the setup.
+ * If they changed, the aggregates are rebuilt (from the existing table, within sqlite).
+ * The table itself (and its content) is untouched, so there's no need to re-populate.
+**/
+- (BOOL)migrateAggregates
+{
+	NSString *oldVersion = [self stringValueForExtensionKey:ext_key_aggregates persistent:YES] ?: @"";
+	NSString *version = [self aggregatesVersion];
+	
+	if ([oldVersion isEqualToString:version]) return YES;
+	
+	YDBLogInfo(@"Rebuilding aggregates for registeredName(%@)", [self registeredName]);
+	
+	if (![self dropAggregatesTable]) return NO;
+	if (![self createAggregatesTableAndRebuild:YES]) return NO;
+	
+	return YES;
+}
+
+/**
+ * Internal method.
+ *
+ * This method is called, if needed, to populate the FTS indexes.
+ * It does so by enumerating the rows in the database, and invoking the usual blocks and insertion methods.
+**/
+- (BOOL)populate
+{
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+	
+	// Remove everything from the database
+	
+	[self removeAllRowids];
+	
+	// For a non-persistent secondary index, the sorted (per-column) indexes are built once at the end,
+	// rather than being updated at every flush. The columns are sorted in parallel.
+	
+	YapDatabaseSecondaryIndexMemoryStore *memoryStore = memoryTableTransaction ? [self mutableMemoryStore] : nil;
+	[memoryStore beginBulkLoad];
+	
+	// Enumerate the existing rows in the database and populate the indexes
+	
+	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	__unsafe_unretained YapWhitelistBlacklist *allowedCollections = secondaryIndex->options.allowedCollections;
+	
+	YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	YapDatabaseBlockType blockType = handler->blockType;
+	
+	if (blockType == YapDatabaseBlockTypeWithKey)
+	{
+		__unsafe_unretained YapDatabaseSecondaryIndexWithKeyBlock secondaryIndexBlock =
+		    (YapDatabaseSecondaryIndexWithKeyBlock)handler->block;
+		
+		void (^enumBlock)(int64_t rowid, NSString *collection, NSString *key, BOOL *stop);
+		enumBlock = ^(int64_t rowid, NSString *collection, NSString *key, BOOL __unused *stop) {
+			
+			secondaryIndexBlock(databaseTransaction, parentConnection->blockDict, collection, key);
+			
+			if ([parentConnection->blockDict count] > 0)
+			{
+				[self addRowid:rowid isNew:YES];
+				[parentConnection->blockDict removeAllObjects];
+			}
+		};
+		
+		if (allowedCollections)
+		{
+			[databaseTransaction enumerateCollectionsUsingBlock:^(NSString *collection, BOOL __unused *stop) {
+				
+				if ([allowedCollections isAllowed:collection])
+				{
+					[databaseTransaction _enumerateKeysInCollections:@[ collection ] usingBlock:enumBlock];
+				}
+			}];
+		}
+		else // if (!allowedCollections)
+		{
+			[databaseTransaction _enumerateKeysInAllCollectionsUsingBlock:enumBlock];
+		}
+	}
+	else if (blockType == YapDatabaseBlockTypeWithObject)
+	{
+		__unsafe_unretained YapDatabaseSecondaryIndexWithObjectBlock secondaryIndexBlock =
+		    (YapDatabaseSecondaryIndexWithObjectBlock)handler->block;
+		
+		void (^enumBlock)(int64_t rowid, NSString *collection, NSString *key, id object, BOOL *stop);
+		enumBlock = ^(int64_t rowid, NSString *collection, NSString *key, id object, BOOL __unused *stop) {
+			
+			secondaryIndexBlock(databaseTransaction, parentConnection->blockDict, collection, key, object);
+			
+			if ([parentConnection->blockDict count] > 0)
+			{
+				[self addRowid:rowid isNew:YES];
+				[parentConnection->blockDict removeAllObjects];
+			}
+		};
+		
+		if (allowedCollections)
+		{
+			[databaseTransaction enumerateCollectionsUsingBlock:^(NSString *collection, BOOL __unused *stop) {
+				
+				if ([allowedCollections isAllowed:collection])
+				{
+					[databaseTransaction _enumerateKeysAndObjectsInCollections:@[ collection ]
+					                                                usingBlock:enumBlock];
+				}
+			}];
+		}
+		else // if (!allowedCollections)
+		{
+			[databaseTransaction _enumerateKeysAndObjectsInAllCollectionsUsingBlock:enumBlock];
+		}
+	}
+	else if (blockType == YapDatabaseBlockTypeWithMetadata)
+	{
+		__unsafe_unretained YapDatabaseSecondaryIndexWithMetadataBlock secondaryIndexBlock =
+		    (YapDatabaseSecondaryIndexWithMetadataBlock)handler->block;
+		
+		void (^enumBlock)(int64_t rowid, NSString *collection, NSString *key, id metadata, BOOL *stop);
 		enumBlock = ^(int64_t rowid, NSString *collection, NSString *key, id metadata, BOOL __unused *stop) {
 			
 			secondaryIndexBlock(databaseTransaction, parentConnection->blockDict, collection, key, metadata);
@@ -423,8 +982,11 @@ static NSString *const ext_key_version_deprecated = @"version";
 		}
 	}
 	
-	return YES;
+	[self flushPendingChanges];
+	[memoryStore endBulkLoad];
 	
+	return YES;
+
 #pragma clang diagnostic pop
 }
 
@@ -458,731 +1020,1822 @@ static NSString *const ext_key_version_deprecated = @"version";
 	return [parentConnection->parent tableName];
 }
 
+- (BOOL)isPersistent
+{
+	return parentConnection->parent->options.isPersistent;
+}
+
+/**
+ * Non-persistent only.
+ *
+ * Returns the store as seen by this transaction.
+ * Within a readWriteTransaction, this includes any (flushed) changes made by the transaction.
+**/
+- (YapDatabaseSecondaryIndexMemoryStore *)memoryStore
+{
+	if (parentConnection->memoryStore)
+		return parentConnection->memoryStore;
+	else
+		return [memoryTableTransaction objectForKey:memory_key_store];
+}
+
+/**
+ * Non-persistent only.
+ *
+ * Returns the mutable store for the current readWriteTransaction (creating it if needed).
+ * This is a copy-on-write copy of the most recent snapshot, so it's cheap to create.
+ * The changes are written back to the memory table (as a new snapshot) in flushPendingChangesToExtensionTables.
+**/
+- (YapDatabaseSecondaryIndexMemoryStore *)mutableMemoryStore
+{
+	if (parentConnection->memoryStore == nil)
+	{
+		YapDatabaseSecondaryIndexMemoryStore *store = [memoryTableTransaction objectForKey:memory_key_store];
+		
+		if (store)
+			parentConnection->memoryStore = [store mutableCopy];
+		else
+			parentConnection->memoryStore =
+			  [[YapDatabaseSecondaryIndexMemoryStore alloc] initWithSetup:parentConnection->parent->setup];
+	}
+	
+	return parentConnection->memoryStore;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Logic
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
  * Adds a row to the table, using the given rowid along with the values in the 'blockDict' ivar.
+ *
+ * The write is deferred until flushPendingChanges is invoked.
+ * This allows multiple changes to the same row (within the same transaction) to result in a single write,
+ * and allows the writes to be performed in rowid order (which is friendlier to the sqlite b-tree).
 **/
 - (void)addRowid:(int64_t)rowid isNew:(BOOL)isNew
 {
 	YDBLogAutoTrace();
 	
-	sqlite3_stmt *statement = NULL;
-	if (isNew)
-		statement = [parentConnection insertStatement];
-	else
-		statement = [parentConnection updateStatement];
+	NSNumber *number = @(rowid);
 	
-	if (statement == NULL)
-		return;
+	if (isNew && ([parentConnection->pendingChanges objectForKey:number] == nil))
+	{
+		// The row isn't in the table, so there's nothing to compare against (or replace) during the flush.
+		// Note: If there's a pending remove for this rowid, then the old row is still in the table.
+		
+		[parentConnection->pendingInserts addObject:number];
+	}
 	
-	//  isNew : INSERT            INTO "tableName" ("rowid", "column1", "column2", ...) VALUES (?, ?, ? ...);
-	// !isNew : INSERT OR REPLACE INTO "tableName" ("rowid", "column1", "column2", ...) VALUES (?, ?, ? ...);
+	[parentConnection->pendingChanges setObject:[parentConnection->blockDict copy] forKey:number];
 	
-	int bind_idx = SQLITE_BIND_START;
+	[parentConnection->mutationStack markAsMutated];
 	
-	sqlite3_bind_int64(statement, bind_idx, rowid);
-	bind_idx++;
+	if ([parentConnection->pendingChanges count] >= kMaxPendingChanges)
+	{
+		[self flushPendingChanges];
+	}
+}
+
+- (void)removeRowid:(int64_t)rowid
+{
+	YDBLogAutoTrace();
 	
-	for (YapDatabaseSecondaryIndexColumn *column in parentConnection->parent->setup)
+	NSNumber *number = @(rowid);
+	
+	if ([parentConnection->pendingInserts containsObject:number])
 	{
-		id columnValue = [parentConnection->blockDict objectForKey:column.name];
-		if (columnValue && columnValue != [NSNull null])
-		{
-			if (column.type == YapDatabaseSecondaryIndexTypeInteger ||
-			    column.type == YapDatabaseSecondaryIndexTypeReal    ||
-			    column.type == YapDatabaseSecondaryIndexTypeNumeric  )
-			{
-				if ([columnValue isKindOfClass:[NSNumber class]])
-				{
-					__unsafe_unretained NSNumber *number = (NSNumber *)columnValue;
-					
-					CFNumberType numberType = CFNumberGetType((CFNumberRef)number);
-					
-					if (numberType == kCFNumberFloat32Type ||
-						numberType == kCFNumberFloat64Type ||
-						numberType == kCFNumberFloatType   ||
-						numberType == kCFNumberDoubleType  ||
-						numberType == kCFNumberCGFloatType  )
-					{
-						double num = [number doubleValue];
-						sqlite3_bind_double(statement, bind_idx, num);
-					}
-					else
-					{
-						int64_t num = [number longLongValue];
-						sqlite3_bind_int64(statement, bind_idx, (sqlite3_int64)num);
-					}
-				}
-				else if ([columnValue isKindOfClass:[NSDate class]])
-				{
-					__unsafe_unretained NSDate *date = (NSDate *)columnValue;
-					
-					double num = [date timeIntervalSinceReferenceDate];
-					sqlite3_bind_double(statement, bind_idx, num);
-				}
-				else
-				{
-					YDBLogWarn(@"Unable to bind value for column(name=%@, type=%@) with unsupported class: %@."
-					           @" Column requires NSNumber or NSDate.",
-					           column.name,
-					           NSStringFromYapDatabaseSecondaryIndexType(column.type),
-					           NSStringFromClass([columnValue class]));
-				}
-			}
-			else if (column.type == YapDatabaseSecondaryIndexTypeText)
-			{
-				if ([columnValue isKindOfClass:[NSString class]])
-				{
-					__unsafe_unretained NSString *string = (NSString *)columnValue;
-					
-					sqlite3_bind_text(statement, bind_idx, [string UTF8String], -1, SQLITE_TRANSIENT);
-				}
-				else
-				{
-					YDBLogWarn(@"Unable to bind value for column(name=%@, type=text) with unsupported class: %@."
-					           @" Column requires NSString.",
-					           column.name, NSStringFromClass([columnValue class]));
-				}
-			}
-			else if (column.type == YapDatabaseSecondaryIndexTypeBlob)
-			{
-				if ([columnValue isKindOfClass:[NSData class]])
-				{
-					__unsafe_unretained NSData *data = (NSData *)columnValue;
-					
-					sqlite3_bind_blob(statement, bind_idx, [data bytes], (int)[data length], SQLITE_STATIC);
-				}
-				else
-				{
-					YDBLogWarn(@"Unable to bind value for column(name=%@, type=text) with unsupported class: %@."
-					           @" Column requires NSData.",
-					           column.name, NSStringFromClass([columnValue class]));
-				}
-			}
-		}
+		// The row was added during this transaction, and was never written to the table.
 		
-		bind_idx++;
+		[parentConnection->pendingInserts removeObject:number];
+		[parentConnection->pendingChanges removeObjectForKey:number];
 	}
-	
-	int status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
+	else
 	{
-		YDBLogError(@"Error executing '%s': %d %s",
-		            isNew ? "insertStatement" : "updateStatement",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		[parentConnection->pendingChanges setObject:[NSNull null] forKey:number];
 	}
 	
-	sqlite3_clear_bindings(statement);
-	sqlite3_reset(statement);
-	
 	[parentConnection->mutationStack markAsMutated];
+	
+	if ([parentConnection->pendingChanges count] >= kMaxPendingChanges)
+	{
+		[self flushPendingChanges];
+	}
 }
 
-- (void)removeRowid:(int64_t)rowid
+- (void)removeRowids:(NSArray *)rowids
 {
 	YDBLogAutoTrace();
 	
-	sqlite3_stmt *statement = [parentConnection removeStatement];
-	if (statement == NULL) return;
-	
-	// DELETE FROM "tableName" WHERE "rowid" = ?;
-	
-	int const bind_idx_rowid = SQLITE_BIND_START;
-	
-	sqlite3_bind_int64(statement, bind_idx_rowid, rowid);
-	
-	int status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
+	for (NSNumber *number in rowids)
 	{
-		YDBLogError(@"Error executing 'removeStatement': %d %s",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		[self removeRowid:[number longLongValue]];
 	}
-	
-	sqlite3_clear_bindings(statement);
-	sqlite3_reset(statement);
-	
-	[parentConnection->mutationStack markAsMutated];
 }
 
-- (void)removeRowids:(NSArray *)rowids
+/**
+ * Writes all pending changes to the table (in rowid order).
+ *
+ * This method is invoked from flushPendingChangesToExtensionTables,
+ * as well as before executing any query (so queries within a readWriteTransaction see its changes).
+**/
+- (void)flushPendingChanges
 {
 	YDBLogAutoTrace();
 	
-	NSUInteger count = [rowids count];
+	NSMutableDictionary<NSNumber*, id> *pendingChanges = parentConnection->pendingChanges;
+	NSMutableSet<NSNumber*> *pendingInserts = parentConnection->pendingInserts;
+	
+	if ([pendingChanges count] == 0) return;
 	
-	if (count == 0) return;
-	if (count == 1)
+	if (memoryTableTransaction)
 	{
-		int64_t rowid = [[rowids objectAtIndex:0] longLongValue];
+		// Non-persistent: there's no table, and the store skips rows that didn't change on its own.
 		
-		[self removeRowid:rowid];
+		[[self mutableMemoryStore] applyChanges:pendingChanges];
+		
+		[pendingChanges removeAllObjects];
+		[pendingInserts removeAllObjects];
 		return;
 	}
 	
-	// DELETE FROM "tableName" WHERE "rowid" in (?, ?, ...);
-	//
-	// Note: We don't have to worry sqlite's max number of host parameters.
-	// YapDatabase gives us the rowids in batches where each batch is already capped at this number.
+	// If the setup has aggregates, then we need the old & new values of every changed row.
+	// The deltas are accumulated (per group), and applied once all the rows have been written.
 	
-	NSUInteger capacity = 50 + (count * 3);
-	NSMutableString *query = [NSMutableString stringWithCapacity:capacity];
+	NSArray<YapDatabaseSecondaryIndexAggregate *> *aggregates = [parentConnection->parent->setup aggregates];
+	NSMutableDictionary *aggregateDeltas = ([aggregates count] > 0) ? [NSMutableDictionary dictionary] : nil;
 	
-	[query appendFormat:@"DELETE FROM \"%@\" WHERE \"rowid\" IN (", [self tableName]];
+	NSArray<NSNumber*> *rowids = [[pendingChanges allKeys] sortedArrayUsingSelector:@selector(compare:)];
 	
-	NSUInteger i;
-	for (i = 0; i < count; i++)
+	for (NSNumber *number in rowids)
 	{
-		if (i == 0)
-			[query appendString:@"?"];
-		else
-			[query appendString:@", ?"];
+		int64_t rowid = [number longLongValue];
+		id change = [pendingChanges objectForKey:number];
+		
+		if (change == [NSNull null])
+		{
+			if (aggregateDeltas)
+			{
+				[self addAggregateDeltas:aggregateDeltas
+				              aggregates:aggregates
+				               oldValues:[self storedValuesForRowid:rowid]
+				               newValues:nil];
+			}
+			
+			[self deleteRowid:rowid];
+		}
+		else if ([pendingInserts containsObject:number])
+		{
+			if (aggregateDeltas)
+			{
+				[self addAggregateDeltas:aggregateDeltas
+				              aggregates:aggregates
+				               oldValues:nil
+				               newValues:[self storedValuesForValues:(NSDictionary *)change]];
+			}
+			
+			[self writeRowid:rowid withValues:(NSDictionary *)change isNew:YES];
+		}
+		else if (![self rowid:rowid hasValues:(NSDictionary *)change])
+		{
+			if (aggregateDeltas)
+			{
+				[self addAggregateDeltas:aggregateDeltas
+				              aggregates:aggregates
+				               oldValues:[self storedValuesForRowid:rowid]
+				               newValues:[self storedValuesForValues:(NSDictionary *)change]];
+			}
+			
+			[self writeRowid:rowid withValues:(NSDictionary *)change isNew:NO];
+		}
 	}
 	
-	[query appendString:@");"];
+	[pendingChanges removeAllObjects];
+	[pendingInserts removeAllObjects];
 	
-	sqlite3_stmt *statement;
+	if ([aggregateDeltas count] > 0)
+	{
+		[self applyAggregateDeltas:aggregateDeltas aggregates:aggregates];
+	}
+}
+
+/**
+ * Binds the given value (as extracted by the handler block) for the given column.
+ * Values of an unsupported class are logged, and left unbound (i.e. NULL).
+**/
+- (void)bindValue:(id)columnValue
+        forColumn:(YapDatabaseSecondaryIndexColumn *)column
+      toStatement:(sqlite3_stmt *)statement
+          atIndex:(int)bind_idx
+{
+	if (columnValue && columnValue != [NSNull null])
+	{
+		if (column.type == YapDatabaseSecondaryIndexTypeInteger ||
+		    column.type == YapDatabaseSecondaryIndexTypeReal    ||
+		    column.type == YapDatabaseSecondaryIndexTypeNumeric  )
+		{
+			if ([columnValue isKindOfClass:[NSNumber class]])
+			{
+				__unsafe_unretained NSNumber *number = (NSNumber *)columnValue;
+				
+				CFNumberType numberType = CFNumberGetType((CFNumberRef)number);
+				
+				if (numberType == kCFNumberFloat32Type ||
+					numberType == kCFNumberFloat64Type ||
+					numberType == kCFNumberFloatType   ||
+					numberType == kCFNumberDoubleType  ||
+					numberType == kCFNumberCGFloatType  )
+				{
+					double num = [number doubleValue];
+					sqlite3_bind_double(statement, bind_idx, num);
+				}
+				else
+				{
+					int64_t num = [number longLongValue];
+					sqlite3_bind_int64(statement, bind_idx, (sqlite3_int64)num);
+				}
+			}
+			else if ([columnValue isKindOfClass:[NSDate class]])
+			{
+				__unsafe_unretained NSDate *date = (NSDate *)columnValue;
+				
+				double num = [date timeIntervalSinceReferenceDate];
+				sqlite3_bind_double(statement, bind_idx, num);
+			}
+			else
+			{
+				YDBLogWarn(@"Unable to bind value for column(name=%@, type=%@) with unsupported class: %@."
+				           @" Column requires NSNumber or NSDate.",
+				           column.name,
+				           NSStringFromYapDatabaseSecondaryIndexType(column.type),
+				           NSStringFromClass([columnValue class]));
+			}
+		}
+		else if (column.type == YapDatabaseSecondaryIndexTypeText)
+		{
+			if ([columnValue isKindOfClass:[NSString class]])
+			{
+				__unsafe_unretained NSString *string = (NSString *)columnValue;
+				
+				sqlite3_bind_text(statement, bind_idx, [string UTF8String], -1, SQLITE_TRANSIENT);
+			}
+			else
+			{
+				YDBLogWarn(@"Unable to bind value for column(name=%@, type=text) with unsupported class: %@."
+				           @" Column requires NSString.",
+				           column.name, NSStringFromClass([columnValue class]));
+			}
+		}
+		else if (column.type == YapDatabaseSecondaryIndexTypeBlob)
+		{
+			if ([columnValue isKindOfClass:[NSData class]])
+			{
+				__unsafe_unretained NSData *data = (NSData *)columnValue;
+				
+				sqlite3_bind_blob(statement, bind_idx, [data bytes], (int)[data length], SQLITE_STATIC);
+			}
+			else
+			{
+				YDBLogWarn(@"Unable to bind value for column(name=%@, type=text) with unsupported class: %@."
+				           @" Column requires NSData.",
+				           column.name, NSStringFromClass([columnValue class]));
+			}
+		}
+	}
+}
+
+/**
+ * Compares the given value (as extracted by the handler block) against the value stored in the table.
+ * That is, whether or not binding the given value would result in the same stored value.
+**/
+- (BOOL)value:(id)columnValue
+    forColumn:(YapDatabaseSecondaryIndexColumn *)column
+  isEqualToColumnAtIndex:(int)column_idx
+  inStatement:(sqlite3_stmt *)statement
+{
+	int column_type = sqlite3_column_type(statement, column_idx);
 	
-	int status = sqlite3_prepare_v2(databaseTransaction->connection->db, [query UTF8String], -1, &statement, NULL);
-	if (status != SQLITE_OK)
+	if (columnValue == nil || columnValue == [NSNull null])
 	{
-		YDBLogError(@"Error creating 'removeRowids' statement: %d %s",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
-		return;
+		return (column_type == SQLITE_NULL);
 	}
 	
-	for (i = 0; i < count; i++)
+	if (column.type == YapDatabaseSecondaryIndexTypeInteger ||
+	    column.type == YapDatabaseSecondaryIndexTypeReal    ||
+	    column.type == YapDatabaseSecondaryIndexTypeNumeric  )
 	{
-		int64_t rowid = [[rowids objectAtIndex:i] longLongValue];
+		// Note: Depending on the column affinity, sqlite may have converted the bound value
+		// from an integer to a real (or vice versa). So we compare the numeric values.
+		
+		BOOL isDouble = NO;
+		double doubleValue = 0;
+		int64_t intValue = 0;
+		
+		if ([columnValue isKindOfClass:[NSNumber class]])
+		{
+			__unsafe_unretained NSNumber *number = (NSNumber *)columnValue;
+			
+			CFNumberType numberType = CFNumberGetType((CFNumberRef)number);
+			
+			if (numberType == kCFNumberFloat32Type ||
+			    numberType == kCFNumberFloat64Type ||
+			    numberType == kCFNumberFloatType   ||
+			    numberType == kCFNumberDoubleType  ||
+			    numberType == kCFNumberCGFloatType  )
+			{
+				isDouble = YES;
+				doubleValue = [number doubleValue];
+			}
+			else
+			{
+				intValue = [number longLongValue];
+			}
+		}
+		else if ([columnValue isKindOfClass:[NSDate class]])
+		{
+			isDouble = YES;
+			doubleValue = [(NSDate *)columnValue timeIntervalSinceReferenceDate];
+		}
+		else
+		{
+			// Unsupported class (never bound)
+			return (column_type == SQLITE_NULL);
+		}
+		
+		if (column_type == SQLITE_INTEGER)
+		{
+			int64_t stored = sqlite3_column_int64(statement, column_idx);
+			
+			if (isDouble)
+				return ((double)stored == doubleValue);
+			else
+				return (stored == intValue);
+		}
+		else if (column_type == SQLITE_FLOAT)
+		{
+			double stored = sqlite3_column_double(statement, column_idx);
+			
+			if (isDouble)
+				return (stored == doubleValue);
+			else
+				return (stored == (double)intValue);
+		}
 		
-		sqlite3_bind_int64(statement, (int)(SQLITE_BIND_START + i), rowid);
+		return NO;
 	}
-	
-	status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
+	else if (column.type == YapDatabaseSecondaryIndexTypeText)
 	{
-		YDBLogError(@"Error executing 'removeRowids' statement: %d %s",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		if (![columnValue isKindOfClass:[NSString class]])
+		{
+			// Unsupported class (never bound)
+			return (column_type == SQLITE_NULL);
+		}
+		
+		if (column_type != SQLITE_TEXT) return NO;
+		
+		const char *utf8 = [(NSString *)columnValue UTF8String];
+		size_t utf8Length = strlen(utf8);
+		
+		const unsigned char *stored = sqlite3_column_text(statement, column_idx);
+		int storedLength = sqlite3_column_bytes(statement, column_idx);
+		
+		return ((size_t)storedLength == utf8Length) && (memcmp(stored, utf8, utf8Length) == 0);
+	}
+	else if (column.type == YapDatabaseSecondaryIndexTypeBlob)
+	{
+		if (![columnValue isKindOfClass:[NSData class]])
+		{
+			// Unsupported class (never bound)
+			return (column_type == SQLITE_NULL);
+		}
+		
+		__unsafe_unretained NSData *data = (NSData *)columnValue;
+		
+		if (column_type == SQLITE_NULL)
+		{
+			// sqlite3_bind_blob with a NULL pointer (e.g. empty NSData) binds NULL
+			return ([data bytes] == NULL);
+		}
+		
+		if (column_type != SQLITE_BLOB) return NO;
+		
+		const void *stored = sqlite3_column_blob(statement, column_idx);
+		int storedLength = sqlite3_column_bytes(statement, column_idx);
+		
+		return ((NSUInteger)storedLength == [data length]) && (memcmp(stored, [data bytes], [data length]) == 0);
 	}
 	
-	sqlite3_finalize(statement);
-	
-	[parentConnection->mutationStack markAsMutated];
+	return NO;
 }
 
-- (void)removeAllRowids
+/**
+ * Returns YES if the table already contains the given row, with the exact same values.
+ * In which case there's no need to re-write it (and update every index on the table).
+**/
+- (BOOL)rowid:(int64_t)rowid hasValues:(NSDictionary *)values
 {
-	YDBLogAutoTrace();
-	
-	sqlite3_stmt *statement = [parentConnection removeAllStatement];
-	if (statement == NULL)
-		return;
+	sqlite3_stmt *statement = [parentConnection selectStatement];
+	if (statement == NULL) return NO;
 	
-	int status;
+	// SELECT "rowid", "column1", "column2", ... FROM "tableName" WHERE "rowid" = ?;
 	
-	// DELETE FROM "tableName";
+	sqlite3_bind_int64(statement, SQLITE_BIND_START, rowid);
 	
-	YDBLogVerbose(@"DELETE FROM '%@';", [self tableName]);
+	BOOL result = NO;
 	
-	status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
 	{
-		YDBLogError(@"(%@): Error in removeAllStatement: %d %s",
-		            [self registeredName],
+		result = YES;
+		int column_idx = SQLITE_COLUMN_START + 1;
+		
+		for (YapDatabaseSecondaryIndexColumn *column in parentConnection->parent->setup)
+		{
+			id columnValue = [values objectForKey:column.name];
+			
+			if (![self value:columnValue forColumn:column isEqualToColumnAtIndex:column_idx inStatement:statement])
+			{
+				result = NO;
+				break;
+			}
+			
+			column_idx++;
+		}
+	}
+	else if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'selectStatement': %d %s",
 		            status, sqlite3_errmsg(databaseTransaction->connection->db));
 	}
 	
+	sqlite3_clear_bindings(statement);
 	sqlite3_reset(statement);
 	
-	[parentConnection->mutationStack markAsMutated];
+	return result;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#pragma mark Cleanup & Commit
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
 /**
- * Required override method from YapDatabaseExtension
+ * Returns the given value (as extracted by the handler block) in the form it would be stored in the table,
+ * which is the same form returned by storedValuesForRowid. Or nil if the value would be stored as NULL.
+ * (This mirrors the logic of bindValue:forColumn:toStatement:atIndex:.)
 **/
-- (void)didCommitTransaction
+- (id)storedValueForValue:(id)columnValue column:(YapDatabaseSecondaryIndexColumn *)column
 {
-	YDBLogAutoTrace();
+	if (column.type == YapDatabaseSecondaryIndexTypeInteger ||
+	    column.type == YapDatabaseSecondaryIndexTypeReal    ||
+	    column.type == YapDatabaseSecondaryIndexTypeNumeric  )
+	{
+		if ([columnValue isKindOfClass:[NSNumber class]])
+		{
+			__unsafe_unretained NSNumber *number = (NSNumber *)columnValue;
+			
+			if (CFNumberIsFloatType((__bridge CFNumberRef)number))
+				return @([number doubleValue]);
+			else
+				return @([number longLongValue]);
+		}
+		else if ([columnValue isKindOfClass:[NSDate class]])
+		{
+			return @([(NSDate *)columnValue timeIntervalSinceReferenceDate]);
+		}
+	}
+	else if (column.type == YapDatabaseSecondaryIndexTypeText)
+	{
+		if ([columnValue isKindOfClass:[NSString class]])
+		{
+			return columnValue;
+		}
+	}
+	else if (column.type == YapDatabaseSecondaryIndexTypeBlob)
+	{
+		if ([columnValue isKindOfClass:[NSData class]] && [(NSData *)columnValue length] > 0)
+		{
+			return columnValue;
+		}
+	}
 	
-	[parentConnection postCommitCleanup];
+	return nil;
+}
+
+- (NSDictionary *)storedValuesForValues:(NSDictionary *)values
+{
+	NSMutableDictionary *storedValues = [NSMutableDictionary dictionaryWithCapacity:[values count]];
 	
-	// An extensionTransaction is only valid within the scope of its encompassing databaseTransaction.
-	// I imagine this may occasionally be misunderstood, and developers may attempt to store the extension in an ivar,
-	// and then use it outside the context of the database transaction block.
-	// Thus, this code is here as a safety net to ensure that such accidental misuse doesn't do any damage.
+	for (YapDatabaseSecondaryIndexColumn *column in parentConnection->parent->setup)
+	{
+		id storedValue = [self storedValueForValue:[values objectForKey:column.name] column:column];
+		if (storedValue)
+		{
+			storedValues[column.name] = storedValue;
+		}
+	}
 	
-	parentConnection = nil;    // Do not remove !
-	databaseTransaction = nil; // Do not remove !
+	return storedValues;
 }
 
 /**
- * Required override method from YapDatabaseExtension
+ * Returns the (non-NULL) values stored in the table for the given row, or nil if the row isn't in the table.
 **/
-- (void)didRollbackTransaction
+- (NSDictionary *)storedValuesForRowid:(int64_t)rowid
 {
-	YDBLogAutoTrace();
+	sqlite3_stmt *statement = [parentConnection selectStatement];
+	if (statement == NULL) return nil;
 	
-	[parentConnection postRollbackCleanup];
+	// SELECT "rowid", "column1", "column2", ... FROM "tableName" WHERE "rowid" = ?;
 	
-	// An extensionTransaction is only valid within the scope of its encompassing databaseTransaction.
-	// I imagine this may occasionally be misunderstood, and developers may attempt to store the extension in an ivar,
-	// and then use it outside the context of the database transaction block.
-	// Thus, this code is here as a safety net to ensure that such accidental misuse doesn't do any damage.
+	sqlite3_bind_int64(statement, SQLITE_BIND_START, rowid);
 	
-	parentConnection = nil;    // Do not remove !
-	databaseTransaction = nil; // Do not remove !
+	NSMutableDictionary *storedValues = nil;
+	
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		storedValues = [NSMutableDictionary dictionaryWithCapacity:[parentConnection->parent->setup count]];
+		int column_idx = SQLITE_COLUMN_START + 1;
+		
+		for (YapDatabaseSecondaryIndexColumn *column in parentConnection->parent->setup)
+		{
+			id storedValue = ColumnValue(statement, column_idx);
+			if (storedValue)
+			{
+				storedValues[column.name] = storedValue;
+			}
+			
+			column_idx++;
+		}
+	}
+	else if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'selectStatement': %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	return storedValues;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#pragma mark Transaction Hooks
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-/**
- * Private helper method for other handleXXX hook methods.
-**/
-- (void)_handleChangeWithRowid:(int64_t)rowid
-                 collectionKey:(YapCollectionKey *)collectionKey
-                        object:(id)object
-                      metadata:(id)metadata
-                      isInsert:(BOOL)isInsert
+- (void)writeRowid:(int64_t)rowid withValues:(NSDictionary *)values isNew:(BOOL)isNew
 {
-	YDBLogAutoTrace();
-	
-	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
-	
-	__unsafe_unretained NSString *collection = collectionKey.collection;
-	__unsafe_unretained NSString *key = collectionKey.key;
+	sqlite3_stmt *statement = NULL;
+	if (isNew)
+		statement = [parentConnection insertStatement];
+	else
+		statement = [parentConnection updateStatement];
 	
-	__unsafe_unretained YapWhitelistBlacklist *allowedCollections = secondaryIndex->options.allowedCollections;
-	if (allowedCollections && ![allowedCollections isAllowed:collection])
-	{
+	if (statement == NULL)
 		return;
-	}
 	
-	// Invoke the block to find out if the object should be included in the index.
+	//  isNew : INSERT            INTO "tableName" ("rowid", "column1", "column2", ...) VALUES (?, ?, ? ...);
+	// !isNew : INSERT OR REPLACE INTO "tableName" ("rowid", "column1", "column2", ...) VALUES (?, ?, ? ...);
 	
-	YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
-	YapDatabaseBlockType blockType = handler->blockType;
+	int bind_idx = SQLITE_BIND_START;
 	
-	if (blockType == YapDatabaseBlockTypeWithKey)
-	{
-		__unsafe_unretained YapDatabaseSecondaryIndexWithKeyBlock block =
-		    (YapDatabaseSecondaryIndexWithKeyBlock)handler->block;
-		
-		block(databaseTransaction, parentConnection->blockDict, collection, key);
-	}
-	else if (blockType == YapDatabaseBlockTypeWithObject)
-	{
-		__unsafe_unretained YapDatabaseSecondaryIndexWithObjectBlock block =
-		    (YapDatabaseSecondaryIndexWithObjectBlock)handler->block;
-		
-		block(databaseTransaction, parentConnection->blockDict, collection, key, object);
-	}
-	else if (blockType == YapDatabaseBlockTypeWithMetadata)
-	{
-		__unsafe_unretained YapDatabaseSecondaryIndexWithMetadataBlock block =
-		    (YapDatabaseSecondaryIndexWithMetadataBlock)handler->block;
-		
-		block(databaseTransaction, parentConnection->blockDict, collection, key, metadata);
-	}
-	else
-	{
-		__unsafe_unretained YapDatabaseSecondaryIndexWithRowBlock block =
-		    (YapDatabaseSecondaryIndexWithRowBlock)handler->block;
-		
-		block(databaseTransaction, parentConnection->blockDict, collection, key, object, metadata);
-	}
+	sqlite3_bind_int64(statement, bind_idx, rowid);
+	bind_idx++;
 	
-	if ([parentConnection->blockDict count] == 0)
+	for (YapDatabaseSecondaryIndexColumn *column in parentConnection->parent->setup)
 	{
-		// Remove associated values from index (if needed).
+		id columnValue = [values objectForKey:column.name];
 		
-		if (!isInsert)
-		{
-			[self removeRowid:rowid];
-		}
+		[self bindValue:columnValue forColumn:column toStatement:statement atIndex:bind_idx];
+		bind_idx++;
 	}
-	else
+	
+	int status = sqlite3_step(statement);
+	if (status != SQLITE_DONE)
 	{
-		// Add values to index (or update them).
-		// This was an update operation, so we need to insert or update.
-		
-		[self addRowid:rowid isNew:isInsert];
-		[parentConnection->blockDict removeAllObjects];
+		YDBLogError(@"Error executing '%s': %d %s",
+		            isNew ? "insertStatement" : "updateStatement",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
 	}
-}
-
-/**
- * YapDatabase extension hook.
- * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
-**/
-- (void)didInsertObject:(id)object
-       forCollectionKey:(YapCollectionKey *)collectionKey
-           withMetadata:(id)metadata
-                  rowid:(int64_t)rowid
-{
-	YDBLogAutoTrace();
 	
-	[self _handleChangeWithRowid:rowid
-	               collectionKey:collectionKey
-	                      object:object
-	                    metadata:metadata
-	                    isInsert:YES];
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
 }
 
-/**
- * YapDatabase extension hook.
- * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
-**/
-- (void)didUpdateObject:(id)object
-       forCollectionKey:(YapCollectionKey *)collectionKey
-           withMetadata:(id)metadata
-                  rowid:(int64_t)rowid
+- (void)deleteRowid:(int64_t)rowid
 {
-	YDBLogAutoTrace();
+	sqlite3_stmt *statement = [parentConnection removeStatement];
+	if (statement == NULL) return;
 	
-	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
-	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	// DELETE FROM "tableName" WHERE "rowid" = ?;
 	
-	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfObjectModified |
-	                                            YapDatabaseBlockInvokeIfMetadataModified;
+	int const bind_idx_rowid = SQLITE_BIND_START;
 	
-	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
+	sqlite3_bind_int64(statement, bind_idx_rowid, rowid);
+	
+	int status = sqlite3_step(statement);
+	if (status != SQLITE_DONE)
 	{
-		return;
+		YDBLogError(@"Error executing 'removeStatement': %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
 	}
 	
-	[self _handleChangeWithRowid:rowid
-	               collectionKey:collectionKey
-	                      object:object
-	                    metadata:metadata
-	                    isInsert:NO];
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
 }
 
-/**
- * YapDatabase extension hook.
- * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
-**/
-- (void)didReplaceObject:(id)object forCollectionKey:(YapCollectionKey *)collectionKey withRowid:(int64_t)rowid
+- (void)removeAllRowids
 {
 	YDBLogAutoTrace();
 	
-	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
-	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	// Any pending changes are moot
 	
-	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfObjectModified;
+	[parentConnection->pendingChanges removeAllObjects];
+	[parentConnection->pendingInserts removeAllObjects];
 	
-	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
+	if (memoryTableTransaction)
 	{
+		[[self mutableMemoryStore] removeAllRowids];
+		
+		[parentConnection->mutationStack markAsMutated];
 		return;
 	}
 	
-	id metadata = nil;
-	if (handler->blockType & YapDatabaseBlockType_MetadataFlag)
-	{
-		metadata = [databaseTransaction metadataForCollectionKey:collectionKey withRowid:rowid];
-	}
+	[self removeAllAggregates];
 	
-	[self _handleChangeWithRowid:rowid
-	               collectionKey:collectionKey
-	                      object:object
-	                    metadata:metadata
-	                    isInsert:NO];
-}
-
-/**
- * YapDatabase extension hook.
- * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
-**/
-- (void)didReplaceMetadata:(id)metadata forCollectionKey:(YapCollectionKey *)collectionKey withRowid:(int64_t)rowid
-{
-	YDBLogAutoTrace();
+	sqlite3_stmt *statement = [parentConnection removeAllStatement];
+	if (statement == NULL)
+		return;
 	
-	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
-	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	int status;
 	
-	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfMetadataModified;
+	// DELETE FROM "tableName";
 	
-	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
-	{
-		return;
-	}
+	YDBLogVerbose(@"DELETE FROM '%@';", [self tableName]);
 	
-	id object = nil;
-	if (handler->blockType & YapDatabaseBlockType_ObjectFlag)
+	status = sqlite3_step(statement);
+	if (status != SQLITE_DONE)
 	{
-		object = [databaseTransaction objectForCollectionKey:collectionKey withRowid:rowid];
+		YDBLogError(@"(%@): Error in removeAllStatement: %d %s",
+		            [self registeredName],
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
 	}
 	
-	[self _handleChangeWithRowid:rowid
-	               collectionKey:collectionKey
-	                      object:object
-	                    metadata:metadata
-	                    isInsert:NO];
+	sqlite3_reset(statement);
+	
+	[parentConnection->mutationStack markAsMutated];
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Aggregate Maintenance
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 /**
- * YapDatabase extension hook.
- * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+ * Binds an aggregate name & group (as the first 2 parameters of the statement).
 **/
-- (void)didTouchObjectForCollectionKey:(YapCollectionKey __unused *)collectionKey withRowid:(int64_t __unused)rowid
+- (void)bindAggregateName:(NSString *)aggregateName group:(id)group toStatement:(sqlite3_stmt *)statement
 {
-	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
-	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	sqlite3_bind_text(statement, SQLITE_BIND_START, [aggregateName UTF8String], -1, SQLITE_TRANSIENT);
 	
-	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfObjectTouched;
-	
-	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
-	{
-		return;
-	}
-	
-	id object = nil;
-	if (handler->blockType & YapDatabaseBlockType_ObjectFlag)
+	if ([group isKindOfClass:[NSData class]])
 	{
-		object = [databaseTransaction objectForCollectionKey:collectionKey withRowid:rowid];
+		__unsafe_unretained NSData *data = (NSData *)group;
+		sqlite3_bind_blob(statement, SQLITE_BIND_START + 1, [data bytes], (int)[data length], SQLITE_TRANSIENT);
 	}
-	
-	id metadata = nil;
-	if (handler->blockType & YapDatabaseBlockType_MetadataFlag)
+	else
 	{
-		metadata = [databaseTransaction metadataForCollectionKey:collectionKey withRowid:rowid];
+		[self bindQueryParameters:@[ group ] forStatement:statement withOffset:(SQLITE_BIND_START + 1)];
 	}
-	
-	[self _handleChangeWithRowid:rowid
-	               collectionKey:collectionKey
-	                      object:object
-	                    metadata:metadata
-	                    isInsert:NO];
 }
 
 /**
- * YapDatabase extension hook.
- * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+ * Adds the change of a single row (from its old values to its new values) to the aggregate deltas.
+ * The old values are nil for an inserted row, and the new values are nil for a removed row.
 **/
-- (void)didTouchMetadataForCollectionKey:(YapCollectionKey __unused *)collectionKey withRowid:(int64_t __unused)rowid
+- (void)addAggregateDeltas:(NSMutableDictionary *)aggregateDeltas
+                aggregates:(NSArray<YapDatabaseSecondaryIndexAggregate *> *)aggregates
+                 oldValues:(NSDictionary *)oldValues
+                 newValues:(NSDictionary *)newValues
 {
-	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
-	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
-	
-	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfMetadataTouched;
-	
-	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
+	for (YapDatabaseSecondaryIndexAggregate *aggregate in aggregates)
 	{
-		return;
-	}
+		YapDatabaseSecondaryIndexAggregateFunction function = aggregate.function;
+		
+		id oldGroup = oldValues[aggregate.groupByColumn];
+		id newGroup = newValues[aggregate.groupByColumn];
+		
+		// A row is part of the aggregate if it has a group, and a value (unless this is COUNT(*))
+		
+		id oldValue = aggregate.column ? oldValues[aggregate.column] : oldGroup;
+		id newValue = aggregate.column ? newValues[aggregate.column] : newGroup;
+		
+		if (oldGroup == nil) oldValue = nil;
+		if (newGroup == nil) newValue = nil;
+		
+		if (oldValue && newValue && [oldGroup isEqual:newGroup])
+		{
+			if (function == YapDatabaseSecondaryIndexAggregateFunctionCount || [oldValue isEqual:newValue])
+			{
+				// The row changed, but not in a way that affects this aggregate
+				continue;
+			}
+		}
+		
+		NSMutableDictionary *groupDeltas = aggregateDeltas[aggregate.name];
+		if (groupDeltas == nil)
+		{
+			groupDeltas = [NSMutableDictionary dictionary];
+			aggregateDeltas[aggregate.name] = groupDeltas;
+		}
+		
+		if (oldValue)
+		{
+			YapDatabaseSecondaryIndexAggregateDelta *delta = groupDeltas[oldGroup];
+			if (delta == nil)
+			{
+				delta = [[YapDatabaseSecondaryIndexAggregateDelta alloc] init];
+				groupDeltas[oldGroup] = delta;
+			}
+			
+			[delta removeValue:oldValue function:function];
+		}
+		
+		if (newValue)
+		{
+			YapDatabaseSecondaryIndexAggregateDelta *delta = groupDeltas[newGroup];
+			if (delta == nil)
+			{
+				delta = [[YapDatabaseSecondaryIndexAggregateDelta alloc] init];
+				groupDeltas[newGroup] = delta;
+			}
+			
+			[delta addValue:newValue function:function];
+		}
+	}
+}
+
+- (void)applyAggregateDeltas:(NSDictionary *)aggregateDeltas
+                  aggregates:(NSArray<YapDatabaseSecondaryIndexAggregate *> *)aggregates
+{
+	for (YapDatabaseSecondaryIndexAggregate *aggregate in aggregates)
+	{
+		NSDictionary *groupDeltas = aggregateDeltas[aggregate.name];
+		
+		[groupDeltas enumerateKeysAndObjectsUsingBlock:
+		    ^(id group, YapDatabaseSecondaryIndexAggregateDelta *delta, BOOL *stop)
+		{
+			[self applyAggregateDelta:delta toGroup:group ofAggregate:aggregate];
+		}];
+	}
+}
+
+/**
+ * Applies the delta to the stored value of a single aggregate group.
+ * 
+ * Count & sum are simple arithmetic.
+ * A min/max only needs to be recalculated (from the table) if a removed value may have been the min/max.
+**/
+- (void)applyAggregateDelta:(YapDatabaseSecondaryIndexAggregateDelta *)delta
+                    toGroup:(id)group
+                ofAggregate:(YapDatabaseSecondaryIndexAggregate *)aggregate
+{
+	sqlite3 *db = databaseTransaction->connection->db;
 	
-	id object = nil;
-	if (handler->blockType & YapDatabaseBlockType_ObjectFlag)
+	// Fetch the current value
+	
+	sqlite3_stmt *statement = [parentConnection aggregateSelectStatement];
+	if (statement == NULL) return;
+	
+	// SELECT "value", "count" FROM "aggregatesTableName" WHERE "name" = ? AND "group" = ?;
+	
+	[self bindAggregateName:aggregate.name group:group toStatement:statement];
+	
+	NSNumber *storedValue = nil;
+	int64_t storedCount = 0;
+	
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
 	{
-		object = [databaseTransaction objectForCollectionKey:collectionKey withRowid:rowid];
+		storedValue = ColumnValue(statement, SQLITE_COLUMN_START + 0);
+		storedCount = sqlite3_column_int64(statement, SQLITE_COLUMN_START + 1);
+	}
+	else if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'aggregateSelectStatement': %d %s", status, sqlite3_errmsg(db));
 	}
 	
-	id metadata = nil;
-	if (handler->blockType & YapDatabaseBlockType_MetadataFlag)
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	// Calculate the new value
+	
+	int64_t count = storedCount + delta->count;
+	NSNumber *value = nil;
+	
+	switch (aggregate.function)
 	{
-		metadata = [databaseTransaction metadataForCollectionKey:collectionKey withRowid:rowid];
+		case YapDatabaseSecondaryIndexAggregateFunctionCount :
+		{
+			value = @(count);
+			break;
+		}
+		case YapDatabaseSecondaryIndexAggregateFunctionSum :
+		{
+			if (delta->hasRealSum || (storedValue && CFNumberIsFloatType((__bridge CFNumberRef)storedValue)))
+				value = @([storedValue doubleValue] + (double)delta->integerSum + delta->realSum);
+			else
+				value = @([storedValue longLongValue] + delta->integerSum);
+			
+			break;
+		}
+		default :
+		{
+			BOOL removedExtreme = NO;
+			if (delta->removed && storedValue)
+			{
+				removedExtreme = !IsExtreme(storedValue, delta->removed, aggregate.function);
+			}
+			
+			if (removedExtreme)
+			{
+				// The row holding the min/max may have been removed (or changed).
+				// So we need to recalculate the min/max (the table has already been updated).
+				
+				sqlite3_stmt *recalculateStatement = [parentConnection aggregateRecalculateStatement:aggregate];
+				if (recalculateStatement == NULL) return;
+				
+				// SELECT MIN("column"), COUNT("column") FROM "tableName" WHERE "groupByColumn" = ?;
+				
+				if ([group isKindOfClass:[NSData class]])
+				{
+					__unsafe_unretained NSData *data = (NSData *)group;
+					sqlite3_bind_blob(recalculateStatement, SQLITE_BIND_START,
+					                  [data bytes], (int)[data length], SQLITE_TRANSIENT);
+				}
+				else
+				{
+					[self bindQueryParameters:@[ group ] forStatement:recalculateStatement withOffset:SQLITE_BIND_START];
+				}
+				
+				status = sqlite3_step(recalculateStatement);
+				if (status == SQLITE_ROW)
+				{
+					value = ColumnValue(recalculateStatement, SQLITE_COLUMN_START + 0);
+					count = sqlite3_column_int64(recalculateStatement, SQLITE_COLUMN_START + 1);
+				}
+				else
+				{
+					YDBLogError(@"Error executing 'aggregateRecalculateStatement': %d %s", status, sqlite3_errmsg(db));
+				}
+				
+				sqlite3_clear_bindings(recalculateStatement);
+				sqlite3_reset(recalculateStatement);
+			}
+			else
+			{
+				value = storedValue;
+				
+				if (delta->added && IsExtreme(delta->added, value, aggregate.function))
+				{
+					value = delta->added;
+				}
+			}
+			
+			break;
+		}
 	}
 	
-	[self _handleChangeWithRowid:rowid
-	               collectionKey:collectionKey
-	                      object:object
-	                    metadata:metadata
-	                    isInsert:NO];
+	// Write the new value (or remove the group, if it's now empty)
+	
+	if (count > 0)
+	{
+		statement = [parentConnection aggregateInsertOrReplaceStatement];
+		if (statement == NULL) return;
+		
+		// INSERT OR REPLACE INTO "aggregatesTableName" ("name", "group", "value", "count") VALUES (?, ?, ?, ?);
+		
+		[self bindAggregateName:aggregate.name group:group toStatement:statement];
+		if (value) {
+			[self bindQueryParameters:@[ value ] forStatement:statement withOffset:(SQLITE_BIND_START + 2)];
+		}
+		sqlite3_bind_int64(statement, SQLITE_BIND_START + 3, count);
+		
+		status = sqlite3_step(statement);
+		if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"Error executing 'aggregateInsertOrReplaceStatement': %d %s", status, sqlite3_errmsg(db));
+		}
+	}
+	else
+	{
+		statement = [parentConnection aggregateRemoveStatement];
+		if (statement == NULL) return;
+		
+		// DELETE FROM "aggregatesTableName" WHERE "name" = ? AND "group" = ?;
+		
+		[self bindAggregateName:aggregate.name group:group toStatement:statement];
+		
+		status = sqlite3_step(statement);
+		if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"Error executing 'aggregateRemoveStatement': %d %s", status, sqlite3_errmsg(db));
+		}
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	[parentConnection didChangeAggregate:aggregate.name group:group];
 }
 
 /**
- * YapDatabase extension hook.
- * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+ * Removes every aggregate group (reporting each of them as changed).
+ * Invoked when every row is removed from the table.
 **/
-- (void)didTouchRowForCollectionKey:(YapCollectionKey *)collectionKey withRowid:(int64_t)rowid
+- (void)removeAllAggregates
 {
-	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
-	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	if ([[parentConnection->parent->setup aggregates] count] == 0) return;
 	
-	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfObjectTouched |
-	                                            YapDatabaseBlockInvokeIfMetadataTouched;
+	sqlite3 *db = databaseTransaction->connection->db;
 	
-	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
+	sqlite3_stmt *statement = [parentConnection aggregateSelectAllStatement];
+	if (statement == NULL) return;
+	
+	// SELECT "name", "group" FROM "aggregatesTableName";
+	
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
 	{
-		return;
+		NSString *aggregateName = ColumnValue(statement, SQLITE_COLUMN_START + 0);
+		id group = ColumnValue(statement, SQLITE_COLUMN_START + 1);
+		
+		if (aggregateName && group)
+		{
+			[parentConnection didChangeAggregate:aggregateName group:group];
+		}
 	}
 	
-	id object = nil;
-	if (handler->blockType & YapDatabaseBlockType_ObjectFlag)
+	if (status != SQLITE_DONE)
 	{
-		object = [databaseTransaction objectForCollectionKey:collectionKey withRowid:rowid];
+		YDBLogError(@"Error executing 'aggregateSelectAllStatement': %d %s", status, sqlite3_errmsg(db));
 	}
 	
-	id metadata = nil;
-	if (handler->blockType & YapDatabaseBlockType_MetadataFlag)
+	sqlite3_reset(statement);
+	
+	statement = [parentConnection aggregateRemoveAllStatement];
+	if (statement == NULL) return;
+	
+	// DELETE FROM "aggregatesTableName";
+	
+	status = sqlite3_step(statement);
+	if (status != SQLITE_DONE)
 	{
-		metadata = [databaseTransaction metadataForCollectionKey:collectionKey withRowid:rowid];
+		YDBLogError(@"Error executing 'aggregateRemoveAllStatement': %d %s", status, sqlite3_errmsg(db));
 	}
 	
-	[self _handleChangeWithRowid:rowid
-	               collectionKey:collectionKey
-	                      object:object
-	                    metadata:metadata
-	                    isInsert:NO];
+	sqlite3_reset(statement);
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Cleanup & Commit
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 /**
- * YapDatabase extension hook.
- * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+ * Optional override method from YapDatabaseExtensionTransaction.
 **/
-- (void)didRemoveObjectForCollectionKey:(YapCollectionKey *)collectionKey withRowid:(int64_t)rowid
+- (void)flushPendingChangesToExtensionTables
 {
 	YDBLogAutoTrace();
 	
-	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	[self flushPendingChanges];
 	
-	__unsafe_unretained YapWhitelistBlacklist *allowedCollections = secondaryIndex->options.allowedCollections;
-	if (allowedCollections && ![allowedCollections isAllowed:collectionKey.collection])
+	if (parentConnection->memoryStore)
 	{
-		return;
+		// Publish an immutable snapshot of the store.
+		// The memory table takes care of snapshot isolation for concurrent read-only transactions.
+		
+		[memoryTableTransaction setObject:[parentConnection->memoryStore copy] forKey:memory_key_store];
 	}
 	
-	[self removeRowid:rowid];
+	[memoryTableTransaction commit];
 }
 
 /**
- * YapDatabase extension hook.
- * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+ * Required override method from YapDatabaseExtension
 **/
-- (void)didRemoveObjectsForKeys:(NSArray __unused *)keys inCollection:(NSString *)collection withRowids:(NSArray *)rowids
+- (void)didCommitTransaction
 {
 	YDBLogAutoTrace();
 	
-	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	[parentConnection postCommitCleanup];
 	
-	__unsafe_unretained YapWhitelistBlacklist *allowedCollections = secondaryIndex->options.allowedCollections;
-	if (allowedCollections && ![allowedCollections isAllowed:collection])
-	{
-		return;
-	}
+	// An extensionTransaction is only valid within the scope of its encompassing databaseTransaction.
+	// I imagine this may occasionally be misunderstood, and developers may attempt to store the extension in an ivar,
+	// and then use it outside the context of the database transaction block.
+	// Thus, this code is here as a safety net to ensure that such accidental misuse doesn't do any damage.
 	
-	[self removeRowids:rowids];
+	parentConnection = nil;    // Do not remove !
+	databaseTransaction = nil; // Do not remove !
 }
 
 /**
- * YapDatabase extension hook.
- * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+ * Required override method from YapDatabaseExtension
 **/
-- (void)didRemoveAllObjectsInAllCollections
+- (void)didRollbackTransaction
 {
 	YDBLogAutoTrace();
 	
-	[self removeAllRowids];
+	[memoryTableTransaction rollback];
+	[parentConnection postRollbackCleanup];
+	
+	// An extensionTransaction is only valid within the scope of its encompassing databaseTransaction.
+	// I imagine this may occasionally be misunderstood, and developers may attempt to store the extension in an ivar,
+	// and then use it outside the context of the database transaction block.
+	// Thus, this code is here as a safety net to ensure that such accidental misuse doesn't do any damage.
+	
+	parentConnection = nil;    // Do not remove !
+	databaseTransaction = nil; // Do not remove !
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#pragma mark Utilities
+#pragma mark Transaction Hooks
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-- (sqlite3_stmt *)prepareQueryString:(NSString *)fullQueryString
+/**
+ * Private helper method for other handleXXX hook methods.
+**/
+- (void)_handleChangeWithRowid:(int64_t)rowid
+                 collectionKey:(YapCollectionKey *)collectionKey
+                        object:(id)object
+                      metadata:(id)metadata
+                      isInsert:(BOOL)isInsert
 {
-	sqlite3_stmt *statement = NULL;
+	YDBLogAutoTrace();
 	
-	YapDatabaseStatement *wrapper = [parentConnection->queryCache objectForKey:fullQueryString];
-	if (wrapper)
+	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	
+	__unsafe_unretained NSString *collection = collectionKey.collection;
+	__unsafe_unretained NSString *key = collectionKey.key;
+	
+	__unsafe_unretained YapWhitelistBlacklist *allowedCollections = secondaryIndex->options.allowedCollections;
+	if (allowedCollections && ![allowedCollections isAllowed:collection])
 	{
-		statement = wrapper.stmt;
+		return;
 	}
-	else
+	
+	// Invoke the block to find out if the object should be included in the index.
+	
+	YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	YapDatabaseBlockType blockType = handler->blockType;
+	
+	if (blockType == YapDatabaseBlockTypeWithKey)
 	{
-		sqlite3 *db = databaseTransaction->connection->db;
+		__unsafe_unretained YapDatabaseSecondaryIndexWithKeyBlock block =
+		    (YapDatabaseSecondaryIndexWithKeyBlock)handler->block;
 		
-		int status = sqlite3_prepare_v2(db, [fullQueryString UTF8String], -1, &statement, NULL);
-		if (status == SQLITE_OK)
-		{
-			if (parentConnection->queryCache)
-			{
-				wrapper = [[YapDatabaseStatement alloc] initWithStatement:statement];
-				[parentConnection->queryCache setObject:wrapper forKey:fullQueryString];
-			}
-		}
-		else
-		{
-			YDBLogError(@"Error creating query:\n query: '%@'\n error: %d %s",
-			             fullQueryString, status, sqlite3_errmsg(db));
-			
-			return NULL;
+		block(databaseTransaction, parentConnection->blockDict, collection, key);
+	}
+	else if (blockType == YapDatabaseBlockTypeWithObject)
+	{
+		__unsafe_unretained YapDatabaseSecondaryIndexWithObjectBlock block =
+		    (YapDatabaseSecondaryIndexWithObjectBlock)handler->block;
+		
+		block(databaseTransaction, parentConnection->blockDict, collection, key, object);
+	}
+	else if (blockType == YapDatabaseBlockTypeWithMetadata)
+	{
+		__unsafe_unretained YapDatabaseSecondaryIndexWithMetadataBlock block =
+		    (YapDatabaseSecondaryIndexWithMetadataBlock)handler->block;
+		
+		block(databaseTransaction, parentConnection->blockDict, collection, key, metadata);
+	}
+	else
+	{
+		__unsafe_unretained YapDatabaseSecondaryIndexWithRowBlock block =
+		    (YapDatabaseSecondaryIndexWithRowBlock)handler->block;
+		
+		block(databaseTransaction, parentConnection->blockDict, collection, key, object, metadata);
+	}
+	
+	if ([parentConnection->blockDict count] == 0)
+	{
+		// Remove associated values from index (if needed).
+		
+		if (!isInsert)
+		{
+			[self removeRowid:rowid];
+		}
+	}
+	else
+	{
+		// Add values to index (or update them).
+		// This was an update operation, so we need to insert or update.
+		
+		[self addRowid:rowid isNew:isInsert];
+		[parentConnection->blockDict removeAllObjects];
+	}
+}
+
+/**
+ * YapDatabase extension hook.
+ * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+**/
+- (void)didInsertObject:(id)object
+       forCollectionKey:(YapCollectionKey *)collectionKey
+           withMetadata:(id)metadata
+                  rowid:(int64_t)rowid
+{
+	YDBLogAutoTrace();
+	
+	[self _handleChangeWithRowid:rowid
+	               collectionKey:collectionKey
+	                      object:object
+	                    metadata:metadata
+	                    isInsert:YES];
+}
+
+/**
+ * YapDatabase extension hook.
+ * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+**/
+- (void)didUpdateObject:(id)object
+       forCollectionKey:(YapCollectionKey *)collectionKey
+           withMetadata:(id)metadata
+                  rowid:(int64_t)rowid
+{
+	YDBLogAutoTrace();
+	
+	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	
+	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfObjectModified |
+	                                            YapDatabaseBlockInvokeIfMetadataModified;
+	
+	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
+	{
+		return;
+	}
+	
+	[self _handleChangeWithRowid:rowid
+	               collectionKey:collectionKey
+	                      object:object
+	                    metadata:metadata
+	                    isInsert:NO];
+}
+
+/**
+ * YapDatabase extension hook.
+ * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+**/
+- (void)didReplaceObject:(id)object forCollectionKey:(YapCollectionKey *)collectionKey withRowid:(int64_t)rowid
+{
+	YDBLogAutoTrace();
+	
+	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	
+	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfObjectModified;
+	
+	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
+	{
+		return;
+	}
+	
+	id metadata = nil;
+	if (handler->blockType & YapDatabaseBlockType_MetadataFlag)
+	{
+		metadata = [databaseTransaction metadataForCollectionKey:collectionKey withRowid:rowid];
+	}
+	
+	[self _handleChangeWithRowid:rowid
+	               collectionKey:collectionKey
+	                      object:object
+	                    metadata:metadata
+	                    isInsert:NO];
+}
+
+/**
+ * YapDatabase extension hook.
+ * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+**/
+- (void)didReplaceMetadata:(id)metadata forCollectionKey:(YapCollectionKey *)collectionKey withRowid:(int64_t)rowid
+{
+	YDBLogAutoTrace();
+	
+	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	
+	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfMetadataModified;
+	
+	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
+	{
+		return;
+	}
+	
+	id object = nil;
+	if (handler->blockType & YapDatabaseBlockType_ObjectFlag)
+	{
+		object = [databaseTransaction objectForCollectionKey:collectionKey withRowid:rowid];
+	}
+	
+	[self _handleChangeWithRowid:rowid
+	               collectionKey:collectionKey
+	                      object:object
+	                    metadata:metadata
+	                    isInsert:NO];
+}
+
+/**
+ * YapDatabase extension hook.
+ * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+**/
+- (void)didTouchObjectForCollectionKey:(YapCollectionKey __unused *)collectionKey withRowid:(int64_t __unused)rowid
+{
+	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	
+	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfObjectTouched;
+	
+	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
+	{
+		return;
+	}
+	
+	id object = nil;
+	if (handler->blockType & YapDatabaseBlockType_ObjectFlag)
+	{
+		object = [databaseTransaction objectForCollectionKey:collectionKey withRowid:rowid];
+	}
+	
+	id metadata = nil;
+	if (handler->blockType & YapDatabaseBlockType_MetadataFlag)
+	{
+		metadata = [databaseTransaction metadataForCollectionKey:collectionKey withRowid:rowid];
+	}
+	
+	[self _handleChangeWithRowid:rowid
+	               collectionKey:collectionKey
+	                      object:object
+	                    metadata:metadata
+	                    isInsert:NO];
+}
+
+/**
+ * YapDatabase extension hook.
+ * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+**/
+- (void)didTouchMetadataForCollectionKey:(YapCollectionKey __unused *)collectionKey withRowid:(int64_t __unused)rowid
+{
+	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	
+	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfMetadataTouched;
+	
+	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
+	{
+		return;
+	}
+	
+	id object = nil;
+	if (handler->blockType & YapDatabaseBlockType_ObjectFlag)
+	{
+		object = [databaseTransaction objectForCollectionKey:collectionKey withRowid:rowid];
+	}
+	
+	id metadata = nil;
+	if (handler->blockType & YapDatabaseBlockType_MetadataFlag)
+	{
+		metadata = [databaseTransaction metadataForCollectionKey:collectionKey withRowid:rowid];
+	}
+	
+	[self _handleChangeWithRowid:rowid
+	               collectionKey:collectionKey
+	                      object:object
+	                    metadata:metadata
+	                    isInsert:NO];
+}
+
+/**
+ * YapDatabase extension hook.
+ * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+**/
+- (void)didTouchRowForCollectionKey:(YapCollectionKey *)collectionKey withRowid:(int64_t)rowid
+{
+	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	__unsafe_unretained YapDatabaseSecondaryIndexHandler *handler = secondaryIndex->handler;
+	
+	YapDatabaseBlockInvoke blockInvokeBitMask = YapDatabaseBlockInvokeIfObjectTouched |
+	                                            YapDatabaseBlockInvokeIfMetadataTouched;
+	
+	if (!(handler->blockInvokeOptions & blockInvokeBitMask))
+	{
+		return;
+	}
+	
+	id object = nil;
+	if (handler->blockType & YapDatabaseBlockType_ObjectFlag)
+	{
+		object = [databaseTransaction objectForCollectionKey:collectionKey withRowid:rowid];
+	}
+	
+	id metadata = nil;
+	if (handler->blockType & YapDatabaseBlockType_MetadataFlag)
+	{
+		metadata = [databaseTransaction metadataForCollectionKey:collectionKey withRowid:rowid];
+	}
+	
+	[self _handleChangeWithRowid:rowid
+	               collectionKey:collectionKey
+	                      object:object
+	                    metadata:metadata
+	                    isInsert:NO];
+}
+
+/**
+ * YapDatabase extension hook.
+ * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+**/
+- (void)didRemoveObjectForCollectionKey:(YapCollectionKey *)collectionKey withRowid:(int64_t)rowid
+{
+	YDBLogAutoTrace();
+	
+	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	
+	__unsafe_unretained YapWhitelistBlacklist *allowedCollections = secondaryIndex->options.allowedCollections;
+	if (allowedCollections && ![allowedCollections isAllowed:collectionKey.collection])
+	{
+		return;
+	}
+	
+	[self removeRowid:rowid];
+}
+
+/**
+ * YapDatabase extension hook.
+ * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+**/
+- (void)didRemoveObjectsForKeys:(NSArray __unused *)keys inCollection:(NSString *)collection withRowids:(NSArray *)rowids
+{
+	YDBLogAutoTrace();
+	
+	__unsafe_unretained YapDatabaseSecondaryIndex *secondaryIndex = parentConnection->parent;
+	
+	__unsafe_unretained YapWhitelistBlacklist *allowedCollections = secondaryIndex->options.allowedCollections;
+	if (allowedCollections && ![allowedCollections isAllowed:collection])
+	{
+		return;
+	}
+	
+	[self removeRowids:rowids];
+}
+
+/**
+ * YapDatabase extension hook.
+ * This method is invoked by a YapDatabaseReadWriteTransaction as a post-operation-hook.
+**/
+- (void)didRemoveAllObjectsInAllCollections
+{
+	YDBLogAutoTrace();
+	
+	[self removeAllRowids];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Utilities
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (sqlite3_stmt *)prepareQueryString:(NSString *)fullQueryString
+{
+	sqlite3_stmt *statement = NULL;
+	
+	YapDatabaseStatement *wrapper = [parentConnection->queryCache objectForKey:fullQueryString];
+	if (wrapper)
+	{
+		statement = wrapper.stmt;
+	}
+	else
+	{
+		sqlite3 *db = databaseTransaction->connection->db;
+		
+		int status = sqlite3_prepare_v2(db, [fullQueryString UTF8String], -1, &statement, NULL);
+		if (status == SQLITE_OK)
+		{
+			if (parentConnection->queryCache)
+			{
+				wrapper = [[YapDatabaseStatement alloc] initWithStatement:statement];
+				[parentConnection->queryCache setObject:wrapper forKey:fullQueryString];
+			}
+		}
+		else
+		{
+			YDBLogError(@"Error creating query:\n query: '%@'\n error: %d %s",
+			             fullQueryString, status, sqlite3_errmsg(db));
+			
+			return NULL;
 		}
 	}
 	
-	return statement;
+	return statement;
+}
+
+- (void)bindQueryParameters:(NSArray *)queryParams forStatement:(sqlite3_stmt *)statement withOffset:(int)bind_idx_start
+{
+	int bind_idx = bind_idx_start;
+	
+	for (id value in queryParams)
+	{
+		if ([value isKindOfClass:[NSNumber class]])
+		{
+			__unsafe_unretained NSNumber *cast = (NSNumber *)value;
+			
+			CFNumberType numType = CFNumberGetType((__bridge CFNumberRef)cast);
+			
+			if (numType == kCFNumberFloatType   ||
+			    numType == kCFNumberFloat32Type ||
+			    numType == kCFNumberFloat64Type ||
+			    numType == kCFNumberDoubleType  ||
+			    numType == kCFNumberCGFloatType  )
+			{
+				double num = [cast doubleValue];
+				sqlite3_bind_double(statement, bind_idx, num);
+			}
+			else
+			{
+				int64_t num = [cast longLongValue];
+				sqlite3_bind_int64(statement, bind_idx, (sqlite3_int64)num);
+			}
+		}
+		else if ([value isKindOfClass:[NSDate class]])
+		{
+			__unsafe_unretained NSDate *cast = (NSDate *)value;
+			
+			double num = [cast timeIntervalSinceReferenceDate];
+			sqlite3_bind_double(statement, bind_idx, num);
+		}
+		else if ([value isKindOfClass:[NSString class]])
+		{
+			__unsafe_unretained NSString *cast = (NSString *)value;
+			
+			sqlite3_bind_text(statement, bind_idx, [cast UTF8String], -1, SQLITE_TRANSIENT);
+		}
+		else
+		{
+			YDBLogWarn(@"Unable to bind value for with unsupported class: %@", NSStringFromClass([value class]));
+		}
+		
+		bind_idx++;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Memory Query
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Non-persistent counterpart of the sqlite enumeration below,
+ * with the same protection against mutation during enumeration.
+**/
+- (BOOL)_enumerateMemoryRowidsMatchingQuery:(YapDatabaseQuery *)query
+                         withValuesInColumn:(NSString *)column
+                                 usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, id value, BOOL *stop))block
+{
+	// Enumerate an immutable snapshot of the store.
+	// This is a cheap (copy-on-write) copy, and it means that changes made within the block
+	// can't modify the structure being enumerated.
+	
+	YapDatabaseSecondaryIndexMemoryStore *store = [[self memoryStore] copy];
+	if (store == nil) return NO;
+	
+	__block BOOL stopped = NO;
+	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
+	
+	BOOL result = [store enumerateRowidsMatchingQuery:query
+	                               withValuesInColumn:column
+	                                       usingBlock:^(int64_t rowid, id value, BOOL *stop)
+	{
+		block(rowid, value, stop);
+		
+		if (*stop)
+			stopped = YES;
+		else if (mutation.isMutated)
+			*stop = YES;
+	}];
+	
+	if (!stopped && mutation.isMutated)
+	{
+		@throw [self mutationDuringEnumerationException];
+	}
+	
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Standard Query - Enumerate
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (BOOL)_enumerateRowidsMatchingQuery:(YapDatabaseQuery *)query
+                           usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, BOOL *stop))block
+{
+	if (query == nil) return NO;
+	if (query.isAggregateQuery) return NO;
+	
+	// Write any changes made within this transaction, so the query sees them
+	
+	[self flushPendingChanges];
+	
+	if (memoryTableTransaction)
+	{
+		return [self _enumerateMemoryRowidsMatchingQuery:query
+		                              withValuesInColumn:nil
+		                                      usingBlock:^(int64_t rowid, id __unused value, BOOL *stop)
+		{
+			block(rowid, stop);
+		}];
+	}
+	
+	// Create full query using given filtering clause(s)
+	
+	NSString *fullQueryString =
+	    [NSString stringWithFormat:@"SELECT \"rowid\" FROM \"%@\" %@;", [self tableName], query.queryString];
+	
+	// Turn query into compiled sqlite statement (using cache if possible)
+	
+	sqlite3_stmt *statement = [self prepareQueryString:fullQueryString];
+	if (statement == NULL)
+	{
+		return NO;
+	}
+	
+	// Bind query parameters appropriately.
+	
+	[self bindQueryParameters:query.queryParameters forStatement:statement withOffset:SQLITE_BIND_START];
+	
+	return [self _enumerateRowidsWithStatement:statement usingBlock:block];
+}
+
+/**
+ * Steps through the given (already bound) statement, which must select only the rowid.
+ * The bindings are cleared & the statement is reset afterwards.
+**/
+- (BOOL)_enumerateRowidsWithStatement:(sqlite3_stmt *)statement
+                           usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, BOOL *stop))block
+{
+	// Enumerate query results
+	
+	BOOL stop = NO;
+	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
+	
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		int64_t rowid = sqlite3_column_int64(statement, SQLITE_COLUMN_START);
+		
+		block(rowid, &stop);
+		
+		if (stop || mutation.isMutated) break;
+	}
+	
+	if ((status != SQLITE_DONE) && !stop && !mutation.isMutated)
+	{
+		YDBLogError(@"sqlite_step error: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	if (!stop && mutation.isMutated)
+	{
+		@throw [self mutationDuringEnumerationException];
+	}
+	
+	return (status == SQLITE_DONE);
 }
 
-- (void)bindQueryParameters:(NSArray *)queryParams forStatement:(sqlite3_stmt *)statement withOffset:(int)bind_idx_start
+- (BOOL)enumerateKeysMatchingQuery:(YapDatabaseQuery *)query
+                        usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block
 {
-	int bind_idx = bind_idx_start;
+	BOOL result = [self _enumerateRowidsMatchingQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+		
+		if (block == NULL) // Query test : caller still wants BOOL result
+		{
+			*stop = YES;
+			return; // from block
+		}
+		
+		YapCollectionKey *ck = [self->databaseTransaction collectionKeyForRowid:rowid];
+		
+		block(ck.collection, ck.key, stop);
+	}];
 	
-	for (id value in queryParams)
+	return result;
+}
+
+- (BOOL)enumerateKeysAndMetadataMatchingQuery:(YapDatabaseQuery *)query
+                                   usingBlock:
+                            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id metadata, BOOL *stop))block
+{
+	BOOL result = [self _enumerateRowidsMatchingQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+		
+		if (block == NULL) // Query test : caller still wants BOOL result
+		{
+			*stop = YES;
+			return; // from block
+		}
+		
+		YapCollectionKey *ck = nil;
+		id metadata = nil;
+		[self->databaseTransaction getCollectionKey:&ck metadata:&metadata forRowid:rowid];
+		
+		block(ck.collection, ck.key, metadata, stop);
+	}];
+	
+	return result;
+}
+
+- (BOOL)enumerateKeysAndObjectsMatchingQuery:(YapDatabaseQuery *)query
+                                  usingBlock:
+                            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, BOOL *stop))block
+{
+	BOOL result = [self _enumerateRowidsMatchingQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+		
+		if (block == NULL) // Query test : caller still wants BOOL result
+		{
+			*stop = YES;
+			return; // from block
+		}
+		
+		YapCollectionKey *ck = nil;
+		id object = nil;
+		[self->databaseTransaction getCollectionKey:&ck object:&object forRowid:rowid];
+		
+		block(ck.collection, ck.key, object, stop);
+	}];
+	
+	return result;
+}
+
+- (BOOL)enumerateRowsMatchingQuery:(YapDatabaseQuery *)query
+                        usingBlock:
+                            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, id metadata, BOOL *stop))block
+{
+	BOOL result = [self _enumerateRowidsMatchingQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+		
+		if (block == NULL) // Query test : caller still wants BOOL result
+		{
+			*stop = YES;
+			return; // from block
+		}
+		
+		YapCollectionKey *ck = nil;
+		id object = nil;
+		id metadata = nil;
+		[self->databaseTransaction getCollectionKey:&ck object:&object metadata:&metadata forRowid:rowid];
+		
+		block(ck.collection, ck.key, object, metadata, stop);
+	}];
+	
+	return result;
+}
+
+- (BOOL)_enumerateIndexedValuesInColumn:(NSString *)column
+                          matchingQuery:(YapDatabaseQuery *)query
+                             usingBlock:(void (NS_NOESCAPE^)(id indexedValue, BOOL *stop))block
+{
+	if (column == nil) return NO;
+	if (query == nil) return NO;
+	if (query.isAggregateQuery) return NO;
+	
+	// Write any changes made within this transaction, so the query sees them
+	
+	[self flushPendingChanges];
+	
+	if (memoryTableTransaction)
 	{
-		if ([value isKindOfClass:[NSNumber class]])
+		return [self _enumerateMemoryRowidsMatchingQuery:query
+		                              withValuesInColumn:column
+		                                      usingBlock:^(int64_t __unused rowid, id indexedValue, BOOL *stop)
 		{
-			__unsafe_unretained NSNumber *cast = (NSNumber *)value;
-			
-			CFNumberType numType = CFNumberGetType((__bridge CFNumberRef)cast);
-			
-			if (numType == kCFNumberFloatType   ||
-			    numType == kCFNumberFloat32Type ||
-			    numType == kCFNumberFloat64Type ||
-			    numType == kCFNumberDoubleType  ||
-			    numType == kCFNumberCGFloatType  )
+			block(indexedValue, stop);
+		}];
+	}
+	
+	// Create full query using given filtering clause(s)
+	
+	NSString *fullQueryString =
+	  [NSString stringWithFormat:@"SELECT \"%@\" AS IndexedValue FROM \"%@\" %@;",
+	  column, [self tableName], query.queryString];
+	
+	// Turn query into compiled sqlite statement (using cache if possible)
+	
+	sqlite3_stmt *statement = [self prepareQueryString:fullQueryString];
+	if (statement == NULL)
+	{
+		return NO;
+	}
+	
+	// Bind query parameters appropriately.
+	
+	[self bindQueryParameters:query.queryParameters forStatement:statement withOffset:SQLITE_BIND_START];
+	
+	// Enumerate query results
+	
+	BOOL stop = NO;
+	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
+	
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		int columnType = sqlite3_column_type(statement, SQLITE_COLUMN_START);
+		id indexedValue = nil;
+		
+		switch(columnType) {
+			case SQLITE_INTEGER:
 			{
-				double num = [cast doubleValue];
-				sqlite3_bind_double(statement, bind_idx, num);
+				int64_t value = sqlite3_column_int64(statement, SQLITE_COLUMN_START);
+				indexedValue = @(value);
+				break;
 			}
-			else
+			
+			case SQLITE_FLOAT:
 			{
-				int64_t num = [cast longLongValue];
-				sqlite3_bind_int64(statement, bind_idx, (sqlite3_int64)num);
+				double value = sqlite3_column_double(statement, SQLITE_COLUMN_START);
+				indexedValue = @(value);
+				break;
 			}
-		}
-		else if ([value isKindOfClass:[NSDate class]])
-		{
-			__unsafe_unretained NSDate *cast = (NSDate *)value;
 			
-			double num = [cast timeIntervalSinceReferenceDate];
-			sqlite3_bind_double(statement, bind_idx, num);
-		}
-		else if ([value isKindOfClass:[NSString class]])
-		{
-			__unsafe_unretained NSString *cast = (NSString *)value;
+			case SQLITE_TEXT:
+			{
+				const unsigned char *text = sqlite3_column_text(statement, SQLITE_COLUMN_START);
+				int textSize = sqlite3_column_bytes(statement, SQLITE_COLUMN_START);
+				indexedValue = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+				break;
+			}
 			
-			sqlite3_bind_text(statement, bind_idx, [cast UTF8String], -1, SQLITE_TRANSIENT);
+			case SQLITE_BLOB:
+			{
+				const void *value = sqlite3_column_blob(statement, SQLITE_COLUMN_START);
+				int valueSize = sqlite3_column_bytes(statement, SQLITE_COLUMN_START);
+				indexedValue = [[NSData alloc] initWithBytes:value length:valueSize];
+				break;
+			}
 		}
-		else
+		
+		block(indexedValue, &stop);
+		
+		if (stop || mutation.isMutated) break;
+	}
+	
+	if ((status != SQLITE_DONE) && !stop && !mutation.isMutated)
+	{
+		YDBLogError(@"sqlite_step error: %d %s",
+					status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	if (!stop && mutation.isMutated)
+	{
+		@throw [self mutationDuringEnumerationException];
+	}
+	
+	return (status == SQLITE_DONE);
+}
+
+- (BOOL)enumerateIndexedValuesInColumn:(NSString *)column
+                         matchingQuery:(YapDatabaseQuery *)query
+                            usingBlock:(void(NS_NOESCAPE^)(id indexedValue, BOOL *stop))block
+{
+	BOOL result = [self _enumerateIndexedValuesInColumn:column
+	                                      matchingQuery:query
+	                                         usingBlock:^(id indexedValue, BOOL *stop)
+	{
+		if (block == NULL) // Query test : caller still wants BOOL result
 		{
-			YDBLogWarn(@"Unable to bind value for with unsupported class: %@", NSStringFromClass([value class]));
+			*stop = YES;
+			return; // from block
 		}
 		
-		bind_idx++;
-	}
+		block(indexedValue, stop);
+	}];
+	
+	return result;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#pragma mark Standard Query - Enumerate
+#pragma mark Standard Query - Count
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-- (BOOL)_enumerateRowidsMatchingQuery:(YapDatabaseQuery *)query
-                           usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, BOOL *stop))block
+- (BOOL)getNumberOfRows:(NSUInteger *)countPtr matchingQuery:(YapDatabaseQuery *)query
 {
-	if (query == nil) return NO;
-	if (query.isAggregateQuery) return NO;
+	// Write any changes made within this transaction, so the query sees them
+	
+	[self flushPendingChanges];
+	
+	if (memoryTableTransaction)
+	{
+		return [[self memoryStore] getNumberOfRows:countPtr matchingQuery:query];
+	}
 	
 	// Create full query using given filtering clause(s)
 	
 	NSString *fullQueryString =
-	    [NSString stringWithFormat:@"SELECT \"rowid\" FROM \"%@\" %@;", [self tableName], query.queryString];
+	    [NSString stringWithFormat:@"SELECT COUNT(*) AS NumberOfRows FROM \"%@\" %@;",
+	                                                           [self tableName], query.queryString];
 	
 	// Turn query into compiled sqlite statement (using cache if possible)
 	
@@ -1192,46 +2845,76 @@ static NSString *const ext_key_version_deprecated = @"version";
 		return NO;
 	}
 	
-	// Bind query parameters appropriately.
+	// Bind query parameters appropriately
 	
 	[self bindQueryParameters:query.queryParameters forStatement:statement withOffset:SQLITE_BIND_START];
 	
-	// Enumerate query results
+	// Execute query
 	
-	BOOL stop = NO;
-	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
+	BOOL result = YES;
+	NSUInteger count = 0;
 	
-	int status;
-	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
 	{
-		int64_t rowid = sqlite3_column_int64(statement, SQLITE_COLUMN_START);
-		
-		block(rowid, &stop);
-			
-		if (stop || mutation.isMutated) break;
+		count = (NSUInteger)sqlite3_column_int64(statement, SQLITE_COLUMN_START);
 	}
-	
-	if ((status != SQLITE_DONE) && !stop && !mutation.isMutated)
+	else if (status == SQLITE_ERROR)
 	{
 		YDBLogError(@"sqlite_step error: %d %s",
 		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		result = NO;
 	}
 	
 	sqlite3_clear_bindings(statement);
 	sqlite3_reset(statement);
 	
-	if (!stop && mutation.isMutated)
+	if (countPtr) *countPtr = count;
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Prepared Query
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (BOOL)_enumerateRowidsMatchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+                                   usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, BOOL *stop))block
+{
+	if (query == nil) return NO;
+	if (query->matchesNothing) return YES;
+	
+	// Write any changes made within this transaction, so the query sees them
+	
+	[self flushPendingChanges];
+	
+	if (memoryTableTransaction)
 	{
-		@throw [self mutationDuringEnumerationException];
+		return [self _enumerateMemoryRowidsMatchingQuery:[query queryWithCurrentParameters]
+		                              withValuesInColumn:nil
+		                                      usingBlock:^(int64_t rowid, id __unused value, BOOL *stop)
+		{
+			block(rowid, stop);
+		}];
 	}
 	
-	return (status == SQLITE_DONE);
+	// No string formatting or queryCache lookup here.
+	// The connection compiles the statement the first time the prepared query is used.
+	
+	sqlite3_stmt *statement = [parentConnection statementForPreparedQuery:query];
+	if (statement == NULL)
+	{
+		return NO;
+	}
+	
+	[query bindParametersToStatement:statement];
+	
+	return [self _enumerateRowidsWithStatement:statement usingBlock:block];
 }
 
-- (BOOL)enumerateKeysMatchingQuery:(YapDatabaseQuery *)query
-                        usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block
+- (BOOL)enumerateKeysMatchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+                                usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block
 {
-	BOOL result = [self _enumerateRowidsMatchingQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+	BOOL result = [self _enumerateRowidsMatchingPreparedQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
 		
 		if (block == NULL) // Query test : caller still wants BOOL result
 		{
@@ -1247,11 +2930,11 @@ static NSString *const ext_key_version_deprecated = @"version";
 	return result;
 }
 
-- (BOOL)enumerateKeysAndMetadataMatchingQuery:(YapDatabaseQuery *)query
-                                   usingBlock:
+- (BOOL)enumerateKeysAndMetadataMatchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+                                           usingBlock:
                             (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id metadata, BOOL *stop))block
 {
-	BOOL result = [self _enumerateRowidsMatchingQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+	BOOL result = [self _enumerateRowidsMatchingPreparedQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
 		
 		if (block == NULL) // Query test : caller still wants BOOL result
 		{
@@ -1269,11 +2952,11 @@ static NSString *const ext_key_version_deprecated = @"version";
 	return result;
 }
 
-- (BOOL)enumerateKeysAndObjectsMatchingQuery:(YapDatabaseQuery *)query
-                                  usingBlock:
+- (BOOL)enumerateKeysAndObjectsMatchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+                                          usingBlock:
                             (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, BOOL *stop))block
 {
-	BOOL result = [self _enumerateRowidsMatchingQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+	BOOL result = [self _enumerateRowidsMatchingPreparedQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
 		
 		if (block == NULL) // Query test : caller still wants BOOL result
 		{
@@ -1291,11 +2974,11 @@ static NSString *const ext_key_version_deprecated = @"version";
 	return result;
 }
 
-- (BOOL)enumerateRowsMatchingQuery:(YapDatabaseQuery *)query
-                        usingBlock:
+- (BOOL)enumerateRowsMatchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
+                                usingBlock:
                             (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, id metadata, BOOL *stop))block
 {
-	BOOL result = [self _enumerateRowidsMatchingQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+	BOOL result = [self _enumerateRowidsMatchingPreparedQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
 		
 		if (block == NULL) // Query test : caller still wants BOOL result
 		{
@@ -1314,162 +2997,285 @@ static NSString *const ext_key_version_deprecated = @"version";
 	return result;
 }
 
-- (BOOL)_enumerateIndexedValuesInColumn:(NSString *)column
-                          matchingQuery:(YapDatabaseQuery *)query
-                             usingBlock:(void (NS_NOESCAPE^)(id indexedValue, BOOL *stop))block
+- (BOOL)getNumberOfRows:(NSUInteger *)countPtr matchingPreparedQuery:(YapDatabaseSecondaryIndexPreparedQuery *)query
 {
-	if (column == nil) return NO;
 	if (query == nil) return NO;
-	if (query.isAggregateQuery) return NO;
-
-	// Create full query using given filtering clause(s)
+	
+	if (query->matchesNothing)
+	{
+		if (countPtr) *countPtr = 0;
+		return YES;
+	}
+	
+	// Write any changes made within this transaction, so the query sees them
+	
+	[self flushPendingChanges];
+	
+	if (memoryTableTransaction)
+	{
+		return [[self memoryStore] getNumberOfRows:countPtr matchingQuery:[query queryWithCurrentParameters]];
+	}
+	
+	sqlite3_stmt *statement = [parentConnection countStatementForPreparedQuery:query];
+	if (statement == NULL)
+	{
+		return NO;
+	}
+	
+	[query bindParametersToStatement:statement];
+	
+	BOOL result = YES;
+	NSUInteger count = 0;
+	
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		count = (NSUInteger)sqlite3_column_int64(statement, SQLITE_COLUMN_START);
+	}
+	else if (status == SQLITE_ERROR)
+	{
+		YDBLogError(@"sqlite_step error: %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+		result = NO;
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	if (countPtr) *countPtr = count;
+	return result;
+}
 
-	NSString *fullQueryString =
-	  [NSString stringWithFormat:@"SELECT \"%@\" AS IndexedValue FROM \"%@\" %@;",
-	  column, [self tableName], query.queryString];
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Joined Query
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-	// Turn query into compiled sqlite statement (using cache if possible)
+static int CompareRowids(const void *a, const void *b)
+{
+	int64_t rowidA = *(const int64_t *)a;
+	int64_t rowidB = *(const int64_t *)b;
+	
+	if (rowidA < rowidB) return -1;
+	if (rowidA > rowidB) return  1;
+	return 0;
+}
 
+/**
+ * Joined queries are executed in 2 stages:
+ * 
+ * 1. The SQL stage joins the secondary index table with the full text search table (if any),
+ *    so sqlite only ever returns the rows that match both.
+ * 
+ * 2. The view stage (if any) filters the rows by view membership.
+ *    Either per row (as they're streamed from sqlite),
+ *    or by walking the view group in order (sortByViewOrder), using a sorted array of the matching rowids.
+**/
+- (BOOL)_enumerateRowidsMatchingJoinedQuery:(YapDatabaseSecondaryIndexJoinedQuery *)joinedQuery
+                                 usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, BOOL *stop))block
+{
+	YapDatabaseQuery *query = joinedQuery.query;
+	
+	if (query == nil) return NO;
+	if (query.isAggregateQuery) return NO;
+	
+	if (memoryTableTransaction)
+	{
+		YDBLogError(@"%@ - Joined queries are not supported by a non-persistent secondary index",
+		            NSStringFromSelector(_cmd));
+		return NO;
+	}
+	
+	// Resolve the other extensions
+	
+	NSString *ftsTableName = nil;
+	NSString *ftsMatch = joinedQuery.fullTextSearchMatch;
+	
+	if (joinedQuery.fullTextSearchName && ftsMatch)
+	{
+		YapDatabaseExtensionTransaction *ftsTransaction = [databaseTransaction ext:joinedQuery.fullTextSearchName];
+		YapDatabaseExtension *fts = [[ftsTransaction extensionConnection] extension];
+		
+		if (![fts isKindOfClass:[YapDatabaseFullTextSearch class]])
+		{
+			YDBLogError(@"%@ - No YapDatabaseFullTextSearch registered with name: %@",
+			            NSStringFromSelector(_cmd), joinedQuery.fullTextSearchName);
+			return NO;
+		}
+		
+		ftsTableName = [(YapDatabaseFullTextSearch *)fts tableName];
+	}
+	
+	YapDatabaseViewTransaction *viewTransaction = nil;
+	NSString *viewGroup = joinedQuery.viewGroup;
+	
+	if (joinedQuery.viewName && viewGroup)
+	{
+		viewTransaction = [databaseTransaction ext:joinedQuery.viewName];
+		
+		if (![viewTransaction isKindOfClass:[YapDatabaseViewTransaction class]])
+		{
+			YDBLogError(@"%@ - No YapDatabaseView registered with name: %@",
+			            NSStringFromSelector(_cmd), joinedQuery.viewName);
+			return NO;
+		}
+	}
+	
+	// Write any changes made within this transaction, so the query sees them
+	
+	[self flushPendingChanges];
+	
+	// SELECT idx."rowid" FROM "siTable" AS idx
+	//   JOIN "ftsTable" AS fts ON fts."rowid" = idx."rowid" AND fts."ftsTable" MATCH ?
+	//   <query>;
+	
+	NSMutableString *fullQueryString = [NSMutableString stringWithCapacity:200];
+	[fullQueryString appendFormat:@"SELECT idx.\"rowid\" FROM \"%@\" AS idx", [self tableName]];
+	
+	if (ftsTableName)
+	{
+		[fullQueryString appendFormat:
+		  @" JOIN \"%@\" AS fts ON fts.\"rowid\" = idx.\"rowid\" AND fts.\"%@\" MATCH ?", ftsTableName, ftsTableName];
+	}
+	
+	[fullQueryString appendFormat:@" %@;", query.queryString];
+	
 	sqlite3_stmt *statement = [self prepareQueryString:fullQueryString];
 	if (statement == NULL)
 	{
 		return NO;
 	}
-
-	// Bind query parameters appropriately.
-
-	[self bindQueryParameters:query.queryParameters forStatement:statement withOffset:SQLITE_BIND_START];
-
-	// Enumerate query results
-
-	BOOL stop = NO;
-	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
-
-	int status;
-	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	
+	int bind_idx = SQLITE_BIND_START;
+	
+	YapDatabaseString _match; MakeYapDatabaseString(&_match, ftsMatch);
+	if (ftsTableName)
 	{
-		int columnType = sqlite3_column_type(statement, SQLITE_COLUMN_START);
-		id indexedValue = nil;
-
-		switch(columnType) {
-			case SQLITE_INTEGER:
-			{
-				int64_t value = sqlite3_column_int64(statement, SQLITE_COLUMN_START);
-				indexedValue = @(value);
-				break;
-			}
+		sqlite3_bind_text(statement, bind_idx, _match.str, _match.length, SQLITE_STATIC);
+		bind_idx++;
+	}
+	
+	[self bindQueryParameters:query.queryParameters forStatement:statement withOffset:bind_idx];
+	
+	NSUInteger const limit = joinedQuery.limit;
+	__block NSUInteger count = 0;
+	
+	BOOL result;
+	
+	if (viewTransaction && joinedQuery.sortByViewOrder)
+	{
+		// Collect the matching rowids (sorted, for binary search),
+		// and then walk the view group in order.
+		
+		__block int64_t *rowids = NULL;
+		__block NSUInteger rowidsCount = 0;
+		__block NSUInteger rowidsCapacity = 0;
+		
+		result = [self _enumerateRowidsWithStatement:statement usingBlock:^(int64_t rowid, BOOL __unused *stop) {
 			
-			case SQLITE_FLOAT:
+			if (rowidsCount == rowidsCapacity)
 			{
-				double value = sqlite3_column_double(statement, SQLITE_COLUMN_START);
-				indexedValue = @(value);
-				break;
-			}
-
-			case SQLITE_TEXT:
-			{
-				const unsigned char *text = sqlite3_column_text(statement, SQLITE_COLUMN_START);
-				int textSize = sqlite3_column_bytes(statement, SQLITE_COLUMN_START);
-				indexedValue = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
-				break;
+				rowidsCapacity = MAX(64, rowidsCapacity * 2);
+				rowids = reallocf(rowids, rowidsCapacity * sizeof(int64_t));
 			}
-
-			case SQLITE_BLOB:
+			
+			rowids[rowidsCount++] = rowid;
+		}];
+		FreeYapDatabaseString(&_match);
+		
+		if (result && rowidsCount > 0)
+		{
+			qsort(rowids, rowidsCount, sizeof(int64_t), CompareRowids);
+			
+			__block NSUInteger remaining = rowidsCount;
+			
+			[viewTransaction enumerateRowidsInGroup:viewGroup
+			                             usingBlock:^(int64_t rowid, NSUInteger __unused index, BOOL *stop)
 			{
-				const void *value = sqlite3_column_blob(statement, SQLITE_COLUMN_START);
-				int valueSize = sqlite3_column_bytes(statement, SQLITE_COLUMN_START);
-				indexedValue = [[NSData alloc] initWithBytes:value length:valueSize];
-				break;
-			}
+				if (bsearch(&rowid, rowids, rowidsCount, sizeof(int64_t), CompareRowids) == NULL) return;
+				
+				block(rowid, stop);
+				
+				if ((limit > 0 && ++count >= limit) || --remaining == 0) *stop = YES;
+			}];
 		}
 		
-		block(indexedValue, &stop);
-
-		if (stop || mutation.isMutated) break;
+		free(rowids);
 	}
-
-	if ((status != SQLITE_DONE) && !stop && !mutation.isMutated)
+	else
 	{
-		YDBLogError(@"sqlite_step error: %d %s",
-					status, sqlite3_errmsg(databaseTransaction->connection->db));
+		result = [self _enumerateRowidsWithStatement:statement usingBlock:^(int64_t rowid, BOOL *stop) {
+			
+			if (viewTransaction && ![[viewTransaction groupForRowid:rowid] isEqualToString:viewGroup]) return;
+			
+			block(rowid, stop);
+			
+			if (limit > 0 && ++count >= limit) *stop = YES;
+		}];
+		FreeYapDatabaseString(&_match);
 	}
+	
+	return result;
+}
 
-	sqlite3_clear_bindings(statement);
-	sqlite3_reset(statement);
-
-	if (!stop && mutation.isMutated)
-	{
-		@throw [self mutationDuringEnumerationException];
-	}
+- (BOOL)enumerateKeysMatchingJoinedQuery:(YapDatabaseSecondaryIndexJoinedQuery *)query
+                              usingBlock:(void (NS_NOESCAPE^)(NSString *collection, NSString *key, BOOL *stop))block
+{
+	BOOL result = [self _enumerateRowidsMatchingJoinedQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+		
+		YapCollectionKey *ck = [self->databaseTransaction collectionKeyForRowid:rowid];
+		
+		block(ck.collection, ck.key, stop);
+	}];
+	
+	return result;
+}
 
-	return (status == SQLITE_DONE);
+- (BOOL)enumerateKeysAndMetadataMatchingJoinedQuery:(YapDatabaseSecondaryIndexJoinedQuery *)query
+                                         usingBlock:
+                            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id metadata, BOOL *stop))block
+{
+	BOOL result = [self _enumerateRowidsMatchingJoinedQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+		
+		YapCollectionKey *ck = nil;
+		id metadata = nil;
+		[self->databaseTransaction getCollectionKey:&ck metadata:&metadata forRowid:rowid];
+		
+		block(ck.collection, ck.key, metadata, stop);
+	}];
+	
+	return result;
 }
 
-- (BOOL)enumerateIndexedValuesInColumn:(NSString *)column
-                         matchingQuery:(YapDatabaseQuery *)query
-                            usingBlock:(void(NS_NOESCAPE^)(id indexedValue, BOOL *stop))block
+- (BOOL)enumerateKeysAndObjectsMatchingJoinedQuery:(YapDatabaseSecondaryIndexJoinedQuery *)query
+                                        usingBlock:
+                            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, BOOL *stop))block
 {
-	BOOL result = [self _enumerateIndexedValuesInColumn:column
-	                                      matchingQuery:query
-	                                         usingBlock:^(id indexedValue, BOOL *stop)
-	{
-		if (block == NULL) // Query test : caller still wants BOOL result
-		{
-			*stop = YES;
-			return; // from block
-		}
-
-		block(indexedValue, stop);
+	BOOL result = [self _enumerateRowidsMatchingJoinedQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+		
+		YapCollectionKey *ck = nil;
+		id object = nil;
+		[self->databaseTransaction getCollectionKey:&ck object:&object forRowid:rowid];
+		
+		block(ck.collection, ck.key, object, stop);
 	}];
-
+	
 	return result;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-#pragma mark Standard Query - Count
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-- (BOOL)getNumberOfRows:(NSUInteger *)countPtr matchingQuery:(YapDatabaseQuery *)query
+- (BOOL)enumerateRowsMatchingJoinedQuery:(YapDatabaseSecondaryIndexJoinedQuery *)query
+                              usingBlock:
+                            (void (NS_NOESCAPE^)(NSString *collection, NSString *key, id object, id metadata, BOOL *stop))block
 {
-	// Create full query using given filtering clause(s)
-	
-	NSString *fullQueryString =
-	    [NSString stringWithFormat:@"SELECT COUNT(*) AS NumberOfRows FROM \"%@\" %@;",
-	                                                           [self tableName], query.queryString];
-	
-	// Turn query into compiled sqlite statement (using cache if possible)
-	
-	sqlite3_stmt *statement = [self prepareQueryString:fullQueryString];
-	if (statement == NULL)
-	{
-		return NO;
-	}
-	
-	// Bind query parameters appropriately
-	
-	[self bindQueryParameters:query.queryParameters forStatement:statement withOffset:SQLITE_BIND_START];
-	
-	// Execute query
-	
-	BOOL result = YES;
-	NSUInteger count = 0;
-	
-	int status = sqlite3_step(statement);
-	if (status == SQLITE_ROW)
-	{
-		count = (NSUInteger)sqlite3_column_int64(statement, SQLITE_COLUMN_START);
-	}
-	else if (status == SQLITE_ERROR)
-	{
-		YDBLogError(@"sqlite_step error: %d %s",
-		            status, sqlite3_errmsg(databaseTransaction->connection->db));
-		result = NO;
-	}
-	
-	sqlite3_clear_bindings(statement);
-	sqlite3_reset(statement);
+	BOOL result = [self _enumerateRowidsMatchingJoinedQuery:query usingBlock:^(int64_t rowid, BOOL *stop) {
+		
+		YapCollectionKey *ck = nil;
+		id object = nil;
+		id metadata = nil;
+		[self->databaseTransaction getCollectionKey:&ck object:&object metadata:&metadata forRowid:rowid];
+		
+		block(ck.collection, ck.key, object, metadata, stop);
+	}];
 	
-	if (countPtr) *countPtr = count;
 	return result;
 }
 
@@ -1482,6 +3288,15 @@ static NSString *const ext_key_version_deprecated = @"version";
 	if (query == nil) return nil;
 	if (query.isAggregateQuery == NO) return nil;
 	
+	// Write any changes made within this transaction, so the query sees them
+	
+	[self flushPendingChanges];
+	
+	if (memoryTableTransaction)
+	{
+		return [[self memoryStore] performAggregateQuery:query];
+	}
+	
 	NSString *fullQueryString =
 	    [NSString stringWithFormat:@"SELECT %@ AS Result FROM \"%@\" %@;",
 	                                        query.aggregateFunction, [self tableName], query.queryString];
@@ -1549,6 +3364,297 @@ static NSString *const ext_key_version_deprecated = @"version";
 	return result;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Aggregates
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (YapDatabaseSecondaryIndexAggregate *)aggregateWithName:(NSString *)aggregateName
+{
+	for (YapDatabaseSecondaryIndexAggregate *aggregate in [parentConnection->parent->setup aggregates])
+	{
+		if ([aggregate.name isEqualToString:aggregateName]) return aggregate;
+	}
+	
+	return nil;
+}
+
+/**
+ * Non-persistent only.
+ *
+ * Calculates the value of an aggregate group on demand (via the in-memory engine).
+**/
+- (NSNumber *)calculateValueForAggregate:(YapDatabaseSecondaryIndexAggregate *)aggregate group:(id)group
+{
+	NSString *function = NSStringFromYapDatabaseSecondaryIndexAggregateFunction(aggregate.function);
+	NSString *aggregateFunction = [NSString stringWithFormat:@"%@(%@)", function, (aggregate.column ?: @"*")];
+	
+	NSString *queryString = [NSString stringWithFormat:@"WHERE %@ = ?", aggregate.groupByColumn];
+	
+	YapDatabaseQuery *query = [YapDatabaseQuery queryWithAggregateFunction:aggregateFunction
+	                                                                string:queryString
+	                                                            parameters:@[ group ]];
+	
+	id result = [self performAggregateQuery:query];
+	
+	if ([result isKindOfClass:[NSNumber class]])
+	{
+		// Match the persistent behavior, where empty groups don't exist
+		
+		if (aggregate.function == YapDatabaseSecondaryIndexAggregateFunctionCount && [result longLongValue] == 0)
+			return nil;
+		else
+			return result;
+	}
+	
+	return nil;
+}
+
+- (NSNumber *)valueForAggregate:(NSString *)aggregateName group:(id)group
+{
+	YapDatabaseSecondaryIndexAggregate *aggregate = [self aggregateWithName:aggregateName];
+	if (aggregate == nil)
+	{
+		YDBLogWarn(@"%@ - No aggregate with name: %@", NSStringFromSelector(_cmd), aggregateName);
+		return nil;
+	}
+	
+	YapDatabaseSecondaryIndexColumn *groupByColumn = nil;
+	for (YapDatabaseSecondaryIndexColumn *column in parentConnection->parent->setup)
+	{
+		if ([column.name isEqualToString:aggregate.groupByColumn]) {
+			groupByColumn = column;
+			break;
+		}
+	}
+	
+	group = [self storedValueForValue:group column:groupByColumn];
+	if (group == nil) return nil;
+	
+	// Write any changes made within this transaction, so the aggregates reflect them
+	
+	[self flushPendingChanges];
+	
+	if (memoryTableTransaction)
+	{
+		return [self calculateValueForAggregate:aggregate group:group];
+	}
+	
+	YapCache *cache = [parentConnection aggregateCacheForName:aggregateName];
+	
+	id cachedValue = [cache objectForKey:group];
+	if (cachedValue)
+	{
+		return (cachedValue == [NSNull null]) ? nil : cachedValue;
+	}
+	
+	sqlite3_stmt *statement = [parentConnection aggregateSelectStatement];
+	if (statement == NULL) return nil;
+	
+	// SELECT "value", "count" FROM "aggregatesTableName" WHERE "name" = ? AND "group" = ?;
+	
+	[self bindAggregateName:aggregateName group:group toStatement:statement];
+	
+	NSNumber *value = nil;
+	
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		value = ColumnValue(statement, SQLITE_COLUMN_START);
+	}
+	else if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error executing 'aggregateSelectStatement': %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	if (status == SQLITE_ROW || status == SQLITE_DONE)
+	{
+		[cache setObject:(value ?: [NSNull null]) forKey:group];
+	}
+	
+	return value;
+}
+
+- (void)enumerateValuesForAggregate:(NSString *)aggregateName
+                         usingBlock:(void (NS_NOESCAPE^)(id group, NSNumber *value, BOOL *stop))block
+{
+	if (block == nil) return;
+	
+	YapDatabaseSecondaryIndexAggregate *aggregate = [self aggregateWithName:aggregateName];
+	if (aggregate == nil)
+	{
+		YDBLogWarn(@"%@ - No aggregate with name: %@", NSStringFromSelector(_cmd), aggregateName);
+		return;
+	}
+	
+	// Write any changes made within this transaction, so the aggregates reflect them
+	
+	[self flushPendingChanges];
+	
+	if (memoryTableTransaction)
+	{
+		// Calculate each (distinct) group on demand
+		
+		NSMutableOrderedSet *groups = [NSMutableOrderedSet orderedSet];
+		YapDatabaseQuery *query = [YapDatabaseQuery queryWithString:@"" parameters:@[]];
+		
+		[self _enumerateIndexedValuesInColumn:aggregate.groupByColumn
+		                        matchingQuery:query
+		                           usingBlock:^(id indexedValue, BOOL *stop)
+		{
+			if (indexedValue && indexedValue != [NSNull null]) {
+				[groups addObject:indexedValue];
+			}
+		}];
+		
+		BOOL stop = NO;
+		for (id group in groups)
+		{
+			NSNumber *value = [self calculateValueForAggregate:aggregate group:group];
+			if (value)
+			{
+				block(group, value, &stop);
+				if (stop) break;
+			}
+		}
+		
+		return;
+	}
+	
+	sqlite3_stmt *statement = [parentConnection aggregateEnumerateStatement];
+	if (statement == NULL) return;
+	
+	// SELECT "group", "value" FROM "aggregatesTableName" WHERE "name" = ?;
+	
+	sqlite3_bind_text(statement, SQLITE_BIND_START, [aggregateName UTF8String], -1, SQLITE_TRANSIENT);
+	
+	YapMutationStackItem_Bool *mutation = [parentConnection->mutationStack push]; // mutation during enum protection
+	
+	BOOL stop = NO;
+	int status;
+	
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		id group = ColumnValue(statement, SQLITE_COLUMN_START + 0);
+		NSNumber *value = ColumnValue(statement, SQLITE_COLUMN_START + 1);
+		
+		block(group, value, &stop);
+		
+		if (stop || mutation.isMutated) break;
+	}
+	
+	if ((status != SQLITE_DONE) && !stop && !mutation.isMutated)
+	{
+		YDBLogError(@"Error executing 'aggregateEnumerateStatement': %d %s",
+		            status, sqlite3_errmsg(databaseTransaction->connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	if (!stop && mutation.isMutated)
+	{
+		@throw [self mutationDuringEnumerationException];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Query Plan
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns the output of EXPLAIN QUERY PLAN for the given query,
+ * as it would be executed by the enumerate methods (or performAggregateQuery: for aggregate queries).
+ *
+ * For a non-persistent secondary index, describes how the in-memory engine would execute the query.
+**/
+- (NSString *)queryPlanForQuery:(YapDatabaseQuery *)query
+{
+	if (query == nil) return nil;
+	
+	if (memoryTableTransaction)
+	{
+		[self flushPendingChanges];
+		return [[self memoryStore] queryPlanForQuery:query];
+	}
+	
+	NSString *fullQueryString;
+	if (query.isAggregateQuery)
+	{
+		fullQueryString = [NSString stringWithFormat:@"EXPLAIN QUERY PLAN SELECT %@ AS Result FROM \"%@\" %@;",
+		                                                query.aggregateFunction, [self tableName], query.queryString];
+	}
+	else
+	{
+		fullQueryString = [NSString stringWithFormat:@"EXPLAIN QUERY PLAN SELECT \"rowid\" FROM \"%@\" %@;",
+		                                                [self tableName], query.queryString];
+	}
+	
+	// This is a debugging tool, so we don't bother caching the statement.
+	
+	sqlite3 *db = databaseTransaction->connection->db;
+	sqlite3_stmt *statement = NULL;
+	
+	int status = sqlite3_prepare_v2(db, [fullQueryString UTF8String], -1, &statement, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error creating query:\n query: '%@'\n error: %d %s",
+		             fullQueryString, status, sqlite3_errmsg(db));
+		
+		return nil;
+	}
+	
+	[self bindQueryParameters:query.queryParameters forStatement:statement withOffset:SQLITE_BIND_START];
+	
+	// Each row is: (id, parent, notused, detail)
+	// The parent column is used to indent subqueries, similar to the sqlite3 shell.
+	
+	int const column_idx_id     = SQLITE_COLUMN_START + 0;
+	int const column_idx_parent = SQLITE_COLUMN_START + 1;
+	int const column_idx_detail = SQLITE_COLUMN_START + 3;
+	
+	NSMutableDictionary<NSNumber*, NSNumber*> *depths = [NSMutableDictionary dictionary];
+	NSMutableString *plan = [NSMutableString string];
+	
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+	{
+		int planId = sqlite3_column_int(statement, column_idx_id);
+		int parentId = sqlite3_column_int(statement, column_idx_parent);
+		
+		const unsigned char *text = sqlite3_column_text(statement, column_idx_detail);
+		int textSize = sqlite3_column_bytes(statement, column_idx_detail);
+		
+		NSString *detail = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+		
+		NSUInteger depth = 0;
+		NSNumber *parentDepth = depths[@(parentId)];
+		if (parentDepth) {
+			depth = [parentDepth unsignedIntegerValue] + 1;
+		}
+		depths[@(planId)] = @(depth);
+		
+		if ([plan length] > 0) {
+			[plan appendString:@"\n"];
+		}
+		for (NSUInteger i = 0; i < depth; i++) {
+			[plan appendString:@"  "];
+		}
+		[plan appendString:(detail ?: @"")];
+	}
+	
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"sqlite_step error: %d %s", status, sqlite3_errmsg(db));
+	}
+	
+	sqlite3_finalize(statement);
+	
+	return (status == SQLITE_DONE) ? [plan copy] : nil;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Query Utilities
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1593,13 +3699,13 @@ static NSString *const ext_key_version_deprecated = @"version";
 {
 	NSString *reason = [NSString stringWithFormat:
 	    @"SecondaryIndex <RegisteredName=%@> was mutated while being enumerated.", [self registeredName]];
-
+	
 	NSDictionary *userInfo = @{ NSLocalizedRecoverySuggestionErrorKey:
 	    @"In general, you cannot modify the database while enumerating it."
 		@" This is similar in concept to an NSMutableArray."
 		@" If you only need to make a single modification, you may do so but you MUST set the 'stop' parameter"
 		@" of the enumeration block to YES (*stop = YES;) immediately after making the modification."};
-
+	
 	return [NSException exceptionWithName:@"YapDatabaseException" reason:reason userInfo:userInfo];
 }
 
@@ -10,6 +10,7 @@
 #import "YapCache.h"
 #import "YapCollectionKey.h"
 #import "YapDatabaseCollectionConfig.h"
+#import "YapDatabaseCollectionStatistics.h"
 #import "YapMemoryTable.h"
 #import "YapMutationStack.h"
 
@@ -64,6 +65,7 @@ extern NSString *const YapDatabaseRegisteredMemoryTablesKey;
 extern NSString *const YapDatabaseExtensionsOrderKey;
 extern NSString *const YapDatabaseExtensionDependenciesKey;
 extern NSString *const YapDatabaseRemovedRowidsKey;
+extern NSString *const YapDatabaseCollectionStatisticsKey;
 extern NSString *const YapDatabaseNotificationKey;
 
 /**
@@ -89,6 +91,8 @@ static NSString *const ext_key_class = @"class";
 	NSMutableArray *connectionStates; // Only to be used by YapDatabaseConnection
 	
 	NSArray *previouslyRegisteredExtensionNames; // Writeable only within snapshot queue
+	
+	BOOL collectionStatisticsFlushFailed; // Accessible only within write queue
 }
 
 /**
@@ -200,6 +204,31 @@ static NSString *const ext_key_class = @"class";
 #pragma mark -
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+@interface YapDatabaseCollectionStatistics ()
+
+- (instancetype)initWithNumberOfKeys:(int64_t)numberOfKeys numberOfBytes:(int64_t)numberOfBytes;
+
+@end
+
+/**
+ * Tracks the changes to a collection's statistics within a read-write transaction.
+ * 
+ * Normally the values are deltas, to be applied to the committed values.
+ * But if the collection was cleared during the transaction (removeAllObjectsInCollection:),
+ * then 'reset' is set, and the values are absolute.
+**/
+@interface YapCollectionStatisticsChange : NSObject {
+@public
+	BOOL reset;
+	int64_t numberOfKeys;
+	int64_t numberOfBytes;
+}
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 @interface YapDatabaseConnection () {	
 @public
 	__strong YapDatabase *database;
@@ -236,6 +265,13 @@ static NSString *const ext_key_class = @"class";
 	BOOL allKeysRemoved;
 	BOOL externallyModified;
 	
+	NSMutableDictionary<NSString*, YapDatabaseCollectionStatistics*> *collectionStatisticsCache; // Committed values
+	BOOL collectionStatisticsCacheIsComplete;  // If YES, a collection missing from the cache is empty
+	
+	NSMutableDictionary<NSString*, YapCollectionStatisticsChange*> *collectionStatisticsChanges;
+	BOOL collectionStatisticsReset;            // Set by removeAllObjectsInAllCollections
+	NSDictionary *committedCollectionStatistics; // Values written during commit, for the changeset
+	
 	YapMutationStack_Bool *mutationStack;
 }
 
@@ -252,10 +288,10 @@ static NSString *const ext_key_class = @"class";
 - (sqlite3_stmt *)yapRemoveForKeyStatement;    // Against "yap" database, for internal use
 - (sqlite3_stmt *)yapRemoveExtensionStatement; // Against "yap" database, for internal use
 
-- (sqlite3_stmt *)getCollectionCountStatement;
-- (sqlite3_stmt *)getKeyCountForCollectionStatement;
-- (sqlite3_stmt *)getKeyCountForAllStatement;
+- (sqlite3_stmt *)getCollectionStatisticsStatement;
+- (sqlite3_stmt *)getAllCollectionStatisticsStatement;
 - (sqlite3_stmt *)getCountForRowidStatement;
+- (sqlite3_stmt *)getSizeForRowidStatement;
 - (sqlite3_stmt *)getRowidForKeyStatement;
 - (sqlite3_stmt *)getKeyForRowidStatement;
 - (sqlite3_stmt *)getDataForRowidStatement;
@@ -271,10 +307,16 @@ static NSString *const ext_key_class = @"class";
 - (sqlite3_stmt *)removeForRowidStatement;
 - (sqlite3_stmt *)removeCollectionStatement;
 - (sqlite3_stmt *)removeAllStatement;
+- (sqlite3_stmt *)updateCollectionStatisticsStatement;
+- (sqlite3_stmt *)insertCollectionStatisticsStatement;
+- (sqlite3_stmt *)removeCollectionStatisticsStatement;
+- (sqlite3_stmt *)removeAllCollectionStatisticsStatement;
 
 - (sqlite3_stmt *)enumerateCollectionsStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateCollectionsForKeyStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateKeysInCollectionStatement:(BOOL *)needsFinalizePtr;
+- (sqlite3_stmt *)enumerateKeysInRangeStatement:(BOOL *)needsFinalizePtr;
+- (sqlite3_stmt *)enumerateKeysInRangeReverseStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateKeysInAllCollectionsStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateKeysAndMetadataInCollectionStatement:(BOOL *)needsFinalizePtr;
 - (sqlite3_stmt *)enumerateKeysAndMetadataInAllCollectionsStatement:(BOOL *)needsFinalizePtr;
@@ -485,6 +527,8 @@ static NSString *const ext_key_class = @"class";
 - (void)removeObjectForCollectionKey:(YapCollectionKey *)collectionKey withRowid:(int64_t)rowid;
 - (void)removeObjectForKey:(NSString *)key inCollection:(NSString *)collection withRowid:(int64_t)rowid;
 
+- (void)flushCollectionStatisticsChanges;
+
 - (void)addRegisteredExtensionTransaction:(YapDatabaseExtensionTransaction *)extTrnsactn withName:(NSString *)extName;
 - (void)removeRegisteredExtensionTransactionWithName:(NSString *)extName;
 
@@ -0,0 +1,36 @@
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ * Welcome to YapDatabase!
+ *
+ * The project page has a wealth of documentation if you have any questions.
+ * https://github.com/yapstudios/YapDatabase
+ *
+ * If you're new to the project you may want to visit the wiki.
+ * https://github.com/yapstudios/YapDatabase/wiki
+ *
+ * Describes the contents of a single collection.
+ *
+ * The statistics are maintained by the database as rows are inserted, updated & removed.
+ * So fetching them doesn't require scanning the collection.
+ *
+ * @see YapDatabaseReadTransaction collectionStatistics
+ */
+@interface YapDatabaseCollectionStatistics : NSObject
+
+/**
+ * The number of key/object pairs in the collection.
+ */
+@property (nonatomic, assign, readonly) NSUInteger numberOfKeys;
+
+/**
+ * The total size (in bytes) of the serialized objects & metadata in the collection.
+ * This doesn't include the size of the keys, nor any overhead of the sqlite file format.
+ */
+@property (nonatomic, assign, readonly) uint64_t numberOfBytes;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,40 @@
+#import "YapDatabaseCollectionStatistics.h"
+#import "YapDatabasePrivate.h"
+
+#if ! __has_feature(objc_arc)
+#warning This file must be compiled with ARC. Use -fobjc-arc flag (or convert project to ARC).
+#endif
+
+
+@implementation YapDatabaseCollectionStatistics
+
+@synthesize numberOfKeys = numberOfKeys;
+@synthesize numberOfBytes = numberOfBytes;
+
+- (instancetype)initWithNumberOfKeys:(int64_t)inNumberOfKeys numberOfBytes:(int64_t)inNumberOfBytes
+{
+	if ((self = [super init]))
+	{
+		// The counters are maintained as deltas, so we're careful to never expose a negative value.
+		
+		numberOfKeys = (inNumberOfKeys > 0) ? (NSUInteger)inNumberOfKeys : 0;
+		numberOfBytes = (inNumberOfBytes > 0) ? (uint64_t)inNumberOfBytes : 0;
+	}
+	return self;
+}
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<YapDatabaseCollectionStatistics[%p] numberOfKeys=%lu numberOfBytes=%llu>",
+	          self, (unsigned long)numberOfKeys, numberOfBytes];
+}
+
+@end
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark -
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+@implementation YapCollectionStatisticsChange
+
+@end
@@ -70,6 +70,7 @@ NSString *const YapDatabaseRegisteredExtensionsKey   = @"registeredExtensions";
 NSString *const YapDatabaseRegisteredMemoryTablesKey = @"registeredMemoryTables";
 NSString *const YapDatabaseExtensionsOrderKey        = @"extensionsOrder";
 NSString *const YapDatabaseExtensionDependenciesKey  = @"extensionDependencies";
+NSString *const YapDatabaseCollectionStatisticsKey   = @"collectionStatistics";
 NSString *const YapDatabaseNotificationKey           = @"notification";
 
 /**
@@ -87,7 +88,7 @@ static NSString *const YDBConnectionPoolValueKey_wal_file  = @"wal_file";
  * the version can be consulted to allow for proper on-the-fly upgrades.
  * For more information, see the upgradeTable method.
 **/
-#define YAP_DATABASE_CURRENT_VERION 3
+#define YAP_DATABASE_CURRENT_VERION 4
 
 /**
  * Default values
@@ -1031,6 +1032,7 @@ static YDBLogHandler logHandler = nil;
  * 
  * - yap2      : stores snapshot and metadata for extensions
  * - database2 : stores collection/key/value/metadata rows
+ * - collection_stats : stores the number of rows (and bytes) per collection
 **/
 - (BOOL)createTables
 {
@@ -1077,6 +1079,20 @@ static YDBLogHandler logHandler = nil;
 		return NO;
 	}
 	
+	char *createStatsTableStatement =
+	    "CREATE TABLE IF NOT EXISTS \"collection_stats\""
+	    " (\"collection\" CHAR PRIMARY KEY NOT NULL,"
+	    "  \"count\" INTEGER NOT NULL,"
+	    "  \"bytes\" INTEGER NOT NULL"
+	    " );";
+	
+	status = sqlite3_exec(db, createStatsTableStatement, NULL, NULL, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Failed creating 'collection_stats' table: %d %s", status, sqlite3_errmsg(db));
+		return NO;
+	}
+	
 	return YES;
 }
 
@@ -1457,6 +1473,18 @@ static YDBLogHandler logHandler = nil;
 	return YES;
 }
 
+/**
+ * In version 4, we added the 'collection_stats' table,
+ * which stores the number of rows (and bytes) in each collection.
+ * 
+ * This method populates it from the existing rows in 'database2'.
+ * From then on, the counters are maintained by the read-write transactions.
+**/
+- (BOOL)upgradeTable_3_4
+{
+	return [self rebuildCollectionStatisticsForSnapshot:[self readSnapshot]];
+}
+
 /**
  * Performs upgrade checks, and implements the upgrade "plumbing" by invoking the appropriate upgrade methods.
  * 
@@ -1534,6 +1562,15 @@ static YDBLogHandler logHandler = nil;
 	[self beginTransaction];
 	{
 		snapshot = [self readSnapshot];
+		
+		if ([self readCollectionStatisticsSnapshot] != snapshot)
+		{
+			// The database was modified by a version of YapDatabase that doesn't maintain 'collection_stats'
+			// (e.g. the app was downgraded, and then upgraded again). So the counters may be stale.
+			
+			YDBLogWarn(@"Recounting collection statistics (name=%@)", [databaseURL lastPathComponent]);
+			[self rebuildCollectionStatisticsForSnapshot:snapshot];
+		}
         
 		sqliteVersion = [YapDatabase sqliteVersionUsing:db];
 		YDBLogVerbose(@"sqlite version = %@", sqliteVersion);
@@ -1606,6 +1643,116 @@ static YDBLogHandler logHandler = nil;
 	return result;
 }
 
+/**
+ * Every read-write transaction that modifies the database increments the 'snapshot' value in the 'yap2' table.
+ * This has been the case since the very first version of YapDatabase.
+ * 
+ * Along with it, newer versions store the snapshot at which the 'collection_stats' table was last updated.
+ * So if the two values differ, then the database was modified by an older version,
+ * which didn't maintain the counters.
+**/
+- (uint64_t)readCollectionStatisticsSnapshot
+{
+	int status;
+	sqlite3_stmt *statement;
+	
+	const char *stmt = "SELECT \"data\" FROM \"yap2\" WHERE \"extension\" = ? AND \"key\" = ?;";
+	
+	int const column_idx_data    = SQLITE_COLUMN_START;
+	int const bind_idx_extension = SQLITE_BIND_START + 0;
+	int const bind_idx_key       = SQLITE_BIND_START + 1;
+	
+	uint64_t result = 0;
+	
+	status = sqlite3_prepare_v2(db, stmt, (int)strlen(stmt)+1, &statement, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error creating statement: %d %s", status, sqlite3_errmsg(db));
+	}
+	else
+	{
+		const char *extension = "";
+		sqlite3_bind_text(statement, bind_idx_extension, extension, (int)strlen(extension), SQLITE_STATIC);
+		
+		const char *key = "collection_stats_snapshot";
+		sqlite3_bind_text(statement, bind_idx_key, key, (int)strlen(key), SQLITE_STATIC);
+		
+		status = sqlite3_step(statement);
+		if (status == SQLITE_ROW)
+		{
+			result = (uint64_t)sqlite3_column_int64(statement, column_idx_data);
+		}
+		else if (status == SQLITE_ERROR)
+		{
+			YDBLogError(@"Error executing 'readCollectionStatisticsSnapshot': %d %s", status, sqlite3_errmsg(db));
+		}
+		
+		sqlite3_finalize(statement);
+	}
+	
+	return result;
+}
+
+/**
+ * Recounts the 'collection_stats' table from the rows in 'database2',
+ * and marks the counters as valid for the given snapshot.
+**/
+- (BOOL)rebuildCollectionStatisticsForSnapshot:(uint64_t)aSnapshot
+{
+	int status = sqlite3_exec(db, "DELETE FROM \"collection_stats\";", NULL, NULL, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error clearing 'collection_stats': %d %s", status, sqlite3_errmsg(db));
+		return NO;
+	}
+	
+	char *populateStatement =
+	    "INSERT INTO \"collection_stats\" (\"collection\", \"count\", \"bytes\")"
+	    " SELECT \"collection\", COUNT(*),"
+	    " SUM(IFNULL(length(\"data\"), 0) + IFNULL(length(\"metadata\"), 0))"
+	    " FROM \"database2\" GROUP BY \"collection\";";
+	
+	status = sqlite3_exec(db, populateStatement, NULL, NULL, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error populating 'collection_stats': %d %s", status, sqlite3_errmsg(db));
+		return NO;
+	}
+	
+	sqlite3_stmt *statement;
+	
+	const char *stmt = "INSERT OR REPLACE INTO \"yap2\" (\"extension\", \"key\", \"data\") VALUES (?, ?, ?);";
+	
+	int const bind_idx_extension = SQLITE_BIND_START + 0;
+	int const bind_idx_key       = SQLITE_BIND_START + 1;
+	int const bind_idx_data      = SQLITE_BIND_START + 2;
+	
+	status = sqlite3_prepare_v2(db, stmt, (int)strlen(stmt)+1, &statement, NULL);
+	if (status != SQLITE_OK)
+	{
+		YDBLogError(@"Error creating statement: %d %s", status, sqlite3_errmsg(db));
+		return NO;
+	}
+	
+	const char *extension = "";
+	sqlite3_bind_text(statement, bind_idx_extension, extension, (int)strlen(extension), SQLITE_STATIC);
+	
+	const char *key = "collection_stats_snapshot";
+	sqlite3_bind_text(statement, bind_idx_key, key, (int)strlen(key), SQLITE_STATIC);
+	
+	sqlite3_bind_int64(statement, bind_idx_data, (sqlite3_int64)aSnapshot);
+	
+	status = sqlite3_step(statement);
+	if (status != SQLITE_DONE)
+	{
+		YDBLogError(@"Error writing 'collection_stats_snapshot': %d %s", status, sqlite3_errmsg(db));
+	}
+	
+	sqlite3_finalize(statement);
+	
+	return (status == SQLITE_DONE);
+}
+
 - (void)fetchPreviouslyRegisteredExtensionNames
 {
 	int status;
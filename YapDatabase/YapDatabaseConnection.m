@@ -120,9 +120,9 @@ static int connectionBusyHandler(void *ptr, int count)
 	sqlite3_stmt *yapRemoveForKeyStatement;    // Against "yap" database, for internal use
 	sqlite3_stmt *yapRemoveExtensionStatement; // Against "yap" database, for internal use
 	
-	sqlite3_stmt *getCollectionCountStatement;
-	sqlite3_stmt *getKeyCountForCollectionStatement;
-	sqlite3_stmt *getKeyCountForAllStatement;
+	sqlite3_stmt *getCollectionStatisticsStatement;
+	sqlite3_stmt *getAllCollectionStatisticsStatement;
+	sqlite3_stmt *getSizeForRowidStatement;
 	sqlite3_stmt *getCountForRowidStatement;
 	sqlite3_stmt *getRowidForKeyStatement;
 	sqlite3_stmt *getKeyForRowidStatement;
@@ -139,10 +139,16 @@ static int connectionBusyHandler(void *ptr, int count)
 	sqlite3_stmt *removeForRowidStatement;
 	sqlite3_stmt *removeCollectionStatement;
 	sqlite3_stmt *removeAllStatement;
+	sqlite3_stmt *updateCollectionStatisticsStatement;
+	sqlite3_stmt *insertCollectionStatisticsStatement;
+	sqlite3_stmt *removeCollectionStatisticsStatement;
+	sqlite3_stmt *removeAllCollectionStatisticsStatement;
 	
 	sqlite3_stmt *enumerateCollectionsStatement;
 	sqlite3_stmt *enumerateCollectionsForKeyStatement;
 	sqlite3_stmt *enumerateKeysInCollectionStatement;
+	sqlite3_stmt *enumerateKeysInRangeStatement;
+	sqlite3_stmt *enumerateKeysInRangeReverseStatement;
 	sqlite3_stmt *enumerateKeysInAllCollectionsStatement;
 	sqlite3_stmt *enumerateKeysAndMetadataInCollectionStatement;
 	sqlite3_stmt *enumerateKeysAndMetadataInAllCollectionsStatement;
@@ -245,6 +251,8 @@ static int connectionBusyHandler(void *ptr, int count)
 		keyCache.allowedKeyClasses = [NSSet setWithObject:[NSNumber class]];
 		keyCache.allowedObjectClasses = [NSSet setWithObject:[YapCollectionKey class]];
 		
+		collectionStatisticsCache = [[NSMutableDictionary alloc] init];
+		
 		#if YapDatabaseEnforcePermittedTransactions
 		self.permittedTransactions = YDB_AnyTransaction;
 		#endif
@@ -483,9 +491,9 @@ static int connectionBusyHandler(void *ptr, int count)
 	sqlite_finalize_null(&yapRemoveForKeyStatement);
 	sqlite_finalize_null(&yapRemoveExtensionStatement);
 	
-	sqlite_finalize_null(&getCollectionCountStatement);
-	sqlite_finalize_null(&getKeyCountForCollectionStatement);
-	sqlite_finalize_null(&getKeyCountForAllStatement);
+	sqlite_finalize_null(&getCollectionStatisticsStatement);
+	sqlite_finalize_null(&getAllCollectionStatisticsStatement);
+	sqlite_finalize_null(&getSizeForRowidStatement);
 	sqlite_finalize_null(&getCountForRowidStatement);
 	sqlite_finalize_null(&getRowidForKeyStatement);
 	sqlite_finalize_null(&getKeyForRowidStatement);
@@ -502,10 +510,16 @@ static int connectionBusyHandler(void *ptr, int count)
 	sqlite_finalize_null(&removeForRowidStatement);
 	sqlite_finalize_null(&removeCollectionStatement);
 	sqlite_finalize_null(&removeAllStatement);
+	sqlite_finalize_null(&updateCollectionStatisticsStatement);
+	sqlite_finalize_null(&insertCollectionStatisticsStatement);
+	sqlite_finalize_null(&removeCollectionStatisticsStatement);
+	sqlite_finalize_null(&removeAllCollectionStatisticsStatement);
 	
 	sqlite_finalize_null(&enumerateCollectionsStatement);
 	sqlite_finalize_null(&enumerateCollectionsForKeyStatement);
 	sqlite_finalize_null(&enumerateKeysInCollectionStatement);
+	sqlite_finalize_null(&enumerateKeysInRangeStatement);
+	sqlite_finalize_null(&enumerateKeysInRangeReverseStatement);
 	sqlite_finalize_null(&enumerateKeysInAllCollectionsStatement);
 	sqlite_finalize_null(&enumerateKeysAndMetadataInCollectionStatement);
 	sqlite_finalize_null(&enumerateKeysAndMetadataInAllCollectionsStatement);
@@ -522,6 +536,9 @@ static int connectionBusyHandler(void *ptr, int count)
 		[keyCache removeAllObjects];
 		[objectCache removeAllObjects];
 		[metadataCache removeAllObjects];
+		
+		[collectionStatisticsCache removeAllObjects];
+		collectionStatisticsCacheIsComplete = NO;
 	}
 	
 	if (flags & YapDatabaseConnectionFlushMemoryFlags_Statements)
@@ -1070,12 +1087,12 @@ static int connectionBusyHandler(void *ptr, int count)
 	return *statement;
 }
 
-- (sqlite3_stmt *)getCollectionCountStatement
+- (sqlite3_stmt *)getCollectionStatisticsStatement
 {
-	sqlite3_stmt **statement = &getCollectionCountStatement;
+	sqlite3_stmt **statement = &getCollectionStatisticsStatement;
 	if (*statement == NULL)
 	{
-		const char *stmt = "SELECT COUNT(DISTINCT collection) AS NumberOfRows FROM \"database2\";";
+		const char *stmt = "SELECT \"count\", \"bytes\" FROM \"collection_stats\" WHERE \"collection\" = ?;";
 		int stmtLen = (int)strlen(stmt);
 		
 		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, statement, NULL);
@@ -1088,12 +1105,12 @@ static int connectionBusyHandler(void *ptr, int count)
 	return *statement;
 }
 
-- (sqlite3_stmt *)getKeyCountForCollectionStatement
+- (sqlite3_stmt *)getAllCollectionStatisticsStatement
 {
-	sqlite3_stmt **statement = &getKeyCountForCollectionStatement;
+	sqlite3_stmt **statement = &getAllCollectionStatisticsStatement;
 	if (*statement == NULL)
 	{
-		const char *stmt = "SELECT COUNT(*) AS NumberOfRows FROM \"database2\" WHERE \"collection\" = ?;";
+		const char *stmt = "SELECT \"collection\", \"count\", \"bytes\" FROM \"collection_stats\";";
 		int stmtLen = (int)strlen(stmt);
 		
 		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, statement, NULL);
@@ -1106,12 +1123,12 @@ static int connectionBusyHandler(void *ptr, int count)
 	return *statement;
 }
 
-- (sqlite3_stmt *)getKeyCountForAllStatement
+- (sqlite3_stmt *)getCountForRowidStatement
 {
-	sqlite3_stmt **statement = &getKeyCountForAllStatement;
+	sqlite3_stmt **statement = &getCountForRowidStatement;
 	if (*statement == NULL)
 	{
-		const char *stmt = "SELECT COUNT(*) AS NumberOfRows FROM \"database2\";";
+		const char *stmt = "SELECT COUNT(*) AS NumberOfRows FROM \"database2\" WHERE \"rowid\" = ?;";
 		int stmtLen = (int)strlen(stmt);
 		
 		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, statement, NULL);
@@ -1124,12 +1141,12 @@ static int connectionBusyHandler(void *ptr, int count)
 	return *statement;
 }
 
-- (sqlite3_stmt *)getCountForRowidStatement
+- (sqlite3_stmt *)getSizeForRowidStatement
 {
-	sqlite3_stmt **statement = &getCountForRowidStatement;
+	sqlite3_stmt **statement = &getSizeForRowidStatement;
 	if (*statement == NULL)
 	{
-		const char *stmt = "SELECT COUNT(*) AS NumberOfRows FROM \"database2\" WHERE \"rowid\" = ?;";
+		const char *stmt = "SELECT length(\"data\"), length(\"metadata\") FROM \"database2\" WHERE \"rowid\" = ?;";
 		int stmtLen = (int)strlen(stmt);
 		
 		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, statement, NULL);
@@ -1147,7 +1164,9 @@ static int connectionBusyHandler(void *ptr, int count)
 	sqlite3_stmt **statement = &getRowidForKeyStatement;
 	if (*statement == NULL)
 	{
-		const char *stmt = "SELECT \"rowid\" FROM \"database2\" WHERE \"collection\" = ? AND \"key\" = ?;";
+		const char *stmt =
+		  "SELECT \"rowid\", length(\"data\"), length(\"metadata\")"
+		  " FROM \"database2\" WHERE \"collection\" = ? AND \"key\" = ?;";
 		int stmtLen = (int)strlen(stmt);
 		
 		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, statement, NULL);
@@ -1414,6 +1433,80 @@ static int connectionBusyHandler(void *ptr, int count)
 	return *statement;
 }
 
+- (sqlite3_stmt *)updateCollectionStatisticsStatement
+{
+	sqlite3_stmt **statement = &updateCollectionStatisticsStatement;
+	if (*statement == NULL)
+	{
+		const char *stmt = "UPDATE \"collection_stats\" SET \"count\" = \"count\" + ?, \"bytes\" = \"bytes\" + ?"
+		                   " WHERE \"collection\" = ?;";
+		int stmtLen = (int)strlen(stmt);
+		
+		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, statement, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Error creating '%s': %d %s", stmt, status, sqlite3_errmsg(db));
+		}
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)insertCollectionStatisticsStatement
+{
+	sqlite3_stmt **statement = &insertCollectionStatisticsStatement;
+	if (*statement == NULL)
+	{
+		const char *stmt = "INSERT OR REPLACE INTO \"collection_stats\""
+		                   " (\"collection\", \"count\", \"bytes\") VALUES (?, ?, ?);";
+		int stmtLen = (int)strlen(stmt);
+		
+		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, statement, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Error creating '%s': %d %s", stmt, status, sqlite3_errmsg(db));
+		}
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)removeCollectionStatisticsStatement
+{
+	sqlite3_stmt **statement = &removeCollectionStatisticsStatement;
+	if (*statement == NULL)
+	{
+		const char *stmt = "DELETE FROM \"collection_stats\" WHERE \"collection\" = ?;";
+		int stmtLen = (int)strlen(stmt);
+		
+		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, statement, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Error creating '%s': %d %s", stmt, status, sqlite3_errmsg(db));
+		}
+	}
+	
+	return *statement;
+}
+
+- (sqlite3_stmt *)removeAllCollectionStatisticsStatement
+{
+	sqlite3_stmt **statement = &removeAllCollectionStatisticsStatement;
+	if (*statement == NULL)
+	{
+		const char *stmt = "DELETE FROM \"collection_stats\";";
+		int stmtLen = (int)strlen(stmt);
+		
+		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, statement, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Error creating '%s': %d %s", stmt, status, sqlite3_errmsg(db));
+		}
+	}
+	
+	return *statement;
+}
+
 - (sqlite3_stmt *)enumerateCollectionsStatement:(BOOL *)needsFinalizePtr
 {
 	sqlite3_stmt **statement = &enumerateCollectionsStatement;
@@ -1549,6 +1642,102 @@ static int connectionBusyHandler(void *ptr, int count)
 	return result;
 }
 
+- (sqlite3_stmt *)enumerateKeysInRangeStatement:(BOOL *)needsFinalizePtr
+{
+	sqlite3_stmt **statement = &enumerateKeysInRangeStatement;
+	
+	sqlite3_stmt* (^CreateStatement)(void) = ^{
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		const char *stmt =
+		  "SELECT \"rowid\", \"key\" FROM \"database2\""
+		  " WHERE \"collection\" = ? AND \"key\" >= ? AND \"key\" < ?"
+		  " ORDER BY \"key\" ASC LIMIT ?;";
+		int stmtLen = (int)strlen(stmt);
+		
+		sqlite3_stmt *result = NULL;
+		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, &result, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Error creating '%s': %d %s", stmt, status, sqlite3_errmsg(db));
+		}
+		
+		return result;
+		
+	#pragma clang diagnostic pop
+	};
+	
+	BOOL needsFinalize = NO;
+	sqlite3_stmt *result = NULL;
+	
+	if (*statement == NULL)
+	{
+		result = *statement = CreateStatement();
+	}
+	else if (sqlite3_stmt_busy(*statement))
+	{
+		result = CreateStatement();
+		needsFinalize = YES;
+	}
+	else
+	{
+		result = *statement;
+	}
+	
+	NSParameterAssert(needsFinalizePtr != NULL);
+	*needsFinalizePtr = needsFinalize;
+	return result;
+}
+
+- (sqlite3_stmt *)enumerateKeysInRangeReverseStatement:(BOOL *)needsFinalizePtr
+{
+	sqlite3_stmt **statement = &enumerateKeysInRangeReverseStatement;
+	
+	sqlite3_stmt* (^CreateStatement)(void) = ^{
+	#pragma clang diagnostic push
+	#pragma clang diagnostic ignored "-Wimplicit-retain-self"
+		
+		const char *stmt =
+		  "SELECT \"rowid\", \"key\" FROM \"database2\""
+		  " WHERE \"collection\" = ? AND \"key\" >= ? AND \"key\" < ?"
+		  " ORDER BY \"key\" DESC LIMIT ?;";
+		int stmtLen = (int)strlen(stmt);
+		
+		sqlite3_stmt *result = NULL;
+		int status = sqlite3_prepare_v2(db, stmt, stmtLen+1, &result, NULL);
+		if (status != SQLITE_OK)
+		{
+			YDBLogError(@"Error creating '%s': %d %s", stmt, status, sqlite3_errmsg(db));
+		}
+		
+		return result;
+		
+	#pragma clang diagnostic pop
+	};
+	
+	BOOL needsFinalize = NO;
+	sqlite3_stmt *result = NULL;
+	
+	if (*statement == NULL)
+	{
+		result = *statement = CreateStatement();
+	}
+	else if (sqlite3_stmt_busy(*statement))
+	{
+		result = CreateStatement();
+		needsFinalize = YES;
+	}
+	else
+	{
+		result = *statement;
+	}
+	
+	NSParameterAssert(needsFinalizePtr != NULL);
+	*needsFinalizePtr = needsFinalize;
+	return result;
+}
+
 - (sqlite3_stmt *)enumerateKeysInAllCollectionsStatement:(BOOL *)needsFinalizePtr
 {
 	sqlite3_stmt **statement = &enumerateKeysInAllCollectionsStatement;
@@ -2866,6 +3055,11 @@ static int connectionBusyHandler(void *ptr, int count)
 	
 	allKeysRemoved = NO;
 	
+	if (collectionStatisticsChanges == nil)
+		collectionStatisticsChanges = [[NSMutableDictionary alloc] init];
+	
+	collectionStatisticsReset = NO;
+	
 	if (mutationStack == nil)
 		mutationStack = [[YapMutationStack_Bool alloc] init];
 }
@@ -3245,6 +3439,15 @@ static int connectionBusyHandler(void *ptr, int count)
 	if ([removedRowids count] > 0)
 		removedRowids = nil;
 	
+	if ([committedCollectionStatistics count] > 0)
+		committedCollectionStatistics = nil;
+	
+	// Read-only transactions look for pending changes to the collection statistics.
+	// So these variables must be cleared (e.g. after a rollback).
+	
+	[collectionStatisticsChanges removeAllObjects];
+	collectionStatisticsReset = NO;
+	
 	[mutationStack clear];
 	
 	// Drop IsOnConnectionQueueKey flag from writeQueue since we're exiting writeQueue.
@@ -3544,6 +3747,32 @@ static int connectionBusyHandler(void *ptr, int count)
 	sqlite3_clear_bindings(statement);
 	sqlite3_reset(statement);
 	
+	// Mark the collection_stats table as up-to-date with this snapshot.
+	// Older versions of YapDatabase increment the snapshot, but don't maintain the collection_stats table.
+	// So if they modify the database, the values won't match, and the counters get rebuilt on the next launch.
+	// See [YapDatabase prepare].
+	//
+	// If we failed to write the counters ourselves, we stop marking them as valid (until they're rebuilt).
+	
+	if (!database->collectionStatisticsFlushFailed)
+	{
+		const char *statsKey = "collection_stats_snapshot";
+		
+		sqlite3_bind_text(statement, bind_idx_extension, extension, (int)strlen(extension), SQLITE_STATIC);
+		sqlite3_bind_text(statement, bind_idx_key, statsKey, (int)strlen(statsKey), SQLITE_STATIC);
+		sqlite3_bind_int64(statement, bind_idx_data, (sqlite3_int64)newSnapshot);
+		
+		status = sqlite3_step(statement);
+		if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"Error executing 'yapSetDataForKeyStatement': %d %s",
+			                                                       status, sqlite3_errmsg(db));
+		}
+		
+		sqlite3_clear_bindings(statement);
+		sqlite3_reset(statement);
+	}
+	
 	return newSnapshot;
 }
 
@@ -3824,6 +4053,7 @@ static int connectionBusyHandler(void *ptr, int count)
 	          YapDatabaseRemovedCollectionsKey,
 	          YapDatabaseRemovedRowidsKey,
 	          YapDatabaseAllKeysRemovedKey,
+	          YapDatabaseCollectionStatisticsKey,
 	          YapDatabaseModifiedExternallyKey ];
 }
 
@@ -4006,6 +4236,11 @@ static int connectionBusyHandler(void *ptr, int count)
 			internalChangeset[YapDatabaseAllKeysRemovedKey] = @(YES);
 			externalChangeset[YapDatabaseAllKeysRemovedKey] = @(YES);
 		}
+		
+		if ([committedCollectionStatistics count] > 0)
+		{
+			internalChangeset[YapDatabaseCollectionStatisticsKey] = committedCollectionStatistics;
+		}
         
         if (externallyModified)
         {
@@ -4077,6 +4312,8 @@ static int connectionBusyHandler(void *ptr, int count)
 	NSSet *changeset_removedKeys        = [changeset objectForKey:YapDatabaseRemovedKeysKey];
 	NSSet *changeset_removedCollections = [changeset objectForKey:YapDatabaseRemovedCollectionsKey];
 	
+	NSDictionary *changeset_collectionStatistics = [changeset objectForKey:YapDatabaseCollectionStatisticsKey];
+	
 	BOOL changeset_modifiedExternally = [[changeset objectForKey:YapDatabaseModifiedExternallyKey] boolValue];
 	BOOL changeset_allKeysRemoved = [[changeset objectForKey:YapDatabaseAllKeysRemovedKey] boolValue];
 	
@@ -4131,6 +4368,32 @@ static int connectionBusyHandler(void *ptr, int count)
 		}
 	}
 	
+	// Update collectionStatisticsCache
+	
+	if (changeset_allKeysRemoved)
+	{
+		// Shortcut: Everything was removed from the database.
+		// So every non-empty collection is listed in the changeset.
+		
+		[collectionStatisticsCache removeAllObjects];
+		collectionStatisticsCacheIsComplete = YES;
+	}
+	
+	for (NSString *collection in changeset_collectionStatistics)
+	{
+		id stats = changeset_collectionStatistics[collection];
+		
+		if ([stats isKindOfClass:[YapDatabaseCollectionStatistics class]])
+		{
+			collectionStatisticsCache[collection] = stats;
+		}
+		else
+		{
+			[collectionStatisticsCache removeObjectForKey:collection];
+			collectionStatisticsCacheIsComplete = NO;
+		}
+	}
+	
 	// Update objectCache
 	
 	if (changeset_allKeysRemoved && !hasObjectChanges)
@@ -1,6 +1,7 @@
 #import <Foundation/Foundation.h>
 
 #import "YapDatabaseTypes.h"
+#import "YapDatabaseCollectionStatistics.h"
 
 @class YapDatabaseConnection;
 @class YapDatabaseExtensionTransaction;
@@ -95,6 +96,20 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (NSUInteger)numberOfKeysInAllCollections;
 
+/**
+ * Returns the statistics (number of keys & total size) for every non-empty collection.
+ * 
+ * The statistics are maintained by the database as rows are inserted, updated & removed,
+ * and are cached by the connection. So this method (like the other methods above) doesn't scan the database.
+ */
+- (NSDictionary<NSString*, YapDatabaseCollectionStatistics*> *)collectionStatistics;
+
+/**
+ * Returns the statistics (number of keys & total size) for the given collection.
+ * Returns nil if the collection doesn't exist (or all key/object pairs from the collection have been removed).
+ */
+- (nullable YapDatabaseCollectionStatistics *)statisticsForCollection:(nullable NSString *)collection;
+
 #pragma mark List
 
 /**
@@ -113,6 +128,78 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - (NSArray<NSString *> *)allKeysInCollection:(nullable NSString *)collection;
 
+#pragma mark Key Ranges
+
+/**
+ * Returns the keys in the given collection within the range [fromKey, toKey), in order.
+ * A nil fromKey or toKey means the range is unbounded on that side.
+ *
+ * Keys are ordered by their UTF-8 bytes (sqlite's BINARY collation).
+ * For ASCII keys this is the same as a simple string comparison (case-sensitive).
+ *
+ * The scan uses the (collection, key) index, and stops after limit keys (zero means no limit).
+ * So the cost is proportional to the number of keys returned, not the size of the collection.
+ */
+- (NSArray<NSString *> *)keysInCollection:(nullable NSString *)collection
+                                     from:(nullable NSString *)fromKey
+                                       to:(nullable NSString *)toKey
+                                    limit:(NSUInteger)limit;
+
+/**
+ * Keyset pagination over the keys in the given collection, within the range [fromKey, toKey).
+ *
+ * If reverse is YES, the keys are returned in descending order (starting from the end of the range).
+ *
+ * The cursor is an in/out parameter.
+ * Pass a pointer to nil to get the first page.
+ * When the method returns, the cursor is set to a token for the next page, or to nil if there are no more keys.
+ * Pass it back (with the same range, limit & direction) to get the next page.
+ *
+ * For example:
+ *
+ * NSString *cursor = nil;
+ * do {
+ *     NSArray *keys = [transaction keysInCollection:@"messages" from:nil to:nil limit:100 reverse:NO cursor:&cursor];
+ *     // ...
+ * } while (cursor);
+ *
+ * Each page is a fresh index lookup, starting after the cursor (no OFFSET).
+ * So every page costs the same, regardless of how deep into the collection it is.
+ * The cursor also remains valid across transactions, even if keys are added or removed in the meantime.
+ * (Treat the cursor as opaque. Currently it's the last key of the page.)
+ */
+- (NSArray<NSString *> *)keysInCollection:(nullable NSString *)collection
+                                     from:(nullable NSString *)fromKey
+                                       to:(nullable NSString *)toKey
+                                    limit:(NSUInteger)limit
+                                  reverse:(BOOL)reverse
+                                   cursor:(NSString *_Nullable *_Nullable)cursorPtr;
+
+/**
+ * Keyset pagination over the keys in the given collection that begin with the given prefix.
+ * The cursor works the same way as above.
+ */
+- (NSArray<NSString *> *)keysInCollection:(nullable NSString *)collection
+                               withPrefix:(NSString *)prefix
+                                    limit:(NSUInteger)limit
+                                  reverse:(BOOL)reverse
+                                   cursor:(NSString *_Nullable *_Nullable)cursorPtr;
+
+/**
+ * Enumerates the keys in the given collection that begin with the given prefix, in order.
+ *
+ * This uses a "SELECT key FROM database WHERE collection = ? AND key >= ? AND key < ? ORDER BY key" operation,
+ * which is a range scan of the (collection, key) index.
+ */
+- (void)enumerateKeysInCollection:(nullable NSString *)collection
+                       withPrefix:(NSString *)prefix
+                       usingBlock:(void (NS_NOESCAPE^)(NSString *key, BOOL *stop))block;
+
+- (void)enumerateKeysInCollection:(nullable NSString *)collection
+                       withPrefix:(NSString *)prefix
+                          reverse:(BOOL)reverse
+                       usingBlock:(void (NS_NOESCAPE^)(NSString *key, BOOL *stop))block;
+
 #pragma mark Object & Metadata
 
 /**
@@ -26,6 +26,56 @@
 #endif
 #pragma unused(ydbLogLevel)
 
+/**
+ * Key ranges are expressed as UTF-8 bytes, which is how sqlite compares text (BINARY collation).
+ *
+ * The smallest key that's greater than the given key is the key followed by a NUL byte.
+**/
+static NSData *YDBKeySuccessor(NSData *key)
+{
+	NSMutableData *result = [key mutableCopy];
+	[result increaseLengthBy:1];
+	
+	return result;
+}
+
+/**
+ * The smallest key that's greater than every key that begins with the given prefix.
+ * That is, the prefix with its last byte incremented (after dropping any trailing 0xFF bytes).
+ * Returns nil if there's no such key (i.e. the range is unbounded).
+**/
+static NSData *YDBKeyPrefixSuccessor(NSData *prefix)
+{
+	NSMutableData *result = [prefix mutableCopy];
+	uint8_t *bytes = (uint8_t *)[result mutableBytes];
+	
+	NSUInteger length = [result length];
+	while ((length > 0) && (bytes[length - 1] == 0xFF))
+	{
+		length--;
+	}
+	
+	if (length == 0) return nil;
+	
+	bytes[length - 1]++;
+	[result setLength:length];
+	
+	return result;
+}
+
+static int YDBKeyCompare(NSData *a, NSData *b)
+{
+	NSUInteger aLength = [a length];
+	NSUInteger bLength = [b length];
+	
+	int cmp = memcmp([a bytes], [b bytes], MIN(aLength, bLength));
+	if (cmp != 0) return cmp;
+	
+	if (aLength < bLength) return -1;
+	if (aLength > bLength) return 1;
+	return 0;
+}
+
 
 @implementation YapDatabaseReadTransaction
 
@@ -151,6 +201,13 @@
 	}];
 	
 	[yapMemoryTableTransaction commit];
+	
+	// Step 3:
+	//
+	// Write the changes to the collection statistics (number of keys & bytes per collection).
+	// This is done last, as the extensions may have modified the main database table during the steps above.
+	
+	[(YapDatabaseReadWriteTransaction *)self flushCollectionStatisticsChanges];
 }
 
 - (void)commitTransaction
@@ -208,87 +265,204 @@
 
 - (NSUInteger)numberOfCollections
 {
-	sqlite3_stmt *statement = [connection getCollectionCountStatement];
-	if (statement == NULL) return 0;
-	
-	// SELECT COUNT(DISTINCT collection) AS NumberOfRows FROM "database2";
+	return [[self collectionStatistics] count];
+}
+
+- (NSUInteger)numberOfKeysInCollection:(NSString *)collection
+{
+	if (collection == nil) collection = @"";
 	
+	return [self _statisticsForCollection:collection].numberOfKeys;
+}
+
+- (NSUInteger)numberOfKeysInAllCollections
+{
 	NSUInteger result = 0;
 	
-	int status = sqlite3_step(statement);
-	if (status == SQLITE_ROW)
+	for (YapDatabaseCollectionStatistics *stats in [[self collectionStatistics] objectEnumerator])
 	{
-		result = (NSUInteger)sqlite3_column_int64(statement, SQLITE_COLUMN_START);
+		result += stats.numberOfKeys;
 	}
-	else if (status == SQLITE_ERROR)
+	
+	return result;
+}
+
+- (NSDictionary<NSString*, YapDatabaseCollectionStatistics*> *)collectionStatistics
+{
+	NSMutableDictionary *result = [NSMutableDictionary dictionary];
+	
+	NSDictionary *changes = connection->collectionStatisticsChanges;
+	
+	if (!connection->collectionStatisticsReset)
 	{
-		YDBLogError(@"Error executing 'getCollectionCountStatement': %d %s",
-		            status, sqlite3_errmsg(connection->db));
+		if (![self _loadAllCollectionStatistics]) return result;
+		
+		for (NSString *collection in connection->collectionStatisticsCache)
+		{
+			if (changes[collection]) continue; // handled below
+			
+			YapDatabaseCollectionStatistics *stats = connection->collectionStatisticsCache[collection];
+			if (stats.numberOfKeys > 0)
+			{
+				result[collection] = stats;
+			}
+		}
 	}
 	
-	sqlite3_reset(statement);
+	for (NSString *collection in changes)
+	{
+		YapDatabaseCollectionStatistics *stats = [self _statisticsForCollection:collection];
+		if (stats.numberOfKeys > 0)
+		{
+			result[collection] = stats;
+		}
+	}
 	
 	return result;
 }
 
-- (NSUInteger)numberOfKeysInCollection:(NSString *)collection
+- (YapDatabaseCollectionStatistics *)statisticsForCollection:(NSString *)collection
 {
 	if (collection == nil) collection = @"";
 	
-	sqlite3_stmt *statement = [connection getKeyCountForCollectionStatement];
-	if (statement == NULL) return 0;
+	YapDatabaseCollectionStatistics *stats = [self _statisticsForCollection:collection];
+	
+	return (stats.numberOfKeys > 0) ? stats : nil;
+}
+
+/**
+ * Returns the committed statistics for the given collection.
+ * That is, excluding any changes made within the current read-write transaction.
+ * 
+ * The values are cached by the connection, and kept up-to-date via the changesets.
+ * (Just like the objectCache & metadataCache.)
+**/
+- (YapDatabaseCollectionStatistics *)_committedStatisticsForCollection:(NSString *)collection
+{
+	YapDatabaseCollectionStatistics *stats = connection->collectionStatisticsCache[collection];
+	if (stats) return stats;
+	
+	int64_t numberOfKeys = 0;
+	int64_t numberOfBytes = 0;
 	
-	// SELECT COUNT(*) AS NumberOfRows FROM "database2" WHERE "collection" = ?;
+	if (!connection->collectionStatisticsCacheIsComplete)
+	{
+		sqlite3_stmt *statement = [connection getCollectionStatisticsStatement];
+		if (statement == NULL) return nil;
+		
+		// SELECT "count", "bytes" FROM "collection_stats" WHERE "collection" = ?;
+		
+		int const column_idx_count    = SQLITE_COLUMN_START + 0;
+		int const column_idx_bytes    = SQLITE_COLUMN_START + 1;
+		int const bind_idx_collection = SQLITE_BIND_START;
+		
+		YapDatabaseString _collection; MakeYapDatabaseString(&_collection, collection);
+		sqlite3_bind_text(statement, bind_idx_collection, _collection.str, _collection.length, SQLITE_STATIC);
+		
+		BOOL fetched = YES;
+		
+		int status = sqlite3_step(statement);
+		if (status == SQLITE_ROW)
+		{
+			numberOfKeys = sqlite3_column_int64(statement, column_idx_count);
+			numberOfBytes = sqlite3_column_int64(statement, column_idx_bytes);
+		}
+		else if (status != SQLITE_DONE)
+		{
+			YDBLogError(@"Error executing 'getCollectionStatisticsStatement': %d %s",
+			            status, sqlite3_errmsg(connection->db));
+			fetched = NO;
+		}
+		
+		sqlite3_clear_bindings(statement);
+		sqlite3_reset(statement);
+		FreeYapDatabaseString(&_collection);
+		
+		if (!fetched) return nil;
+	}
 	
-	int const column_idx_result   = SQLITE_COLUMN_START;
-	int const bind_idx_collection = SQLITE_BIND_START;
+	stats = [[YapDatabaseCollectionStatistics alloc] initWithNumberOfKeys:numberOfKeys numberOfBytes:numberOfBytes];
+	connection->collectionStatisticsCache[collection] = stats;
 	
-	YapDatabaseString _collection; MakeYapDatabaseString(&_collection, collection);
-	sqlite3_bind_text(statement, bind_idx_collection, _collection.str, _collection.length, SQLITE_STATIC);
+	return stats;
+}
+
+/**
+ * Ensures the connection's collectionStatisticsCache contains every (non-empty) collection.
+**/
+- (BOOL)_loadAllCollectionStatistics
+{
+	if (connection->collectionStatisticsCacheIsComplete) return YES;
 	
-	NSUInteger result = 0;
+	sqlite3_stmt *statement = [connection getAllCollectionStatisticsStatement];
+	if (statement == NULL) return NO;
 	
-	int status = sqlite3_step(statement);
-	if (status == SQLITE_ROW)
+	// SELECT "collection", "count", "bytes" FROM "collection_stats";
+	
+	int const column_idx_collection = SQLITE_COLUMN_START + 0;
+	int const column_idx_count      = SQLITE_COLUMN_START + 1;
+	int const column_idx_bytes      = SQLITE_COLUMN_START + 2;
+	
+	NSMutableDictionary *cache = [NSMutableDictionary dictionary];
+	
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
 	{
-		result = (NSUInteger)sqlite3_column_int64(statement, column_idx_result);
+		const unsigned char *text = sqlite3_column_text(statement, column_idx_collection);
+		int textSize = sqlite3_column_bytes(statement, column_idx_collection);
+		
+		NSString *collection = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+		
+		int64_t numberOfKeys = sqlite3_column_int64(statement, column_idx_count);
+		int64_t numberOfBytes = sqlite3_column_int64(statement, column_idx_bytes);
+		
+		cache[collection] =
+		  [[YapDatabaseCollectionStatistics alloc] initWithNumberOfKeys:numberOfKeys numberOfBytes:numberOfBytes];
 	}
-	else if (status == SQLITE_ERROR)
+	
+	if (status != SQLITE_DONE)
 	{
-		YDBLogError(@"Error executing 'getKeyCountForCollectionStatement': %d %s",
+		YDBLogError(@"Error executing 'getAllCollectionStatisticsStatement': %d %s",
 		            status, sqlite3_errmsg(connection->db));
 	}
 	
-	sqlite3_clear_bindings(statement);
 	sqlite3_reset(statement);
-	FreeYapDatabaseString(&_collection);
 	
-	return result;
+	if (status != SQLITE_DONE) return NO;
+	
+	connection->collectionStatisticsCache = cache;
+	connection->collectionStatisticsCacheIsComplete = YES;
+	
+	return YES;
 }
 
-- (NSUInteger)numberOfKeysInAllCollections
+/**
+ * Returns the statistics for the given collection, as of this point in the transaction.
+ * That is, the committed values plus any changes made within the current read-write transaction.
+**/
+- (YapDatabaseCollectionStatistics *)_statisticsForCollection:(NSString *)collection
 {
-	sqlite3_stmt *statement = [connection getKeyCountForAllStatement];
-	if (statement == NULL) return 0;
+	YapCollectionStatisticsChange *change = connection->collectionStatisticsChanges[collection];
 	
-	// SELECT COUNT(*) AS NumberOfRows FROM "database2";
-	
-	NSUInteger result = 0;
+	BOOL reset = connection->collectionStatisticsReset || (change && change->reset);
 	
-	int status = sqlite3_step(statement);
-	if (status == SQLITE_ROW)
+	YapDatabaseCollectionStatistics *committed = nil;
+	if (!reset)
 	{
-		result = (NSUInteger)sqlite3_column_int64(statement, SQLITE_COLUMN_START);
+		committed = [self _committedStatisticsForCollection:collection];
+		
+		if (change == nil) return committed;
 	}
-	else if (status == SQLITE_ERROR)
+	else if (change == nil)
 	{
-		YDBLogError(@"Error executing 'getKeyCountForAllStatement': %d %s",
-		            status, sqlite3_errmsg(connection->db));
+		// removeAllObjectsInAllCollections, and nothing added since
+		return [[YapDatabaseCollectionStatistics alloc] initWithNumberOfKeys:0 numberOfBytes:0];
 	}
 	
-	sqlite3_reset(statement);
+	int64_t numberOfKeys  = (int64_t)committed.numberOfKeys  + change->numberOfKeys;
+	int64_t numberOfBytes = (int64_t)committed.numberOfBytes + change->numberOfBytes;
 	
-	return result;
+	return [[YapDatabaseCollectionStatistics alloc] initWithNumberOfKeys:numberOfKeys numberOfBytes:numberOfBytes];
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -340,6 +514,119 @@
 	return result;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Key Ranges
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+- (NSArray *)keysInCollection:(NSString *)collection
+                         from:(NSString *)fromKey
+                           to:(NSString *)toKey
+                        limit:(NSUInteger)limit
+{
+	return [self keysInCollection:collection from:fromKey to:toKey limit:limit reverse:NO cursor:NULL];
+}
+
+- (NSArray *)keysInCollection:(NSString *)collection
+                         from:(NSString *)fromKey
+                           to:(NSString *)toKey
+                        limit:(NSUInteger)limit
+                      reverse:(BOOL)reverse
+                       cursor:(NSString **)cursorPtr
+{
+	NSData *lowerBound = [fromKey dataUsingEncoding:NSUTF8StringEncoding];
+	NSData *upperBound = [toKey dataUsingEncoding:NSUTF8StringEncoding];
+	
+	return [self _keysInCollection:collection
+	                    lowerBound:lowerBound
+	                    upperBound:upperBound
+	                         limit:limit
+	                       reverse:reverse
+	                        cursor:cursorPtr];
+}
+
+- (NSArray *)keysInCollection:(NSString *)collection
+                   withPrefix:(NSString *)prefix
+                        limit:(NSUInteger)limit
+                      reverse:(BOOL)reverse
+                       cursor:(NSString **)cursorPtr
+{
+	NSData *lowerBound = [prefix dataUsingEncoding:NSUTF8StringEncoding];
+	NSData *upperBound = YDBKeyPrefixSuccessor(lowerBound);
+	
+	return [self _keysInCollection:collection
+	                    lowerBound:lowerBound
+	                    upperBound:upperBound
+	                         limit:limit
+	                       reverse:reverse
+	                        cursor:cursorPtr];
+}
+
+/**
+ * Fetches a page of keys within the range [lowerBound, upperBound).
+ *
+ * The cursor is the last key of the previous page.
+ * So the next page starts strictly after it (or strictly before it, in reverse),
+ * which is expressed by narrowing the range. This keeps each page a single index range scan.
+ *
+ * One extra key is fetched to find out whether there's another page.
+**/
+- (NSArray *)_keysInCollection:(NSString *)collection
+                    lowerBound:(NSData *)lowerBound
+                    upperBound:(NSData *)upperBound
+                         limit:(NSUInteger)limit
+                       reverse:(BOOL)reverse
+                        cursor:(NSString **)cursorPtr
+{
+	NSString *cursor = cursorPtr ? *cursorPtr : nil;
+	if (cursor)
+	{
+		NSData *cursorBytes = [cursor dataUsingEncoding:NSUTF8StringEncoding];
+		
+		if (reverse)
+		{
+			if ((upperBound == nil) || (YDBKeyCompare(cursorBytes, upperBound) < 0))
+				upperBound = cursorBytes;
+		}
+		else
+		{
+			NSData *afterCursor = YDBKeySuccessor(cursorBytes);
+			
+			if ((lowerBound == nil) || (YDBKeyCompare(afterCursor, lowerBound) > 0))
+				lowerBound = afterCursor;
+		}
+	}
+	
+	BOOL needsCursor = (cursorPtr != NULL) && (limit > 0);
+	NSUInteger fetchLimit = needsCursor ? (limit + 1) : limit;
+	
+	NSMutableArray *result = [NSMutableArray arrayWithCapacity:MIN(fetchLimit, (NSUInteger)1024)];
+	
+	[self _enumerateKeysInCollection:collection
+	                      lowerBound:lowerBound
+	                      upperBound:upperBound
+	                         reverse:reverse
+	                           limit:fetchLimit
+	                      usingBlock:^(int64_t __unused rowid, NSString *key, BOOL __unused *stop)
+	{
+		[result addObject:key];
+	}];
+	
+	if (cursorPtr)
+	{
+		if (needsCursor && ([result count] > limit))
+		{
+			[result removeLastObject];
+			*cursorPtr = [result lastObject];
+		}
+		else
+		{
+			*cursorPtr = nil;
+		}
+	}
+	
+	return result;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Internal (using rowid)
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -358,15 +645,41 @@
 		return YES;
 	}
 	
+	return [self getRowid:rowidPtr dataSize:NULL metadataSize:NULL forCollectionKey:cacheKey];
+}
+
+/**
+ * Fetches the rowid, along with the size of the serialized object & metadata, for the given collection/key.
+ * The size pointers may be NULL.
+ *
+ * The sizes come from the same statement as the rowid, so they don't cost an extra query.
+ * But they aren't cached, so this method always executes the statement (bypassing the keyCache).
+ * It's used by the write methods, which need the previous sizes for the collection statistics.
+**/
+- (BOOL)getRowid:(int64_t *)rowidPtr
+        dataSize:(int64_t *)dataSizePtr
+    metadataSize:(int64_t *)metadataSizePtr
+forCollectionKey:(YapCollectionKey *)cacheKey
+{
+	if (dataSizePtr) *dataSizePtr = 0;
+	if (metadataSizePtr) *metadataSizePtr = 0;
+	
+	if (cacheKey == nil) {
+		if (rowidPtr) *rowidPtr = 0;
+		return NO;
+	}
+	
 	sqlite3_stmt *statement = [connection getRowidForKeyStatement];
 	if (statement == NULL) {
 		if (rowidPtr) *rowidPtr = 0;
 		return NO;
 	}
 	
-	// SELECT "rowid" FROM "database2" WHERE "collection" = ? AND "key" = ?;
+	// SELECT "rowid", length("data"), length("metadata") FROM "database2" WHERE "collection" = ? AND "key" = ?;
 	
-	int const column_idx_result   = SQLITE_COLUMN_START;
+	int const column_idx_result   = SQLITE_COLUMN_START + 0;
+	int const column_idx_data     = SQLITE_COLUMN_START + 1;
+	int const column_idx_metadata = SQLITE_COLUMN_START + 2;
 	int const bind_idx_collection = SQLITE_BIND_START + 0;
 	int const bind_idx_key        = SQLITE_BIND_START + 1;
 	
@@ -384,6 +697,11 @@
 	{
 		rowid = sqlite3_column_int64(statement, column_idx_result);
 		result = YES;
+		
+		// length(NULL) is NULL, which sqlite3_column_int64 converts to zero.
+		
+		if (dataSizePtr) *dataSizePtr = sqlite3_column_int64(statement, column_idx_data);
+		if (metadataSizePtr) *metadataSizePtr = sqlite3_column_int64(statement, column_idx_metadata);
 	}
 	else if (status == SQLITE_ERROR)
 	{
@@ -1712,6 +2030,40 @@
 	}];
 }
 
+/**
+ * Fast enumeration over the keys in the given collection that begin with the given prefix.
+ *
+ * This uses a "SELECT key FROM database WHERE collection = ? AND key >= ? AND key < ? ORDER BY key" operation,
+ * and then steps over the results invoking the given block handler.
+**/
+- (void)enumerateKeysInCollection:(NSString *)collection
+                       withPrefix:(NSString *)prefix
+                       usingBlock:(void (NS_NOESCAPE^)(NSString *key, BOOL *stop))block
+{
+	[self enumerateKeysInCollection:collection withPrefix:prefix reverse:NO usingBlock:block];
+}
+
+- (void)enumerateKeysInCollection:(NSString *)collection
+                       withPrefix:(NSString *)prefix
+                          reverse:(BOOL)reverse
+                       usingBlock:(void (NS_NOESCAPE^)(NSString *key, BOOL *stop))block
+{
+	if (block == NULL) return;
+	
+	NSData *lowerBound = [prefix dataUsingEncoding:NSUTF8StringEncoding];
+	NSData *upperBound = YDBKeyPrefixSuccessor(lowerBound);
+	
+	[self _enumerateKeysInCollection:collection
+	                      lowerBound:lowerBound
+	                      upperBound:upperBound
+	                         reverse:reverse
+	                           limit:0
+	                      usingBlock:^(int64_t __unused rowid, NSString *key, BOOL *stop)
+	{
+		block(key, stop);
+	}];
+}
+
 /**
  * Fast enumeration over all keys in the given collection.
  *
@@ -2748,48 +3100,133 @@
 }
 
 /**
- * Fast enumeration over all keys in select collections.
+ * Fast enumeration over the keys in the given collection within the range [lowerBound, upperBound), in key order.
  *
- * This uses a "SELECT key FROM database WHERE collection = ?" operation,
- * and then steps over the results invoking the given block handler.
+ * The bounds are UTF-8 bytes (nil means unbounded), and limit zero means no limit.
+ *
+ * This uses a "SELECT key FROM database WHERE collection = ? AND key >= ? AND key < ? ORDER BY key LIMIT ?" operation,
+ * which is a range scan of the (collection, key) index, and then steps over the results invoking the given block handler.
 **/
-- (void)_enumerateKeysInCollections:(NSArray *)collections
-                         usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, NSString *collection, NSString *key, BOOL *stop))block
+- (void)_enumerateKeysInCollection:(NSString *)collection
+                        lowerBound:(NSData *)lowerBound
+                        upperBound:(NSData *)upperBound
+                           reverse:(BOOL)reverse
+                             limit:(NSUInteger)limit
+                        usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, NSString *key, BOOL *stop))block
 {
 	if (block == NULL) return;
-	if ([collections count] == 0) return;
+	if (collection == nil) collection = @"";
 	
 	BOOL needsFinalize;
-	sqlite3_stmt *statement = [connection enumerateKeysInCollectionStatement:&needsFinalize];
+	sqlite3_stmt *statement = reverse
+	  ? [connection enumerateKeysInRangeReverseStatement:&needsFinalize]
+	  : [connection enumerateKeysInRangeStatement:&needsFinalize];
 	if (statement == NULL) return;
 	
 	YapMutationStackItem_Bool *mutation = [connection->mutationStack push]; // mutation during enumeration protection
 	BOOL stop = NO;
 	
-	// SELECT "rowid", "key" FROM "database2" WHERE collection = ?;
+	// SELECT "rowid", "key" FROM "database2"
+	//  WHERE "collection" = ? AND "key" >= ? AND "key" < ?
+	//  ORDER BY "key" ASC|DESC LIMIT ?;
 	
 	int const column_idx_rowid    = SQLITE_COLUMN_START + 0;
 	int const column_idx_key      = SQLITE_COLUMN_START + 1;
-	int const bind_idx_collection = SQLITE_BIND_START;
+	int const bind_idx_collection = SQLITE_BIND_START + 0;
+	int const bind_idx_lower      = SQLITE_BIND_START + 1;
+	int const bind_idx_upper      = SQLITE_BIND_START + 2;
+	int const bind_idx_limit      = SQLITE_BIND_START + 3;
 	
-	for (NSString *collection in collections)
+	YapDatabaseString _collection; MakeYapDatabaseString(&_collection, collection);
+	sqlite3_bind_text(statement, bind_idx_collection, _collection.str, _collection.length, SQLITE_STATIC);
+	
+	// Every key is >= the empty string.
+	// And sqlite sorts all BLOB values after all TEXT values, so every key is < an empty blob.
+	
+	if (lowerBound)
+		sqlite3_bind_text(statement, bind_idx_lower, [lowerBound bytes], (int)[lowerBound length], SQLITE_STATIC);
+	else
+		sqlite3_bind_text(statement, bind_idx_lower, "", 0, SQLITE_STATIC);
+	
+	if (upperBound)
+		sqlite3_bind_text(statement, bind_idx_upper, [upperBound bytes], (int)[upperBound length], SQLITE_STATIC);
+	else
+		sqlite3_bind_zeroblob(statement, bind_idx_upper, 0);
+	
+	sqlite3_bind_int64(statement, bind_idx_limit, (limit > 0) ? (sqlite3_int64)limit : -1);
+	
+	int status;
+	while ((status = sqlite3_step(statement)) == SQLITE_ROW)
 	{
-		YapDatabaseString _collection; MakeYapDatabaseString(&_collection, collection);
-		sqlite3_bind_text(statement, bind_idx_collection, _collection.str, _collection.length, SQLITE_STATIC);
+		int64_t rowid = sqlite3_column_int64(statement, column_idx_rowid);
 		
-		int status;
-		while ((status = sqlite3_step(statement)) == SQLITE_ROW)
-		{
-			int64_t rowid = sqlite3_column_int64(statement, column_idx_rowid);
-			
-			const unsigned char *text = sqlite3_column_text(statement, column_idx_key);
-			int textSize = sqlite3_column_bytes(statement, column_idx_key);
-			
-			NSString *key = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
-			
-			block(rowid, collection, key, &stop);
-			
-			if (stop || mutation.isMutated) break;
+		const unsigned char *text = sqlite3_column_text(statement, column_idx_key);
+		int textSize = sqlite3_column_bytes(statement, column_idx_key);
+		
+		NSString *key = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+		
+		block(rowid, key, &stop);
+		
+		if (stop || mutation.isMutated) break;
+	}
+	
+	if ((status != SQLITE_DONE) && !stop && !mutation.isMutated)
+	{
+		YDBLogError(@"sqlite_step error: %d %s", status, sqlite3_errmsg(connection->db));
+	}
+	
+	sqlite_enum_reset(statement, needsFinalize);
+	FreeYapDatabaseString(&_collection);
+	
+	if (!stop && mutation.isMutated)
+	{
+		@throw [self mutationDuringEnumerationException];
+	}
+}
+
+/**
+ * Fast enumeration over all keys in select collections.
+ *
+ * This uses a "SELECT key FROM database WHERE collection = ?" operation,
+ * and then steps over the results invoking the given block handler.
+**/
+- (void)_enumerateKeysInCollections:(NSArray *)collections
+                         usingBlock:(void (NS_NOESCAPE^)(int64_t rowid, NSString *collection, NSString *key, BOOL *stop))block
+{
+	if (block == NULL) return;
+	if ([collections count] == 0) return;
+	
+	BOOL needsFinalize;
+	sqlite3_stmt *statement = [connection enumerateKeysInCollectionStatement:&needsFinalize];
+	if (statement == NULL) return;
+	
+	YapMutationStackItem_Bool *mutation = [connection->mutationStack push]; // mutation during enumeration protection
+	BOOL stop = NO;
+	
+	// SELECT "rowid", "key" FROM "database2" WHERE collection = ?;
+	
+	int const column_idx_rowid    = SQLITE_COLUMN_START + 0;
+	int const column_idx_key      = SQLITE_COLUMN_START + 1;
+	int const bind_idx_collection = SQLITE_BIND_START;
+	
+	for (NSString *collection in collections)
+	{
+		YapDatabaseString _collection; MakeYapDatabaseString(&_collection, collection);
+		sqlite3_bind_text(statement, bind_idx_collection, _collection.str, _collection.length, SQLITE_STATIC);
+		
+		int status;
+		while ((status = sqlite3_step(statement)) == SQLITE_ROW)
+		{
+			int64_t rowid = sqlite3_column_int64(statement, column_idx_rowid);
+			
+			const unsigned char *text = sqlite3_column_text(statement, column_idx_key);
+			int textSize = sqlite3_column_bytes(statement, column_idx_key);
+			
+			NSString *key = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
+			
+			block(rowid, collection, key, &stop);
+			
+			if (stop || mutation.isMutated) break;
 		}
 		
 		if ((status != SQLITE_DONE) && !stop && !mutation.isMutated)
@@ -4761,9 +5198,16 @@
 	YapCollectionKey *cacheKey = [[YapCollectionKey alloc] initWithCollection:collection key:key];
 	
 	// Fetch rowid for <collection, key> tuple
+	// (along with the previous sizes, for the collection statistics)
 	
 	int64_t rowid = 0;
-	BOOL found = [self getRowid:&rowid forCollectionKey:cacheKey];
+	int64_t prevDataSize = 0;
+	int64_t prevMetadataSize = 0;
+	
+	BOOL found = [self getRowid:&rowid
+	                   dataSize:&prevDataSize
+	               metadataSize:&prevMetadataSize
+	           forCollectionKey:cacheKey];
     
 	for (YapDatabaseExtensionTransaction *extTransaction in [self orderedExtensions])
 	{
@@ -4861,6 +5305,12 @@
 	connection->hasDiskChanges = YES;
 	[connection->mutationStack markAsMutated];  // mutation during enumeration protection
 	
+	int64_t size = (int64_t)(serializedObject.length + serializedMetadata.length);
+	
+	[self noteCollectionStatisticsChangeForCollection:collection
+	                                        keysDelta:(found ? 0 : 1)
+	                                       bytesDelta:(size - prevDataSize - prevMetadataSize)];
+	
 	id _object = nil;
 	YapDatabasePolicy objectPolicy = collectionConfig.objectPolicy;
 	
@@ -4965,10 +5415,19 @@
 **/
 - (void)replaceObject:(id)object forKey:(NSString *)key inCollection:(NSString *)collection
 {
+	YapCollectionKey *cacheKey = [[YapCollectionKey alloc] initWithCollection:collection key:key];
+	
 	int64_t rowid = 0;
-	if ([self getRowid:&rowid forKey:key inCollection:collection])
+	int64_t prevDataSize = 0;
+	
+	if ([self getRowid:&rowid dataSize:&prevDataSize metadataSize:NULL forCollectionKey:cacheKey])
 	{
-		[self replaceObject:object forKey:key inCollection:collection withRowid:rowid serializedObject:nil];
+		[self replaceObject:object
+		             forKey:key
+		       inCollection:collection
+		          withRowid:rowid
+		       prevDataSize:prevDataSize
+		   serializedObject:nil];
 	}
 }
 
@@ -5008,13 +5467,18 @@
 - (void)replaceObject:(id)object forKey:(NSString *)key inCollection:(NSString *)collection
                                                 withSerializedObject:(NSData *)preSerializedObject
 {
+	YapCollectionKey *cacheKey = [[YapCollectionKey alloc] initWithCollection:collection key:key];
+	
 	int64_t rowid = 0;
-	if ([self getRowid:&rowid forKey:key inCollection:collection])
+	int64_t prevDataSize = 0;
+	
+	if ([self getRowid:&rowid dataSize:&prevDataSize metadataSize:NULL forCollectionKey:cacheKey])
 	{
 		[self replaceObject:object
 		             forKey:key
 		       inCollection:collection
 		          withRowid:rowid
+		       prevDataSize:prevDataSize
 		   serializedObject:preSerializedObject];
 	}
 }
@@ -5025,6 +5489,26 @@
 - (void)replaceObject:(id)object forKey:(NSString *)key inCollection:(NSString *)collection
                                                            withRowid:(int64_t)rowid
                                                     serializedObject:(NSData *)preSerializedObject
+{
+	int64_t prevDataSize = 0;
+	[self getDataSize:&prevDataSize metadataSize:NULL forRowid:rowid];
+	
+	[self replaceObject:object
+	             forKey:key
+	       inCollection:collection
+	          withRowid:rowid
+	       prevDataSize:prevDataSize
+	   serializedObject:preSerializedObject];
+}
+
+/**
+ * Internal replaceObject method that takes a rowid, along with the size of the previous (serialized) object.
+ * The size is used to update the collection statistics.
+**/
+- (void)replaceObject:(id)object forKey:(NSString *)key inCollection:(NSString *)collection
+                                                           withRowid:(int64_t)rowid
+                                                        prevDataSize:(int64_t)prevDataSize
+                                                    serializedObject:(NSData *)preSerializedObject
 {
 	if (object == nil)
 	{
@@ -5081,9 +5565,15 @@
 	sqlite3_bind_int64(statement, bind_idx_rowid, rowid);
 	
 	BOOL updated = YES;
+	BOOL exists = NO;
 	
 	int status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
+	if (status == SQLITE_DONE)
+	{
+		// The row may have already been removed (e.g. by an extension, within the pre-hook above).
+		exists = (sqlite3_changes(connection->db) > 0);
+	}
+	else
 	{
 		YDBLogError(@"Error executing 'updateObjectForRowidStatement': %d %s",
 		                                                    status, sqlite3_errmsg(connection->db));
@@ -5098,6 +5588,13 @@
 	connection->hasDiskChanges = YES;
 	[connection->mutationStack markAsMutated];  // mutation during enumeration protection
 	
+	if (exists)
+	{
+		[self noteCollectionStatisticsChangeForCollection:collection
+		                                        keysDelta:0
+		                                       bytesDelta:(int64_t)serializedObject.length - prevDataSize];
+	}
+	
 	id _object = nil;
 	YapDatabasePolicy objectPolicy = collectionConfig.objectPolicy;
 	
@@ -5154,10 +5651,19 @@
 **/
 - (void)replaceMetadata:(id)metadata forKey:(NSString *)key inCollection:(NSString *)collection
 {
+	YapCollectionKey *cacheKey = [[YapCollectionKey alloc] initWithCollection:collection key:key];
+	
 	int64_t rowid = 0;
-	if ([self getRowid:&rowid forKey:key inCollection:collection])
+	int64_t prevMetadataSize = 0;
+	
+	if ([self getRowid:&rowid dataSize:NULL metadataSize:&prevMetadataSize forCollectionKey:cacheKey])
 	{
-		[self replaceMetadata:metadata forKey:key inCollection:collection withRowid:rowid serializedMetadata:nil];
+		[self replaceMetadata:metadata
+		               forKey:key
+		         inCollection:collection
+		            withRowid:rowid
+		     prevMetadataSize:prevMetadataSize
+		   serializedMetadata:nil];
 	}
 }
 
@@ -5197,13 +5703,18 @@
 - (void)replaceMetadata:(id)metadata forKey:(NSString *)key inCollection:(NSString *)collection
                                                   withSerializedMetadata:(NSData *)preSerializedMetadata
 {
+	YapCollectionKey *cacheKey = [[YapCollectionKey alloc] initWithCollection:collection key:key];
+	
 	int64_t rowid = 0;
-	if ([self getRowid:&rowid forKey:key inCollection:collection])
+	int64_t prevMetadataSize = 0;
+	
+	if ([self getRowid:&rowid dataSize:NULL metadataSize:&prevMetadataSize forCollectionKey:cacheKey])
 	{
 		[self replaceMetadata:metadata
 		               forKey:key
 		         inCollection:collection
 		            withRowid:rowid
+		     prevMetadataSize:prevMetadataSize
 		   serializedMetadata:preSerializedMetadata];
 	}
 }
@@ -5216,6 +5727,28 @@
            inCollection:(NSString *)collection
               withRowid:(int64_t)rowid
      serializedMetadata:(NSData *)preSerializedMetadata
+{
+	int64_t prevMetadataSize = 0;
+	[self getDataSize:NULL metadataSize:&prevMetadataSize forRowid:rowid];
+	
+	[self replaceMetadata:metadata
+	               forKey:key
+	         inCollection:collection
+	            withRowid:rowid
+	     prevMetadataSize:prevMetadataSize
+	   serializedMetadata:preSerializedMetadata];
+}
+
+/**
+ * Internal replaceMetadata method that takes a rowid, along with the size of the previous (serialized) metadata.
+ * The size is used to update the collection statistics.
+**/
+- (void)replaceMetadata:(id)metadata
+                 forKey:(NSString *)key
+           inCollection:(NSString *)collection
+              withRowid:(int64_t)rowid
+       prevMetadataSize:(int64_t)prevMetadataSize
+     serializedMetadata:(NSData *)preSerializedMetadata
 {
 	NSAssert(key != nil, @"Internal error");
 	if (collection == nil) collection = @"";
@@ -5271,9 +5804,15 @@
 	sqlite3_bind_int64(statement, bind_idx_rowid, rowid);
 	
 	BOOL updated = YES;
-
+	BOOL exists = NO;
+	
 	int status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
+	if (status == SQLITE_DONE)
+	{
+		// The row may have already been removed (e.g. by an extension, within the pre-hook above).
+		exists = (sqlite3_changes(connection->db) > 0);
+	}
+	else
 	{
 		YDBLogError(@"Error executing 'updateMetadataForRowidStatement': %d %s",
 		                                                    status, sqlite3_errmsg(connection->db));
@@ -5288,6 +5827,13 @@
 	connection->hasDiskChanges = YES;
 	[connection->mutationStack markAsMutated];  // mutation during enumeration protection
 	
+	if (exists)
+	{
+		[self noteCollectionStatisticsChangeForCollection:collection
+		                                        keysDelta:0
+		                                       bytesDelta:(int64_t)serializedMetadata.length - prevMetadataSize];
+	}
+	
 	if (metadata)
 	{
 		id _metadata = nil;
@@ -5399,6 +5945,27 @@
 {
 	if (cacheKey == nil) return;
 	
+	int64_t prevDataSize = 0;
+	int64_t prevMetadataSize = 0;
+	[self getDataSize:&prevDataSize metadataSize:&prevMetadataSize forRowid:rowid];
+	
+	[self removeObjectForCollectionKey:cacheKey
+	                         withRowid:rowid
+	                      prevDataSize:prevDataSize
+	                  prevMetadataSize:prevMetadataSize];
+}
+
+/**
+ * Internal remove method that takes a rowid, along with the size of the (serialized) object & metadata.
+ * The sizes are used to update the collection statistics.
+**/
+- (void)removeObjectForCollectionKey:(YapCollectionKey *)cacheKey
+                           withRowid:(int64_t)rowid
+                        prevDataSize:(int64_t)prevDataSize
+                    prevMetadataSize:(int64_t)prevMetadataSize
+{
+	if (cacheKey == nil) return;
+	
 	sqlite3_stmt *statement = [connection removeForRowidStatement];
 	if (statement == NULL) return;
 	
@@ -5420,9 +5987,15 @@
 	sqlite3_bind_int64(statement, bind_idx_rowid, rowid);
 	
 	BOOL removed = YES;
-
+	BOOL exists = NO;
+	
 	int status = sqlite3_step(statement);
-	if (status != SQLITE_DONE)
+	if (status == SQLITE_DONE)
+	{
+		// The row may have already been removed (e.g. by an extension, within the pre-hook above).
+		exists = (sqlite3_changes(connection->db) > 0);
+	}
+	else
 	{
 		YDBLogError(@"Error executing 'removeForRowidStatement': %d %s", status, sqlite3_errmsg(connection->db));
 		removed = NO;
@@ -5436,6 +6009,13 @@
 	connection->hasDiskChanges = YES;
 	[connection->mutationStack markAsMutated];  // mutation during enumeration protection
 	
+	if (exists)
+	{
+		[self noteCollectionStatisticsChangeForCollection:cacheKey.collection
+		                                        keysDelta:-1
+		                                       bytesDelta:-(prevDataSize + prevMetadataSize)];
+	}
+	
 	[connection->keyCache removeObjectForKey:@(rowid)];
 	[connection->objectCache removeObjectForKey:cacheKey];
 	[connection->metadataCache removeObjectForKey:cacheKey];
@@ -5460,12 +6040,18 @@
 
 - (void)removeObjectForKey:(NSString *)key inCollection:(NSString *)collection
 {
+	YapCollectionKey *ck = [[YapCollectionKey alloc] initWithCollection:collection key:key];
+	
 	int64_t rowid = 0;
-	if ([self getRowid:&rowid forKey:key inCollection:collection])
+	int64_t prevDataSize = 0;
+	int64_t prevMetadataSize = 0;
+	
+	if ([self getRowid:&rowid dataSize:&prevDataSize metadataSize:&prevMetadataSize forCollectionKey:ck])
 	{
-		YapCollectionKey *ck = [[YapCollectionKey alloc] initWithCollection:collection key:key];
-		
-		[self removeObjectForCollectionKey:ck withRowid:rowid];
+		[self removeObjectForCollectionKey:ck
+		                         withRowid:rowid
+		                      prevDataSize:prevDataSize
+		                  prevMetadataSize:prevMetadataSize];
 	}
 }
 
@@ -5486,6 +6072,7 @@
 	
 	NSMutableArray *foundKeys = nil;
 	NSMutableArray *foundRowids = nil;
+	NSMutableArray *foundSizes = nil;
 	
 	// Sqlite has an upper bound on the number of host parameters that may be used in a single query.
 	// We need to watch out for this in case a large array of keys is passed.
@@ -5506,27 +6093,33 @@
 		{
 			foundKeys   = [NSMutableArray arrayWithCapacity:numKeyParams];
 			foundRowids = [NSMutableArray arrayWithCapacity:numKeyParams];
+			foundSizes  = [NSMutableArray arrayWithCapacity:numKeyParams];
 		}
 		else
 		{
 			[foundKeys removeAllObjects];
 			[foundRowids removeAllObjects];
+			[foundSizes removeAllObjects];
 		}
 		
 		// Find rowids for keys
 		
 		if (YES)
 		{
-			// SELECT "rowid", "key" FROM "database2" WHERE "collection" = ? AND "key" IN (?, ?, ...);
+			// SELECT "rowid", "key", length("data"), length("metadata") FROM "database2"
+			//  WHERE "collection" = ? AND "key" IN (?, ?, ...);
 			
-			int const column_idx_rowid = SQLITE_COLUMN_START + 0;
-			int const column_idx_key   = SQLITE_COLUMN_START + 1;
+			int const column_idx_rowid        = SQLITE_COLUMN_START + 0;
+			int const column_idx_key          = SQLITE_COLUMN_START + 1;
+			int const column_idx_dataSize     = SQLITE_COLUMN_START + 2;
+			int const column_idx_metadataSize = SQLITE_COLUMN_START + 3;
 			
-			NSUInteger capacity = 100 + (numKeyParams * 3);
+			NSUInteger capacity = 150 + (numKeyParams * 3);
 			NSMutableString *query = [NSMutableString stringWithCapacity:capacity];
 			
 			[query appendString:
-			    @"SELECT \"rowid\", \"key\" FROM \"database2\" WHERE \"collection\" = ? AND \"key\" IN ("];
+			    @"SELECT \"rowid\", \"key\", length(\"data\"), length(\"metadata\") FROM \"database2\""
+			    @" WHERE \"collection\" = ? AND \"key\" IN ("];
 			
 			NSUInteger i;
 			for (i = 0; i < numKeyParams; i++)
@@ -5567,8 +6160,12 @@
 				
 				NSString *key = [[NSString alloc] initWithBytes:text length:textSize encoding:NSUTF8StringEncoding];
 				
+				int64_t size = sqlite3_column_int64(statement, column_idx_dataSize)
+				             + sqlite3_column_int64(statement, column_idx_metadataSize);
+				
 				[foundKeys addObject:key];
 				[foundRowids addObject:@(rowid)];
+				[foundSizes addObject:@(size)];
 			}
 			
 			if (status != SQLITE_DONE)
@@ -5617,6 +6214,8 @@
 				return;
 			}
 			
+			YapMutationStackItem_Bool *mutation = [connection->mutationStack push];
+			
 			for (YapDatabaseExtensionTransaction *extTransaction in [self orderedExtensions])
 			{
 				[extTransaction willRemoveObjectsForKeys:foundKeys
@@ -5624,10 +6223,35 @@
 				                              withRowids:foundRowids];
 			}
 			
+			// The sizes from statement (A) are only valid if the pre-hooks above didn't modify the database.
+			// Otherwise (e.g. an extension removed some of the rows) we have to re-check each row.
+			
+			BOOL hooksMutated = mutation.isMutated;
+			
+			int64_t removedCount = 0;
+			int64_t removedSize = 0;
+			
 			for (i = 0; i < foundCount; i++)
 			{
 				int64_t rowid = [[foundRowids objectAtIndex:i] longLongValue];
 				
+				if (hooksMutated)
+				{
+					int64_t prevDataSize = 0;
+					int64_t prevMetadataSize = 0;
+					
+					if ([self getDataSize:&prevDataSize metadataSize:&prevMetadataSize forRowid:rowid])
+					{
+						removedCount++;
+						removedSize += (prevDataSize + prevMetadataSize);
+					}
+				}
+				else
+				{
+					removedCount++;
+					removedSize += [[foundSizes objectAtIndex:i] longLongValue];
+				}
+				
 				sqlite3_bind_int64(statement, (int)(SQLITE_BIND_START + i), rowid);
 			}
             
@@ -5637,6 +6261,12 @@
 				YDBLogError(@"Error executing 'removeKeys:inCollection:' statement (B): %d %s",
 							status, sqlite3_errmsg(connection->db));
 			}
+			else
+			{
+				[self noteCollectionStatisticsChangeForCollection:collection
+				                                        keysDelta:-removedCount
+				                                       bytesDelta:-removedSize];
+			}
 			
 			sqlite3_finalize(statement);
 			statement = NULL;
@@ -5805,6 +6435,10 @@
 			YDBLogError(@"Error executing 'removeCollectionStatement': %d %s, collection(%@)",
 			                                                       status, sqlite3_errmsg(connection->db), collection);
 		}
+		else
+		{
+			[self resetCollectionStatisticsForCollection:collection];
+		}
 		
 		sqlite3_clear_bindings(statement);
 		sqlite3_reset(statement);
@@ -5971,6 +6605,7 @@
 		
 	} while((left > 0) && ([foundKeys count] > 0));
 	
+	[self resetCollectionStatisticsForCollection:collection];
 	
 	FreeYapDatabaseString(&_collection);
 }
@@ -6008,12 +6643,347 @@
 	[connection->removedRowids removeAllObjects];
 	connection->allKeysRemoved = YES;
 	
+	[connection->collectionStatisticsChanges removeAllObjects];
+	connection->collectionStatisticsReset = YES;
+	
 	for (YapDatabaseExtensionTransaction *extTransaction in [self orderedExtensions])
 	{
 		[extTransaction didRemoveAllObjectsInAllCollections];
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma mark Collection Statistics
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Fetches the size of the serialized object & metadata for the given rowid.
+ * Either pointer may be NULL.
+ * 
+ * @return YES if the row exists. NO otherwise.
+**/
+- (BOOL)getDataSize:(int64_t *)dataSizePtr metadataSize:(int64_t *)metadataSizePtr forRowid:(int64_t)rowid
+{
+	sqlite3_stmt *statement = [connection getSizeForRowidStatement];
+	if (statement == NULL) return NO;
+	
+	// SELECT length("data"), length("metadata") FROM "database2" WHERE "rowid" = ?;
+	
+	int const column_idx_data     = SQLITE_COLUMN_START + 0;
+	int const column_idx_metadata = SQLITE_COLUMN_START + 1;
+	int const bind_idx_rowid      = SQLITE_BIND_START;
+	
+	sqlite3_bind_int64(statement, bind_idx_rowid, rowid);
+	
+	BOOL found = NO;
+	int64_t dataSize = 0;
+	int64_t metadataSize = 0;
+	
+	int status = sqlite3_step(statement);
+	if (status == SQLITE_ROW)
+	{
+		// length(NULL) is NULL, which sqlite3_column_int64 converts to zero.
+		
+		dataSize = sqlite3_column_int64(statement, column_idx_data);
+		metadataSize = sqlite3_column_int64(statement, column_idx_metadata);
+		found = YES;
+	}
+	else if (status == SQLITE_ERROR)
+	{
+		YDBLogError(@"Error executing 'getSizeForRowidStatement': %d %s", status, sqlite3_errmsg(connection->db));
+	}
+	
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+	
+	if (dataSizePtr) *dataSizePtr = dataSize;
+	if (metadataSizePtr) *metadataSizePtr = metadataSize;
+	
+	return found;
+}
+
+/**
+ * Records a change to the statistics of the given collection.
+ * The changes are accumulated in memory, and written to the database when the transaction is committed.
+**/
+- (void)noteCollectionStatisticsChangeForCollection:(NSString *)collection
+                                          keysDelta:(int64_t)keysDelta
+                                         bytesDelta:(int64_t)bytesDelta
+{
+	YapCollectionStatisticsChange *change = connection->collectionStatisticsChanges[collection];
+	if (change == nil)
+	{
+		change = [[YapCollectionStatisticsChange alloc] init];
+		connection->collectionStatisticsChanges[collection] = change;
+	}
+	
+	change->numberOfKeys += keysDelta;
+	change->numberOfBytes += bytesDelta;
+}
+
+/**
+ * Invoked after all the rows in the given collection have been removed.
+**/
+- (void)resetCollectionStatisticsForCollection:(NSString *)collection
+{
+	YapCollectionStatisticsChange *change = [[YapCollectionStatisticsChange alloc] init];
+	change->reset = YES;
+	
+	connection->collectionStatisticsChanges[collection] = change;
+}
+
+/**
+ * Writes the accumulated changes to the collection_stats table.
+ * 
+ * This method is invoked from preCommitReadWriteTransaction,
+ * after the extensions have flushed their changes to the main database table.
+ * 
+ * The connection's collectionStatisticsCache is updated with the new values,
+ * which are then passed to the other connections via the changeset.
+ * If we don't know a new value (due to an error), we pass NSNull,
+ * and the other connections will fetch it from the database if needed.
+**/
+- (void)flushCollectionStatisticsChanges
+{
+	NSDictionary<NSString*, YapCollectionStatisticsChange*> *changes = connection->collectionStatisticsChanges;
+	BOOL reset = connection->collectionStatisticsReset;
+	
+	if ([changes count] == 0 && !reset) return;
+	
+	if (reset)
+	{
+		sqlite3_stmt *statement = [connection removeAllCollectionStatisticsStatement];
+		if (statement)
+		{
+			// DELETE FROM "collection_stats";
+			
+			int status = sqlite3_step(statement);
+			if (status != SQLITE_DONE)
+			{
+				YDBLogError(@"Error executing 'removeAllCollectionStatisticsStatement': %d %s",
+				            status, sqlite3_errmsg(connection->db));
+				
+				connection->database->collectionStatisticsFlushFailed = YES;
+			}
+			
+			sqlite3_reset(statement);
+		}
+		
+		// Every non-empty collection is now listed in the changes.
+		
+		[connection->collectionStatisticsCache removeAllObjects];
+		connection->collectionStatisticsCacheIsComplete = YES;
+	}
+	
+	NSMutableDictionary *committed = [NSMutableDictionary dictionaryWithCapacity:[changes count]];
+	
+	for (NSString *collection in changes)
+	{
+		YapCollectionStatisticsChange *change = changes[collection];
+		
+		BOOL isAbsolute = reset || change->reset;
+		
+		if (!isAbsolute && (change->numberOfKeys == 0) && (change->numberOfBytes == 0))
+		{
+			// E.g. an object was replaced with another of the same size.
+			// Nothing to write, and nothing to report to the other connections.
+			continue;
+		}
+		
+		YapDatabaseCollectionStatistics *stats =
+		  [self writeCollectionStatisticsChange:change forCollection:collection isAbsolute:isAbsolute];
+		
+		if (stats)
+		{
+			connection->collectionStatisticsCache[collection] = stats;
+			committed[collection] = stats;
+		}
+		else
+		{
+			[connection->collectionStatisticsCache removeObjectForKey:collection];
+			connection->collectionStatisticsCacheIsComplete = NO;
+			committed[collection] = [NSNull null];
+			
+			// The table may now be incorrect, so it must be rebuilt on the next launch.
+			// See incrementSnapshotInDatabase.
+			connection->database->collectionStatisticsFlushFailed = YES;
+		}
+	}
+	
+	// The changes are now part of the committed values (in the cache).
+	// So they must not be applied again if the statistics are requested during the remainder of the commit.
+	
+	[connection->collectionStatisticsChanges removeAllObjects];
+	connection->collectionStatisticsReset = NO;
+	
+	connection->committedCollectionStatistics = [committed copy];
+}
+
+/**
+ * Applies a single change to the collection_stats table.
+ * 
+ * @return The new statistics for the collection, or nil if an error occurred.
+**/
+- (YapDatabaseCollectionStatistics *)writeCollectionStatisticsChange:(YapCollectionStatisticsChange *)change
+                                                       forCollection:(NSString *)collection
+                                                          isAbsolute:(BOOL)isAbsolute
+{
+	int64_t numberOfKeys = change->numberOfKeys;
+	int64_t numberOfBytes = change->numberOfBytes;
+	
+	BOOL exists = NO;
+	BOOL failed = NO;
+	
+	YapDatabaseString _collection; MakeYapDatabaseString(&_collection, collection);
+	
+	if (!isAbsolute)
+	{
+		sqlite3_stmt *statement = [connection updateCollectionStatisticsStatement];
+		if (statement == NULL) {
+			FreeYapDatabaseString(&_collection);
+			return nil;
+		}
+		
+		// UPDATE "collection_stats" SET "count" = "count" + ?, "bytes" = "bytes" + ? WHERE "collection" = ?;
+		
+		int const bind_idx_count      = SQLITE_BIND_START + 0;
+		int const bind_idx_bytes      = SQLITE_BIND_START + 1;
+		int const bind_idx_collection = SQLITE_BIND_START + 2;
+		
+		sqlite3_bind_int64(statement, bind_idx_count, numberOfKeys);
+		sqlite3_bind_int64(statement, bind_idx_bytes, numberOfBytes);
+		sqlite3_bind_text(statement, bind_idx_collection, _collection.str, _collection.length, SQLITE_STATIC);
+		
+		int status = sqlite3_step(statement);
+		if (status == SQLITE_DONE)
+		{
+			exists = (sqlite3_changes(connection->db) > 0);
+		}
+		else
+		{
+			YDBLogError(@"Error executing 'updateCollectionStatisticsStatement': %d %s",
+			            status, sqlite3_errmsg(connection->db));
+			failed = YES;
+		}
+		
+		sqlite3_clear_bindings(statement);
+		sqlite3_reset(statement);
+	}
+	
+	if (exists)
+	{
+		// Fetch the new values
+		
+		sqlite3_stmt *statement = [connection getCollectionStatisticsStatement];
+		if (statement == NULL) {
+			FreeYapDatabaseString(&_collection);
+			return nil;
+		}
+		
+		// SELECT "count", "bytes" FROM "collection_stats" WHERE "collection" = ?;
+		
+		int const column_idx_count    = SQLITE_COLUMN_START + 0;
+		int const column_idx_bytes    = SQLITE_COLUMN_START + 1;
+		int const bind_idx_collection = SQLITE_BIND_START;
+		
+		sqlite3_bind_text(statement, bind_idx_collection, _collection.str, _collection.length, SQLITE_STATIC);
+		
+		int status = sqlite3_step(statement);
+		if (status == SQLITE_ROW)
+		{
+			numberOfKeys = sqlite3_column_int64(statement, column_idx_count);
+			numberOfBytes = sqlite3_column_int64(statement, column_idx_bytes);
+		}
+		else
+		{
+			YDBLogError(@"Error executing 'getCollectionStatisticsStatement': %d %s",
+			            status, sqlite3_errmsg(connection->db));
+			failed = YES;
+		}
+		
+		sqlite3_clear_bindings(statement);
+		sqlite3_reset(statement);
+	}
+	
+	if (failed)
+	{
+		FreeYapDatabaseString(&_collection);
+		return nil;
+	}
+	
+	if (numberOfKeys > 0)
+	{
+		if (!exists)
+		{
+			sqlite3_stmt *statement = [connection insertCollectionStatisticsStatement];
+			if (statement == NULL) {
+				FreeYapDatabaseString(&_collection);
+				return nil;
+			}
+			
+			// INSERT OR REPLACE INTO "collection_stats" ("collection", "count", "bytes") VALUES (?, ?, ?);
+			
+			int const bind_idx_collection = SQLITE_BIND_START + 0;
+			int const bind_idx_count      = SQLITE_BIND_START + 1;
+			int const bind_idx_bytes      = SQLITE_BIND_START + 2;
+			
+			sqlite3_bind_text(statement, bind_idx_collection, _collection.str, _collection.length, SQLITE_STATIC);
+			sqlite3_bind_int64(statement, bind_idx_count, numberOfKeys);
+			sqlite3_bind_int64(statement, bind_idx_bytes, MAX(numberOfBytes, 0));
+			
+			int status = sqlite3_step(statement);
+			if (status != SQLITE_DONE)
+			{
+				YDBLogError(@"Error executing 'insertCollectionStatisticsStatement': %d %s",
+				            status, sqlite3_errmsg(connection->db));
+				failed = YES;
+			}
+			
+			sqlite3_clear_bindings(statement);
+			sqlite3_reset(statement);
+		}
+	}
+	else
+	{
+		// The collection is now empty
+		
+		if (exists || isAbsolute)
+		{
+			sqlite3_stmt *statement = [connection removeCollectionStatisticsStatement];
+			if (statement == NULL) {
+				FreeYapDatabaseString(&_collection);
+				return nil;
+			}
+			
+			// DELETE FROM "collection_stats" WHERE "collection" = ?;
+			
+			int const bind_idx_collection = SQLITE_BIND_START;
+			
+			sqlite3_bind_text(statement, bind_idx_collection, _collection.str, _collection.length, SQLITE_STATIC);
+			
+			int status = sqlite3_step(statement);
+			if (status != SQLITE_DONE)
+			{
+				YDBLogError(@"Error executing 'removeCollectionStatisticsStatement': %d %s",
+				            status, sqlite3_errmsg(connection->db));
+				failed = YES;
+			}
+			
+			sqlite3_clear_bindings(statement);
+			sqlite3_reset(statement);
+		}
+		
+		numberOfKeys = 0;
+		numberOfBytes = 0;
+	}
+	
+	FreeYapDatabaseString(&_collection);
+	
+	if (failed) return nil;
+	
+	return [[YapDatabaseCollectionStatistics alloc] initWithNumberOfKeys:numberOfKeys numberOfBytes:numberOfBytes];
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma mark Completion
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////